@@ -0,0 +1,13 @@
+/*
+ * C library versions of the asn1c allocation hooks; see acm_asn_alloc.h.
+ *
+ * These are weak so the definitions in the ACM take precedence when it links libasncodec.a.
+ */
+#include <stdlib.h>
+
+#include "acm_asn_alloc.h"
+
+__attribute__((weak)) void *acm_asn_calloc(size_t nmemb, size_t size) { return calloc(nmemb, size); }
+__attribute__((weak)) void *acm_asn_malloc(size_t size) { return malloc(size); }
+__attribute__((weak)) void *acm_asn_realloc(void *ptr, size_t size) { return realloc(ptr, size); }
+__attribute__((weak)) void acm_asn_free(void *ptr) { free(ptr); }
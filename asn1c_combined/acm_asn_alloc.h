@@ -0,0 +1,27 @@
+/*
+ * Allocation hooks for the generated asn1c runtime.
+ *
+ * doIt.sh includes this file from asn_internal.h when ACM_ASN1_ARENA=1 so the CALLOC, MALLOC, REALLOC, and FREEMEM
+ * macros call these functions. The ACM provides them (src/asn1_arena.cpp) to place the structures built for one
+ * message in a per-thread arena; acm_asn_alloc.c provides weak C library versions for the other programs linked with
+ * libasncodec.a.
+ */
+#ifndef ACM_ASN_ALLOC_H
+#define ACM_ASN_ALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *acm_asn_calloc(size_t nmemb, size_t size);
+void *acm_asn_malloc(size_t size);
+void *acm_asn_realloc(void *ptr, size_t size);
+void acm_asn_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
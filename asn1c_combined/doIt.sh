@@ -12,4 +12,16 @@ asn1c -fcompound-names -gen-PER -gen-OER -pdu=all \
 
 sed -i 's/\(-DASN_PDU_COLLECTION\)/-DPDU=MessageFrame \1/' converter-example.mk
 
-make -f converter-example.mk
+# With ACM_ASN1_ARENA=1 the runtime allocates through acm_asn_alloc.h, so the ACM can place each message's structures
+# in a per-thread arena (see include/asn1_arena.hpp).
+if [ "${ACM_ASN1_ARENA:-0}" = "1" ]; then
+    sed -i -e 's/^#define[[:space:]]*CALLOC(nmemb, size).*/#include "acm_asn_alloc.h"\n#define\tCALLOC(nmemb, size)\tacm_asn_calloc(nmemb, size)/' \
+           -e 's/^#define[[:space:]]*MALLOC(size).*/#define\tMALLOC(size)\t\tacm_asn_malloc(size)/' \
+           -e 's/^#define[[:space:]]*REALLOC(oldptr, size).*/#define\tREALLOC(oldptr, size)\tacm_asn_realloc(oldptr, size)/' \
+           -e 's/^#define[[:space:]]*FREEMEM(ptr).*/#define\tFREEMEM(ptr)\t\tacm_asn_free(ptr)/' \
+           asn_internal.h
+    echo 'ASN_MODULE_SRCS+=acm_asn_alloc.c' >> Makefile.am.libasncodec
+fi
+
+# libasncodec.a is position independent so it can also be linked into libacm.so (cmake -DACM_SHARED_LIBRARY=ON).
+CFLAGS="${CFLAGS} -fPIC" make -f converter-example.mk
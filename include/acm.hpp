@@ -56,145 +56,253 @@
  * TODO: Add to docs, if your encoding rules are WRONG, you will get a bad data error -- the data may be good under another set of encoding rules.
  */
 
-#include "MessageFrame.h"
-#include "Ieee1609Dot2Data.h"
-#include "AdvisorySituationData.h"
+#include "acm_codec.hpp"
+#include "alloc_counter.hpp"
+#include "batch_input.hpp"
+#include "commit_manager.hpp"
+#include "cpu_affinity.hpp"
+#include "geofence.hpp"
+#include "kafka_stats.hpp"
+#include "latency_histogram.hpp"
+#include "batch_tuner.hpp"
+#include "bsm_deduplicator.hpp"
+#include "bsm_rate_limiter.hpp"
+#include "error_breaker.hpp"
+#include "lane_queue.hpp"
+#include "memory_budget.hpp"
+#include "message_latencies.hpp"
+#include "metrics_endpoint.hpp"
+#include "ring_queue.hpp"
+#include "output_buffer_pool.hpp"
+#include "output_partitioner.hpp"
+#include "produce_stream.hpp"
+#include "spool_directory.hpp"
+#include "trajectory_aggregator.hpp"
+#include "shm_ring.hpp"
+#include "slow_messages.hpp"
+#include "udp_receiver.hpp"
 #include "tool.hpp"
 #include "spdlog/spdlog.h"
 #include "rdkafkacpp.h"
 #include "pugixml.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
 #include <utility>
 #include <tuple>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
-typedef struct buffer_structure {
-    char *buffer;
-    size_t buffer_size;      // this is really where we will write next.
-    size_t allocated_size;   // this is the total size of the buffer.
-} buffer_structure_t;
-
-enum class Asn1ErrorType : uint32_t {
-    SUCCESS = 0,            // not used.
-    FAILURE,                // not used.
-    REQUEST,                // Any error relating to the input XML.
-    DATA,                   // Any error relating to the payload in the input XML.
-    COUNT
-};
-
-enum class Asn1DataType : uint32_t {
-    ODE = 0,                // return data type for all error messages.
-    XML,                    // return data type for XML/MessageFrame data.
-    HEX,                    // hex byte array data type.
-    PAYLOAD,                // payload type.
-    COUNT
-};
-
-// an enumeration that specifies which bit in a flag word is used to turn on and off certain operations.
-enum class Asn1OpsType : uint32_t {
-	IEEE1609DOT2 = 1,			// 1<<0
-	J2735MESSAGEFRAME = 2,		// 1<<1
-	ASDFRAME = 4,					// 1<<2
-	COUNT
-};
-
-class UnparseableInputError : public std::runtime_error {
-
-    Asn1DataType dt_;
-    Asn1ErrorType et_;
+/**
+ * Returns each produced response buffer to the output pool once librdkafka is done with it, delivered or not, and
+ * completes the consumed message's commit token (the message opaque) when it was delivered. The delivery counters and
+ * latencies are kept for reporting; the callback runs on the producer poll thread.
+ */
+class PooledDeliveryReport : public RdKafka::DeliveryReportCb {
 
     public:
 
-        explicit UnparseableInputError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
+        std::atomic<uint64_t> delivered;                                ///> responses acknowledged by the brokers.
+        std::atomic<uint64_t> failed;                                   ///> responses librdkafka gave up on.
+        std::atomic<uint64_t> latency_us;                               ///> total produce to acknowledgement time.
+        std::atomic<uint64_t> max_latency_us;
+
+        PooledDeliveryReport( OutputBufferPool& pool, CommitManager& commits ) :
+            delivered{ 0 }
+            , failed{ 0 }
+            , latency_us{ 0 }
+            , max_latency_us{ 0 }
+            , pool_( pool )
+            , commits_( commits )
+            , latencies_{ nullptr }
         {}
 
-        explicit UnparseableInputError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST  ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
-        {}
-
-        virtual ~UnparseableInputError() throw () 
-        { }
-
-        Asn1DataType data_type() const 
+        /**
+         * @brief Record the delivery latency of each output topic in latencies; null stops. Set before producing.
+         */
+        void track_latencies( MessageLatencies* latencies )
         {
-            return dt_;
+            latencies_ = latencies;
         }
 
-        Asn1ErrorType error_type() const 
+        void dr_cb( RdKafka::Message& message ) override
         {
-            return et_;
+            bool ok = ( message.err() == RdKafka::ERR_NO_ERROR );
+
+            pool_.release( static_cast<char*>( message.payload() ) );
+            commits_.complete( static_cast<CommitManager::Token*>( message.msg_opaque() ), ok );
+
+            if ( ok ) {
+                ++delivered;
+            } else {
+                ++failed;
+            }
+
+            // only the poll thread updates the maximum.
+            int64_t latency = message.latency();
+            if ( latency > 0 ) {
+                latency_us += static_cast<uint64_t>( latency );
+                if ( static_cast<uint64_t>( latency ) > max_latency_us.load() ) max_latency_us = static_cast<uint64_t>( latency );
+                if ( latencies_ ) latencies_->delivery( message.topic_name() ).record( static_cast<uint64_t>( latency ) * 1000 );
+            }
         }
-};
 
-class MissingInputElementError : public std::runtime_error {
+    private:
 
-    Asn1DataType dt_;
-    Asn1ErrorType et_;
+        OutputBufferPool& pool_;
+        CommitManager& commits_;
+        MessageLatencies* latencies_;
+};
 
-    public:
+/**
+ * Keeps the last statistics report of the producer and of the consumer, and writes the librdkafka errors and logs to
+ * the ACM logs instead of stderr. Installed only when statistics.interval.ms is configured; the callback runs on the
+ * producer poll thread and on the consumer thread.
+ */
+class KafkaEventReport : public RdKafka::EventCb {
 
-        explicit MissingInputElementError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
-        {}
+    public:
 
-        explicit MissingInputElementError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST  ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
+        KafkaEventReport( const std::shared_ptr<spdlog::logger>& ilogger, const std::shared_ptr<spdlog::logger>& elogger ) :
+            ilogger_( ilogger )
+            , elogger_( elogger )
+            , mutex_{}
+            , producer_{}
+            , consumer_{}
         {}
 
-        virtual ~MissingInputElementError() throw () 
-        { }
-
-        Asn1DataType data_type() const 
+        void event_cb( RdKafka::Event& event ) override
         {
-            return dt_;
+            switch ( event.type() ) {
+                case RdKafka::Event::EVENT_STATS:
+                    {
+                        std::string json = event.str();
+                        KafkaStatistics stats;
+                        if ( !KafkaStatistics::parse( json.data(), json.size(), stats ) ) {
+                            elogger_->warn("librdkafka statistics are not valid JSON.");
+                            break;
+                        }
+
+                        std::lock_guard<std::mutex> lock{ mutex_ };
+                        if ( stats.type == "producer" ) {
+                            producer_ = std::move( stats );
+                        } else {
+                            consumer_ = std::move( stats );
+                        }
+                    }
+                    break;
+
+                case RdKafka::Event::EVENT_ERROR:
+                    elogger_->error("librdkafka error: {} {}", RdKafka::err2str( event.err() ), event.str());
+                    break;
+
+                case RdKafka::Event::EVENT_THROTTLE:
+                    ilogger_->warn("librdkafka throttled {} ms by broker {}", event.throttle_time(), event.broker_name());
+                    break;
+
+                default:
+                    if ( event.severity() <= RdKafka::Event::EVENT_SEVERITY_ERROR ) {
+                        elogger_->error("librdkafka {}: {}", event.fac(), event.str());
+                    } else if ( event.severity() == RdKafka::Event::EVENT_SEVERITY_WARNING ) {
+                        ilogger_->warn("librdkafka {}: {}", event.fac(), event.str());
+                    } else {
+                        ilogger_->debug("librdkafka {}: {}", event.fac(), event.str());
+                    }
+                    break;
+            }
         }
 
-        Asn1ErrorType error_type() const 
+        /**
+         * @brief Copy the last statistics reports; a client that has not reported yet has an empty type.
+         */
+        void latest( KafkaStatistics& producer, KafkaStatistics& consumer )
         {
-            return et_;
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            producer = producer_;
+            consumer = consumer_;
         }
+
+    private:
+
+        const std::shared_ptr<spdlog::logger>& ilogger_;
+        const std::shared_ptr<spdlog::logger>& elogger_;
+        std::mutex mutex_;
+        KafkaStatistics producer_;
+        KafkaStatistics consumer_;
 };
 
-class Asn1CodecError : public std::runtime_error {
-    Asn1DataType dt_;
-    Asn1ErrorType et_;
+/**
+ * Assigns and revokes the consumer's partitions, incrementally when the group uses the cooperative-sticky assignor
+ * (partition.assignment.strategy), so only the partitions that move stop. Before a partition is given up, drain is
+ * called to finish, and commit, the work already consumed from it. The callback runs on the consumer thread.
+ */
+class ConsumerRebalance : public RdKafka::RebalanceCb {
 
     public:
 
-        explicit Asn1CodecError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::DATA ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
-        {}
+        typedef std::function<void( const std::vector<RdKafka::TopicPartition*>& )> Drain;
 
-        explicit Asn1CodecError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::DATA  ) :
-            std::runtime_error{ message }
-            , dt_{ dt }
-            , et_{ et }
+        ConsumerRebalance( const std::shared_ptr<spdlog::logger>& ilogger, const std::shared_ptr<spdlog::logger>& elogger ) :
+            ilogger_( ilogger )
+            , elogger_( elogger )
+            , drain_{}
         {}
 
-        virtual ~Asn1CodecError() throw () 
-        { }
-
-        Asn1DataType data_type() const 
+        void set_drain( Drain drain )
         {
-            return dt_;
+            drain_ = std::move( drain );
         }
 
-        Asn1ErrorType error_type() const 
+        void rebalance_cb( RdKafka::KafkaConsumer* consumer, RdKafka::ErrorCode err, std::vector<RdKafka::TopicPartition*>& partitions ) override
         {
-            return et_;
+            bool cooperative = ( consumer->rebalance_protocol() == "COOPERATIVE" );
+            RdKafka::Error* error = nullptr;
+            RdKafka::ErrorCode status = RdKafka::ERR_NO_ERROR;
+
+            if ( err == RdKafka::ERR__ASSIGN_PARTITIONS ) {
+                ilogger_->info("rebalance: {} partitions assigned ({}).", partitions.size(), cooperative ? "incremental" : "eager");
+
+                if ( cooperative ) {
+                    error = consumer->incremental_assign( partitions );
+                } else {
+                    status = consumer->assign( partitions );
+                }
+            } else {
+                if ( err != RdKafka::ERR__REVOKE_PARTITIONS ) {
+                    elogger_->error("rebalance: {}; giving up the partitions.", RdKafka::err2str( err ));
+                }
+
+                ilogger_->info("rebalance: {} partitions revoked ({}); draining them.", partitions.size(), cooperative ? "incremental" : "eager");
+                if ( drain_ ) drain_( partitions );
+
+                if ( cooperative ) {
+                    error = consumer->incremental_unassign( partitions );
+                } else {
+                    status = consumer->unassign();
+                }
+            }
+
+            if ( error ) {
+                elogger_->error("rebalance: {}", error->str());
+                delete error;
+            } else if ( status != RdKafka::ERR_NO_ERROR ) {
+                elogger_->error("rebalance: {}", RdKafka::err2str( status ));
+            }
         }
+
+    private:
+
+        const std::shared_ptr<spdlog::logger>& ilogger_;
+        const std::shared_ptr<spdlog::logger>& elogger_;
+        Drain drain_;
 };
 
 class ASN1_Codec : public tool::Tool {
@@ -206,17 +314,110 @@ class ASN1_Codec : public tool::Tool {
 
         static void sigterm (int sig);
 
+        /**
+         * @brief Ask the consume loop to reload the configuration file.
+         */
+        static void sighup (int sig);
+
+        /**
+         * @brief Ask the consume loop for a dump of the ACM's state.
+         */
+        static void sigusr1 (int sig);
+
         ASN1_Codec( const std::string& name, const std::string& description );
         ~ASN1_Codec();
         void metadata_print (const std::string &topic, const RdKafka::Metadata *metadata);
-        bool topic_available( const std::string& topic );
+        /**
+         * @brief Look for the waiting topics in one metadata request and remove those that are available.
+         *
+         * @return true when no topic is left waiting.
+         */
+        bool topics_available( std::vector<std::string>& waiting );
         void print_configuration() const;
         bool configure();
         bool launch_consumer();
         bool launch_producer();
-        bool process_message(RdKafka::Message* message, std::stringstream& output_message_stream);
+        bool message_available(RdKafka::Message* message);
+        /**
+         * A consumed message waiting to be processed, with the time it was consumed.
+         */
+        struct WorkItem {
+            std::unique_ptr<RdKafka::Message> message;
+            std::chrono::steady_clock::time_point consumed;
+            MessageLatencies::Partition* latencies;                     ///> the histograms of its partition; null when not tracked.
+            std::size_t lane;                                           ///> its priority lane; 0 is the highest.
+        };
+
+        std::size_t consume_batch(std::vector<WorkItem>& batch);
+        bool process_message(RdKafka::Message* message, CodecContext& codec, ProduceStream& output_message_stream);
+        /**
+         * @brief Produce the response in output_message_stream, retrying while the producer queue is full; token, when
+         * not null, is completed by the delivery report.
+         *
+         * @return false when the response could not be produced; its buffer is back in the pool.
+         */
+        bool produce_response(const CodecContext& codec, ProduceStream& output_message_stream, int32_t input_partition, std::size_t topic, CommitManager::Token* token);
+
+        /**
+         * A serialized response waiting for a produce thread; the buffer, headers, and token pass to librdkafka when it
+         * is produced.
+         */
+        struct ProduceItem {
+            char* buffer;
+            std::size_t size;
+            int32_t partition;
+            std::size_t topic;                                          ///> the index of the output topic.
+            RdKafka::Headers* headers;
+            CommitManager::Token* token;
+            std::string key;                                            ///> the Kafka key; empty for none.
+        };
+
+        /**
+         * @brief Give the item to librdkafka, retrying while the producer queue is full.
+         *
+         * @return false when the response could not be produced; its buffer is back in the pool.
+         */
+        bool produce_item(ProduceItem& item);
+        /**
+         * @brief Decode a binary message as the next bytes of its partition's PDU stream and produce one response per
+         * complete PDU; an incomplete PDU at the end is carried to the partition's next message.
+         *
+         * @return false when any response is an error response.
+         */
+        bool process_stream_message(RdKafka::Message* message, CodecContext& codec, ProduceStream& output_message_stream, const char* encodings, std::size_t encodings_length, std::size_t topic);
+        /**
+         * @brief The headers of a response: its envelope when acm.output.headers is set and the signature status of its
+         * signed frames; null when it has neither.
+         */
+        RdKafka::Headers* make_headers(const CodecContext::ResponseMetadata& metadata, SignatureVerifier::Status signature) const;
         bool filetest();
         bool file_test(std::string file_path, std::ostream& os, bool encode = true);
+
+        /**
+         * @brief Process every message in a replay file (the first operand, or stdin) with the worker codecs and write
+         * the responses, one per line and in input order, to output_path ("-" for stdout); Kafka is not used.
+         *
+         * @return EXIT_SUCCESS when the whole input was read and every response written.
+         */
+        int batch( const std::string& output_path );
+
+        /**
+         * @brief Process the files dropped into the spool directory until a signal stops the ACM; the responses are
+         * produced to Kafka or written to the spool output directory.
+         */
+        int spool();
+
+        /**
+         * @brief Decode the datagrams received on the UDP listen address until a signal stops the ACM; every worker
+         * receives on a socket of its own and produces its responses to Kafka.
+         */
+        int udp();
+
+        /**
+         * @brief Process the requests of the shared memory input ring until a signal stops the ACM; the responses go to
+         * the output ring, or to Kafka when there is none.
+         */
+        int shm();
         int operator()(void);
 
         /**
@@ -236,33 +437,38 @@ class ASN1_Codec : public tool::Tool {
 
         static bool bootstrap;                                          ///> flag indicating we need to bootstrap the consumer and producer
         static bool data_available;                                     ///> flag to exit application; set via signals so static.
+        static bool reload_requested;                                   ///> flag to reload the configuration file; set via SIGHUP so static.
+        static bool dump_requested;                                     ///> flag to dump the diagnostics; set via SIGUSR1 so static.
 
         static constexpr long ilogsize = 1048576 * 5;                   ///> The size of a single information log; these rotate.
         static constexpr long elogsize = 1048576 * 2;                   ///> The size of a single error log; these rotate.
         static constexpr int ilognum = 5;                               ///> The number of information logs to rotate.
         static constexpr int elognum = 2;                               ///> The number of error logs to rotate.
-        static constexpr std::size_t max_errbuf_size = 128;             ///> The length of error buffers for ASN.1 compiler.
-
-        // possible encoding configurations.
-        static constexpr uint32_t IEEE1609DOT2 = 1;
-        static constexpr uint32_t J2735MESSAGEFRAME = 2;		
-        static constexpr uint32_t IEEE1609DOT2_J2735MESSAGEFRAME = 3;
-        static constexpr uint32_t ASDFRAME = 4;
-        static constexpr uint32_t ASDFRAME_IEEE1609DOT2 = 5;
-        static constexpr uint32_t ASDFRAME_J2735MESSAGEFRAME = 6;
-        static constexpr uint32_t ASDFRAME_IEEE1609DOT2_J2735MESSAGEFRAME = 7;
 
         bool exit_eof;                                                  ///> flag to cause the application to exit on stream eof.
-        int32_t eof_cnt;                                                ///> counts the number of eofs needed for exit_eof to work; each partition must end.
-        int32_t partition_cnt;                                          ///> TODO: the number of partitions being processed; currently 1.
-
-        // bookkeeping.
-        uint64_t msg_recv_count;                                        ///> Counter for the number of BSMs received.
-        uint64_t msg_send_count;                                        ///> Counter for the number of BSMs published.
-        uint64_t msg_filt_count;                                        ///> Counter for hte number of BSMs filtered/suppressed.
-        uint64_t msg_recv_bytes;                                        ///> Counter for the number of BSM bytes received.
-        uint64_t msg_send_bytes;                                        ///> Counter for the nubmer of BSM bytes published.
-        uint64_t msg_filt_bytes;                                        ///> Counter for the nubmer of BSM bytes filtered/suppressed.
+        std::set<std::pair<std::string, int32_t>> eof_partitions;      ///> the assigned partitions at their end; each must end for exit_eof to work.
+        int32_t partition_cnt;                                          ///> the number of partitions assigned to the consumer.
+
+        // bookkeeping; updated by all the worker threads.
+        std::atomic<uint64_t> msg_recv_count;                           ///> Counter for the number of BSMs received.
+        std::atomic<uint64_t> msg_send_count;                           ///> Counter for the number of BSMs published.
+        std::atomic<uint64_t> msg_filt_count;                           ///> Counter for hte number of BSMs filtered/suppressed.
+        std::atomic<uint64_t> msg_recv_bytes;                           ///> Counter for the number of BSM bytes received.
+        std::atomic<uint64_t> msg_send_bytes;                           ///> Counter for the nubmer of BSM bytes published.
+        std::atomic<uint64_t> msg_filt_bytes;                           ///> Counter for the nubmer of BSM bytes filtered/suppressed.
+        std::atomic<uint64_t> msg_error_count;                          ///> Counter for the number of messages answered with an error.
+        std::atomic<uint64_t> produce_error_count;                      ///> Counter for the number of responses that could not be produced.
+
+        // periodic statistics; logged by the reporter thread.
+        int stats_interval;                                             ///> milliseconds between statistics reports; 0 disables them.
+        std::unique_ptr<MessageLatencies> message_latencies;            ///> reported with the statistics; null when not tracked.
+        std::unique_ptr<MetricsEndpoint> metrics_endpoint;              ///> serves the scaling signals of each report; null when not listening.
+        std::atomic<uint64_t> busy_ns;                                  ///> the time the threads spent processing messages; counted for the endpoint.
+        std::atomic<std::size_t> processing_threads;                    ///> the threads busy_ns is counted on.
+        bool reporting;                                                 ///> guarded by report_mutex.
+        std::mutex report_mutex;
+        std::condition_variable report_cv;
+        std::thread report_thread;
 
         // Logging.
         spdlog::level::level_enum iloglevel;                            ///> Log level for the information log.
@@ -272,76 +478,413 @@ class ASN1_Codec : public tool::Tool {
 
         // configurations; global and topic (the names in these are fixed)
         std::unordered_map<std::string, std::string> pconf;
+        std::unordered_map<std::string, std::string> file_settings;     ///> every setting of the configuration file as running.
         RdKafka::Conf *conf;
         RdKafka::Conf *tconf;
 
         // Kafka component pointers and variables.
         int consumer_timeout;
+        std::size_t consume_batch_size;                                 ///> The maximum number of messages consumed per loop iteration.
+        int consume_batch_timeout;                                      ///> The maximum milliseconds spent filling a batch.
+        std::unique_ptr<BatchTuner> batch_tuner;                        ///> adjusts the two above for a latency target; null when they are fixed.
+        int batch_tune_interval;                                        ///> milliseconds between adjustments.
+        std::chrono::steady_clock::time_point next_batch_tune;
+        std::unique_ptr<std::ofstream> capture;                         ///> the consumed messages as timed batch frames; null when not captured.
+        std::string capture_frame;                                      ///> the frame being written.
         std::string brokers;
         int32_t partition;
+        std::unique_ptr<OutputPartitioner> partitioner;                ///> chooses the partition of each response.
         int64_t offset;
         std::string published_topic_name;                               ///> The topic we are publishing filtered BSM to.
         std::vector<std::string> consumed_topics;                       ///> consumer topics.
+        OutputBufferPool output_pool;                                   ///> response buffers; must outlive the producer.
+        CommitManager commit_manager;                                   ///> the delivered offsets; must outlive the producer.
+        PooledDeliveryReport delivery_report;
+        KafkaEventReport event_report;                                  ///> the librdkafka statistics; must outlive the clients.
+        ConsumerRebalance rebalance;                                    ///> must outlive the consumer.
+        int rebalance_drain_timeout;                                    ///> milliseconds a revoked partition may take to drain.
+        bool kafka_statistics;                                          ///> true when statistics.interval.ms is configured.
+        int commit_interval;                                            ///> milliseconds between offset commits; 0 uses the Kafka auto commit.
+        std::chrono::steady_clock::time_point next_commit;
+        std::atomic<uint64_t> produce_retry_count;                      ///> produce calls repeated because the local queue was full.
+        int histogram_interval;                                         ///> milliseconds between latency histogram logs; 0 disables them.
+        std::chrono::steady_clock::time_point next_histogram;
+        std::unique_ptr<LatencyHistogram[]> histograms;                 ///> indexed by histogram_index; null when disabled.
+        std::atomic<bool> polling;
+        std::thread poll_thread;                                        ///> serves the producer delivery reports.
         std::shared_ptr<RdKafka::KafkaConsumer> consumer_ptr;
         std::shared_ptr<RdKafka::Producer> producer_ptr;
-        std::shared_ptr<RdKafka::Topic> published_topic_ptr;
+        std::vector<std::string> output_topic_names;                    ///> the produced topics; the first is published_topic_name.
+        std::vector<std::shared_ptr<RdKafka::Topic>> output_topics;     ///> the handles of output_topic_names, created with the producer.
 
-        // ODE XML input XPath queries and parse options.
-        pugi::xml_document input_doc;
-        pugi::xml_document internal_doc;
-        pugi::xml_document error_doc;                                   ///> A base XML document to use in responding to input XML parse errors.
+        /**
+         * The pipeline of the messages of one consumed topic: their direction, output topic, and, when the topic has
+         * workers of its own, those workers, their constraint check policies, and their lazy decode setting.
+         */
+        struct TopicRoute {
+            bool decode;
+            std::size_t output;                                         ///> the index of the output topic.
+            std::size_t workers;                                        ///> the workers only this topic uses; 0 to share the others.
+            std::size_t first_worker;
+            std::vector<std::pair<std::string, ValidationPolicy>> validation_policies;  ///> replace the configured ones in the topic's workers.
+            bool own_lazy_decode;                                       ///> lazy_decode replaces acm.decode.lazy in the topic's workers.
+            LazyDecode lazy_decode;
+        };
+
+        std::unordered_map<std::string, TopicRoute> routes;             ///> by consumed topic; empty when acm.type sets the direction.
+        std::unordered_map<int32_t, std::size_t> message_routes;        ///> the output topic of each routed MessageFrame messageId.
+        std::size_t shared_worker;                                      ///> the first worker of the topics without workers of their own.
+
+        // priority lanes: the messages of the priority topics go to their worker's high lane, the rest to its normal lane.
+        static constexpr std::size_t lane_count = 2;
+        std::unordered_set<std::string> priority_topics;                ///> the consumed topics of the high lane; empty for one lane.
+        unsigned priority_weight;                                       ///> the high lane messages taken in a row while normal ones wait; 0 is strict.
+        std::unique_ptr<LatencyHistogram[]> lane_latencies;             ///> consumption to response of each lane; null without priority topics.
 
-        unsigned int xml_parse_options;
-        pugi::xpath_query ieee1609dot2_unsecuredData_query;
-        pugi::xpath_query ode_payload_query;
-        pugi::xpath_query ode_encodings_query;
+        /**
+         * @brief Read acm.priority.topics and acm.priority.weight.
+         *
+         * @return false when a priority topic is not consumed.
+         */
+        bool configure_priority();
 
-        std::ostringstream erroross;
-		bool add_error_xml( pugi::xml_document& doc, Asn1DataType dt, Asn1ErrorType et, std::string message, bool update_time = false );
+        /**
+         * @brief Read acm.routes, consumed:decode|encode:output entries, and acm.routes.messageid, messageId:output
+         * entries.
+         *
+         * @return false when an entry is not a route.
+         */
+        bool configure_routes();
 
-        std::vector<char> byte_buffer;                                 ///> storage for hex to byte and byte to hex encoder/decoder.
+        /**
+         * @brief Give the routes with acm.route.<topic>.workers their workers, from the first one, in the order of
+         * acm.routes; the other topics share the rest.
+         *
+         * @return false when the workers do not leave one for the topics that share them.
+         */
+        bool assign_workers();
 
+        /**
+         * @brief The worker of a consumed partition: one of its route's workers or of the shared ones.
+         */
+        std::size_t worker_of( const std::string& topic, int32_t partition ) const;
 
-        bool hex_to_bytes_(const std::string& payload_hex, std::vector<char>& byte_buffer);
-        bool bytes_to_hex_(buffer_structure_t* buf_struct, std::string& payload_hex );
+        /**
+         * @brief Give a consumed message to its worker. The message of a partition whose worker is full is held, and
+         * the partition paused, so the other partitions keep going.
+         */
+        void dispatch( WorkItem& item );
 
-        // ASN.1 Compiler
-        std::size_t errlen;
-        char errbuf[max_errbuf_size];
+        /**
+         * @brief Give the held messages to their workers, in order, and resume the partitions that have none left.
+         */
+        void dispatch_held();
 
-		// TODO: A byte flag word is needed here since we will set multiple decode / encoders.
-		uint32_t opsflag;
-        bool decode_1609dot2;
-        bool decode_messageframe;
-		bool decode_asdframe;
-        bool decode_functionality;
+        /**
+         * @brief Give item to worker id if its queue and the memory budget of the queues have room.
+         */
+        bool try_queue( std::size_t id, WorkItem& item );
 
-		// TODO: flagword is more challenging here...
-        enum asn_transfer_syntax decode_1609dot2_type;
-        enum asn_transfer_syntax decode_messageframe_type;
-        enum asn_transfer_syntax decode_asdframe_type;
-        enum asn_transfer_syntax curr_decode_type_;
-    
-        uint32_t curr_op_;
-        std::string curr_node_path_;
-        pugi::xml_node payload_node_;
+        /**
+         * @brief Forget the held messages of revoked partitions; they are consumed again by the next owner.
+         */
+        void release_held( const std::vector<RdKafka::TopicPartition*>& partitions );
 
-        std::vector<std::tuple<uint32_t, enum asn_transfer_syntax, std::string, bool>> protocol_;
-        std::vector<std::tuple<std::string, std::string>> hex_data_;
+        std::deque<WorkItem> held_items;                                ///> the messages of paused partitions, in consumed order.
+        std::set<std::pair<std::string, int32_t>> paused_partitions;
 
-        enum asn_transfer_syntax get_ats_transfer_syntax( const char* ats_type );
-        bool set_codec_requirements( pugi::xml_document& doc );
+        /**
+         * @brief Give codec i the constraint check policies of the route it works for, or the configured ones.
+         */
+        void set_validation_policies( std::size_t i );
 
-        bool decode_message( pugi::xml_node& payload_node, std::stringstream& output_message_stream );
-        bool decode_message_legacy( pugi::xml_node& payload_node, std::stringstream& output_message_stream );
-        bool decode_1609dot2_data( std::string& data_as_hex, buffer_structure_t* xml_buffer );
-        bool decode_messageframe_data( std::string& data_as_hex, buffer_structure_t* xml_buffer );
+        /**
+         * @brief Give codec i the lazy decode setting of the route it works for, or the configured one.
+         */
+        void set_lazy_decode( std::size_t i );
 
-        bool encode_message( std::stringstream& output_message_stream );
-        void encode_frame_data(const std::string& data_as_xml, std::string& hex_string);
-        void encode_node_as_hex_string(bool replace = true);
-        void encode_for_protocol();
+        /**
+         * @brief The index of an output topic, adding it when it is new.
+         */
+        std::size_t output_topic( const std::string& name );
 
-        std::string get_current_time() const;
-};
+        /**
+         * @brief true when the messages, of some topic, are decoded (decode) or encoded.
+         */
+        bool uses_direction( bool decode ) const;
+
+        bool decode_functionality;                                      ///> true when decoding; false when encoding.
+        std::string error_template_file;                                ///> The ODE XML used to respond to input errors.
+        bool splice_output;                                             ///> write decoded XER directly into the output envelope.
+        bool slice_input;                                               ///> give the encoder the element text from the input message.
+        bool dom_input;                                                 ///> fill the encoded structures from the parsed document.
+        bool base64_output;                                             ///> write the encoded bytes as base64 instead of hex.
+        bool scan_envelope;                                             ///> decode without loading the envelope into the DOM.
+        bool concatenated_pdus;                                         ///> decode every PDU in the payload bytes, not just the first.
+        bool bsm_fast_path;                                             ///> decode common UPER BSMs without asn1c.
+        bool compact_xer;                                               ///> write the decoded MessageFrames as compact XER.
+        LazyDecode lazy_decode;                                         ///> the 1609.2 frames decoded only as far as their header.
+        std::string projection;                                         ///> the paths of the MessageFrame fields written; empty for all.
+        std::size_t decode_cache_size;                                  ///> the memory cap of each worker's decode cache in bytes; 0 when not used.
+        std::size_t map_cache_size;                                     ///> the memory cap of each worker's MAP revision cache in bytes; 0 when not used.
+        std::size_t encode_cache_size;                                  ///> the memory cap of each worker's encode cache in bytes; 0 when not used.
+        std::size_t encode_templates;                                   ///> the TIM templates each worker keeps; 0 when not used.
+        bool json_output;                                               ///> respond with JSON instead of ODE XML.
+        uint32_t message_key_fields;                                    ///> the MessageKey bits of the decoded fields the response keys are taken from.
+        bool binary_input;                                              ///> consume raw UPER/COER bytes instead of ODE XML.
+        bool output_headers;                                            ///> produce only the decoded payload; the envelope is in headers.
+        std::vector<std::pair<std::string, ValidationPolicy>> validation_policies;  ///> the configured constraint check policy of each PDU type.
+        std::string input_encodings;                                    ///> the encodings of binary messages without the header.
+        std::string input_encodings_header;                             ///> the Kafka header holding the encodings of a binary message.
+        bool input_stream;                                              ///> binary messages are pieces of a per-partition PDU stream.
+        std::size_t asn1_arena_size;                                    ///> The chunk size of the per-worker asn1c arenas; 0 when not used.
+        MessageBudget message_budget;                                   ///> the limits of every message; 0 turns one off.
+        std::size_t xml_pool_size;                                      ///> The chunk size of the per-worker pugixml page pools; 0 when not used.
+        BatchInput::Framing batch_framing;                              ///> how the messages of a batch mode input are delimited.
+        std::string spool_dir;                                          ///> the directory of files to ingest instead of consuming Kafka.
+        std::string spool_output_dir;                                   ///> where spool responses are written; Kafka when empty.
+        std::string spool_done_dir;                                     ///> where processed spool files are moved.
+        std::string udp_listen;                                         ///> the [host:]port of the UDP ingest; Kafka is consumed when empty.
+        std::string udp_encodings;                                      ///> the encodings of every datagram.
+        std::size_t udp_batch;                                          ///> the datagrams received by one recvmmsg call.
+        std::size_t udp_max_bytes;                                      ///> the largest datagram; larger ones are truncated and dropped.
+        std::string shm_input;                                          ///> the shared memory ring of the requests; Kafka is consumed when empty.
+        std::string shm_output;                                         ///> the shared memory ring of the responses; Kafka when empty.
+        std::size_t shm_bytes;                                          ///> the capacity of a ring the ACM makes.
+
+        // Startup.
+        int metadata_timeout;                                           ///> The milliseconds of each topic metadata request while waiting on the topics.
+        std::vector<std::pair<std::string, bool>> warmup_files;         ///> the samples every codec processes before the first message, and whether each is decoded.
+        int warmup_rounds;                                              ///> The times each codec processes the samples; 0 skips the warm-up.
+        std::string ready_file;                                         ///> exists while the ACM is processing at full speed; empty when not used.
+
+        // Worker pool; each worker owns one codec context; context 0 is used by the consumer thread when there is one worker.
+        std::size_t worker_threads;                                     ///> The number of codec contexts/threads.
+        std::size_t worker_queue_size;                                  ///> The maximum number of messages waiting for a worker.
+        std::vector<std::unique_ptr<CodecContext>> codecs;
+        BsmArchive::Settings archive_settings;                          ///> the Parquet archive of the decoded BSMs; off when its uri is empty.
+        std::vector<std::unique_ptr<BsmArchive>> archives;              ///> one per codec.
+        std::shared_ptr<const GeofenceIndex> geofence;                  ///> the polygons the BSMs are kept in; null when not used.
+        std::unique_ptr<GeofenceFilter> geofence_filter;                ///> shared by every codec.
+        std::size_t geofence_topic;                                     ///> the output of the BSMs outside the geofence when they are diverted.
+        std::unique_ptr<BsmDeduplicator> deduplicator;                  ///> shared by every codec; null when duplicates are decoded.
+        std::unique_ptr<BsmRateLimiter> rate_limiter;                   ///> shared by every codec; null when the BSMs are not rate limited.
+        std::unique_ptr<ErrorBreaker> error_breaker;                    ///> shared by every worker; null when every error response is produced.
+        std::chrono::steady_clock::time_point next_error_summary;
+        bool spat_delta;                                                ///> write only the changed movements of each SPaT.
+        uint32_t spat_snapshot_seconds;                                 ///> how often each intersection of a SPaT is written whole.
+        std::unique_ptr<SignatureVerifier> verifier;                    ///> shared by every codec; null when signatures are not verified.
+        bool verify_drop;                                               ///> produce nothing for a frame with an invalid signature.
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<LaneQueue<WorkItem>>> work_queues;    ///> one per worker; a partition always uses the same queue.
+        std::unique_ptr<std::atomic<uint64_t>[]> worker_backlog;       ///> the messages given to each worker and not yet processed.
+        std::unique_ptr<MemoryBudget> memory_budget;                    ///> shared by every stage; null when acm.memory.budget is not set.
+        std::vector<std::pair<std::size_t, std::size_t>> memory_reported;   ///> the cache and arena bytes each codec last added to the budget.
+        std::size_t batch_bytes;                                        ///> the bytes of the consume batch in the budget.
+
+        /**
+         * @brief Bring the budget's use of the caches and arena of codec id up to date; called on the codec's thread.
+         */
+        void track_memory( std::size_t id );
+
+        /**
+         * @brief The bytes of arena chunks each codec keeps between messages within the budget; 0 for all.
+         */
+        std::size_t arena_retain() const;
+
+        // Produce stage; when it has threads, the codec threads hand their responses to them instead of producing.
+        std::size_t produce_threads;                                    ///> The number of produce threads; 0 produces on the codec threads.
+        uint32_t produce_wait_ms;                                       ///> how long a response waits for room in a full producer queue.
+        std::vector<std::thread> producers;
+        std::vector<std::unique_ptr<RingQueue<ProduceItem>>> produce_queues;    ///> one per produce thread; a produce partition always uses the same queue.
+
+        // Quarantine; the inputs that fail are copied to a topic of their own so they can be decoded again after a fix.
+        std::string quarantine_topic_name;                              ///> empty when failed inputs are not kept.
+        std::size_t quarantine_topic;                                   ///> the index of the output topic.
+        bool reprocess;                                                 ///> consume the quarantine topic, to its end, instead of the inputs.
+        std::thread quarantiner;
+        std::unique_ptr<RingQueue<ProduceItem>> quarantine_queue;
+        std::atomic<uint64_t> msg_quarantine_count;                     ///> Counter for the number of inputs copied to the quarantine topic.
+
+        /**
+         * @brief Read acm.quarantine.topic and acm.quarantine.reprocess; reprocessing consumes the quarantine topic in
+         * place of the configured inputs.
+         *
+         * @return false when reprocessing has no quarantine topic.
+         */
+        bool configure_quarantine();
+
+        /**
+         * @brief Queue a copy of a failed input, its key and headers, with the error type and the position it was
+         * consumed from, for the quarantine topic. The copy has a commit token of its own, so the offset is committed
+         * only when both it and the error response are delivered.
+         */
+        void quarantine( RdKafka::Message* message, const CodecContext& codec );
+
+        /**
+         * @brief Produce the quarantined copies; a copy waits while the responses fill the produce queues.
+         */
+        void quarantine_producer();
+
+        // Trajectories; the positions of each vehicle's BSMs are summarized once per window to a topic of their own.
+        std::unique_ptr<TrajectoryAggregator> trajectories;             ///> the last filter of every codec; null when not summarized.
+        std::size_t trajectory_topic;                                   ///> the index of the output topic.
+        bool summarizing;                                               ///> guarded by trajectory_mutex.
+        std::mutex trajectory_mutex;
+        std::condition_variable trajectory_cv;
+        std::thread trajectory_thread;
+        std::atomic<uint64_t> msg_trajectory_count;                     ///> Counter for the number of trajectory summaries produced.
+
+        /**
+         * @brief Produce the summaries of the windows that have ended, at least every second; when stopped, the open
+         * tracks are summarized as they are.
+         */
+        void trajectory_producer();
+
+        bool make_codecs();
+        void make_work_queues();
+
+        /**
+         * @brief Give the BSM filters of the configuration to a codec, in the order they are applied.
+         */
+        void add_filters( CodecContext& codec );
+
+        /**
+         * @brief Count the BSMs the codec's last message dropped; true when it has no response.
+         */
+        bool filtered( const CodecContext& codec );
+
+        /**
+         * @brief Count the codec's last response, an error, against its source's breaker; true when it is dropped.
+         */
+        bool error_dropped( const CodecContext& codec, const std::string& topic, int32_t partition );
 
+        /**
+         * @brief Record the latency of a processed message for the batch tuner.
+         */
+        void processed( const WorkItem& item );
+
+        /**
+         * @brief Apply the batch tuner's adjustment for the last interval; the consumer thread.
+         */
+        void tune_batching();
+
+        /**
+         * @brief Read the key = value lines of a configuration file in order.
+         *
+         * @return false when the file cannot be opened.
+         */
+        bool read_settings( const std::string& cfile, std::vector<std::pair<std::string, std::string>>& settings );
+
+        /**
+         * @brief Read the settings that a reload may change: log levels, consume batch, caches, validation policies,
+         * and worker threads.
+         *
+         * @return false when one of them cannot be used.
+         */
+        bool configure_reloadable();
+
+        /**
+         * @brief Re-read the configuration file and apply the changed settings that configure_reloadable reads; the
+         * workers are restarted when their codecs change. Every other change is logged and ignored.
+         *
+         * @return false when a change was rejected.
+         */
+        bool reload();
+
+        /**
+         * @brief Run the warm-up samples through every codec, so the first messages do not pay for first allocations
+         * and cold caches; a sample that cannot be read is skipped.
+         */
+        void warm_up();
+
+        /**
+         * @brief Create (ready) or remove the readiness file.
+         */
+        void signal_ready( bool ready );
+        bool process_spool_file( SpoolDirectory::File& file, CodecContext& codec, ProduceStream& output_message_stream );
+        void receive_datagrams( UdpReceiver& receiver, CodecContext& codec );
+        void start_workers();
+        void stop_workers();
+        void worker( std::size_t id );
+        // CPU placement; a role with an empty set runs on the CPUs the process started with, not on those of the
+        // thread that created it.
+        std::vector<int> process_cpus;                                  ///> the main thread's CPUs at construction.
+        std::vector<int> kafka_cpus;                                    ///> the librdkafka threads and the delivery report poll thread.
+        std::vector<int> consumer_cpus;                                 ///> the consume loop.
+        std::vector<int> worker_cpus;                                   ///> the codec workers, one CPU each in turn.
+        std::vector<int> producer_cpus;                                 ///> the produce threads.
+
+        /**
+         * @brief Read a CPU list setting; false when it is present and not a CPU list.
+         */
+        bool configure_cpus( const char* key, std::vector<int>& cpus );
+
+        /**
+         * @brief Place the calling thread on cpus; on process_cpus when cpus is empty, so an unplaced role does not
+         * keep the CPUs of the thread that created it.
+         */
+        void pin_thread( const std::vector<int>& cpus, const char* role );
+
+        /**
+         * @brief Wait until the messages consumed from the partitions are processed and their responses delivered, or the
+         * drain timeout passes, and commit their offsets; the other partitions keep being processed meanwhile.
+         */
+        void drain_partitions( const std::vector<RdKafka::TopicPartition*>& partitions );
+
+        void start_producers();
+        void stop_producers();
+        void producer( std::size_t id );
+        int32_t assigned_partitions();
+        void commit_offsets( bool synchronous );
+
+        // the latencies kept for each message type (opsflag) and outcome: every codec stage, the whole codec, and produce.
+        static constexpr std::size_t histogram_stages = static_cast<std::size_t>( CodecStage::COUNT ) + 2;
+        static constexpr std::size_t histogram_types = 8;                ///> every combination of the three Asn1OpsType bits.
+        static constexpr std::size_t histogram_count = histogram_types * 2 * histogram_stages;
+        static std::size_t histogram_index( uint32_t ops, bool success, std::size_t stage );
+        void record_latencies( const CodecContext& codec, bool success, uint64_t codec_ns, uint64_t produce_ns );
+        void log_histograms();
+        void log_error_storms();
+
+        /**
+         * The counters of a codec, copied on the thread that uses it for a diagnostics dump.
+         */
+        struct CodecReport {
+            bool ready;                                                 ///> copied since the dump was requested.
+            ResultCache::Stats decode_cache;
+            ResultCache::Stats map_cache;
+            ResultCache::Stats encode_cache;
+            ValidationStats validation;
+            BudgetStats budget;
+            std::size_t arena_bytes;
+            AllocCounter::Counts allocations;                           ///> of the codec's thread since it started.
+        };
+
+        std::string diagnostics_file;                                   ///> the file the dumps are appended to; the information log when empty.
+        std::unique_ptr<SlowMessages> slow_messages;                    ///> shared by every worker; null when not kept.
+        std::vector<CodecReport> codec_reports;                         ///> one per codec; guarded by diagnostics_mutex.
+        std::mutex diagnostics_mutex;
+        bool diagnostics_pending;
+        std::chrono::steady_clock::time_point diagnostics_due;
+
+        /**
+         * @brief Ask each worker for its counters, with an item on its priority lane, and schedule the dump; the
+         * consumer does not wait for them.
+         */
+        void request_diagnostics();
+
+        /**
+         * @brief Copy the counters of codec id; called on the thread that uses it.
+         */
+        void report_codec( std::size_t id );
+
+        /**
+         * @brief Write the dump with the counters the workers have reported; a busy worker's are missing.
+         */
+        void dump_diagnostics();
+        void start_polling();
+        void stop_polling();
+        void start_reporting();
+        void stop_reporting();
+};
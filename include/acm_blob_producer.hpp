@@ -53,6 +53,54 @@
 #include "tool.hpp"
 #include "spdlog/spdlog.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Counts the acknowledged and failed load messages; the messages point into the corpus, so nothing is freed.
+ */
+class LoadDeliveryReport : public RdKafka::DeliveryReportCb {
+
+    public:
+
+        std::atomic<uint64_t> delivered;
+        std::atomic<uint64_t> failed;
+
+        LoadDeliveryReport() :
+            delivered{ 0 }
+            , failed{ 0 }
+        {}
+
+        void dr_cb( RdKafka::Message& message ) override
+        {
+            if ( message.err() == RdKafka::ERR_NO_ERROR ) {
+                ++delivered;
+            } else {
+                ++failed;
+            }
+        }
+};
+
+/**
+ * A load generator for the ACM. The input file (the corpus) is memory mapped and cut into messages, either in fixed
+ * size blocks or at the boundaries of the PDUs it holds; each message is produced as it is or, with an envelope template, as the hex payload of an ODE XML envelope. The messages are built
+ * once, so producing copies nothing: librdkafka is handed pointers into the corpus (or the envelopes), which stay
+ * mapped until every message has been delivered.
+ *
+ * Several threads share one producer and replay the corpus until the message count is reached or a signal arrives,
+ * together holding the target rate (or as fast as the producer accepts messages). The achieved rate is reported
+ * periodically and at the end.
+ *
+ * A timed corpus is a capture of consumed messages in the timed batch framing (BatchInput). It is replayed with its
+ * original burst shape instead: each captured partition has its own thread, which produces every message of the
+ * partition when its timestamp, relative to the first one of the capture and divided by the speed-up factor, comes due.
+ */
 class ACMBlobProducer : public tool::Tool {
 
     public:
@@ -89,24 +137,42 @@ class ACMBlobProducer : public tool::Tool {
 
         static constexpr long ilogsize = 1048576 * 5;                   ///> The size of a single information log; these rotate.
         static constexpr long elogsize = 1048576 * 2;                   ///> The size of a single error log; these rotate.
-        
-        // If this buffer size is too small then an entire record will not be processed and things will FAIL!
-        // buffer for the ASN1 stuff.
-        static constexpr std::size_t BUFSIZE = 1<<12;                   ///> 4k
-        uint8_t buf[BUFSIZE];
+        static constexpr std::size_t default_block_size = 1<<12;        ///> 4k
+        static constexpr const char* payload_placeholder = "{{payload}}";  ///> replaced by the hex payload in an envelope template.
 
         static constexpr int ilognum = 5;                               ///> The number of information logs to rotate.
         static constexpr int elognum = 2;                               ///> The number of error logs to rotate.
 
-        // counters.
-        uint64_t msg_send_count;                                            ///> Counter for the number of BSMs published.
-        uint64_t msg_send_bytes;                                         ///> Counter for the nubmer of BSM bytes published.
+        // counters; updated by all the producer threads.
+        std::atomic<uint64_t> msg_send_count;                           ///> Counter for the number of BSMs published.
+        std::atomic<uint64_t> msg_send_bytes;                           ///> Counter for the nubmer of BSM bytes published.
+        std::atomic<uint64_t> queue_full_count;                         ///> produce calls repeated because the local queue was full.
 
         spdlog::level::level_enum iloglevel;                            ///> Log level for the information log.
         spdlog::level::level_enum eloglevel;                            ///> Log level for the error log.
         std::string debug;
         std::string input_file;
         std::size_t block_size;
+        std::string template_file;                                      ///> ODE XML envelope holding payload_placeholder; empty to send raw blocks.
+        std::string pdu;                                                ///> Type:RULE of the corpus PDUs; empty to cut fixed size blocks.
+        double target_rate;                                             ///> messages per second over all threads; 0 is unlimited.
+        bool timed;                                                     ///> the input file is a timed capture, replayed by its timestamps.
+        double speed;                                                   ///> the speed-up factor of a timed replay.
+        bool fixed_partition;                                           ///> a timed replay produces to partition, not the captured ones.
+        std::size_t producer_threads;
+        uint64_t message_limit;                                         ///> messages to produce; 0 produces until a signal arrives.
+        int report_interval;                                            ///> seconds between achieved rate reports.
+
+        // the corpus and the messages built from it.
+        const char* corpus;                                             ///> the mapped input file.
+        std::size_t corpus_size;
+        std::string envelopes;                                          ///> every enveloped message, when there is a template.
+        std::vector<std::pair<const char*, std::size_t>> messages;      ///> into the corpus or the envelopes.
+        std::atomic<uint64_t> next_message;                             ///> the sequence number of the next message to produce.
+        std::vector<int64_t> message_times;                             ///> of a timed corpus: each message's milliseconds after the first.
+        std::map<int32_t, std::vector<std::size_t>> partition_messages; ///> of a timed corpus: the messages of each captured partition, in order.
+        int64_t capture_span;                                           ///> of a timed corpus: the milliseconds from its first to its last message.
+        LoadDeliveryReport delivery_report;
 
         int32_t partition;
         std::string published_topic_name;                                    ///> The topic we are publishing filtered BSM to.
@@ -118,5 +184,35 @@ class ACMBlobProducer : public tool::Tool {
 
         std::shared_ptr<RdKafka::Producer> producer_ptr;
         std::shared_ptr<RdKafka::Topic> published_topic_ptr;
+
+        bool load_corpus();
+        /**
+         * @brief Cut the corpus at its PDU boundaries and pack whole PDUs into blocks of at most block_size bytes; a
+         * PDU larger than a block is split over several blocks. With an envelope template each block is one PDU.
+         *
+         * @return false when pdu is not understood or a PDU in the corpus cannot be decoded.
+         */
+        bool frame_pdus( std::vector<std::pair<const char*, std::size_t>>& blocks ) const;
+
+        /**
+         * @brief Read the messages of a timed corpus, their times, and their partitions.
+         *
+         * @return false when the corpus ends inside a frame.
+         */
+        bool read_capture( std::vector<std::pair<const char*, std::size_t>>& blocks );
+
+        /**
+         * @brief Produce one message, waiting while the local queue is full.
+         *
+         * @return false when it cannot be produced or a signal arrived.
+         */
+        bool produce_message( std::size_t id, int32_t to, const std::pair<const char*, std::size_t>& message );
+        void produce_load( std::size_t id, std::chrono::steady_clock::time_point start );
+
+        /**
+         * @brief Replay the messages of one captured partition by their times; every pass over the capture starts
+         * where the previous one ended.
+         */
+        void replay_partition( std::size_t id, int32_t captured, const std::vector<std::size_t>& indices, std::chrono::steady_clock::time_point start );
 };
 
@@ -0,0 +1,1113 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_CODEC_HPP
+#define ACM_CODEC_HPP
+
+#include "MessageFrame.h"
+#include "Ieee1609Dot2Data.h"
+#include "AdvisorySituationData.h"
+#include "asn1_arena.hpp"
+#include "asn1_json.hpp"
+#include "asn1_projection.hpp"
+#include "bsm_archive.hpp"
+#include "bsm_fast_path.hpp"
+#include "bsm_filter.hpp"
+#include "coarse_clock.hpp"
+#include "map_frame.hpp"
+#include "ode_envelope.hpp"
+#include "result_cache.hpp"
+#include "signature_verifier.hpp"
+#include "spat_delta.hpp"
+#include "tim_template.hpp"
+#include "xml_page_pool.hpp"
+#include "spdlog/spdlog.h"
+#include "pugixml.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+typedef struct buffer_structure {
+    char *buffer;
+    size_t buffer_size;      // this is really where we will write next.
+    size_t allocated_size;   // this is the total size of the buffer.
+} buffer_structure_t;
+
+enum class Asn1ErrorType : uint32_t {
+    SUCCESS = 0,            // not used.
+    FAILURE,                // not used.
+    REQUEST,                // Any error relating to the input XML.
+    DATA,                   // Any error relating to the payload in the input XML.
+    COUNT
+};
+
+enum class Asn1DataType : uint32_t {
+    ODE = 0,                // return data type for all error messages.
+    XML,                    // return data type for XML/MessageFrame data.
+    HEX,                    // hex byte array data type.
+    PAYLOAD,                // payload type.
+    COUNT
+};
+
+// an enumeration that specifies which bit in a flag word is used to turn on and off certain operations.
+enum class Asn1OpsType : uint32_t {
+	IEEE1609DOT2 = 1,			// 1<<0
+	J2735MESSAGEFRAME = 2,		// 1<<1
+	ASDFRAME = 4,					// 1<<2
+	COUNT
+};
+
+// the decoded fields the Kafka key of a response can be taken from; a bit each.
+enum class MessageKey : uint32_t {
+    NONE = 0,
+    BSM_ID = 1,             // the temporary id of a BSM, 8 hex digits.
+    INTERSECTION_ID = 2,    // the id of the first intersection of a MAP or SPaT; region:id when it has a region.
+    TIM_PACKET_ID = 4,      // the packetID of a TIM, 18 hex digits.
+};
+
+// the parts of processing a message that are timed separately.
+enum class CodecStage : uint32_t {
+    ENVELOPE = 0,           // parsing the ODE XML envelope (DOM or scanner).
+    REQUIREMENTS,           // resolving the encodings into the codec requirements.
+    HEX,                    // conversion between hex and bytes.
+    BINARY,                 // asn1c UPER/COER decoding and encoding.
+    CONSTRAINTS,            // asn1c constraints checks.
+    XER,                    // asn1c XER decoding and encoding, or the JSON writer.
+    SERIALIZE,              // writing the response.
+    COUNT
+};
+
+extern const char* asn1errortypes[];
+extern const char* asn1datatypes[];
+extern const char* codecstages[];
+
+std::ostream& operator<<( std::ostream& os, Asn1ErrorType err );
+std::ostream& operator<<( std::ostream& os, Asn1DataType dt );
+
+class UnparseableInputError : public std::runtime_error {
+
+    Asn1DataType dt_;
+    Asn1ErrorType et_;
+
+    public:
+
+        explicit UnparseableInputError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        explicit UnparseableInputError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST  ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        virtual ~UnparseableInputError() throw ()
+        { }
+
+        Asn1DataType data_type() const
+        {
+            return dt_;
+        }
+
+        Asn1ErrorType error_type() const
+        {
+            return et_;
+        }
+};
+
+class MissingInputElementError : public std::runtime_error {
+
+    Asn1DataType dt_;
+    Asn1ErrorType et_;
+
+    public:
+
+        explicit MissingInputElementError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        explicit MissingInputElementError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::REQUEST  ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        virtual ~MissingInputElementError() throw ()
+        { }
+
+        Asn1DataType data_type() const
+        {
+            return dt_;
+        }
+
+        Asn1ErrorType error_type() const
+        {
+            return et_;
+        }
+};
+
+class Asn1CodecError : public std::runtime_error {
+    Asn1DataType dt_;
+    Asn1ErrorType et_;
+
+    public:
+
+        explicit Asn1CodecError( const char* message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::DATA ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        explicit Asn1CodecError( const std::string& message, Asn1DataType dt = Asn1DataType::ODE, Asn1ErrorType et = Asn1ErrorType::DATA  ) :
+            std::runtime_error{ message }
+            , dt_{ dt }
+            , et_{ et }
+        {}
+
+        virtual ~Asn1CodecError() throw ()
+        { }
+
+        Asn1DataType data_type() const
+        {
+            return dt_;
+        }
+
+        Asn1ErrorType error_type() const
+        {
+            return et_;
+        }
+};
+
+/**
+ * How often the structures of one PDU type are checked against their ASN.1 constraints after they are decoded.
+ *
+ * A sampled check never rejects a message, so every message of the type is handled the same way; its violations are
+ * only counted and logged.
+ */
+struct ValidationPolicy {
+    enum class Mode { ALWAYS, SAMPLED, OFF };
+
+    Mode mode;
+    uint32_t rate_ppm;                                                  ///> the share of sampled messages checked, in parts per million.
+
+    /**
+     * @brief Parse a policy: always, off, sample:N (every Nth message), or sample:X% (X percent of the messages).
+     *
+     * @throws std::invalid_argument when the text is not a policy.
+     */
+    static ValidationPolicy parse( const std::string& policy );
+};
+
+/**
+ * The constraint checks made by a context.
+ */
+struct ValidationStats {
+    uint64_t checked;
+    uint64_t skipped;
+    uint64_t violations;                                                ///> includes the sampled violations.
+    uint64_t sampled_violations;                                        ///> violations found by sampled checks; the messages were not rejected.
+};
+
+/**
+ * The limits one message is processed within, so a pathological input fails fast instead of holding up the messages
+ * behind it; 0 turns a limit off.
+ */
+struct MessageBudget {
+    std::size_t max_bytes;                                              ///> the largest input message.
+    std::size_t max_stack;                                              ///> the stack an asn1c decoder may use, which bounds the nesting of a PDU; 0 for asn1c's default.
+    std::size_t max_memory;                                             ///> the bytes of the asn1c structures of one message; needs the arena.
+    uint32_t max_ms;                                                    ///> the time one message may take; checked during asn1c decoding with the arena, and between layers.
+};
+
+/**
+ * The messages a context stopped because they went over their budget.
+ */
+struct BudgetStats {
+    uint64_t oversize;
+    uint64_t memory;
+    uint64_t time;
+};
+
+/**
+ * Which IEEE 1609.2 frames are decoded only as far as their header. A lazy frame's response holds its PSID, generation
+ * time, and signer, which are enough to route it, and its unsecuredData as the hex of the bytes received; the
+ * MessageFrame inside is not decoded.
+ */
+struct LazyDecode {
+    bool enabled;
+    std::vector<uintmax_t> full_psids;                                  ///> the PSIDs whose MessageFrame is still decoded.
+
+    /**
+     * @brief Parse a setting: off, on, or a comma-separated list of the PSIDs, decimal or 0x hex, that are decoded in
+     * full while the others are lazy.
+     *
+     * @throws std::invalid_argument when the text is not a setting.
+     */
+    static LazyDecode parse( const std::string& setting );
+
+    /**
+     * @brief Whether the frames with the PSID are decoded only as far as their header.
+     */
+    bool lazy( uintmax_t psid ) const;
+};
+
+/**
+ * The per-message state and the encode/decode operations of the ACM.
+ *
+ * A CodecContext owns everything that is modified while a single ODE message is processed: the pugixml documents, the
+ * ASN.1 compiler error buffer, the hex/byte scratch buffers, and the encode protocol. A context is NOT thread-safe;
+ * each worker thread owns exactly one context so encoding and decoding can run in parallel without locking.
+ */
+class CodecContext {
+
+    public:
+
+        /**
+         * The ODE envelope of a payload only response; every field is empty for responses that are complete ODE
+         * documents.
+         */
+        struct ResponseMetadata {
+            std::string payload_type;
+            std::string data_type;
+            std::string generated_at;
+            std::string encodings;                                      ///> elementType:encodingRule pairs separated by commas.
+
+            void clear();
+        };
+
+        /**
+         * @brief Construct a codec context that logs to the provided loggers.
+         *
+         * @param ilogger the information logger; if null, log messages are discarded.
+         * @param elogger the error logger; if null, log messages are discarded.
+         * @param decode true if this context decodes ASN.1 binary data; false if it encodes XML into ASN.1 binary data.
+         */
+        CodecContext( std::shared_ptr<spdlog::logger> ilogger, std::shared_ptr<spdlog::logger> elogger, bool decode = true );
+
+        ~CodecContext();
+
+        CodecContext( const CodecContext& ) = delete;
+        CodecContext& operator=( const CodecContext& ) = delete;
+
+        /**
+         * @brief Load the XML document used to report errors about unparseable or incomplete input.
+         *
+         * @param errorfile the path to the error XML template.
+         * @return true if the template was loaded; false otherwise.
+         */
+        bool load_error_template( const std::string& errorfile );
+
+        void set_decode_functionality( bool decode );
+        bool decode_functionality() const;
+
+        /**
+         * @brief Allocate the asn1c structures of each message from an arena owned by this context.
+         *
+         * Only effective when the asn1c library was generated with ACM_ASN1_ARENA=1.
+         *
+         * @param chunk_size the size of the arena chunks in bytes; 0 turns the arena off.
+         */
+        void use_arena( std::size_t chunk_size );
+
+        /**
+         * @brief Keep at most max_bytes of arena chunks between messages; 0 keeps them all.
+         */
+        void set_arena_retain( std::size_t max_bytes );
+
+        /**
+         * @brief The bytes held by the arena and by the decode, MAP, and encode caches; read on the thread using the
+         * context.
+         */
+        std::size_t arena_bytes() const;
+        std::size_t cache_bytes() const;
+
+        /**
+         * @brief Allocate the pugixml pages of the documents from a pool owned by this context, recycled between
+         * messages (see XmlPagePool).
+         *
+         * Call it before load_error_template() and the first message.
+         *
+         * @param chunk_size the size of the pool chunks in bytes; 0 turns the pool off.
+         */
+        void use_xml_pool( std::size_t chunk_size );
+
+        /**
+         * @brief Keep the decoded output of recent payloads so a payload decoded again with the same encodings is
+         * written without the asn1c decoders, constraint checks, or XER/JSON writer.
+         *
+         * Only payloads that decode to a MessageFrame are kept; failures are never kept.
+         *
+         * @param capacity the memory cap of the cache in bytes; 0 (the default) turns the cache off.
+         */
+        void use_decode_cache( std::size_t capacity );
+
+        /**
+         * @brief The counters of the decode cache; all zero when it is off.
+         */
+        ResultCache::Stats decode_cache_stats() const;
+
+        /**
+         * @brief Keep the hex encodings of recently encoded elements so an element encoded again is not XER decoded,
+         * checked, and encoded. Each layer of an encode is looked up by its own XML, so the same MessageFrame inside
+         * different enclosing elements is only encoded once.
+         *
+         * @param capacity the memory cap of the cache in bytes; 0 (the default) turns the cache off.
+         */
+        void use_encode_cache( std::size_t capacity );
+
+        /**
+         * @brief The counters of the encode cache; all zero when it is off.
+         */
+        ResultCache::Stats encode_cache_stats() const;
+
+        /**
+         * @brief Keep the decoded structures of recent TIM templates so a TIM that differs from one only in its
+         * msgCnt, timeStamp, packetID, and frame times is encoded without being XER decoded; see TimTemplates. A TIM
+         * encoded from a template is not put in the encode cache.
+         *
+         * @param count the number of templates kept; 0 (the default) turns them off.
+         */
+        void use_encode_templates( std::size_t count );
+
+        /**
+         * @brief The TIM templates; null when they are off.
+         */
+        const TimTemplates* encode_templates() const;
+
+        /**
+         * @brief Keep the XER of recent MAP revisions so a UPER MAP of a revision already decoded, inside any
+         * envelope or 1609.2 frame, is written without asn1c; only its timeStamp text is changed.
+         *
+         * MAPs are looked up by their map_frame::revision_key. A MAP with JSON or projected output is always decoded.
+         *
+         * @param capacity the memory cap of the cache in bytes; 0 (the default) turns the cache off.
+         */
+        void use_map_cache( std::size_t capacity );
+
+        /**
+         * @brief The counters of the MAP cache; all zero when it is off.
+         */
+        ResultCache::Stats map_cache_stats() const;
+
+        /**
+         * @brief Write only the intersections and movements of each decoded SPaT that changed since the last SPaT of
+         * the intersection this context decoded, and the whole intersection every snapshot_seconds; a SPaT with no
+         * change writes no response and its verdict is DROP. The state is this context's, so each worker keeps its own.
+         *
+         * @param delta false (the default) to write every SPaT whole.
+         */
+        void use_spat_delta( bool delta, uint32_t snapshot_seconds = 10 );
+
+        /**
+         * @brief Give the hashes and signature of each decoded 1609.2 signedData frame to verifier, which is shared by
+         * every context; decoding goes on while it verifies. nullptr (the default) verifies nothing.
+         */
+        void set_verifier( SignatureVerifier* verifier );
+
+        /**
+         * @brief The signature status of the last response: the worst status of its signed frames, or NONE when it has
+         * none. This waits for the verifier.
+         */
+        SignatureVerifier::Status signature_status() const;
+
+        /**
+         * @brief Set which IEEE 1609.2 frames are decoded only as far as their header; every frame is decoded in full by
+         * default. Only a request that decodes both the Ieee1609Dot2Data and its MessageFrame is affected; the BSM
+         * filters, the archive, and the SPaT delta do not see a lazy frame.
+         */
+        void set_lazy_decode( const LazyDecode& lazy );
+
+        /**
+         * @brief Set the constraint check policy of a PDU type; every type is always checked by default.
+         *
+         * @param type_name Ieee1609Dot2Data, MessageFrame, or AdvisorySituationData.
+         * @return false when the type is not one this context decodes or encodes.
+         */
+        bool set_validation_policy( const std::string& type_name, const ValidationPolicy& policy );
+
+        const ValidationStats& validation_stats() const;
+
+        /**
+         * @brief Set the limits of every message; a message over one gets a DATA error response.
+         */
+        void set_budget( const MessageBudget& budget );
+
+        const BudgetStats& budget_stats() const;
+
+        /**
+         * The time spent in each stage of one message and, in a build that counts them (alloc_counter.hpp), the heap
+         * allocations each made.
+         */
+        struct StageTimes {
+            uint64_t ns[static_cast<int>(CodecStage::COUNT)];
+            uint64_t allocations[static_cast<int>(CodecStage::COUNT)];
+            uint64_t bytes[static_cast<int>(CodecStage::COUNT)];
+        };
+
+        /**
+         * @brief Time the stages of every message; off by default because reading the clock costs tens of nanoseconds
+         * per stage.
+         */
+        void set_stage_timing( bool timing );
+
+        /**
+         * @brief The stage times of the last message processed; all zero when stage timing is off.
+         */
+        const StageTimes& stage_times() const;
+
+        /**
+         * @brief The Asn1OpsType flags of the last message processed; 0 when its type could not be determined.
+         */
+        uint32_t operations() const;
+
+        /**
+         * @brief Choose how decoded XER is placed in the ODE output.
+         *
+         * @param splice true (the default) to write the canonical XER directly into the serialized ODE envelope; false to
+         * parse the XER and insert it into the ODE document before serializing.
+         */
+        void set_splice_output( bool splice );
+
+        /**
+         * @brief Choose how the XML of the element being encoded is given to the XER decoder.
+         *
+         * @param slice true (the default) to pass the element's text directly from the input message when the document has
+         * not been modified; false to always serialize the element from the parsed document. Slices are not whitespace
+         * trimmed.
+         */
+        void set_slice_input( bool slice );
+
+        /**
+         * @brief Choose how the element being encoded is read into its ASN.1 structure.
+         *
+         * @param dom true (the default) to fill the structure directly from the parsed document with asn1_dom; false to
+         * give the element's XML to the XER decoder (see set_slice_input). With an encode cache the XML is always used,
+         * since it is the cache key.
+         */
+        void set_dom_input( bool dom );
+
+        /**
+         * @brief Choose the text encoding of the bytes in encode responses.
+         *
+         * @param base64 true to write the bytes as base64 in a bytes element with the attribute encoding="base64"; false
+         * (the default) to write upper case hex. Decode requests select their encoding with the same attribute.
+         */
+        void set_base64_output( bool base64 );
+
+        /**
+         * @brief Choose how decode requests are read.
+         *
+         * @param scan true (the default) to find the encodings and bytes with a single forward scan and copy the rest of
+         * the envelope to the output as it is, using the DOM only for envelopes the scanner does not accept and for
+         * errors; false to always load the envelope into the DOM. Scanning is only used when the output is spliced.
+         */
+        void set_scan_envelope( bool scan );
+
+        /**
+         * @brief Choose the format of the responses.
+         *
+         * @param json false (the default) for ODE XML; true for JSON. In JSON the decoded MessageFrame is written
+         * directly from its C structure and the envelope, error, and encode responses are converted from their XML;
+         * decode requests are then always read with the DOM.
+         */
+        void set_json_output( bool json );
+
+        /**
+         * @brief Choose which fields of a decoded MessageFrame are written.
+         *
+         * @param paths empty (the default) to write the complete MessageFrame; otherwise the comma separated paths of
+         * the fields to write, below the MessageFrame element, e.g., value/BasicSafetyMessage/coreData/lat (see
+         * Asn1Projection). The selected fields are written in XER or JSON as the complete MessageFrame would be.
+         *
+         * @throws std::invalid_argument when the paths are not valid.
+         */
+        void set_projection( const std::string& paths );
+
+        /**
+         * @brief Choose how many PDUs the hex bytes of a decode request hold.
+         *
+         * @param concatenated false (the default) to decode the first PDU and ignore any bytes after it; true to decode
+         * every PDU in the bytes, one after another. Their XER elements follow one another in the data element; in JSON
+         * the data is an array. Bytes that do not end with a complete PDU are an error.
+         */
+        void set_concatenated_pdus( bool concatenated );
+
+        /**
+         * @brief Choose how UPER MessageFrames holding a BSM are decoded.
+         *
+         * @param fast true (the default) to decode the common BSM layouts with bsm_fast_path and write their canonical
+         * XER directly; anything else, and JSON or projected output, still uses asn1c. false to always use asn1c.
+         */
+        void set_bsm_fast_path( bool fast );
+
+        /**
+         * @brief Choose the tag set of the decoded MessageFrame XER.
+         *
+         * @param compact false (the default) for canonical XER; true for the compact XER of asn1_xer, with ENUMERATED
+         * and BOOLEAN values as element text and empty element tags. A projection is written as canonical XER.
+         */
+        void set_compact_xer( bool compact );
+
+        /**
+         * @brief Append the BSMcoreData of every BSM this context decodes to an archive; nullptr (the default) for none.
+         *
+         * The archive is not owned and must outlive its use. A response served from the decode cache is not archived
+         * again.
+         */
+        void set_archive( BsmArchive* archive );
+        BsmArchive* archive() const;
+
+        /**
+         * @brief Test every BSM this context decodes with filter, after the filters already added; the filters are
+         * not owned and must outlive their use.
+         *
+         * A dropped BSM writes no XER or JSON, and a message whose BSMs are all dropped writes no response; verdict()
+         * tells the caller. The decode cache is not used while there are filters, since a filter may keep state.
+         */
+        void add_filter( BsmFilter* filter );
+        void clear_filters();
+
+        /**
+         * @brief The verdict for the last message processed: DROP when it wrote no response, DIVERT when a filter
+         * diverted one of its BSMs, otherwise PASS.
+         */
+        BsmFilter::Verdict verdict() const;
+
+        /**
+         * @brief The MessageFrames of the last message that were dropped (filtered BSMs and unchanged SPaTs), and their
+         * bytes.
+         */
+        std::size_t dropped_frames() const;
+        std::size_t dropped_bytes() const;
+
+        /**
+         * @brief Choose what a successful decode writes.
+         *
+         * @param payload_only false (the default) to write the complete ODE document; true to write only the decoded
+         * MessageFrame (XER or JSON) and leave the envelope in response_metadata(). Errors and encodings are always
+         * complete documents.
+         */
+        void set_payload_only( bool payload_only );
+
+        /**
+         * @brief The envelope of the last response written by process() or process_bytes().
+         */
+        const ResponseMetadata& response_metadata() const;
+
+        /**
+         * @brief The messageId of the MessageFrame of the last response; -1 when the response has none or is an error.
+         */
+        int32_t message_id() const;
+
+        /**
+         * @brief The code of the last response when it is an error; SUCCESS when it is not.
+         */
+        Asn1ErrorType error_type() const;
+
+        /**
+         * @brief Take the key of each decoded response from the fields, MessageKey bits; 0 (the default) for no keys.
+         */
+        void set_message_key( uint32_t fields );
+
+        /**
+         * @brief The key of the last response: the chosen field of its first MessageFrame that has one; empty when it
+         * has none or is an error.
+         */
+        const std::string& message_key() const;
+
+        /**
+         * @brief Decode or encode a single ODE XML message and write the result to the output stream.
+         *
+         * Failures are NOT thrown; they are reported by writing the ODE error XML to the output stream.
+         *
+         * @param buffer the ODE XML message; it must remain valid until this method returns.
+         * @param length the number of bytes in the message.
+         * @param output_message_stream where the resulting XML is written.
+         * @return true if the message was successfully decoded/encoded; false if error XML was written.
+         */
+        bool process( const void* buffer, std::size_t length, std::ostream& output_message_stream );
+
+        /**
+         * @brief Decode a raw binary message, one with no ODE XML envelope, and write the result to the output stream.
+         *
+         * The response is an ODE document holding only the payload dataType and data. Failures are NOT thrown; they
+         * are reported by writing the ODE error XML to the output stream. Binary messages can only be decoded.
+         *
+         * @param bytes the UPER/COER encoding of the outermost element.
+         * @param length the number of bytes in the message.
+         * @param encodings the elementType:encodingRule pairs of the message, outermost first, separated by commas,
+         * e.g., Ieee1609Dot2Data:COER,MessageFrame:UPER
+         * @param encodings_length the number of characters in encodings.
+         * @param output_message_stream where the resulting XML is written.
+         * @param consumed when not null, the bytes may hold more than one PDU and this is assigned the bytes of the first
+         * one, which is the one decoded. It is 0 when the bytes hold only the beginning of a PDU; then nothing is written
+         * and the result is true. After an error it is length, since the next PDU cannot be found.
+         * @return true if the message was successfully decoded; false if error XML was written.
+         */
+        bool process_bytes( const void* bytes, std::size_t length, const char* encodings, std::size_t encodings_length, std::ostream& output_message_stream, std::size_t* consumed = nullptr );
+
+        /**
+         * @brief Decode the raw binary PDUs of a stream whose messages may hold many PDUs and may split a PDU, e.g., one
+         * Kafka partition of large blocks cut from a capture.
+         *
+         * The bytes are appended to the stream's carry-over buffer, every complete PDU in it is decoded as by
+         * process_bytes, and the beginning of a PDU left at the end is kept for the next call. respond is called after
+         * each response is written to output_message_stream, with the success of that PDU; it must take the response
+         * from the stream. A stream is only ever given to one context.
+         *
+         * @param stream the topic and partition, or any other name, of the stream.
+         * @return the number of responses written.
+         */
+        std::size_t process_stream( const std::string& stream, const void* bytes, std::size_t length, const char* encodings, std::size_t encodings_length,
+                std::ostream& output_message_stream, const std::function<void( bool )>& respond );
+
+        /**
+         * @brief The bytes kept for the next message of the stream.
+         */
+        std::size_t carried_bytes( const std::string& stream ) const;
+
+        /**
+         * @brief The current UTC time formatted for the ODE timestamps; only formatted when the second changes.
+         */
+        const std::string& get_current_time() const;
+
+    private:
+
+        static constexpr std::size_t max_errbuf_size = 128;             ///> The length of error buffers for ASN.1 compiler.
+        static constexpr std::size_t max_retained_output = 65536;       ///> Output buffers larger than this shrink when the estimate falls.
+        static constexpr std::size_t max_carried_pdu = 1 << 20;         ///> A stream PDU may not be split over more bytes than this.
+
+        // possible encoding configurations.
+        static constexpr uint32_t IEEE1609DOT2 = 1;
+        static constexpr uint32_t J2735MESSAGEFRAME = 2;
+        static constexpr uint32_t IEEE1609DOT2_J2735MESSAGEFRAME = 3;
+        static constexpr uint32_t ASDFRAME = 4;
+        static constexpr uint32_t ASDFRAME_IEEE1609DOT2 = 5;
+        static constexpr uint32_t ASDFRAME_J2735MESSAGEFRAME = 6;
+        static constexpr uint32_t ASDFRAME_IEEE1609DOT2_J2735MESSAGEFRAME = 7;
+
+        std::shared_ptr<spdlog::logger> ilogger;
+        std::shared_ptr<spdlog::logger> elogger;
+
+        // ODE XML input XPath queries and parse options.
+        pugi::xml_document input_doc;
+        pugi::xml_document internal_doc;
+        pugi::xml_document error_doc;                                   ///> A base XML document to use in responding to input XML parse errors.
+
+        unsigned int xml_parse_options;
+        pugi::xpath_query ode_payload_query;
+        pugi::xpath_query ode_encodings_query;
+
+        std::ostringstream erroross;
+		bool add_error_xml( pugi::xml_document& doc, Asn1DataType dt, Asn1ErrorType et, std::string message, bool update_time = false );
+
+        // the error template serialized once with its variable fields cut out.
+        enum class ErrorField { RECEIVED_AT, GENERATED_AT, DATA_TYPE, CODE, MESSAGE, COUNT };
+
+        struct ErrorSplice {
+            std::size_t offset;                                         ///> where the field is written in error_text_.
+            ErrorField field;
+        };
+
+        mutable CoarseClock clock_;                                     ///> the timestamps of the responses.
+
+        std::string error_text_;
+        std::vector<ErrorSplice> error_splices_;                        ///> in offset order; empty when the template cannot be spliced.
+
+        void render_error_template();
+
+        /**
+         * @brief Write the error response built from the error template: the pre-rendered text with the times, types,
+         * and message written between its pieces, or the template document in JSON and when it could not be rendered.
+         */
+        void save_error( Asn1DataType dt, Asn1ErrorType et, const std::string& message, std::ostream& output_message_stream );
+
+        std::vector<char> byte_buffer;                                 ///> storage for hex to byte and byte to hex encoder/decoder.
+
+        // ASN.1 Compiler
+        std::size_t errlen;
+        char errbuf[max_errbuf_size];
+
+        struct Validation {
+            const struct asn_TYPE_descriptor_s* type;
+            ValidationPolicy policy;
+            uint32_t credit;                                            ///> accumulates rate_ppm; a check is due at one million.
+        };
+
+        std::vector<Validation> validations_;
+        ValidationStats validation_stats_;
+
+        MessageBudget budget_;
+        BudgetStats budget_stats_;
+        asn_codec_ctx_t codec_ctx_;                                     ///> passed to the asn1c decoders; holds the stack limit.
+        std::chrono::steady_clock::time_point deadline_;                ///> the end of the current message's time; only set with max_ms.
+        bool over_budget_;                                              ///> the current message was counted; the DOM retry of a scan is not.
+
+        /**
+         * @brief Start the budget of a message of length bytes.
+         *
+         * @throws UnparseableInputError when the message is too large.
+         */
+        void start_budget( std::size_t length );
+
+        /**
+         * @brief Called when a decode fails or between layers.
+         *
+         * @throws Asn1CodecError when the message went over its memory or time.
+         */
+        void check_budget();
+
+        std::map<std::string, std::vector<uint8_t>> carry_;             ///> the beginning of the last PDU of each stream.
+
+        bool stage_timing_;
+        StageTimes stage_times_;
+
+        StageTimes* timing() { return stage_timing_ ? &stage_times_ : nullptr; }
+
+        /**
+         * @brief Check the structure according to the policy of its type; like asn_check_constraints, nonzero means the
+         * message must be rejected and errbuf holds the reason.
+         */
+        int check_constraints( const struct asn_TYPE_descriptor_s* type, const void* sptr );
+
+        /**
+         * @brief Count a validation of the type by its policy; false when the policy skips it.
+         */
+        bool validation_due( const struct asn_TYPE_descriptor_s* type, const ValidationPolicy** policy = nullptr );
+
+		// TODO: A byte flag word is needed here since we will set multiple decode / encoders.
+		uint32_t opsflag;
+        bool decode_1609dot2;
+        bool decode_messageframe;
+		bool decode_asdframe;
+        bool decode_functionality_;
+
+		// TODO: flagword is more challenging here...
+        enum asn_transfer_syntax decode_1609dot2_type;
+        enum asn_transfer_syntax decode_messageframe_type;
+        enum asn_transfer_syntax decode_asdframe_type;
+
+        pugi::xml_node payload_node_;
+
+        /**
+         * One layer of an encode: the element at path is XER decoded as type, encoded using the transfer syntax
+         * configured for op, and, when replace is true, removed so its encoding can be placed in the OCTET STRING of the
+         * enclosing layer's structure.
+         */
+        struct EncodeStep {
+            uint32_t op;
+            const struct asn_TYPE_descriptor_s* type;
+            std::vector<const char*> path;                              ///> path below OdeAsn1Data/payload/data; the last segment is the element name.
+            const char* path_name;                                      ///> the same path for error messages.
+            bool replace;
+        };
+
+        typedef std::vector<EncodeStep> EncodePlan;
+
+        std::vector<std::string> encoded_data_;                         ///> the encoding of each step of the current plan.
+        std::string encode_key_;                                        ///> the cache key of a layer that encloses another.
+        std::string encode_hex_;                                        ///> the hex or base64 of one encoding of the output.
+        std::vector<pugi::xml_node> encode_pdus_;                       ///> the PDU elements of the current encode request.
+        std::unique_ptr<ResultCache> encode_cache_;                     ///> the hex of recently encoded elements; null when not used.
+        std::unique_ptr<TimTemplates> tim_templates_;                   ///> the structures of recent TIMs; null when not used.
+
+        // the message being processed; only valid during process().
+        const char* input_buffer_;
+        std::size_t input_length_;
+        bool slice_input_;
+        bool dom_input_;
+        bool base64_output_;
+
+        /**
+         * @brief The precompiled plan for an opsflag value; empty when the combination is not supported.
+         */
+        static const EncodePlan& encode_plan( uint32_t ops );
+        enum asn_transfer_syntax transfer_syntax( uint32_t op ) const;
+
+        std::unique_ptr<Asn1Arena> arena_;                             ///> the asn1c allocations of one message; null when not used.
+        std::size_t arena_retain_;                                      ///> the bytes of arena chunks kept between messages; 0 for all.
+        std::unique_ptr<XmlPagePool> xml_pool_;                        ///> the pugixml allocations of the documents; null when not used.
+        std::vector<char> input_copy_;                                  ///> the XML input_doc is parsed in place from.
+
+        // asn1c output buffers; these persist across messages and are sized from the recent output of each PDU type.
+        buffer_structure_t xer_buffer_;                                 ///> XER output of the decoders.
+        buffer_structure_t encode_buffer_;                              ///> UPER/COER output of the encoder.
+        std::map<std::pair<const struct asn_TYPE_descriptor_s*, int>, std::size_t> output_estimates_;
+
+        void prepare_output_buffer( buffer_structure_t* buf, const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax );
+        void record_output_size( const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax, std::size_t size );
+
+        // decoded XER spliced into the output.
+        static constexpr const char* xer_placeholder = "acm-xer";      ///> The processing instruction replaced by the XER.
+        bool splice_output_;
+        bool compact_xer_;                                              ///> write the decoded MessageFrame as compact XER.
+        std::string envelope_;                                          ///> The ODE output around the placeholder; also the serialized element being encoded.
+
+        void save_with_xer( std::ostream& output_message_stream, const buffer_structure_t& xer );
+
+        // JSON responses.
+        bool json_output_;
+        rapidjson::StringBuffer json_buffer_;                           ///> JSON output of the MessageFrame decoder.
+        rapidjson::StringBuffer json_envelope_;                         ///> the converted response document.
+        asn1_json::Writer json_writer_;
+
+        std::unique_ptr<Asn1Projection> projection_;                    ///> the MessageFrame fields written; null for all.
+
+        /**
+         * @brief Write doc to the output in the configured format; in JSON, the element holding the placeholder is
+         * replaced by json.
+         */
+        void save_document( const pugi::xml_document& doc, std::ostream& output_message_stream, const rapidjson::StringBuffer* json = nullptr );
+
+        /**
+         * @brief Write the response to a binary message: the decoded MessageFrame in a payload-only ODE document.
+         */
+        void save_decoded( std::ostream& output_message_stream );
+
+        // payload only responses.
+        bool payload_only_;
+        ResponseMetadata metadata_;
+        int32_t message_id_;                                            ///> the messageId of the last MessageFrame decoded or encoded; -1 for none.
+        Asn1ErrorType error_type_;                                      ///> the code of the last error response; SUCCESS for none.
+
+        // response keys.
+        uint32_t key_fields_;                                           ///> MessageKey bits.
+        std::string message_key_;
+        std::string frame_key_;                                         ///> the key of the last MessageFrame decoded with asn1c.
+
+        /**
+         * @brief Set the response key from a MessageFrame's or a BSM temporary id's chosen field when it has none.
+         */
+        void key_frame( const MessageFrame_t& frame );
+        void key_bsm( const uint8_t* id );
+
+        // BSM fast path.
+        bool bsm_fast_path_;
+        bsm_fast_path::Bsm fast_bsm_;                                   ///> the last BSM decoded on the fast path.
+        std::string fast_xer_;                                          ///> its XER.
+        BsmArchive* archive_;                                           ///> the columnar side-output of the decoded BSMs; not owned.
+
+        // BSM filters.
+        std::vector<BsmFilter*> filters_;                               ///> not owned.
+        BsmFilter::Verdict verdict_;                                    ///> for the last message.
+        std::size_t dropped_frames_;
+        std::size_t dropped_bytes_;
+
+        BsmFilter::Verdict filter_bsm( std::size_t bytes );
+        void reset_verdict();
+
+        void save_payload( std::ostream& output_message_stream );
+        void set_response_metadata( const pugi::xml_document& doc );
+        void set_response_metadata( const OdeEnvelope& envelope );
+
+        enum asn_transfer_syntax get_ats_transfer_syntax( const char* ats_type );
+        bool set_codec_requirements( pugi::xml_document& doc );
+        bool set_codec_requirements( const char* encodings, std::size_t length );
+        void reset_codec_requirements();
+        void add_codec_requirement( const char* element_type, std::size_t length, enum asn_transfer_syntax atstype );
+
+        /**
+         * One PDU type the codec understands: the elementType name used in the encodings, its asn1c descriptor, the
+         * transfer syntax used until the encodings give one, and the members that hold the requirement. Adding a type
+         * is a new entry here; the requirements and the encode steps find it by table lookup.
+         *
+         * A container type also names the OCTET STRING of its decoded structure that holds the next layer, so a decode
+         * follows the containers of pdu_layers down to the MessageFrame.
+         */
+        struct PduType {
+            const char* name;
+            std::size_t length;
+            Asn1OpsType op;
+            const struct asn_TYPE_descriptor_s* type;
+            enum asn_transfer_syntax default_syntax;
+            bool CodecContext::* enabled;
+            enum asn_transfer_syntax CodecContext::* syntax;
+            const OCTET_STRING_t* (*inner)( const void* structure );  ///> the next layer; null for the MessageFrame.
+            const char* missing;                                        ///> the error when a structure has no next layer.
+            void (CodecContext::* visit)( const void* structure );      ///> called for each decoded structure; may be null.
+        };
+
+        static constexpr std::size_t pdu_type_count = 3;
+        static constexpr std::size_t pdu_slot_count = 8;                ///> the name length modulo this is a perfect hash.
+        static const PduType pdu_types[pdu_type_count];
+        static const PduType* const pdu_slots[pdu_slot_count];          ///> by name length modulo pdu_slot_count.
+        static const PduType* const pdu_ops[static_cast<uint32_t>(Asn1OpsType::ASDFRAME) + 1];  ///> by Asn1OpsType value.
+        static const PduType* const pdu_layers[pdu_type_count];        ///> the decode layers, outermost first.
+
+        /**
+         * @brief The registered type with the elementType name; nullptr when there is none.
+         */
+        static const PduType* find_pdu_type( const char* name, std::size_t length );
+
+        /**
+         * The resolved requirements of one encodings block. The ODE sends only a few distinct blocks, so the requirements
+         * are looked up by the block's text instead of being resolved for every message.
+         */
+        struct CodecRequirements {
+            std::string encodings;                                      ///> the text of the encodings element.
+            std::size_t hash;
+            uint32_t opsflag;
+            bool decode_1609dot2;
+            bool decode_messageframe;
+            bool decode_asdframe;
+            enum asn_transfer_syntax decode_1609dot2_type;
+            enum asn_transfer_syntax decode_messageframe_type;
+            enum asn_transfer_syntax decode_asdframe_type;
+        };
+
+        static constexpr std::size_t max_cached_requirements = 8;
+        std::vector<CodecRequirements> requirements_cache_;
+        std::size_t requirements_next_;                                 ///> the entry replaced when the cache is full.
+
+        bool apply_cached_requirements( const char* block, std::size_t length, std::size_t& hash );
+        void cache_requirements( const char* block, std::size_t length, std::size_t hash );
+
+        // decode requests handled without the DOM.
+        bool scan_envelope_;
+        OdeEnvelope envelope_scanner_;
+        std::string byte_hex_;                                          ///> the hex payload of a scanned envelope.
+
+        bool decode_envelope( const char* buffer, std::size_t length, std::ostream& output_message_stream );
+
+        // the PDUs of a payload that holds several.
+        bool concatenated_pdus_;
+
+        /**
+         * @brief Decode every PDU in bytes with the configured decoders, appending their output to xml_buffer (or the
+         * JSON array).
+         */
+        bool decode_pdus( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer );
+
+        // the output of recently decoded payloads.
+        std::unique_ptr<ResultCache> decode_cache_;                     ///> null when not used.
+
+        // the XER of recent MAP revisions.
+        std::unique_ptr<ResultCache> map_cache_;                        ///> null when not used.
+        std::string map_key_;
+        std::string map_xer_;
+
+        // the last state of each intersection of the SPaTs.
+        std::unique_ptr<SpatDelta> spat_delta_;                         ///> null when not used.
+        bool spat_reduced_;                                             ///> the message had a SPaT the delta reduced.
+
+        // the signatures of the signed frames of the response.
+        SignatureVerifier* verifier_;                                   ///> null when not used; not owned.
+        std::vector<SignatureVerifier::Ticket> signatures_;
+        buffer_structure_t signed_buffer_;                              ///> the COER encodings that are hashed.
+
+        /**
+         * @brief The certificate of signer from the verifier's cache; a new certificate is kept. Null, with failure the
+         * reason, when the signer cannot be verified.
+         */
+        UnvalidatedCertificateCache::Entry find_signer( const SignerIdentifier_t& signer, SignatureVerifier::Status& failure );
+
+        // the 1609.2 frames decoded only as far as their header.
+        LazyDecode lazy_decode_;
+        std::string lazy_hex_;                                          ///> the hex of one field of a lazy frame's header.
+        std::string lazy_xml_;                                          ///> the XML of a lazy frame's header.
+
+        /**
+         * @brief Write the header of a lazy frame and its unsecuredData to xml_buffer (or the JSON); false, with nothing
+         * written, when the frame is decoded in full.
+         */
+        bool decode_lazy( const Ieee1609Dot2Data_t& data, const OCTET_STRING_t& unsecured, buffer_structure_t* xml_buffer, bool append );
+
+        /**
+         * @brief Submit the signature of signed_data to the verifier, or resolve why it is not verified.
+         */
+        void verify_signature( const SignedData_t& signed_data );
+
+        /**
+         * @brief SHA-256 of the COER encoding of a structure of type; false when it does not encode.
+         */
+        bool hash_coer( const asn_TYPE_descriptor_t& type, const void* structure, uint8_t hash[32] );
+
+        /**
+         * @brief Write the cached XER of the MAP at bytes to xml_buffer; false when it is not a MAP or not cached, and
+         * then header is valid when is_map is true.
+         */
+        bool decode_map_cached( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append, map_frame::Header& header, bool& is_map );
+
+        /**
+         * @brief The requirements and settings the decoded output of a payload depends on.
+         */
+        uint64_t decode_signature() const;
+
+        /**
+         * @brief Decode the bytes of a request payload with the configured decoders, from the decode cache when they
+         * were decoded before.
+         */
+        bool decode_payload( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer );
+
+        /**
+         * @brief Whether the encodings request a decoder this module has.
+         */
+        bool decoding() const;
+
+        bool decode_message( pugi::xml_node& payload_node, std::ostream& output_message_stream );
+        bool decode_hex_data( std::string& data_as_hex, buffer_structure_t* xml_buffer, bool base64 = false );
+
+        /**
+         * @brief Decode bytes as the outermost requested layer of pdu_layers at or after layer, and the OCTET STRING
+         * that holds the next requested layer from its C structure, down to the MessageFrame whose output is written
+         * to xml_buffer. Each layer is decoded once; nothing is written when xml_buffer is nullptr.
+         */
+        bool decode_layers( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed = nullptr, bool append = false, std::size_t layer = 0 );
+
+        /**
+         * @brief The index of the first requested layer of pdu_layers at or after layer; pdu_type_count when none is.
+         */
+        std::size_t next_layer( std::size_t layer ) const;
+
+        void visit_1609dot2( const void* structure );
+        bool decode_messageframe_bytes( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed = nullptr, bool append = false );
+
+        /**
+         * @brief Decode a BSM MessageFrame with bsm_fast_path; false, with nothing written, when asn1c must decode it.
+         */
+        bool decode_bsm_fast( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append );
+
+        bool encode_message( std::ostream& output_message_stream );
+
+        /**
+         * @brief Encode the XER data_as_xml of step into bytes; inner, when not null, is the encoding of the layer it
+         * encloses and is placed in the OCTET STRING that holds it. filled, when not null, is step's structure already
+         * filled from the document; it is encoded and freed in place of decoding data_as_xml, and is not cached. A
+         * filled structure that is not owned belongs to the TIM templates and is not freed.
+         */
+        void encode_frame_data(const EncodeStep& step, const char* data_as_xml, std::size_t length, const std::string* inner, std::string& bytes, void* filled = nullptr, bool owned = true);
+        void encode_node(const EncodeStep& step, pugi::xml_node pdu, bool pristine, const std::string* inner, std::string& bytes);
+        bool input_slice(const pugi::xml_node& node, const char*& xml, std::size_t& length) const;
+        void encode_for_protocol(const EncodePlan& plan, pugi::xml_node pdu);
+};
+
+#endif
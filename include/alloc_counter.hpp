@@ -0,0 +1,82 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_ALLOC_COUNTER_HPP
+#define ACM_ALLOC_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The heap allocations of the calling thread, counted in a build with -DACM_ALLOC_COUNTING (cmake
+ * -DACM_ALLOC_COUNTING=ON), which replaces malloc, calloc, realloc, free, and the aligned allocators with versions that
+ * count before calling the C library; operator new allocates through malloc, so it is counted too. The asn1c
+ * allocation hooks (acm_asn_alloc.h) are counted separately because the arena serves them without the heap.
+ *
+ * The counts are per thread, so a counter only sees the allocations of the thread that made it. In other builds every
+ * count is 0 and the counters cost nothing; the ACM is not meant to run with them in production.
+ */
+class AllocCounter {
+
+    public:
+
+        struct Counts {
+            uint64_t allocations;                                       ///> heap allocations, including reallocations.
+            uint64_t bytes;                                             ///> the bytes requested by those allocations.
+            uint64_t frees;
+            uint64_t asn1_allocations;                                  ///> calls of the asn1c allocation hooks, from the arena or the heap.
+            uint64_t asn1_bytes;
+        };
+
+        /**
+         * @brief True when the allocations are counted (the build defines ACM_ALLOC_COUNTING).
+         */
+        static bool enabled();
+
+        /**
+         * @brief The counts of the calling thread since it started.
+         */
+        static Counts thread_counts();
+
+        /**
+         * @brief Count a call of an asn1c allocation hook of size bytes.
+         */
+        static void count_asn1( std::size_t size );
+
+        /**
+         * @brief Start counting the allocations of the calling thread.
+         */
+        AllocCounter();
+
+        /**
+         * @brief The allocations of the calling thread since construction or the last restart.
+         */
+        Counts counts() const;
+
+        void restart();
+
+    private:
+
+        Counts start_;
+};
+
+#endif
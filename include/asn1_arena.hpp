@@ -0,0 +1,169 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_ASN1_ARENA_HPP
+#define ACM_ASN1_ARENA_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A bump allocator for the structures the asn1c runtime builds while one message is decoded or encoded.
+ *
+ * When the asn1c library is generated with ACM_ASN1_ARENA=1 (see asn1c_combined/doIt.sh) its CALLOC, MALLOC,
+ * REALLOC, and FREEMEM macros call the acm_asn_* functions below. While an Asn1Arena::Scope is active on a thread
+ * those functions allocate from that thread's arena and FREEMEM of arena memory does nothing; the whole message is
+ * released in O(1) when the scope ends. With no active scope they call the C library allocator.
+ *
+ * Each worker thread owns its own arena, so there is no allocator lock contention between workers. The arena keeps its
+ * chunks between messages; chunks are backed by huge pages when the platform provides them.
+ */
+class Asn1Arena {
+
+    public:
+
+        /**
+         * @brief Make an arena active on the calling thread; the arena is reset when the scope ends.
+         *
+         * Nothing allocated from the arena may be used after the scope ends. A null arena makes the scope do nothing.
+         */
+        class Scope {
+
+            public:
+
+                explicit Scope( Asn1Arena* arena );
+                ~Scope();
+
+                Scope( const Scope& ) = delete;
+                Scope& operator=( const Scope& ) = delete;
+
+            private:
+
+                Asn1Arena* arena_;
+                Asn1Arena* previous_;
+        };
+
+        /**
+         * @brief Make the C library allocator active on the calling thread while it exists, for structures that are
+         * kept after the message; the active arena, if any, is restored unchanged.
+         */
+        class Suspend {
+
+            public:
+
+                Suspend();
+                ~Suspend();
+
+                Suspend( const Suspend& ) = delete;
+                Suspend& operator=( const Suspend& ) = delete;
+
+            private:
+
+                Asn1Arena* previous_;
+        };
+
+        /**
+         * @brief Construct an arena whose chunks hold at least chunk_size bytes; chunks are allocated when needed.
+         */
+        explicit Asn1Arena( std::size_t chunk_size = 1 << 20 );
+        ~Asn1Arena();
+
+        Asn1Arena( const Asn1Arena& ) = delete;
+        Asn1Arena& operator=( const Asn1Arena& ) = delete;
+
+        void* allocate( std::size_t size );
+        void* reallocate( void* ptr, std::size_t size );
+
+        /**
+         * @brief Predicate indicating whether ptr refers to memory in this arena.
+         */
+        bool owns( const void* ptr ) const;
+
+        /**
+         * @brief Release every allocation; the chunks are kept for the next message. The limits stay set.
+         */
+        void reset();
+
+        enum class Exceeded { NONE, MEMORY, TIME };
+
+        /**
+         * @brief Fail the allocations of a message past max_bytes (0 for no limit) or, checked every few allocations,
+         * past the deadline, so the asn1c runtime gives up on a pathological PDU; the deadline is cleared by reset().
+         */
+        void set_limit( std::size_t max_bytes );
+        void set_deadline( std::chrono::steady_clock::time_point deadline );
+
+        /**
+         * @brief The limit that failed an allocation since the last reset; NONE when none did.
+         */
+        Exceeded exceeded() const;
+
+        /**
+         * @brief Release the chunks over max_bytes at each reset, newest first, so one large message does not keep its
+         * memory; the first chunk is always kept. 0 keeps every chunk.
+         */
+        void set_retain( std::size_t max_bytes );
+
+        std::size_t bytes_allocated() const;            ///> bytes handed out since the last reset.
+        std::size_t bytes_reserved() const;             ///> bytes held in chunks.
+        std::size_t huge_page_chunks() const;           ///> the number of chunks backed by huge pages.
+
+        /**
+         * @brief The arena that is active on the calling thread or nullptr.
+         */
+        static Asn1Arena* current();
+
+    private:
+
+        struct Chunk {
+            char* base;
+            std::size_t size;
+            bool mapped;                                ///> true when obtained from mmap, false from malloc.
+            bool huge;                                  ///> true when backed by huge pages.
+        };
+
+        std::size_t chunk_size_;
+        std::vector<Chunk> chunks_;
+        std::size_t curr_;                              ///> index of the chunk being filled.
+        std::size_t offset_;                            ///> next free byte in the current chunk.
+        std::size_t allocated_;
+        std::size_t limit_;                             ///> the bytes a message may allocate; 0 for no limit.
+        bool timed_;                                    ///> the deadline is checked.
+        std::chrono::steady_clock::time_point deadline_;
+        unsigned calls_;                                ///> the allocations since the deadline was last checked.
+        Exceeded exceeded_;
+        std::size_t retain_;                            ///> the bytes of chunks kept between messages; 0 for all.
+
+        bool add_chunk( std::size_t minimum );
+        static void release( Chunk& chunk );
+};
+
+extern "C" {
+
+    // The allocation functions used by the asn1c runtime when it is generated with ACM_ASN1_ARENA=1.
+    void* acm_asn_calloc( std::size_t nmemb, std::size_t size );
+    void* acm_asn_malloc( std::size_t size );
+    void* acm_asn_realloc( void* ptr, std::size_t size );
+    void acm_asn_free( void* ptr );
+}
+
+#endif
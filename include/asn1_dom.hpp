@@ -0,0 +1,54 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_ASN1_DOM_HPP
+#define ACM_ASN1_DOM_HPP
+
+#include "asn_application.h"
+#include "pugixml.hpp"
+
+/**
+ * Fill asn1c structures from parsed XER.
+ *
+ * The encoder's input is already a pugixml document; instead of serializing an element and tokenizing it again with
+ * xer_decode, the structure is built by walking the element's nodes through the asn1c type descriptors' member tables.
+ * SEQUENCE, CHOICE, open types, SEQUENCE OF and SET OF, INTEGER, ENUMERATED, BOOLEAN, NULL, OCTET STRING, BIT STRING,
+ * and the character string types are filled directly; that covers MessageFrame, Ieee1609Dot2Data, and
+ * AdvisorySituationData. Any element the walk does not handle (an unknown or misplaced child, an attribute, a value
+ * that is not in its usual XER form) is printed and given to its type's asn1c XER decoder, so an element is accepted
+ * exactly when xer_decode accepts it. Text values are those of the document; the ACM parses with whitespace trimming.
+ */
+namespace asn1_dom {
+
+    /**
+     * @brief Fill the structure of type td from node, the element in td's XML tag.
+     *
+     * The structure is allocated with the asn1c runtime's allocator when *sptr is null, as xer_decode does.
+     *
+     * @return true on success; false when the element is not a valid td. On failure the structure is freed and *sptr
+     * is null.
+     */
+    bool fill( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void** sptr, const asn_codec_ctx_t* ctx );
+}
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_ASN1_JSON_HPP
+#define ACM_ASN1_JSON_HPP
+
+#include "asn_application.h"
+#include "pugixml.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <cstddef>
+
+/**
+ * JSON output for the ACM: decoded ASN.1 structures and the ODE envelope.
+ *
+ * The ASN.1 structures are written directly from the asn1c type descriptors' member tables; the layout follows the
+ * XER the ACM otherwise produces: a SEQUENCE is an object keyed by member name with absent OPTIONAL members left out,
+ * a CHOICE (and an open type) is an object with the single present alternative, a SEQUENCE OF is an array, an
+ * ENUMERATED is its identifier, an OCTET STRING is upper case hex, and a BIT STRING is a string of 0 and 1.
+ */
+namespace asn1_json {
+
+    typedef rapidjson::Writer<rapidjson::StringBuffer> Writer;
+
+    /**
+     * @brief Write the structure as an object with one member named by the type's XML tag, e.g., {"MessageFrame":{...}}.
+     */
+    void write( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& writer );
+
+    /**
+     * @brief Write the structure's value without the object around it, e.g., {...} instead of {"MessageFrame":{...}}.
+     */
+    void write_content( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& writer );
+
+    /**
+     * @brief Write an XML element as a JSON value.
+     *
+     * An element with child elements is an object whose repeated children become arrays; any other element is its text.
+     * An element holding the processing instruction named raw_pi is replaced by raw, which must be a JSON value.
+     */
+    void write_xml( const pugi::xml_node& node, Writer& writer, const char* raw_pi = nullptr, const char* raw = nullptr, std::size_t raw_length = 0 );
+}
+
+#endif
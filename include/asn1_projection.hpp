@@ -0,0 +1,90 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_ASN1_PROJECTION_HPP
+#define ACM_ASN1_PROJECTION_HPP
+
+#include "asn_application.h"
+#include "asn1_json.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * A projection writes only the selected fields of a decoded ASN.1 structure, as compact XER or as JSON.
+ *
+ * The fields are given as paths below the structure's element that follow the names of its XER, e.g., for a
+ * MessageFrame, value/BasicSafetyMessage/coreData/lat. A path may go through a CHOICE (or open type) alternative and
+ * through the items of a SEQUENCE OF (by the item element name, e.g., crumbData/PathHistoryPoint/latOffset). The field
+ * at the end of a path is written completely. Fields are written in the type's member order; fields that are absent
+ * (OPTIONAL members, CHOICE alternatives that are not present) are left out, so a path naming another message type
+ * costs nothing.
+ *
+ * The structure is walked directly; the output needs no further parsing or filtering.
+ */
+class Asn1Projection {
+
+    public:
+
+        /**
+         * @brief Construct a projection of the comma separated paths; segments are separated by /.
+         *
+         * @throws std::invalid_argument when there is no path or a path has an empty segment.
+         */
+        explicit Asn1Projection( const std::string& paths );
+
+        std::size_t size() const;                                       ///> the number of paths.
+
+        /**
+         * @brief Write the projection of the structure as an object with one member named by the type's XML tag, like
+         * asn1_json::write.
+         */
+        void write_json( const asn_TYPE_descriptor_t* td, const void* sptr, asn1_json::Writer& writer ) const;
+
+        /**
+         * @brief Write the projection of the structure as canonical XER in the type's XML tag.
+         *
+         * @return the number of bytes written, or -1 when the callback or an asn1c XER encoder fails.
+         */
+        ssize_t write_xer( const asn_TYPE_descriptor_t* td, const void* sptr, asn_app_consume_bytes_f* cb, void* key ) const;
+
+    private:
+
+        struct Node {
+            std::string name;
+            std::vector<Node> children;
+            bool whole;                                                 ///> the field is written completely; there are no children.
+        };
+
+        Node root_;
+        std::size_t size_;
+
+        struct Sink;
+
+        void write_json( const Node& node, const asn_TYPE_descriptor_t* td, const void* sptr, asn1_json::Writer& writer ) const;
+        bool write_xer( const Node& node, const asn_TYPE_descriptor_t* td, const void* sptr, Sink& sink ) const;
+
+        static const Node* find( const Node& node, const char* name );
+};
+
+#endif
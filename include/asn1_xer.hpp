@@ -0,0 +1,51 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_ASN1_XER_HPP
+#define ACM_ASN1_XER_HPP
+
+#include "asn_application.h"
+
+#include <sys/types.h>
+
+/**
+ * Compact XER for the ACM's decoded output.
+ *
+ * The XER is the canonical XER asn1c writes, with a smaller tag set: an ENUMERATED or BOOLEAN value is the text of its
+ * element instead of an empty element inside it, e.g., <transmission>neutral</transmission> for
+ * <transmission><neutral/></transmission>, and an element without content is written as an empty element tag, e.g.,
+ * <x/> for <x></x>. A SEQUENCE OF whose items have no element of their own (a list of ENUMERATED or BOOLEAN values) is
+ * written as in canonical XER. The structure is walked directly from the asn1c type descriptors' member tables; the
+ * other values are written by their asn1c XER encoders.
+ */
+namespace asn1_xer {
+
+    /**
+     * @brief Write the structure as compact XER in the type's XML tag.
+     *
+     * @return the number of bytes written, or -1 when the callback or an asn1c XER encoder fails, or a value has no
+     * XER, e.g., a CHOICE with no alternative present or an ENUMERATED value that is not named.
+     */
+    ssize_t write_compact( const asn_TYPE_descriptor_t* td, const void* sptr, asn_app_consume_bytes_f* cb, void* key );
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BASE64_CODEC_HPP
+#define ACM_BASE64_CODEC_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Conversion between raw bytes and the base64 (RFC 4648, standard alphabet) strings a payload may be carried as in the
+ * ODE XML.
+ * The conversions process 24 bytes into 32 characters (AVX2) or 12 bytes into 16 characters (SSSE3) at a time when the
+ * compiler targets those instruction sets; the translation between 6 bit values and characters is done with byte
+ * shuffles instead of a table. The remainder, padding, and every other platform use a table-driven scalar loop.
+ */
+namespace base64_codec {
+
+    static constexpr std::size_t npos = static_cast<std::size_t>( -1 );
+
+    /**
+     * @brief The name of the implementation selected at compile time: "avx2", "ssse3", or "scalar".
+     */
+    const char* implementation();
+
+    /**
+     * @brief The number of characters, including the padding, in the encoding of length bytes.
+     */
+    inline std::size_t encoded_length( std::size_t length ) { return 4 * ( ( length + 2 ) / 3 ); }
+
+    /**
+     * @brief The largest number of bytes that length characters can decode into.
+     */
+    inline std::size_t decoded_length( std::size_t length ) { return 3 * ( ( length + 3 ) / 4 ); }
+
+    /**
+     * @brief Write encoded_length( length ) padded base64 characters for the bytes to out; out is NOT null terminated.
+     */
+    void encode( const void* bytes, std::size_t length, char* out );
+
+    /**
+     * @brief Replace the contents of text with the padded base64 representation of the bytes.
+     */
+    void encode( const void* bytes, std::size_t length, std::string& text );
+
+    /**
+     * @brief Convert length base64 characters into at most decoded_length( length ) bytes written to out.
+     *
+     * The padding is optional, but when present it must end the text. A final group of a single character cannot be a
+     * byte; its offset is returned.
+     *
+     * @param written set to the number of bytes written to out.
+     * @return npos on success; otherwise the offset of the first character that is not part of a valid encoding.
+     */
+    std::size_t decode( const char* text, std::size_t length, void* out, std::size_t& written );
+
+    /**
+     * @brief Replace the contents of bytes with the bytes represented by text.
+     *
+     * @return npos on success; otherwise the offset of the first character that is not part of a valid encoding.
+     */
+    std::size_t decode( const std::string& text, std::vector<char>& bytes );
+}
+
+#endif
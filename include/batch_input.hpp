@@ -0,0 +1,104 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_BATCH_INPUT_HPP
+#define ACM_BATCH_INPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The messages of a replay file read in batch mode: a file is memory mapped, stdin is read into memory. The file holds
+ * either newline delimited messages (ODE XML) or frames that start with a 4 byte big-endian length (raw UPER/COER or
+ * XML). A timed frame, as the ACM captures consumed messages (acm.capture.file), starts with the message's 8 byte
+ * big-endian timestamp in milliseconds since the epoch and its 4 byte big-endian partition before the length. The
+ * records refer to the input memory, so they are valid until the input is closed.
+ */
+class BatchInput {
+
+    public:
+
+        enum class Framing { LINES, LENGTH, TIMED };
+
+        struct Record {
+            const uint8_t* data;
+            std::size_t length;
+            int64_t timestamp;                  ///> milliseconds since the epoch of a timed frame; 0 otherwise.
+            int32_t partition;                  ///> the partition of a timed frame; -1 otherwise.
+        };
+
+        /**
+         * @brief Interpret the name of a framing: lines, length, or timed.
+         *
+         * @throws std::invalid_argument for any other name.
+         */
+        static Framing parse_framing( const std::string& name );
+
+        /**
+         * @brief Append the timed frame of a message to out.
+         */
+        static void append_timed( std::string& out, int64_t timestamp, int32_t partition, const void* data, std::size_t length );
+
+        explicit BatchInput( Framing framing = Framing::LINES );
+        ~BatchInput();
+
+        BatchInput( const BatchInput& ) = delete;
+        BatchInput& operator=( const BatchInput& ) = delete;
+
+        /**
+         * @brief Map the file at path, or read stdin when path is "-".
+         *
+         * @return false when the input cannot be read; errno holds the reason.
+         */
+        bool open( const std::string& path );
+
+        /**
+         * @brief Use length bytes at data, which must outlive the input, instead of a file.
+         */
+        void assign( const uint8_t* data, std::size_t length );
+
+        void close();
+
+        /**
+         * @brief The next record; empty lines are skipped and a line's trailing carriage return is removed.
+         *
+         * @return false at the end of the input or when a length prefix runs past it (see truncated).
+         */
+        bool next( Record& record );
+
+        bool truncated() const;                 ///> true when the last frame is shorter than its length.
+        std::size_t size() const;               ///> the bytes of input.
+        std::size_t position() const;           ///> the bytes of input consumed by next.
+
+    private:
+
+        Framing framing_;
+        const uint8_t* data_;
+        std::size_t size_;
+        std::size_t pos_;
+        bool mapped_;
+        bool truncated_;
+        std::vector<uint8_t> buffer_;           ///> stdin, which cannot be mapped.
+};
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BATCH_TUNER_HPP
+#define ACM_BATCH_TUNER_HPP
+
+#include "latency_histogram.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Adjusts the consume batch size and batch timeout to keep the 99th percentile of the ACM's message latency, from
+ * consumption to the hand off of the response to librdkafka, under a target while batching as much as that allows.
+ *
+ * The latencies are recorded by the threads that finish the messages; the consumer thread reports each batch and
+ * calls adjust() once per control interval. The changes are additive increase and multiplicative decrease:
+ *
+ * - Over the target, the batch timeout is halved, which removes the fill wait at low rates. When the workers have less
+ *   than a batch each waiting the batch is the delay, so its size is halved too; a deep backlog means the codec is
+ *   behind and smaller batches would not help.
+ * - Under three quarters of the target, while most batches were filled, the batch size grows by a quarter; the
+ *   timeout grows by a quarter, up to half of the target, so the fill wait alone never uses the latency budget.
+ *
+ * At 50 messages a second the batches are never filled, so they do not grow and only a timeout that breaks the target
+ * is cut; at 50,000 they grow until the latency or the maximum stops them. Nothing changes in an interval without
+ * messages.
+ */
+class BatchTuner {
+
+    public:
+
+        struct Settings {
+            std::size_t batch_size;
+            int batch_timeout;                                  ///> milliseconds.
+        };
+
+        /**
+         * @param target_p99 the 99th percentile latency to stay under, in nanoseconds.
+         * @param max the largest batch size and timeout used.
+         */
+        BatchTuner( uint64_t target_p99, const Settings& max );
+
+        BatchTuner( const BatchTuner& ) = delete;
+        BatchTuner& operator=( const BatchTuner& ) = delete;
+
+        /**
+         * @brief Record the latency of one message; any thread.
+         */
+        void record( uint64_t ns );
+
+        /**
+         * @brief Report a consumed batch; full when it reached the batch size, backlog the messages waiting for the
+         * workers, per worker; the consumer thread.
+         */
+        void consumed( bool full, std::size_t backlog );
+
+        /**
+         * @brief Apply the control law to settings with what was recorded since the last call; the consumer thread.
+         *
+         * @return true when settings changed.
+         */
+        bool adjust( Settings& settings );
+
+        uint64_t last_p99() const;                              ///> the 99th percentile of the last adjusted interval.
+        uint64_t target_p99() const;
+
+    private:
+
+        uint64_t target_;
+        Settings max_;
+        LatencyHistogram latencies_;
+        LatencyHistogram::Snapshot snapshot_;
+        std::size_t batches_;
+        std::size_t full_batches_;
+        std::size_t backlog_;                                   ///> the sum over the batches of the interval.
+        uint64_t last_p99_;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BSM_ARCHIVE_HPP
+#define ACM_BSM_ARCHIVE_HPP
+
+#include "bsm_fast_path.hpp"
+#include "MessageFrame.h"
+#include "spdlog/spdlog.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * A columnar side-output of the BSMs one worker decodes: the BSMcoreData of every BSM, with the time it was decoded,
+ * is appended to an Arrow record batch that is written as a row group of a rolling Parquet file.
+ *
+ * A file is written under a hidden name and renamed, e.g., bsm-0-20171011T212140Z-1.parquet, when it is closed: when
+ * it reaches max_bytes, is max_seconds old (checked as BSMs are appended), or the archive is destroyed. The location is
+ * a local directory or any URI of an Arrow file system, e.g., s3://bucket/bsm. An archive is used by one thread.
+ *
+ * Parquet support is optional; without it (the ACM_PARQUET build option) available() is false and the constructor
+ * throws.
+ */
+class BsmArchive {
+
+    public:
+
+        struct Settings {
+            std::string uri;                                            ///> the directory or file system URI of the files.
+            std::size_t max_bytes = 128 << 20;                          ///> a file is closed when it has this many bytes.
+            int max_seconds = 300;                                      ///> a file is closed when it is this old.
+            std::size_t row_group = 65536;                              ///> the rows of each record batch and row group.
+            std::string compression = "zstd";                           ///> zstd, snappy, gzip, or none.
+        };
+
+        /**
+         * @brief Construct the archive of one worker; its files begin with bsm-name-. No file is opened until a BSM is
+         * appended.
+         *
+         * @throws std::runtime_error when the ACM is built without Parquet support or the location cannot be used.
+         */
+        BsmArchive( const Settings& settings, const std::string& name, std::shared_ptr<spdlog::logger> elogger );
+        ~BsmArchive();
+
+        BsmArchive( const BsmArchive& ) = delete;
+        BsmArchive& operator=( const BsmArchive& ) = delete;
+
+        /**
+         * @brief Append the BSMcoreData of bsm; its Part II is not archived. Failures to write are logged and the rows
+         * of the failed batch are dropped; they are never thrown.
+         */
+        void append( const bsm_fast_path::Bsm& bsm );
+
+        /**
+         * @brief Write the buffered rows and close the current file.
+         */
+        void close();
+
+        uint64_t rows() const;                                          ///> rows appended.
+        uint64_t files() const;                                         ///> files closed.
+        uint64_t failures() const;                                      ///> writes that failed; their rows are dropped.
+
+        /**
+         * @brief Copy the BSMcoreData of a decoded MessageFrame into the core fields of bsm.
+         *
+         * @return false when the frame does not hold a BasicSafetyMessage.
+         */
+        static bool core_data( const MessageFrame_t* frame, bsm_fast_path::Bsm& bsm );
+
+        /**
+         * @brief Predicate indicating whether the ACM is built with Parquet support.
+         */
+        static bool available();
+
+    private:
+
+        struct Writer;                                                  ///> the Arrow builders and the open file.
+
+        Settings settings_;
+        std::string name_;
+        std::shared_ptr<spdlog::logger> elogger_;
+        std::unique_ptr<Writer> writer_;
+        uint64_t rows_;
+        uint64_t files_;
+        uint64_t failures_;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_BSM_COLUMNS_HPP
+#define ACM_BSM_COLUMNS_HPP
+
+#include "bsm_fast_path.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * The BSMcoreData of a batch of BSMs as columns: the id, secMark, lat, long, elev, speed, heading, and longitudinal
+ * acceleration of row i are element i of eight arrays, for analytics that run one loop over a field of a whole batch
+ * instead of walking a MessageFrame_t per message.
+ *
+ * Each payload is a UPER MessageFrame. It is read by the BSM fast path, or by asn1c when the fast path does not handle
+ * it; a payload that is not a BasicSafetyMessage has no row, and the input column gives the payload of each row. Every
+ * column starts on an alignment boundary and has room for capacity() rows, so a vector loop needs no peeled prologue. A
+ * batch is used by one thread.
+ */
+class BsmColumns {
+
+    public:
+
+        static constexpr std::size_t alignment = 64;                    ///> the boundary each column starts on.
+
+        explicit BsmColumns( std::size_t capacity = 0 );
+
+        BsmColumns( const BsmColumns& ) = delete;
+        BsmColumns& operator=( const BsmColumns& ) = delete;
+
+        /**
+         * @brief Replace the rows with those of count payloads; payload i is lengths[i] bytes at payloads[i].
+         *
+         * @return the rows decoded.
+         */
+        std::size_t decode( const void* const* payloads, const std::size_t* lengths, std::size_t count );
+
+        /**
+         * @brief Append the row of bsm, decoded from the payload numbered input.
+         */
+        void append( const bsm_fast_path::Bsm& bsm, uint32_t input );
+
+        /**
+         * @brief Make room for capacity rows; the rows are kept.
+         */
+        void reserve( std::size_t capacity );
+
+        void clear();
+
+        std::size_t size() const;
+        std::size_t capacity() const;
+
+        const uint32_t* input() const;                                  ///> the payload of each row.
+        const uint32_t* id() const;                                     ///> the TemporaryID, its first byte highest.
+        const uint16_t* sec_mark() const;
+        const int32_t* lat() const;
+        const int32_t* lon() const;
+        const int32_t* elev() const;
+        const uint16_t* speed() const;
+        const uint16_t* heading() const;
+        const int16_t* accel() const;                                   ///> the longitudinal acceleration.
+
+        /**
+         * @brief Decode the BSMcoreData of a UPER MessageFrame into the core fields of bsm, with the fast path or asn1c.
+         *
+         * @return false when the bytes are not a BasicSafetyMessage.
+         */
+        static bool decode_core( const void* bytes, std::size_t length, bsm_fast_path::Bsm& bsm );
+
+        /**
+         * @brief The TemporaryID of bsm as a number, its first byte highest.
+         */
+        static uint32_t id_value( const bsm_fast_path::Bsm& bsm );
+
+    private:
+
+        std::size_t size_;
+        std::size_t capacity_;
+        std::unique_ptr<unsigned char[]> block_;                        ///> every column, with room to align the first.
+
+        uint32_t* input_;
+        uint32_t* id_;
+        uint16_t* sec_mark_;
+        int32_t* lat_;
+        int32_t* lon_;
+        int32_t* elev_;
+        uint16_t* speed_;
+        uint16_t* heading_;
+        int16_t* accel_;
+
+        bsm_fast_path::Bsm bsm_;                                        ///> the BSM being decoded.
+};
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BSM_DEDUPLICATOR_HPP
+#define ACM_BSM_DEDUPLICATOR_HPP
+
+#include "bsm_filter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Drops a BSM when one with the same temporary id, msgCnt, and secMark passed within the window, e.g., the copies of
+ * one BSM heard by several RSUs, whose envelopes and bytes differ.
+ *
+ * The keys are kept in a ring of time buckets, each a fixed-size open addressing set of the keys of one fifth of the
+ * window that is cleared when its time comes around again, so the memory is fixed and old keys cost nothing to forget.
+ * A key is remembered for at least the window and at most a fifth longer. The id, msgCnt, and secMark fit in the 64
+ * bit key, so a BSM is never taken for another. The sets are split into shards with a lock each, so one deduplicator
+ * serves every context. When the slots a key may use in a full bucket are taken, the key replaces one of them.
+ */
+class BsmDeduplicator : public BsmFilter {
+
+    public:
+
+        /**
+         * @brief Remember the BSMs of window_ms; capacity is the number of keys of all the buckets, rounded up to a
+         * power of 2 per bucket of a shard.
+         */
+        explicit BsmDeduplicator( uint32_t window_ms, std::size_t capacity = 262144 );
+
+        /**
+         * @brief The verdict with the steady clock's time.
+         */
+        Verdict test( const bsm_fast_path::Bsm& bsm ) override;
+
+        /**
+         * @brief The verdict for a BSM at now_ms; the times given must not go back.
+         */
+        Verdict test( uint32_t id, uint8_t msg_cnt, uint16_t sec_mark, uint64_t now_ms );
+
+        std::size_t capacity() const;
+
+    private:
+
+        static constexpr std::size_t shard_count = 16;
+        static constexpr std::size_t bucket_count = 6;                  ///> the window is bucket_count - 1 slices.
+        static constexpr std::size_t max_probes = 8;
+
+        struct Shard {
+            std::mutex mutex;
+            uint64_t slices[ bucket_count ];                            ///> the slice of time each bucket holds.
+            std::vector<uint64_t> keys;                                 ///> the buckets one after another; 0 for a free slot.
+        };
+
+        uint64_t slice_;                                                ///> the milliseconds of one bucket.
+        std::size_t mask_;                                              ///> the slots of a bucket, less 1.
+        std::unique_ptr<Shard[]> shards_;
+};
+
+#endif
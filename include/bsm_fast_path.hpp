@@ -0,0 +1,116 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BSM_FAST_PATH_HPP
+#define ACM_BSM_FAST_PATH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A UPER decoder specialized for the MessageFrame of a BasicSafetyMessage, which is most of the ACM's traffic.
+ *
+ * It reads the BSMcoreData, and the events, path history, path prediction, and lights of the VehicleSafetyExtensions,
+ * straight into a fixed-size structure and writes the same canonical XER as asn1c's uper_decode and xer_encode, without
+ * walking the type descriptors or allocating. Anything else (an extension, regional content, other Part II content,
+ * a value outside its constraint, or missing bytes) is not decoded; the caller then uses the generic asn1c decoder,
+ * which gives its usual output or error.
+ */
+namespace bsm_fast_path {
+
+    struct PositionalAccuracy {
+        uint8_t semi_major;
+        uint8_t semi_minor;
+        uint16_t orientation;
+    };
+
+    struct PathHistoryPoint {
+        int32_t lat_offset;
+        int32_t lon_offset;
+        int16_t elevation_offset;
+        uint16_t time_offset;
+        bool has_speed;
+        bool has_pos_accuracy;
+        bool has_heading;
+        uint16_t speed;
+        PositionalAccuracy pos_accuracy;
+        uint8_t heading;
+    };
+
+    static constexpr std::size_t max_crumbs = 23;                       ///> the size limit of a PathHistoryPointList.
+
+    struct Bsm {
+        // BSMcoreData.
+        uint8_t msg_cnt;
+        uint8_t id[4];
+        uint16_t sec_mark;
+        int32_t lat;
+        int32_t lon;
+        int32_t elev;
+        PositionalAccuracy accuracy;
+        uint8_t transmission;
+        uint16_t speed;
+        uint16_t heading;
+        int16_t angle;
+        int16_t accel_long;
+        int16_t accel_lat;
+        int16_t accel_vert;
+        int16_t accel_yaw;
+        uint8_t wheel_brakes;                                           ///> the 5 bits of BrakeAppliedStatus, first bit highest.
+        uint8_t traction;
+        uint8_t abs;
+        uint8_t scs;
+        uint8_t brake_boost;
+        uint8_t aux_brakes;
+        uint16_t width;
+        uint16_t length;
+
+        // the VehicleSafetyExtensions, the only Part II content decoded.
+        bool has_safety_extensions;
+        bool has_events;
+        bool has_path_history;
+        bool has_path_prediction;
+        bool has_lights;
+        uint16_t events;                                                ///> the 13 bits of VehicleEventFlags, first bit highest.
+        std::size_t crumb_count;
+        PathHistoryPoint crumbs[ max_crumbs ];
+        int16_t radius_of_curve;
+        uint8_t confidence;
+        uint16_t lights;                                                ///> the 9 bits of ExteriorLights, first bit highest.
+    };
+
+    /**
+     * @brief Decode a UPER MessageFrame holding a BasicSafetyMessage into bsm.
+     *
+     * @param consumed when not null, receives the bytes of the MessageFrame; later bytes are not read.
+     * @return false when the frame is not one this decoder handles; bsm is then undefined.
+     */
+    bool decode( const void* bytes, std::size_t length, Bsm& bsm, std::size_t* consumed = nullptr );
+
+    /**
+     * @brief Append the canonical XER of the MessageFrame of bsm to xer; compact writes the compact XER of asn1_xer.
+     */
+    void write_xer( const Bsm& bsm, std::string& xer, bool compact = false );
+}
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BSM_FILTER_HPP
+#define ACM_BSM_FILTER_HPP
+
+#include "bsm_fast_path.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A test of the BSMcoreData of each decoded BSM that decides what becomes of its response. A CodecContext applies its
+ * filters in order, after the binary decoding and before any XER is written, and stops at the first DROP.
+ *
+ * A filter given to several contexts is called by their threads at once, so it either keeps no state or guards it.
+ */
+class BsmFilter {
+
+    public:
+
+        enum class Verdict {
+            PASS,                                                       ///> the response is produced as usual.
+            DIVERT,                                                     ///> the response is produced to the filter's topic.
+            DROP                                                        ///> no response is written.
+        };
+
+        virtual ~BsmFilter() = default;
+
+        /**
+         * @brief The verdict for one BSM.
+         */
+        virtual Verdict test( const bsm_fast_path::Bsm& bsm ) = 0;
+};
+
+/**
+ * The pieces the stateful filters share: the vehicle key, the shard of a key, and the clock.
+ */
+namespace bsm_filter {
+
+    /**
+     * @brief The 4-byte temporary id of a BSM as a number.
+     */
+    inline uint32_t vehicle_id( const bsm_fast_path::Bsm& bsm ) {
+        return static_cast<uint32_t>( bsm.id[0] ) << 24 | static_cast<uint32_t>( bsm.id[1] ) << 16
+            | static_cast<uint32_t>( bsm.id[2] ) << 8 | bsm.id[3];
+    }
+
+    /**
+     * @brief A key mixed by Fibonacci hashing; the top bits are the best mixed, so they choose the shard and the
+     * bits below them the first slot.
+     */
+    inline uint64_t spread( uint64_t key ) {
+        return key * 0x9E3779B97F4A7C15ULL;
+    }
+
+    constexpr unsigned log2( std::size_t n ) {
+        return n > 1 ? 1 + log2( n / 2 ) : 0;
+    }
+
+    /**
+     * @brief The shard of a key out of shard_count, from the top log2(shard_count) bits of its spread.
+     */
+    template <std::size_t shard_count>
+    inline std::size_t shard_of( uint64_t key ) {
+        static_assert( shard_count > 1 && ( shard_count & ( shard_count - 1 ) ) == 0, "shard_count must be a power of 2 above 1" );
+        return static_cast<std::size_t>( spread( key ) >> ( 64 - log2( shard_count ) ) );
+    }
+
+    /**
+     * @brief Milliseconds of the steady clock.
+     *
+     * Threads read the clock before they take a shard's lock, so a time may be a little behind the one the shard
+     * last saw; the users of these times take a time that goes back as no time passing.
+     */
+    inline uint64_t steady_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    /**
+     * @brief Milliseconds since the epoch, for times that are reported.
+     */
+    inline uint64_t system_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+    }
+}
+
+#endif
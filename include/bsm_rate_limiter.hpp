@@ -0,0 +1,86 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_BSM_RATE_LIMITER_HPP
+#define ACM_BSM_RATE_LIMITER_HPP
+
+#include "bsm_filter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Passes at most one BSM per vehicle, by its temporary id, in each interval; the others are dropped. A vehicle's first
+ * BSM passes, and the next one passes when at least interval_ms have gone by since the last one that passed.
+ *
+ * The vehicles are kept in a fixed-size open addressing table of 16 byte slots, split into shards with a lock each,
+ * so one limiter serves every context. A vehicle not seen for idle_ms frees its slot for the next vehicle that probes
+ * it; when every slot a vehicle may use is taken, the one seen longest ago is evicted. An evicted vehicle's next BSM
+ * passes.
+ */
+class BsmRateLimiter : public BsmFilter {
+
+    public:
+
+        /**
+         * @brief Rate limit to one BSM per interval_ms; capacity is the number of vehicles tracked, rounded up to a
+         * power of 2 per shard, and idle_ms is at least interval_ms.
+         */
+        BsmRateLimiter( uint32_t interval_ms, std::size_t capacity = 65536, uint32_t idle_ms = 10000 );
+
+        /**
+         * @brief The verdict with the steady clock's time.
+         */
+        Verdict test( const bsm_fast_path::Bsm& bsm ) override;
+
+        /**
+         * @brief The verdict for a BSM from vehicle id at now_ms; the times given must not go back.
+         */
+        Verdict test( uint32_t id, uint64_t now_ms );
+
+        std::size_t capacity() const;
+
+    private:
+
+        static constexpr std::size_t shard_count = 16;
+        static constexpr std::size_t max_probes = 16;                   ///> the slots a vehicle may use.
+
+        struct Slot {
+            uint64_t last;                                              ///> the milliseconds of the last BSM that passed; 0 for a free slot.
+            uint32_t id;
+        };
+
+        struct Shard {
+            std::mutex mutex;
+            std::vector<Slot> slots;
+        };
+
+        uint64_t interval_;
+        uint64_t idle_;
+        std::size_t mask_;                                              ///> the slots of a shard, less 1.
+        std::unique_ptr<Shard[]> shards_;
+};
+
+#endif
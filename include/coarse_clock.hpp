@@ -0,0 +1,52 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_COARSE_CLOCK_HPP
+#define ACM_COARSE_CLOCK_HPP
+
+#include <ctime>
+#include <string>
+
+/**
+ * The current UTC time formatted for the ODE timestamps (receivedAt, generatedAt), e.g., 2018-03-14T15:09:26Z[UTC].
+ *
+ * The timestamps have a resolution of one second, so the text is only formatted again when the second changes; the
+ * other calls read the system clock and compare. A clock is NOT thread-safe; each codec context owns one.
+ */
+class CoarseClock {
+
+    public:
+
+        CoarseClock();
+
+        /**
+         * @brief The current time; the reference is valid until the next call.
+         */
+        const std::string& now();
+
+    private:
+
+        std::time_t second_;                                            ///> the second the text was formatted for.
+        std::string text_;
+};
+
+#endif
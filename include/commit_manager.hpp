@@ -0,0 +1,146 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_COMMIT_MANAGER_HPP
+#define ACM_COMMIT_MANAGER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Tracks, for each consumed partition, the highest contiguous offset whose response has been delivered.
+ *
+ * A message is tracked just before its response is produced and completed from the delivery report. The offsets
+ * returned by take_commits() only cover messages whose responses, and those of every earlier message of the
+ * partition, were delivered, so committing them gives at-least-once processing. A message that is never completed
+ * holds back the commits of its partition; it is processed again after a restart.
+ *
+ * A failed delivery, or a response librdkafka would not take, is resolved like a delivered one: librdkafka has already
+ * retried it, and keeping it in flight would stop its partition's commits for good while its entries grow without
+ * bound. Its response is lost; the failures are counted so they can be reported.
+ *
+ * Messages of a partition must be tracked in offset order; the worker pool guarantees this by giving each partition
+ * to one worker. track() and complete() may be called from different threads.
+ */
+class CommitManager {
+
+    struct Partition;
+
+    struct Entry {
+        int64_t offset;
+        bool done;
+        Partition* partition;
+    };
+
+    public:
+
+        typedef Entry Token;                            ///> identifies a tracked message; valid until it is completed.
+
+        struct Offset {
+            std::string topic;
+            int32_t partition;
+            int64_t offset;                             ///> the next offset to consume, as Kafka commits expect.
+        };
+
+        CommitManager();
+
+        CommitManager( const CommitManager& ) = delete;
+        CommitManager& operator=( const CommitManager& ) = delete;
+
+        /**
+         * @brief Start tracking a consumed message.
+         *
+         * @return the token to complete when the response has been delivered.
+         */
+        Token* track( const std::string& topic, int32_t partition, int64_t offset );
+
+        /**
+         * @brief Record the delivery result of a tracked message; a failed delivery is counted and committed past.
+         */
+        void complete( Token* token, bool delivered = true );
+
+        /**
+         * @brief The number of tracked messages completed as failed.
+         */
+        uint64_t failures() const;
+
+        /**
+         * @brief Assign the partitions whose committable offset advanced since the last call.
+         *
+         * @return the number of offsets assigned.
+         */
+        std::size_t take_commits( std::vector<Offset>& offsets );
+
+        /**
+         * @brief The number of tracked messages that are not yet committable.
+         */
+        std::size_t pending() const;
+
+        /**
+         * @brief The number of tracked messages of one partition that are not yet committable.
+         */
+        std::size_t pending( const std::string& topic, int32_t partition ) const;
+
+        struct Position {
+            std::string topic;
+            int32_t partition;
+            int64_t next;                               ///> the offset to commit; -1 when none is committable.
+            int64_t first;                              ///> the lowest offset tracked; -1 when none is in flight.
+            int64_t last;                               ///> the highest offset tracked; -1 when none is in flight.
+            std::size_t pending;                        ///> the tracked messages that are not yet committable.
+        };
+
+        /**
+         * @brief The position of every tracked partition.
+         */
+        std::vector<Position> positions() const;
+
+        /**
+         * @brief Stop tracking a partition that is no longer consumed, e.g., after it is revoked. A partition with
+         * messages in flight is kept, since their tokens refer to it.
+         *
+         * @param offset assigned the committable offset that was not yet taken, if any.
+         * @return true when offset was assigned.
+         */
+        bool release( const std::string& topic, int32_t partition, Offset& offset );
+
+    private:
+
+        struct Partition {
+            std::string topic;
+            int32_t partition;
+            std::deque<Entry> entries;                  ///> in offset order; references stay valid as the ends change.
+            int64_t next;                               ///> the offset to commit; -1 when there is none.
+            bool advanced;
+        };
+
+        std::map<std::pair<std::string, int32_t>, std::unique_ptr<Partition>> partitions_;
+        uint64_t failures_;
+        mutable std::mutex mutex_;
+};
+
+#endif
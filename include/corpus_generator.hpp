@@ -0,0 +1,141 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_CORPUS_GENERATOR_HPP
+#define ACM_CORPUS_GENERATOR_HPP
+
+#include "asn_application.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Builds benchmark corpora of valid J2735 MessageFrames: BSMs of a fleet of moving vehicles, with and without Part II
+ * content, TIMs, and the MAPs and SPaTs of a fixed set of intersections, in a configurable mix. Each message is written
+ * as XER with randomized fields and optional elements and encoded with the asn1c encoders, so every message passes the
+ * constraint checks; a vehicle's BSMs continue its track and an intersection's MAP keeps its geometry and revision, as
+ * a real feed does.
+ *
+ * The same seed always gives the same corpus.
+ */
+class CorpusGenerator {
+
+    public:
+
+        enum class Kind : uint8_t { BSM, TIM, MAP, SPAT, COUNT };
+
+        /**
+         * The form of a generated message: a MessageFrame in UPER, an IEEE 1609.2 frame in COER whose unsecuredData
+         * is the UPER MessageFrame, or an ODE XML decode request holding the UPER MessageFrame in hex.
+         */
+        enum class Format : uint8_t { UPER, COER, XML };
+
+        static const char* name( Kind kind );
+
+        /**
+         * @brief Interpret the name of a format: uper, coer, or xml.
+         *
+         * @throws std::invalid_argument for any other name.
+         */
+        static Format parse_format( const std::string& name );
+
+        /**
+         * @brief Encode the XER text of a structure of type with the transfer syntax.
+         *
+         * @throws std::runtime_error when the XER does not decode, violates a constraint, or does not encode.
+         */
+        static void encode( const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax, const std::string& xer, std::string& bytes );
+
+        explicit CorpusGenerator( uint64_t seed = 1, std::size_t vehicles = 256, std::size_t intersections = 32 );
+
+        /**
+         * @brief Set the weights of the kinds from a list such as bsm=70,tim=10,map=10,spat=10; kinds not in the list
+         * are not generated.
+         *
+         * @throws std::invalid_argument for an unknown kind, a bad weight, or weights that are all zero.
+         */
+        void set_mix( const std::string& mix );
+
+        /**
+         * @brief The kind of the next message, drawn by the weights of the mix.
+         */
+        Kind next_kind();
+
+        /**
+         * @brief The XER of a new MessageFrame of kind.
+         */
+        void xer( Kind kind, std::string& xer );
+
+        /**
+         * @brief Generate the next message of the mix in format; the XML request carries the message's sequence number
+         * as its serialNumber.
+         *
+         * @return the kind of the message.
+         */
+        Kind next( Format format, std::string& message );
+
+        uint64_t generated() const;             ///> the messages generated so far.
+
+    private:
+
+        struct Vehicle {
+            uint32_t id;
+            int64_t lat;                        ///> 1/10 micro degrees.
+            int64_t lon;
+            int64_t elev;                       ///> decimeters.
+            int64_t speed;                      ///> 0.02 m/s.
+            int64_t heading;                    ///> 0.0125 degrees.
+            int64_t msg_count;
+            int64_t sec_mark;                   ///> milliseconds in the minute.
+            bool part2;                         ///> the vehicle sends Part II content.
+        };
+
+        struct Intersection {
+            int64_t id;
+            int64_t lat;
+            int64_t lon;
+            int64_t revision;
+            uint64_t geometry;                  ///> the seed of its lanes.
+            std::vector<uint8_t> phases;        ///> the phase of each signal group, from 1.
+        };
+
+        std::mt19937_64 rng_;
+        std::vector<uint32_t> weights_;         ///> by Kind.
+        std::vector<Vehicle> vehicles_;
+        std::vector<Intersection> intersections_;
+        uint64_t generated_;
+        int64_t minute_;                        ///> the minute of the year of the messages.
+        std::string xer_;
+        std::string frame_;
+        std::string hex_;
+
+        int64_t uniform( int64_t low, int64_t high );
+
+        void bsm_xer( std::string& xer );
+        void tim_xer( std::string& xer );
+        void map_xer( std::string& xer );
+        void spat_xer( std::string& xer );
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_CPU_AFFINITY_HPP
+#define ACM_CPU_AFFINITY_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * Placement of the ACM threads on CPUs.
+ *
+ * A thread inherits the CPU set of the thread that creates it. This is how the librdkafka threads are kept on their
+ * own CPUs, since librdkafka does not expose them. The memory a thread touches first is allocated on that thread's
+ * NUMA node, so a pinned worker's arena and buffers are local to it without a NUMA library.
+ */
+namespace cpu_affinity {
+
+/**
+ * @brief Parse a CPU list, e.g., 0-3,8,10-11.
+ *
+ * @return the CPU numbers in the order listed; empty for an empty list.
+ * @throws std::invalid_argument when the text is not a CPU list.
+ */
+std::vector<int> parse( const std::string& list );
+
+/**
+ * @brief Restrict the calling thread to the CPUs; an empty set leaves it where it is.
+ *
+ * @return false when the platform does not support it or a CPU does not exist.
+ */
+bool pin_current_thread( const std::vector<int>& cpus );
+
+/**
+ * @brief The CPUs the calling thread may run on, in increasing order; empty when the platform does not tell.
+ */
+std::vector<int> current_cpus();
+
+}  // end namespace.
+
+#endif
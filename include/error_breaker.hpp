@@ -0,0 +1,129 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_ERROR_BREAKER_HPP
+#define ACM_ERROR_BREAKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A circuit breaker on the error responses of each source, a consumed topic and partition.
+ *
+ * A source's breaker is closed while it sends fewer than threshold bad messages in a window of window_ms, and every
+ * error is reported in full. From the threshold-th error of a window, the breaker is open: only the first error and
+ * then one in every sample is reported, and the others are counted and dropped. The breaker closes again at the end of
+ * the first window that has fewer errors than the threshold, quiet windows included, so a source that recovers is
+ * reported in full without a restart.
+ *
+ * The counts of each source since the last call are taken by summaries(), which gives the compact record of a storm
+ * in place of the dropped responses. Good messages are never counted, so they keep the capacity the dropped responses
+ * would have taken. report() and summaries() may be called from different threads; only errors take the lock.
+ */
+class ErrorBreaker {
+
+    public:
+
+        static constexpr std::size_t codes = 4;                         ///> the error codes counted apart; larger codes count as the last.
+
+        struct Summary {
+            std::string topic;
+            int32_t partition;
+            uint64_t errors;                                            ///> the errors since the last summary.
+            uint64_t reported;                                          ///> those reported in full.
+            uint64_t suppressed[codes];                                 ///> those dropped, by code.
+            bool open;                                                  ///> the breaker's state when the summary is taken.
+        };
+
+        /**
+         * @brief Open a source's breaker at threshold errors (at least 1) in window_ms, then report one error in every
+         * sample (at least 1).
+         */
+        ErrorBreaker( uint32_t threshold, uint32_t window_ms = 1000, uint32_t sample = 100 );
+
+        ErrorBreaker( const ErrorBreaker& ) = delete;
+        ErrorBreaker& operator=( const ErrorBreaker& ) = delete;
+
+        /**
+         * @brief Count an error of the source with the steady clock's time.
+         *
+         * @return true when the error response is to be produced; false when it is dropped.
+         */
+        bool report( const std::string& topic, int32_t partition, uint32_t code );
+
+        /**
+         * @brief Count an error of the source at now_ms; the times given must not go back.
+         */
+        bool report( const std::string& topic, int32_t partition, uint32_t code, uint64_t now_ms );
+
+        /**
+         * @brief The counts of the sources whose breaker was open at some time since the last call, with the steady
+         * clock's time; each source's counts restart.
+         */
+        std::vector<Summary> summaries();
+
+        /**
+         * @brief The summaries at now_ms; the breakers whose window ended quietly close first, and the sources that
+         * are closed and were quiet for a window are forgotten.
+         */
+        std::vector<Summary> summaries( uint64_t now_ms );
+
+        /**
+         * @brief The errors dropped since the breaker was made.
+         */
+        uint64_t suppressed() const;
+
+        uint64_t window() const;
+
+    private:
+
+        struct Source {
+            uint64_t window_start;
+            uint64_t window_errors;                                     ///> the errors of the current window.
+            uint64_t open_errors;                                       ///> the errors since the breaker opened; chooses the samples.
+            bool open;
+            bool tripped;                                               ///> open at some time since the last summary.
+            uint64_t errors;                                            ///> the counts since the last summary.
+            uint64_t reported;
+            uint64_t suppressed[codes];
+        };
+
+        /**
+         * @brief Move the source's window to the one holding now; the breaker closes when a window ends with fewer
+         * errors than the threshold.
+         */
+        void roll( Source& source, uint64_t now ) const;
+
+        uint64_t threshold_;
+        uint64_t window_;
+        uint64_t sample_;
+
+        mutable std::mutex mutex_;
+        std::map<std::pair<std::string, int32_t>, Source> sources_;
+        uint64_t suppressed_;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_GEOFENCE_HPP
+#define ACM_GEOFENCE_HPP
+
+#include "bsm_filter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A set of polygons, in the 1/10 micro degree units of the J2735 Latitude and Longitude, with a uniform grid over their
+ * bounding box for point queries.
+ *
+ * A cell that no edge touches is entirely inside or entirely outside, which is decided when the index is built; a
+ * point there is answered by a lookup. A point in a cell an edge touches is tested, by the even-odd rule, against the
+ * edges of its row of cells only. The rings of a polygon after the first are its holes. Polygons do not cross the
+ * antimeridian. An index is not changed after it is built, so one index serves every thread.
+ */
+class GeofenceIndex {
+
+    public:
+
+        struct Point {
+            int32_t lat;
+            int32_t lon;
+        };
+
+        using Ring = std::vector<Point>;                                ///> closed implicitly; the last point may repeat the first.
+        using Polygon = std::vector<Ring>;
+
+        static constexpr std::size_t default_cells = 128;              ///> the rows and columns of the grid.
+
+        /**
+         * @brief Build the index of polygons; throws std::invalid_argument when there are none or a ring has fewer
+         * than 3 points.
+         */
+        explicit GeofenceIndex( const std::vector<Polygon>& polygons, std::size_t cells = default_cells );
+
+        /**
+         * @brief Build the index of the Polygon and MultiPolygon geometries of a GeoJSON geometry, Feature, or
+         * FeatureCollection; throws std::invalid_argument when the text is not one or has no polygons.
+         */
+        static std::shared_ptr<const GeofenceIndex> from_geojson( const std::string& json, std::size_t cells = default_cells );
+
+        /**
+         * @brief Read a GeoJSON file with from_geojson; throws std::invalid_argument when it cannot be read.
+         */
+        static std::shared_ptr<const GeofenceIndex> load( const std::string& path, std::size_t cells = default_cells );
+
+        /**
+         * @brief True when the point is inside a polygon; a point on an edge may be either.
+         */
+        bool contains( int32_t lat, int32_t lon ) const;
+
+        std::size_t polygons() const;
+        std::size_t edges() const;
+
+    private:
+
+        enum CellState : uint8_t { OUTSIDE, INSIDE, BOUNDARY };
+
+        struct Edge {
+            int32_t lat1;
+            int32_t lon1;
+            int32_t lat2;
+            int32_t lon2;
+            uint32_t polygon;
+        };
+
+        std::size_t cells_;
+        std::size_t polygons_;
+        std::size_t edges_;
+        int64_t min_lat_;
+        int64_t min_lon_;
+        int64_t cell_lat_;                                              ///> the height of a row, at least 1.
+        int64_t cell_lon_;                                              ///> the width of a column, at least 1.
+        std::vector<uint8_t> states_;                                   ///> the CellState of each cell, row by row.
+        std::vector<std::vector<Edge>> rows_;                           ///> the edges that reach into each row, by polygon.
+
+        bool row_contains( std::size_t row, int32_t lat, int32_t lon ) const;
+};
+
+/**
+ * Keeps the BSMs inside a GeofenceIndex; the others are dropped or diverted. It has no state of its own, so one filter
+ * serves every context.
+ */
+class GeofenceFilter : public BsmFilter {
+
+    public:
+
+        GeofenceFilter( std::shared_ptr<const GeofenceIndex> index, Verdict outside );
+
+        Verdict test( const bsm_fast_path::Bsm& bsm ) override;
+
+    private:
+
+        std::shared_ptr<const GeofenceIndex> index_;
+        Verdict outside_;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_HEX_CODEC_HPP
+#define ACM_HEX_CODEC_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Conversion between raw bytes and the hex strings carried in the ODE XML.
+ *
+ * The conversions process 16 (SSE2, NEON) or 32 (AVX2) bytes at a time when the compiler targets those instruction
+ * sets; the remainder, and every other platform, use a table-driven scalar loop.
+ */
+namespace hex_codec {
+
+    static constexpr std::size_t npos = static_cast<std::size_t>( -1 );
+
+    /**
+     * @brief The name of the implementation selected at compile time: "avx2", "sse2", "neon", or "scalar".
+     */
+    const char* implementation();
+
+    /**
+     * @brief Write 2 * length upper case hex characters for the bytes to out; out is NOT null terminated.
+     */
+    void encode( const void* bytes, std::size_t length, char* out );
+
+    /**
+     * @brief Replace the contents of hex with the upper case hex representation of the bytes.
+     */
+    void encode( const void* bytes, std::size_t length, std::string& hex );
+
+    /**
+     * @brief Convert length hex characters (either case) into (length + 1) / 2 bytes written to out.
+     *
+     * An odd number of characters is accepted; the final character becomes the high order nibble of the final byte.
+     *
+     * @return npos on success; otherwise the offset of the first character that is not a hex digit.
+     */
+    std::size_t decode( const char* hex, std::size_t length, void* out );
+
+    /**
+     * @brief Replace the contents of bytes with the bytes represented by hex.
+     *
+     * @return npos on success; otherwise the offset of the first character that is not a hex digit.
+     */
+    std::size_t decode( const std::string& hex, std::vector<char>& bytes );
+}
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_KAFKA_STATS_HPP
+#define ACM_KAFKA_STATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * The fields of a librdkafka statistics report (see STATISTICS.md in librdkafka) used to size the ACM's batching and
+ * worker counts. librdkafka emits a report from each client every statistics.interval.ms.
+ */
+struct KafkaStatistics {
+    std::string type;                                               ///> the client type: producer or consumer.
+    int64_t queued_messages;                                        ///> msg_cnt: messages waiting in the producer queues.
+    int64_t queued_bytes;                                           ///> msg_size: bytes waiting in the producer queues.
+    int64_t reply_queue;                                            ///> replyq: operations waiting to be served by poll.
+    int64_t consumer_lag;                                           ///> the sum of the known partition consumer lags.
+    int64_t fetch_queue;                                            ///> the sum of the partition fetch queue message counts.
+    int64_t rtt_avg_us;                                             ///> the largest average broker round trip time.
+    int64_t rtt_p99_us;                                             ///> the largest 99th percentile broker round trip time.
+    int32_t brokers;                                                ///> the brokers with round trip times.
+    int32_t partitions;                                             ///> the partitions with a known consumer lag.
+
+    KafkaStatistics();
+
+    /**
+     * @brief Read the fields from the statistics JSON; the fields absent from the report are 0.
+     *
+     * @return false when json is not a JSON object; stats is unchanged.
+     */
+    static bool parse( const char* json, std::size_t length, KafkaStatistics& stats );
+};
+
+#endif
@@ -0,0 +1,184 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_LANE_QUEUE_HPP
+#define ACM_LANE_QUEUE_HPP
+
+#include "ring_queue.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * A queue with priority lanes, each a RingQueue: lane 0 is served first, then lane 1, and so on, so the items of a high
+ * lane do not wait behind a flood in a lower one.
+ *
+ * With a weight of 0 the dispatch is strict: a lower lane is served only when the higher ones are empty. With a weight
+ * of N, a lane that has been served N times in a row while a lower lane has items gives that lane one turn, so no
+ * lane is starved. The items of one lane stay in order; the lanes are not ordered with respect to each other. Any
+ * number of threads may push, but only one may pop, since the turns are kept without synchronization.
+ */
+template<typename T>
+class LaneQueue {
+
+    public:
+
+        /**
+         * @param lanes the number of lanes, at least 1.
+         * @param capacity the number of items each lane holds; rounded up to a power of two.
+         */
+        explicit LaneQueue( std::size_t lanes = 2, std::size_t capacity = 256, unsigned weight = 0 ) :
+            lanes_{}
+            , streaks_( lanes ? lanes : 1, 0 )
+            , weight_{ weight }
+        {
+            for ( std::size_t i = 0; i < streaks_.size(); ++i ) {
+                lanes_.emplace_back( new RingQueue<T>{ capacity } );
+            }
+        }
+
+        LaneQueue( const LaneQueue& ) = delete;
+        LaneQueue& operator=( const LaneQueue& ) = delete;
+
+        /**
+         * @brief Change the capacity of every lane; only call this when no threads are using the queue.
+         */
+        void set_capacity( std::size_t capacity )
+        {
+            for ( auto& lane : lanes_ ) lane->set_capacity( capacity );
+        }
+
+        void set_weight( unsigned weight )
+        {
+            weight_ = weight;
+        }
+
+        /**
+         * @brief Add an item to a lane (the last one when lane is past it), waiting for space if the lane is full.
+         *
+         * @return true if the item was queued; false if the queue was closed.
+         */
+        bool push( T item, std::size_t lane )
+        {
+            return lanes_[ lane < lanes_.size() ? lane : lanes_.size() - 1 ]->push( std::move( item ) );
+        }
+
+        /**
+         * @brief Add an item to a lane without waiting; the item is only moved from when it is queued.
+         *
+         * @return false when the lane is full or the queue is closed.
+         */
+        bool try_push( T& item, std::size_t lane )
+        {
+            return lanes_[ lane < lanes_.size() ? lane : lanes_.size() - 1 ]->try_push( item );
+        }
+
+        /**
+         * @brief Remove the next item by priority, waiting for one to arrive; lane, when not null, is set to its lane.
+         *
+         * @return true if item was assigned; false if the queue is closed and every lane is empty.
+         */
+        bool pop( T& item, std::size_t* lane = nullptr )
+        {
+            std::size_t from;
+            for ( unsigned waits = 0; !take( item, from ); ++waits ) {
+                if ( lanes_.front()->closed() ) {
+                    // a push that completed before the close is still dequeued.
+                    if ( !take( item, from ) ) return false;
+                    break;
+                }
+                RingQueue<T>::wait( waits );
+            }
+            if ( lane ) *lane = from;
+            return true;
+        }
+
+        /**
+         * @brief Wake all waiting threads; no further items are accepted.
+         */
+        void close()
+        {
+            for ( auto& lane : lanes_ ) lane->close();
+        }
+
+        void open()
+        {
+            for ( auto& lane : lanes_ ) lane->open();
+        }
+
+        /**
+         * @brief The number of items queued in every lane; approximate while other threads use the queue.
+         */
+        std::size_t size() const
+        {
+            std::size_t n = 0;
+            for ( const auto& lane : lanes_ ) n += lane->size();
+            return n;
+        }
+
+        std::size_t size( std::size_t lane ) const
+        {
+            return lanes_[ lane ]->size();
+        }
+
+        std::size_t lanes() const
+        {
+            return lanes_.size();
+        }
+
+    private:
+
+        std::vector<std::unique_ptr<RingQueue<T>>> lanes_;
+        std::vector<unsigned> streaks_;                                 ///> the turns each lane has had in a row.
+        unsigned weight_;
+
+        bool take( T& item, std::size_t& lane )
+        {
+            for ( std::size_t i = 0; i < lanes_.size(); ++i ) {
+                // a full streak passes the turn down; the lane is tried again below when no lower lane has an item.
+                if ( weight_ > 0 && streaks_[i] >= weight_ && i + 1 < lanes_.size() ) {
+                    streaks_[i] = 0;
+                    continue;
+                }
+                if ( lanes_[i]->try_pop( item ) ) {
+                    ++streaks_[i];
+                    lane = i;
+                    return true;
+                }
+                streaks_[i] = 0;
+            }
+
+            for ( std::size_t i = 0; i < lanes_.size(); ++i ) {
+                if ( lanes_[i]->try_pop( item ) ) {
+                    streaks_[i] = 1;
+                    lane = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+};
+
+#endif
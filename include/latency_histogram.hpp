@@ -0,0 +1,91 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_LATENCY_HISTOGRAM_HPP
+#define ACM_LATENCY_HISTOGRAM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A lock-free histogram of latencies in nanoseconds with HDR-style log-linear buckets.
+ *
+ * Values below 8 have their own buckets; larger values fall in one of 8 buckets per power of two, so a reported value
+ * is at most 12.5% above the recorded one. Any number of threads may record at the same time; recording is three
+ * relaxed atomic operations.
+ */
+class LatencyHistogram {
+
+    public:
+
+        /**
+         * The counts taken from a histogram.
+         */
+        struct Snapshot {
+            std::vector<uint64_t> counts;
+            uint64_t count;
+            uint64_t sum;
+            uint64_t max;
+
+            Snapshot();
+
+            /**
+             * @brief The upper limit of the bucket holding the pth (0 to 1) fraction of the values; 0 when empty.
+             */
+            uint64_t percentile( double p ) const;
+            uint64_t mean() const;
+        };
+
+        static constexpr unsigned sub_bucket_bits = 3;
+        static constexpr std::size_t sub_buckets = 1 << sub_bucket_bits;
+        static constexpr std::size_t bucket_count = ( 64 - sub_bucket_bits + 1 ) * sub_buckets;
+
+        LatencyHistogram();
+
+        LatencyHistogram( const LatencyHistogram& ) = delete;
+        LatencyHistogram& operator=( const LatencyHistogram& ) = delete;
+
+        void record( uint64_t ns );
+
+        /**
+         * @brief Move the counts recorded since the last take into snapshot; values recorded meanwhile go to one of
+         * the two takes.
+         */
+        void take( Snapshot& snapshot );
+
+        /**
+         * @brief Copy the counts recorded since the last take into snapshot, leaving them for the next take.
+         */
+        void peek( Snapshot& snapshot ) const;
+
+        static std::size_t bucket( uint64_t ns );
+        static uint64_t bucket_limit( std::size_t bucket );        ///> the largest value in the bucket.
+
+    private:
+
+        std::atomic<uint64_t> counts_[bucket_count];
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> max_;
+};
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_LIBACM_H
+#define ACM_LIBACM_H
+
+/*
+ * libacm: the ACM codec as a library with a C API, for services that decode and encode in process instead of through
+ * Kafka (e.g., the ODE through JNI or Panama).
+ *
+ * An acm_t is thread-safe: each call borrows a codec context from the handle's idle contexts, or builds a new one, so
+ * concurrent calls run in parallel with one context per calling thread and no lock held while a message is processed.
+ * Responses are written into the caller's buffer; nothing returned by the library must be freed by the caller except
+ * the handle itself.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define ACM_API __attribute__((visibility("default")))
+#else
+#define ACM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The results of the library calls. */
+enum acm_status {
+    ACM_OK = 0,                 /* the response is in the output buffer. */
+    ACM_ERROR_RESPONSE,         /* the input could not be decoded or encoded; the ODE error document is in the output. */
+    ACM_BUFFER_TOO_SMALL,       /* nothing usable was written; written holds the size the response needs. */
+    ACM_INVALID_ARGUMENT,
+    ACM_FAILURE                 /* the library could not process the call, e.g., out of memory. */
+};
+
+typedef struct acm_handle acm_t;
+
+/** The settings of a handle; acm_options_init sets the defaults. */
+typedef struct acm_options {
+    const char* error_template;     /* the ODE error XML template; default "./config/Output.error.xml". */
+    size_t decode_cache_bytes;      /* the memory cap of each context's decode cache; default 0, no cache. */
+    size_t encode_cache_bytes;      /* the memory cap of each context's encode cache; default 0, no cache. */
+    size_t xml_pool_chunk_bytes;    /* the chunk size of each context's XML page pool; default 1 MiB, 0 is no pool. */
+    int json_output;                /* non-zero to write decoded responses as JSON; default 0, ODE XML. */
+} acm_options;
+
+/** Set the default options. */
+ACM_API void acm_options_init( acm_options* options );
+
+/**
+ * Build a handle; options may be NULL for the defaults. On failure NULL is returned and, when error is not NULL, the
+ * reason is written to it (truncated to error_size with a terminating null).
+ */
+ACM_API acm_t* acm_create( const acm_options* options, char* error, size_t error_size );
+
+/** Release a handle and its contexts; no call may be using it. */
+ACM_API void acm_destroy( acm_t* acm );
+
+/**
+ * Decode an ODE XML request (an OdeAsn1Data document with hex UPER/COER data) into the output buffer.
+ *
+ * written is assigned the bytes of the response, written or needed; the response is not null terminated. After
+ * ACM_BUFFER_TOO_SMALL the call can be repeated with a buffer of at least that size; output may be NULL when capacity
+ * is 0, to learn the size.
+ */
+ACM_API int acm_decode( acm_t* acm, const void* message, size_t length, char* output, size_t capacity, size_t* written );
+
+/** Encode an ODE XML request holding XER into the UPER/COER hex response; as acm_decode. */
+ACM_API int acm_encode( acm_t* acm, const void* message, size_t length, char* output, size_t capacity, size_t* written );
+
+/**
+ * Decode a binary PDU with no ODE envelope; encodings are its elementType:encodingRule pairs, outermost first,
+ * separated by commas and null terminated, e.g., "Ieee1609Dot2Data:COER,MessageFrame:UPER". As acm_decode.
+ */
+ACM_API int acm_decode_bytes( acm_t* acm, const void* bytes, size_t length, const char* encodings, char* output,
+        size_t capacity, size_t* written );
+
+/**
+ * The caller's column arrays of a BSM batch decode; each array that is not NULL has room for capacity elements, and
+ * element i of every array is row i. A NULL array is not written.
+ */
+typedef struct acm_bsm_columns {
+    size_t capacity;
+    uint32_t* input;            /* the index of the payload of each row. */
+    uint32_t* id;               /* the TemporaryID, its first byte highest. */
+    uint16_t* sec_mark;
+    int32_t* lat;
+    int32_t* lon;
+    int32_t* elev;
+    uint16_t* speed;
+    uint16_t* heading;
+    int16_t* accel;             /* the longitudinal acceleration. */
+} acm_bsm_columns;
+
+/**
+ * Decode the BSMcoreData of count UPER MessageFrame payloads, payload i being lengths[i] bytes at payloads[i], into the
+ * columns; a payload that is not a BasicSafetyMessage has no row. It needs no handle and is thread-safe.
+ *
+ * rows is assigned the rows written. Every payload may be a row, so ACM_BUFFER_TOO_SMALL, with nothing written, is
+ * returned when the capacity is less than count.
+ */
+ACM_API int acm_decode_bsm_columns( const void* const* payloads, const size_t* lengths, size_t count,
+        acm_bsm_columns* columns, size_t* rows );
+
+/** Write the 2 * length upper case hex characters of the bytes to out, which is not null terminated. */
+ACM_API void acm_hex_encode( const void* bytes, size_t length, char* out );
+
+/**
+ * Write the (length + 1) / 2 bytes of length hex characters to out.
+ *
+ * @return ACM_OK, or ACM_INVALID_ARGUMENT when a character is not a hex digit.
+ */
+ACM_API int acm_hex_decode( const char* hex, size_t length, void* out );
+
+/** A static description of a status. */
+ACM_API const char* acm_status_string( int status );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
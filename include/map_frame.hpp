@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_MAP_FRAME_HPP
+#define ACM_MAP_FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * The start of a UPER MessageFrame holding a MapData (messageId 18), read without asn1c.
+ *
+ * An intersection's MAP is rebroadcast unchanged until its msgIssueRevision changes, except for its timeStamp, the
+ * minute of the year it was sent. The revision key of a MAP is its MessageFrame with the timeStamp bits set to 0, so
+ * every MAP of one revision of an intersection has the same key, and its XER is the XER of any of them with the
+ * timeStamp text changed.
+ */
+namespace map_frame {
+
+    struct Header {
+        std::size_t bytes;                                              ///> the bytes of the MessageFrame.
+        bool has_time_stamp;
+        uint32_t time_stamp;                                            ///> the MinuteOfTheYear.
+        std::size_t time_stamp_bit;                                     ///> the offset of its 20 bits in the frame.
+        uint8_t revision;                                               ///> the msgIssueRevision.
+    };
+
+    /**
+     * @brief Read the header of the MessageFrame at bytes; false when it is not a MapData or is shorter than its
+     * length says. Nothing after the msgIssueRevision is checked.
+     */
+    bool parse( const void* bytes, std::size_t length, Header& header );
+
+    /**
+     * @brief The revision key of the MessageFrame that header was read from.
+     */
+    void revision_key( const void* bytes, const Header& header, std::string& key );
+
+    /**
+     * @brief Append the XER of a MAP with the revision key of cached, the XER of another MAP, to xer: the text of its
+     * first timeStamp element is header's timeStamp. False when cached and header do not agree on having one.
+     */
+    bool restamp( const std::string& cached, const Header& header, std::string& xer );
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_MEMORY_BUDGET_HPP
+#define ACM_MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * One memory budget for the ACM, split in shares for the components whose memory depends on the traffic: the consume
+ * batches, the messages waiting in the worker queues, the decode caches, and the asn1c arenas.
+ *
+ * Each component's use and high-water mark are tracked in bytes. The components that hold messages are limited when
+ * they are added: reserve() blocks, and try_reserve() fails, while the share is used, so the consumer stops taking
+ * messages until the workers release theirs. A reservation is always granted when nothing of its share is in use, so a
+ * message larger than the share still goes through alone. The caches and arenas are sized within their shares when
+ * they are made and only report their use, with adjust().
+ *
+ * A budget of 0 bytes limits nothing and only tracks the use. Every member may be called from any thread.
+ */
+class MemoryBudget {
+
+    public:
+
+        enum class Component : uint32_t {
+            BATCH,                                                      ///> the messages of the consume batch.
+            QUEUES,                                                     ///> the messages waiting for a worker.
+            CACHES,                                                     ///> the decode, MAP, and encode caches of every worker.
+            ARENAS,                                                     ///> the chunks the asn1c arenas keep between messages.
+            COUNT
+        };
+
+        static constexpr std::size_t components = static_cast<std::size_t>( Component::COUNT );
+
+        static const char* name( Component c );
+
+        /**
+         * @brief Make a budget of total bytes split by the default shares: batch=10,queues=40,caches=30,arenas=20.
+         */
+        explicit MemoryBudget( std::size_t total = 0 );
+
+        MemoryBudget( const MemoryBudget& ) = delete;
+        MemoryBudget& operator=( const MemoryBudget& ) = delete;
+
+        /**
+         * @brief Set the total and the percent of each component named in split, e.g., "queues=50,caches=50"; the
+         * components not named have no share and are not limited. An empty split keeps the current shares.
+         *
+         * @throws std::invalid_argument for an unknown component, a bad percent, or percents over 100 in all.
+         */
+        void set_total( std::size_t total, const std::string& split = "" );
+
+        std::size_t total() const;
+
+        /**
+         * @brief The bytes of a component's share; 0 when it is not limited.
+         */
+        std::size_t limit( Component c ) const;
+
+        /**
+         * @brief Add bytes to the use of c unless that takes it over its share.
+         */
+        bool try_reserve( Component c, std::size_t bytes );
+
+        /**
+         * @brief Add bytes to the use of c, waiting for releases while that takes it over its share.
+         */
+        void reserve( Component c, std::size_t bytes );
+
+        void release( Component c, std::size_t bytes );
+
+        /**
+         * @brief Change the use a component reports from the bytes it used to the bytes it uses now.
+         */
+        void adjust( Component c, std::size_t from, std::size_t to );
+
+        std::size_t in_use( Component c ) const;
+        std::size_t high_water( Component c ) const;
+
+    private:
+
+        std::atomic<std::size_t> total_;
+        std::atomic<uint32_t> percent_[components];
+        std::atomic<std::size_t> in_use_[components];
+        std::atomic<std::size_t> high_water_[components];
+
+        std::mutex mutex_;
+        std::condition_variable released_;
+        std::atomic<uint32_t> waiting_;
+
+        bool add( Component c, std::size_t bytes, bool limited );
+};
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_MESSAGE_LATENCIES_HPP
+#define ACM_MESSAGE_LATENCIES_HPP
+
+#include "latency_histogram.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * The latency histograms that place a message's end-to-end delay: for each consumed topic and partition, the time from
+ * its Kafka timestamp to its consumption (kafka) and from its consumption to the hand off of its response to
+ * librdkafka (acm); for each produced topic, the time from that hand off to the brokers' acknowledgement (delivery).
+ *
+ * The histograms are created on first use and never removed, so the references returned stay valid; recording is
+ * lock-free. Each thread keeps its own copy of the histograms it has looked up, so a lookup takes the lock only the
+ * first time a thread asks for a histogram, and the consumer and the delivery reports do not contend. take() may run
+ * on another thread at the same time.
+ */
+class MessageLatencies {
+
+    public:
+
+        struct Partition {
+            LatencyHistogram kafka;
+            LatencyHistogram acm;
+        };
+
+        typedef std::function<void( const std::string& key, const char* stage, const LatencyHistogram::Snapshot& snapshot )> Visitor;
+
+        MessageLatencies();
+
+        MessageLatencies( const MessageLatencies& ) = delete;
+        MessageLatencies& operator=( const MessageLatencies& ) = delete;
+
+        Partition& partition( const std::string& topic, int32_t partition );
+        LatencyHistogram& delivery( const std::string& topic );
+
+        /**
+         * @brief Visit the histograms with values recorded since the last take, keyed topic:partition or topic, taking
+         * their counts.
+         */
+        void take( const Visitor& visit );
+
+    private:
+
+        const uint64_t generation_;                     ///> tells this object's entries in the per-thread copies from others'.
+        std::mutex mutex_;
+        std::map<std::pair<std::string, int32_t>, std::unique_ptr<Partition>> partitions_;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> delivery_;
+        LatencyHistogram::Snapshot snapshot_;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_METRICS_ENDPOINT_HPP
+#define ACM_METRICS_ENDPOINT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A page of metrics in the Prometheus text exposition format (version 0.0.4).
+ */
+class MetricsText {
+
+    public:
+
+        typedef std::vector<std::pair<std::string, std::string>> Labels;
+
+        /**
+         * @brief Start a metric family; its samples follow.
+         *
+         * @param type gauge or counter.
+         */
+        void family( const std::string& name, const char* type, const char* help );
+
+        void sample( const std::string& name, double value );
+        void sample( const std::string& name, const Labels& labels, double value );
+
+        const std::string& str() const;
+
+    private:
+
+        std::string text_;
+};
+
+/**
+ * Serves the last published metrics page over HTTP, e.g., to a Prometheus scraper or an autoscaler.
+ *
+ * One thread accepts the connections and answers each with a copy of the page, so a scrape never waits for, or
+ * slows down, the thread that publishes it. GET /metrics returns the page; any other path is not found. Each
+ * connection carries one request.
+ */
+class MetricsEndpoint {
+
+    public:
+
+        /**
+         * @param host the address to bind; empty for every interface.
+         * @param port the TCP port; 0 for one the kernel chooses.
+         */
+        MetricsEndpoint( const std::string& host, uint16_t port );
+        ~MetricsEndpoint();
+
+        MetricsEndpoint( const MetricsEndpoint& ) = delete;
+        MetricsEndpoint& operator=( const MetricsEndpoint& ) = delete;
+
+        /**
+         * @brief Bind and listen, and start the thread that answers the requests.
+         *
+         * @return false when the address cannot be bound; errno holds the reason.
+         */
+        bool open();
+
+        /**
+         * @brief Stop answering and close the socket.
+         */
+        void close();
+
+        /**
+         * @brief The port the endpoint listens on; 0 before it is open.
+         */
+        uint16_t port() const;
+
+        /**
+         * @brief Replace the page the next requests get.
+         */
+        void publish( std::string page );
+
+        /**
+         * @brief The projected time to consume a backlog of lag messages at full utilization.
+         *
+         * @param consumed_per_s the rate messages were consumed at.
+         * @param lag_per_s the rate the backlog grew at; negative while it shrinks.
+         * @param busy_ratio the share of the processing threads' time spent on those messages.
+         * @return the seconds; infinity when the backlog cannot shrink at full utilization.
+         */
+        static double drain_seconds( double lag, double consumed_per_s, double lag_per_s, double busy_ratio );
+
+    private:
+
+        std::string host_;
+        uint16_t port_;
+        int fd_;
+        std::atomic<bool> running_;
+        std::thread thread_;
+        std::string page_;
+        std::mutex mutex_;
+
+        bool bind_to( int family );
+        void serve();
+        void answer( int fd );
+};
+
+#endif
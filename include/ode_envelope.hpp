@@ -0,0 +1,102 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_ODE_ENVELOPE_HPP
+#define ACM_ODE_ENVELOPE_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * A forward-only scanner for the OdeAsn1Data envelope of a decode request.
+ *
+ * The scanner makes one pass over the message and records where the parts the decoder needs are: the encodings in
+ * metadata/encodings, the payloadType and generatedAt metadata, the payload dataType text, the payload data element,
+ * and its bytes text. Nothing is copied; the
+ * ranges refer to the scanned buffer, and the rest of the envelope can be copied to the output as it is.
+ *
+ * Only the common shape of the envelope is accepted. Comments, CDATA, a DOCTYPE, processing instructions after the XML
+ * declaration, entity references in the recorded text, repeated target elements, and a data element holding anything
+ * other than bytes all make scan() return false so the caller can use the DOM instead.
+ */
+class OdeEnvelope {
+
+    public:
+
+        struct Range {
+            const char* begin;
+            std::size_t size;
+
+            const char* end() const { return begin + size; }
+        };
+
+        struct Encoding {
+            Range element_type;
+            Range encoding_rule;                        ///> begin is null when the encoding has no rule.
+        };
+
+        OdeEnvelope();
+
+        /**
+         * @brief Scan a message; the ranges are valid while the buffer is.
+         *
+         * @return true if the envelope has the expected shape and every target element was found.
+         */
+        bool scan( const char* buffer, std::size_t length );
+
+        const std::vector<Encoding>& encodings() const;
+        Range encodings_block() const;                  ///> the whole OdeAsn1Data/metadata/encodings element.
+        Range payload_type() const;                     ///> the trimmed text of OdeAsn1Data/metadata/payloadType; begin is null when absent.
+        Range generated_at() const;                     ///> the trimmed text of OdeAsn1Data/metadata/generatedAt; begin is null when absent.
+
+        Range data_type() const;                        ///> the trimmed text of OdeAsn1Data/payload/dataType.
+        Range data() const;                             ///> the content of OdeAsn1Data/payload/data.
+        Range bytes() const;                            ///> the trimmed text of OdeAsn1Data/payload/data/bytes.
+        Range bytes_encoding() const;                   ///> the encoding attribute of OdeAsn1Data/payload/data/bytes; begin is null when absent.
+
+    private:
+
+        struct Element {
+            Range name;
+            const char* start;                          ///> the '<' of the start tag.
+            const char* content;                        ///> the first byte after the start tag.
+            std::size_t children;
+        };
+
+        std::vector<Element> stack_;
+        std::vector<Encoding> encodings_;
+        Range encodings_block_;
+        Encoding encoding_;
+        Range payload_type_;
+        Range generated_at_;
+        Range data_type_;
+        Range data_;
+        Range bytes_;
+        Range bytes_encoding_;
+        const char* bytes_start_;
+        const char* bytes_end_;
+        std::size_t found_encodings_;
+
+        bool close( const Element& element, const char* content_end, const char* element_end );
+        bool in( std::size_t depth, const char* name ) const;
+};
+
+#endif
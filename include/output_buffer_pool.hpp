@@ -0,0 +1,146 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_OUTPUT_BUFFER_POOL_HPP
+#define ACM_OUTPUT_BUFFER_POOL_HPP
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * A thread-safe pool of the buffers the responses are written into and produced from.
+ *
+ * A buffer is acquired by a ProduceStream, written, and handed to librdkafka without a copy; the delivery report
+ * callback returns it to the pool. Each buffer keeps its capacity in a header in front of the data, so only the data
+ * pointer has to travel through librdkafka. In steady state responses are written and produced with no heap
+ * allocation. Buffers beyond the retained limit, or larger than the retained size, are freed instead of pooled.
+ */
+class OutputBufferPool {
+
+    public:
+
+        /**
+         * @brief Construct a pool of buffers that start with buffer_size bytes.
+         *
+         * @param buffer_size the capacity of a new buffer.
+         * @param max_buffers the most buffers kept for reuse.
+         * @param max_retained_size buffers that have grown beyond this are freed when returned.
+         */
+        explicit OutputBufferPool( std::size_t buffer_size = 4096, std::size_t max_buffers = 1024, std::size_t max_retained_size = 1 << 20 ) :
+            buffer_size_{ buffer_size ? buffer_size : 1 }
+            , max_buffers_{ max_buffers }
+            , max_retained_size_{ max_retained_size }
+            , free_{}
+            , mutex_{}
+        {}
+
+        ~OutputBufferPool()
+        {
+            for ( char* data : free_ ) std::free( header( data ) );
+        }
+
+        OutputBufferPool( const OutputBufferPool& ) = delete;
+        OutputBufferPool& operator=( const OutputBufferPool& ) = delete;
+
+        /**
+         * @brief A buffer from the pool, or a new one when the pool is empty; throws std::bad_alloc.
+         */
+        char* acquire()
+        {
+            {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                if ( !free_.empty() ) {
+                    char* data = free_.back();
+                    free_.pop_back();
+                    return data;
+                }
+            }
+
+            return allocate( nullptr, buffer_size_ );
+        }
+
+        /**
+         * @brief Grow a buffer from this pool to capacity bytes, keeping its contents; throws std::bad_alloc.
+         */
+        char* grow( char* data, std::size_t capacity )
+        {
+            return allocate( data, capacity );
+        }
+
+        /**
+         * @brief Return a buffer to the pool; a null data pointer is ignored.
+         */
+        void release( char* data )
+        {
+            if ( !data ) return;
+
+            if ( capacity( data ) <= max_retained_size_ ) {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                if ( free_.size() < max_buffers_ ) {
+                    free_.push_back( data );
+                    return;
+                }
+            }
+
+            std::free( header( data ) );
+        }
+
+        /**
+         * @brief The number of bytes that can be written to a buffer from this pool.
+         */
+        static std::size_t capacity( const char* data )
+        {
+            return *reinterpret_cast<const std::size_t*>( data - header_size );
+        }
+
+        std::size_t available()
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            return free_.size();
+        }
+
+    private:
+
+        static constexpr std::size_t header_size = 16;                  ///> keeps the data aligned like malloc.
+
+        std::size_t buffer_size_;
+        std::size_t max_buffers_;
+        std::size_t max_retained_size_;
+        std::vector<char*> free_;
+        std::mutex mutex_;
+
+        static char* header( char* data )
+        {
+            return data - header_size;
+        }
+
+        static char* allocate( char* data, std::size_t capacity )
+        {
+            char* p = static_cast<char*>( std::realloc( data ? header( data ) : nullptr, header_size + capacity ) );
+            if ( !p ) throw std::bad_alloc{};
+            *reinterpret_cast<std::size_t*>( p ) = capacity;
+            return p + header_size;
+        }
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_OUTPUT_PARTITIONER_HPP
+#define ACM_OUTPUT_PARTITIONER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Chooses the partition each response is produced to, so the output of the ACM can be consumed in parallel.
+ *
+ * - fixed: every response goes to one partition, or to librdkafka's choice when none is given (the default).
+ * - input: a response goes to the partition its request was consumed from, so the order of each partition is kept.
+ * - key: librdkafka's partitioner places each response by its key (see acm.output.key), so the responses with one
+ *   key stay together and in order; keyless ones are spread by it.
+ * - sticky: the responses of each output topic fill its partitions in turn, batch responses at a time, so the
+ *   producer still sends large batches but every partition is used. The order across partitions is not kept.
+ *
+ * The partition counts of the output topics are set before producing; partition() may then run on any thread.
+ */
+class OutputPartitioner {
+
+    public:
+
+        enum class Strategy { FIXED, INPUT, KEY, STICKY };
+
+        static constexpr int32_t unassigned = -1;                       ///> RdKafka::Topic::PARTITION_UA.
+
+        /**
+         * @brief The strategy named fixed, input, key, or sticky.
+         *
+         * @throws std::invalid_argument for any other name.
+         */
+        static Strategy parse( const std::string& name );
+
+        static const char* name( Strategy strategy );
+
+        /**
+         * @param fixed the partition of the fixed strategy; unassigned for librdkafka's choice.
+         * @param batch the responses produced to a partition before the sticky strategy moves to the next.
+         */
+        explicit OutputPartitioner( Strategy strategy, int32_t fixed = unassigned, uint32_t batch = 1000 );
+
+        OutputPartitioner( const OutputPartitioner& ) = delete;
+        OutputPartitioner& operator=( const OutputPartitioner& ) = delete;
+
+        /**
+         * @brief The number of partitions of each output topic, by index; 0 when it is not known. Not thread-safe.
+         */
+        void set_partitions( const std::vector<int32_t>& counts );
+
+        /**
+         * @brief The partition of a response to the output topic; input_partition is its request's, negative when it
+         * has none. unassigned leaves the choice to librdkafka.
+         */
+        int32_t partition( std::size_t topic, int32_t input_partition );
+
+        Strategy strategy() const;
+
+    private:
+
+        Strategy strategy_;
+        int32_t fixed_;
+        uint32_t batch_;
+        std::vector<int32_t> counts_;
+        std::unique_ptr<std::atomic<uint64_t>[]> produced_;             ///> the responses of each topic so far; sticky.
+};
+
+#endif
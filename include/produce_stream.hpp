@@ -0,0 +1,217 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_PRODUCE_STREAM_HPP
+#define ACM_PRODUCE_STREAM_HPP
+
+#include "output_buffer_pool.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <streambuf>
+
+/**
+ * An output stream that writes into a malloc'd buffer that can be handed directly to librdkafka.
+ *
+ * The codec writes its response into this stream; the buffer is then released and produced with RK_MSG_FREE so
+ * librdkafka frees it after delivery. This replaces the std::stringstream::str() copy and the RK_MSG_COPY copy.
+ *
+ * When the stream is given an OutputBufferPool its buffers come from, and must be returned to, that pool instead; the
+ * producer then neither copies nor frees them and the delivery report callback returns them.
+ */
+class ProduceStream : public std::ostream {
+
+    class Buffer : public std::streambuf {
+
+        public:
+
+            Buffer( std::size_t capacity, OutputBufferPool* pool ) :
+                data_{ nullptr }
+                , capacity_{ capacity ? capacity : 1 }
+                , pool_{ pool }
+            {
+                allocate();
+            }
+
+            ~Buffer()
+            {
+                if ( pool_ ) {
+                    pool_->release( data_ );
+                } else {
+                    std::free( data_ );
+                }
+            }
+
+            Buffer( const Buffer& ) = delete;
+            Buffer& operator=( const Buffer& ) = delete;
+
+            char* data() const
+            {
+                return pbase();
+            }
+
+            std::size_t size() const
+            {
+                return static_cast<std::size_t>( pptr() - pbase() );
+            }
+
+            char* release( std::size_t& length )
+            {
+                char* r = data_;
+                length = size();
+                data_ = nullptr;
+                allocate();
+                return r;
+            }
+
+            void reset()
+            {
+                setp( data_, data_ + capacity_ );
+            }
+
+        protected:
+
+            int_type overflow( int_type ch ) override
+            {
+                if ( traits_type::eq_int_type( ch, traits_type::eof() ) ) return traits_type::not_eof( ch );
+                grow( 1 );
+                *pptr() = traits_type::to_char_type( ch );
+                pbump( 1 );
+                return ch;
+            }
+
+            std::streamsize xsputn( const char* s, std::streamsize n ) override
+            {
+                std::size_t len = static_cast<std::size_t>( n );
+                if ( len > static_cast<std::size_t>( epptr() - pptr() ) ) grow( len );
+                std::memcpy( pptr(), s, len );
+                // pbump takes an int; large payloads are advanced in pieces.
+                while ( len > 0 ) {
+                    int step = len > 0x40000000 ? 0x40000000 : static_cast<int>( len );
+                    pbump( step );
+                    len -= step;
+                }
+                return n;
+            }
+
+        private:
+
+            char* data_;
+            std::size_t capacity_;
+            OutputBufferPool* pool_;
+
+            void allocate()
+            {
+                if ( pool_ ) {
+                    data_ = pool_->acquire();
+                    capacity_ = OutputBufferPool::capacity( data_ );
+                } else {
+                    data_ = static_cast<char*>( std::malloc( capacity_ ) );
+                    if ( !data_ ) throw std::bad_alloc{};
+                }
+                setp( data_, data_ + capacity_ );
+            }
+
+            void grow( std::size_t needed )
+            {
+                std::size_t used = size();
+                std::size_t capacity = capacity_;
+                while ( capacity - used < needed ) capacity *= 2;
+
+                char* p = pool_ ? pool_->grow( data_, capacity ) : static_cast<char*>( std::realloc( data_, capacity ) );
+                if ( !p ) throw std::bad_alloc{};
+
+                data_ = p;
+                capacity_ = capacity;
+                setp( data_, data_ + capacity_ );
+                // restore the write position.
+                std::size_t len = used;
+                while ( len > 0 ) {
+                    int step = len > 0x40000000 ? 0x40000000 : static_cast<int>( len );
+                    pbump( step );
+                    len -= step;
+                }
+            }
+    };
+
+    public:
+
+        /**
+         * @brief Construct a stream whose buffers start with the given capacity; buffers grow as needed.
+         *
+         * @param capacity the initial capacity of the malloc'd buffers; ignored when there is a pool.
+         * @param pool when not null the buffers are taken from this pool, which must outlive the stream.
+         */
+        explicit ProduceStream( std::size_t capacity = 4096, OutputBufferPool* pool = nullptr ) :
+            std::ostream{ nullptr }
+            , buf_{ capacity, pool }
+        {
+            rdbuf( &buf_ );
+        }
+
+        ProduceStream( const ProduceStream& ) = delete;
+        ProduceStream& operator=( const ProduceStream& ) = delete;
+
+        /**
+         * @brief The bytes written since the last release/reset; NOT null terminated.
+         */
+        const char* data() const
+        {
+            return buf_.data();
+        }
+
+        std::size_t size() const
+        {
+            return buf_.size();
+        }
+
+        /**
+         * @brief Give the written bytes to the caller, who must release them with std::free (librdkafka RK_MSG_FREE), or
+         * return them to the stream's pool when it has one.
+         *
+         * A new, empty buffer is allocated (or acquired) for the next message.
+         *
+         * @param length assigned the number of bytes in the returned buffer.
+         * @return the malloc'd buffer.
+         */
+        char* release( std::size_t& length )
+        {
+            clear();
+            return buf_.release( length );
+        }
+
+        /**
+         * @brief Discard the written bytes and keep the buffer for the next message.
+         */
+        void reset()
+        {
+            clear();
+            buf_.reset();
+        }
+
+    private:
+
+        Buffer buf_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_RESULT_CACHE_HPP
+#define ACM_RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * A bounded least recently used cache from exact input bytes to the output they produced.
+ *
+ * The ODE rebroadcasts the same TIMs, MAPs, and ASDs many times a minute; a context keeps the output of each distinct
+ * input so a copy skips the codec. An entry is found by a 64 bit hash of the input and a signature of everything else
+ * the output depends on (e.g., the encodings), and is only used when its input is the same byte for byte. The cache
+ * holds at most capacity bytes of inputs, outputs, and entry overhead. Like the context, it is not thread-safe.
+ */
+class ResultCache {
+
+    public:
+
+        struct Stats {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+            std::size_t entries;
+            std::size_t bytes;                                          ///> the memory charged to the entries.
+        };
+
+        /**
+         * @param capacity the memory cap in bytes; an output larger than a quarter of it is never cached.
+         */
+        explicit ResultCache( std::size_t capacity );
+
+        ResultCache( const ResultCache& ) = delete;
+        ResultCache& operator=( const ResultCache& ) = delete;
+
+        /**
+         * @brief A 64 bit hash of the bytes computed eight bytes at a time.
+         */
+        static uint64_t hash( const void* bytes, std::size_t length );
+
+        /**
+         * @brief The output cached for the input; nullptr when there is none. A hit becomes the most recently used
+         * entry, and its tag and label are copied to tag and label when they are not null. The pointer is valid until
+         * the next insert or clear.
+         */
+        const std::string* find( uint64_t signature, const void* input, std::size_t length, int32_t* tag = nullptr, std::string* label = nullptr );
+
+        /**
+         * @brief Cache the output of the input, evicting the least recently used entries to stay within the capacity.
+         *
+         * @param tag a value kept with the output for the caller, e.g., the messageId of a decoded MessageFrame.
+         * @param label a string kept with the output for the caller, e.g., the Kafka key of the response.
+         */
+        void insert( uint64_t signature, const void* input, std::size_t length, const char* output, std::size_t output_length, int32_t tag = -1,
+                const std::string& label = std::string{} );
+
+        void clear();
+
+        std::size_t capacity() const;
+        const Stats& stats() const;
+
+    private:
+
+        static constexpr std::size_t entry_overhead = 96;               ///> the list node, index node, and string headers of an entry.
+
+        struct Entry {
+            uint64_t key;                                               ///> the hash of the input combined with the signature.
+            uint64_t signature;
+            int32_t tag;
+            std::string input;
+            std::string output;
+            std::string label;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        std::size_t capacity_;
+        EntryList entries_;                                             ///> most recently used first.
+        std::unordered_map<uint64_t, EntryList::iterator> index_;
+        Stats stats_;
+
+        static uint64_t key( uint64_t signature, const void* input, std::size_t length );
+        static std::size_t charge( const Entry& entry );
+        void erase( EntryList::iterator it );
+};
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_RING_QUEUE_HPP
+#define ACM_RING_QUEUE_HPP
+
+#include "spdlog/details/mpmc_bounded_q.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/**
+ * A bounded, lock-free, multi-producer / multi-consumer queue connecting the stages of the ACM: the consumer, the codec
+ * workers, and the producers.
+ *
+ * The items are kept in the bundled spdlog ring buffer (Vyukov's bounded MPMC queue), so a push or pop that does not
+ * wait is a compare and swap and never takes a lock. A full or empty queue is waited on by spinning, then yielding,
+ * then sleeping for short intervals. The interface is the same as WorkQueue: producers wait when the queue is full,
+ * which applies backpressure to the stage before it, and once closed, pushes fail and pops drain the remaining items
+ * before failing.
+ */
+template<typename T>
+class RingQueue {
+
+    public:
+
+        /**
+         * @param capacity the number of items held; rounded up to a power of two.
+         */
+        explicit RingQueue( std::size_t capacity = 256 ) :
+            capacity_{ ring_size( capacity ) }
+            , ring_{ new spdlog::details::mpmc_bounded_queue<T>{ capacity_ } }
+            , closed_{ false }
+        {}
+
+        RingQueue( const RingQueue& ) = delete;
+        RingQueue& operator=( const RingQueue& ) = delete;
+
+        /**
+         * @brief Change the capacity; only call this when no threads are using the queue. Queued items are discarded.
+         */
+        void set_capacity( std::size_t capacity )
+        {
+            if ( ring_size( capacity ) == capacity_ ) return;
+            capacity_ = ring_size( capacity );
+            ring_.reset( new spdlog::details::mpmc_bounded_queue<T>{ capacity_ } );
+        }
+
+        /**
+         * @brief Add an item to the queue, waiting for space if the queue is full.
+         *
+         * @return true if the item was queued; false if the queue was closed.
+         */
+        bool push( T item )
+        {
+            if ( closed_.load( std::memory_order_acquire ) ) return false;
+
+            // the ring only moves from the item when it is queued.
+            for ( unsigned waits = 0; !ring_->enqueue( std::move( item ) ); ++waits ) {
+                if ( closed_.load( std::memory_order_acquire ) ) return false;
+                wait( waits );
+            }
+            return true;
+        }
+
+        /**
+         * @brief Add an item to the queue without waiting; the item is only moved from when it is queued.
+         *
+         * @return false when the queue is full or closed.
+         */
+        bool try_push( T& item )
+        {
+            if ( closed_.load( std::memory_order_acquire ) ) return false;
+            return ring_->enqueue( std::move( item ) );
+        }
+
+        /**
+         * @brief Remove the item at the front of the queue, waiting for one to arrive.
+         *
+         * @return true if item was assigned; false if the queue is closed and empty.
+         */
+        bool pop( T& item )
+        {
+            for ( unsigned waits = 0; !ring_->dequeue( item ); ++waits ) {
+                // a push that completed before the close is still dequeued.
+                if ( closed_.load( std::memory_order_acquire ) ) return ring_->dequeue( item );
+                wait( waits );
+            }
+            return true;
+        }
+
+        /**
+         * @brief Remove the item at the front of the queue without waiting.
+         *
+         * @return false when the queue is empty.
+         */
+        bool try_pop( T& item )
+        {
+            return ring_->dequeue( item );
+        }
+
+        bool closed() const
+        {
+            return closed_.load( std::memory_order_acquire );
+        }
+
+        /**
+         * @brief Wake all waiting threads; no further items are accepted.
+         */
+        void close()
+        {
+            closed_.store( true, std::memory_order_release );
+        }
+
+        /**
+         * @brief Reopen a closed queue so it can be used again, e.g., after the Kafka connections are rebuilt.
+         */
+        void open()
+        {
+            closed_.store( false, std::memory_order_release );
+        }
+
+        /**
+         * @brief The number of queued items; approximate while other threads use the queue.
+         */
+        std::size_t size() const
+        {
+            return ring_->approx_size();
+        }
+
+        std::size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        /**
+         * @brief Back off after waits tries of a full or empty queue: spin, then yield, then sleep. A busy stage is
+         * answered in well under a microsecond; an idle one costs a wake up every 200 us.
+         */
+        static void wait( unsigned waits )
+        {
+            if ( waits < 64 ) return;
+
+            if ( waits < 128 ) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+            }
+        }
+
+    private:
+
+        std::size_t capacity_;
+        std::unique_ptr<spdlog::details::mpmc_bounded_queue<T>> ring_;
+        std::atomic<bool> closed_;
+
+        static std::size_t ring_size( std::size_t capacity )
+        {
+            std::size_t size = 2;
+            while ( size < capacity ) size <<= 1;
+            return size;
+        }
+};
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_SHM_RING_HPP
+#define ACM_SHM_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * A ring of variable length records in a POSIX shared memory object, so processes on one host hand messages over
+ * without a broker. Any number of producers may push into a ring, each from any thread; one consumer takes the records
+ * in the order their space was reserved.
+ *
+ * A producer reserves its record's space with a compare-and-swap on the ring's head, copies the record in, and then
+ * publishes its header; a record that does not fit before the end of the ring is put at its start, after a padding
+ * record. The consumer reads a record in place with peek() and gives its space back, zeroed, with pop(). A consumer
+ * that finds the ring empty, and a producer that finds it full, sleep on a futex in the shared memory, and the other
+ * side only makes the wake-up system call when someone sleeps.
+ *
+ * A producer that dies between the reservation and the publication of a record stops the consumer at that record.
+ */
+class ShmRing {
+
+    public:
+
+        /**
+         * @param name the shared memory object, e.g., /acm.requests; a missing leading slash is added.
+         * @param capacity the bytes of records when the ring is made, rounded up to a power of 2; 0 to only attach to
+         * a ring another process made.
+         */
+        explicit ShmRing( const std::string& name, std::size_t capacity = 0 );
+        ~ShmRing();
+
+        ShmRing( const ShmRing& ) = delete;
+        ShmRing& operator=( const ShmRing& ) = delete;
+
+        /**
+         * @brief Attach to the ring, making it when it does not exist and there is a capacity.
+         *
+         * @return false when the object cannot be opened, mapped, or is not a ring; errno holds the reason.
+         */
+        bool open();
+
+        /**
+         * @brief Copy a record into the ring, waiting up to timeout_ms for its space; -1 waits without end.
+         *
+         * @return false when the ring stays full or the record can never fit (errno EMSGSIZE).
+         */
+        bool push( const void* data, std::size_t length, int timeout_ms );
+
+        /**
+         * @brief Wait up to timeout_ms for the next record; only one thread may consume a ring.
+         *
+         * @return the record, valid until pop(); null when there is none in time.
+         */
+        const uint8_t* peek( std::size_t& length, int timeout_ms );
+
+        /**
+         * @brief Give back the space of the record returned by the last peek().
+         */
+        void pop();
+
+        /**
+         * @brief The bytes of records the ring holds, headers and padding included.
+         */
+        std::size_t capacity() const;
+
+        const std::string& name() const;
+
+        /**
+         * @brief Remove the shared memory object; the processes attached keep their mappings.
+         */
+        static bool remove( const std::string& name );
+
+    private:
+
+        static constexpr uint64_t magic = 0x41434d52494e4731ULL;       ///> "ACMRING1".
+        static constexpr std::size_t header_bytes = 8;                  ///> a record's header; records start on 8 bytes.
+
+        struct alignas(64) Control {
+            std::atomic<uint64_t> magic;                                ///> stored last when the ring is made.
+            uint64_t capacity;
+            alignas(64) std::atomic<uint64_t> head;                     ///> the bytes reserved by the producers.
+            alignas(64) std::atomic<uint64_t> tail;                     ///> the bytes given back by the consumer.
+            alignas(64) std::atomic<uint32_t> data_signal;              ///> the futex the consumer sleeps on.
+            std::atomic<uint32_t> consumer_waiting;
+            alignas(64) std::atomic<uint32_t> space_signal;             ///> the futex the producers sleep on.
+            std::atomic<uint32_t> producers_waiting;
+        };
+
+        std::atomic<uint32_t>& header( uint64_t position ) const;
+
+        /**
+         * @brief Sleep on signal, last read as seen, until it changes, it is woken, or timeout_ms; false on a timeout.
+         */
+        static bool wait( std::atomic<uint32_t>& signal, uint32_t seen, int timeout_ms );
+        static void wake( std::atomic<uint32_t>& signal, int count );
+
+        bool attach( int fd );
+
+        std::string name_;
+        std::size_t requested_;
+        void* map_;
+        std::size_t map_bytes_;
+        Control* control_;
+        uint8_t* data_;
+        uint64_t mask_;
+        uint64_t read_;                                                 ///> the consumer's position.
+        uint64_t peeked_;                                               ///> the bytes of the record being read; 0 for none.
+};
+
+#endif
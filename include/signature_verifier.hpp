@@ -0,0 +1,183 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_SIGNATURE_VERIFIER_HPP
+#define ACM_SIGNATURE_VERIFIER_HPP
+
+#include "unvalidated_certificate_cache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Verifies the ECDSA NIST P-256 signatures of IEEE 1609.2 signedData on a pool of its own threads, shared by every
+ * codec context. A context submits the hashes and the signature of each signed frame it decodes and waits for the
+ * result just before its response is produced, so the verification overlaps the decoding of the MessageFrame. Each
+ * pool thread takes up to a batch of the queued requests at a time, so one wake up and one notification serve many
+ * signatures when the traffic is heavy. The signatures are verified with OpenSSL's P-256 code (the constant time
+ * nistz256 assembly on x86-64 and ARMv8).
+ *
+ * The sampled percent of the signed frames are verified; the others are SKIPPED. The signer certificates are kept
+ * in the verifier's UnvalidatedCertificateCache, so the frames signed with only the digest of a certificate seen
+ * before are verified too, and each key is parsed once. Implicit certificates, which need the issuer to reconstruct
+ * the key, are UNSUPPORTED.
+ *
+ * No certificate chain is checked: a signer certificate is never verified against its issuer or a trust anchor, so
+ * SIGNATURE_MATCHES_CARRIED_KEY only shows that the frame was signed with the key of the certificate it carries (or,
+ * for a digest, of the certificate an earlier frame carried). Anyone can make such a frame; it does not authenticate
+ * the sender.
+ *
+ * Verification is optional; without OpenSSL (the ACM_VERIFY build option) available() is false and the constructor
+ * throws.
+ */
+class SignatureVerifier {
+
+    public:
+
+        enum class Status : uint8_t {
+            NONE,                                                       ///> the frame is not signed.
+            SIGNATURE_MATCHES_CARRIED_KEY,                              ///> signed with the key of its unvalidated certificate.
+            SKIPPED,                                                    ///> signed, but not in the verified sample.
+            UNSUPPORTED,                                                ///> an implicit certificate, a self signer, or another curve or hash.
+            UNKNOWN_SIGNER,                                             ///> signed with the digest of a certificate not seen.
+            EXPIRED,                                                    ///> signed outside the validity period of the certificate.
+            REVOKED,
+            INVALID
+        };
+
+        static constexpr std::size_t statuses = 8;
+
+        /**
+         * @brief The name of status in the response metadata, e.g., matches_carried_key; empty for NONE.
+         */
+        static const char* name( Status status );
+
+        /**
+         * @brief The status of a response with frames a and b: the worse of the two, in the order of the enum.
+         */
+        static Status combine( Status a, Status b );
+
+        /**
+         * @brief What a signature is checked with. The signed digest is SHA-256( tbs_hash || signer->hash ).
+         */
+        struct Request {
+            uint8_t tbs_hash[32];                                       ///> SHA-256 of the COER ToBeSignedData.
+            UnvalidatedCertificateCache::Entry signer;
+            uint8_t r[32];                                              ///> the x coordinate of the signature's R.
+            uint8_t s[32];
+        };
+
+        struct Job;                                                     ///> a request and its result.
+        using Ticket = std::shared_ptr<Job>;
+
+        /**
+         * @brief Start threads pool threads that take up to batch requests at a time; certificates signer
+         * certificates are kept. sample_percent is clamped to 100.
+         *
+         * @throws std::runtime_error when the ACM is built without OpenSSL.
+         */
+        SignatureVerifier( std::size_t threads = 2, std::size_t batch = 64, uint32_t sample_percent = 100, std::size_t certificates = 65536 );
+
+        /**
+         * @brief Verify the requests already submitted and stop the threads.
+         */
+        ~SignatureVerifier();
+
+        SignatureVerifier( const SignatureVerifier& ) = delete;
+        SignatureVerifier& operator=( const SignatureVerifier& ) = delete;
+
+        /**
+         * @brief Predicate indicating whether the next signed frame is in the sample; each call counts one frame.
+         */
+        bool sample();
+
+        /**
+         * @brief Queue request for the pool.
+         */
+        Ticket submit( const Request& request );
+
+        /**
+         * @brief A ticket that already has status, for the frames that are not verified.
+         */
+        Ticket resolve( Status status );
+
+        /**
+         * @brief Wait for the result of ticket.
+         */
+        Status wait( const Ticket& ticket ) const;
+
+        /**
+         * @brief Verify request on this thread; the pool threads call this.
+         */
+        Status verify( const Request& request );
+
+        /**
+         * @brief The results given since the verifier started, by status.
+         */
+        uint64_t count( Status status ) const;
+
+        uint64_t batches() const;                                       ///> the batches the pool took.
+
+        /**
+         * @brief The signer certificates, shared by the contexts that submit to this verifier.
+         */
+        UnvalidatedCertificateCache& certificates();
+
+        /**
+         * @brief Predicate indicating whether the ACM is built with OpenSSL.
+         */
+        static bool available();
+
+        /**
+         * @brief out = SHA-256 of the size bytes at data.
+         */
+        static void sha256( const void* data, std::size_t size, uint8_t out[32] );
+
+    private:
+
+        std::size_t batch_;
+        uint32_t sample_percent_;
+        std::atomic<uint64_t> sampled_;                                 ///> the signed frames counted by sample().
+        UnvalidatedCertificateCache certificates_;
+        std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+        std::atomic<uint64_t> batches_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable work_;
+        mutable std::condition_variable done_;
+        std::deque<Ticket> queue_;
+        bool stopping_;
+        std::vector<std::thread> threads_;
+
+        void run();
+        void finish( Job& job, Status status );
+};
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_SLOW_MESSAGES_HPP
+#define ACM_SLOW_MESSAGES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The slowest messages of the recent windows, so a diagnostics dump can name the inputs that took the longest.
+ *
+ * The messages of the current window and of the one before are kept, at most capacity of each. A message no slower
+ * than the fastest one kept in a full window is rejected with two relaxed atomic loads, so the workers can record
+ * every message; only the slower ones take the lock.
+ */
+class SlowMessages {
+
+    public:
+
+        struct Message {
+            std::string topic;
+            int32_t partition;
+            int64_t offset;
+            uint64_t ns;                                                ///> the time from consumption to response.
+            int64_t at_ms;                                              ///> the steady clock time it was recorded.
+        };
+
+        SlowMessages( std::size_t capacity = 10, uint32_t window_ms = 60000 );
+
+        SlowMessages( const SlowMessages& ) = delete;
+        SlowMessages& operator=( const SlowMessages& ) = delete;
+
+        /**
+         * @brief Record a message that took ns, at now_ms of the steady clock; the times given must not go back.
+         */
+        void record( const std::string& topic, int32_t partition, int64_t offset, uint64_t ns, int64_t now_ms );
+
+        /**
+         * @brief The slowest messages of this window and the one before, slowest first.
+         */
+        std::vector<Message> recent() const;
+
+    private:
+
+        std::size_t capacity_;
+        int64_t window_ms_;
+        std::atomic<uint64_t> threshold_;                               ///> a message must be slower to be kept; 0 until the window is full.
+        std::atomic<int64_t> window_end_;
+        std::vector<Message> current_;
+        std::vector<Message> previous_;
+        mutable std::mutex mutex_;
+};
+
+#endif
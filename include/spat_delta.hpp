@@ -0,0 +1,93 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_SPAT_DELTA_HPP
+#define ACM_SPAT_DELTA_HPP
+
+#include "SPAT.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * Reduces decoded SPaTs to what changed since the last SPaT of each intersection, for consumers that only need the
+ * changes of the signal states; a controller sends the same states ten times a second for most of each phase.
+ *
+ * Each MovementState is remembered by the hash of its UPER encoding, so a movement is changed when any of its content
+ * is, including its TimeMarks (these are the tenths of the hour, not countdowns, so they stay the same while the
+ * timing does). An intersection whose status and movements did not change is removed. Every snapshot_seconds, and
+ * when its revision changes, the whole intersection is kept so a consumer that starts late or loses a message catches
+ * up. A delta works on the SPaTs of one stream, so each context has its own.
+ */
+class SpatDelta {
+
+    public:
+
+        /**
+         * @brief Send the whole of an intersection every snapshot_seconds; capacity is the number of intersections
+         * remembered, and when a new one would pass it everything is forgotten and the next SPaTs are sent whole.
+         */
+        explicit SpatDelta( uint32_t snapshot_seconds = 10, std::size_t capacity = 65536 );
+
+        /**
+         * @brief Reduce spat with the steady clock's time.
+         */
+        bool reduce( SPAT_t& spat );
+
+        /**
+         * @brief Remove the unchanged movements and intersections of spat, a SPaT at now_ms; false when nothing is left
+         * and spat should not be sent. The times given must not go back.
+         */
+        bool reduce( SPAT_t& spat, uint64_t now_ms );
+
+        /**
+         * @brief The intersections remembered.
+         */
+        std::size_t intersections() const;
+
+        /**
+         * @brief Forget every intersection, so the next SPaT of each is sent whole.
+         */
+        void clear();
+
+    private:
+
+        struct Intersection {
+            uint64_t snapshot_ms;                                       ///> when the whole intersection was last kept.
+            long revision;
+            uint64_t status;                                            ///> the hash of the IntersectionStatusObject.
+            std::unordered_map<long, uint64_t> movements;               ///> the hash of each signal group's MovementState.
+        };
+
+        uint64_t snapshot_ms_;
+        std::size_t capacity_;
+        std::unordered_map<uint64_t, Intersection> intersections_;     ///> by region and intersection id.
+
+        /**
+         * @brief The FNV-1a hash of the UPER encoding of a MovementState; 0 when it does not encode.
+         */
+        static uint64_t hash( const MovementState_t& movement );
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_SPOOL_DIRECTORY_HPP
+#define ACM_SPOOL_DIRECTORY_HPP
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * A directory into which captured logs are dropped for the ACM to process. A file is ready when it is closed after
+ * writing or renamed into the directory; files already present when the directory is opened are ready too. Names that
+ * begin with '.' are ignored, so writers can create a hidden file and rename it when it is complete.
+ *
+ * Ready files are read in batches: the kernel is asked to read every file of the batch ahead before the first one is
+ * copied, so the reads of a batch overlap each other and, because a batch is read while the previous one is being
+ * processed, the codecs.
+ */
+class SpoolDirectory {
+
+    public:
+
+        struct File {
+            std::string name;                                       ///> the name in the directory.
+            std::vector<uint8_t> data;
+            int error;                                              ///> the errno of a failed read; 0 when read.
+        };
+
+        explicit SpoolDirectory( const std::string& path );
+        ~SpoolDirectory();
+
+        SpoolDirectory( const SpoolDirectory& ) = delete;
+        SpoolDirectory& operator=( const SpoolDirectory& ) = delete;
+
+        /**
+         * @brief Start watching the directory and queue the files it holds.
+         *
+         * @return false when the directory cannot be watched; errno holds the reason.
+         */
+        bool open();
+
+        /**
+         * @brief Wait up to timeout_ms for ready files and move up to max_files of their names, oldest first, to names.
+         *
+         * @return the number of names added.
+         */
+        std::size_t wait( std::vector<std::string>& names, std::size_t max_files, int timeout_ms );
+
+        /**
+         * @brief Read the named files into files, one entry each, in the order given.
+         */
+        void read( const std::vector<std::string>& names, std::vector<File>& files ) const;
+
+        const std::string& path() const;
+
+    private:
+
+        std::string path_;
+        int fd_;                                                    ///> the inotify descriptor.
+        int watch_;
+        std::vector<std::string> ready_;                            ///> in the order they became ready.
+        std::set<std::string> queued_;                              ///> the names in ready_.
+
+        void scan();
+        void queue( const std::string& name );
+        void drain_events();
+};
+
+#endif
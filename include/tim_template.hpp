@@ -0,0 +1,112 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_TIM_TEMPLATE_HPP
+#define ACM_TIM_TEMPLATE_HPP
+
+#include "MessageFrame.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The decoded structures of the TIMs an encoder sees again and again with only a few fields changed.
+ *
+ * The ODE deposits TIMs made from a few templates that differ only in their msgCnt, timeStamp, packetID, and the
+ * startTime and duratonTime of each TravelerDataFrame. The key of a TIM is its MessageFrame XER with the text of those
+ * elements removed; the first TIM of a key is XER decoded and its structure kept, and every later TIM with the key gets
+ * that structure with the varying members set from its own text, so it is encoded without being XER decoded. Each
+ * context has its own templates; the least recently used one is forgotten when a new one would pass the capacity.
+ */
+class TimTemplates {
+
+    public:
+
+        explicit TimTemplates( std::size_t capacity = 16 );
+        ~TimTemplates();
+
+        TimTemplates( const TimTemplates& ) = delete;
+        TimTemplates& operator=( const TimTemplates& ) = delete;
+
+        /**
+         * @brief Split the XER of a MessageFrame into its key and the text of its varying fields; false, and nothing
+         * is looked up, when it is not a TravelerInformation.
+         */
+        bool split( const char* xer, std::size_t length );
+
+        /**
+         * @brief The structure of the last split's template with its varying members patched; nullptr when the key has
+         * no template or a value does not fit its structure. The structure still belongs to the templates.
+         */
+        MessageFrame_t* find();
+
+        /**
+         * @brief Keep frame, the decoded XER of the last split, as the template of its key, in place of any it had.
+         * The templates own frame, which must have been allocated with the C library allocator.
+         */
+        void insert( MessageFrame_t* frame );
+
+        std::size_t size() const;
+        uint64_t hits() const;
+        uint64_t misses() const;
+
+        /**
+         * @brief Forget every template.
+         */
+        void clear();
+
+    private:
+
+        enum class Field { MSG_CNT, TIME_STAMP, PACKET_ID, START_TIME, DURATION_TIME };
+
+        struct Value {
+            Field field;
+            const char* text;                                           ///> in the split XER.
+            std::size_t length;
+        };
+
+        struct Template {
+            std::string key;
+            MessageFrame_t* frame;
+            uint64_t used;                                              ///> the lookup that last used it.
+        };
+
+        std::size_t capacity_;
+        std::vector<Template> templates_;
+        uint64_t lookups_;
+        uint64_t hits_;
+        uint64_t misses_;
+
+        std::string key_;                                               ///> of the last split.
+        std::vector<Value> values_;                                     ///> of the last split, in document order.
+        std::vector<uint8_t> bytes_;                                    ///> a decoded packetID.
+
+        /**
+         * @brief Set the varying members of frame from the values of the last split; false when they do not fit it.
+         */
+        bool patch( MessageFrame_t& frame );
+};
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_TRAJECTORY_AGGREGATOR_HPP
+#define ACM_TRAJECTORY_AGGREGATOR_HPP
+
+#include "bsm_filter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Accumulates the positions of each vehicle's BSMs, by its temporary id, over fixed windows of the system clock, and
+ * gives one trajectory summary per vehicle per window: its polyline, its least and greatest speed, and its BSM count.
+ *
+ * A vehicle's track ends when its window does: collect() takes the tracks of the windows that have ended, and a BSM of
+ * a new window ends the vehicle's previous track at once. A polyline has at most max_points points; a track that
+ * reaches it keeps every other point and then takes every other BSM, so the points always span the whole window. The
+ * vehicles are split into shards with a lock each, so one aggregator serves every context; a vehicle that would pass
+ * the capacity is not tracked.
+ *
+ * As a filter it gives every BSM the same verdict: PASS to produce the BSM responses as usual, or DROP when only the
+ * summaries are wanted.
+ */
+class TrajectoryAggregator : public BsmFilter {
+
+    public:
+
+        struct Point {
+            int32_t lat;
+            int32_t lon;
+            uint16_t sec_mark;
+        };
+
+        struct Summary {
+            uint32_t id;                                                ///> the TemporaryID, its first byte highest.
+            uint64_t window_start;                                      ///> the milliseconds since the epoch.
+            uint64_t window_end;
+            uint64_t count;                                             ///> the BSMs of the window.
+            uint16_t min_speed;                                         ///> 8191, unavailable, when no BSM had a speed.
+            uint16_t max_speed;
+            std::vector<Point> points;
+        };
+
+        /**
+         * @brief Aggregate over windows of window_ms; capacity is the number of vehicles tracked at once.
+         */
+        TrajectoryAggregator( uint32_t window_ms, std::size_t max_points = 256, std::size_t capacity = 65536,
+                Verdict verdict = Verdict::PASS );
+
+        /**
+         * @brief Add bsm at the system clock's time.
+         */
+        Verdict test( const bsm_fast_path::Bsm& bsm ) override;
+
+        /**
+         * @brief Add bsm at now_ms, the milliseconds since the epoch.
+         */
+        Verdict test( const bsm_fast_path::Bsm& bsm, uint64_t now_ms );
+
+        /**
+         * @brief Move the summaries of the tracks whose window ended by now_ms to the end of summaries;
+         * UINT64_MAX takes every track.
+         *
+         * @return the summaries moved.
+         */
+        std::size_t collect( uint64_t now_ms, std::vector<Summary>& summaries );
+
+        /**
+         * @brief Append the JSON object of summary to json; the id is its key() and the points are [lat, long,
+         * secMark] arrays in the units of a BSM.
+         */
+        static void write_json( const Summary& summary, std::string& json );
+
+        /**
+         * @brief The 8 hex digits of the TemporaryID id: the id of its summaries' JSON and their Kafka key.
+         */
+        static std::string key( uint32_t id );
+
+        uint32_t window() const;
+        std::size_t vehicles() const;                                   ///> tracked now.
+        uint64_t untracked() const;                                     ///> BSMs of vehicles past the capacity.
+
+    private:
+
+        static constexpr std::size_t shard_count = 16;
+
+        struct Track {
+            Summary summary;
+            uint64_t stride;                                            ///> one BSM in stride is a point.
+        };
+
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<uint32_t, Track> tracks;
+            std::vector<Summary> ended;                                 ///> the tracks a later BSM ended.
+        };
+
+        uint64_t window_;
+        std::size_t max_points_;
+        std::size_t shard_capacity_;
+        Verdict verdict_;
+        std::unique_ptr<Shard[]> shards_;
+        std::atomic<uint64_t> untracked_;
+
+        void start( Track& track, uint32_t id, uint64_t window_start );
+        void add( Track& track, const bsm_fast_path::Bsm& bsm );
+};
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_UDP_RECEIVER_HPP
+#define ACM_UDP_RECEIVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+/**
+ * A UDP socket that receives datagrams in batches, e.g., the 1609.2 frames forwarded by RSUs.
+ *
+ * The socket is opened with SO_REUSEPORT, so every worker thread can open its own receiver on the same address and
+ * the kernel spreads the datagrams over them. receive() fills a batch with one recvmmsg call; the datagrams stay in
+ * the receiver's buffers until the next call.
+ */
+class UdpReceiver {
+
+    public:
+
+        struct Datagram {
+            const uint8_t* data;
+            std::size_t length;
+            bool truncated;                                         ///> the datagram was larger than the buffer.
+        };
+
+        /**
+         * @param host the address to bind; empty for every interface.
+         * @param port the UDP port.
+         * @param batch the number of datagrams received at once.
+         * @param max_bytes the buffer size of each datagram; larger datagrams are truncated.
+         */
+        UdpReceiver( const std::string& host, uint16_t port, std::size_t batch, std::size_t max_bytes );
+        ~UdpReceiver();
+
+        UdpReceiver( const UdpReceiver& ) = delete;
+        UdpReceiver& operator=( const UdpReceiver& ) = delete;
+
+        /**
+         * @brief Bind the socket.
+         *
+         * @return false when the address cannot be bound; errno holds the reason.
+         */
+        bool open();
+
+        /**
+         * @brief Wait up to timeout_ms for datagrams and receive up to a batch of them.
+         *
+         * @return the number of datagrams received.
+         */
+        std::size_t receive( int timeout_ms );
+
+        /**
+         * @brief The i-th datagram of the last receive().
+         */
+        Datagram datagram( std::size_t i ) const;
+
+        /**
+         * @brief Split a listen address, [host:]port, into its host and port; an IPv6 host is written in brackets.
+         *
+         * @throws std::invalid_argument when the port is not a number from 1 to 65535.
+         */
+        static void parse_listen( const std::string& listen, std::string& host, uint16_t& port );
+
+    private:
+
+        std::string host_;
+        uint16_t port_;
+        std::size_t max_bytes_;
+        int fd_;
+        std::vector<uint8_t> buffers_;                              ///> batch buffers of max_bytes each.
+        std::vector<struct iovec> iovecs_;
+        std::vector<struct mmsghdr> headers_;
+
+        bool bind_to( int family );
+};
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#ifndef ACM_UNVALIDATED_CERTIFICATE_CACHE_HPP
+#define ACM_UNVALIDATED_CERTIFICATE_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * The signer certificates of the signed 1609.2 frames decoded so far, kept so the key of a certificate is parsed once
+ * and the frames signed with only its digest can be checked. A certificate is known by its HashedId8 (the low 8 bytes
+ * of its SHA-256) and matched by the whole hash, so a frame that carries a certificate finds only that certificate,
+ * never another with the same key or validity. The verifier parses the key of a certificate the first time it is used
+ * and keeps it with the certificate.
+ *
+ * The certificates are unvalidated: they are kept as the frames carry them, and none is checked against its issuer or
+ * a trust anchor. A signature checked with one only shows that the frame was signed with the key its certificate
+ * names.
+ *
+ * Each index is split into shards with a lock each, so one cache serves every context; when a shard is full the
+ * certificate kept longest is forgotten. A certificate is checked against the revocation hook when it is inserted, and
+ * revoke() marks the ones already kept. Its validity period is checked by the caller at the time of each frame.
+ */
+class UnvalidatedCertificateCache {
+
+    public:
+
+        struct Certificate {
+            uint8_t id[8];                                              ///> the HashedId8.
+            uint8_t hash[32];                                           ///> SHA-256 of the COER certificate.
+            uint8_t key[65];                                            ///> the SEC 1 encoded public key.
+            std::size_t key_size;                                       ///> 33 or 65.
+            uint32_t start;                                             ///> the validity period in 1609.2 Time32 seconds.
+            uint32_t end;
+            std::atomic<bool> revoked;
+
+            std::once_flag parse_once;
+            std::shared_ptr<void> parsed;                               ///> the verifier's form of the key; null until it is parsed, or when it cannot be.
+
+            Certificate();
+
+            /**
+             * @brief Predicate indicating whether the certificate is valid at now, in Time32 seconds.
+             */
+            bool current( uint32_t now ) const;
+        };
+
+        using Entry = std::shared_ptr<Certificate>;
+
+        /**
+         * @brief The hook a new certificate is checked with, e.g., against a CRL; true when it is revoked.
+         */
+        using RevocationCheck = std::function<bool( const Certificate& certificate )>;
+
+        /**
+         * @brief Keep capacity certificates, rounded up to a multiple of the shards.
+         */
+        explicit UnvalidatedCertificateCache( std::size_t capacity = 65536 );
+
+        /**
+         * @brief The certificate with HashedId8 id; null when it is not kept.
+         */
+        Entry find( const uint8_t id[8] ) const;
+
+        /**
+         * @brief The certificate with SHA-256 hash; null when it is not kept.
+         */
+        Entry find_hash( const uint8_t hash[32] ) const;
+
+        /**
+         * @brief Keep certificate, marking it revoked when it has been revoked or the hook says so; a
+         * certificate that is already kept is returned instead. A different certificate with the HashedId8 of one
+         * already kept is checked and returned, but not kept.
+         */
+        Entry insert( Entry certificate );
+
+        /**
+         * @brief Revoke the certificate with HashedId8 id, now and when it is inserted again.
+         */
+        void revoke( const uint8_t id[8] );
+
+        /**
+         * @brief Check each certificate inserted from now on with check; an empty function checks nothing.
+         */
+        void set_revocation_check( RevocationCheck check );
+
+        std::size_t size() const;                                       ///> the certificates kept.
+        std::size_t capacity() const;
+
+        /**
+         * @brief The system clock as 1609.2 Time32: seconds since 2004-01-01 00:00:00 UTC, counting the leap seconds
+         * added since.
+         */
+        static uint32_t now();
+
+    private:
+
+        static constexpr std::size_t shard_count = 16;
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::unordered_map<uint64_t, Entry> entries;
+            std::deque<uint64_t> order;                                 ///> the keys by when they were kept; the oldest first.
+        };
+
+        std::size_t shard_capacity_;
+        std::unique_ptr<Shard[]> ids_;                                  ///> by HashedId8.
+
+        mutable std::mutex revoked_mutex_;
+        std::unordered_set<uint64_t> revoked_;
+        RevocationCheck check_;
+
+        static uint64_t id_key( const uint8_t id[8] );
+        static Entry lookup( const Shard* shards, uint64_t key );
+        void keep( Shard* shards, uint64_t key, const Entry& certificate );
+};
+
+#endif
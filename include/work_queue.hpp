@@ -0,0 +1,131 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#ifndef ACM_WORK_QUEUE_HPP
+#define ACM_WORK_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * A bounded, blocking, multi-producer / multi-consumer queue used to hand work to the codec worker threads.
+ *
+ * Producers block when the queue is full, so a slow pool applies backpressure to the Kafka consumer instead of
+ * buffering without bound. Once closed, pushes fail and pops drain the remaining items before failing.
+ */
+template<typename T>
+class WorkQueue {
+
+    public:
+
+        explicit WorkQueue( std::size_t capacity = 256 ) :
+            capacity_{ capacity ? capacity : 1 }
+            , closed_{ false }
+            , items_{}
+        {}
+
+        WorkQueue( const WorkQueue& ) = delete;
+        WorkQueue& operator=( const WorkQueue& ) = delete;
+
+        /**
+         * @brief Change the capacity; only call this when no threads are using the queue.
+         */
+        void set_capacity( std::size_t capacity )
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            capacity_ = capacity ? capacity : 1;
+        }
+
+        /**
+         * @brief Add an item to the queue, waiting for space if the queue is full.
+         *
+         * @return true if the item was queued; false if the queue was closed.
+         */
+        bool push( T item )
+        {
+            std::unique_lock<std::mutex> lock{ mutex_ };
+            not_full_.wait( lock, [this]{ return closed_ || items_.size() < capacity_; } );
+            if ( closed_ ) return false;
+            items_.push_back( std::move( item ) );
+            lock.unlock();
+            not_empty_.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief Remove the item at the front of the queue, waiting for one to arrive.
+         *
+         * @return true if item was assigned; false if the queue is closed and empty.
+         */
+        bool pop( T& item )
+        {
+            std::unique_lock<std::mutex> lock{ mutex_ };
+            not_empty_.wait( lock, [this]{ return closed_ || !items_.empty(); } );
+            if ( items_.empty() ) return false;
+            item = std::move( items_.front() );
+            items_.pop_front();
+            lock.unlock();
+            not_full_.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief Wake all waiting threads; no further items are accepted.
+         */
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                closed_ = true;
+            }
+            not_empty_.notify_all();
+            not_full_.notify_all();
+        }
+
+        /**
+         * @brief Reopen a closed queue so it can be used again, e.g., after the Kafka connections are rebuilt.
+         */
+        void open()
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            closed_ = false;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            return items_.size();
+        }
+
+    private:
+
+        std::size_t capacity_;
+        bool closed_;
+        std::deque<T> items_;
+        mutable std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+};
+
+#endif
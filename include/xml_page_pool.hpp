@@ -0,0 +1,132 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#ifndef ACM_XML_PAGE_POOL_HPP
+#define ACM_XML_PAGE_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A recycling pool for the memory pugixml allocates for the documents of one worker.
+ *
+ * install() points pugixml's allocation functions at the pools. While an XmlPagePool::Scope is active on a thread,
+ * pugixml's pages, xpath blocks, and long strings come from that thread's pool, in size classes carved from large
+ * chunks, and freed blocks go onto a free list of their class to be used by the next message; no global allocator
+ * lock is taken once the pool has grown to the working set of the documents. Outside a scope, and for blocks larger
+ * than the largest class, pugixml uses the C library allocator as it does by default.
+ *
+ * A block of a pool freed on a thread where that pool is not active is pushed onto the pool's remote list without a
+ * lock, and the pool's own thread moves it to its free list when it next runs out of a class, so pugixml never passes
+ * pool memory to free(). Nothing allocated from a pool may be used, or freed, after the pool is destroyed.
+ */
+class XmlPagePool {
+
+    public:
+
+        /**
+         * @brief Make a pool active on the calling thread until the scope ends. A null pool makes the scope do nothing.
+         */
+        class Scope {
+
+            public:
+
+                explicit Scope( XmlPagePool* pool );
+                ~Scope();
+
+                Scope( const Scope& ) = delete;
+                Scope& operator=( const Scope& ) = delete;
+
+            private:
+
+                XmlPagePool* pool_;
+                XmlPagePool* previous_;
+        };
+
+        /**
+         * @brief Construct a pool whose chunks hold at least chunk_size bytes; chunks are allocated when needed.
+         */
+        explicit XmlPagePool( std::size_t chunk_size = 1 << 20 );
+        ~XmlPagePool();
+
+        XmlPagePool( const XmlPagePool& ) = delete;
+        XmlPagePool& operator=( const XmlPagePool& ) = delete;
+
+        /**
+         * @brief A block of at least size bytes; nullptr when size is larger than the largest class or no chunk can
+         * be allocated.
+         */
+        void* allocate( std::size_t size );
+
+        /**
+         * @brief Return a block of this pool to the free list of its class.
+         */
+        void release( void* ptr );
+
+        /**
+         * @brief Return a block of this pool from any thread; it is reused once the pool's thread next allocates.
+         */
+        void release_remote( void* ptr );
+
+        /**
+         * @brief Predicate indicating whether ptr refers to memory in this pool.
+         */
+        bool owns( const void* ptr ) const;
+
+        std::size_t bytes_reserved() const;             ///> bytes held in chunks.
+        std::size_t blocks_recycled() const;            ///> allocations served from a free list.
+
+        /**
+         * @brief The pool that is active on the calling thread or nullptr.
+         */
+        static XmlPagePool* current();
+
+        /**
+         * @brief Set pugixml's allocation functions; only the first call has an effect. It must be made before other
+         * threads use pugixml.
+         */
+        static void install();
+
+    private:
+
+        struct Chunk {
+            char* base;
+            std::size_t size;
+        };
+
+        static constexpr std::size_t class_count = 49;     ///> 64 bytes, then 4 classes per power of two to 256 KiB.
+
+        std::size_t chunk_size_;
+        std::vector<Chunk> chunks_;
+        std::size_t offset_;                            ///> next free byte in the last chunk.
+        void* free_[ class_count ];                     ///> the freed blocks of each class, linked through their first word.
+        std::atomic<void*> remote_;                     ///> the blocks freed on other threads, linked the same way.
+        std::size_t recycled_;
+
+        static std::size_t class_of( std::size_t size );
+        static std::size_t class_size( std::size_t index );
+
+        bool add_chunk( std::size_t minimum );
+};
+
+#endif
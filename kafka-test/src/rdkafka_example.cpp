@@ -38,6 +38,13 @@
 #include <cstdio>
 #include <csignal>
 #include <cstring>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #ifdef _MSC_VER
 #include "../win32/wingetopt.h"
@@ -225,6 +232,272 @@ class ExampleConsumeCb : public RdKafka::ConsumeCb {
 
 
 
+/*
+ * Round-trip performance mode: produce templated requests to the ACM input
+ * topic at a fixed rate, consume the ACM output topic, and time each request
+ * to its response.
+ */
+struct PerfConfig {
+  std::string request_topic;
+  std::string response_topic;
+  std::string templ;            /* the request document; {{id}} is replaced. */
+  std::vector<std::string> corpus; /* request documents used in turn instead. */
+  std::string match = "element:serialNumber";
+  long count = 1000;
+  double rate = 100.0;          /* requests per second; 0 is unpaced. */
+  int wait_ms = 10000;          /* time allowed for the last responses. */
+};
+
+typedef std::chrono::steady_clock perf_clock;
+
+static int64_t perf_now_ns () {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      perf_clock::now().time_since_epoch()).count();
+}
+
+/* Build the request for id from the template, or from the corpus line the id
+ * comes to; without a {{id}} placeholder an element match replaces the text of
+ * the first such element. */
+static std::string perf_request (const PerfConfig &pc, long id) {
+  std::string doc = pc.corpus.empty() ? pc.templ :
+      pc.corpus[static_cast<size_t>(id) % pc.corpus.size()];
+  std::string value = std::to_string(id);
+  bool placed = false;
+
+  for (size_t at = doc.find("{{id}}"); at != std::string::npos;
+       at = doc.find("{{id}}", at + value.size())) {
+    doc.replace(at, 6, value);
+    placed = true;
+  }
+
+  if (!placed && pc.match.compare(0, 8, "element:") == 0) {
+    std::string open = "<" + pc.match.substr(8) + ">";
+    size_t begin = doc.find(open);
+    size_t end = doc.find("</", begin);
+    if (begin != std::string::npos && end != std::string::npos) {
+      begin += open.size();
+      doc.replace(begin, end - begin, value);
+    }
+  }
+  return doc;
+}
+
+/* The id the response carries, or -1 when it has none. */
+static long perf_response_id (const PerfConfig &pc, RdKafka::Message *msg) {
+  std::string value;
+
+  if (pc.match == "key") {
+    if (!msg->key())
+      return -1;
+    value = *msg->key();
+  } else if (pc.match.compare(0, 7, "header:") == 0) {
+    RdKafka::Headers *headers = msg->headers();
+    if (!headers)
+      return -1;
+    RdKafka::Headers::Header header = headers->get_last(pc.match.substr(7));
+    if (header.err() != RdKafka::ERR_NO_ERROR || !header.value())
+      return -1;
+    value.assign(static_cast<const char *>(header.value()), header.value_size());
+  } else {
+    std::string open = "<" + pc.match.substr(8) + ">";
+    const char *payload = static_cast<const char *>(msg->payload());
+    std::string doc(payload, msg->len());
+    size_t begin = doc.find(open);
+    if (begin == std::string::npos)
+      return -1;
+    begin += open.size();
+    value = doc.substr(begin, doc.find('<', begin) - begin);
+  }
+
+  if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+    return -1;
+  return std::strtol(value.c_str(), NULL, 10);
+}
+
+static int64_t perf_percentile (const std::vector<int64_t> &sorted, double q) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static int perf_run (const PerfConfig &pc, RdKafka::Conf *conf,
+                     RdKafka::Conf *tconf) {
+  std::string errstr;
+
+  if (!(pc.match == "key" || pc.match.compare(0, 7, "header:") == 0 ||
+        (pc.match.compare(0, 8, "element:") == 0 && pc.match.size() > 8))) {
+    std::cerr << "% Unknown match (key, header:<name>, element:<name>): " <<
+        pc.match << std::endl;
+    return 1;
+  }
+
+  RdKafka::Producer *producer = RdKafka::Producer::create(conf, errstr);
+  if (!producer) {
+    std::cerr << "Failed to create producer: " << errstr << std::endl;
+    return 1;
+  }
+
+  /* The consumer reads every partition of the response topic from its high
+   * watermark, so nothing produced before the run is counted. */
+  if (conf->set("group.id", "kafka_tool_perf", errstr) != RdKafka::Conf::CONF_OK ||
+      conf->set("enable.auto.commit", "false", errstr) != RdKafka::Conf::CONF_OK) {
+    std::cerr << errstr << std::endl;
+    return 1;
+  }
+
+  RdKafka::KafkaConsumer *consumer = RdKafka::KafkaConsumer::create(conf, errstr);
+  if (!consumer) {
+    std::cerr << "Failed to create consumer: " << errstr << std::endl;
+    return 1;
+  }
+
+  RdKafka::Topic *response_topic = RdKafka::Topic::create(producer,
+                                                          pc.response_topic,
+                                                          tconf, errstr);
+  RdKafka::Metadata *metadata = NULL;
+  if (!response_topic ||
+      producer->metadata(false, response_topic, &metadata, 5000) !=
+      RdKafka::ERR_NO_ERROR || metadata->topics()->empty()) {
+    std::cerr << "% Failed to get the partitions of " << pc.response_topic <<
+        std::endl;
+    return 1;
+  }
+
+  std::vector<RdKafka::TopicPartition *> assignment;
+  const RdKafka::TopicMetadata *topic_metadata = metadata->topics()->front();
+  for (RdKafka::TopicMetadata::PartitionMetadataIterator ip =
+           topic_metadata->partitions()->begin();
+       ip != topic_metadata->partitions()->end(); ++ip) {
+    int64_t low = 0, high = 0;
+    if (producer->query_watermark_offsets(pc.response_topic, (*ip)->id(), &low,
+                                          &high, 5000) != RdKafka::ERR_NO_ERROR) {
+      std::cerr << "% Failed to get the offsets of " << pc.response_topic <<
+          " partition " << (*ip)->id() << std::endl;
+      return 1;
+    }
+    assignment.push_back(RdKafka::TopicPartition::create(pc.response_topic,
+                                                         (*ip)->id(), high));
+  }
+  delete metadata;
+  delete response_topic;
+  consumer->assign(assignment);
+  RdKafka::TopicPartition::destroy(assignment);
+
+  /* Send times by id; 0 is not sent yet. Only the consumer thread touches the
+   * received flags and the latencies. */
+  std::vector<std::atomic<int64_t> > sent_at(pc.count);
+  std::vector<char> received(pc.count, 0);
+  std::vector<int64_t> latencies;
+  latencies.reserve(pc.count);
+  long unmatched = 0, duplicates = 0;
+  std::atomic<bool> producing(true);
+  std::atomic<int64_t> last_sent_ns(0);
+  int64_t last_received_ns = 0;
+
+  std::thread receiver([&]() {
+    while (run) {
+      RdKafka::Message *msg = consumer->consume(100);
+      int64_t now = perf_now_ns();
+
+      if (msg->err() == RdKafka::ERR_NO_ERROR) {
+        long id = perf_response_id(pc, msg);
+        int64_t sent = (id >= 0 && id < pc.count) ?
+            sent_at[id].load(std::memory_order_acquire) : 0;
+        if (sent == 0) {
+          ++unmatched;
+        } else if (received[id]) {
+          ++duplicates;
+        } else {
+          received[id] = 1;
+          latencies.push_back(now - sent);
+          last_received_ns = now;
+        }
+      } else if (msg->err() != RdKafka::ERR__TIMED_OUT &&
+                 msg->err() != RdKafka::ERR__PARTITION_EOF) {
+        std::cerr << "% Consume failed: " << msg->errstr() << std::endl;
+      }
+      delete msg;
+
+      if (static_cast<long>(latencies.size()) == pc.count)
+        break;
+      if (!producing.load() &&
+          now - last_sent_ns.load() > int64_t(pc.wait_ms) * 1000000)
+        break;
+    }
+  });
+
+  RdKafka::Headers *headers = NULL;
+  int64_t start_ns = perf_now_ns();
+
+  for (long id = 0; run && id < pc.count; ++id) {
+    if (pc.rate > 0) {
+      int64_t due = start_ns + static_cast<int64_t>(id * 1e9 / pc.rate);
+      while (perf_now_ns() < due) {
+        producer->poll(0);
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+
+    std::string doc = perf_request(pc, id);
+    std::string key = std::to_string(id);
+    if (pc.match.compare(0, 7, "header:") == 0) {
+      headers = RdKafka::Headers::create();
+      headers->add(pc.match.substr(7), key);
+    }
+
+    sent_at[id].store(perf_now_ns(), std::memory_order_release);
+    RdKafka::ErrorCode resp;
+    while ((resp = producer->produce(pc.request_topic,
+                                     RdKafka::Topic::PARTITION_UA,
+                                     RdKafka::Producer::RK_MSG_COPY,
+                                     const_cast<char *>(doc.data()), doc.size(),
+                                     key.data(), key.size(), 0, headers,
+                                     NULL)) == RdKafka::ERR__QUEUE_FULL)
+      producer->poll(10);
+
+    if (resp != RdKafka::ERR_NO_ERROR) {
+      std::cerr << "% Produce failed: " << RdKafka::err2str(resp) << std::endl;
+      delete headers;
+    }
+    headers = NULL;
+    producer->poll(0);
+  }
+
+  int64_t end_send_ns = perf_now_ns();
+  producer->flush(pc.wait_ms);
+  last_sent_ns = perf_now_ns();
+  producing = false;
+  receiver.join();
+
+  consumer->close();
+  delete consumer;
+  delete producer;
+
+  std::sort(latencies.begin(), latencies.end());
+  long matched = static_cast<long>(latencies.size());
+  double send_s = (end_send_ns - start_ns) / 1e9;
+  double run_s = ((matched ? last_received_ns : end_send_ns) - start_ns) / 1e9;
+
+  std::cerr << "% Sent " << pc.count << " in " << send_s << " s; matched " <<
+      matched << ", lost " << pc.count - matched << ", unmatched " <<
+      unmatched << ", duplicates " << duplicates << std::endl;
+
+  std::cout << "{\"sent\":" << pc.count << ",\"matched\":" << matched <<
+      ",\"lost\":" << pc.count - matched << ",\"unmatched\":" << unmatched <<
+      ",\"duplicates\":" << duplicates <<
+      ",\"offered_rate\":" << (send_s > 0 ? pc.count / send_s : 0) <<
+      ",\"throughput\":" << (run_s > 0 ? matched / run_s : 0) <<
+      ",\"latency_us\":{\"p50\":" << perf_percentile(latencies, 0.50) / 1000 <<
+      ",\"p99\":" << perf_percentile(latencies, 0.99) / 1000 <<
+      ",\"p999\":" << perf_percentile(latencies, 0.999) / 1000 <<
+      ",\"max\":" << (matched ? latencies.back() / 1000 : 0) << "}}" <<
+      std::endl;
+
+  return matched == pc.count ? 0 : 2;
+}
+
+
 int main (int argc, char **argv) {
   std::string brokers = "localhost";
   std::string errstr;
@@ -237,6 +510,7 @@ int main (int argc, char **argv) {
   int opt;
   MyHashPartitionerCb hash_partitioner;
   int use_ccb = 0;
+  PerfConfig perf;
 
   /*
    * Create configuration objects
@@ -245,11 +519,12 @@ int main (int argc, char **argv) {
   RdKafka::Conf *tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
 
 
-  while ((opt = getopt(argc, argv, "PCLt:p:b:z:qd:o:eX:AM:f:")) != -1) {
+  while ((opt = getopt(argc, argv, "PCLRt:T:n:r:m:c:k:w:p:b:z:qd:o:eX:AM:f:")) != -1) {
     switch (opt) {
     case 'P':
     case 'C':
     case 'L':
+    case 'R':
       mode = opt;
       break;
     case 't':
@@ -267,6 +542,52 @@ int main (int argc, char **argv) {
       } else
         partition = std::atoi(optarg);
       break;
+    case 'T':
+      perf.response_topic = optarg;
+      break;
+    case 'n':
+      perf.count = std::atol(optarg);
+      break;
+    case 'r':
+      perf.rate = std::atof(optarg);
+      break;
+    case 'm':
+      {
+        std::ifstream in(optarg);
+        if (!in) {
+          std::cerr << "% Cannot read the template " << optarg << std::endl;
+          exit(1);
+        }
+        std::stringstream templ;
+        templ << in.rdbuf();
+        perf.templ = templ.str();
+        while (!perf.templ.empty() && (perf.templ.back() == '\n' ||
+                                       perf.templ.back() == '\r'))
+          perf.templ.pop_back();
+      }
+      break;
+    case 'c':
+      {
+        std::ifstream in(optarg);
+        if (!in) {
+          std::cerr << "% Cannot read the corpus " << optarg << std::endl;
+          exit(1);
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+          if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+          if (!line.empty())
+            perf.corpus.push_back(line);
+        }
+      }
+      break;
+    case 'k':
+      perf.match = optarg;
+      break;
+    case 'w':
+      perf.wait_ms = std::atoi(optarg);
+      break;
     case 'b':
       brokers = optarg;
       break;
@@ -354,7 +675,7 @@ int main (int argc, char **argv) {
 	  std::string features;
 	  conf->get("builtin.features", features);
     fprintf(stderr,
-            "Usage: %s [-C|-P] -t <topic> "
+            "Usage: %s [-C|-P|-R] -t <topic> "
             "[-p <partition>] [-b <host1:port1,host2:port2,..>]\n"
             "\n"
             "librdkafka version %s (0x%08x, builtin.features \"%s\")\n"
@@ -362,6 +683,7 @@ int main (int argc, char **argv) {
             " Options:\n"
             "  -C | -P         Consumer or Producer mode\n"
             "  -L              Metadata list mode\n"
+            "  -R              Round-trip performance mode\n"
             "  -t <topic>      Topic to fetch / produce\n"
             "  -p <num>        Partition (random partitioner)\n"
             "  -p <func>       Use partitioner:\n"
@@ -388,6 +710,18 @@ int main (int argc, char **argv) {
             "  writes fetched messages to stdout\n"
             " In Producer mode:\n"
             "  reads messages from stdin and sends to broker\n"
+            " In Round-trip mode:\n"
+            "  -T <topic>      Response topic (the -t topic gets the requests)\n"
+            "  -m <file>       Request template; {{id}} is the request id\n"
+            "  -c <file>       Request corpus, one request a line, used\n"
+            "                  in turn instead of a template (acm_corpus -f xml)\n"
+            "  -n <count>      Number of requests (1000)\n"
+            "  -r <rate>       Requests per second, 0 is unpaced (100)\n"
+            "  -k <match>      Where a response carries its id: key,\n"
+            "                  header:<name> or element:<name>\n"
+            "                  (element:serialNumber)\n"
+            "  -w <ms>         Wait for responses after the last request (10000)\n"
+            "  writes a JSON summary with throughput and latency to stdout\n"
             "\n"
             "\n"
             "\n",
@@ -443,7 +777,17 @@ int main (int argc, char **argv) {
   signal(SIGTERM, sigterm);
 
 
-  if (mode == "P") {
+  if (mode == "R") {
+    if (perf.response_topic.empty() || (perf.templ.empty() && perf.corpus.empty()) ||
+        perf.count <= 0)
+      goto usage;
+
+    perf.request_topic = topic_str;
+    int status = perf_run(perf, conf, tconf);
+    RdKafka::wait_destroyed(5000);
+    return status;
+
+  } else if (mode == "P") {
     /*
      * Producer mode
      */
@@ -44,15 +44,29 @@
  */
 
 #include "acm.hpp"
+#include "hex_codec.hpp"
 #include "utilities.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 #include <iomanip>
 
 #include "spdlog/spdlog.h"
 
+#include <cerrno>
+#include <cmath>
 #include <csignal>
+#include <cstring>
+#include <fstream>
 #include <chrono>
 #include <thread>
 #include <cstdio>
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 // for both windows and linux.
 #include <sys/types.h>
@@ -106,64 +120,19 @@ bool dirExists( const std::string& s ) {
     return false;
 }
 
-/**
- *
- * TODO: Consider moving these to the ASN1_Codec class?
- */
-static int dynamic_buffer_append(const void *buffer, size_t size, void *app_key) {
-    buffer_structure_t *xb = static_cast<buffer_structure_t *>(app_key);
-
-    while(xb->buffer_size + size + 1 > xb->allocated_size) {
-        // increase size of buffer.
-        size_t new_size = 2 * (xb->allocated_size ? xb->allocated_size : 64);
-        char *new_buf = static_cast<char *>(MALLOC(new_size));
-        if(!new_buf) return -1;
-        // move old to new.
-        memcpy(new_buf, xb->buffer, xb->buffer_size);
-
-        FREEMEM(xb->buffer);
-        xb->buffer = new_buf;
-        xb->allocated_size = new_size;
-    }
-
-    memcpy(xb->buffer + xb->buffer_size, buffer, size);
-    xb->buffer_size += size;
-    // null terminate the string.
-    xb->buffer[xb->buffer_size] = '\0';
-    return 0;
-}
-
 bool ASN1_Codec::data_available = true;
+bool ASN1_Codec::reload_requested = false;
+bool ASN1_Codec::dump_requested = false;
 bool ASN1_Codec::bootstrap = true;
-
-const char* asn1errortypes[] = {
-    [static_cast<int>(Asn1ErrorType::SUCCESS)] = "SUCCESS",
-    [static_cast<int>(Asn1ErrorType::FAILURE)] = "FAILURE",
-    [static_cast<int>(Asn1ErrorType::REQUEST)] = "INVALID_REQUEST_TYPE_ERROR",
-    [static_cast<int>(Asn1ErrorType::DATA)]    = "INVALID_DATA_TYPE_ERROR"
-};
-
-const char* asn1datatypes[] = {
-    [static_cast<int>(Asn1DataType::ODE)] = "us.dot.its.jpo.ode.model.OdeStatus",
-    [static_cast<int>(Asn1DataType::XML)] = "MessageFrame",
-    [static_cast<int>(Asn1DataType::HEX)] = "us.dot.its.jpo.ode.model.OdeHexByteArray",
-    [static_cast<int>(Asn1DataType::PAYLOAD)] = "us.dot.its.jpo.ode.model.OdeAsn1Payload"
-};
-
-std::ostream& operator<<( std::ostream& os, Asn1ErrorType err ) {
-    os << asn1errortypes[static_cast<int>(err)];
-	return os;
-}
-
-std::ostream& operator<<( std::ostream& os, Asn1DataType dt ) {
-    os << asn1datatypes[static_cast<int>(dt)];
-	return os;
-}
+constexpr std::size_t ASN1_Codec::histogram_stages;
+constexpr std::size_t ASN1_Codec::histogram_types;
+constexpr std::size_t ASN1_Codec::lane_count;
+constexpr std::size_t ASN1_Codec::histogram_count;
 
 ASN1_Codec::ASN1_Codec( const std::string& name, const std::string& description ) :
     Tool{ name, description }
     , exit_eof{true}
-    , eof_cnt{0}
+    , eof_partitions{}
     , partition_cnt{1}
     , msg_recv_count{0}
     , msg_send_count{0}
@@ -171,39 +140,153 @@ ASN1_Codec::ASN1_Codec( const std::string& name, const std::string& description
     , msg_recv_bytes{0}
     , msg_send_bytes{0}
     , msg_filt_bytes{0}
+    , msg_error_count{0}
+    , produce_error_count{0}
+    , stats_interval{10000}
+    , message_latencies{}
+    , metrics_endpoint{}
+    , busy_ns{0}
+    , processing_threads{1}
+    , reporting{false}
+    , report_mutex{}
+    , report_cv{}
+    , report_thread{}
     , iloglevel{ spdlog::level::trace }
     , eloglevel{ spdlog::level::err }
     , pconf{}
     , brokers{"localhost"}
     , partition{RdKafka::Topic::PARTITION_UA}
+    , partitioner{}
     , mode{""}
     , debug{""}
     , consumed_topics{}
+    , output_pool{}
+    , commit_manager{}
+    , delivery_report{ output_pool, commit_manager }
+    , event_report{ ilogger, elogger }
+    , rebalance{ ilogger, elogger }
+    , rebalance_drain_timeout{10000}
+    , kafka_statistics{false}
+    , commit_interval{0}
+    , next_commit{}
+    , produce_retry_count{0}
+    , histogram_interval{0}
+    , next_histogram{}
+    , histograms{}
+    , polling{false}
+    , poll_thread{}
     , offset{RdKafka::Topic::OFFSET_BEGINNING}
     , published_topic_name{}
     , conf{nullptr}
     , tconf{nullptr}
     , consumer_ptr{}
     , consumer_timeout{500}
+    , consume_batch_size{1}
+    , consume_batch_timeout{100}
+    , batch_tuner{}
+    , batch_tune_interval{1000}
+    , next_batch_tune{}
+    , capture{}
+    , capture_frame{}
     , producer_ptr{}
-    , published_topic_ptr{}
-    , input_doc{}
-    , internal_doc{}
-    , error_doc{}
-    , xml_parse_options{ pugi::parse_default | pugi::parse_declaration | pugi::parse_doctype | pugi::parse_trim_pcdata }
-    , ieee1609dot2_unsecuredData_query{"Ieee1609Dot2Data/content//unsecuredData"}  // this will work on both signed and unsigned
-    , ode_payload_query{"OdeAsn1Data/payload/data"}
-    , ode_encodings_query{"OdeAsn1Data/metadata/encodings"}
-    , erroross{}
-    , byte_buffer{}
-	, opsflag{0}
-    , decode_1609dot2{ false }
-    , decode_messageframe{ false }
-	, decode_asdframe{ false }
+    , output_topic_names{}
+    , output_topics{}
+    , routes{}
+    , message_routes{}
+    , shared_worker{0}
+    , priority_topics{}
+    , priority_weight{0}
+    , lane_latencies{}
 	, decode_functionality{ true }
-	, decode_1609dot2_type{ATS_CANONICAL_OER}
-	, decode_messageframe_type{ATS_UNALIGNED_BASIC_PER}
-	, decode_asdframe_type{ATS_UNALIGNED_BASIC_PER}
+    , error_template_file{"./config/Output.error.xml"}
+    , splice_output{true}
+    , slice_input{true}
+    , dom_input{true}
+    , base64_output{false}
+    , scan_envelope{true}
+    , concatenated_pdus{false}
+    , bsm_fast_path{true}
+    , compact_xer{false}
+    , lazy_decode{ false, {} }
+    , projection{}
+    , decode_cache_size{0}
+    , map_cache_size{0}
+    , encode_cache_size{0}
+    , encode_templates{0}
+    , json_output{false}
+    , message_key_fields{0}
+    , binary_input{false}
+    , output_headers{false}
+    , validation_policies{}
+    , input_encodings{"MessageFrame:UPER"}
+    , input_encodings_header{"acm.encodings"}
+    , input_stream{false}
+    , asn1_arena_size{0}
+    , message_budget{ 0, 0, 0, 0 }
+    , xml_pool_size{1048576}
+    , batch_framing{BatchInput::Framing::LINES}
+    , spool_dir{}
+    , spool_output_dir{}
+    , spool_done_dir{}
+    , udp_listen{}
+    , udp_encodings{"Ieee1609Dot2Data:COER,MessageFrame:UPER"}
+    , udp_batch{64}
+    , udp_max_bytes{4096}
+    , shm_input{}
+    , shm_output{}
+    , shm_bytes{16777216}
+    , worker_threads{1}
+    , worker_queue_size{256}
+    , codecs{}
+    , geofence{}
+    , geofence_filter{}
+    , geofence_topic{0}
+    , deduplicator{}
+    , rate_limiter{}
+    , error_breaker{}
+    , next_error_summary{}
+    , diagnostics_file{}
+    , slow_messages{}
+    , codec_reports{}
+    , diagnostics_mutex{}
+    , diagnostics_pending{false}
+    , diagnostics_due{}
+    , spat_delta{false}
+    , spat_snapshot_seconds{10}
+    , verifier{}
+    , verify_drop{false}
+    , workers{}
+    , work_queues{}
+    , worker_backlog{}
+    , memory_budget{}
+    , memory_reported{}
+    , batch_bytes{0}
+    , produce_threads{0}
+    , produce_wait_ms{60000}
+    , producers{}
+    , produce_queues{}
+    , quarantine_topic_name{}
+    , quarantine_topic{0}
+    , reprocess{false}
+    , quarantiner{}
+    , quarantine_queue{}
+    , msg_quarantine_count{0}
+    , trajectories{}
+    , trajectory_topic{0}
+    , summarizing{false}
+    , trajectory_mutex{}
+    , trajectory_cv{}
+    , trajectory_thread{}
+    , msg_trajectory_count{0}
+    , metadata_timeout{1000}
+    , warmup_files{}
+    , warmup_rounds{2}
+    , ready_file{}
+    , process_cpus{ cpu_affinity::current_cpus() }
+    , kafka_cpus{}
+    , consumer_cpus{}
+    , worker_cpus{}
+    , producer_cpus{}
     , ilogger{}
     , elogger{}
 {
@@ -211,6 +294,8 @@ ASN1_Codec::ASN1_Codec( const std::string& name, const std::string& description
 
 ASN1_Codec::~ASN1_Codec() 
 {
+    stop_polling();
+
     if (consumer_ptr) {
         consumer_ptr->close();
     }
@@ -223,22 +308,19 @@ ASN1_Codec::~ASN1_Codec()
     RdKafka::wait_destroyed(5000);    // pause to let RdKafka reclaim resources.
 }
 
-std::string ASN1_Codec::get_current_time() const {
-	char buf[50];
-	std::time_t t = std::time(NULL);
-
-	if ( std::strftime(buf, sizeof(buf), "%Y-%m-%dT%TZ[UTC]", std::gmtime(&t) ) ) {
-		return std::string{ buf };
-	}
-
-	return std::string{};
-}
-
 void ASN1_Codec::sigterm (int sig) {
     data_available = false;
     bootstrap = false;
 }
 
+void ASN1_Codec::sighup (int sig) {
+    reload_requested = true;
+}
+
+void ASN1_Codec::sigusr1 (int sig) {
+    dump_requested = true;
+}
+
 void ASN1_Codec::metadata_print (const std::string &topic, const RdKafka::Metadata *metadata) {
 
     std::cout << "Metadata for " << (topic.empty() ? "" : "all topics")
@@ -290,30 +372,36 @@ void ASN1_Codec::metadata_print (const std::string &topic, const RdKafka::Metada
     }
 }
 
-bool ASN1_Codec::topic_available( const std::string& topic ) {
-    bool r = false;
+bool ASN1_Codec::topics_available( std::vector<std::string>& waiting ) {
 
     RdKafka::Metadata* md;
-    RdKafka::ErrorCode err = consumer_ptr->metadata( true, nullptr, &md, 5000 );
+    // one request for the metadata of all topics answers for every topic we are waiting on.
+    RdKafka::ErrorCode err = consumer_ptr->metadata( true, nullptr, &md, metadata_timeout );
     // TODO: Will throw a broker transport error (ERR__TRANSPORT = -195) if the broker is not available.
 
     if ( err == RdKafka::ERR_NO_ERROR ) {
-        RdKafka::Metadata::TopicMetadataIterator it = md->topics()->begin();
+        std::unordered_set<std::string> found;
+        for ( auto it = md->topics()->begin(); it != md->topics()->end(); ++it ) {
+            found.insert( (*it)->topic() );
+        }
+        delete md;
 
-        // search for the raw BSM topic.
-        while ( it != md->topics()->end() && !r ) {
-            // finish when we find it.
-            r = ( (*it)->topic() == topic );
-            if ( r ) ilogger->info( "Topic: {} found in the kafka metadata.", topic );
-            ++it;
+        auto it = waiting.begin();
+        while ( it != waiting.end() ) {
+            if ( found.count( *it ) ) {
+                ilogger->info( "Topic: {} found in the kafka metadata.", *it );
+                it = waiting.erase( it );
+            } else {
+                ilogger->warn( "Metadata did not contain topic: {}.", *it );
+                ++it;
+            }
         }
-        if (!r) ilogger->warn( "Metadata did not contain topic: {}.", topic );
 
     } else {
         elogger->error( "cannot retrieve consumer metadata with error: {}.", err2str(err) );
     }
     
-    return r;
+    return waiting.empty();
 }
 
 void ASN1_Codec::print_configuration() const
@@ -365,46 +453,35 @@ bool ASN1_Codec::configure() {
 
     const std::string& cfile = optString('c');              // needed for error message.
     ilogger->trace("{}: using configuration file: {}", fnname , cfile );
-    std::ifstream ifs{ cfile };
+    std::vector<std::pair<std::string, std::string>> settings;
 
-    if (!ifs) {
+    if ( !read_settings( cfile, settings ) ) {
         std::cout << fnname << ": cannot open configuration file: " << cfile << '\n';
         elogger->error("{}: cannot open configuration file: {}", fnname , cfile);
         return false;
     }
 
-    while (std::getline( ifs, line )) {
-        line = string_utilities::strip( line );
-        if ( !line.empty() && line[0] != '#' ) {
-            pieces = string_utilities::split( line, '=' );
-            bool done = false;
-            if (pieces.size() == 2) {
-                // in case the user inserted some spaces...
-                string_utilities::strip( pieces[0] );
-                string_utilities::strip( pieces[1] );
-                // some of these configurations are stored in each...?? strange.
-                if ( tconf->set(pieces[0], pieces[1], error_string) == RdKafka::Conf::CONF_OK ) {
-                    ilogger->info("{}: kafka topic configuration: {} = {}", fnname , pieces[0], pieces[1]);
-                    done = true;
-                }
-
-                if ( conf->set(pieces[0], pieces[1], error_string) == RdKafka::Conf::CONF_OK ) {
-                    ilogger->info("{}: kafka configuration: {} = {}", fnname , pieces[0], pieces[1]);
-                    done = true;
-                }
+    for ( const auto& setting : settings ) {
+        bool done = false;
+        // some of these configurations are stored in each...?? strange.
+        if ( tconf->set(setting.first, setting.second, error_string) == RdKafka::Conf::CONF_OK ) {
+            ilogger->info("{}: kafka topic configuration: {} = {}", fnname , setting.first, setting.second);
+            done = true;
+        }
 
-                if ( !done ) { 
-                    ilogger->info("{}: ASN1_Codec configuration: {} = {}", fnname , pieces[0], pieces[1]);
-                    // These configuration options are not expected by Kafka.
-                    // Assume there are for the ASN1_Codec.
-                    pconf[ pieces[0] ] = pieces[1];
-                }
+        if ( conf->set(setting.first, setting.second, error_string) == RdKafka::Conf::CONF_OK ) {
+            ilogger->info("{}: kafka configuration: {} = {}", fnname , setting.first, setting.second);
+            done = true;
+        }
 
-            } else {
-                elogger->warn("{}: too many pieces in the configuration file line: {}", fnname , line);
-            }
+        if ( !done ) { 
+            ilogger->info("{}: ASN1_Codec configuration: {} = {}", fnname , setting.first, setting.second);
+            // These configuration options are not expected by Kafka.
+            // Assume there are for the ASN1_Codec.
+            pconf[ setting.first ] = setting.second;
+        }
 
-        } // otherwise: empty or comment line.
+        file_settings[ setting.first ] = setting.second;
     }
 
     // All configuration file settings are overridden, if supplied, by CLI options. Those occur here.
@@ -442,19 +519,11 @@ bool ASN1_Codec::configure() {
         }
     } // else it is already set to default.
 
-    std::string errorfile{"./config/Output.error.xml"};
-
     search = pconf.find("acm.error.template");
     if ( search != pconf.end() ) {
-        errorfile = search->second;
+        error_template_file = search->second;
     }  
 
-    pugi::xml_parse_result result = error_doc.load_file( errorfile.c_str() );
-    if (!result) {
-        elogger->error("{}: Failure to find or parse the error template file: {} (offset = {})!", fnname , result.description(), result.offset);
-        return false;
-    } 
-
     if ( optIsSet('b') ) {
         // broker specified.
         ilogger->info("{}: setting kafka broker to: {}", fnname , optString('b'));
@@ -474,6 +543,38 @@ bool ASN1_Codec::configure() {
 
     ilogger->info("{}: kafka partition: {}", fnname , partition);
 
+    // acm.produce.match.partition is the input strategy.
+    OutputPartitioner::Strategy strategy = OutputPartitioner::Strategy::FIXED;
+
+    auto match_search = pconf.find("acm.produce.match.partition");
+    if ( match_search != pconf.end() && match_search->second == "true" ) {
+        strategy = OutputPartitioner::Strategy::INPUT;
+    }
+
+    match_search = pconf.find("acm.produce.partitioner");
+    if ( match_search != pconf.end() ) {
+        try {
+            strategy = OutputPartitioner::parse( match_search->second );
+        } catch ( std::invalid_argument& e ) {
+            elogger->error("{}: {}", fnname, e.what() );
+            return false;
+        }
+    }
+
+    uint32_t sticky_batch = 1000;
+    match_search = pconf.find("acm.produce.sticky.messages");
+    if ( match_search != pconf.end() ) {
+        try {
+            int n = std::stoi( match_search->second );
+            if ( n > 0 ) sticky_batch = static_cast<uint32_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default sticky batch.", fnname );
+        }
+    }
+
+    partitioner.reset( new OutputPartitioner{ strategy, partition, sticky_batch } );
+    ilogger->info("{}: output partitioner: {}", fnname , OutputPartitioner::name( strategy ));
+
     if ( getOption('g').isSet() && conf->set("group.id", optString('g'), error_string) != RdKafka::Conf::CONF_OK) {
         // NOTE: there are some checks in librdkafka that require this to be present and set.
         elogger->error("{}: kafka error setting configuration parameters group.id h: {}", fnname , error_string);
@@ -536,6 +637,21 @@ bool ASN1_Codec::configure() {
 
     ilogger->info("{}: published topic: {}", fnname , published_topic_name);
 
+    output_topic_names.clear();
+    output_topic( published_topic_name );
+
+    if ( !configure_routes() ) {
+        return false;
+    }
+
+    if ( !configure_priority() ) {
+        return false;
+    }
+
+    if ( !configure_quarantine() ) {
+        return false;
+    }
+
     search = pconf.find("asn1.consumer.timeout.ms");
     if ( search != pconf.end() ) {
         try {
@@ -545,1242 +661,3766 @@ bool ASN1_Codec::configure() {
         }
     }
 
-    ilogger->trace("{}: finished.", fnname );
-    return true;
-}
-
-bool ASN1_Codec::launch_producer()
-{
-    std::string error_string;
-
-    producer_ptr = std::shared_ptr<RdKafka::Producer>( RdKafka::Producer::create(conf, error_string) );
-    if ( !producer_ptr ) {
-        elogger->critical("Failed to create producer with error: {}.", error_string );
-        return false;
+    search = pconf.find("acm.commit.interval.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) commit_interval = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the Kafka automatic offset commits.", fnname );
+        }
     }
 
-    published_topic_ptr = std::shared_ptr<RdKafka::Topic>( RdKafka::Topic::create(producer_ptr.get(), published_topic_name, tconf, error_string) );
-    if ( !published_topic_ptr ) {
-        elogger->critical("Failed to create topic: {}. Error: {}.", published_topic_name, error_string );
-        return false;
-    } 
+    if ( commit_interval > 0 ) {
+        // only the offsets of delivered responses are committed.
+        std::string error_string;
+        if ( conf->set("enable.auto.commit", "false", error_string) != RdKafka::Conf::CONF_OK ) {
+            elogger->error("{}: cannot disable the Kafka automatic offset commits: {}", fnname , error_string);
+            return false;
+        }
+    }
 
-    ilogger->info("Producer: {} created using topic: {}.", producer_ptr->name(), published_topic_name);
-    return true;
-}
+    ilogger->info("{}: offset commit interval: {} ms", fnname , commit_interval);
 
-bool ASN1_Codec::launch_consumer()
-{
-    std::string error_string;
+    search = pconf.find("acm.rebalance.drain.timeout.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) rebalance_drain_timeout = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default rebalance drain timeout.", fnname );
+        }
+    }
 
-    consumer_ptr = std::shared_ptr<RdKafka::KafkaConsumer>( RdKafka::KafkaConsumer::create(conf, error_string) );
-    if (!consumer_ptr) {
-        elogger->critical("Failed to create consumer with error: {}",  error_string );
-        return false;
+    // revoked partitions finish their consumed work before they are given up; with the cooperative-sticky assignor
+    // only the partitions that move are revoked.
+    rebalance.set_drain( [this]( const std::vector<RdKafka::TopicPartition*>& partitions ) { drain_partitions( partitions ); } );
+    {
+        std::string error_string;
+        if ( conf->set("rebalance_cb", &rebalance, error_string) != RdKafka::Conf::CONF_OK ) {
+            elogger->error("{}: cannot set the consumer rebalance callback: {}", fnname , error_string);
+            return false;
+        }
     }
 
-    // wait on the topics we specified to become available for subscription.
-    // loop terminates with a signal (CTRL-C) or when all the topics are available.
-    int tcount = 0;
-    for ( auto& topic : consumed_topics ) {
-        while ( data_available && tcount < consumed_topics.size() ) {
-            if ( topic_available(topic) ) {
-                ilogger->trace("Consumer topic: {} is available.", topic);
-                // count it and attempt to get the next one if it exists.
-                ++tcount;
-                break;
-            }
-            // topic is not available, wait for a second or two.
-            std::this_thread::sleep_for( std::chrono::milliseconds( 1500 ) );
-            ilogger->trace("Waiting for needed consumer topic: {}.", topic);
+    ilogger->info("{}: rebalance drain timeout: {} ms", fnname , rebalance_drain_timeout);
+
+    // the consumer and producer statistics reports are merged into the ACM metrics.
+    std::string statistics_interval;
+    if ( conf->get("statistics.interval.ms", statistics_interval) == RdKafka::Conf::CONF_OK ) {
+        try {
+            kafka_statistics = std::stoi( statistics_interval ) > 0;
+        } catch( std::exception& e ) {
+            kafka_statistics = false;
         }
     }
 
-    if ( tcount == consumed_topics.size() ) {
-        // all the needed topics are available for subscription.
-        RdKafka::ErrorCode status = consumer_ptr->subscribe(consumed_topics);
-        if (status) {
-            elogger->critical("Failed to subscribe to {} topics. Error: {}.", consumed_topics.size(), RdKafka::err2str(status) );
+    if ( kafka_statistics ) {
+        std::string error_string;
+        if ( conf->set("event_cb", &event_report, error_string) != RdKafka::Conf::CONF_OK ) {
+            elogger->error("{}: cannot set the Kafka event callback: {}", fnname , error_string);
             return false;
         }
-    } else {
-        ilogger->warn("User cancelled ASN1_Codec while waiting for topics to become available.");
-        return false;
+
+        ilogger->info("{}: kafka statistics interval: {} ms", fnname , statistics_interval);
     }
 
-    std::ostringstream osbuf{};
-    for ( auto& topic : consumed_topics ) {
-        if ( osbuf.tellp() != 0 ) osbuf << ", ";
-        osbuf << topic;
+    search = pconf.find("acm.histogram.interval.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) histogram_interval = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: latency histograms are disabled.", fnname );
+        }
     }
 
-    ilogger->info("Consumer: {} created using topics: {}.", consumer_ptr->name(), osbuf.str());
-    return true;
-}
+    if ( histogram_interval > 0 ) {
+        histograms.reset( new LatencyHistogram[ histogram_count ] );
+        next_histogram = std::chrono::steady_clock::now() + std::chrono::milliseconds( histogram_interval );
+    } else {
+        histograms.reset();
+    }
 
-bool ASN1_Codec::make_loggers( bool remove_files )
-{
-    // defaults.
-    std::string path{ "logs/" };
-    std::string ilogname{ "log.info" };
-    std::string elogname{ "log.error" };
+    ilogger->info("{}: latency histogram interval: {} ms", fnname , histogram_interval);
 
-    if (getOption('D').hasArg()) {
-        // replace default
-        path = getOption('D').argument();
-        if ( path.back() != '/' ) {
-            path += '/';
+    search = pconf.find("acm.batch.autotune.p99.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int target = std::stoi( search->second );
+            BatchTuner::Settings max{ 1000, 100 };
+
+            search = pconf.find("acm.batch.autotune.max.size");
+            if ( search != pconf.end() ) max.batch_size = std::max( std::stoi( search->second ), 1 );
+
+            search = pconf.find("acm.batch.autotune.max.timeout.ms");
+            if ( search != pconf.end() ) max.batch_timeout = std::max( std::stoi( search->second ), 0 );
+
+            search = pconf.find("acm.batch.autotune.interval.ms");
+            if ( search != pconf.end() ) batch_tune_interval = std::max( std::stoi( search->second ), 1 );
+
+            if ( target > 0 ) {
+                batch_tuner.reset( new BatchTuner{ static_cast<uint64_t>( target ) * 1000000, max } );
+                next_batch_tune = std::chrono::steady_clock::now() + std::chrono::milliseconds( batch_tune_interval );
+                ilogger->info("{}: consume batches tuned for p99 {} ms every {} ms; at most {} messages and {} ms", fnname, target, batch_tune_interval, max.batch_size, max.batch_timeout );
+            }
+        } catch( std::exception& e ) {
+            elogger->error("{}: the batch autotune settings must be integers; batches are not tuned.", fnname );
         }
     }
 
-    // if the directory specified doesn't exist, then make it.
-    if (!dirExists( path )) {
-#ifndef _MSC_VER
-        if (mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH ) != 0)   // linux
-#elif _MSC_VER 
-        if (_mkdir(path.c_str()) != 0)                                          // windows
-#else
-                                                                                // some other strange os...
-#endif
-        {
-            std::cerr << "Error making the logging directory.\n";
-            return false;
+    search = pconf.find("acm.stats.interval.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) stats_interval = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default statistics interval.", fnname );
         }
     }
-    
-    // ilog check for user-defined file locations and names.
-    if (getOption('i').hasArg()) {
-        // replace default.
-        ilogname = string_utilities::basename<std::string>( getOption('i').argument() );
-    }
 
-    if (getOption('e').hasArg()) {
-        // replace default.
-        elogname = string_utilities::basename<std::string>( getOption('e').argument() );
+    ilogger->info("{}: statistics interval: {} ms", fnname , stats_interval);
+
+    search = pconf.find("acm.stats.latency");
+    if ( stats_interval > 0 && search != pconf.end() && search->second == "true" ) {
+        message_latencies.reset( new MessageLatencies{} );
+        ilogger->info("{}: reporting the latencies of each partition.", fnname );
+    } else {
+        message_latencies.reset();
     }
-    
-    ilogname = path + ilogname;
-    elogname = path + elogname;
+    delivery_report.track_latencies( message_latencies.get() );
 
-    if ( remove_files && fileExists( ilogname ) ) {
-        if ( std::remove( ilogname.c_str() ) != 0 ) {
-            std::cerr << "Error removing the previous information log file.\n";
-            return false;
+    search = pconf.find("acm.metrics.listen");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        if ( stats_interval <= 0 ) {
+            elogger->error("{}: the metrics endpoint is refreshed by the statistics reports; set acm.stats.interval.ms.", fnname );
+        } else {
+            std::string host;
+            uint16_t port;
+            // throws for an address that is not [host:]port.
+            UdpReceiver::parse_listen( search->second, host, port );
+
+            metrics_endpoint.reset( new MetricsEndpoint{ host, port } );
+            if ( !metrics_endpoint->open() ) {
+                elogger->critical("{}: cannot listen for metrics on {}: {}", fnname, search->second, std::strerror( errno ));
+                return false;
+            }
+            ilogger->info("{}: serving the scaling metrics on {}/metrics every {} ms", fnname, search->second, stats_interval );
         }
     }
 
-    if ( remove_files && fileExists( elogname ) ) {
-        if ( std::remove( elogname.c_str() ) != 0 ) {
-            std::cerr << "Error removing the previous error log file.\n";
+    if ( !configure_reloadable() ) {
+        return false;
+    }
+
+    search = pconf.find("acm.decode.splice");
+    if ( search != pconf.end() ) {
+        splice_output = ( search->second != "false" );
+    }
+
+    search = pconf.find("acm.decode.scan");
+    if ( search != pconf.end() ) {
+        scan_envelope = ( search->second != "false" );
+    }
+
+    search = pconf.find("acm.decode.projection");
+    if ( search != pconf.end() ) {
+        try {
+            Asn1Projection check{ search->second };
+            projection = search->second;
+            ilogger->info("{}: MessageFrame projection: {} paths", fnname, check.size() );
+        } catch ( std::invalid_argument& e ) {
+            elogger->error("{}: acm.decode.projection: {}", fnname, e.what() );
             return false;
         }
     }
 
-    // setup information logger.
-    ilogger = spdlog::rotating_logger_mt("ilog", ilogname, ilogsize, ilognum);
-    ilogger->set_pattern("[%C%m%d %H:%M:%S.%f] [%l] %v");
-    ilogger->set_level( iloglevel );
+    search = pconf.find("acm.decode.concatenated");
+    if ( search != pconf.end() ) {
+        concatenated_pdus = ( search->second == "true" );
+    }
 
-    // setup error logger.
-    elogger = spdlog::rotating_logger_mt("elog", elogname, elogsize, elognum);
-    elogger->set_level( iloglevel );
-    elogger->set_pattern("[%C%m%d %H:%M:%S.%f] [%l] %v");
-    return true;
-}
+    search = pconf.find("acm.decode.bsm.fast");
+    if ( search != pconf.end() ) {
+        bsm_fast_path = ( search->second != "false" );
+    }
 
-    /**
-     * Update the error information in the doc provided. The doc will have to conform to the schema below or this method
-     * will not do anything.
-     *
-     *
-     *
-     *
-     *
-     * Modify the following parts:
-     *      <?xml version="1.0"?>
-     *      <OdeAsn1Data>
-     *        <metadata>
-     *          <payloadType>us.dot.its.jpo.ode.model.OdeAsn1Payload</payloadType>
-     *          <serialId>
-     *            <streamId></streamId>
-     *            <bundleSize></bundleSize>
-     *            <bundleId></bundleId>
-     *            <recordId></recordId>
-     *            <serialNumber></serialNumber>
-     *          </serialId>
-     * >>>         <receivedAt>[TIMESTAMP]</receivedAt>
-     *          <schemaVersion>2</schemaVersion>
-     * >>>         <generatedAt>[TIMESTAMP]</generatedAt>
-     *          <logFileName></logFileName>
-     *          <validSignature></validSignature>
-     *          <sanitized></sanitized>
-     *          <encodings>
-     *          </encodings>
-     *        </metadata>
-     *        <payload>
-     * >>>         <dataType>us.dot.its.jpo.ode.model.OdeStatus</dataType>
-     *          <data>
-     * >>>             <code></code>
-     * >>>             <message></message>
-     *          </data>
-     *        </payload>
-     *      </OdeAsn1Data>
-     *
-     *
-     * doc:
-     * dt:
-     * et:
-     * message: this string will be COPIED INTO the xml dom by pugixml.
-     */
-
-bool ASN1_Codec::add_error_xml( pugi::xml_document& doc, Asn1DataType dt, Asn1ErrorType et, std::string message, bool update_time ) {
-
-	static const char* fnname = "add_error_xml()";
-	bool r = true;
-
-	// Attempt to set all these fields; log the errors; return false if any fail.
-
-	// access this directly because we remove the bytes branch.
-	pugi::xml_node metadata_node = doc.child("OdeAsn1Data").child("metadata");
-	if ( !metadata_node ) {
-		//elogger->error("{}: Cannot find OdeAsn1Data/metadata nodes in function input document.", fnname );
-		return false;
-	}
-
-	pugi::xml_node payload_node  = doc.child("OdeAsn1Data").child("payload");
-	if ( !payload_node ) {
-		//elogger->error("{}: Cannot find OdeAsn1Data/payload nodes in function input document.", fnname );
-		return false;
-	}
-
-	if ( !metadata_node.child("payloadType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::PAYLOAD)]  ) ) {
-		//elogger->error("{}: Failure to update the payloadType field of the error xml", fnname );
-		r = false;
-	}
-
-	// receivedAt is only updatable if update_time is true.
-	if ( update_time && !metadata_node.child("receivedAt").text().set( get_current_time().c_str() ) ) {
-		//elogger->error("{}: Failure to update the receivedAt field of the error xml", fnname );
-		r = false;
-	}
-
-	// generateAt time is always updated; it is the time of generating this message.
-	if ( !metadata_node.child("generatedAt").text().set( get_current_time().c_str() ) ) {
-		//elogger->error("{}: Failure to update the generatedAt field of the error xml", fnname );
-		r = false;
-	}
-
-	if ( !payload_node.child("dataType").text().set( asn1datatypes[static_cast<int>(dt)]  ) ) {
-		//elogger->error("{}: Failure to update the dataType field of the error xml", fnname );
-		r = false;
-	}
-
-	pugi::xml_node data_node = payload_node.child("data");
-
-	// when bytes doesn't exist this is effectively a noop.
-	bool result = data_node.remove_child("bytes");
-
-	if ( !data_node.child("code") ) {
-		data_node.append_child("code");
-	}
-
-	if ( !data_node.child("message") ) {
-		data_node.append_child("message");
-	}
-
-	if ( !data_node.child("code").text().set( asn1errortypes[static_cast<int>(et)]  ) ) {
-		//elogger->error("{}: Failure to update the data/code field of the error xml", fnname );
-		r = false;
-	}
-
-	if ( !data_node.child("message").text().set( message.c_str() ) ) {
-		//elogger->error("{}: Failure to update the data/message field of the error xml", fnname );
-		r = false;
-	}
-
-	return r;
-}
-
-bool ASN1_Codec::hex_to_bytes_(const std::string& payload_hex, std::vector<char>& buf) {
-    uint8_t d = 0;
-    int i = 0;          // so we can return -1;
-
-    for (const char& c : payload_hex) {
-        if ( c <= '9' && c >= '0' ) {
-            d = c-'0';
-        } else if ( c <= 'F' && c >= 'A' ) {
-            d = c-55;       // c - 'A' + 10
-        } else if ( c <= 'f' && c >= 'a' ) {
-            d = c-87;        // c - 'a' + 10;
-        } else {
+    search = pconf.find("acm.decode.xer.compact");
+    if ( search != pconf.end() ) {
+        compact_xer = ( search->second == "true" );
+        if ( compact_xer ) ilogger->info("{}: decoded MessageFrames are written as compact XER.", fnname );
+    }
+
+    search = pconf.find("acm.decode.lazy");
+    if ( search != pconf.end() ) {
+        try {
+            lazy_decode = LazyDecode::parse( search->second );
+        } catch ( std::invalid_argument& e ) {
+            elogger->error("{}: acm.decode.lazy: {}", fnname, e.what() );
             return false;
         }
+        ilogger->info("{}: IEEE 1609.2 lazy decode: {}", fnname, search->second );
+    }
 
-        if (i%2) {
-            // low order nibble.
-            buf.back() |= d;
+    search = pconf.find("acm.output.format");
+    if ( search != pconf.end() ) {
+        if ( search->second == "json" ) {
+            json_output = true;
+        } else if ( search->second == "xml" ) {
+            json_output = false;
         } else {
-            // high order nibble.
-            buf.push_back( d<<4 );
+            elogger->error("{}: unknown acm.output.format: {}; using xml.", fnname, search->second );
         }
-        ++i;
     }
 
-    // the number of bytes in the buf.
-    return true;
-}
+    search = pconf.find("acm.output.headers");
+    if ( search != pconf.end() ) {
+        output_headers = ( search->second == "true" );
+    }
 
-bool ASN1_Codec::bytes_to_hex_(buffer_structure_t* buf_struct, std::string& hex_vector ) {
-    char c = 0;
+    message_key_fields = 0;
 
-    hex_vector.clear();
-    for ( std::size_t i = 0; i < buf_struct->buffer_size; ++i ) {
+    search = pconf.find("acm.output.key");
+    if ( search != pconf.end() ) {
+        for ( auto& entry : string_utilities::split( search->second ) ) {
+            std::string field = string_utilities::strip( entry );
+            if ( field == "bsm" ) {
+                message_key_fields |= static_cast<uint32_t>( MessageKey::BSM_ID );
+            } else if ( field == "intersection" ) {
+                message_key_fields |= static_cast<uint32_t>( MessageKey::INTERSECTION_ID );
+            } else if ( field == "tim" ) {
+                message_key_fields |= static_cast<uint32_t>( MessageKey::TIM_PACKET_ID );
+            } else if ( field != "none" ) {
+                elogger->error("{}: unknown acm.output.key field: {}", fnname, field );
+                return false;
+            }
+        }
 
-        uint8_t bh = (buf_struct->buffer[i] & 0xF0) >> 4;
+        if ( message_key_fields ) ilogger->info("{}: response keys: {}", fnname, search->second );
+    }
 
-        if ( bh <= 9 && bh >= 0 ) {
-            c = (bh+48); // b + '0'
-        } else if ( bh <= 15 && bh >= 10 ) {
-            c = (bh+55); // b + 'A' - 10;
+    search = pconf.find("acm.input.format");
+    if ( search != pconf.end() ) {
+        if ( search->second == "binary" ) {
+            binary_input = true;
+        } else if ( search->second == "xml" ) {
+            binary_input = false;
         } else {
+            elogger->error("{}: unknown acm.input.format: {}; using xml.", fnname, search->second );
+        }
+    }
+
+    if ( binary_input ) {
+        // with routes, the messages of the encoded topics are still ODE XML.
+        if ( !uses_direction( true ) ) {
+            elogger->error("{}: binary input can only be decoded.", fnname );
             return false;
         }
 
-        hex_vector.push_back(c);
+        search = pconf.find("acm.input.encodings");
+        if ( search != pconf.end() ) {
+            input_encodings = search->second;
+        }
+
+        search = pconf.find("acm.input.encodings.header");
+        if ( search != pconf.end() ) {
+            input_encodings_header = search->second;
+        }
 
-        uint8_t bl = (buf_struct->buffer[i] & 0x0F);
+        search = pconf.find("acm.input.stream");
+        if ( search != pconf.end() ) {
+            input_stream = ( search->second == "true" );
+        }
 
-        if ( bl <= 9 && bl >= 0 ) {
-            c = (bl+48);
-        } else if ( bl <= 15 && bl >= 10 ) {
-            c = (bl+55);
-        } else {
-            return false;
+        if ( input_stream ) {
+            ilogger->info("{}: binary messages are pieces of a PDU stream per partition.", fnname );
         }
 
-        hex_vector.push_back(c);
+        ilogger->info("{}: binary input; encodings: {} unless given by the {} header", fnname, input_encodings, input_encodings_header );
     }
 
-    return true;
+    search = pconf.find("acm.batch.framing");
+    if ( search != pconf.end() ) {
+        // throws for an unknown framing.
+        batch_framing = BatchInput::parse_framing( search->second );
+        ilogger->info("{}: batch mode framing: {}", fnname, search->second );
+    }
+
+    search = pconf.find("acm.spool.dir");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        spool_dir = search->second;
+        spool_done_dir = spool_dir + "/done";
+
+        search = pconf.find("acm.spool.done.dir");
+        if ( search != pconf.end() && !search->second.empty() ) spool_done_dir = search->second;
+
+        search = pconf.find("acm.spool.output.dir");
+        if ( search != pconf.end() ) spool_output_dir = search->second;
+
+        // no offsets are consumed, so there are none to commit.
+        commit_interval = 0;
+
+        ilogger->info("{}: spool directory: {} processed files moved to: {} responses to: {}", fnname, spool_dir, spool_done_dir,
+                spool_output_dir.empty() ? published_topic_name : spool_output_dir );
+    }
+
+    search = pconf.find("acm.udp.listen");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        std::string host;
+        uint16_t port;
+        // throws for an address that is not [host:]port.
+        UdpReceiver::parse_listen( search->second, host, port );
+        udp_listen = search->second;
+
+        search = pconf.find("acm.udp.encodings");
+        if ( search != pconf.end() && !search->second.empty() ) udp_encodings = search->second;
+
+        search = pconf.find("acm.udp.batch");
+        if ( search != pconf.end() ) udp_batch = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.udp.max.bytes");
+        if ( search != pconf.end() ) udp_max_bytes = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        // no offsets are consumed, so there are none to commit.
+        commit_interval = 0;
+
+        ilogger->info("{}: UDP ingest on {}; encodings: {} batch: {} datagrams of at most {} bytes; responses to: {}", fnname,
+                udp_listen, udp_encodings, udp_batch, udp_max_bytes, published_topic_name );
+    }
+
+    search = pconf.find("acm.shm.input");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        shm_input = search->second;
+
+        search = pconf.find("acm.shm.output");
+        if ( search != pconf.end() ) shm_output = search->second;
+
+        search = pconf.find("acm.shm.bytes");
+        if ( search != pconf.end() ) shm_bytes = std::max<std::size_t>( 1, std::stoull( search->second ) );
+
+        // no offsets are consumed, so there are none to commit.
+        commit_interval = 0;
+
+        ilogger->info("{}: shared memory ingest from {}; responses to: {}; rings made with {} bytes", fnname,
+                shm_input, shm_output.empty() ? published_topic_name : shm_output, shm_bytes );
+    }
+
+    search = pconf.find("acm.archive.uri");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        if ( !BsmArchive::available() ) {
+            throw std::invalid_argument{ "acm.archive.uri needs an ACM built with Parquet support (cmake -DACM_PARQUET=ON)." };
+        }
+        archive_settings.uri = search->second;
+
+        search = pconf.find("acm.archive.max.bytes");
+        if ( search != pconf.end() ) archive_settings.max_bytes = std::stoull( search->second );
+
+        search = pconf.find("acm.archive.max.seconds");
+        if ( search != pconf.end() ) archive_settings.max_seconds = std::stoi( search->second );
+
+        search = pconf.find("acm.archive.row.group");
+        if ( search != pconf.end() ) archive_settings.row_group = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.archive.compression");
+        if ( search != pconf.end() ) archive_settings.compression = search->second;
+
+        ilogger->info("{}: BSM archive: {} files of at most {} bytes and {} s; row groups of {} rows; compression: {}", fnname,
+                archive_settings.uri, archive_settings.max_bytes, archive_settings.max_seconds, archive_settings.row_group,
+                archive_settings.compression );
+    }
+
+    geofence.reset();
+    geofence_filter.reset();
+
+    search = pconf.find("acm.geofence.file");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        std::size_t cells = GeofenceIndex::default_cells;
+        auto cells_search = pconf.find("acm.geofence.cells");
+        if ( cells_search != pconf.end() ) cells = std::max<std::size_t>( 1, std::stoul( cells_search->second ) );
+
+        geofence = GeofenceIndex::load( search->second, cells );      // throws std::invalid_argument.
+
+        // without an output for them, the BSMs outside are dropped.
+        BsmFilter::Verdict outside = BsmFilter::Verdict::DROP;
+        search = pconf.find("acm.geofence.outside.topic");
+        if ( search != pconf.end() && !search->second.empty() ) {
+            outside = BsmFilter::Verdict::DIVERT;
+            geofence_topic = output_topic( search->second );
+        }
+
+        geofence_filter.reset( new GeofenceFilter{ geofence, outside } );
+
+        ilogger->info("{}: geofence: {} polygons with {} edges on a {} cell grid; BSMs outside are {}", fnname,
+                geofence->polygons(), geofence->edges(), cells * cells,
+                outside == BsmFilter::Verdict::DROP ? std::string{ "dropped" } : "produced to " + search->second );
+    }
+
+    deduplicator.reset();
+
+    search = pconf.find("acm.dedup.window.ms");
+    if ( search != pconf.end() && std::stoul( search->second ) > 0 ) {
+        uint32_t window = static_cast<uint32_t>( std::stoul( search->second ) );
+        std::size_t keys = 262144;
+
+        search = pconf.find("acm.dedup.keys");
+        if ( search != pconf.end() ) keys = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        deduplicator.reset( new BsmDeduplicator{ window, keys } );
+
+        ilogger->info("{}: duplicate BSMs dropped within {} ms; {} keys", fnname, window, deduplicator->capacity() );
+    }
+
+    rate_limiter.reset();
+
+    search = pconf.find("acm.ratelimit.interval.ms");
+    if ( search != pconf.end() && std::stoul( search->second ) > 0 ) {
+        uint32_t interval = static_cast<uint32_t>( std::stoul( search->second ) );
+        std::size_t vehicles = 65536;
+        uint32_t idle = 10000;
+
+        search = pconf.find("acm.ratelimit.vehicles");
+        if ( search != pconf.end() ) vehicles = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.ratelimit.idle.ms");
+        if ( search != pconf.end() ) idle = static_cast<uint32_t>( std::stoul( search->second ) );
+
+        rate_limiter.reset( new BsmRateLimiter{ interval, vehicles, idle } );
+
+        ilogger->info("{}: rate limit: one BSM per vehicle every {} ms; {} vehicles tracked; idle after {} ms", fnname,
+                interval, rate_limiter->capacity(), std::max( idle, interval ) );
+    }
+
+    trajectories.reset();
+
+    search = pconf.find("acm.trajectory.topic");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        trajectory_topic = output_topic( search->second );
+        uint32_t window = 60000;
+        std::size_t points = 256;
+        std::size_t vehicles = 65536;
+        BsmFilter::Verdict verdict = BsmFilter::Verdict::PASS;
+
+        auto setting = pconf.find("acm.trajectory.window.ms");
+        if ( setting != pconf.end() ) {
+            try {
+                window = std::max<uint32_t>( 1, std::stoul( setting->second ) );
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default trajectory window.", fnname );
+            }
+        }
+
+        setting = pconf.find("acm.trajectory.points");
+        if ( setting != pconf.end() ) {
+            try {
+                points = std::max<std::size_t>( 2, std::stoul( setting->second ) );
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default trajectory points.", fnname );
+            }
+        }
+
+        setting = pconf.find("acm.trajectory.vehicles");
+        if ( setting != pconf.end() ) {
+            try {
+                vehicles = std::max<std::size_t>( 1, std::stoul( setting->second ) );
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default trajectory vehicles.", fnname );
+            }
+        }
+
+        // a trajectory only ACM produces the summaries and no BSM responses.
+        setting = pconf.find("acm.trajectory.only");
+        if ( setting != pconf.end() && setting->second == "true" ) verdict = BsmFilter::Verdict::DROP;
+
+        trajectories.reset( new TrajectoryAggregator{ window, points, vehicles, verdict } );
+
+        ilogger->info("{}: trajectories: one summary per vehicle every {} ms to {}; at most {} points; {} vehicles; BSM responses {}",
+                fnname, window, search->second, points, vehicles, verdict == BsmFilter::Verdict::DROP ? "dropped" : "produced" );
+    }
+
+    error_breaker.reset();
+
+    uint32_t threshold = 0;
+    search = pconf.find("acm.errors.breaker.threshold");
+    if ( search != pconf.end() ) {
+        try {
+            threshold = static_cast<uint32_t>( std::stoul( search->second ) );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default error breaker: none.", fnname );
+        }
+    }
+
+    if ( threshold > 0 ) {
+        uint32_t window = 1000;
+        uint32_t sample = 100;
+
+        search = pconf.find("acm.errors.breaker.window.ms");
+        if ( search != pconf.end() ) {
+            try {
+                window = std::max<uint32_t>( 1, std::stoul( search->second ) );
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default error breaker window.", fnname );
+            }
+        }
+
+        search = pconf.find("acm.errors.breaker.sample");
+        if ( search != pconf.end() ) {
+            try {
+                sample = std::max<uint32_t>( 1, std::stoul( search->second ) );
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default error breaker sample.", fnname );
+            }
+        }
+
+        error_breaker.reset( new ErrorBreaker{ threshold, window, sample } );
+        next_error_summary = std::chrono::steady_clock::now() + std::chrono::milliseconds( window );
+
+        ilogger->info("{}: error breaker: opens at {} errors of a partition in {} ms, then reports one error in {}", fnname,
+                threshold, window, sample );
+    }
+
+    search = pconf.find("acm.diagnostics.file");
+    if ( search != pconf.end() ) diagnostics_file = search->second;
+
+    // the slowest messages are named in the diagnostics dumps.
+    search = pconf.find("acm.diagnostics.slow.messages");
+    std::size_t slow = search != pconf.end() ? std::stoul( search->second ) : 10;
+    slow_messages.reset( slow > 0 ? new SlowMessages{ slow } : nullptr );
+
+    ilogger->info("{}: diagnostics on SIGUSR1 to {}; the {} slowest recent messages are kept", fnname,
+            diagnostics_file.empty() ? "the information log" : diagnostics_file, slow );
+
+    search = pconf.find("acm.spat.delta");
+    if ( search != pconf.end() ) {
+        spat_delta = ( search->second == "true" );
+    }
+
+    search = pconf.find("acm.spat.snapshot.seconds");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) spat_snapshot_seconds = static_cast<uint32_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default SPaT snapshot interval.", fnname );
+        }
+    }
+
+    if ( spat_delta ) {
+        ilogger->info("{}: SPaT delta: only changed movements; every intersection whole every {} s", fnname, spat_snapshot_seconds );
+    }
+
+    verifier.reset();
+
+    search = pconf.find("acm.verify");
+    if ( search != pconf.end() && search->second == "true" ) {
+        if ( !SignatureVerifier::available() ) {
+            throw std::invalid_argument{ "acm.verify needs an ACM built with signature verification (cmake -DACM_VERIFY=ON)." };
+        }
+
+        std::size_t threads = 2;
+        std::size_t batch = 64;
+        uint32_t sample = 100;
+        std::size_t certificates = 65536;
+
+        search = pconf.find("acm.verify.threads");
+        if ( search != pconf.end() ) threads = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.verify.batch");
+        if ( search != pconf.end() ) batch = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.verify.sample.percent");
+        if ( search != pconf.end() ) sample = static_cast<uint32_t>( std::min<unsigned long>( 100, std::stoul( search->second ) ) );
+
+        search = pconf.find("acm.verify.certificates");
+        if ( search != pconf.end() ) certificates = std::max<std::size_t>( 1, std::stoul( search->second ) );
+
+        search = pconf.find("acm.verify.drop.invalid");
+        if ( search != pconf.end() ) verify_drop = ( search->second == "true" );
+
+        verifier.reset( new SignatureVerifier{ threads, batch, sample, certificates } );
+
+        // the HashedId8s of revoked certificates, e.g., taken from a CRL, in hex; one per line.
+        search = pconf.find("acm.verify.revoked.file");
+        if ( search != pconf.end() && !search->second.empty() ) {
+            std::ifstream ifs{ search->second };
+            if ( !ifs ) {
+                throw std::invalid_argument{ "cannot read acm.verify.revoked.file: " + search->second };
+            }
+
+            std::string line;
+            std::vector<char> id;
+            std::size_t revoked = 0;
+            while ( std::getline( ifs, line ) ) {
+                string_utilities::strip( line );
+                if ( line.empty() || line[0] == '#' ) continue;
+                if ( line.size() != 16 || hex_codec::decode( line, id ) != hex_codec::npos ) {
+                    throw std::invalid_argument{ "acm.verify.revoked.file has a line that is not a HashedId8: " + line };
+                }
+                verifier->certificates().revoke( reinterpret_cast<const uint8_t*>( id.data() ) );
+                ++revoked;
+            }
+            ilogger->info("{}: {} revoked certificates from {}", fnname, revoked, search->second );
+        }
+
+        ilogger->info("{}: 1609.2 signatures: {}% verified on {} threads in batches of at most {}; {} signer certificates kept; invalid frames are {}",
+                fnname, sample, threads, batch, verifier->certificates().capacity(), verify_drop ? "dropped" : "produced" );
+    }
+
+    search = pconf.find("acm.encode.slice");
+    if ( search != pconf.end() ) {
+        slice_input = ( search->second != "false" );
+    }
+
+    search = pconf.find("acm.encode.dom");
+    if ( search != pconf.end() ) {
+        dom_input = ( search->second != "false" );
+        if ( !dom_input ) ilogger->info("{}: encoded elements are read by the ASN.1 XER decoder.", fnname );
+    }
+
+    search = pconf.find("acm.encode.bytes");
+    if ( search != pconf.end() ) {
+        if ( search->second != "hex" && search->second != "base64" ) {
+            elogger->error("{}: acm.encode.bytes must be hex or base64: {}", fnname, search->second );
+            return false;
+        }
+        base64_output = ( search->second == "base64" );
+        ilogger->info("{}: encoded bytes are written as {}.", fnname, search->second );
+    }
+
+    search = pconf.find("acm.asn1.arena");
+    if ( search != pconf.end() && search->second == "true" ) {
+        asn1_arena_size = 1048576;
+
+        search = pconf.find("acm.asn1.arena.chunk.size");
+        if ( search != pconf.end() ) {
+            try {
+                int n = std::stoi( search->second );
+                if ( n > 0 ) asn1_arena_size = n;
+            } catch( std::exception& e ) {
+                ilogger->info("{}: using the default asn1c arena chunk size.", fnname );
+            }
+        }
+
+        ilogger->info("{}: asn1c arena chunk size: {} bytes", fnname , asn1_arena_size);
+    }
+
+    search = pconf.find("acm.xml.pool");
+    if ( search != pconf.end() && search->second == "false" ) {
+        xml_pool_size = 0;
+    }
+
+    // a limit that cannot be read is not guessed; the ACM does not start.
+    auto read_limit = [&]( const char* key, unsigned long long& limit ) {
+        auto found = pconf.find( key );
+        if ( found == pconf.end() ) return true;
+        try {
+            limit = std::stoull( found->second );
+        } catch( std::exception& e ) {
+            elogger->error("{}: {} must be a number: {}", fnname, key, found->second );
+            return false;
+        }
+        return true;
+    };
+
+    unsigned long long max_bytes = 0, max_stack = 0, max_memory = 0, max_ms = 0;
+    if ( !read_limit( "acm.limit.message.bytes", max_bytes ) || !read_limit( "acm.limit.decode.stack", max_stack )
+            || !read_limit( "acm.limit.decode.memory", max_memory ) || !read_limit( "acm.limit.decode.ms", max_ms ) ) {
+        return false;
+    }
+
+    message_budget.max_bytes = static_cast<std::size_t>( max_bytes );
+    message_budget.max_stack = static_cast<std::size_t>( max_stack );
+    message_budget.max_memory = static_cast<std::size_t>( max_memory );
+    message_budget.max_ms = static_cast<uint32_t>( max_ms );
+
+    if ( asn1_arena_size == 0 && message_budget.max_memory > 0 ) {
+        elogger->warn("{}: acm.limit.decode.memory needs acm.asn1.arena; the decode memory is not limited.", fnname );
+    }
+
+    if ( message_budget.max_bytes || message_budget.max_stack || message_budget.max_memory || message_budget.max_ms ) {
+        ilogger->info("{}: message limits: {} bytes; decode: {} bytes of stack, {} bytes of memory, {} ms", fnname,
+                message_budget.max_bytes, message_budget.max_stack, message_budget.max_memory, message_budget.max_ms );
+    }
+
+    search = pconf.find("acm.xml.pool.chunk.size");
+    if ( xml_pool_size > 0 && search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n > 0 ) xml_pool_size = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default XML page pool chunk size.", fnname );
+        }
+    }
+
+    ilogger->info("{}: XML page pool chunk size: {} bytes", fnname , xml_pool_size);
+
+    search = pconf.find("acm.worker.queue.size");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n > 0 ) worker_queue_size = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default worker queue size.", fnname );
+        }
+    }
+
+    search = pconf.find("acm.produce.threads");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) produce_threads = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: producing on the codec threads.", fnname );
+        }
+    }
+
+    ilogger->info("{}: produce threads: {}", fnname , produce_threads);
+
+    search = pconf.find("acm.produce.wait.ms");
+    if ( search != pconf.end() ) {
+        try {
+            long n = std::stol( search->second );
+            if ( n > 0 ) produce_wait_ms = static_cast<uint32_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default producer queue wait.", fnname );
+        }
+    }
+
+    ilogger->info("{}: a response waits at most {} ms for room in the producer queue", fnname , produce_wait_ms);
+
+    search = pconf.find("acm.startup.metadata.timeout.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n > 0 ) metadata_timeout = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default startup metadata timeout.", fnname );
+        }
+    }
+
+    search = pconf.find("acm.warmup.rounds");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) warmup_rounds = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default number of warm-up rounds.", fnname );
+        }
+    }
+
+    search = pconf.find("acm.warmup.files");
+    if ( search != pconf.end() ) {
+        warmup_files.clear();
+        for ( const auto& file : string_utilities::split( search->second ) ) {
+            if ( !file.empty() ) warmup_files.emplace_back( file, decode_functionality );
+        }
+    } else {
+        // the bundled samples of each direction in use.
+        warmup_files.clear();
+        if ( uses_direction( true ) && !binary_input ) {
+            for ( const char* file : { "data/InputData.Ieee1609Dot2Data.Bsm.xml", "data/InputData.Ieee1609Dot2Data.TravelerInformation.xml",
+                    "data/InputData.TravelerInformation.xml" } ) {
+                warmup_files.emplace_back( file, true );
+            }
+        }
+        if ( uses_direction( false ) ) {
+            for ( const char* file : { "data/InputData.encoding.bsm.xml", "data/InputData.encoding.tim.xml" } ) {
+                warmup_files.emplace_back( file, false );
+            }
+        }
+    }
+
+    search = pconf.find("acm.ready.file");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        ready_file = search->second;
+        // a file left by an earlier run must not announce this one.
+        std::remove( ready_file.c_str() );
+        ilogger->info("{}: readiness file: {}", fnname, ready_file );
+    }
+
+    if ( !configure_cpus( "acm.cpu.kafka", kafka_cpus ) || !configure_cpus( "acm.cpu.consumer", consumer_cpus )
+            || !configure_cpus( "acm.cpu.workers", worker_cpus ) || !configure_cpus( "acm.cpu.producers", producer_cpus ) ) {
+        return false;
+    }
+
+    if ( !make_codecs() ) {
+        return false;
+    }
+
+    // the stage queues exist before the metrics thread reads their occupancy.
+    make_work_queues();
+
+    produce_queues.clear();
+    for ( std::size_t i = 0; i < produce_threads; ++i ) {
+        produce_queues.emplace_back( new RingQueue<ProduceItem>{ worker_queue_size } );
+    }
+
+    ilogger->trace("{}: finished.", fnname );
+    return true;
+}
+
+bool ASN1_Codec::read_settings( const std::string& cfile, std::vector<std::pair<std::string, std::string>>& settings ) {
+
+    static const char* fnname = "read_settings()";
+    std::string line;
+    StrVector pieces;
+    std::ifstream ifs{ cfile };
+
+    if (!ifs) {
+        return false;
+    }
+
+    while (std::getline( ifs, line )) {
+        line = string_utilities::strip( line );
+        if ( !line.empty() && line[0] != '#' ) {
+            pieces = string_utilities::split( line, '=' );
+            if (pieces.size() == 2) {
+                // in case the user inserted some spaces...
+                settings.emplace_back( string_utilities::strip( pieces[0] ), string_utilities::strip( pieces[1] ) );
+            } else {
+                elogger->warn("{}: too many pieces in the configuration file line: {}", fnname , line);
+            }
+
+        } // otherwise: empty or comment line.
+    }
+
+    return true;
+}
+
+bool ASN1_Codec::configure_reloadable() {
+
+    static const char* fnname = "configure()";
+
+    // the -v option overrides the information log level of the configuration file.
+    auto set_level = [this]( const char* key, std::shared_ptr<spdlog::logger>& logger, spdlog::level::level_enum& level ) {
+        auto search = pconf.find( key );
+        if ( search == pconf.end() ) return true;
+
+        for ( int l = spdlog::level::trace; l <= spdlog::level::off; ++l ) {
+            if ( search->second == spdlog::level::level_names[l] ) {
+                level = static_cast<spdlog::level::level_enum>( l );
+                logger->set_level( level );
+                return true;
+            }
+        }
+
+        elogger->error("{}: unknown {}: {}", fnname, key, search->second );
+        return false;
+    };
+
+    if ( !optIsSet('v') && !set_level( "acm.log.level", ilogger, iloglevel ) ) return false;
+    if ( !set_level( "acm.log.error.level", elogger, eloglevel ) ) return false;
+
+    auto search = pconf.end();
+
+    search = pconf.find("acm.consume.batch.size");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n > 0 ) consume_batch_size = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default consume batch size.", fnname );
+        }
+    }
+
+    search = pconf.find("acm.consume.batch.timeout.ms");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) consume_batch_timeout = n;
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default consume batch timeout value.", fnname );
+        }
+    }
+
+    ilogger->info("{}: consume batch size: {} timeout: {} ms", fnname , consume_batch_size, consume_batch_timeout);
+
+    search = pconf.find("acm.capture.file");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        capture.reset( new std::ofstream{ search->second, std::ios::binary | std::ios::app } );
+        if ( !*capture ) {
+            elogger->error("{}: cannot open the capture file: {}", fnname, search->second );
+            return false;
+        }
+        ilogger->info("{}: appending the consumed messages to {}", fnname, search->second );
+    }
+
+    search = pconf.find("acm.decode.cache.bytes");
+    if ( search != pconf.end() ) {
+        try {
+            long long n = std::stoll( search->second );
+            if ( n >= 0 ) decode_cache_size = static_cast<std::size_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: the decode cache is disabled.", fnname );
+        }
+    }
+
+    ilogger->info("{}: decode cache: {} bytes per worker", fnname , decode_cache_size);
+
+    search = pconf.find("acm.map.cache.bytes");
+    if ( search != pconf.end() ) {
+        try {
+            long long n = std::stoll( search->second );
+            if ( n >= 0 ) map_cache_size = static_cast<std::size_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: the MAP cache is disabled.", fnname );
+        }
+    }
+
+    ilogger->info("{}: MAP cache: {} bytes per worker", fnname , map_cache_size);
+
+    search = pconf.find("acm.encode.cache.bytes");
+    if ( search != pconf.end() ) {
+        try {
+            long long n = std::stoll( search->second );
+            if ( n >= 0 ) encode_cache_size = static_cast<std::size_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: the encode cache is disabled.", fnname );
+        }
+    }
+
+    ilogger->info("{}: encode cache: {} bytes per worker", fnname , encode_cache_size);
+
+    search = pconf.find("acm.encode.templates");
+    if ( search != pconf.end() ) {
+        try {
+            long long n = std::stoll( search->second );
+            if ( n >= 0 ) encode_templates = static_cast<std::size_t>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: the TIM templates are disabled.", fnname );
+        }
+    }
+
+    ilogger->info("{}: TIM templates: {} per worker", fnname , encode_templates);
+
+    // the constraint check policy applies to every type unless the type has its own; a type without one is always
+    // checked, so a reload that removes a policy restores the default.
+    validation_policies.clear();
+    for ( const char* type : { "Ieee1609Dot2Data", "MessageFrame", "AdvisorySituationData" } ) {
+        search = pconf.find( std::string{ "acm.validate." } + type );
+        if ( search == pconf.end() ) search = pconf.find("acm.validate");
+        if ( search == pconf.end() ) {
+            validation_policies.emplace_back( type, ValidationPolicy::parse( "always" ) );
+            continue;
+        }
+
+        try {
+            validation_policies.emplace_back( type, ValidationPolicy::parse( search->second ) );
+        } catch ( std::exception& e ) {
+            elogger->error("{}: {} for {}.", fnname, e.what(), type );
+            return false;
+        }
+
+        ilogger->info("{}: {} constraints check: {}", fnname, type, search->second );
+    }
+
+    search = pconf.find("acm.worker.threads");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            // 0 means use every hardware thread the platform reports.
+            worker_threads = ( n > 0 ) ? n : std::max( 1U, std::thread::hardware_concurrency() );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using the default number of worker threads.", fnname );
+        }
+    }
+
+    ilogger->info("{}: worker threads: {}", fnname , worker_threads);
+
+    search = pconf.find("acm.memory.budget");
+    if ( search != pconf.end() || memory_budget ) {
+        try {
+            std::size_t total = search != pconf.end() ? std::stoull( search->second ) : 0;
+            auto split = pconf.find("acm.memory.budget.split");
+            if ( !memory_budget ) memory_budget.reset( new MemoryBudget{} );
+            memory_budget->set_total( total, split != pconf.end() ? split->second : "" );
+        } catch ( std::exception& e ) {
+            elogger->error("{}: bad memory budget: {}", fnname, e.what() );
+            return false;
+        }
+
+        // the caches evict to stay within their share; each worker's are scaled down together.
+        std::size_t share = memory_budget->limit( MemoryBudget::Component::CACHES ) / worker_threads;
+        std::size_t caches = decode_cache_size + map_cache_size + encode_cache_size;
+        if ( share > 0 && caches > share ) {
+            double scale = static_cast<double>( share ) / caches;
+            decode_cache_size = static_cast<std::size_t>( decode_cache_size * scale );
+            map_cache_size = static_cast<std::size_t>( map_cache_size * scale );
+            encode_cache_size = static_cast<std::size_t>( encode_cache_size * scale );
+            ilogger->info("{}: caches scaled to the memory budget: decode {} MAP {} encode {} bytes per worker", fnname,
+                    decode_cache_size, map_cache_size, encode_cache_size );
+        }
+
+        ilogger->info("{}: memory budget: {} bytes; batch {} queues {} caches {} arenas {} bytes", fnname, memory_budget->total(),
+                memory_budget->limit( MemoryBudget::Component::BATCH ), memory_budget->limit( MemoryBudget::Component::QUEUES ),
+                memory_budget->limit( MemoryBudget::Component::CACHES ), memory_budget->limit( MemoryBudget::Component::ARENAS ) );
+    }
+
+    return assign_workers();
+}
+
+std::size_t ASN1_Codec::arena_retain() const {
+    return memory_budget ? memory_budget->limit( MemoryBudget::Component::ARENAS ) / std::max<std::size_t>( worker_threads, 1 ) : 0;
+}
+
+void ASN1_Codec::track_memory( std::size_t id ) {
+    if ( !memory_budget ) return;
+
+    std::pair<std::size_t, std::size_t>& reported = memory_reported[id];
+    std::size_t caches = codecs[id]->cache_bytes();
+    std::size_t arenas = codecs[id]->arena_bytes();
+    memory_budget->adjust( MemoryBudget::Component::CACHES, reported.first, caches );
+    memory_budget->adjust( MemoryBudget::Component::ARENAS, reported.second, arenas );
+    reported = std::make_pair( caches, arenas );
+}
+
+bool ASN1_Codec::configure_routes() {
+
+    static const char* fnname = "configure()";
+
+    routes.clear();
+    message_routes.clear();
+
+    auto search = pconf.find("acm.routes.messageid");
+    if ( search != pconf.end() ) {
+        for ( auto& entry : string_utilities::split( search->second ) ) {
+            StrVector pieces = string_utilities::split( string_utilities::strip( entry ), ':' );
+            int32_t id = -1;
+            try {
+                if ( pieces.size() == 2 && !pieces[1].empty() ) id = std::stoi( pieces[0] );
+            } catch ( std::exception& e ) {
+                id = -1;
+            }
+
+            if ( id < 0 || id > 32767 ) {
+                elogger->error("{}: acm.routes.messageid entry is not messageId:output: {}", fnname, entry );
+                return false;
+            }
+
+            message_routes[ id ] = output_topic( pieces[1] );
+            ilogger->info("{}: messageId {} routed to {}", fnname, id, pieces[1] );
+        }
+    }
+
+    search = pconf.find("acm.routes");
+    if ( search == pconf.end() || search->second.empty() ) return true;
+
+    // the routes replace asn1.topic.consumer; Kafka topic names cannot contain ':'.
+    consumed_topics.clear();
+
+    for ( auto& entry : string_utilities::split( search->second ) ) {
+        StrVector pieces = string_utilities::split( string_utilities::strip( entry ), ':' );
+        if ( pieces.size() != 3 || pieces[0].empty() || pieces[2].empty() || ( pieces[1] != "decode" && pieces[1] != "encode" ) ) {
+            elogger->error("{}: acm.routes entry is not consumed:decode|encode:output: {}", fnname, entry );
+            return false;
+        }
+
+        if ( routes.find( pieces[0] ) != routes.end() ) {
+            elogger->error("{}: acm.routes has two routes for topic: {}", fnname, pieces[0] );
+            return false;
+        }
+
+        TopicRoute route{ pieces[1] == "decode", output_topic( pieces[2] ), 0, 0, {}, false, { false, {} } };
+
+        // a topic may have a pipeline of its own: workers that no other topic holds back, with their own checks.
+        auto option = pconf.find( "acm.route." + pieces[0] + ".workers" );
+        if ( option != pconf.end() ) {
+            try {
+                route.workers = std::stoul( option->second );
+            } catch ( std::exception& e ) {
+                elogger->error("{}: acm.route.{}.workers is not a number: {}", fnname, pieces[0], option->second );
+                return false;
+            }
+        }
+
+        option = pconf.find( "acm.route." + pieces[0] + ".validate" );
+        if ( option != pconf.end() ) {
+            if ( route.workers == 0 ) {
+                elogger->error("{}: acm.route.{}.validate needs acm.route.{}.workers.", fnname, pieces[0], pieces[0] );
+                return false;
+            }
+
+            try {
+                for ( const char* type : { "Ieee1609Dot2Data", "MessageFrame", "AdvisorySituationData" } ) {
+                    route.validation_policies.emplace_back( type, ValidationPolicy::parse( option->second ) );
+                }
+            } catch ( std::exception& e ) {
+                elogger->error("{}: {} for acm.route.{}.validate.", fnname, e.what(), pieces[0] );
+                return false;
+            }
+        }
+
+        option = pconf.find( "acm.route." + pieces[0] + ".lazy" );
+        if ( option != pconf.end() ) {
+            if ( route.workers == 0 ) {
+                elogger->error("{}: acm.route.{}.lazy needs acm.route.{}.workers.", fnname, pieces[0], pieces[0] );
+                return false;
+            }
+
+            try {
+                route.lazy_decode = LazyDecode::parse( option->second );
+                route.own_lazy_decode = true;
+            } catch ( std::exception& e ) {
+                elogger->error("{}: {} for acm.route.{}.lazy.", fnname, e.what(), pieces[0] );
+                return false;
+            }
+        }
+
+        routes[ pieces[0] ] = route;
+        consumed_topics.push_back( pieces[0] );
+        ilogger->info("{}: route: {} {}d to {}", fnname, pieces[0], pieces[1], pieces[2] );
+    }
+
+    return true;
+}
+
+bool ASN1_Codec::configure_quarantine() {
+
+    static const char* fnname = "configure_quarantine()";
+
+    auto search = pconf.find("acm.quarantine.topic");
+    if ( search != pconf.end() && !search->second.empty() ) {
+        quarantine_topic_name = search->second;
+        quarantine_topic = output_topic( quarantine_topic_name );
+        ilogger->info("{}: failed inputs are copied to {}", fnname, quarantine_topic_name );
+    }
+
+    search = pconf.find("acm.quarantine.reprocess");
+    reprocess = ( search != pconf.end() && search->second == "true" );
+    if ( !reprocess ) return true;
+
+    if ( quarantine_topic_name.empty() ) {
+        elogger->error("{}: acm.quarantine.reprocess needs acm.quarantine.topic.", fnname );
+        return false;
+    }
+
+    // every worker takes the quarantined messages, which keep the routes of the topics they were consumed from; the
+    // ACM stops when the topic is drained.
+    consumed_topics.assign( 1, quarantine_topic_name );
+    for ( auto& route : routes ) {
+        route.second.workers = 0;
+        route.second.validation_policies.clear();
+        route.second.own_lazy_decode = false;
+    }
+    priority_topics.clear();
+    exit_eof = true;
+
+    ilogger->info("{}: reprocessing {}", fnname, quarantine_topic_name );
+    return true;
+}
+
+bool ASN1_Codec::assign_workers() {
+
+    static const char* fnname = "assign_workers()";
+
+    shared_worker = 0;
+    bool shared = routes.empty();
+
+    for ( const auto& topic : consumed_topics ) {
+        auto route = routes.find( topic );
+        if ( route == routes.end() || route->second.workers == 0 ) {
+            shared = true;
+            continue;
+        }
+
+        route->second.first_worker = shared_worker;
+        shared_worker += route->second.workers;
+        ilogger->info("{}: {} has workers {} to {}", fnname, topic, route->second.first_worker, shared_worker - 1 );
+    }
+
+    if ( shared_worker > worker_threads || ( shared && shared_worker == worker_threads && shared_worker > 0 ) ) {
+        elogger->error("{}: the {} workers of the routes leave none of the {} worker threads for the other topics.", fnname,
+                shared_worker, worker_threads );
+        return false;
+    }
+
+    return true;
+}
+
+std::size_t ASN1_Codec::worker_of( const std::string& topic, int32_t partition_id ) const {
+
+    std::size_t partition = static_cast<std::size_t>( std::max( partition_id, 0 ) );
+
+    if ( shared_worker > 0 ) {
+        auto route = routes.find( topic );
+        if ( route != routes.end() && route->second.workers > 0 ) {
+            return route->second.first_worker + partition % route->second.workers;
+        }
+    }
+
+    // when every topic has workers of its own there are no shared ones.
+    std::size_t shared = work_queues.size() - shared_worker;
+    return shared > 0 ? shared_worker + partition % shared : 0;
+}
+
+void ASN1_Codec::dispatch( WorkItem& item ) {
+
+    static const char* fnname = "dispatch()";
+
+    // each partition is processed by one worker, which keeps its messages in order. The consumer never waits for a
+    // worker, shared or not: when its lane or the memory budget of the queues is full, the partition is paused, so the
+    // other partitions keep going and the consumer does not buffer without bound.
+    std::size_t id = worker_of( item.message->topic_name(), item.message->partition() );
+
+    // a paused partition's messages wait behind the ones already held, so it keeps its order.
+    auto key = std::make_pair( item.message->topic_name(), item.message->partition() );
+    if ( paused_partitions.find( key ) == paused_partitions.end() ) {
+        if ( try_queue( id, item ) ) return;
+
+        // the fetched messages are held; librdkafka fetches the rest again from the consumed position on resume.
+        std::vector<RdKafka::TopicPartition*> partitions{ RdKafka::TopicPartition::create( key.first, key.second ) };
+        RdKafka::ErrorCode status = consumer_ptr->pause( partitions );
+        RdKafka::TopicPartition::destroy( partitions );
+        if ( status != RdKafka::ERR_NO_ERROR ) {
+            elogger->error("{}: cannot pause {}:{}: {}", fnname, key.first, key.second, RdKafka::err2str( status ));
+        }
+
+        paused_partitions.insert( key );
+        SPDLOG_TRACE(ilogger, "{}: {}:{} is paused while worker {} is full.", fnname, key.first, key.second, id );
+    }
+
+    held_items.push_back( std::move( item ) );
+}
+
+bool ASN1_Codec::try_queue( std::size_t id, WorkItem& item ) {
+    std::size_t bytes = item.message->len();
+    if ( memory_budget && !memory_budget->try_reserve( MemoryBudget::Component::QUEUES, bytes ) ) return false;
+
+    ++worker_backlog[id];
+    if ( work_queues[id]->try_push( item, item.lane ) ) return true;
+    --worker_backlog[id];
+
+    if ( memory_budget ) memory_budget->release( MemoryBudget::Component::QUEUES, bytes );
+    return false;
+}
+
+void ASN1_Codec::dispatch_held() {
+
+    static const char* fnname = "dispatch_held()";
+
+    std::set<std::pair<std::string, int32_t>> waiting;
+
+    for ( auto it = held_items.begin(); it != held_items.end(); ) {
+        auto key = std::make_pair( it->message->topic_name(), it->message->partition() );
+
+        if ( waiting.find( key ) == waiting.end() && try_queue( worker_of( key.first, key.second ), *it ) ) {
+            it = held_items.erase( it );
+            continue;
+        }
+
+        waiting.insert( key );
+        ++it;
+    }
+
+    for ( auto it = paused_partitions.begin(); it != paused_partitions.end(); ) {
+        if ( waiting.find( *it ) != waiting.end() ) {
+            ++it;
+            continue;
+        }
+
+        std::vector<RdKafka::TopicPartition*> partitions{ RdKafka::TopicPartition::create( it->first, it->second ) };
+        RdKafka::ErrorCode status = consumer_ptr->resume( partitions );
+        RdKafka::TopicPartition::destroy( partitions );
+        if ( status != RdKafka::ERR_NO_ERROR ) {
+            elogger->error("{}: cannot resume {}:{}: {}", fnname, it->first, it->second, RdKafka::err2str( status ));
+        }
+
+        it = paused_partitions.erase( it );
+    }
+}
+
+void ASN1_Codec::release_held( const std::vector<RdKafka::TopicPartition*>& partitions ) {
+
+    for ( const RdKafka::TopicPartition* tp : partitions ) {
+        auto key = std::make_pair( tp->topic(), tp->partition() );
+        paused_partitions.erase( key );
+        held_items.erase( std::remove_if( held_items.begin(), held_items.end(), [&key]( const WorkItem& item ) {
+            return item.message->partition() == key.second && item.message->topic_name() == key.first;
+        } ), held_items.end() );
+    }
+}
+
+void ASN1_Codec::set_validation_policies( std::size_t i ) {
+
+    const std::vector<std::pair<std::string, ValidationPolicy>>* policies = &validation_policies;
+
+    for ( const auto& route : routes ) {
+        if ( !route.second.validation_policies.empty() && i >= route.second.first_worker
+                && i < route.second.first_worker + route.second.workers ) {
+            policies = &route.second.validation_policies;
+        }
+    }
+
+    for ( const auto& policy : *policies ) {
+        codecs[i]->set_validation_policy( policy.first, policy.second );
+    }
+}
+
+void ASN1_Codec::set_lazy_decode( std::size_t i ) {
+
+    const LazyDecode* lazy = &lazy_decode;
+
+    for ( const auto& route : routes ) {
+        if ( route.second.own_lazy_decode && i >= route.second.first_worker
+                && i < route.second.first_worker + route.second.workers ) {
+            lazy = &route.second.lazy_decode;
+        }
+    }
+
+    codecs[i]->set_lazy_decode( *lazy );
+}
+
+bool ASN1_Codec::configure_priority() {
+
+    static const char* fnname = "configure_priority()";
+
+    priority_topics.clear();
+    lane_latencies.reset();
+
+    auto search = pconf.find("acm.priority.weight");
+    if ( search != pconf.end() ) {
+        try {
+            int n = std::stoi( search->second );
+            if ( n >= 0 ) priority_weight = static_cast<unsigned>( n );
+        } catch( std::exception& e ) {
+            ilogger->info("{}: using strict priority.", fnname );
+        }
+    }
+
+    search = pconf.find("acm.priority.topics");
+    if ( search == pconf.end() || search->second.empty() ) return true;
+
+    // a topic is in one lane, so the messages of each partition stay in order.
+    for ( auto& entry : string_utilities::split( search->second ) ) {
+        std::string topic = string_utilities::strip( entry );
+        if ( std::find( consumed_topics.begin(), consumed_topics.end(), topic ) == consumed_topics.end() ) {
+            elogger->error("{}: acm.priority.topics has a topic that is not consumed: {}", fnname, topic );
+            return false;
+        }
+        priority_topics.insert( topic );
+        ilogger->info("{}: priority topic: {}", fnname, topic );
+    }
+
+    lane_latencies.reset( new LatencyHistogram[ lane_count ] );
+
+    if ( priority_weight > 0 ) {
+        ilogger->info("{}: a worker takes at most {} priority messages while others wait", fnname, priority_weight );
+    } else {
+        ilogger->info("{}: priority messages are always taken first", fnname );
+    }
+
+    return true;
+}
+
+std::size_t ASN1_Codec::output_topic( const std::string& name ) {
+
+    auto it = std::find( output_topic_names.begin(), output_topic_names.end(), name );
+    if ( it != output_topic_names.end() ) return static_cast<std::size_t>( it - output_topic_names.begin() );
+
+    output_topic_names.push_back( name );
+    return output_topic_names.size() - 1;
+}
+
+bool ASN1_Codec::uses_direction( bool decode ) const {
+
+    if ( routes.empty() ) return decode == decode_functionality;
+
+    for ( const auto& route : routes ) {
+        if ( route.second.decode == decode ) return true;
+    }
+
+    return false;
+}
+
+bool ASN1_Codec::configure_cpus( const char* key, std::vector<int>& cpus ) {
+
+    static const char* fnname = "configure()";
+
+    auto search = pconf.find( key );
+    if ( search == pconf.end() ) return true;
+
+    try {
+        cpus = cpu_affinity::parse( search->second );
+    } catch ( std::invalid_argument& e ) {
+        elogger->error("{}: {}: {}", fnname, key, e.what() );
+        return false;
+    }
+
+    ilogger->info("{}: {}: {} CPUs", fnname, key, cpus.size() );
+    return true;
+}
+
+void ASN1_Codec::pin_thread( const std::vector<int>& cpus, const char* role ) {
+
+    static const char* fnname = "pin_thread()";
+
+    // the main thread is placed on the consumer's CPUs after it starts the workers and produce threads, and on the
+    // Kafka CPUs again when it restarts, so the roles with no CPUs of their own are given back the process's.
+    if ( !cpu_affinity::pin_current_thread( cpus.empty() ? process_cpus : cpus ) ) {
+        elogger->warn("{}: the {} thread cannot be placed on the configured CPUs.", fnname, role );
+    }
+}
+
+bool ASN1_Codec::launch_producer()
+{
+    std::string error_string;
+
+    // the responses are produced from pooled buffers that the delivery reports return.
+    if ( conf->set("dr_cb", &delivery_report, error_string) != RdKafka::Conf::CONF_OK ) {
+        elogger->critical("Failed to set the producer delivery report callback: {}.", error_string );
+        return false;
+    }
+
+    producer_ptr = std::shared_ptr<RdKafka::Producer>( RdKafka::Producer::create(conf, error_string) );
+    if ( !producer_ptr ) {
+        elogger->critical("Failed to create producer with error: {}.", error_string );
+        return false;
+    }
+
+    // every output topic has its handle before the first response is produced.
+    output_topics.clear();
+    for ( const auto& name : output_topic_names ) {
+        output_topics.emplace_back( RdKafka::Topic::create(producer_ptr.get(), name, tconf, error_string) );
+        if ( !output_topics.back() ) {
+            elogger->critical("Failed to create topic: {}. Error: {}.", name, error_string );
+            return false;
+        }
+
+        ilogger->info("Producer: {} created using topic: {}.", producer_ptr->name(), name);
+    }
+
+    // the sticky partitioner fills the partitions the output topics have now; one added later is used after a restart.
+    std::vector<int32_t> counts( output_topics.size(), 0 );
+    for ( std::size_t i = 0; partitioner->strategy() == OutputPartitioner::Strategy::STICKY && i < output_topics.size(); ++i ) {
+        RdKafka::Metadata* md;
+        if ( producer_ptr->metadata( false, output_topics[i].get(), &md, metadata_timeout ) == RdKafka::ERR_NO_ERROR ) {
+            if ( !md->topics()->empty() ) counts[i] = static_cast<int32_t>( md->topics()->front()->partitions()->size() );
+            delete md;
+        }
+
+        if ( counts[i] > 0 ) {
+            ilogger->info("Producer: {} has {} partitions.", output_topic_names[i], counts[i] );
+        } else {
+            ilogger->warn("Producer: the partitions of {} are not known; librdkafka places its responses.", output_topic_names[i] );
+        }
+    }
+    partitioner->set_partitions( counts );
+
+    return true;
+}
+
+bool ASN1_Codec::launch_consumer()
+{
+    std::string error_string;
+
+    // the reporter thread reads the consumer's watermarks.
+    std::atomic_store( &consumer_ptr, std::shared_ptr<RdKafka::KafkaConsumer>( RdKafka::KafkaConsumer::create(conf, error_string) ) );
+    if (!consumer_ptr) {
+        elogger->critical("Failed to create consumer with error: {}",  error_string );
+        return false;
+    }
+
+    // wait on the topics we specified to become available for subscription.
+    // loop terminates with a signal (CTRL-C) or when all the topics are available.
+    std::vector<std::string> waiting{ consumed_topics };
+    int backoff = 100;
+    while ( data_available && !topics_available( waiting ) ) {
+        // a topic is not available; back off from a short wait so a broker that is just starting is found quickly.
+        ilogger->trace("Waiting {} ms for {} needed consumer topics.", backoff, waiting.size());
+        std::this_thread::sleep_for( std::chrono::milliseconds( backoff ) );
+        backoff = std::min( backoff * 2, 1500 );
+    }
+
+    if ( waiting.empty() ) {
+        // all the needed topics are available for subscription.
+        RdKafka::ErrorCode status = consumer_ptr->subscribe(consumed_topics);
+        if (status) {
+            elogger->critical("Failed to subscribe to {} topics. Error: {}.", consumed_topics.size(), RdKafka::err2str(status) );
+            return false;
+        }
+    } else {
+        ilogger->warn("User cancelled ASN1_Codec while waiting for topics to become available.");
+        return false;
+    }
+
+    std::ostringstream osbuf{};
+    for ( auto& topic : consumed_topics ) {
+        if ( osbuf.tellp() != 0 ) osbuf << ", ";
+        osbuf << topic;
+    }
+
+    ilogger->info("Consumer: {} created using topics: {}.", consumer_ptr->name(), osbuf.str());
+    return true;
+}
+
+bool ASN1_Codec::make_loggers( bool remove_files )
+{
+    // defaults.
+    std::string path{ "logs/" };
+    std::string ilogname{ "log.info" };
+    std::string elogname{ "log.error" };
+
+    if (getOption('D').hasArg()) {
+        // replace default
+        path = getOption('D').argument();
+        if ( path.back() != '/' ) {
+            path += '/';
+        }
+    }
+
+    // if the directory specified doesn't exist, then make it.
+    if (!dirExists( path )) {
+#ifndef _MSC_VER
+        if (mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH ) != 0)   // linux
+#elif _MSC_VER 
+        if (_mkdir(path.c_str()) != 0)                                          // windows
+#else
+                                                                                // some other strange os...
+#endif
+        {
+            std::cerr << "Error making the logging directory.\n";
+            return false;
+        }
+    }
+    
+    // ilog check for user-defined file locations and names.
+    if (getOption('i').hasArg()) {
+        // replace default.
+        ilogname = string_utilities::basename<std::string>( getOption('i').argument() );
+    }
+
+    if (getOption('e').hasArg()) {
+        // replace default.
+        elogname = string_utilities::basename<std::string>( getOption('e').argument() );
+    }
+    
+    ilogname = path + ilogname;
+    elogname = path + elogname;
+
+    if ( remove_files && fileExists( ilogname ) ) {
+        if ( std::remove( ilogname.c_str() ) != 0 ) {
+            std::cerr << "Error removing the previous information log file.\n";
+            return false;
+        }
+    }
+
+    if ( remove_files && fileExists( elogname ) ) {
+        if ( std::remove( elogname.c_str() ) != 0 ) {
+            std::cerr << "Error removing the previous error log file.\n";
+            return false;
+        }
+    }
+
+    // asynchronous logging: log calls only enqueue; a spdlog thread per logger writes and periodically flushes the files.
+    if (getOption('A').hasArg()) {
+        std::size_t qsize = 1;
+        try {
+            // the spdlog queue size must be a power of 2.
+            int n = std::max( 1, std::stoi( getOption('A').argument() ) );
+            while ( qsize < static_cast<std::size_t>( n ) ) qsize <<= 1;
+        } catch ( std::exception& e ) {
+            std::cerr << "Error reading the asynchronous log queue size: " << getOption('A').argument() << '\n';
+            return false;
+        }
+
+        int flush_ms = 1000;
+        if (getOption('L').hasArg()) {
+            try {
+                flush_ms = std::max( 0, std::stoi( getOption('L').argument() ) );
+            } catch ( std::exception& e ) {
+                std::cerr << "Error reading the log flush interval: " << getOption('L').argument() << '\n';
+                return false;
+            }
+        }
+
+        spdlog::set_async_mode( qsize, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds( flush_ms ) );
+    }
+
+    // setup information logger.
+    ilogger = spdlog::rotating_logger_mt("ilog", ilogname, ilogsize, ilognum);
+    ilogger->set_pattern("[%C%m%d %H:%M:%S.%f] [%l] %v");
+    ilogger->set_level( iloglevel );
+
+    // setup error logger.
+    elogger = spdlog::rotating_logger_mt("elog", elogname, elogsize, elognum);
+    elogger->set_level( iloglevel );
+    elogger->set_pattern("[%C%m%d %H:%M:%S.%f] [%l] %v");
+
+    // the message loop never flushes; make sure the reason for an abnormal exit reaches the disk.
+    ilogger->flush_on( spdlog::level::critical );
+    elogger->flush_on( spdlog::level::critical );
+    return true;
+}
+
+bool ASN1_Codec::message_available(RdKafka::Message* message) {
+
+    static const char* fnname = "message_available()";
+
+    switch (message->err()) {
+
+        case RdKafka::ERR__TIMED_OUT:
+            ilogger->info("{}: Waiting for more BSMs.", fnname );
+            break;
+
+        case RdKafka::ERR__MSG_TIMED_OUT:
+            ilogger->info("{}: Waiting for more BSMs from the ODE producer.", fnname );
+            break;
+
+        case RdKafka::ERR_NO_ERROR:
+            /* Real message */
+            msg_recv_count++;
+            msg_recv_bytes += message->len();
+
+            // a partition that receives data after its end is no longer at its end.
+            if ( exit_eof && !eof_partitions.empty() ) {
+                eof_partitions.erase( std::make_pair( message->topic_name(), message->partition() ) );
+            }
+            return true;
+
+        case RdKafka::ERR__PARTITION_EOF:
+            ilogger->info("ODE BSM consumer partition {} end of file, but ASN1_Codec still alive.", message->partition());
+            if (exit_eof) {
+                eof_partitions.insert( std::make_pair( message->topic_name(), message->partition() ) );
+                partition_cnt = assigned_partitions();
+
+                if (static_cast<int32_t>( eof_partitions.size() ) >= partition_cnt) {
+                    ilogger->info("EOF reached for all {} partition(s)", partition_cnt);
+                    data_available = false;
+                }
+            }
+            break;
+
+        case RdKafka::ERR__UNKNOWN_TOPIC:
+            elogger->error("cannot consume due to an UNKNOWN consumer topic: {}", message->errstr());
+
+        case RdKafka::ERR__UNKNOWN_PARTITION:
+            elogger->error("cannot consume due to an UNKNOWN consumer partition: {}", message->errstr());
+            data_available = false;
+            break;
+
+        default:
+            elogger->error("cannot consume due to an error: {}", message->errstr());
+            data_available = false;
+    }
+
+    return false;
+}
+
+int32_t ASN1_Codec::assigned_partitions() {
+    std::vector<RdKafka::TopicPartition*> partitions;
+    int32_t n = 0;
+
+    if ( consumer_ptr && consumer_ptr->assignment( partitions ) == RdKafka::ERR_NO_ERROR ) {
+        n = static_cast<int32_t>( partitions.size() );
+    }
+
+    RdKafka::TopicPartition::destroy( partitions );
+
+    // before the first assignment is known there is at least the partition that reported its end.
+    return n > 0 ? n : 1;
+}
+
+void ASN1_Codec::start_polling() {
+
+    polling = true;
+
+    // delivery reports (and so the pooled buffers and commit tokens) are returned while the workers produce.
+    poll_thread = std::thread{ [this]() {
+        while ( polling ) {
+            producer_ptr->poll( 100 );
+        }
+    } };
+}
+
+void ASN1_Codec::stop_polling() {
+
+    polling = false;
+    if ( poll_thread.joinable() ) poll_thread.join();
+}
+
+void ASN1_Codec::start_reporting() {
+
+    if ( stats_interval <= 0 ) return;
+
+    reporting = true;
+
+    // the counters are read without stopping the workers; each report gives the change since the previous one.
+    report_thread = std::thread{ [this]() {
+        uint64_t recv_count = 0, recv_bytes = 0, send_count = 0, send_bytes = 0, filt_count = 0, error_count = 0;
+        uint64_t produce_errors = 0, delivered = 0, failed = 0, errors_dropped = 0, quarantined = 0;
+        uint64_t signature_counts[SignatureVerifier::statuses] = {}, verify_batches = 0;
+        uint64_t busy = busy_ns.load();
+        int64_t last_lag = -1;
+        auto last = std::chrono::steady_clock::now();
+
+        KafkaStatistics producer;
+        KafkaStatistics consumer;
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer;
+
+        // write the change in a counter since the last report.
+        auto delta = [&writer]( const char* name, uint64_t value, uint64_t& previous ) {
+            writer.Key( name );
+            writer.Uint64( value - previous );
+            previous = value;
+        };
+
+        std::unique_lock<std::mutex> lock{ report_mutex };
+
+        while ( !report_cv.wait_for( lock, std::chrono::milliseconds( stats_interval ), [this]() { return !reporting; } ) ) {
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>( now - last ).count();
+            last = now;
+
+            buffer.Clear();
+            writer.Reset( buffer );
+            writer.StartObject();
+
+            writer.Key( "interval_s" );
+            writer.Double( seconds );
+
+            uint64_t received = msg_recv_count.load();
+            uint64_t recv_count_before = recv_count;
+            writer.Key( "consumed_per_s" );
+            writer.Double( ( received - recv_count ) / seconds );
+            delta( "consumed", received, recv_count );
+            delta( "consumed_bytes", msg_recv_bytes.load(), recv_bytes );
+
+            uint64_t sent = msg_send_count.load();
+            writer.Key( "produced_per_s" );
+            writer.Double( ( sent - send_count ) / seconds );
+            delta( "produced", sent, send_count );
+            delta( "produced_bytes", msg_send_bytes.load(), send_bytes );
+
+            delta( "errors", msg_error_count.load(), error_count );
+            delta( "errors_dropped", error_breaker ? error_breaker->suppressed() : 0, errors_dropped );
+            delta( "filtered", msg_filt_count.load(), filt_count );
+            delta( "quarantined", msg_quarantine_count.load(), quarantined );
+            delta( "produce_failures", produce_error_count.load(), produce_errors );
+            delta( "delivered", delivery_report.delivered.load(), delivered );
+            delta( "delivery_failures", delivery_report.failed.load(), failed );
+
+            // the items waiting between the stages show which one is behind: full worker queues mean the codec, full
+            // produce queues mean librdkafka.
+            std::size_t waiting = 0;
+            for ( const auto& q : work_queues ) waiting += q->size();
+            writer.Key( "worker_queue" );
+            writer.Uint64( waiting );
+
+            if ( lane_latencies ) {
+                // the priority lane's share of the worker queues, and the consumption to response time of each lane.
+                static const char* lane_names[lane_count] = { "priority", "normal" };
+                LatencyHistogram::Snapshot snapshot;
+
+                waiting = 0;
+                for ( const auto& q : work_queues ) waiting += q->size( 0 );
+                writer.Key( "priority_queue" );
+                writer.Uint64( waiting );
+
+                writer.Key( "lanes" );
+                writer.StartObject();
+                for ( std::size_t lane = 0; lane < lane_count; ++lane ) {
+                    lane_latencies[lane].take( snapshot );
+                    writer.Key( lane_names[lane] );
+                    writer.StartObject();
+                    writer.Key( "n" );
+                    writer.Uint64( snapshot.count );
+                    writer.Key( "p50_us" );
+                    writer.Uint64( snapshot.percentile( 0.5 ) / 1000 );
+                    writer.Key( "p99_us" );
+                    writer.Uint64( snapshot.percentile( 0.99 ) / 1000 );
+                    writer.Key( "max_us" );
+                    writer.Uint64( snapshot.max / 1000 );
+                    writer.EndObject();
+                }
+                writer.EndObject();
+            }
+
+            waiting = 0;
+            for ( const auto& q : produce_queues ) waiting += q->size();
+            writer.Key( "produce_queue" );
+            writer.Uint64( waiting );
+
+            if ( memory_budget ) {
+                // the bytes each component of the budget holds, and the most it has held.
+                writer.Key( "memory" );
+                writer.StartObject();
+                for ( std::size_t i = 0; i < MemoryBudget::components; ++i ) {
+                    MemoryBudget::Component c = static_cast<MemoryBudget::Component>( i );
+                    writer.Key( MemoryBudget::name( c ) );
+                    writer.StartObject();
+                    writer.Key( "bytes" );
+                    writer.Uint64( memory_budget->in_use( c ) );
+                    writer.Key( "high_water" );
+                    writer.Uint64( memory_budget->high_water( c ) );
+                    writer.Key( "limit" );
+                    writer.Uint64( memory_budget->limit( c ) );
+                    writer.EndObject();
+                }
+                writer.EndObject();
+            }
+
+            if ( verifier ) {
+                // the signatures checked by the result, and the batches the pool took them in.
+                writer.Key( "signatures" );
+                writer.StartObject();
+                for ( std::size_t i = 1; i < SignatureVerifier::statuses; ++i ) {
+                    SignatureVerifier::Status status = static_cast<SignatureVerifier::Status>( i );
+                    delta( SignatureVerifier::name( status ), verifier->count( status ), signature_counts[i] );
+                }
+                delta( "batches", verifier->batches(), verify_batches );
+                writer.Key( "certificates" );
+                writer.Uint64( verifier->certificates().size() );
+                writer.EndObject();
+            }
+
+            if ( message_latencies ) {
+                // the partitions' histograms since the last record; each key's stages are visited together.
+                std::string key;
+                writer.Key( "latency" );
+                writer.StartObject();
+                message_latencies->take( [&writer, &key]( const std::string& k, const char* stage, const LatencyHistogram::Snapshot& snapshot ) {
+                    if ( k != key ) {
+                        if ( !key.empty() ) writer.EndObject();
+                        key = k;
+                        writer.Key( key.c_str() );
+                        writer.StartObject();
+                    }
+                    writer.Key( stage );
+                    writer.StartObject();
+                    writer.Key( "n" );
+                    writer.Uint64( snapshot.count );
+                    writer.Key( "p50_us" );
+                    writer.Uint64( snapshot.percentile( 0.5 ) / 1000 );
+                    writer.Key( "p99_us" );
+                    writer.Uint64( snapshot.percentile( 0.99 ) / 1000 );
+                    writer.Key( "max_us" );
+                    writer.Uint64( snapshot.max / 1000 );
+                    writer.EndObject();
+                } );
+                if ( !key.empty() ) writer.EndObject();
+                writer.EndObject();
+            }
+
+            if ( kafka_statistics ) {
+                // the last librdkafka reports; they are as old as statistics.interval.ms.
+                event_report.latest( producer, consumer );
+
+                writer.Key( "producer_queue" );
+                writer.Int64( producer.queued_messages );
+                writer.Key( "producer_queue_bytes" );
+                writer.Int64( producer.queued_bytes );
+                writer.Key( "consumer_lag" );
+                writer.Int64( consumer.consumer_lag );
+                writer.Key( "fetch_queue" );
+                writer.Int64( consumer.fetch_queue );
+                writer.Key( "producer_rtt_avg_us" );
+                writer.Int64( producer.rtt_avg_us );
+                writer.Key( "producer_rtt_p99_us" );
+                writer.Int64( producer.rtt_p99_us );
+                writer.Key( "consumer_rtt_avg_us" );
+                writer.Int64( consumer.rtt_avg_us );
+                writer.Key( "consumer_rtt_p99_us" );
+                writer.Int64( consumer.rtt_p99_us );
+            }
+
+            if ( metrics_endpoint ) {
+                // the signals an autoscaler needs before the latency suffers: the backlog of each partition, from its
+                // committed offset to its high watermark, how busy the threads are, and how long the backlog would take
+                // to consume at full utilization.
+                MetricsText page;
+                MetricsText::Labels labels{ { "topic", "" }, { "partition", "" } };
+                int64_t lag = 0;
+
+                page.family( "acm_consumer_lag_messages", "gauge", "Messages from the committed offset to the high watermark of a partition." );
+                std::shared_ptr<RdKafka::KafkaConsumer> consumer_handle = std::atomic_load( &consumer_ptr );
+                for ( const CommitManager::Position& p : commit_manager.positions() ) {
+                    int64_t low = -1, high = -1;
+                    int64_t committed = p.next >= 0 ? p.next : p.first;
+                    if ( !consumer_handle || committed < 0 ) continue;
+                    if ( consumer_handle->get_watermark_offsets( p.topic, p.partition, &low, &high ) != RdKafka::ERR_NO_ERROR || high < 0 ) continue;
+
+                    int64_t partition_lag = std::max<int64_t>( high - committed, 0 );
+                    labels[0].second = p.topic;
+                    labels[1].second = std::to_string( p.partition );
+                    page.sample( "acm_consumer_lag_messages", labels, static_cast<double>( partition_lag ) );
+                    lag += partition_lag;
+                }
+
+                uint64_t busy_now = busy_ns.load();
+                std::size_t threads = processing_threads.load();
+                double busy_ratio = std::min( ( busy_now - busy ) / ( seconds * 1e9 * threads ), 1.0 );
+                busy = busy_now;
+
+                double consumed_per_s = ( received - recv_count_before ) / seconds;
+                double lag_per_s = last_lag < 0 ? 0 : ( lag - last_lag ) / seconds;
+                double drain = MetricsEndpoint::drain_seconds( static_cast<double>( lag ), consumed_per_s, lag_per_s, busy_ratio );
+                last_lag = lag;
+
+                waiting = 0;
+                for ( const auto& q : work_queues ) waiting += q->size();
+
+                page.family( "acm_worker_busy_ratio", "gauge", "The share of the processing threads' time spent on messages since the last report." );
+                page.sample( "acm_worker_busy_ratio", busy_ratio );
+                page.family( "acm_worker_threads", "gauge", "The threads that process messages." );
+                page.sample( "acm_worker_threads", static_cast<double>( threads ) );
+                page.family( "acm_worker_queue_messages", "gauge", "Messages waiting for a worker." );
+                page.sample( "acm_worker_queue_messages", static_cast<double>( waiting ) );
+                page.family( "acm_consumed_per_second", "gauge", "Messages consumed per second since the last report." );
+                page.sample( "acm_consumed_per_second", consumed_per_s );
+                page.family( "acm_drain_seconds", "gauge", "The projected time to consume the lag at full utilization; +Inf when it cannot shrink." );
+                page.sample( "acm_drain_seconds", drain );
+                page.family( "acm_consumed_messages_total", "counter", "Messages consumed." );
+                page.sample( "acm_consumed_messages_total", static_cast<double>( received ) );
+                page.family( "acm_produced_messages_total", "counter", "Responses produced." );
+                page.sample( "acm_produced_messages_total", static_cast<double>( sent ) );
+                page.family( "acm_error_responses_total", "counter", "Messages answered with an error." );
+                page.sample( "acm_error_responses_total", static_cast<double>( msg_error_count.load() ) );
+                metrics_endpoint->publish( page.str() );
+
+                writer.Key( "scaling" );
+                writer.StartObject();
+                writer.Key( "lag" );
+                writer.Int64( lag );
+                writer.Key( "busy_ratio" );
+                writer.Double( busy_ratio );
+                writer.Key( "drain_s" );
+                writer.Double( std::isinf( drain ) ? -1 : drain );
+                writer.EndObject();
+            }
+
+            writer.EndObject();
+            ilogger->info("metrics: {}", buffer.GetString());
+        }
+    } };
+}
+
+void ASN1_Codec::stop_reporting() {
+
+    {
+        std::lock_guard<std::mutex> lock{ report_mutex };
+        reporting = false;
+    }
+
+    report_cv.notify_all();
+    if ( report_thread.joinable() ) report_thread.join();
+}
+
+void ASN1_Codec::commit_offsets( bool synchronous ) {
+
+    static const char* fnname = "commit_offsets()";
+    std::vector<CommitManager::Offset> offsets;
+
+    next_commit = std::chrono::steady_clock::now() + std::chrono::milliseconds( commit_interval );
+
+    if ( !consumer_ptr || commit_manager.take_commits( offsets ) == 0 ) return;
+
+    std::vector<RdKafka::TopicPartition*> partitions;
+    for ( auto& o : offsets ) {
+        partitions.push_back( RdKafka::TopicPartition::create( o.topic, o.partition, o.offset ) );
+    }
+
+    // one request for every partition that advanced; the result of an asynchronous commit is not waited for.
+    RdKafka::ErrorCode status = synchronous ? consumer_ptr->commitSync( partitions ) : consumer_ptr->commitAsync( partitions );
+
+    if ( status != RdKafka::ERR_NO_ERROR ) {
+        elogger->error("{}: cannot commit offsets for {} partition(s): {}", fnname , partitions.size(), RdKafka::err2str( status ));
+    }
+
+    RdKafka::TopicPartition::destroy( partitions );
+}
+
+void ASN1_Codec::drain_partitions( const std::vector<RdKafka::TopicPartition*>& partitions ) {
+
+    static const char* fnname = "drain_partitions()";
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( rebalance_drain_timeout );
+
+    // a revoked partition is done when its worker has processed everything consumed from it and, with tracked commits,
+    // its responses are delivered. Only the workers of revoked partitions are waited on; the rest keep working.
+    release_held( partitions );
+
+    auto drained = [this]( const RdKafka::TopicPartition* tp ) {
+        if ( !workers.empty() ) {
+            std::size_t id = worker_of( tp->topic(), tp->partition() );
+            if ( worker_backlog[id] > 0 ) return false;
+        }
+        return commit_interval <= 0 || commit_manager.pending( tp->topic(), tp->partition() ) == 0;
+    };
+
+    for ( const RdKafka::TopicPartition* tp : partitions ) {
+        while ( !drained( tp ) ) {
+            if ( std::chrono::steady_clock::now() >= deadline ) {
+                elogger->warn("{}: {}:{} did not drain in {} ms; its undelivered messages will be consumed again.", fnname, tp->topic(), tp->partition(), rebalance_drain_timeout );
+                break;
+            }
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+
+    if ( commit_interval <= 0 || !consumer_ptr ) return;
+
+    // the final offsets of the revoked partitions are committed before the next owner starts consuming them.
+    std::vector<RdKafka::TopicPartition*> commits;
+    for ( const RdKafka::TopicPartition* tp : partitions ) {
+        CommitManager::Offset offset;
+        if ( commit_manager.release( tp->topic(), tp->partition(), offset ) ) {
+            commits.push_back( RdKafka::TopicPartition::create( offset.topic, offset.partition, offset.offset ) );
+        }
+    }
+
+    if ( !commits.empty() ) {
+        RdKafka::ErrorCode status = consumer_ptr->commitSync( commits );
+        if ( status != RdKafka::ERR_NO_ERROR ) {
+            elogger->error("{}: cannot commit offsets for {} revoked partition(s): {}", fnname , commits.size(), RdKafka::err2str( status ));
+        }
+    }
+
+    ilogger->info("{}: {} revoked partitions drained; {} offsets committed.", fnname, partitions.size(), commits.size() );
+    RdKafka::TopicPartition::destroy( commits );
+}
+
+std::size_t ASN1_Codec::histogram_index( uint32_t ops, bool success, std::size_t stage ) {
+    return ( ( ops % histogram_types ) * 2 + ( success ? 0 : 1 ) ) * histogram_stages + stage;
+}
+
+void ASN1_Codec::record_latencies( const CodecContext& codec, bool success, uint64_t codec_ns, uint64_t produce_ns ) {
+
+    static constexpr std::size_t codec_stage = static_cast<std::size_t>( CodecStage::COUNT );
+
+    uint32_t ops = codec.operations();
+    const CodecContext::StageTimes& times = codec.stage_times();
+
+    // stages the message did not pass through are not recorded.
+    for ( std::size_t stage = 0; stage < codec_stage; ++stage ) {
+        if ( times.ns[stage] ) histograms[ histogram_index( ops, success, stage ) ].record( times.ns[stage] );
+    }
+
+    histograms[ histogram_index( ops, success, codec_stage ) ].record( codec_ns );
+    histograms[ histogram_index( ops, success, codec_stage + 1 ) ].record( produce_ns );
+}
+
+namespace {
+
+    // the names of the histogram types, by the layers of the message.
+    const char* histogram_type_names[] = {
+        "unknown",
+        "Ieee1609Dot2Data",
+        "MessageFrame",
+        "Ieee1609Dot2Data/MessageFrame",
+        "AdvisorySituationData",
+        "AdvisorySituationData/Ieee1609Dot2Data",
+        "AdvisorySituationData/MessageFrame",
+        "AdvisorySituationData/Ieee1609Dot2Data/MessageFrame"
+    };
+}
+
+void ASN1_Codec::log_histograms() {
+
+    next_histogram = std::chrono::steady_clock::now() + std::chrono::milliseconds( histogram_interval );
+
+    if ( !histograms ) return;
+
+    // each log covers the messages since the previous one; the workers keep recording while the counts are taken.
+    LatencyHistogram::Snapshot snapshot;
+
+    for ( std::size_t ops = 0; ops < histogram_types; ++ops ) {
+        for ( int outcome = 0; outcome < 2; ++outcome ) {
+            for ( std::size_t stage = 0; stage < histogram_stages; ++stage ) {
+                histograms[ histogram_index( static_cast<uint32_t>( ops ), outcome == 0, stage ) ].take( snapshot );
+                if ( snapshot.count == 0 ) continue;
+
+                const char* stage_name = stage < static_cast<std::size_t>( CodecStage::COUNT ) ? codecstages[stage] : ( stage == histogram_stages - 2 ? "codec" : "produce" );
+                ilogger->info("latency {} {} {}: n={} mean={} p50={} p90={} p99={} max={} ns", histogram_type_names[ops], outcome == 0 ? "success" : "error", stage_name,
+                        snapshot.count, snapshot.mean(), snapshot.percentile( 0.5 ), snapshot.percentile( 0.9 ), snapshot.percentile( 0.99 ), snapshot.max );
+            }
+        }
+    }
+}
+
+std::size_t ASN1_Codec::consume_batch(std::vector<WorkItem>& batch) {
+
+    batch.clear();
+
+    // the first consume waits the usual amount of time for data; the rest of the batch is bounded by the batch timeout.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( consume_batch_timeout );
+    int timeout = consumer_timeout;
+
+    // a batch ends early at its share of the memory budget.
+    std::size_t limit = memory_budget ? memory_budget->limit( MemoryBudget::Component::BATCH ) : 0;
+    std::size_t bytes = 0;
+
+    while ( data_available && batch.size() < consume_batch_size && ( limit == 0 || bytes < limit ) ) {
+
+        std::unique_ptr<RdKafka::Message> msg{ consumer_ptr->consume( timeout ) };
+
+        if ( message_available( msg.get() ) ) {
+            MessageLatencies::Partition* latencies = nullptr;
+
+            if ( message_latencies ) {
+                latencies = &message_latencies->partition( msg->topic_name(), msg->partition() );
+
+                // the producer's or the broker's clock; a clock ahead of this one counts as no delay.
+                RdKafka::MessageTimestamp ts = msg->timestamp();
+                if ( ts.type != RdKafka::MessageTimestamp::MSG_TIMESTAMP_NOT_AVAILABLE ) {
+                    int64_t lag = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count() - ts.timestamp;
+                    latencies->kafka.record( lag > 0 ? static_cast<uint64_t>( lag ) * 1000000 : 0 );
+                }
+            }
+
+            if ( capture ) {
+                // without a Kafka timestamp the message is captured at the time it was consumed.
+                RdKafka::MessageTimestamp ts = msg->timestamp();
+                int64_t ms = ts.type != RdKafka::MessageTimestamp::MSG_TIMESTAMP_NOT_AVAILABLE ? ts.timestamp :
+                    std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+                capture_frame.clear();
+                BatchInput::append_timed( capture_frame, ms, msg->partition(), msg->payload(), msg->len() );
+                capture->write( capture_frame.data(), capture_frame.size() );
+            }
+
+            std::size_t lane = priority_topics.empty() || priority_topics.count( msg->topic_name() ) ? 0 : 1;
+            bytes += msg->len();
+            batch.push_back( WorkItem{ std::move( msg ), std::chrono::steady_clock::now(), latencies, lane } );
+        } else if ( !batch.empty() || msg->err() == RdKafka::ERR__TIMED_OUT ) {
+            // no more data right now, or time to report a non-data event; process what we have.
+            break;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now() ).count();
+        if ( remaining <= 0 ) break;
+        timeout = static_cast<int>( remaining );
+    }
+
+    if ( memory_budget ) {
+        memory_budget->adjust( MemoryBudget::Component::BATCH, batch_bytes, bytes );
+        batch_bytes = bytes;
+    }
+
+    return batch.size();
+}
+
+void ASN1_Codec::processed( const WorkItem& item ) {
+    if ( !batch_tuner && !item.latencies && !lane_latencies && !slow_messages ) return;
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>( now - item.consumed ).count();
+    if ( batch_tuner ) batch_tuner->record( ns );
+    if ( item.latencies ) item.latencies->acm.record( ns );
+    if ( lane_latencies ) lane_latencies[ item.lane ].record( ns );
+    if ( slow_messages ) {
+        slow_messages->record( item.message->topic_name(), item.message->partition(), item.message->offset(), ns,
+                std::chrono::duration_cast<std::chrono::milliseconds>( now.time_since_epoch() ).count() );
+    }
+}
+
+void ASN1_Codec::tune_batching() {
+
+    static const char* fnname = "tune_batching()";
+
+    next_batch_tune = std::chrono::steady_clock::now() + std::chrono::milliseconds( batch_tune_interval );
+
+    BatchTuner::Settings settings{ consume_batch_size, consume_batch_timeout };
+    if ( batch_tuner->adjust( settings ) ) {
+        SPDLOG_DEBUG(ilogger, "{}: p99 {} ns, target {} ns: batch size {} -> {}, timeout {} -> {} ms", fnname, batch_tuner->last_p99(), batch_tuner->target_p99(),
+                consume_batch_size, settings.batch_size, consume_batch_timeout, settings.batch_timeout );
+        consume_batch_size = settings.batch_size;
+        consume_batch_timeout = settings.batch_timeout;
+    }
+}
+
+RdKafka::Headers* ASN1_Codec::make_headers( const CodecContext::ResponseMetadata& metadata, SignatureVerifier::Status signature ) const {
+    // responses that are complete ODE documents have no envelope headers.
+    bool envelope = output_headers && !metadata.data_type.empty();
+
+    if ( !envelope && signature == SignatureVerifier::Status::NONE ) {
+        return nullptr;
+    }
+
+    RdKafka::Headers* headers = RdKafka::Headers::create();
+
+    if ( envelope ) {
+        if ( !metadata.payload_type.empty() ) headers->add( "payloadType", metadata.payload_type );
+        headers->add( "dataType", metadata.data_type );
+        if ( !metadata.generated_at.empty() ) headers->add( "generatedAt", metadata.generated_at );
+        if ( !metadata.encodings.empty() ) headers->add( "encodings", metadata.encodings );
+    }
+
+    if ( signature != SignatureVerifier::Status::NONE ) headers->add( "signature", SignatureVerifier::name( signature ) );
+
+    return headers;
+}
+
+bool ASN1_Codec::process_message(RdKafka::Message* message, CodecContext& codec, ProduceStream& output_message_stream ) {
+
+    static const char* fnname = "process_message()";
+
+	SPDLOG_TRACE(ilogger, "{}: starting...", fnname);
+
+    if ( message->len() == 0 ) {
+        // nothing to decode or encode and nothing to respond with; the offset is done.
+        if ( commit_interval > 0 ) {
+            commit_manager.complete( commit_manager.track( message->topic_name(), message->partition(), message->offset() ) );
+        }
+        return false;
+    }
+
+    SPDLOG_TRACE(ilogger, "{}: Read message at byte offset: {} with length {}", fnname , message->offset(), message->len() );
+
+#ifdef SPDLOG_TRACE_ON
+    RdKafka::MessageTimestamp ts = message->timestamp();
+    std::string tsname;
+
+    if (ts.type != RdKafka::MessageTimestamp::MSG_TIMESTAMP_NOT_AVAILABLE) {
+        if (ts.type == RdKafka::MessageTimestamp::MSG_TIMESTAMP_CREATE_TIME) {
+            tsname = "create time";
+        } else if (ts.type == RdKafka::MessageTimestamp::MSG_TIMESTAMP_LOG_APPEND_TIME) {
+            tsname = "log append time";
+        } else {
+            tsname = "unknown";
+        }
+
+        SPDLOG_TRACE(ilogger, "{}: Message timestamp: {}, type: {}", fnname , tsname, ts.timestamp);
+    }
+#endif
+
+    if ( message->key() ) {
+        SPDLOG_TRACE(ilogger, "{}: Message key: {}", fnname , *message->key() );
+    }
+
+    // with routes, the consumed topic selects the direction and the output topic of its messages; a reprocessed
+    // message takes the route of the topic it was quarantined from.
+    std::size_t topic = 0;
+    if ( !routes.empty() ) {
+        std::string consumed = message->topic_name();
+        if ( reprocess && message->headers() ) {
+            RdKafka::Headers::Header source = message->headers()->get_last( "sourceTopic" );
+            if ( source.err() == RdKafka::ERR_NO_ERROR && source.value() ) {
+                consumed.assign( static_cast<const char*>( source.value() ), source.value_size() );
+            }
+        }
+
+        auto route = routes.find( consumed );
+        if ( route != routes.end() ) {
+            codec.set_decode_functionality( route->second.decode );
+            topic = route->second.output;
+        } else {
+            codec.set_decode_functionality( decode_functionality );
+        }
+    }
+
+    // success or failure, the codec writes a response (possibly error xml) to the stream.
+    bool success;
+    std::chrono::steady_clock::time_point codec_start;
+    if ( histograms ) codec_start = std::chrono::steady_clock::now();
+
+    // encoders always take ODE XML.
+    if ( binary_input && codec.decode_functionality() ) {
+        // the encodings of a raw binary message come from its header when it has one, otherwise from the configuration.
+        const char* encodings = input_encodings.data();
+        std::size_t encodings_length = input_encodings.size();
+
+        RdKafka::Headers* headers = message->headers();
+        RdKafka::Headers::Header header{ input_encodings_header, nullptr, 0 };
+
+        if ( headers ) {
+            header = headers->get_last( input_encodings_header );
+            if ( header.err() == RdKafka::ERR_NO_ERROR && header.value() ) {
+                encodings = static_cast<const char*>( header.value() );
+                encodings_length = header.value_size();
+            }
+        }
+
+        if ( input_stream ) {
+            return process_stream_message( message, codec, output_message_stream, encodings, encodings_length, topic );
+        }
+
+        success = codec.process_bytes( message->payload(), message->len(), encodings, encodings_length, output_message_stream );
+
+    } else {
+        success = codec.process( message->payload(), message->len(), output_message_stream );
+    }
+
+    std::chrono::steady_clock::time_point codec_end;
+    if ( histograms ) codec_end = std::chrono::steady_clock::now();
+
+    if ( !success ) ++msg_error_count;
+
+    // the offset becomes committable when the delivery report for this response arrives.
+    CommitManager::Token* token = nullptr;
+    if ( commit_interval > 0 ) {
+        token = commit_manager.track( message->topic_name(), message->partition(), message->offset() );
+    }
+
+    // a message that fails again while it is reprocessed keeps only its error response.
+    if ( !success && !quarantine_topic_name.empty() && !reprocess ) {
+        quarantine( message, codec );
+    }
+
+    if ( !success && error_dropped( codec, message->topic_name(), message->partition() ) ) {
+        // nothing is produced, so the offset is done now.
+        output_message_stream.reset();
+        if ( token ) commit_manager.complete( token );
+    } else {
+        produce_response( codec, output_message_stream, message->partition(), topic, token );
+    }
+
+    if ( histograms ) {
+        // produce includes the waits for room in a full queue.
+        record_latencies( codec, success,
+                std::chrono::duration_cast<std::chrono::nanoseconds>( codec_end - codec_start ).count(),
+                std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - codec_end ).count() );
+    }
+
+	SPDLOG_TRACE(ilogger, "{}: finished...", fnname);
+    return success;
+}
+
+bool ASN1_Codec::process_stream_message( RdKafka::Message* message, CodecContext& codec, ProduceStream& output_message_stream, const char* encodings, std::size_t encodings_length, std::size_t topic ) {
+
+    static const char* fnname = "process_stream_message()";
+
+    // a PDU may start in one message and end in the next message of the same partition.
+    std::string stream = message->topic_name() + ':' + std::to_string( message->partition() );
+    bool all_success = true;
+
+    std::size_t responses = codec.process_stream( stream, message->payload(), message->len(), encodings, encodings_length, output_message_stream,
+            [&]( bool success ) {
+                if ( !success ) {
+                    ++msg_error_count;
+                    all_success = false;
+
+                    if ( error_dropped( codec, message->topic_name(), message->partition() ) ) {
+                        output_message_stream.reset();
+                        return;
+                    }
+                }
+                produce_response( codec, output_message_stream, message->partition(), topic, nullptr );
+            } );
+
+    // responses are produced as their PDUs complete, so the offset becomes committable once the message is consumed;
+    // a PDU that is still carried when the ACM restarts is not decoded.
+    if ( commit_interval > 0 ) {
+        commit_manager.complete( commit_manager.track( message->topic_name(), message->partition(), message->offset() ) );
+    }
+
+    SPDLOG_TRACE(ilogger, "{}: {} responses; {} bytes carried", fnname, responses, codec.carried_bytes( stream ) );
+    return all_success;
+}
+
+bool ASN1_Codec::produce_response( const CodecContext& codec, ProduceStream& output_message_stream, int32_t input_partition, std::size_t topic, CommitManager::Token* token ) {
+
+    static const char* fnname = "produce_response()";
+
+    if ( filtered( codec ) ) {
+        // nothing is produced, so the offset is done now.
+        output_message_stream.reset();
+        if ( token ) commit_manager.complete( token );
+        SPDLOG_TRACE(ilogger, "{}: the message was filtered.", fnname );
+        return true;
+    }
+
+    // this waits for the verifier, which has been checking the signatures while the codec decoded.
+    SignatureVerifier::Status signature = codec.signature_status();
+
+    if ( verify_drop && signature == SignatureVerifier::Status::INVALID ) {
+        output_message_stream.reset();
+        if ( token ) commit_manager.complete( token );
+        ++msg_filt_count;
+        SPDLOG_TRACE(ilogger, "{}: the message has an invalid signature.", fnname );
+        return true;
+    }
+
+    // a rule for the messageId of the response's MessageFrame takes the place of the consumed topic's output; a
+    // diverted BSM goes to its filter's output.
+    if ( !message_routes.empty() && codec.message_id() >= 0 ) {
+        auto rule = message_routes.find( codec.message_id() );
+        if ( rule != message_routes.end() ) topic = rule->second;
+    }
+
+    if ( codec.verdict() == BsmFilter::Verdict::DIVERT ) topic = geofence_topic;
+
+    // librdkafka neither copies nor frees the pooled buffer; the delivery report returns it to the pool.
+    ProduceItem item{ nullptr, 0, partitioner->partition( topic, input_partition ), topic, nullptr, token };
+    item.buffer = output_message_stream.release( item.size );
+
+    // librdkafka copies the key; the default partitioner puts the responses with one key in one partition.
+    if ( message_key_fields ) item.key = codec.message_key();
+
+    // a payload only response carries its envelope in headers, and a signed one its signature status; librdkafka owns
+    // the headers once produce succeeds.
+    item.headers = make_headers( codec.response_metadata(), signature );
+
+    // the responses of a produce partition, or of a key that librdkafka places, all go to one produce thread and stay
+    // in order.
+    if ( !producers.empty() ) {
+        std::size_t lane = item.partition >= 0 ? static_cast<std::size_t>( item.partition ) : item.key.empty() ? 0 : std::hash<std::string>{}( item.key );
+        std::size_t id = lane % produce_queues.size();
+        if ( produce_queues[id]->push( item ) ) {
+            SPDLOG_TRACE(ilogger, "{}: response queued for producer {}", fnname, id );
+            return true;
+        }
+    }
+
+    return produce_item( item );
 }
 
-enum asn_transfer_syntax ASN1_Codec::get_ats_transfer_syntax( const char* ats ) {
+bool ASN1_Codec::produce_item( ProduceItem& item ) {
+
+    static const char* fnname = "produce_item()";
+    RdKafka::ErrorCode status;
+
+    auto produce = [&]() {
+        const void* key = item.key.empty() ? NULL : item.key.data();
+        if ( item.headers ) {
+            return producer_ptr->produce(output_topic_names[item.topic], item.partition, 0, item.buffer, item.size, key, item.key.size(), 0, item.headers, item.token);
+        }
+        return producer_ptr->produce(output_topics[item.topic].get(), item.partition, 0, item.buffer, item.size, key, item.key.size(), item.token);
+    };
+
+    status = produce();
+
+    // a full local queue drains as the poll thread serves delivery reports; wait for room instead of dropping the
+    // response. The waiting stops this thread, which in turn stops the stages before it when their queues fill. A
+    // queue that does not drain, e.g., with the brokers unreachable, fails the response after produce_wait_ms, so the
+    // threads can still be stopped.
+    if ( status == RdKafka::ERR__QUEUE_FULL ) {
+        ilogger->warn("{}: the producer queue is full; waiting to produce.", fnname );
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( produce_wait_ms );
+
+        while ( status == RdKafka::ERR__QUEUE_FULL && std::chrono::steady_clock::now() < deadline ) {
+            ++produce_retry_count;
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+            status = produce();
+        }
+    }
+
+    if (status != RdKafka::ERR_NO_ERROR) {
+        // on failure there is no delivery report; the buffer still belongs to us. The message is resolved as failed,
+        // so its partition still commits.
+        output_pool.release( item.buffer );
+        delete item.headers;
+        commit_manager.complete( item.token, false );
+        ++produce_error_count;
+        elogger->error("{}: Failure to produce the response: {}", fnname , RdKafka::err2str( status ));
+        return false;
+    }
+
+    // successfully sent; update counters.
+    msg_send_count++;
+    msg_send_bytes += item.size;
+    SPDLOG_TRACE(ilogger, "{}: successful encoding/decoding", fnname );
+    return true;
+}
 
-    enum asn_transfer_syntax r = ATS_INVALID;
+bool ASN1_Codec::make_codecs() {
 
-    if ( std::strcmp( ats, "UPER" ) == 0 ) {
+    static const char* fnname = "make_codecs()";
 
-        r = ATS_UNALIGNED_BASIC_PER;
+    // the old archives close their files.
+    codecs.clear();
+    archives.clear();
 
-    } else if ( std::strcmp( ats, "COER" ) == 0 ) {
+    // the new codecs start with empty caches and arenas.
+    for ( auto& reported : memory_reported ) {
+        if ( !memory_budget ) break;
+        memory_budget->adjust( MemoryBudget::Component::CACHES, reported.first, 0 );
+        memory_budget->adjust( MemoryBudget::Component::ARENAS, reported.second, 0 );
+    }
+    memory_reported.assign( worker_threads, std::make_pair( 0, 0 ) );
+
+    for ( std::size_t i = 0; i < worker_threads; ++i ) {
+        codecs.emplace_back( new CodecContext{ ilogger, elogger, decode_functionality } );
+
+        codecs.back()->set_arena_retain( arena_retain() );
+        codecs.back()->use_arena( asn1_arena_size );
+        codecs.back()->use_xml_pool( xml_pool_size );
+        codecs.back()->set_splice_output( splice_output );
+        codecs.back()->set_slice_input( slice_input );
+        codecs.back()->set_dom_input( dom_input );
+        codecs.back()->set_base64_output( base64_output );
+        codecs.back()->set_scan_envelope( scan_envelope );
+        codecs.back()->set_concatenated_pdus( concatenated_pdus );
+        codecs.back()->set_bsm_fast_path( bsm_fast_path );
+        codecs.back()->set_compact_xer( compact_xer );
+        codecs.back()->set_projection( projection );
+        codecs.back()->use_decode_cache( decode_cache_size );
+        codecs.back()->use_map_cache( map_cache_size );
+        codecs.back()->use_spat_delta( spat_delta, spat_snapshot_seconds );
+        codecs.back()->set_verifier( verifier.get() );
+        codecs.back()->use_encode_cache( encode_cache_size );
+        codecs.back()->use_encode_templates( encode_templates );
+        codecs.back()->set_json_output( json_output );
+        codecs.back()->set_message_key( message_key_fields );
+        codecs.back()->set_payload_only( output_headers );
+        codecs.back()->set_stage_timing( histogram_interval > 0 );
+        codecs.back()->set_budget( message_budget );
+
+        set_validation_policies( i );
+        set_lazy_decode( i );
+
+        if ( !codecs.back()->load_error_template( error_template_file ) ) {
+            elogger->error("{}: cannot build the codec for worker {}.", fnname , i );
+            return false;
+        }
 
-        r = ATS_CANONICAL_OER;
+        if ( !archive_settings.uri.empty() ) {
+            // the file names of every ACM and worker differ.
+            char host[256] = "acm";
+            gethostname( host, sizeof( host ) - 1 );
+            try {
+                archives.emplace_back( new BsmArchive{ archive_settings, std::string{ host } + '-' + std::to_string( i ), elogger } );
+            } catch ( std::exception& e ) {
+                elogger->error("{}: cannot build the archive for worker {}: {}", fnname , i, e.what() );
+                return false;
+            }
+            codecs.back()->set_archive( archives.back().get() );
+        }
 
-    } else if ( std::strcmp( ats, "XER" ) == 0 ) {
+        add_filters( *codecs.back() );
+    }
 
-        r = ATS_BASIC_XER;
+    return true;
+}
 
-    } else if ( std::strcmp( ats, "CPER" ) == 0 ) {
+void ASN1_Codec::add_filters( CodecContext& codec ) {
 
-        r = ATS_UNALIGNED_CANONICAL_PER;
+    codec.clear_filters();
+    if ( geofence_filter ) codec.add_filter( geofence_filter.get() );
+    if ( deduplicator ) codec.add_filter( deduplicator.get() );
+    if ( rate_limiter ) codec.add_filter( rate_limiter.get() );
+    if ( trajectories ) codec.add_filter( trajectories.get() );
+}
 
-    } else if ( std::strcmp( ats, "CXER" ) == 0 ) {
-        
-        r = ATS_CANONICAL_XER;
+bool ASN1_Codec::filtered( const CodecContext& codec ) {
 
-    } else if ( std::strcmp( ats, "BER" ) == 0 ) {
+    msg_filt_count += codec.dropped_frames();
+    msg_filt_bytes += codec.dropped_bytes();
+    return codec.verdict() == BsmFilter::Verdict::DROP;
+}
 
-        r = ATS_BER;
+bool ASN1_Codec::error_dropped( const CodecContext& codec, const std::string& topic, int32_t partition ) {
 
-    } else if ( std::strcmp( ats, "DER" ) == 0 ) {
+    return error_breaker && !error_breaker->report( topic, partition, static_cast<uint32_t>( codec.error_type() ) );
+}
 
-        r = ATS_DER;
+void ASN1_Codec::log_error_storms() {
 
-    } else if ( std::strcmp( ats, "CER" ) == 0 ) {
+    static const char* fnname = "log_error_storms()";
 
-        r = ATS_CER;
+    next_error_summary = std::chrono::steady_clock::now() + std::chrono::milliseconds( error_breaker->window() );
 
+    // one line per source in a storm takes the place of its dropped error responses.
+    for ( const ErrorBreaker::Summary& summary : error_breaker->summaries() ) {
+        elogger->warn("{}: {}:{} sent {} errors; {} reported, {} dropped ({} request, {} data); the breaker is {}.", fnname,
+                summary.topic, summary.partition, summary.errors, summary.reported,
+                summary.errors - summary.reported,
+                summary.suppressed[ static_cast<std::size_t>( Asn1ErrorType::REQUEST ) ],
+                summary.suppressed[ static_cast<std::size_t>( Asn1ErrorType::DATA ) ],
+                summary.open ? "open" : "closed" );
     }
-
-    return r;
 }
 
-bool ASN1_Codec::process_message(RdKafka::Message* message, std::stringstream& output_message_stream ) {
+void ASN1_Codec::request_diagnostics() {
 
-    static const char* fnname = "process_message()";
-    static std::string tsname;
-    static RdKafka::MessageTimestamp ts;
-    
-    // flags for type of decoding required.
-    pugi::xml_parse_result parse_result;
+    static const char* fnname = "request_diagnostics()";
 
-    size_t bytes_processed = 0;
+    {
+        std::lock_guard<std::mutex> lock{ diagnostics_mutex };
+        codec_reports.assign( codecs.size(), CodecReport{} );
+    }
 
-	ilogger->trace("{}: starting...", fnname);
+    if ( workers.empty() ) {
+        // the only codec is used on this thread.
+        report_codec( 0 );
+    } else {
+        // a full worker's counters are missing from the dump rather than waited for.
+        for ( auto& q : work_queues ) {
+            WorkItem item{ nullptr, std::chrono::steady_clock::now(), nullptr, 0 };
+            q->try_push( item, 0 );
+        }
+    }
 
-    switch (message->err()) {
+    diagnostics_pending = true;
+    diagnostics_due = std::chrono::steady_clock::now() + std::chrono::milliseconds( 200 );
+    ilogger->info("{}: diagnostics requested.", fnname );
+}
 
-        case RdKafka::ERR__TIMED_OUT:
-            ilogger->info("{}: Waiting for more BSMs.", fnname );
-            break;
+void ASN1_Codec::report_codec( std::size_t id ) {
+    const CodecContext& codec = *codecs[id];
+    CodecReport report{ true, codec.decode_cache_stats(), codec.map_cache_stats(), codec.encode_cache_stats(),
+        codec.validation_stats(), codec.budget_stats(), codec.arena_bytes(), AllocCounter::thread_counts() };
 
-        case RdKafka::ERR__MSG_TIMED_OUT:
-            ilogger->info("{}: Waiting for more BSMs from the ODE producer.", fnname );
-            break;
+    std::lock_guard<std::mutex> lock{ diagnostics_mutex };
+    if ( id < codec_reports.size() ) codec_reports[id] = report;
+}
 
-        case RdKafka::ERR_NO_ERROR:
-            /* Real message */
-            msg_recv_count++;
-            msg_recv_bytes += message->len();
+void ASN1_Codec::dump_diagnostics() {
 
-            ilogger->trace("{}: Read message at byte offset: {} with length {}", fnname , message->offset(), message->len() );
+    static const char* fnname = "dump_diagnostics()";
 
-            ts = message->timestamp();
+    diagnostics_pending = false;
 
-            if (ts.type != RdKafka::MessageTimestamp::MSG_TIMESTAMP_NOT_AVAILABLE) {
-                if (ts.type == RdKafka::MessageTimestamp::MSG_TIMESTAMP_CREATE_TIME) {
-                    tsname = "create time";
-                } else if (ts.type == RdKafka::MessageTimestamp::MSG_TIMESTAMP_LOG_APPEND_TIME) {
-                    tsname = "log append time";
-                } else {
-                    tsname = "unknown";
+    std::ostringstream os;
+
+    os << "consumed " << msg_recv_count.load() << " blocks, published " << msg_send_count.load() << ", filtered "
+        << msg_filt_count.load() << ", errors " << msg_error_count.load() << ", not produced " << produce_error_count.load() << '\n';
+
+    os << "worker queues:";
+    for ( std::size_t i = 0; i < work_queues.size(); ++i ) {
+        os << ' ' << i << '=' << work_queues[i]->size() << '/' << worker_backlog[i].load();
+    }
+    os << " (queued/given); produce queues:";
+    for ( std::size_t i = 0; i < produce_queues.size(); ++i ) {
+        os << ' ' << i << '=' << produce_queues[i]->size();
+    }
+    os << "; held " << held_items.size() << " messages of " << paused_partitions.size() << " paused partitions\n";
+
+    if ( memory_budget ) {
+        os << "memory budget:";
+        for ( std::size_t i = 0; i < MemoryBudget::components; ++i ) {
+            MemoryBudget::Component c = static_cast<MemoryBudget::Component>( i );
+            os << ' ' << MemoryBudget::name( c ) << ' ' << memory_budget->in_use( c ) << '/' << memory_budget->high_water( c )
+                << '/' << memory_budget->limit( c );
+        }
+        os << " (bytes/high water/limit)\n";
+    }
+
+    // the histograms are left for the periodic log.
+    if ( histograms ) {
+        LatencyHistogram::Snapshot snapshot;
+        for ( std::size_t ops = 0; ops < histogram_types; ++ops ) {
+            for ( int outcome = 0; outcome < 2; ++outcome ) {
+                for ( std::size_t stage = 0; stage < histogram_stages; ++stage ) {
+                    histograms[ histogram_index( static_cast<uint32_t>( ops ), outcome == 0, stage ) ].peek( snapshot );
+                    if ( snapshot.count == 0 ) continue;
+
+                    const char* stage_name = stage < static_cast<std::size_t>( CodecStage::COUNT ) ? codecstages[stage] : ( stage == histogram_stages - 2 ? "codec" : "produce" );
+                    os << "latency " << histogram_type_names[ops] << ' ' << ( outcome == 0 ? "success" : "error" ) << ' ' << stage_name << ": n=" << snapshot.count
+                        << " p50=" << snapshot.percentile( 0.5 ) << " p99=" << snapshot.percentile( 0.99 ) << " max=" << snapshot.max << " ns\n";
                 }
+            }
+        }
+    }
 
-                ilogger->trace("{}: Message timestamp: {}, type: {}", fnname , tsname, ts.timestamp);
+    auto hit_rate = []( const ResultCache::Stats& stats ) {
+        uint64_t lookups = stats.hits + stats.misses;
+        return lookups ? 100.0 * stats.hits / lookups : 0.0;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock{ diagnostics_mutex };
+        for ( std::size_t i = 0; i < codec_reports.size(); ++i ) {
+            const CodecReport& r = codec_reports[i];
+            if ( !r.ready ) {
+                os << "codec " << i << ": busy; no counters\n";
+                continue;
             }
 
-            if ( message->key() ) {
-                ilogger->trace("{}: Message key: {}", fnname , *message->key() );
+            os << std::fixed << std::setprecision( 1 ) << "codec " << i
+                << ": decode cache " << hit_rate( r.decode_cache ) << "% of " << r.decode_cache.hits + r.decode_cache.misses << ", " << r.decode_cache.bytes << " bytes"
+                << "; MAP cache " << hit_rate( r.map_cache ) << "% of " << r.map_cache.hits + r.map_cache.misses << ", " << r.map_cache.bytes << " bytes"
+                << "; encode cache " << hit_rate( r.encode_cache ) << "% of " << r.encode_cache.hits + r.encode_cache.misses << ", " << r.encode_cache.bytes << " bytes"
+                << "; constraints " << r.validation.checked << " checked, " << r.validation.violations << " violations"
+                << "; over limits " << r.budget.oversize + r.budget.memory + r.budget.time
+                << "; arena " << r.arena_bytes << " bytes";
+            if ( AllocCounter::enabled() ) {
+                os << "; " << r.allocations.allocations << " allocations of " << r.allocations.bytes << " bytes";
             }
+            os << '\n';
+        }
+    }
+
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 heap = mallinfo2();
+    os << "allocator: " << heap.arena << " bytes from sbrk, " << heap.hblkhd << " mapped, " << heap.uordblks << " in use, "
+        << heap.fordblks << " free\n";
+#endif
+#endif
 
-            // already verified non-zero message length.
+    for ( const CommitManager::Position& p : commit_manager.positions() ) {
+        os << "partition " << p.topic << ':' << p.partition << ": commit " << p.next << ", last tracked " << p.last
+            << ", " << p.pending << " pending\n";
+    }
 
-            parse_result = input_doc.load_buffer((const void*) message->payload(), message->len(), xml_parse_options );
+    if ( slow_messages ) {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+        for ( const SlowMessages::Message& m : slow_messages->recent() ) {
+            os << "slow message " << m.topic << ':' << m.partition << '@' << m.offset << ": " << m.ns / 1000 << " us, "
+                << ( now_ms - m.at_ms ) / 1000 << " s ago\n";
+        }
+    }
 
-            if (!parse_result) {
-                erroross.str("");
-                erroross << "Input file parse error: " << parse_result.description() << " at offset " << parse_result.offset;
-                throw UnparseableInputError{ erroross.str() };
-            } 
+    std::string dump = os.str();
 
-            // examine the input xml encodings information and set the flags and requirements needed to properly parse
-            // the byte strings.
-            set_codec_requirements( input_doc );        // throws UnparseableInputErrors
+    if ( !diagnostics_file.empty() ) {
+        CoarseClock clock;
+        std::ofstream file{ diagnostics_file, std::ios::app };
+        file << "diagnostics at " << clock.now() << '\n' << dump << '\n';
+        if ( file ) {
+            ilogger->info("{}: diagnostics written to {}", fnname, diagnostics_file );
+            return;
+        }
+        elogger->error("{}: cannot write the diagnostics to {}; they are logged.", fnname, diagnostics_file );
+    }
 
-            payload_node_ = ode_payload_query.evaluate_node( input_doc ).node();
+    std::size_t begin = 0;
+    for ( std::size_t end = dump.find( '\n' ); end != std::string::npos; begin = end + 1, end = dump.find( '\n', begin ) ) {
+        ilogger->info("diagnostics: {}", dump.substr( begin, end - begin ) );
+    }
+}
 
-            if ( !payload_node_ ) {
-                throw UnparseableInputError{ "Failed to find the OdeAsn1Data/payload/data field in the input file." };
-            }
+void ASN1_Codec::warm_up() {
 
-            if ( decode_functionality ) {
-                decode_message( payload_node_, output_message_stream );          // throws
-            } else {
-                encode_message( output_message_stream );          // throws
-            }
-                
-            return true;
-            break;
+    static const char* fnname = "warm_up()";
 
-        case RdKafka::ERR__PARTITION_EOF:
-            ilogger->info("ODE BSM consumer partition end of file, but ASN1_Codec still alive.");
-            if (exit_eof) {
-                eof_cnt++;
+    if ( warmup_rounds == 0 || warmup_files.empty() ) return;
 
-                if (eof_cnt == partition_cnt) {
-                    ilogger->info("EOF reached for all {} partition(s)", partition_cnt);
-                    data_available = false;
+    std::vector<std::pair<std::vector<char>, bool>> samples;
+    for ( const auto& file : warmup_files ) {
+        std::ifstream ifs{ file.first, std::ios::binary };
+        std::vector<char> sample{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+        if ( sample.empty() ) {
+            ilogger->warn("{}: cannot read the warm-up sample: {}", fnname, file.first );
+            continue;
+        }
+        samples.emplace_back( std::move( sample ), file.second );
+    }
+
+    if ( samples.empty() ) return;
+
+    auto start = std::chrono::steady_clock::now();
+    ProduceStream output_msg_stream{ 4096, &output_pool };
+
+    // the responses are thrown away; the samples only grow the buffers, arenas, and caches to their working size.
+    for ( auto& codec : codecs ) {
+        // nor are the samples archived, filtered, remembered by the SPaT delta, or verified.
+        BsmArchive* archive = codec->archive();
+        codec->set_archive( nullptr );
+        codec->clear_filters();
+        codec->use_spat_delta( false );
+        codec->set_verifier( nullptr );
+
+        for ( int round = 0; round < warmup_rounds; ++round ) {
+            for ( const auto& sample : samples ) {
+                try {
+                    codec->set_decode_functionality( sample.second );
+                    if ( binary_input && sample.second ) {
+                        codec->process_bytes( sample.first.data(), sample.first.size(), input_encodings.data(), input_encodings.size(), output_msg_stream );
+                    } else {
+                        codec->process( sample.first.data(), sample.first.size(), output_msg_stream );
+                    }
+                } catch ( std::exception& e ) {
+                    ilogger->warn("{}: warm-up sample exception: {}", fnname, e.what() );
                 }
+                output_msg_stream.reset();
             }
-            break;
+        }
 
-        case RdKafka::ERR__UNKNOWN_TOPIC:
-            elogger->error("cannot consume due to an UNKNOWN consumer topic: {}", message->errstr());
+        codec->set_decode_functionality( decode_functionality );
+        codec->set_archive( archive );
+        codec->use_spat_delta( spat_delta, spat_snapshot_seconds );
+        codec->set_verifier( verifier.get() );
+        add_filters( *codec );
+    }
 
-        case RdKafka::ERR__UNKNOWN_PARTITION:
-            elogger->error("cannot consume due to an UNKNOWN consumer partition: {}", message->errstr());
-            data_available = false;
-            break;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start ).count();
+    ilogger->info("{}: {} codecs processed {} samples {} times in {} ms.", fnname, codecs.size(), samples.size(), warmup_rounds, ms );
+}
 
-        default:
-            elogger->error("cannot consume due to an error: {}", message->errstr());
-            data_available = false;
+void ASN1_Codec::signal_ready( bool ready ) {
+
+    static const char* fnname = "signal_ready()";
+
+    if ( ready_file.empty() ) return;
+
+    if ( !ready ) {
+        std::remove( ready_file.c_str() );
+        return;
     }
 
-	ilogger->trace("{}: finished...", fnname);
-    return false;
+    std::ofstream ofs{ ready_file, std::ios::trunc };
+    ofs << "ready\n";
+    if ( !ofs ) {
+        elogger->error("{}: cannot write the readiness file: {}", fnname, ready_file );
+        return;
+    }
+
+    ilogger->info("{}: ready; wrote {}", fnname, ready_file );
 }
 
-bool ASN1_Codec::decode_message( pugi::xml_node& payload_node, std::stringstream& output_message_stream ) {
+bool ASN1_Codec::reload() {
+
+    static const char* fnname = "reload()";
 
-    static const char* fnname = "decode_message()";
-    bool success = true;
-    pugi::xml_parse_result parse_result;
+    // the settings applied without restarting the consumer; the others configure the Kafka clients, the topics, or
+    // the operation of the codecs.
+    static const std::unordered_set<std::string> reloadable{ "acm.log.level", "acm.log.error.level",
+        "acm.consume.batch.size", "acm.consume.batch.timeout.ms", "acm.decode.cache.bytes", "acm.encode.cache.bytes",
+        "acm.map.cache.bytes",
+        "acm.validate", "acm.validate.Ieee1609Dot2Data", "acm.validate.MessageFrame", "acm.validate.AdvisorySituationData",
+        "acm.worker.threads" };
 
-    buffer_structure_t xb = {0, 0, 0};
+    const std::string& cfile = optString('c');
+    std::vector<std::pair<std::string, std::string>> settings;
 
-    ilogger->trace("{}: starting...", fnname);
+    if ( !read_settings( cfile, settings ) ) {
+        elogger->error("{}: cannot open configuration file: {}; keeping the running configuration.", fnname, cfile );
+        return false;
+    }
 
-    if ( !decode_1609dot2 && !decode_messageframe ) {
-        // if neither of these is set, this function becomes a noop and nothing will be returned, so this is an
-        // exception.
-        throw MissingInputElementError{"An decoder was not specified in the encodingType tag that this module understands."};
+    std::unordered_map<std::string, std::string> next;
+    for ( const auto& setting : settings ) {
+        next[ setting.first ] = setting.second;
     }
 
-    // access this directly because we remove the bytes branch.
-    pugi::xml_text text = payload_node.child("bytes").text();
+    std::vector<std::string> changed;
+    for ( const auto& setting : next ) {
+        auto it = file_settings.find( setting.first );
+        if ( it == file_settings.end() || it->second != setting.second ) changed.push_back( setting.first );
+    }
+    for ( const auto& setting : file_settings ) {
+        if ( next.find( setting.first ) == next.end() ) changed.push_back( setting.first );
+    }
 
-    if ( text ) {
-        // store the bytes and remove the bytes node since we replace it.
-        std::string hstr{ text.get() };
-        payload_node.remove_child("bytes");
+    auto previous_pconf = pconf;
+    auto previous_settings = file_settings;
+    bool rejected = false;
+    std::size_t applied = 0;
 
-        // Ieee 1609.2 is the outer frame.
-		if ( decode_1609dot2 ) {
+    for ( const auto& key : changed ) {
+        // the carried bytes of a PDU stream stay with the worker that has them.
+        if ( reloadable.find( key ) == reloadable.end() || ( key == "acm.worker.threads" && input_stream ) ) {
+            elogger->error("{}: {} cannot change without a restart; keeping the running value.", fnname, key );
+            rejected = true;
+            continue;
+        }
 
-			decode_1609dot2_data(hstr, &xb);            // throws.
+        auto it = next.find( key );
+        if ( it == next.end() ) {
+            // the running value is kept, except for a validation policy, which returns to the default.
+            pconf.erase( key );
+            file_settings.erase( key );
+            ilogger->info("{}: {} removed.", fnname, key );
+        } else {
+            pconf[ key ] = it->second;
+            file_settings[ key ] = it->second;
+            ilogger->info("{}: {} = {}", fnname, key, it->second );
+        }
 
-			// asssert success == true;
+        ++applied;
+    }
 
-			// pugi resets the document as part of load_buffer
-			parse_result = internal_doc.load_buffer(static_cast<const void *>( xb.buffer), xb.buffer_size );
+    if ( applied == 0 ) {
+        ilogger->info("{}: no setting can be changed.", fnname );
+        return !rejected;
+    }
 
-			if ( !parse_result ) {
-				erroross.str("");
-				erroross << "IEEE 1609.2 decoded XER cannot be parsed/loaded as a valid document: " << parse_result.description() << " at offset " << parse_result.offset;
-				throw Asn1CodecError{ erroross.str() };
-			}
+    std::size_t threads = worker_threads;
+    std::size_t decode_cache = decode_cache_size;
+    std::size_t map_cache = map_cache_size;
+    std::size_t encode_cache = encode_cache_size;
+
+    if ( !configure_reloadable() ) {
+        // restore every setting; the previous ones were read successfully.
+        elogger->error("{}: the new configuration is rejected; keeping the running configuration.", fnname );
+        pconf = previous_pconf;
+        file_settings = previous_settings;
+        configure_reloadable();
+        return false;
+    }
 
-			// XPath search the IEEE structure for the unsecured data.
-			pugi::xpath_node unsecuredDataNode = ieee1609dot2_unsecuredData_query.evaluate_node( internal_doc );
-			text = unsecuredDataNode.node().text();
+    // the workers process the messages already given to them before their codecs change.
+    stop_workers();
 
-			if ( !text ) throw Asn1CodecError{"IEEE 1609.2 internal XER unsecuredData element could not be found."};
+    if ( worker_threads != threads ) {
+        if ( !make_codecs() ) {
+            elogger->critical("{}: cannot build {} codecs; stopping.", fnname, worker_threads );
+            data_available = false;
+            bootstrap = false;
+            return false;
+        }
 
-			// replacing the original hex string, so the next processing step works.
-			hstr = std::string( text.get() );
-			internal_doc.reset();
-			std::free( static_cast<void *>(xb.buffer) );
-			xb = { 0,0,0 };                     // reset buffer;
-		}
+        {
+            // the metrics thread reads the queue occupancy.
+            std::lock_guard<std::mutex> lock{ report_mutex };
+            make_work_queues();
+        }
 
-		if ( success && decode_messageframe ) {
+        warm_up();
 
-			decode_messageframe_data( hstr, &xb );          // throws.
+    } else {
+        for ( std::size_t i = 0; i < codecs.size(); ++i ) {
+            if ( decode_cache_size != decode_cache ) codecs[i]->use_decode_cache( decode_cache_size );
+            if ( map_cache_size != map_cache ) codecs[i]->use_map_cache( map_cache_size );
+            if ( encode_cache_size != encode_cache ) codecs[i]->use_encode_cache( encode_cache_size );
+            codecs[i]->set_arena_retain( arena_retain() );
+            set_validation_policies( i );
+        }
+    }
 
-			// asssert success == true;
+    start_workers();
 
-			// eliminate the original hex string, so the new XML can be inserted.
-			payload_node.text().set("");
-			parse_result = internal_doc.load_buffer( static_cast<const void *>( xb.buffer), xb.buffer_size );
+    ilogger->info("{}: applied {} changed settings from {}.", fnname, applied, cfile );
+    return !rejected;
+}
 
-			if ( !parse_result ) {
-				erroross.str("");
-				erroross <<"J2735 decoded XER cannot be parsed/loaded as a valid document: "<< parse_result.description() << " at offset " << parse_result.offset;
-				throw Asn1CodecError{ erroross.str() };
-			}
+void ASN1_Codec::make_work_queues() {
 
-			payload_node.append_copy( internal_doc.document_element() );
+    work_queues.clear();
+    for ( std::size_t i = 0; codecs.size() > 1 && i < codecs.size(); ++i ) {
+        work_queues.emplace_back( new LaneQueue<WorkItem>{ lane_count, worker_queue_size, priority_weight } );
+    }
+    worker_backlog.reset( new std::atomic<uint64_t>[ codecs.size() ] );
+    for ( std::size_t i = 0; i < codecs.size(); ++i ) worker_backlog[i] = 0;
+}
 
-			if ( !payload_node.parent().child("dataType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::XML)] ) ) {
-				throw MissingInputElementError{"Could not update the dataType field of the payload section."};
-			}
+void ASN1_Codec::worker( std::size_t id ) {
 
-			std::free( static_cast<void *>(xb.buffer) );
-		}
+    static const char* fnname = "worker()";
 
+    // pinned before anything is allocated, so the worker's buffers and arena chunks are on its NUMA node.
+    if ( worker_cpus.empty() ) {
+        pin_thread( worker_cpus, "worker" );
     } else {
-        throw MissingInputElementError{"failure accessing input XML bytes node."};
+        pin_thread( { worker_cpus[ id % worker_cpus.size() ] }, "worker" );
     }
 
-    // convert DOM to a RAW string representation: no spaces, no tabs.
-    input_doc.save(output_message_stream,"",pugi::format_raw);
-    ilogger->trace("{}: finished...", fnname);
-    return success;
-} 
+    ProduceStream output_msg_stream{ 4096, &output_pool };
+    WorkItem item;
+    CodecContext& codec = *codecs[id];
+
+    ilogger->trace("{}: worker {} starting...", fnname , id );
+
+    // the messages of a partition are all on this worker's queue, so they are processed and produced in order.
+    while ( work_queues[id]->pop( item ) ) {
+
+        // an item without a message asks for the codec's counters.
+        if ( !item.message ) {
+            report_codec( id );
+            continue;
+        }
+
+        auto started = metrics_endpoint ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+        try {
 
-void ASN1_Codec::encode_node_as_hex_string(bool replace) {
-    std::stringstream xml_stream;
-    std::string hex_str;
+            process_message( item.message.get(), codec, output_msg_stream );
 
-    pugi::xml_node node = payload_node_.first_element_by_path(curr_node_path_.c_str());
+        } catch ( std::exception& e ) {
+
+            // the codec reports input errors itself; anything else must not take down the worker.
+            elogger->error("{}: worker {} exception: {}", fnname , id, e.what() );
+            output_msg_stream.reset();
+        }
 
-    if (!node) {
-        throw MissingInputElementError{"Failed to find path: " + curr_node_path_ + "in the input document."};
+        processed( item );
+        if ( metrics_endpoint ) busy_ns.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - started ).count(), std::memory_order_relaxed );
+        if ( memory_budget ) {
+            memory_budget->release( MemoryBudget::Component::QUEUES, item.message->len() );
+            track_memory( id );
+        }
+        item.message.reset();
+        --worker_backlog[id];
     }
 
-    pugi::xml_node parent_node = node.parent();
+    ilogger->trace("{}: worker {} finished.", fnname , id );
+}
+
+void ASN1_Codec::start_workers() {
 
-    if (!parent_node) {
-        throw MissingInputElementError{"Failed to find parent node for: " + curr_node_path_ + "in the input document."};
+    // a single codec context is run on the consumer thread; no hand off is needed.
+    processing_threads = std::max<std::size_t>( codecs.size(), 1 );
+    if ( codecs.size() < 2 ) return;
+
+    if ( work_queues.size() != codecs.size() ) {
+        work_queues.clear();
+        for ( std::size_t i = 0; i < codecs.size(); ++i ) {
+            work_queues.emplace_back( new LaneQueue<WorkItem>{ lane_count } );
+        }
     }
 
-    // convert the child to string stream 
-    node.print(xml_stream, "", pugi::format_raw);
+    for ( auto& q : work_queues ) {
+        q->set_capacity( worker_queue_size );
+        q->set_weight( priority_weight );
+        q->open();
+    }
 
-    // remove the child node from parent
-    if ( !parent_node.remove_child(node) ) {
-        throw MissingInputElementError{"Failed to find child node in the input document."};
+    for ( std::size_t i = 0; i < codecs.size(); ++i ) {
+        workers.emplace_back( &ASN1_Codec::worker, this, i );
     }
 
-    // do the encoding
-    encode_frame_data(xml_stream.str(), hex_str);
+    ilogger->info("Started {} codec worker threads.", workers.size() );
+}
 
-    std::string node_name(node.name());
-    hex_data_.push_back(std::make_tuple(node_name, hex_str));
+void ASN1_Codec::stop_workers() {
 
-    if (!replace) {
-        return;
+    // workers drain what is already queued before they exit.
+    for ( auto& q : work_queues ) {
+        q->close();
     }
 
-    // append the hex bytes as a new node
-    if ( !parent_node.text().set(hex_str.c_str()) ) {
-        throw MissingInputElementError{"Failure to append hex bytes to the output document."};
+    for ( auto& w : workers ) {
+        if ( w.joinable() ) w.join();
     }
+
+    workers.clear();
 }
 
-void ASN1_Codec::encode_for_protocol() {
-    for (auto& part : protocol_) {
-        curr_op_ = std::get<0>(part);
-        curr_decode_type_ = std::get<1>(part);
-        curr_node_path_ = std::get<2>(part);
+void ASN1_Codec::quarantine( RdKafka::Message* message, const CodecContext& codec ) {
 
-        encode_node_as_hex_string(std::get<3>(part));
+    ProduceItem item{ nullptr, message->len(), RdKafka::Topic::PARTITION_UA, quarantine_topic, nullptr, nullptr };
+
+    item.buffer = output_pool.acquire();
+    if ( OutputBufferPool::capacity( item.buffer ) < item.size ) item.buffer = output_pool.grow( item.buffer, item.size );
+    std::memcpy( item.buffer, message->payload(), item.size );
+
+    if ( message->key() ) item.key = *message->key();
+
+    // the input's headers, e.g., the encodings of a binary message, are kept so it can be decoded the same way.
+    item.headers = message->headers() ? RdKafka::Headers::create( message->headers()->get_all() ) : RdKafka::Headers::create();
+    item.headers->add( "errorType", asn1errortypes[ static_cast<int>( codec.error_type() ) ] );
+    item.headers->add( "sourceTopic", message->topic_name() );
+    item.headers->add( "sourcePartition", std::to_string( message->partition() ) );
+    item.headers->add( "sourceOffset", std::to_string( message->offset() ) );
+
+    if ( commit_interval > 0 ) {
+        item.token = commit_manager.track( message->topic_name(), message->partition(), message->offset() );
     }
 
-    for (auto& data : hex_data_) {
-        std::string node_name = std::get<0>(data);
-        std::string hex_str = std::get<1>(data);
+    ++msg_quarantine_count;
+
+    if ( !quarantine_queue || !quarantine_queue->push( item ) ) produce_item( item );
+}
+
+void ASN1_Codec::quarantine_producer() {
+
+    static const char* fnname = "quarantine_producer()";
+    ProduceItem item;
 
-        if ( !payload_node_.append_child(node_name.c_str()).append_child("bytes").text().set(hex_str.c_str()) ) {
-            throw MissingInputElementError{"Failure to append path: OdeAsn1Data/payload/data/" + node_name + "/bytes to the output document."};
+    ilogger->trace("{}: starting...", fnname );
+
+    // the responses go first: a copy waits while any produce queue is more than half full.
+    auto busy = [this]() {
+        for ( const auto& q : produce_queues ) {
+            if ( 2 * q->size() > worker_queue_size ) return true;
+        }
+        return false;
+    };
+
+    while ( quarantine_queue->pop( item ) ) {
+        while ( busy() && !quarantine_queue->closed() ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
         }
+        produce_item( item );
     }
 
-    if (!payload_node_.parent().child("dataType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::HEX)] ) ) {
-            throw MissingInputElementError{"Failure to update path: OdeAsn1Data/payload/dataType in the output document."};
+    ilogger->trace("{}: finished.", fnname );
+}
+
+void ASN1_Codec::trajectory_producer() {
+
+    static const char* fnname = "trajectory_producer()";
+    std::vector<TrajectoryAggregator::Summary> summaries;
+    std::string json;
+
+    ilogger->trace("{}: starting...", fnname );
+
+    auto period = std::chrono::milliseconds( std::min<uint32_t>( 1000, trajectories->window() ) );
+    std::unique_lock<std::mutex> lock{ trajectory_mutex };
+    bool running = true;
+
+    while ( running ) {
+        trajectory_cv.wait_for( lock, period, [this]() { return !summarizing; } );
+        running = summarizing;
+        lock.unlock();
+
+        uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+        trajectories->collect( running ? now : std::numeric_limits<uint64_t>::max(), summaries );
+
+        for ( const TrajectoryAggregator::Summary& summary : summaries ) {
+            json.clear();
+            TrajectoryAggregator::write_json( summary, json );
+
+            // keyed by the vehicle, so its summaries stay in order.
+            ProduceItem item{ nullptr, json.size(), RdKafka::Topic::PARTITION_UA, trajectory_topic, nullptr, nullptr,
+                TrajectoryAggregator::key( summary.id ) };
+            item.buffer = output_pool.acquire();
+            if ( OutputBufferPool::capacity( item.buffer ) < item.size ) item.buffer = output_pool.grow( item.buffer, item.size );
+            std::memcpy( item.buffer, json.data(), item.size );
+
+            ++msg_trajectory_count;
+            produce_item( item );
+        }
+        summaries.clear();
+
+        lock.lock();
     }
+
+    ilogger->trace("{}: finished.", fnname );
 }
 
-// throws MissingInputElementError or Asn1CodecError (from encode_messageframe_data call) ONLY!
-bool ASN1_Codec::encode_message( std::stringstream& output_message_stream ) {
+void ASN1_Codec::producer( std::size_t id ) {
 
-    static const char* fnname = "encode_message()";
+    static const char* fnname = "producer()";
+    ProduceItem item;
 
-    protocol_.clear();
-    hex_data_.clear();
+    pin_thread( producer_cpus, "produce" );
+    ilogger->trace("{}: producer {} starting...", fnname , id );
 
-    switch (opsflag) {
-        case IEEE1609DOT2:
-            protocol_.push_back(std::make_tuple(IEEE1609DOT2, decode_1609dot2_type, "Ieee1609Dot2Data", false));
+    // librdkafka's produce calls, and their waits for room, overlap with the codec work of the other threads.
+    while ( produce_queues[id]->pop( item ) ) {
+        produce_item( item );
+    }
 
-            break;
-        case J2735MESSAGEFRAME:
-            protocol_.push_back(std::make_tuple(J2735MESSAGEFRAME, decode_messageframe_type, "MessageFrame", false));
+    ilogger->trace("{}: producer {} finished.", fnname , id );
+}
 
-            break;
-        case IEEE1609DOT2_J2735MESSAGEFRAME:
-            protocol_.push_back(std::make_tuple(J2735MESSAGEFRAME, decode_messageframe_type, "Ieee1609Dot2Data/content/unsecuredData/MessageFrame", true));
-            protocol_.push_back(std::make_tuple(IEEE1609DOT2, decode_1609dot2_type, "Ieee1609Dot2Data", false));
+void ASN1_Codec::start_producers() {
 
-            break;
-        case ASDFRAME:
-            protocol_.push_back(std::make_tuple(ASDFRAME, decode_asdframe_type, "AdvisorySituationData", false));
+    if ( !quarantine_topic_name.empty() ) {
+        if ( !quarantine_queue ) quarantine_queue.reset( new RingQueue<ProduceItem>{} );
+        quarantine_queue->set_capacity( worker_queue_size );
+        quarantine_queue->open();
+        quarantiner = std::thread{ &ASN1_Codec::quarantine_producer, this };
+    }
 
-            break;
-        case ASDFRAME_IEEE1609DOT2:
-            protocol_.push_back(std::make_tuple(IEEE1609DOT2, decode_1609dot2_type, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data", true));
-            protocol_.push_back(std::make_tuple(ASDFRAME, decode_asdframe_type, "AdvisorySituationData", false));
+    if ( trajectories ) {
+        summarizing = true;
+        trajectory_thread = std::thread{ &ASN1_Codec::trajectory_producer, this };
+    }
 
-            break;
-        case ASDFRAME_J2735MESSAGEFRAME:
-            protocol_.push_back(std::make_tuple(J2735MESSAGEFRAME, decode_messageframe_type, "AdvisorySituationData/asdmDetails/advisoryMessage/MessageFrame", true));
-            protocol_.push_back(std::make_tuple(ASDFRAME, decode_asdframe_type, "AdvisorySituationData", false));
+    if ( produce_threads == 0 ) return;
 
-            break;
-        case ASDFRAME_IEEE1609DOT2_J2735MESSAGEFRAME:
-            protocol_.push_back(std::make_tuple(J2735MESSAGEFRAME, decode_messageframe_type, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data/content/unsecuredData/MessageFrame", true));
-            protocol_.push_back(std::make_tuple(IEEE1609DOT2, decode_1609dot2_type, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data", true));
-            protocol_.push_back(std::make_tuple(ASDFRAME, decode_asdframe_type, "AdvisorySituationData", false));
+    if ( produce_queues.size() != produce_threads ) {
+        produce_queues.clear();
+        for ( std::size_t i = 0; i < produce_threads; ++i ) {
+            produce_queues.emplace_back( new RingQueue<ProduceItem>{} );
+        }
+    }
 
+    for ( auto& q : produce_queues ) {
+        q->set_capacity( worker_queue_size );
+        q->open();
+    }
 
-            break;
-        default:
-            throw MissingInputElementError{"An encoder was not specified in the encodingType tag that this module understands."};
+    for ( std::size_t i = 0; i < produce_threads; ++i ) {
+        producers.emplace_back( &ASN1_Codec::producer, this, i );
+    }
+
+    ilogger->info("Started {} produce threads.", producers.size() );
+}
+
+void ASN1_Codec::stop_producers() {
 
+    // the producers give librdkafka what is already queued before they exit; the codec threads must be stopped first.
+    for ( auto& q : produce_queues ) {
+        q->close();
     }
-    
-    encode_for_protocol();
-    
-    // convert DOM to a RAW string representation: no spaces, no tabs.
-    // for testing.
-    input_doc.save(output_message_stream, "", pugi::format_raw);
 
-    return true;
+    for ( auto& p : producers ) {
+        if ( p.joinable() ) p.join();
+    }
+
+    producers.clear();
+
+    if ( quarantine_queue ) quarantine_queue->close();
+    if ( quarantiner.joinable() ) quarantiner.join();
+
+    {
+        std::lock_guard<std::mutex> lock{ trajectory_mutex };
+        summarizing = false;
+    }
+
+    trajectory_cv.notify_all();
+    if ( trajectory_thread.joinable() ) trajectory_thread.join();
 }
 
-/** 
- * Decodes the IEEE 1609.2 ASN.1 bytes represented by the hex string according to the instance type variable:
- * decode_1609dot2_type into its C structure, then encodes the C structure into XML. The XML is put into the xml_buffer.
- *
- * This method does not NORMALLY modify the input_doc directly.
- * This method will modify the input_doc on error. 
+bool ASN1_Codec::file_test(std::string file_path, std::ostream& os, bool encode) {
+    static const char* fnname = "file_test()";
+
+    std::stringstream output_msg_stream;
+    bool r = true;
+
+    std::FILE* ifile = std::fopen( file_path.c_str(), "r" );
+
+    if (!ifile) {
+        std::cerr << "cannot open " << file_path << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if ( codecs.empty() ) {
+        // not configured (e.g., unit tests); the error template is used when it is available.
+        codecs.emplace_back( new CodecContext{ ilogger, elogger } );
+        codecs.back()->load_error_template( error_template_file );
+    }
+
+    CodecContext& codec = *codecs[0];
+    codec.set_decode_functionality( !encode );
+
+    // compute file size in bytes.
+    std::fseek(ifile, 0, SEEK_END);
+    std::size_t ifile_size = std::ftell(ifile);
+    std::fseek(ifile, 0, SEEK_SET);
+
+    std::vector<unsigned char> consumed_xml_buffer( ifile_size );
+    std::size_t count = std::fread( consumed_xml_buffer.data(), sizeof( uint8_t ), consumed_xml_buffer.size(), ifile );
+    std::fclose( ifile );
+
+    if ( consumed_xml_buffer.size() > 0 ) {
+        msg_recv_count++;
+        msg_recv_bytes += consumed_xml_buffer.size();
+
+        r = codec.process( consumed_xml_buffer.data(), consumed_xml_buffer.size(), output_msg_stream );
+
+        os << output_msg_stream.str() << std::endl;
+    }
+
+    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Used as a test stub to bypass Kafka and work through the parsing, encoding, decoding.
  *
- * Return true on success: use the xml_buffer to generate valid XML to use to extract out the next layer.
- * Return false on failure: immediately use the input_doc to return what happened during decoding of 1609.2
  */
+bool ASN1_Codec::filetest() {
+    static const char* fnname = "filetest()";
+    bool r = true;
 
-// throws Asn1CodecError ONLY!
-bool ASN1_Codec::decode_1609dot2_data( std::string& data_as_hex, buffer_structure_t* xml_buffer ) {
-    static const char* fnname = "decode_1609dot2_data()";
+    std::stringstream output_msg_stream;
 
-    // enum asn_dec_rval_code_e {
-    // 	RC_OK,		                                  // successful decoding.
-    // 	RC_WMORE,	                                  // more data expected.
-    // 	RC_FAIL		                                  // failure to decode data.
-    // };
-    //
-    // typedef struct asn_dec_rval_s {
-    // 	enum asn_dec_rval_code_e code;                // one of the above codes.
-    // 	size_t consumed;		                      // number of bytes consumed.
-    // } asn_dec_rval_t;
-    asn_dec_rval_t decode_rval;
+    signal(SIGINT, sigterm);
+    signal(SIGTERM, sigterm);
 
-    // typedef struct asn_enc_rval_s {
-    // 	ssize_t encoded;                              // bytes encoded on success; -1 on fail
-    // 	struct asn_TYPE_descriptor_s *failed_type;    // the type that failed.
-    // 	      ->name  
-    // 	void *structure_ptr;                          // pointer to structure of that type.
-    // } asn_enc_rval_t;
-    asn_enc_rval_t encode_rval;
+    try {
 
-    errlen = max_errbuf_size;
+        if ( !configure() ) return EXIT_FAILURE;
 
-    Ieee1609Dot2Data_t *ieee1609data = 0;        // must initialize to 0 according to asn.1 instructions.
+    } catch ( std::exception& e ) {
 
-    ilogger->trace("{}: starting...", fnname);
+        std::cerr << "Fatal Exception: " << e.what() << '\n';           // logger may have failed to configure.
+        return EXIT_FAILURE;
+    }
 
-    // remove all spaces.
-    data_as_hex.erase( remove_if ( data_as_hex.begin(), data_as_hex.end(), isspace), data_as_hex.end());
+    ilogger->trace("{}: Starting...", fnname);
 
-    if (data_as_hex.empty()) {
-        throw Asn1CodecError{"failed attempt to decode IEEE 1609.2 hex string: string empty."};
+    std::FILE* ifile = std::fopen( operands[0].c_str(), "r" );
+    if (!ifile) {
+        std::cerr << "cannot open " << operands[0] << '\n';
+        return EXIT_FAILURE;
     }
 
-    ilogger->trace("{}: success extracting {} hex string: {}", fnname , asn_DEF_Ieee1609Dot2Data.name, data_as_hex );
+    // compute file size in bytes.
+    std::fseek(ifile, 0, SEEK_END);
+    std::size_t ifile_size = std::ftell(ifile);
+    std::fseek(ifile, 0, SEEK_SET);
 
-    byte_buffer.clear();
-    if (!hex_to_bytes_(data_as_hex, byte_buffer)) {
-        throw Asn1CodecError{"failed attempt to decode IEEE 1609.2 hex string: cannot convert to bytes."};
-    }
+    std::vector<unsigned char> consumed_xml_buffer( ifile_size );
+    std::size_t count = std::fread( consumed_xml_buffer.data(), sizeof( uint8_t ), consumed_xml_buffer.size(), ifile );
+    std::fclose( ifile );
+
+    if ( consumed_xml_buffer.size() > 0 ) {
 
-    ilogger->trace("{}: successful conversion to raw byte buffer.", fnname );
+        ilogger->trace("{}: successful read of the test file having {} bytes.", fnname, consumed_xml_buffer.size() );
 
-    // Decode BAH Bytes (A 1609.2 Frame) into the appropriate structure.
-    decode_rval = asn_decode( 
-            0, 
-            decode_1609dot2_type, 
-            &asn_DEF_Ieee1609Dot2Data, 
-            (void **)&ieee1609data, 
-            byte_buffer.data(), 
-            byte_buffer.size() 
-            );
+        msg_recv_count++;
+        msg_recv_bytes += consumed_xml_buffer.size();
 
-    if ( decode_rval.code != RC_OK ) {
-        erroross.str("");
-        erroross << "failed ASN.1 binary decoding of element " << asn_DEF_Ieee1609Dot2Data.name << ": ";
-        if ( decode_rval.code == RC_FAIL ) {
-            erroross << "bad data.";
+        if ( binary_input ) {
+            r = codecs[0]->process_bytes( consumed_xml_buffer.data(), consumed_xml_buffer.size(), input_encodings.data(), input_encodings.size(), output_msg_stream );
         } else {
-            erroross << "more data expected.";
+            r = codecs[0]->process( consumed_xml_buffer.data(), consumed_xml_buffer.size(), output_msg_stream );
         }
-        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
-        throw Asn1CodecError{ erroross.str() };
-    }
 
-    ilogger->trace("{}: ASN.1 binary decode success.", fnname );
+        std::cout << output_msg_stream.str() << '\n';
 
-    // check the data in the returned structure against the ASN.1 specification constraints.
-    if (asn_check_constraints( &asn_DEF_Ieee1609Dot2Data, ieee1609data, errbuf, &errlen )) {
-        erroross.str("");
-        erroross << "failed ASN.1 constraints check of element " << asn_DEF_Ieee1609Dot2Data.name << ": ";
-        erroross.write( errbuf, errlen );
-        ASN_STRUCT_FREE(asn_DEF_Ieee1609Dot2Data, ieee1609data);
-        throw Asn1CodecError{ erroross.str() };
+    } else {
+        ilogger->trace("Read an empty file.");
     }
 
-    // target form is always XML (for now).
-    encode_rval = xer_encode( 
-            &asn_DEF_Ieee1609Dot2Data, 
-            ieee1609data, 
-            XER_F_CANONICAL, 
-            dynamic_buffer_append, 
-            static_cast<void *>(xml_buffer) 
-            );
-
-    ASN_STRUCT_FREE(asn_DEF_Ieee1609Dot2Data, ieee1609data);
-
-    if ( encode_rval.encoded == -1 ) {
-        erroross.str("");
-        erroross << "failed ASN.1 XML encoding of Ieee1609Dot2Data element " << encode_rval.failed_type->name;
-        throw Asn1CodecError{ erroross.str() };
-    }
+    // NOTE: good for troubleshooting, but bad for performance.
+    ilogger->trace("{}: Finished.", fnname);
+    elogger->flush();
+    ilogger->flush();
 
-    ilogger->trace("{}: finished.", fnname );
-    return true;
+    return r ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-/**
- * TODO: This method should be generalizable to any type def and structure pointer -- tried but moved on.
- */
-bool ASN1_Codec::decode_messageframe_data( std::string& data_as_hex, buffer_structure_t* xml_buffer ) {
-    static const char* fnname = "decode_messageframe_data()";
+int ASN1_Codec::batch( const std::string& output_path ) {
+    static const char* fnname = "batch()";
 
-    asn_dec_rval_t decode_rval;
-    asn_enc_rval_t encode_rval;
+    // records processed by a worker between claims, and per worker between ordered writes of the responses.
+    static constexpr std::size_t claim_size = 64;
+    static constexpr std::size_t window_size = 1024;
 
-    errlen = max_errbuf_size;
+    signal(SIGINT, sigterm);
+    signal(SIGTERM, sigterm);
 
-    MessageFrame_t *messageframe = 0;           // must be initialized to 0.
+    try {
 
-    ilogger->trace("{}: starting...", fnname);
+        if ( !configure() ) return EXIT_FAILURE;
 
-    // remove all spaces.
-    data_as_hex.erase( remove_if ( data_as_hex.begin(), data_as_hex.end(), isspace), data_as_hex.end());
+    } catch ( std::exception& e ) {
 
-    if (data_as_hex.empty()) {
-        throw Asn1CodecError{"failed attempt to decode MessageFrame hex string: string empty."};
+        std::cerr << "Fatal Exception: " << e.what() << '\n';           // logger may have failed to configure.
+        return EXIT_FAILURE;
     }
 
-    ilogger->trace("{}: success extracting {} hex string: {}", fnname , asn_DEF_MessageFrame.name, data_as_hex );
+    std::string input_path = operands.empty() ? "-" : operands[0];
 
-    byte_buffer.clear();
-    if (!hex_to_bytes_(data_as_hex, byte_buffer)) {
-        throw Asn1CodecError{"failed attempt to decode MessageFrame hex string: cannot convert to bytes."};
+    BatchInput input{ batch_framing };
+    if ( !input.open( input_path ) ) {
+        elogger->critical("{}: cannot read {}: {}", fnname, input_path, std::strerror( errno ));
+        std::cerr << "cannot open " << input_path << '\n';
+        return EXIT_FAILURE;
     }
 
-    ilogger->trace("{}: successful conversion to raw byte buffer.", fnname );
-
-    decode_rval = asn_decode( 
-            0, 
-            decode_messageframe_type, 
-            &asn_DEF_MessageFrame,
-            (void **)&messageframe,
-            byte_buffer.data(), 
-            byte_buffer.size() 
-            );
-
-    if ( decode_rval.code != RC_OK ) {
-        erroross.str("");
-        erroross << "failed ASN.1 binary decoding of element " << asn_DEF_MessageFrame.name << ": ";
-        if ( decode_rval.code == RC_FAIL ) {
-            erroross << "bad data.";
-        } else {
-            erroross << "more data expected.";
+    std::ofstream ofile;
+    if ( output_path != "-" ) {
+        ofile.open( output_path, std::ios::binary | std::ios::trunc );
+        if ( !ofile ) {
+            elogger->critical("{}: cannot write {}: {}", fnname, output_path, std::strerror( errno ));
+            std::cerr << "cannot open " << output_path << '\n';
+            return EXIT_FAILURE;
         }
-        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
-        throw Asn1CodecError{ erroross.str() };
     }
 
-    ilogger->trace("{}: ASN.1 binary decode successful.", fnname );
+    std::ostream& os = ( output_path == "-" ) ? std::cout : ofile;
 
-    if (asn_check_constraints( &asn_DEF_MessageFrame, messageframe, errbuf, &errlen )) {
-        erroross.str("");
-        erroross << "failed ASN.1 constraints check of element " << asn_DEF_MessageFrame.name << ": ";
-        erroross.write( errbuf, errlen );
-        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
-        throw Asn1CodecError{ erroross.str() };
-    }
+    ilogger->info("{}: processing {} bytes from {} with {} workers", fnname, input.size(), input_path, codecs.size());
 
-    // Encode the Ieee1609Dot2Data ASN.1 C struct into XML, so we can extract out the BSM.
-    encode_rval = xer_encode( 
-            &asn_DEF_MessageFrame, 
-            messageframe, 
-            XER_F_CANONICAL, 
-            dynamic_buffer_append, 
-            static_cast<void *>(xml_buffer) 
-            );
+    auto start = std::chrono::steady_clock::now();
+    std::size_t window = window_size * codecs.size();
+    std::vector<BatchInput::Record> records;
+    std::vector<std::string> responses;
+    std::atomic<std::size_t> claimed{ 0 };
+    records.reserve( window );
 
-    ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+    // each worker claims runs of records in the window; every response has its own slot, so the output order is the
+    // input order whatever the finishing order.
+    auto work = [&]( CodecContext& codec ) {
+        std::ostringstream output_msg_stream;
 
-    if ( encode_rval.encoded == -1 ) {
-        erroross.str("");
-        erroross << "failed ASN.1 XML encoding of MessageFrame element " << encode_rval.failed_type->name;
-        throw Asn1CodecError{ erroross.str() };
-    }
+        for ( std::size_t begin = claimed.fetch_add( claim_size ); begin < records.size(); begin = claimed.fetch_add( claim_size ) ) {
+            std::size_t end = std::min( begin + claim_size, records.size() );
 
-    ilogger->trace("{}: finished.", fnname );
-    return true;
-}
-        
-void ASN1_Codec::encode_frame_data(const std::string& data_as_xml, std::string& hex_string) {
-    static const char* fnname = "encode_frame_data()";
+            for ( std::size_t i = begin; i < end; ++i ) {
+                output_msg_stream.str( std::string{} );
 
-    asn_dec_rval_t decode_rval;
-    asn_enc_rval_t encode_rval;
+                bool success;
+                if ( binary_input ) {
+                    success = codec.process_bytes( records[i].data, records[i].length, input_encodings.data(), input_encodings.size(), output_msg_stream );
+                } else {
+                    success = codec.process( records[i].data, records[i].length, output_msg_stream );
+                }
 
-	// TODO: working toward a general solution for these function; first is passing in a ref to 
-	// these types of structures.
-	struct asn_TYPE_descriptor_s* data_struct;
-    void *frame_data = 0;
+                if ( !success ) ++msg_error_count;
 
-    switch (curr_op_) {
-        case J2735MESSAGEFRAME:
-            data_struct = &asn_DEF_MessageFrame;
+                // a filtered message leaves an empty line, so the responses stay in line with the records.
+                filtered( codec );
+                responses[i] = output_msg_stream.str();
+            }
+        }
+    };
 
-            break;
-        case IEEE1609DOT2:
-            data_struct = &asn_DEF_Ieee1609Dot2Data;
+    bool written = true;
+    BatchInput::Record record;
 
-            break;
-        case ASDFRAME:
-            data_struct = &asn_DEF_AdvisorySituationData;
+    while ( data_available && written ) {
+        records.clear();
+        while ( records.size() < window && input.next( record ) ) {
+            records.push_back( record );
+            msg_recv_bytes += record.length;
+        }
 
-            break;
-        default:
-            // TODO internal err
-            break;
-    }
+        if ( records.empty() ) break;
+
+        msg_recv_count += records.size();
+        responses.resize( records.size() );
+        claimed = 0;
 
-    errlen = max_errbuf_size;
+        std::vector<std::thread> threads;
+        for ( std::size_t i = 1; i < codecs.size(); ++i ) {
+            threads.emplace_back( work, std::ref( *codecs[i] ) );
+        }
 
-    decode_rval = xer_decode( 
-            0 				// new parameter addition seems to work with nullptr.
-			, data_struct
-            , (void **)&frame_data
-            , data_as_xml.data()
-            , data_as_xml.size()
-            );
+        work( *codecs[0] );
+        for ( auto& t : threads ) t.join();
 
-    if ( decode_rval.code != RC_OK ) {
-        erroross.str("");
-        erroross << "failed ASN.1 decoding of XML element " << data_struct->name << ": ";
-        if ( decode_rval.code == RC_FAIL ) {
-            erroross << "bad data.";
-        } else {
-            erroross << "more data expected.";
+        for ( std::size_t i = 0; i < records.size(); ++i ) {
+            os.write( responses[i].data(), responses[i].size() );
+            os.put( '\n' );
+            msg_send_bytes += responses[i].size();
         }
-        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
-        throw Asn1CodecError{ erroross.str() };
-    }
 
-    if (asn_check_constraints( data_struct, frame_data, errbuf, &errlen )) {
-        erroross.str("");
-        erroross << "failed ASN.1 constraints check of element " << data_struct->name << ": ";
-        erroross.write( errbuf, errlen );
-        ASN_STRUCT_FREE(*data_struct, frame_data);
-        throw Asn1CodecError{ erroross.str() };
+        msg_send_count += records.size();
+        written = static_cast<bool>( os.flush() );
     }
 
-    buffer_structure_t buffer = {0,0,0};
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
 
-    encode_rval = asn_encode(
-        0,
-        curr_decode_type_,
-        data_struct,
-        frame_data, 
-        dynamic_buffer_append, 
-        static_cast<void *>(&buffer) 
-        );
+    ilogger->info("{}: {} messages ({} bytes) processed in {:.3f} s; {} error responses; {:.1f} msg/s", fnname,
+            msg_recv_count.load(), msg_recv_bytes.load(), seconds, msg_error_count.load(), seconds > 0 ? msg_recv_count.load() / seconds : 0.0);
 
-    ASN_STRUCT_FREE(*data_struct, frame_data);
+    bool r = written && data_available;
 
-    if ( encode_rval.encoded == -1 ) {
-        erroross.str("");
-        erroross << "failed ASN.1 encoding of SDWTIM element " << encode_rval.failed_type->name;
-        throw Asn1CodecError{ erroross.str() };
+    if ( !written ) {
+        elogger->error("{}: cannot write the responses to {}", fnname, output_path);
     }
 
-    if (!bytes_to_hex_(&buffer, hex_string)) {
-        std::free( static_cast<void *>(buffer.buffer) );
-        throw Asn1CodecError{ "failed attempt to encode SDWTIM byte buffer into hex string." };
+    if ( input.truncated() ) {
+        elogger->error("{}: the frame at byte {} is longer than the rest of the input.", fnname, input.position());
+        r = false;
     }
 
-    std::free( static_cast<void *>(buffer.buffer) );
-}
+    elogger->flush();
+    ilogger->flush();
 
-bool ASN1_Codec::set_codec_requirements( pugi::xml_document& doc ) {
+    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-    static const char* fnname = "set_codec_requirements()";
+bool ASN1_Codec::process_spool_file( SpoolDirectory::File& file, CodecContext& codec, ProduceStream& output_message_stream ) {
+    static const char* fnname = "process_spool_file()";
 
-    enum asn_transfer_syntax atstype = ATS_INVALID;
-	opsflag = 0;
+    // an unreadable file stays in the spool directory.
+    if ( file.error ) {
+        elogger->error("{}: cannot read {}/{}: {}", fnname, spool_dir, file.name, std::strerror( file.error ));
+        return false;
+    }
 
-    // re-establish defaults.
-    decode_1609dot2 = false;
-    decode_messageframe = false;
-    decode_asdframe = false;
-    decode_1609dot2_type = ATS_CANONICAL_OER;
-    decode_messageframe_type = ATS_UNALIGNED_BASIC_PER;
+    std::ofstream ofile;
+    if ( !spool_output_dir.empty() ) {
+        std::string output_path = spool_output_dir + '/' + file.name + ".out";
+        ofile.open( output_path, std::ios::binary | std::ios::trunc );
+        if ( !ofile ) {
+            elogger->error("{}: cannot write {}: {}", fnname, output_path, std::strerror( errno ));
+            return false;
+        }
+    }
 
+    BatchInput input{ batch_framing };
+    input.assign( file.data.data(), file.data.size() );
 
-    // Determine which decodings are needed.
-    // TODO: Think aobut using a xpath_nodeset structure and iterating.
-    pugi::xpath_node encodings_xpath_node = ode_encodings_query.evaluate_node( input_doc );
-    if (!encodings_xpath_node) {
-        throw UnparseableInputError{"Failed to find path: OdeAsn1Data/metadata/encodings in the input file."};
-    }
+    BatchInput::Record record;
+    std::size_t records = 0;
 
-    for ( pugi::xml_node n = encodings_xpath_node.node().first_child(); n; n = n.next_sibling()) {
+    while ( input.next( record ) ) {
+        ++records;
+        msg_recv_count++;
+        msg_recv_bytes += record.length;
 
-        pugi::xml_text ats_node = n.child("encodingRule").text();
-        if ( ats_node ) {
-            // the XML file contains the rule specification and we should use it.
-            atstype = get_ats_transfer_syntax( ats_node.get() );
+        bool success;
+        if ( binary_input ) {
+            success = codec.process_bytes( record.data, record.length, input_encodings.data(), input_encodings.size(), output_message_stream );
+        } else {
+            success = codec.process( record.data, record.length, output_message_stream );
         }
 
-		if ( atstype == ATS_INVALID ) {
-			throw UnparseableInputError{"Invalid encoding rule in input file."};
-		}
-        
-        // TODO: These strings ( must be detected as hard coded string or config parameters ).
-
-        if ( std::strcmp(n.child("elementType").text().get(), "Ieee1609Dot2Data") == 0 ) {
-			opsflag |= static_cast<uint32_t>(Asn1OpsType::IEEE1609DOT2);
-            decode_1609dot2 = true;
-            decode_1609dot2_type = atstype;
+        if ( !success ) ++msg_error_count;
 
-        } else if ( std::strcmp(n.child("elementType").text().get(), "MessageFrame") == 0 ) {
-			opsflag |= static_cast<uint32_t>(Asn1OpsType::J2735MESSAGEFRAME);
-            decode_messageframe = true;
-            decode_messageframe_type = atstype;
+        if ( ofile.is_open() ) {
+            if ( filtered( codec ) ) {
+                output_message_stream.reset();
+                continue;
+            }
 
-        } else if ( std::strcmp(n.child("elementType").text().get(), "AdvisorySituationData") == 0 ) {
-			opsflag |= static_cast<uint32_t>(Asn1OpsType::ASDFRAME);
-            decode_asdframe = true;
-            decode_asdframe_type = atstype;
+            // the responses of a file are in its output file, one per line.
+            ofile.write( output_message_stream.data(), output_message_stream.size() );
+            ofile.put( '\n' );
+            msg_send_count++;
+            msg_send_bytes += output_message_stream.size();
+            output_message_stream.reset();
+        } else {
+            produce_response( codec, output_message_stream, -1, 0, nullptr );
         }
     }
 
-    if (!opsflag) {
-        throw UnparseableInputError{"Input file did not specify any encoding/decoding operations."};
+    if ( input.truncated() ) {
+        elogger->error("{}: {} ends inside the frame at byte {}.", fnname, file.name, input.position());
     }
 
+    if ( ofile.is_open() && !ofile.flush() ) {
+        elogger->error("{}: cannot write the responses of {}.", fnname, file.name);
+        return false;
+    }
+
+    std::string done_path = spool_done_dir + '/' + file.name;
+    if ( std::rename( ( spool_dir + '/' + file.name ).c_str(), done_path.c_str() ) != 0 ) {
+        elogger->error("{}: cannot move {} to {}: {}", fnname, file.name, done_path, std::strerror( errno ));
+    }
+
+    ilogger->info("{}: {} records of {} processed.", fnname, records, file.name);
     return true;
 }
 
-bool ASN1_Codec::file_test(std::string file_path, std::ostream& os, bool encode) {
-    static const char* fnname = "file_test()";
-
-    std::stringstream output_msg_stream;
-    bool r = true;
+int ASN1_Codec::spool() {
+    static const char* fnname = "spool()";
 
-    std::FILE* ifile = std::fopen( file_path.c_str(), "r" );
+    // the files of a batch are read together; each worker takes whole files, so a file's responses stay in order.
+    static constexpr std::size_t files_per_worker = 4;
 
-    if (!ifile) {
-        std::cerr << "cannot open " << file_path << '\n';
+    SpoolDirectory dir{ spool_dir };
+    if ( !dir.open() ) {
+        elogger->critical("{}: cannot watch the spool directory {}: {}", fnname, spool_dir, std::strerror( errno ));
         return EXIT_FAILURE;
     }
 
-    decode_functionality = !encode;
-
-    // compute file size in bytes.
-    std::fseek(ifile, 0, SEEK_END);
-    std::size_t ifile_size = std::ftell(ifile);
-    std::fseek(ifile, 0, SEEK_SET);
-
-    std::vector<unsigned char> consumed_xml_buffer( ifile_size );
-    std::size_t count = std::fread( consumed_xml_buffer.data(), sizeof( uint8_t ), consumed_xml_buffer.size(), ifile );
-    std::fclose( ifile );
-
-    if ( consumed_xml_buffer.size() > 0 ) {
-        msg_recv_count++;
-        msg_recv_bytes += consumed_xml_buffer.size();
+    if ( !dirExists( spool_done_dir ) && mkdir( spool_done_dir.c_str(), 0755 ) != 0 ) {
+        elogger->critical("{}: cannot make the spool done directory {}: {}", fnname, spool_done_dir, std::strerror( errno ));
+        return EXIT_FAILURE;
+    }
 
-        try {
+    if ( !spool_output_dir.empty() && !dirExists( spool_output_dir ) ) {
+        elogger->critical("{}: the spool output directory {} does not exist.", fnname, spool_output_dir);
+        return EXIT_FAILURE;
+    }
 
-            // pugi resets the document as part of load_buffer
-            pugi::xml_parse_result result = input_doc.load_buffer((const void*) consumed_xml_buffer.data(), consumed_xml_buffer.size(), xml_parse_options );
+    if ( spool_output_dir.empty() ) {
+        while ( !launch_producer() ) {
+            if ( !data_available ) return EXIT_FAILURE;
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1500 ) );
+        }
 
-            if (!result) {
-                erroross.str("");
-                erroross << "Input file parse error: " << result.description() << " at offset " << result.offset;
-                throw UnparseableInputError{ erroross.str() };
-            } 
+        start_polling();
+    }
 
-            // examine the input xml encodings information and set the flags and requirements needed to properly parse the byte strings.
-            set_codec_requirements( input_doc );            // throws.
+    ilogger->info("{}: watching {}", fnname, spool_dir);
 
-            // Retain this node reference. It is where the decoded result will be inserted.
+    std::size_t batch_size = files_per_worker * codecs.size();
+    std::vector<std::string> names;
+    std::vector<SpoolDirectory::File> files;
+    std::vector<SpoolDirectory::File> current;
 
-            payload_node_ = ode_payload_query.evaluate_node( input_doc ).node();
-            if ( !payload_node_ ) {
-                throw UnparseableInputError{ "Failed to find path: OdeAsn1Data/payload/data in the input document." };
-            } 
+    while ( data_available ) {
 
-            if ( decode_functionality ) {
-                decode_message( payload_node_, output_msg_stream );
-            } else {
-                encode_message( output_msg_stream );
+        if ( files.empty() ) {
+            if ( dir.wait( names, batch_size, consumer_timeout ) > 0 ) {
+                dir.read( names, files );
+                names.clear();
             }
+        }
 
-        } catch (const UnparseableInputError& e) {
-
-            r = false;
-            //elogger->trace("{}: UnparseableInputError {}", fnname , e.what() );
-            add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+        if ( !files.empty() ) {
+            current.swap( files );
+            files.clear();
 
-        } catch (const MissingInputElementError& e) {
+            std::atomic<std::size_t> claimed{ 0 };
 
-            r = false;
-            //elogger->trace("{}: MissingInputElementError {}", fnname , e.what() );
-            add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+            auto work = [&]( CodecContext& codec ) {
+                ProduceStream output_msg_stream{ 4096, &output_pool };
+                for ( std::size_t i = claimed++; i < current.size(); i = claimed++ ) {
+                    process_spool_file( current[i], codec, output_msg_stream );
+                }
+            };
 
-        } catch (const pugi::xpath_exception& e ) {
+            std::vector<std::thread> threads;
+            for ( auto& codec : codecs ) {
+                threads.emplace_back( work, std::ref( *codec ) );
+            }
 
-            r = false;
-            //elogger->trace("{}: pugi::xpath_exception {}", fnname, e.what() );
-            add_error_xml( error_doc, Asn1DataType::ODE, Asn1ErrorType::REQUEST, e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+            // the next batch is read while this one is processed.
+            if ( dir.wait( names, batch_size, 0 ) > 0 ) {
+                dir.read( names, files );
+                names.clear();
+            }
 
-        } catch (const Asn1CodecError& e) {
+            for ( auto& t : threads ) t.join();
+            current.clear();
+        }
 
-            r = false;
-            //elogger->trace("{}: Asn1CodecError {}", fnname , e.what() );
-            add_error_xml( input_doc, e.data_type(), e.error_type(), e.what(), false );
-            input_doc.save(output_msg_stream,"",pugi::format_raw);
+        if ( histogram_interval > 0 && std::chrono::steady_clock::now() >= next_histogram ) {
+            log_histograms();
         }
+    }
 
-        os << output_msg_stream.str() << std::endl;
+    if ( spool_output_dir.empty() ) {
+        stop_polling();
+        producer_ptr->flush( 5000 );
     }
 
-    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
 
-/**
- * Used as a test stub to bypass Kafka and work through the parsing, encoding, decoding.
- *
- */
-bool ASN1_Codec::filetest() {
-    static const char* fnname = "filetest()";
-    bool r = true;
-
-    std::string error_string;
-    RdKafka::ErrorCode status;
-    std::stringstream output_msg_stream;
+void ASN1_Codec::receive_datagrams( UdpReceiver& receiver, CodecContext& codec ) {
+    static const char* fnname = "receive_datagrams()";
 
-    signal(SIGINT, sigterm);
-    signal(SIGTERM, sigterm);
+    ProduceStream output_msg_stream{ 4096, &output_pool };
 
-    try {
+    while ( data_available ) {
+        std::size_t count = receiver.receive( consumer_timeout );
 
-        if ( !configure() ) return EXIT_FAILURE;
+        for ( std::size_t i = 0; i < count; ++i ) {
+            UdpReceiver::Datagram datagram = receiver.datagram( i );
+            msg_recv_count++;
+            msg_recv_bytes += datagram.length;
 
-    } catch ( std::exception& e ) {
+            if ( datagram.truncated ) {
+                elogger->error("{}: a datagram larger than {} bytes was dropped.", fnname, udp_max_bytes );
+                ++msg_error_count;
+                continue;
+            }
 
-        std::cerr << "Fatal Exception: " << e.what() << '\n';           // logger may have failed to configure.
-        return EXIT_FAILURE;
+            if ( !codec.process_bytes( datagram.data, datagram.length, udp_encodings.data(), udp_encodings.size(), output_msg_stream ) ) {
+                ++msg_error_count;
+            }
+            produce_response( codec, output_msg_stream, -1, 0, nullptr );
+        }
     }
+}
 
-    ilogger->trace("{}: Starting...", fnname);
+int ASN1_Codec::udp() {
+    static const char* fnname = "udp()";
 
-    std::FILE* ifile = std::fopen( operands[0].c_str(), "r" );
-    if (!ifile) {
-        std::cerr << "cannot open " << operands[0] << '\n';
+    if ( !decode_functionality ) {
+        elogger->critical("{}: UDP ingest only decodes; set acm.type=decode.", fnname);
         return EXIT_FAILURE;
     }
 
-    // compute file size in bytes.
-    std::fseek(ifile, 0, SEEK_END);
-    std::size_t ifile_size = std::ftell(ifile);
-    std::fseek(ifile, 0, SEEK_SET);
+    std::string host;
+    uint16_t port;
+    UdpReceiver::parse_listen( udp_listen, host, port );
+
+    // every worker has a socket on the same port; they are bound before anything is produced.
+    std::vector<std::unique_ptr<UdpReceiver>> receivers;
+    for ( std::size_t i = 0; i < codecs.size(); ++i ) {
+        receivers.emplace_back( new UdpReceiver{ host, port, udp_batch, udp_max_bytes } );
+        if ( !receivers.back()->open() ) {
+            elogger->critical("{}: cannot bind the UDP listen address {}: {}", fnname, udp_listen, std::strerror( errno ));
+            return EXIT_FAILURE;
+        }
+    }
 
-    std::vector<unsigned char> consumed_xml_buffer( ifile_size );
-    std::size_t count = std::fread( consumed_xml_buffer.data(), sizeof( uint8_t ), consumed_xml_buffer.size(), ifile );
-    std::fclose( ifile );
+    while ( !launch_producer() ) {
+        if ( !data_available ) return EXIT_FAILURE;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1500 ) );
+    }
 
-    if ( consumed_xml_buffer.size() > 0 ) {
+    start_polling();
+    ilogger->info("{}: receiving on {} with {} sockets", fnname, udp_listen, receivers.size());
 
-        ilogger->trace("{}: successful read of the test file having {} bytes.", fnname, consumed_xml_buffer.size() );
+    std::vector<std::thread> threads;
+    for ( std::size_t i = 0; i < codecs.size(); ++i ) {
+        threads.emplace_back( &ASN1_Codec::receive_datagrams, this, std::ref( *receivers[i] ), std::ref( *codecs[i] ) );
+    }
 
-        msg_recv_count++;
-        msg_recv_bytes += consumed_xml_buffer.size();
+    while ( data_available ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
 
-        try {
+        if ( histogram_interval > 0 && std::chrono::steady_clock::now() >= next_histogram ) {
+            log_histograms();
+        }
+    }
 
-            // pugi resets the document as part of load_buffer
-            pugi::xml_parse_result result = input_doc.load_buffer((const void*) consumed_xml_buffer.data(), consumed_xml_buffer.size(), xml_parse_options );
+    for ( auto& t : threads ) t.join();
 
-            if (!result) {
-                erroross.str("");
-                erroross << "Input file parse error: " << result.description() << " at offset " << result.offset;
-                throw UnparseableInputError{ erroross.str() };
-            } 
+    stop_polling();
+    producer_ptr->flush( 5000 );
 
-            // examine the input xml encodings information and set the flags and requirements needed to properly parse the byte strings.
-            set_codec_requirements( input_doc );            // throws.
+    return EXIT_SUCCESS;
+}
 
-            // Retain this node reference. It is where the decoded result will be inserted.
-            payload_node_ = ode_payload_query.evaluate_node( input_doc ).node();
+int ASN1_Codec::shm() {
+    static const char* fnname = "shm()";
 
-            if ( !payload_node_ ) {
-                throw UnparseableInputError{ "Failed to find path: OdeAsn1Data/payload/data in the input document." };
-            } 
+    // the ACM makes the rings that do not exist, so it may start before or after the processes that share them.
+    ShmRing input{ shm_input, shm_bytes };
+    if ( !input.open() ) {
+        elogger->critical("{}: cannot open the shared memory ring {}: {}", fnname, shm_input, std::strerror( errno ));
+        return EXIT_FAILURE;
+    }
 
-            if ( decode_functionality ) {
-                decode_message( payload_node_, output_msg_stream );
-            } else {
-                encode_message( output_msg_stream );
-            }
+    std::unique_ptr<ShmRing> output;
+    if ( !shm_output.empty() ) {
+        output.reset( new ShmRing{ shm_output, shm_bytes } );
+        if ( !output->open() ) {
+            elogger->critical("{}: cannot open the shared memory ring {}: {}", fnname, shm_output, std::strerror( errno ));
+            return EXIT_FAILURE;
+        }
+    } else {
+        while ( !launch_producer() ) {
+            if ( !data_available ) return EXIT_FAILURE;
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1500 ) );
+        }
 
-        } catch (const UnparseableInputError& e) {
+        start_polling();
+    }
 
-            r = false;
-            elogger->trace("{}: UnparseableInputError {}", fnname , e.what() );
-            add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+    ilogger->info("{}: consuming {} ({} bytes)", fnname, input.name(), input.capacity());
 
-        } catch (const MissingInputElementError& e) {
+    // one consumer takes the ring's records in order, and decodes each where the producer wrote it.
+    CodecContext& codec = *codecs[0];
+    ProduceStream output_msg_stream{ 4096, &output_pool };
 
-            r = false;
-            elogger->trace("{}: MissingInputElementError {}", fnname , e.what() );
-            add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+    while ( data_available ) {
+        std::size_t length;
+        const uint8_t* request = input.peek( length, consumer_timeout );
 
-        } catch (const pugi::xpath_exception& e ) {
+        if ( request ) {
+            msg_recv_count++;
+            msg_recv_bytes += length;
 
-            r = false;
-            elogger->trace("{}: pugi::xpath_exception {}", fnname, e.what() );
-            add_error_xml( error_doc, Asn1DataType::ODE, Asn1ErrorType::REQUEST, e.what(), true );
-            error_doc.save(output_msg_stream,"",pugi::format_raw);
+            bool success = binary_input && decode_functionality
+                ? codec.process_bytes( request, length, input_encodings.data(), input_encodings.size(), output_msg_stream )
+                : codec.process( request, length, output_msg_stream );
+            input.pop();
 
-        } catch (const Asn1CodecError& e) {
+            if ( !success ) ++msg_error_count;
 
-            r = false;
-            elogger->trace("{}: Asn1CodecError {}", fnname , e.what() );
-            add_error_xml( input_doc, e.data_type(), e.error_type(), e.what(), false );
-            input_doc.save(output_msg_stream,"",pugi::format_raw);
+            if ( !success && error_dropped( codec, shm_input, 0 ) ) {
+                output_msg_stream.reset();
+            } else if ( !output ) {
+                produce_response( codec, output_msg_stream, -1, 0, nullptr );
+            } else if ( filtered( codec ) ) {
+                output_msg_stream.reset();
+            } else {
+                // the consumer of the responses holds back this one, and the requests behind it, while its ring is full.
+                bool pushed;
+                while ( !( pushed = output->push( output_msg_stream.data(), output_msg_stream.size(), consumer_timeout ) ) && errno == EAGAIN && data_available ) {}
 
+                if ( pushed ) {
+                    msg_send_count++;
+                    msg_send_bytes += output_msg_stream.size();
+                } else {
+                    ++produce_error_count;
+                    elogger->error("{}: cannot write a response of {} bytes to {}: {}", fnname, output_msg_stream.size(),
+                            output->name(), std::strerror( errno ));
+                }
+                output_msg_stream.reset();
+            }
         }
 
-        std::cout << output_msg_stream.str() << '\n';
+        if ( histogram_interval > 0 && std::chrono::steady_clock::now() >= next_histogram ) {
+            log_histograms();
+        }
 
-    } else {
-        ilogger->trace("Read an empty file.");
+        if ( error_breaker && std::chrono::steady_clock::now() >= next_error_summary ) {
+            log_error_storms();
+        }
     }
 
-    // NOTE: good for troubleshooting, but bad for performance.
-    ilogger->trace("{}: Finished.", fnname);
-    elogger->flush();
-    ilogger->flush();
+    if ( !output ) {
+        stop_polling();
+        producer_ptr->flush( 5000 );
+    }
 
-    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
 
 int ASN1_Codec::operator()(void) {
 
     static const char* fnname = "run()";
 
-    RdKafka::ErrorCode status;
-    std::string error_string;
-    bool success = false;
-
-    std::stringstream output_msg_stream;
+    ProduceStream output_msg_stream{ 4096, &output_pool };
+    std::vector<WorkItem> batch;
+    batch.reserve( consume_batch_size );
 
     signal(SIGINT, sigterm);
     signal(SIGTERM, sigterm);
+#ifdef SIGHUP
+    signal(SIGHUP, sighup);
+#endif
+#ifdef SIGUSR1
+    signal(SIGUSR1, sigusr1);
+#endif
     
     try {
 
@@ -1794,10 +4434,42 @@ int ASN1_Codec::operator()(void) {
         return EXIT_FAILURE;
     }
 
+    warm_up();
+    start_reporting();
+
+    int status = EXIT_SUCCESS;
+
+    // a spool directory replaces the consumer.
+    if ( !spool_dir.empty() ) {
+        signal_ready( true );
+        status = spool();
+        signal_ready( false );
+        bootstrap = false;
+    }
+
+    // as does a UDP listen address.
+    if ( bootstrap && !udp_listen.empty() ) {
+        signal_ready( true );
+        status = udp();
+        signal_ready( false );
+        bootstrap = false;
+    }
+
+    // or a shared memory ring.
+    if ( bootstrap && !shm_input.empty() ) {
+        signal_ready( true );
+        status = shm();
+        signal_ready( false );
+        bootstrap = false;
+    }
+
     while (bootstrap) {
         // reset flag here, or else nothing works below
         data_available = true;
 
+        // the librdkafka threads, and the poll thread, take the CPU set of the thread that creates them.
+        pin_thread( kafka_cpus, "Kafka" );
+
         if ( !launch_consumer() ) {
             std::this_thread::sleep_for( std::chrono::milliseconds( 1500 ) );
         
@@ -1810,78 +4482,179 @@ int ASN1_Codec::operator()(void) {
             continue;
         }
 
+        start_polling();
+        start_producers();
+        start_workers();
+        pin_thread( consumer_cpus, "consumer" );
+
+        // subscribed, with every stage running and warm; a restarted bootstrap withdraws it until it is ready again.
+        signal_ready( true );
+
         // consume-produce loop.
         while (data_available) {
 
-            std::unique_ptr<RdKafka::Message> msg{ consumer_ptr->consume( consumer_timeout ) };
+            if ( reload_requested ) {
+                // between batches, so no message is in the consumer thread's hands.
+                reload_requested = false;
+                reload();
+            }
 
-            try {
+            if ( !held_items.empty() ) dispatch_held();
 
-                success = process_message( msg.get(), output_msg_stream );          // throws.
+            consume_batch( batch );
 
-            } catch (const UnparseableInputError& e) {
+            if ( batch_tuner && !batch.empty() ) {
+                std::size_t backlog = 0;
+                for ( std::size_t i = 0; i < work_queues.size(); ++i ) backlog += worker_backlog[i];
+                batch_tuner->consumed( batch.size() >= consume_batch_size, backlog / std::max<std::size_t>( work_queues.size(), 1 ) );
+            }
 
-                elogger->trace("{}: UnparseableInputError {}", fnname , e.what() );
-                add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-                error_doc.save(output_msg_stream,"",pugi::format_raw);
+            // the priority messages of the batch are handed off first, so they do not wait for the consumer to push the
+            // rest; the lane of a message is its topic's, so each partition keeps its order.
+            for ( std::size_t lane = 0; lane < ( priority_topics.empty() ? 1 : lane_count ); ++lane ) {
+                for ( auto& item : batch ) {
+
+                    if ( item.lane != lane ) continue;
+
+                    if ( workers.empty() ) {
+                        auto started = metrics_endpoint ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+                        process_message( item.message.get(), *codecs[0], output_msg_stream );
+                        processed( item );
+                        if ( metrics_endpoint ) busy_ns.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - started ).count(), std::memory_order_relaxed );
+                        track_memory( 0 );
+                    } else {
+                        dispatch( item );
+                    }
+                }
+            }
 
-            } catch (const MissingInputElementError& e) {
+            batch.clear();
+            if ( memory_budget ) memory_budget->release( MemoryBudget::Component::BATCH, batch_bytes );
+            batch_bytes = 0;
 
-                elogger->trace("{}: MissingInputElementError {}", fnname , e.what() );
-                add_error_xml( error_doc, e.data_type(), e.error_type(), e.what(), true );
-                error_doc.save(output_msg_stream,"",pugi::format_raw);
+            if ( batch_tuner && std::chrono::steady_clock::now() >= next_batch_tune ) {
+                tune_batching();
+            }
 
-            } catch (const pugi::xpath_exception& e ) {
+            if ( commit_interval > 0 && std::chrono::steady_clock::now() >= next_commit ) {
+                commit_offsets( false );
+            }
 
-                elogger->trace("{}: pugi::xpath_exception {}", fnname, e.what() );
-                add_error_xml( error_doc, Asn1DataType::ODE, Asn1ErrorType::REQUEST, e.what(), true );
-                error_doc.save(output_msg_stream,"",pugi::format_raw);
+            if ( histogram_interval > 0 && std::chrono::steady_clock::now() >= next_histogram ) {
+                log_histograms();
+            }
 
-            } catch (const Asn1CodecError& e) {
+            if ( error_breaker && std::chrono::steady_clock::now() >= next_error_summary ) {
+                log_error_storms();
+            }
 
-                elogger->trace("{}: Asn1CodecError {}", fnname , e.what() );
-                add_error_xml( input_doc, e.data_type(), e.error_type(), e.what(), false );
-                input_doc.save(output_msg_stream,"",pugi::format_raw);
+            if ( dump_requested ) {
+                dump_requested = false;
+                request_diagnostics();
+            }
 
+            if ( diagnostics_pending && std::chrono::steady_clock::now() >= diagnostics_due ) {
+                dump_diagnostics();
             }
+        }
 
-            if ( msg->len() > 0 ) {
+        signal_ready( false );
+        stop_workers();
+        stop_producers();
+        stop_polling();
 
-                std::cerr << msg->len() << " bytes consumed from topic: " << consumed_topics[0] << '\n';
+        // the held messages were not processed, so their offsets were not committed.
+        held_items.clear();
+        paused_partitions.clear();
 
-                std::string output_msg_string = output_msg_stream.str();
-                status = producer_ptr->produce(published_topic_ptr.get(), partition, RdKafka::Producer::RK_MSG_COPY, (void *)output_msg_string.c_str(), output_msg_string.size(), NULL, NULL);
+        // the outstanding delivery reports return their buffers before the producer is replaced or destroyed.
+        producer_ptr->flush( 5000 );
 
-                if (status != RdKafka::ERR_NO_ERROR) {
-                    elogger->error("{}: Failure of XER encoding: {}", fnname , RdKafka::err2str( status ));
+        if ( commit_interval > 0 ) {
+            commit_offsets( true );
+        }
 
-                } else {
-                    // successfully sent; update counters.
-                    msg_send_count++;
-                    msg_send_bytes += output_msg_string.size();
-                    ilogger->trace("{}: successful encoding/decoding", fnname );
-                    std::cerr << output_msg_string.size() << " bytes produced to topic: " << published_topic_ptr->name() << '\n';
-                }
+        if ( error_breaker ) log_error_storms();
+    }
 
-                // clear out the stream
-                output_msg_stream.str("");
-                output_msg_stream.clear();
-            } 
+    stop_reporting();
 
-            // NOTE: good for troubleshooting, but bad for performance.
-            elogger->flush();
-            ilogger->flush();
+    ilogger->info("{}: shutting down...", fnname );
+    ilogger->info("ASN1_Codec consumed  : {} blocks and {} bytes", msg_recv_count.load(), msg_recv_bytes.load());
+    ilogger->info("ASN1_Codec published : {} blocks and {} bytes", msg_send_count.load(), msg_send_bytes.load());
+    ilogger->info("ASN1_Codec errors    : {} error responses, {} not produced, {} quarantined", msg_error_count.load(), produce_error_count.load(), msg_quarantine_count.load());
+    if ( trajectories ) {
+        ilogger->info("ASN1_Codec trajectories: {} summaries, {} BSMs of untracked vehicles", msg_trajectory_count.load(), trajectories->untracked() );
+    }
+    ilogger->info("ASN1_Codec delivered : {} blocks, {} failed, {} produce retries", delivery_report.delivered.load(), delivery_report.failed.load(), produce_retry_count.load());
+    uint64_t reports = delivery_report.delivered.load() + delivery_report.failed.load();
+    ilogger->info("ASN1_Codec delivery latency: {} us average, {} us maximum", reports ? delivery_report.latency_us.load() / reports : 0, delivery_report.max_latency_us.load());
+
+    ValidationStats validation{ 0, 0, 0, 0 };
+    for ( const auto& codec : codecs ) {
+        validation.checked += codec->validation_stats().checked;
+        validation.skipped += codec->validation_stats().skipped;
+        validation.violations += codec->validation_stats().violations;
+        validation.sampled_violations += codec->validation_stats().sampled_violations;
+    }
+    ilogger->info("ASN1_Codec constraints: {} checked, {} skipped, {} violations ({} sampled)", validation.checked, validation.skipped, validation.violations, validation.sampled_violations);
+
+    BudgetStats budget{ 0, 0, 0 };
+    for ( const auto& codec : codecs ) {
+        budget.oversize += codec->budget_stats().oversize;
+        budget.memory += codec->budget_stats().memory;
+        budget.time += codec->budget_stats().time;
+    }
+    ilogger->info("ASN1_Codec over limits: {} too large, {} out of memory, {} out of time", budget.oversize, budget.memory, budget.time);
+
+    if ( memory_budget ) {
+        ilogger->info("ASN1_Codec memory high water: batch {} queues {} caches {} arenas {} bytes",
+                memory_budget->high_water( MemoryBudget::Component::BATCH ), memory_budget->high_water( MemoryBudget::Component::QUEUES ),
+                memory_budget->high_water( MemoryBudget::Component::CACHES ), memory_budget->high_water( MemoryBudget::Component::ARENAS ) );
+    }
+
+    // the counters of every worker's cache of one kind.
+    auto report_cache = [&]( const char* name, ResultCache::Stats (CodecContext::*stats_of)() const ) {
+        ResultCache::Stats cache{ 0, 0, 0, 0, 0 };
+        for ( const auto& codec : codecs ) {
+            ResultCache::Stats stats = ( *codec.*stats_of )();
+            cache.hits += stats.hits;
+            cache.misses += stats.misses;
+            cache.evictions += stats.evictions;
+            cache.entries += stats.entries;
+            cache.bytes += stats.bytes;
         }
+        ilogger->info("ASN1_Codec {} cache: {} hits, {} misses, {} evictions, {} entries in {} bytes", name, cache.hits, cache.misses, cache.evictions, cache.entries, cache.bytes);
+    };
+
+    if ( decode_cache_size > 0 && uses_direction( true ) ) report_cache( "decode", &CodecContext::decode_cache_stats );
+    if ( map_cache_size > 0 && uses_direction( true ) ) report_cache( "MAP", &CodecContext::map_cache_stats );
+    if ( encode_cache_size > 0 && uses_direction( false ) ) report_cache( "encode", &CodecContext::encode_cache_stats );
+
+    if ( encode_templates > 0 && uses_direction( false ) ) {
+        uint64_t hits = 0, misses = 0;
+        std::size_t kept = 0;
+        for ( const auto& codec : codecs ) {
+            const TimTemplates* t = codec->encode_templates();
+            hits += t->hits();
+            misses += t->misses();
+            kept += t->size();
+        }
+        ilogger->info("ASN1_Codec TIM templates: {} hits, {} misses, {} kept", hits, misses, kept);
     }
 
-    ilogger->info("{}: shutting down...", fnname );
-    ilogger->info("ASN1_Codec consumed  : {} blocks and {} bytes", msg_recv_count, msg_recv_bytes);
-    ilogger->info("ASN1_Codec published : {} blocks and {} bytes", msg_send_count, msg_send_bytes);
+    if ( histogram_interval > 0 ) {
+        log_histograms();
+    }
 
     std::cerr << "ASN1_Codec operations complete; shutting down...\n";
-    std::cerr << "ASN1_Codec consumed   : " << msg_recv_count << " blocks and " << msg_recv_bytes << " bytes\n";
-    std::cerr << "ASN1_Codec published  : " << msg_send_count << " blocks and " << msg_send_bytes << " bytes\n";
-    return EXIT_SUCCESS;
+    std::cerr << "ASN1_Codec consumed   : " << msg_recv_count.load() << " blocks and " << msg_recv_bytes.load() << " bytes\n";
+    std::cerr << "ASN1_Codec published  : " << msg_send_count.load() << " blocks and " << msg_send_bytes.load() << " bytes\n";
+    std::cerr << "ASN1_Codec delivered  : " << delivery_report.delivered.load() << " blocks, " << delivery_report.failed.load() << " failed\n";
+
+    elogger->flush();
+    ilogger->flush();
+    return status;
 }
 
 #ifndef _ASN1_CODEC_TESTS
@@ -1904,8 +4677,11 @@ int main( int argc, char* argv[] )
     asn1_codec.addOption( 'R', "log-rm", "Remove specified/default log files if they exist.", false );
     asn1_codec.addOption( 'i', "ilog", "Information log file name.", true );
     asn1_codec.addOption( 'e', "elog", "Error log file name.", true );
+    asn1_codec.addOption( 'A', "log-async", "Log asynchronously using a queue of this many messages (rounded up to a power of 2).", true );
+    asn1_codec.addOption( 'L', "log-flush-ms", "Milliseconds between flushes of the asynchronous logs; defaults to 1000.", true );
     asn1_codec.addOption( 'h', "help", "print out some help" );
     asn1_codec.addOption( 'F', "infile", "accept a file and bypass kafka.", false );
+    asn1_codec.addOption( 'B', "batch", "Process every message in the input file (or stdin) and write the responses to this file (- for stdout); bypasses kafka.", true );
     asn1_codec.addOption( 'T', "codec-type", "The type of codec to use: decode or encode; defaults to decode", true );
 
 
@@ -1945,7 +4721,10 @@ int main( int argc, char* argv[] )
         }
     }
 
-    if (asn1_codec.optIsSet('F')) {
+    if (asn1_codec.optIsSet('B')) {
+        std::exit( asn1_codec.batch( asn1_codec.optString('B') ) );
+
+    } else if (asn1_codec.optIsSet('F')) {
         // Only used when an input file is specified.
         std::exit( asn1_codec.filetest() );
 
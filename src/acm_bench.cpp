@@ -0,0 +1,399 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+/**
+ * acm_bench: replay ODE payloads through a CodecContext without Kafka and report the time spent in each stage and, in
+ * a build with ACM_ALLOC_COUNTING, the heap allocations of each stage.
+ *
+ * usage: acm_bench [-n messages] [-w warmup] [-j] [-e] [-g corpus [-m mix] [-s seed]] [-t threads [-p cpus]] [file ...]
+ *
+ *    -n  the number of timed messages for each payload (default 10000).
+ *    -w  the number of untimed messages processed first (default 1000).
+ *    -j  respond with JSON instead of ODE XML.
+ *    -e  encode the files given; they are decoded otherwise.
+ *    -g  replay decode requests of that many generated messages instead of files, in turn.
+ *    -m  the mix of the generated messages (default bsm=70,tim=10,map=10,spat=10).
+ *    -s  the seed of the generated messages (default 1).
+ *    -t  measure the scaling from 1 to that many threads, each with its own context, instead of the stages.
+ *    -p  pin the threads of -t to the CPUs of the list, e.g., 0-7, in turn.
+ *
+ * Without files the decode requests in data/ and the encode requests in unit-test-data/ are replayed. Run it from the
+ * build directory, where those directories are copied.
+ */
+
+#include "acm_codec.hpp"
+#include "alloc_counter.hpp"
+#include "corpus_generator.hpp"
+#include "cpu_affinity.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Payload {
+        std::string file;
+        bool decode;
+    };
+
+    const Payload default_payloads[] = {
+        { "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml", true },
+        { "data/InputData.Ieee1609Dot2Data.coer.Bsm.packed.xml", true },
+        { "data/InputData.Ieee1609Dot2Data.TravelerInformation.packed.xml", true },
+        { "data/InputData.TravelerInformation.packed.xml", true },
+        { "unit-test-data/BSM.xml", false },
+        { "unit-test-data/1609_BSM.xml", false },
+        { "unit-test-data/ASD_BSM.xml", false },
+        { "unit-test-data/ASD_1609_BSM.xml", false },
+        { "data/InputData.encoding.tim.xml", false }
+    };
+
+    // collects the responses; the storage is reused so the output does not allocate once it has grown.
+    class ResponseBuffer : public std::streambuf {
+        public:
+            void clear() { data_.clear(); }
+            std::size_t size() const { return data_.size(); }
+
+        protected:
+            std::streamsize xsputn( const char* s, std::streamsize n ) override {
+                data_.insert( data_.end(), s, s + n );
+                return n;
+            }
+
+            int_type overflow( int_type c ) override {
+                if ( c != traits_type::eof() ) data_.push_back( static_cast<char>( c ) );
+                return c;
+            }
+
+        private:
+            std::vector<char> data_;
+    };
+
+    uint64_t percentile( std::vector<uint64_t>& samples, double p ) {
+        if ( samples.empty() ) return 0;
+        std::size_t i = static_cast<std::size_t>( p * ( samples.size() - 1 ) );
+        std::nth_element( samples.begin(), samples.begin() + i, samples.end() );
+        return samples[i];
+    }
+
+    double mean( const std::vector<uint64_t>& samples ) {
+        if ( samples.empty() ) return 0.0;
+        double sum = 0.0;
+        for ( uint64_t s : samples ) sum += static_cast<double>( s );
+        return sum / samples.size();
+    }
+
+    void report_row( std::ostream& os, const char* name, std::vector<uint64_t>& samples ) {
+        os << "  " << std::left << std::setw( 20 ) << name << std::right
+            << std::setw( 12 ) << std::fixed << std::setprecision( 0 ) << mean( samples )
+            << std::setw( 12 ) << percentile( samples, 0.50 )
+            << std::setw( 12 ) << percentile( samples, 0.99 ) << '\n';
+    }
+
+    /**
+     * @brief Time the requests of inputs, in turn, through one context.
+     */
+    bool bench( const std::string& name, const std::vector<std::string>& inputs, bool decode, std::size_t messages, std::size_t warmup, bool json, std::ostream& os ) {
+        CodecContext codec{ nullptr, nullptr, decode };
+        codec.use_xml_pool( 1 << 20 );                  // as the ACM does by default.
+        codec.set_json_output( json );
+        codec.set_stage_timing( true );
+
+        ResponseBuffer buffer;
+        std::ostream output{ &buffer };
+
+        // every input is processed at least once, so one the codec rejects is found before timing.
+        for ( std::size_t i = 0; i < std::max( warmup, inputs.size() ); ++i ) {
+            const std::string& input = inputs[ i % inputs.size() ];
+            buffer.clear();
+            if ( !codec.process( input.data(), input.size(), output ) ) {
+                os << name << ": the codec reported an error; skipped.\n\n";
+                return false;
+            }
+        }
+
+        const int stages = static_cast<int>( CodecStage::COUNT );
+        std::vector<std::vector<uint64_t>> stage_samples( stages );
+        std::vector<uint64_t> totals;
+        totals.reserve( messages );
+        for ( auto& s : stage_samples ) s.reserve( messages );
+
+        // the sums of the allocations of each stage; the last entry is the whole message.
+        std::vector<uint64_t> stage_allocations( stages + 1, 0 );
+        std::vector<uint64_t> stage_bytes( stages + 1, 0 );
+        AllocCounter allocs;
+
+        double bytes_in = 0.0;
+        double bytes_out = 0.0;
+
+        for ( std::size_t i = 0; i < messages; ++i ) {
+            const std::string& input = inputs[ i % inputs.size() ];
+            buffer.clear();
+
+            allocs.restart();
+            auto start = std::chrono::steady_clock::now();
+            codec.process( input.data(), input.size(), output );
+            auto end = std::chrono::steady_clock::now();
+            AllocCounter::Counts counts = allocs.counts();
+
+            bytes_in += input.size();
+            bytes_out += buffer.size();
+
+            totals.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() );
+            for ( int s = 0; s < stages; ++s ) {
+                stage_samples[s].push_back( codec.stage_times().ns[s] );
+                stage_allocations[s] += codec.stage_times().allocations[s];
+                stage_bytes[s] += codec.stage_times().bytes[s];
+            }
+            stage_allocations[stages] += counts.allocations;
+            stage_bytes[stages] += counts.bytes;
+        }
+
+        double ns_per_message = mean( totals );
+        double per_second = ns_per_message > 0.0 ? 1e9 / ns_per_message : 0.0;
+        bytes_in /= messages;
+        bytes_out /= messages;
+
+        os << name << " (" << ( decode ? "decode" : "encode" ) << ", " << std::fixed << std::setprecision( 0 ) << bytes_in
+            << " bytes in, " << bytes_out << " bytes out)\n";
+        os << "  " << std::left << std::setw( 20 ) << "stage (ns/msg)" << std::right
+            << std::setw( 12 ) << "mean" << std::setw( 12 ) << "p50" << std::setw( 12 ) << "p99" << '\n';
+
+        for ( int s = 0; s < stages; ++s ) {
+            report_row( os, codecstages[s], stage_samples[s] );
+        }
+        report_row( os, "total", totals );
+
+        if ( AllocCounter::enabled() ) {
+            os << "  " << std::left << std::setw( 20 ) << "stage (heap/msg)" << std::right
+                << std::setw( 12 ) << "allocs" << std::setw( 12 ) << "bytes" << '\n';
+            for ( int s = 0; s <= stages; ++s ) {
+                os << "  " << std::left << std::setw( 20 ) << ( s < stages ? codecstages[s] : "total" ) << std::right
+                    << std::setw( 12 ) << std::fixed << std::setprecision( 1 ) << static_cast<double>( stage_allocations[s] ) / messages
+                    << std::setw( 12 ) << std::setprecision( 0 ) << static_cast<double>( stage_bytes[s] ) / messages << '\n';
+            }
+        }
+
+        os << "  " << std::fixed << std::setprecision( 0 ) << per_second << " msgs/s, "
+            << std::setprecision( 1 ) << per_second * bytes_in / 1e6 << " MB/s in, "
+            << per_second * bytes_out / 1e6 << " MB/s out\n\n";
+
+        return true;
+    }
+
+    /**
+     * @brief The time taken by count threads, each with its own context as the ACM's workers have, to process messages
+     * requests of inputs each after they start together.
+     *
+     * @return the seconds, or a negative value when the codec rejected an input.
+     */
+    double run_threads( const std::vector<std::string>& inputs, bool decode, std::size_t messages, std::size_t warmup, bool json, std::size_t count, const std::vector<int>& cpus ) {
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::atomic<bool> failed{ false };
+
+        for ( std::size_t t = 0; t < count; ++t ) {
+            threads.emplace_back( [&, t]() {
+                if ( !cpus.empty() ) cpu_affinity::pin_current_thread( std::vector<int>( 1, cpus[ t % cpus.size() ] ) );
+
+                // the context is made on its thread, so the memory of its pool is local to the CPU it runs on.
+                CodecContext codec{ nullptr, nullptr, decode };
+                codec.use_xml_pool( 1 << 20 );
+                codec.set_json_output( json );
+
+                ResponseBuffer buffer;
+                std::ostream output{ &buffer };
+
+                for ( std::size_t i = 0; i < std::max( warmup, inputs.size() ); ++i ) {
+                    const std::string& input = inputs[ i % inputs.size() ];
+                    buffer.clear();
+                    if ( !codec.process( input.data(), input.size(), output ) ) failed = true;
+                }
+
+                ++ready;
+                while ( !go.load() ) std::this_thread::yield();
+
+                // the threads start at different inputs, as workers given the messages of a batch in turn do.
+                for ( std::size_t i = 0; i < messages; ++i ) {
+                    const std::string& input = inputs[ ( i + t ) % inputs.size() ];
+                    buffer.clear();
+                    codec.process( input.data(), input.size(), output );
+                }
+            } );
+        }
+
+        while ( ready.load() < count ) std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for ( std::thread& thread : threads ) thread.join();
+        auto end = std::chrono::steady_clock::now();
+
+        return failed ? -1.0 : std::chrono::duration<double>( end - start ).count();
+    }
+
+    /**
+     * @brief Report the throughput of inputs on 1 to threads threads, its speedup over one thread, and the efficiency:
+     * the speedup over the number of threads, 100% when the threads scale linearly.
+     */
+    bool scale( const std::string& name, const std::vector<std::string>& inputs, bool decode, std::size_t messages, std::size_t warmup, bool json, std::size_t threads, const std::vector<int>& cpus, std::ostream& os ) {
+        os << name << " (" << ( decode ? "decode" : "encode" ) << ", " << messages << " messages a thread)\n";
+        os << "  " << std::setw( 8 ) << "threads" << std::setw( 14 ) << "msgs/s" << std::setw( 12 ) << "speedup"
+            << std::setw( 12 ) << "efficiency" << '\n';
+
+        double single = 0.0;
+        for ( std::size_t count = 1; count <= threads; ++count ) {
+            double seconds = run_threads( inputs, decode, messages, warmup, json, count, cpus );
+            if ( seconds < 0.0 ) {
+                os << name << ": the codec reported an error; skipped.\n\n";
+                return false;
+            }
+
+            double per_second = seconds > 0.0 ? count * messages / seconds : 0.0;
+            if ( count == 1 ) single = per_second;
+            double speedup = single > 0.0 ? per_second / single : 0.0;
+
+            os << "  " << std::setw( 8 ) << count << std::setw( 14 ) << std::fixed << std::setprecision( 0 ) << per_second
+                << std::setw( 12 ) << std::setprecision( 2 ) << speedup
+                << std::setw( 11 ) << std::setprecision( 1 ) << 100.0 * speedup / count << "%\n";
+        }
+
+        os << '\n';
+        return true;
+    }
+
+    std::vector<std::string> read_payload( const Payload& payload, std::ostream& os ) {
+        std::ifstream ifs{ payload.file, std::ios::binary };
+        std::vector<std::string> inputs( 1, std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} } );
+
+        if ( inputs[0].empty() ) {
+            os << payload.file << ": cannot read the file; skipped.\n\n";
+            inputs.clear();
+        }
+
+        return inputs;
+    }
+
+    void usage( const char* name ) {
+        std::cerr << "usage: " << name << " [-n messages] [-w warmup] [-j] [-e] [-g corpus [-m mix] [-s seed]] [-t threads [-p cpus]] [file ...]\n";
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    std::size_t messages = 10000;
+    std::size_t warmup = 1000;
+    bool json = false;
+    bool decode = true;
+    std::size_t corpus = 0;
+    std::string mix;
+    uint64_t seed = 1;
+    std::size_t threads = 0;
+    std::vector<int> cpus;
+    std::vector<Payload> payloads;
+
+    for ( int i = 1; i < argc; ++i ) {
+        if ( std::strcmp( argv[i], "-n" ) == 0 && i + 1 < argc ) {
+            messages = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-w" ) == 0 && i + 1 < argc ) {
+            warmup = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-j" ) == 0 ) {
+            json = true;
+        } else if ( std::strcmp( argv[i], "-e" ) == 0 ) {
+            decode = false;
+        } else if ( std::strcmp( argv[i], "-g" ) == 0 && i + 1 < argc ) {
+            corpus = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-m" ) == 0 && i + 1 < argc ) {
+            mix = argv[++i];
+        } else if ( std::strcmp( argv[i], "-s" ) == 0 && i + 1 < argc ) {
+            seed = std::strtoull( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-t" ) == 0 && i + 1 < argc ) {
+            threads = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-p" ) == 0 && i + 1 < argc ) {
+            try {
+                cpus = cpu_affinity::parse( argv[++i] );
+            } catch ( const std::exception& e ) {
+                std::cerr << "-p: " << e.what() << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if ( argv[i][0] == '-' ) {
+            usage( argv[0] );
+            return EXIT_FAILURE;
+        } else {
+            payloads.push_back( Payload{ argv[i], true } );
+        }
+    }
+
+    if ( payloads.empty() ) {
+        payloads.assign( std::begin( default_payloads ), std::end( default_payloads ) );
+    } else {
+        for ( Payload& p : payloads ) p.decode = decode;
+    }
+
+    if ( messages == 0 ) {
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    if ( corpus > 0 ) {
+        std::vector<std::string> inputs( corpus );
+
+        try {
+            CorpusGenerator generator{ seed };
+            if ( !mix.empty() ) generator.set_mix( mix );
+            for ( std::string& input : inputs ) generator.next( CorpusGenerator::Format::XML, input );
+        } catch ( const std::exception& e ) {
+            std::cerr << "cannot generate the corpus: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        std::string name = "generated corpus of " + std::to_string( corpus ) + " messages (" + ( mix.empty() ? "bsm=70,tim=10,map=10,spat=10" : mix ) + ")";
+        bool r = threads > 0 ? scale( name, inputs, true, messages, warmup, json, threads, cpus, std::cout )
+                             : bench( name, inputs, true, messages, warmup, json, std::cout );
+        return r ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    bool r = true;
+    for ( const Payload& p : payloads ) {
+        std::vector<std::string> inputs = read_payload( p, std::cout );
+        if ( inputs.empty() ) {
+            r = false;
+        } else if ( threads > 0 ) {
+            r = scale( p.file, inputs, p.decode, messages, warmup, json, threads, cpus, std::cout ) && r;
+        } else {
+            r = bench( p.file, inputs, p.decode, messages, warmup, json, std::cout ) && r;
+        }
+    }
+
+    return r ? EXIT_SUCCESS : EXIT_FAILURE;
+}
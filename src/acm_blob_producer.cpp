@@ -44,14 +44,24 @@
  */
 
 #include "acm_blob_producer.hpp"
+#include "batch_input.hpp"
+#include "hex_codec.hpp"
 #include "utilities.hpp"
+#include "MessageFrame.h"
+#include "Ieee1609Dot2Data.h"
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
 #include <csignal>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <cstdio>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+
 // for both windows and linux.
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -114,12 +124,31 @@ ACMBlobProducer::ACMBlobProducer( const std::string& name, const std::string& de
     Tool{ name, description },
     msg_send_count{0},
     msg_send_bytes{0},
+    queue_full_count{0},
     iloglevel{ spdlog::level::trace },
     eloglevel{ spdlog::level::err },
     mconf{},
     partition{RdKafka::Topic::PARTITION_UA},
     debug{""},
-    block_size{BUFSIZE},
+    block_size{default_block_size},
+    template_file{},
+    pdu{},
+    target_rate{0.0},
+    timed{false},
+    speed{1.0},
+    fixed_partition{false},
+    producer_threads{1},
+    message_limit{0},
+    report_interval{5},
+    corpus{nullptr},
+    corpus_size{0},
+    envelopes{},
+    messages{},
+    next_message{0},
+    message_times{},
+    partition_messages{},
+    capture_span{0},
+    delivery_report{},
     published_topic_name{},
     conf{nullptr},
     tconf{nullptr},
@@ -134,6 +163,11 @@ ACMBlobProducer::~ACMBlobProducer()
 {
     //if (consumer_ptr) consumer_ptr->close();
 
+    // the queued messages refer to the corpus.
+    published_topic_ptr.reset();
+    producer_ptr.reset();
+    if (corpus) munmap( const_cast<char*>( corpus ), corpus_size );
+
     // free raw librdkafka pointers.
     if (tconf) delete tconf;
     if (conf) delete conf;
@@ -229,18 +263,76 @@ bool ACMBlobProducer::configure() {
 
     if ( optIsSet('B') ) {
         try {
-            block_size = optInt('B');
+            int n = optInt('B');
+            block_size = n > 0 ? static_cast<std::size_t>( n ) : default_block_size;
         } catch ( std::exception& e ) {
-            block_size = BUFSIZE;
+            block_size = default_block_size;
         }
     }
 
-    if ( !fileExists( input_file ) ) {
-        elogger->error( "The input file: {} does not exist.", input_file );
-        return false;
+    ilogger->info("block size: {} bytes", block_size );
+
+    if ( optIsSet('E') ) {
+        template_file = optString('E');
+        ilogger->info("using envelope template: {}", template_file );
     }
 
-    ilogger->info("using input file: {}", input_file );
+    if ( optIsSet('P') ) {
+        pdu = optString('P');
+        ilogger->info("framing the input file as {} PDUs", pdu );
+    }
+
+    if ( optIsSet('r') ) {
+        try {
+            target_rate = std::stod( optString('r') );
+        } catch ( std::exception& e ) {
+            elogger->error("the rate {} is not a number.", optString('r'));
+            return false;
+        }
+        if ( target_rate < 0 ) target_rate = 0;
+    }
+
+    ilogger->info("target rate: {} msg/s", target_rate > 0 ? std::to_string( target_rate ) : "unlimited" );
+
+    timed = optIsSet('T');
+    if ( timed ) {
+        if ( optIsSet('S') ) {
+            try {
+                speed = std::stod( optString('S') );
+            } catch ( std::exception& e ) {
+                elogger->error("the speed-up factor {} is not a number.", optString('S'));
+                return false;
+            }
+        }
+
+        if ( !( speed > 0 ) ) {
+            elogger->error("the speed-up factor {} is not greater than 0.", optString('S'));
+            return false;
+        }
+
+        if ( !pdu.empty() ) {
+            elogger->error("a timed capture is already cut into messages; it cannot be cut at PDU boundaries.");
+            return false;
+        }
+
+        ilogger->info("replaying a timed capture at {}x, one thread per captured partition; the rate and thread count are not used", speed );
+    }
+
+    if ( optIsSet('j') ) {
+        int n = optInt('j');
+        producer_threads = n > 0 ? static_cast<std::size_t>( n ) : std::max( 1U, std::thread::hardware_concurrency() );
+    }
+
+    if ( optIsSet('n') ) {
+        message_limit = std::stoull( optString('n') );                  // throws.
+    }
+
+    if ( optIsSet('I') ) {
+        int n = optInt('I');
+        report_interval = n > 0 ? n : 5;
+    }
+
+    ilogger->info("producer threads: {} messages: {} report interval: {} s", producer_threads, message_limit, report_interval );
 
     // must use a configuration file.
     if ( !optIsSet('c') ) {
@@ -310,6 +402,9 @@ bool ACMBlobProducer::configure() {
         }  // otherwise leave at default; PARTITION_UA
     }
 
+    // a timed replay keeps the captured partitions unless one is given.
+    fixed_partition = optIsSet('p');
+
     ilogger->info("kafka partition: {}", partition);
 
     if ( getOption('g').isSet() && conf->set("group.id", optString('g'), error_string) != RdKafka::Conf::CONF_OK) {
@@ -370,6 +465,240 @@ bool ACMBlobProducer::launch_producer()
     return true;
 }
 
+bool ACMBlobProducer::load_corpus()
+{
+    int fd = open( input_file.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        elogger->error("No file: {}; cannot be opened: {}", input_file, std::strerror( errno ));
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 || info.st_size == 0 ) {
+        elogger->error("The input file: {} is empty or cannot be read.", input_file);
+        close( fd );
+        return false;
+    }
+
+    corpus_size = static_cast<std::size_t>( info.st_size );
+    void* p = mmap( nullptr, corpus_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( p == MAP_FAILED ) {
+        elogger->error("The input file: {} cannot be mapped: {}", input_file, std::strerror( errno ));
+        corpus_size = 0;
+        return false;
+    }
+
+    corpus = static_cast<const char*>( p );
+
+    // the corpus is cut into blocks; the last block may be short.
+    std::vector<std::pair<const char*, std::size_t>> blocks;
+    if ( timed ) {
+        if ( !read_capture( blocks ) ) return false;
+        ilogger->info("timed capture: {} messages of {} partitions over {} ms", blocks.size(), partition_messages.size(), capture_span );
+    } else if ( !pdu.empty() ) {
+        if ( !frame_pdus( blocks ) ) return false;
+        ilogger->info("{} PDUs in {} messages", pdu, blocks.size() );
+    } else {
+        for ( std::size_t offset = 0; offset < corpus_size; offset += block_size ) {
+            blocks.emplace_back( corpus + offset, std::min( block_size, corpus_size - offset ) );
+        }
+    }
+
+    if ( template_file.empty() ) {
+        messages = std::move( blocks );
+        return true;
+    }
+
+    std::ifstream ifs{ template_file };
+    std::string envelope{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+    std::size_t placeholder = envelope.find( payload_placeholder );
+
+    if ( !ifs || placeholder == std::string::npos ) {
+        elogger->error("The envelope template: {} cannot be read or does not hold {}.", template_file, payload_placeholder);
+        return false;
+    }
+
+    std::string prefix = envelope.substr( 0, placeholder );
+    std::string suffix = envelope.substr( placeholder + std::strlen( payload_placeholder ) );
+
+    // every envelope is built up front, so producing copies nothing.
+    envelopes.reserve( blocks.size() * ( prefix.size() + suffix.size() ) + 2 * corpus_size );
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+
+    for ( auto& block : blocks ) {
+        std::size_t start = envelopes.size();
+        envelopes += prefix;
+        std::size_t hex = envelopes.size();
+        envelopes.resize( hex + 2 * block.second );
+        hex_codec::encode( block.first, block.second, &envelopes[hex] );
+        envelopes += suffix;
+        spans.emplace_back( start, envelopes.size() - start );
+    }
+
+    for ( auto& span : spans ) {
+        messages.emplace_back( envelopes.data() + span.first, span.second );
+    }
+
+    return true;
+}
+
+bool ACMBlobProducer::frame_pdus( std::vector<std::pair<const char*, std::size_t>>& blocks ) const
+{
+    std::size_t colon = pdu.find( ':' );
+    std::string type_name = pdu.substr( 0, colon );
+    std::string rule = colon == std::string::npos ? "" : pdu.substr( colon + 1 );
+
+    const asn_TYPE_descriptor_t* type = nullptr;
+    if ( type_name == "MessageFrame" ) {
+        type = &asn_DEF_MessageFrame;
+    } else if ( type_name == "Ieee1609Dot2Data" ) {
+        type = &asn_DEF_Ieee1609Dot2Data;
+    }
+
+    enum asn_transfer_syntax syntax = ATS_INVALID;
+    if ( rule == "UPER" ) {
+        syntax = ATS_UNALIGNED_BASIC_PER;
+    } else if ( rule == "COER" ) {
+        syntax = ATS_CANONICAL_OER;
+    }
+
+    if ( !type || syntax == ATS_INVALID ) {
+        elogger->error("The PDU {} is not one of MessageFrame:UPER, MessageFrame:COER, Ieee1609Dot2Data:UPER, Ieee1609Dot2Data:COER.", pdu );
+        return false;
+    }
+
+    // decode each PDU to find where the next one starts.
+    std::vector<std::pair<const char*, std::size_t>> pdus;
+    for ( std::size_t offset = 0; offset < corpus_size; ) {
+        void* structure = nullptr;
+        asn_dec_rval_t rval = asn_decode( nullptr, syntax, type, &structure, corpus + offset, corpus_size - offset );
+        ASN_STRUCT_FREE( *type, structure );
+
+        if ( rval.code != RC_OK || rval.consumed == 0 || rval.consumed > corpus_size - offset ) {
+            elogger->error("The {} PDU at offset {} of {} cannot be decoded.", pdu, offset, input_file );
+            return false;
+        }
+
+        pdus.emplace_back( corpus + offset, rval.consumed );
+        offset += rval.consumed;
+    }
+
+    if ( !template_file.empty() ) {
+        blocks = std::move( pdus );
+        return true;
+    }
+
+    // consecutive PDUs are adjacent in the corpus, so a block is a span of it.
+    std::pair<const char*, std::size_t> block{ corpus, 0 };
+    for ( auto& p : pdus ) {
+        if ( block.second > 0 && block.second + p.second > block_size ) {
+            blocks.push_back( block );
+            block = { p.first, 0 };
+        }
+
+        if ( p.second <= block_size ) {
+            block.second += p.second;
+            continue;
+        }
+
+        // the ACM reassembles a PDU split over several messages (acm.input.stream).
+        for ( std::size_t offset = 0; offset < p.second; offset += block_size ) {
+            blocks.emplace_back( p.first + offset, std::min( block_size, p.second - offset ) );
+        }
+        block = { p.first + p.second, 0 };
+    }
+
+    if ( block.second > 0 ) blocks.push_back( block );
+    return true;
+}
+
+bool ACMBlobProducer::read_capture( std::vector<std::pair<const char*, std::size_t>>& blocks )
+{
+    BatchInput input{ BatchInput::Framing::TIMED };
+    input.assign( reinterpret_cast<const uint8_t*>( corpus ), corpus_size );
+
+    std::vector<int64_t> stamps;
+    BatchInput::Record record;
+    while ( input.next( record ) ) {
+        partition_messages[ record.partition ].push_back( blocks.size() );
+        blocks.emplace_back( reinterpret_cast<const char*>( record.data ), record.length );
+        stamps.push_back( record.timestamp );
+    }
+
+    if ( input.truncated() ) {
+        elogger->error("The timed capture {} ends inside the frame at offset {}.", input_file, input.position() );
+        return false;
+    }
+
+    // the partitions of a capture are interleaved, so its first and last messages need not be at its ends.
+    int64_t first = *std::min_element( stamps.begin(), stamps.end() );
+    capture_span = *std::max_element( stamps.begin(), stamps.end() ) - first;
+
+    message_times.clear();
+    for ( int64_t t : stamps ) message_times.push_back( t - first );
+    return true;
+}
+
+bool ACMBlobProducer::produce_message( std::size_t id, int32_t to, const std::pair<const char*, std::size_t>& message )
+{
+    RdKafka::ErrorCode status = producer_ptr->produce(published_topic_ptr.get(), to, 0, const_cast<char*>( message.first ), message.second, NULL, NULL);
+
+    // a full queue drains as delivery reports are served.
+    while ( status == RdKafka::ERR__QUEUE_FULL && data_available ) {
+        ++queue_full_count;
+        producer_ptr->poll( 1 );
+        status = producer_ptr->produce(published_topic_ptr.get(), to, 0, const_cast<char*>( message.first ), message.second, NULL, NULL);
+    }
+
+    if ( status != RdKafka::ERR_NO_ERROR ) {
+        if ( data_available ) elogger->error("Thread {}: production failure code {} for {} bytes.", id, RdKafka::err2str( status ), message.second);
+        return false;
+    }
+
+    msg_send_count++;
+    msg_send_bytes += message.second;
+    return true;
+}
+
+void ACMBlobProducer::produce_load( std::size_t id, std::chrono::steady_clock::time_point start )
+{
+    // the threads share one sequence, so together they hold the target rate and replay the corpus in order.
+    for ( uint64_t seq = next_message++; data_available && ( message_limit == 0 || seq < message_limit ); seq = next_message++ ) {
+
+        if ( target_rate > 0 ) {
+            std::this_thread::sleep_until( start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( seq / target_rate ) ) );
+        }
+
+        if ( !produce_message( id, partition, messages[ seq % messages.size() ] ) ) return;
+    }
+}
+
+void ACMBlobProducer::replay_partition( std::size_t id, int32_t captured, const std::vector<std::size_t>& indices, std::chrono::steady_clock::time_point start )
+{
+    int32_t to = fixed_partition ? partition : captured;
+
+    // a pass lasts one millisecond longer than the capture, so the first message of a pass follows the last of the one
+    // before. The message count is shared with the other partitions.
+    for ( int64_t pass = 0; data_available; ++pass ) {
+        for ( std::size_t index : indices ) {
+            uint64_t seq = next_message++;
+            if ( message_limit > 0 && seq >= message_limit ) return;
+
+            std::chrono::duration<double, std::milli> offset{ ( pass * ( capture_span + 1 ) + message_times[index] ) / speed };
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( offset );
+
+            // a gap in the capture may be long; a signal ends the wait.
+            while ( data_available && std::chrono::steady_clock::now() < due ) {
+                std::this_thread::sleep_until( std::min( due, std::chrono::steady_clock::now() + std::chrono::milliseconds( 100 ) ) );
+            }
+
+            if ( !data_available || !produce_message( id, to, messages[index] ) ) return;
+        }
+    }
+}
+
 bool ACMBlobProducer::make_loggers( bool remove_files )
 {
     // defaults.
@@ -443,10 +772,6 @@ bool ACMBlobProducer::make_loggers( bool remove_files )
 int ACMBlobProducer::operator()(void) {
 
     std::string error_string;
-    RdKafka::ErrorCode status;
-    FILE *source;
-    std::size_t bytes_read = 0;
-    int file_round = 0;
 
     signal(SIGINT, sigterm);
     signal(SIGTERM, sigterm);
@@ -463,56 +788,75 @@ int ACMBlobProducer::operator()(void) {
         return EXIT_FAILURE;
     }
 
-    if ( !launch_producer() ) return false;
-
-    while (data_available) {
-        // data_available changed via interupt SIGINT or SIGTERM
+    if ( !load_corpus() ) return EXIT_FAILURE;
 
-        // Process
-        // 1. Read in the uper file.
-        // 2. "Produce" some sized blocks of the file to the kafka topic with size indicated.
+    ilogger->info("corpus: {} bytes in {} messages", corpus_size, messages.size());
 
-        source = fopen( input_file.c_str(), "rb" );
-
-        if ( !source ) {
-            elogger->error("No file: {}; cannot be opened for decoding.",input_file);
-            return false;
-        } 
-
-        while ( !feof( source ) ) {
+    if ( conf->set("dr_cb", &delivery_report, error_string) != RdKafka::Conf::CONF_OK ) {
+        elogger->critical("Failed to set the producer delivery report callback: {}.", error_string );
+        return EXIT_FAILURE;
+    }
 
-            // attempt to read 1K bytes into buffer.
-            bytes_read = fread( buf, sizeof buf[0], block_size, source );
+    if ( !launch_producer() ) return EXIT_FAILURE;
 
-            if ( bytes_read > 0 ) {
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<std::size_t> running{ timed ? partition_messages.size() : producer_threads };
+    std::vector<std::thread> threads;
 
-                status = producer_ptr->produce(published_topic_ptr.get(), partition, RdKafka::Producer::RK_MSG_COPY, (void *)buf, bytes_read, NULL, NULL);
+    if ( timed ) {
+        for ( const auto& p : partition_messages ) {
+            const auto* replay = &p;
+            std::size_t i = threads.size();
+            threads.emplace_back( [this, i, replay, start, &running]() {
+                replay_partition( i, replay->first, replay->second, start );
+                --running;
+            } );
+        }
+    } else {
+        for ( std::size_t i = 0; i < producer_threads; ++i ) {
+            threads.emplace_back( [this, i, start, &running]() {
+                produce_load( i, start );
+                --running;
+            } );
+        }
+    }
 
-                if (status != RdKafka::ERR_NO_ERROR) {
-                    elogger->error("Production failure code {} after reading {} bytes.", RdKafka::err2str( status ), bytes_read);
-                    break;
+    // serve the delivery reports and report the achieved rate while the threads produce.
+    auto last_report = start;
+    uint64_t reported = 0;
+
+    while ( running > 0 ) {
+        producer_ptr->poll( 100 );
+
+        auto now = std::chrono::steady_clock::now();
+        if ( now >= last_report + std::chrono::seconds( report_interval ) ) {
+            uint64_t sent = msg_send_count.load();
+            double rate = ( sent - reported ) / std::chrono::duration<double>( now - last_report ).count();
+            ilogger->info("produced {} messages ({:.1f} msg/s); {} delivered, {} failed, {} queue full waits", sent, rate,
+                    delivery_report.delivered.load(), delivery_report.failed.load(), queue_full_count.load());
+            std::cerr << "produced " << sent << " messages at " << static_cast<uint64_t>( rate ) << " msg/s\n";
+            reported = sent;
+            last_report = now;
+        }
+    }
 
-                } else {
-                    // successfully sent; update counters.
-                    msg_send_count++;
-                    msg_send_bytes += bytes_read;
-                    ilogger->trace("Production success of {} bytes.", bytes_read);
-                }
+    for ( auto& t : threads ) t.join();
 
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
 
-                std::cerr << "Bytes from file: " << bytes_read << ". Successfully produced to: " << published_topic_name << '\n';
-            }
-        }
+    // the corpus stays mapped until the queued messages are delivered.
+    producer_ptr->flush( 10000 );
 
-        fclose( source );
-        ilogger->info( "Finished producing the entire file.");
-        std::cerr << "Sleeping for 5 seconds after file round " << ++file_round << "\n";
-        std::this_thread::sleep_for( std::chrono::seconds(5) ); 
-    }
+    double rate = seconds > 0 ? msg_send_count.load() / seconds : 0.0;
+    double byte_rate = seconds > 0 ? msg_send_bytes.load() / seconds : 0.0;
 
     ilogger->info("ACMBlobProducer operations complete; shutting down...");
-    ilogger->info("ACMBlobProducer published : {} blocks and {} bytes", msg_send_count, msg_send_bytes);
-    std::cerr << "ACMBlobProducer published : " << msg_send_count << " binary blocks of size: " << block_size << " for " << msg_send_bytes << " bytes.\n";
+    ilogger->info("ACMBlobProducer published : {} blocks and {} bytes in {:.3f} s; {:.1f} msg/s {:.1f} bytes/s", msg_send_count.load(), msg_send_bytes.load(), seconds, rate, byte_rate);
+    ilogger->info("ACMBlobProducer delivered : {} blocks, {} failed, {} queue full waits", delivery_report.delivered.load(), delivery_report.failed.load(), queue_full_count.load());
+    std::cerr << "ACMBlobProducer published : " << msg_send_count.load() << " messages for " << msg_send_bytes.load() << " bytes in " << seconds << " s: "
+        << static_cast<uint64_t>( rate ) << " msg/s ("
+        << ( timed ? "timed replay at " + std::to_string( speed ) + "x" : "target " + ( target_rate > 0 ? std::to_string( target_rate ) : std::string{ "unlimited" } ) ) << ").\n";
+    std::cerr << "ACMBlobProducer delivered : " << delivery_report.delivered.load() << " messages, " << delivery_report.failed.load() << " failed.\n";
     
     // NOTE: good for troubleshooting, but bad for performance.
     elogger->flush();
@@ -539,7 +883,15 @@ int main( int argc, char* argv[] )
     acm_blob_producer.addOption( 'i', "ilog", "Information log file name.", true );
     acm_blob_producer.addOption( 'e', "elog", "Error log file name.", true );
     acm_blob_producer.addOption( 'F', "file", "Input binary file", true );
-    acm_blob_producer.addOption( 'B', "blocksize", "The block size to read and write.", true );
+    acm_blob_producer.addOption( 'B', "blocksize", "The size of the messages cut from the input file.", true );
+    acm_blob_producer.addOption( 'P', "pdu", "Cut the input file at its PDU boundaries: MessageFrame:UPER, Ieee1609Dot2Data:COER, ...", true );
+    acm_blob_producer.addOption( 'E', "envelope", "ODE XML envelope template; {{payload}} is replaced by each message in hex.", true );
+    acm_blob_producer.addOption( 'r', "rate", "Target messages per second over all threads; 0 (default) is unlimited.", true );
+    acm_blob_producer.addOption( 'j', "threads", "Producer threads; defaults to 1, 0 uses every core.", true );
+    acm_blob_producer.addOption( 'n', "count", "Messages to produce, replaying the file as needed; 0 (default) runs until interrupted.", true );
+    acm_blob_producer.addOption( 'I', "report-interval", "Seconds between achieved rate reports; defaults to 5.", true );
+    acm_blob_producer.addOption( 'T', "timed", "The input file is a timed capture (acm.capture.file); replay it by its timestamps, each partition on its own thread.", false );
+    acm_blob_producer.addOption( 'S', "speed", "The speed-up factor of a timed replay, e.g., 10 for 10x; defaults to 1.", true );
     acm_blob_producer.addOption( 'h', "help", "print out some help" );
 
     if (!acm_blob_producer.parseArgs(argc, argv)) {
@@ -0,0 +1,3068 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "acm_codec.hpp"
+#include "alloc_counter.hpp"
+#include "base64_codec.hpp"
+#include "hex_codec.hpp"
+#include "asn1_arena.hpp"
+#include "asn1_dom.hpp"
+#include "asn1_xer.hpp"
+#include "asn_internal.h"
+#include "bsm_fast_path.hpp"
+#include "ode_envelope.hpp"
+#include "xml_page_pool.hpp"
+#include "spdlog/sinks/null_sink.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+/**
+ *
+ * TODO: Consider moving these to the CodecContext class?
+ */
+static int dynamic_buffer_append(const void *buffer, size_t size, void *app_key) {
+    buffer_structure_t *xb = static_cast<buffer_structure_t *>(app_key);
+
+    if (xb->buffer_size + size + 1 > xb->allocated_size) {
+        // the buffers persist across messages and are pre-sized, so this is rare.
+        size_t new_size = xb->allocated_size ? xb->allocated_size : 64;
+        while (xb->buffer_size + size + 1 > new_size) new_size *= 2;
+
+        // the C library allocator, NOT the asn1c macros: these buffers outlive the per-message arena.
+        char *new_buf = static_cast<char *>(std::realloc(xb->buffer, new_size));
+        if(!new_buf) return -1;
+
+        xb->buffer = new_buf;
+        xb->allocated_size = new_size;
+    }
+
+    memcpy(xb->buffer + xb->buffer_size, buffer, size);
+    xb->buffer_size += size;
+    // null terminate the string.
+    xb->buffer[xb->buffer_size] = '\0';
+    return 0;
+}
+
+const char* asn1errortypes[] = {
+    [static_cast<int>(Asn1ErrorType::SUCCESS)] = "SUCCESS",
+    [static_cast<int>(Asn1ErrorType::FAILURE)] = "FAILURE",
+    [static_cast<int>(Asn1ErrorType::REQUEST)] = "INVALID_REQUEST_TYPE_ERROR",
+    [static_cast<int>(Asn1ErrorType::DATA)]    = "INVALID_DATA_TYPE_ERROR"
+};
+
+const char* asn1datatypes[] = {
+    [static_cast<int>(Asn1DataType::ODE)] = "us.dot.its.jpo.ode.model.OdeStatus",
+    [static_cast<int>(Asn1DataType::XML)] = "MessageFrame",
+    [static_cast<int>(Asn1DataType::HEX)] = "us.dot.its.jpo.ode.model.OdeHexByteArray",
+    [static_cast<int>(Asn1DataType::PAYLOAD)] = "us.dot.its.jpo.ode.model.OdeAsn1Payload"
+};
+
+const char* codecstages[] = {
+    [static_cast<int>(CodecStage::ENVELOPE)]     = "envelope",
+    [static_cast<int>(CodecStage::REQUIREMENTS)] = "requirements",
+    [static_cast<int>(CodecStage::HEX)]          = "hex",
+    [static_cast<int>(CodecStage::BINARY)]       = "asn1c binary",
+    [static_cast<int>(CodecStage::CONSTRAINTS)]  = "asn1c constraints",
+    [static_cast<int>(CodecStage::XER)]          = "asn1c xer",
+    [static_cast<int>(CodecStage::SERIALIZE)]    = "serialize"
+};
+
+namespace {
+
+    // adds the time and allocations from construction to destruction to a stage; does nothing without stage times.
+    class StageClock {
+        public:
+            StageClock( CodecContext::StageTimes* times, CodecStage stage ) :
+                times_{ times }
+                , stage_{ stage }
+                , start_{ times ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} }
+                , allocs_{}
+            {}
+
+            ~StageClock() {
+                if ( times_ ) {
+                    int s = static_cast<int>(stage_);
+                    times_->ns[s] += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start_ ).count();
+                    AllocCounter::Counts counts = allocs_.counts();
+                    times_->allocations[s] += counts.allocations;
+                    times_->bytes[s] += counts.bytes;
+                }
+            }
+
+            StageClock( const StageClock& ) = delete;
+            StageClock& operator=( const StageClock& ) = delete;
+
+        private:
+            CodecContext::StageTimes* times_;
+            CodecStage stage_;
+            std::chrono::steady_clock::time_point start_;
+            AllocCounter allocs_;
+    };
+
+    // assigns the bytes of the PDU a stream decode used; false when the bytes end inside the PDU.
+    bool pdu_consumed( const asn_dec_rval_t& rval, std::size_t length, std::size_t* consumed ) {
+        if ( rval.code == RC_WMORE ) {
+            *consumed = 0;
+            return false;
+        }
+
+        // a failure leaves no way to find the next PDU.
+        *consumed = ( rval.code == RC_OK && rval.consumed > 0 && rval.consumed <= length ) ? rval.consumed : length;
+        return true;
+    }
+}
+
+std::ostream& operator<<( std::ostream& os, Asn1ErrorType err ) {
+    os << asn1errortypes[static_cast<int>(err)];
+	return os;
+}
+
+std::ostream& operator<<( std::ostream& os, Asn1DataType dt ) {
+    os << asn1datatypes[static_cast<int>(dt)];
+	return os;
+}
+
+CodecContext::CodecContext( std::shared_ptr<spdlog::logger> ilog, std::shared_ptr<spdlog::logger> elog, bool decode ) :
+    ilogger{ ilog }
+    , elogger{ elog }
+    , input_doc{}
+    , internal_doc{}
+    , error_doc{}
+    , xml_parse_options{ pugi::parse_default | pugi::parse_declaration | pugi::parse_doctype | pugi::parse_trim_pcdata }
+    , ode_payload_query{"OdeAsn1Data/payload/data"}
+    , ode_encodings_query{"OdeAsn1Data/metadata/encodings"}
+    , erroross{}
+    , clock_{}
+    , error_text_{}
+    , error_splices_{}
+    , byte_buffer{}
+    , errlen{ max_errbuf_size }
+    , validations_{
+        { &asn_DEF_Ieee1609Dot2Data, { ValidationPolicy::Mode::ALWAYS, 1000000 }, 0 },
+        { &asn_DEF_MessageFrame, { ValidationPolicy::Mode::ALWAYS, 1000000 }, 0 },
+        { &asn_DEF_AdvisorySituationData, { ValidationPolicy::Mode::ALWAYS, 1000000 }, 0 } }
+    , validation_stats_{ 0, 0, 0, 0 }
+    , budget_{ 0, 0, 0, 0 }
+    , budget_stats_{ 0, 0, 0 }
+    , codec_ctx_{ ASN__DEFAULT_STACK_MAX }
+    , deadline_{}
+    , over_budget_{ false }
+    , carry_{}
+    , stage_timing_{ false }
+    , stage_times_{}
+	, opsflag{0}
+    , decode_1609dot2{ false }
+    , decode_messageframe{ false }
+	, decode_asdframe{ false }
+	, decode_functionality_{ decode }
+	, decode_1609dot2_type{ATS_CANONICAL_OER}
+	, decode_messageframe_type{ATS_UNALIGNED_BASIC_PER}
+	, decode_asdframe_type{ATS_UNALIGNED_BASIC_PER}
+    , payload_node_{}
+    , encoded_data_{}
+    , encode_key_{}
+    , encode_hex_{}
+    , encode_pdus_{}
+    , encode_cache_{}
+    , tim_templates_{}
+    , input_buffer_{ nullptr }
+    , input_length_{ 0 }
+    , slice_input_{ true }
+    , dom_input_{ true }
+    , base64_output_{ false }
+    , scan_envelope_{ true }
+    , envelope_scanner_{}
+    , byte_hex_{}
+    , concatenated_pdus_{ false }
+    , decode_cache_{}
+    , map_cache_{}
+    , map_key_{}
+    , map_xer_{}
+    , spat_delta_{}
+    , spat_reduced_{ false }
+    , verifier_{ nullptr }
+    , signatures_{}
+    , lazy_decode_{ false, {} }
+    , lazy_hex_{}
+    , lazy_xml_{}
+    , signed_buffer_{ nullptr, 0, 0 }
+    , requirements_cache_{}
+    , requirements_next_{ 0 }
+    , arena_{}
+    , arena_retain_{ 0 }
+    , xml_pool_{}
+    , input_copy_{}
+    , xer_buffer_{ nullptr, 0, 0 }
+    , encode_buffer_{ nullptr, 0, 0 }
+    , output_estimates_{}
+    , splice_output_{ true }
+    , compact_xer_{ false }
+    , envelope_{}
+    , json_output_{ false }
+    , json_buffer_{}
+    , json_envelope_{}
+    , json_writer_{ json_buffer_ }
+    , projection_{}
+    , payload_only_{ false }
+    , metadata_{}
+    , message_id_{ -1 }
+    , error_type_{ Asn1ErrorType::SUCCESS }
+    , key_fields_{ 0 }
+    , message_key_{}
+    , frame_key_{}
+    , bsm_fast_path_{ true }
+    , fast_bsm_{}
+    , fast_xer_{}
+    , archive_{ nullptr }
+    , filters_{}
+    , verdict_{ BsmFilter::Verdict::PASS }
+    , dropped_frames_{ 0 }
+    , dropped_bytes_{ 0 }
+{
+    // contexts used outside of the Kafka tool (e.g., unit tests) may not have loggers; discard their output.
+    if ( !ilogger ) {
+        ilogger = std::make_shared<spdlog::logger>( "ilog_null", std::make_shared<spdlog::sinks::null_sink_mt>() );
+    }
+
+    if ( !elogger ) {
+        elogger = std::make_shared<spdlog::logger>( "elog_null", std::make_shared<spdlog::sinks::null_sink_mt>() );
+    }
+}
+
+CodecContext::~CodecContext() {
+    // the pool is destroyed before the documents; they return its blocks first.
+    {
+        XmlPagePool::Scope pool_scope{ xml_pool_.get() };
+        input_doc.reset();
+        internal_doc.reset();
+        error_doc.reset();
+    }
+
+    std::free( xer_buffer_.buffer );
+    std::free( encode_buffer_.buffer );
+    std::free( signed_buffer_.buffer );
+}
+
+void CodecContext::prepare_output_buffer( buffer_structure_t* buf, const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax ) {
+    std::size_t& estimate = output_estimates_[ std::make_pair( type, static_cast<int>( syntax ) ) ];
+
+    buf->buffer_size = 0;
+
+    // room for the estimate plus a margin; the estimate falls when an unusually large message is followed by normal
+    // ones, so the capacity is also returned after such outliers.
+    std::size_t wanted = estimate + estimate / 4 + 1;
+
+    if ( buf->allocated_size < wanted || ( buf->allocated_size > 4 * wanted && buf->allocated_size > max_retained_output ) ) {
+        char* p = static_cast<char*>( std::realloc( buf->buffer, wanted ) );
+        if ( p ) {
+            buf->buffer = p;
+            buf->allocated_size = wanted;
+        }
+    }
+}
+
+void CodecContext::record_output_size( const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax, std::size_t size ) {
+    std::size_t& estimate = output_estimates_[ std::make_pair( type, static_cast<int>( syntax ) ) ];
+
+    // a running average that follows increases immediately and decreases slowly.
+    estimate = ( size > estimate ) ? size : ( 7 * estimate + size ) / 8;
+}
+
+bool CodecContext::load_error_template( const std::string& errorfile ) {
+    static const char* fnname = "load_error_template()";
+
+    pugi::xml_parse_result result = error_doc.load_file( errorfile.c_str() );
+    if (!result) {
+        elogger->error("{}: Failure to find or parse the error template file: {} (offset = {})!", fnname , result.description(), result.offset);
+        return false;
+    } 
+
+    render_error_template();
+    return true;
+}
+
+ValidationPolicy ValidationPolicy::parse( const std::string& policy ) {
+    if ( policy == "always" ) return ValidationPolicy{ Mode::ALWAYS, 1000000 };
+    if ( policy == "off" ) return ValidationPolicy{ Mode::OFF, 0 };
+
+    static const std::string sample{ "sample:" };
+    if ( policy.compare( 0, sample.size(), sample ) == 0 && policy.size() > sample.size() ) {
+        std::string value = policy.substr( sample.size() );
+        std::size_t used = 0;
+
+        try {
+            if ( value.back() == '%' ) {
+                double percent = std::stod( value, &used );
+                if ( used == value.size() - 1 && percent > 0.0 && percent <= 100.0 ) {
+                    return ValidationPolicy{ Mode::SAMPLED, static_cast<uint32_t>( percent * 10000.0 + 0.5 ) };
+                }
+            } else {
+                unsigned long every = std::stoul( value, &used );
+                if ( used == value.size() && every > 0 ) {
+                    return ValidationPolicy{ Mode::SAMPLED, static_cast<uint32_t>( 1000000 / std::min( every, 1000000UL ) ) };
+                }
+            }
+        } catch ( const std::logic_error& ) {
+            // not a number; reported below.
+        }
+    }
+
+    throw std::invalid_argument{ "unknown validation policy: " + policy };
+}
+
+LazyDecode LazyDecode::parse( const std::string& setting ) {
+    if ( setting == "off" ) return LazyDecode{ false, {} };
+    if ( setting == "on" ) return LazyDecode{ true, {} };
+
+    LazyDecode lazy{ true, {} };
+    std::stringstream ss{ setting };
+    std::string psid;
+
+    while ( std::getline( ss, psid, ',' ) ) {
+        std::size_t used = 0;
+        unsigned long long value = 0;
+
+        try {
+            value = std::stoull( psid, &used, 0 );
+        } catch ( const std::logic_error& ) {
+            // not a number; reported below.
+        }
+
+        if ( used == 0 || used != psid.size() || psid[0] == '-' ) {
+            throw std::invalid_argument{ "unknown lazy decode setting: " + setting };
+        }
+
+        lazy.full_psids.push_back( static_cast<uintmax_t>( value ) );
+    }
+
+    if ( lazy.full_psids.empty() ) {
+        throw std::invalid_argument{ "unknown lazy decode setting: " + setting };
+    }
+
+    return lazy;
+}
+
+bool LazyDecode::lazy( uintmax_t psid ) const {
+    return enabled && std::find( full_psids.begin(), full_psids.end(), psid ) == full_psids.end();
+}
+
+bool CodecContext::set_validation_policy( const std::string& type_name, const ValidationPolicy& policy ) {
+    for ( Validation& v : validations_ ) {
+        if ( type_name == v.type->name ) {
+            v.policy = policy;
+            v.credit = 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const ValidationStats& CodecContext::validation_stats() const {
+    return validation_stats_;
+}
+
+void CodecContext::set_budget( const MessageBudget& budget ) {
+    budget_ = budget;
+    // without a limit of its own a decoder keeps asn1c's default one; 0 would turn the stack check off.
+    codec_ctx_.max_stack_size = budget.max_stack ? budget.max_stack : ASN__DEFAULT_STACK_MAX;
+}
+
+const BudgetStats& CodecContext::budget_stats() const {
+    return budget_stats_;
+}
+
+void CodecContext::start_budget( std::size_t length ) {
+    over_budget_ = false;
+
+    if ( budget_.max_bytes > 0 && length > budget_.max_bytes ) {
+        ++budget_stats_.oversize;
+        throw UnparseableInputError{ "message of " + std::to_string( length ) + " bytes is over the limit of " + std::to_string( budget_.max_bytes ) + " bytes.", Asn1DataType::ODE, Asn1ErrorType::DATA };
+    }
+
+    if ( budget_.max_ms > 0 ) {
+        deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds{ budget_.max_ms };
+    }
+
+    // the arena's scope resets it after every message; the limits are set again for each.
+    if ( arena_ ) {
+        arena_->set_limit( budget_.max_memory );
+        if ( budget_.max_ms > 0 ) arena_->set_deadline( deadline_ );
+    }
+}
+
+void CodecContext::check_budget() {
+    Asn1Arena::Exceeded exceeded = arena_ ? arena_->exceeded() : Asn1Arena::Exceeded::NONE;
+
+    if ( exceeded == Asn1Arena::Exceeded::NONE && budget_.max_ms > 0 && std::chrono::steady_clock::now() > deadline_ ) {
+        exceeded = Asn1Arena::Exceeded::TIME;
+    }
+
+    if ( exceeded == Asn1Arena::Exceeded::NONE ) return;
+
+    if ( !over_budget_ ) {
+        over_budget_ = true;
+        if ( exceeded == Asn1Arena::Exceeded::MEMORY ) {
+            ++budget_stats_.memory;
+        } else {
+            ++budget_stats_.time;
+        }
+    }
+
+    if ( exceeded == Asn1Arena::Exceeded::MEMORY ) {
+        throw Asn1CodecError{ "decoding stopped: the message went over the limit of " + std::to_string( budget_.max_memory ) + " bytes of memory." };
+    }
+
+    throw Asn1CodecError{ "decoding stopped: the message went over the limit of " + std::to_string( budget_.max_ms ) + " ms." };
+}
+
+void CodecContext::set_stage_timing( bool timing ) {
+    stage_timing_ = timing;
+    stage_times_ = StageTimes{};
+}
+
+const CodecContext::StageTimes& CodecContext::stage_times() const {
+    return stage_times_;
+}
+
+uint32_t CodecContext::operations() const {
+    return opsflag;
+}
+
+bool CodecContext::validation_due( const struct asn_TYPE_descriptor_s* type, const ValidationPolicy** policy ) {
+    Validation* validation = nullptr;
+
+    for ( Validation& v : validations_ ) {
+        if ( v.type == type ) validation = &v;
+    }
+
+    if ( validation ) {
+        if ( policy ) *policy = &validation->policy;
+
+        if ( validation->policy.mode == ValidationPolicy::Mode::OFF ) {
+            ++validation_stats_.skipped;
+            return false;
+        }
+
+        if ( validation->policy.mode == ValidationPolicy::Mode::SAMPLED ) {
+            validation->credit += validation->policy.rate_ppm;
+            if ( validation->credit < 1000000 ) {
+                ++validation_stats_.skipped;
+                return false;
+            }
+            validation->credit -= 1000000;
+        }
+    }
+
+    ++validation_stats_.checked;
+    return true;
+}
+
+int CodecContext::check_constraints( const struct asn_TYPE_descriptor_s* type, const void* sptr ) {
+    static const char* fnname = "check_constraints()";
+
+    const ValidationPolicy* policy = nullptr;
+    if ( !validation_due( type, &policy ) ) return 0;
+
+    errlen = max_errbuf_size;
+
+    int violated;
+    {
+        StageClock clock{ timing(), CodecStage::CONSTRAINTS };
+        violated = asn_check_constraints( type, sptr, errbuf, &errlen );
+    }
+
+    if ( !violated ) {
+        return 0;
+    }
+
+    ++validation_stats_.violations;
+
+    if ( policy && policy->mode == ValidationPolicy::Mode::SAMPLED ) {
+        ++validation_stats_.sampled_violations;
+        elogger->warn("{}: sampled constraints check of element {} failed: {}", fnname, type->name, std::string{ errbuf, errlen } );
+        return 0;
+    }
+
+    return 1;
+}
+
+void CodecContext::set_decode_functionality( bool decode ) {
+    decode_functionality_ = decode;
+}
+
+bool CodecContext::decode_functionality() const {
+    return decode_functionality_;
+}
+
+void CodecContext::use_arena( std::size_t chunk_size ) {
+    if ( chunk_size > 0 ) {
+        arena_.reset( new Asn1Arena{ chunk_size } );
+        arena_->set_retain( arena_retain_ );
+    } else {
+        arena_.reset();
+    }
+}
+
+void CodecContext::use_xml_pool( std::size_t chunk_size ) {
+    {
+        XmlPagePool::Scope pool_scope{ xml_pool_.get() };
+        input_doc.reset();
+        internal_doc.reset();
+    }
+
+    if ( chunk_size > 0 ) {
+        XmlPagePool::install();
+        xml_pool_.reset( new XmlPagePool{ chunk_size } );
+    } else {
+        xml_pool_.reset();
+    }
+}
+
+void CodecContext::use_decode_cache( std::size_t capacity ) {
+    decode_cache_.reset( capacity ? new ResultCache{ capacity } : nullptr );
+}
+
+void CodecContext::set_arena_retain( std::size_t max_bytes ) {
+    arena_retain_ = max_bytes;
+    if ( arena_ ) arena_->set_retain( max_bytes );
+}
+
+std::size_t CodecContext::arena_bytes() const {
+    return arena_ ? arena_->bytes_reserved() : 0;
+}
+
+std::size_t CodecContext::cache_bytes() const {
+    return decode_cache_stats().bytes + map_cache_stats().bytes + encode_cache_stats().bytes;
+}
+
+ResultCache::Stats CodecContext::decode_cache_stats() const {
+    return decode_cache_ ? decode_cache_->stats() : ResultCache::Stats{ 0, 0, 0, 0, 0 };
+}
+
+void CodecContext::use_map_cache( std::size_t capacity ) {
+    map_cache_.reset( capacity ? new ResultCache{ capacity } : nullptr );
+}
+
+ResultCache::Stats CodecContext::map_cache_stats() const {
+    return map_cache_ ? map_cache_->stats() : ResultCache::Stats{ 0, 0, 0, 0, 0 };
+}
+
+void CodecContext::use_spat_delta( bool delta, uint32_t snapshot_seconds ) {
+    spat_delta_.reset( delta ? new SpatDelta{ snapshot_seconds } : nullptr );
+}
+
+void CodecContext::set_verifier( SignatureVerifier* verifier ) {
+    verifier_ = verifier;
+    signatures_.clear();
+}
+
+SignatureVerifier::Status CodecContext::signature_status() const {
+    SignatureVerifier::Status status = SignatureVerifier::Status::NONE;
+    for ( const auto& ticket : signatures_ ) {
+        status = SignatureVerifier::combine( status, verifier_->wait( ticket ) );
+    }
+    return status;
+}
+
+void CodecContext::use_encode_cache( std::size_t capacity ) {
+    encode_cache_.reset( capacity ? new ResultCache{ capacity } : nullptr );
+}
+
+ResultCache::Stats CodecContext::encode_cache_stats() const {
+    return encode_cache_ ? encode_cache_->stats() : ResultCache::Stats{ 0, 0, 0, 0, 0 };
+}
+
+void CodecContext::use_encode_templates( std::size_t count ) {
+    tim_templates_.reset( count ? new TimTemplates{ count } : nullptr );
+}
+
+const TimTemplates* CodecContext::encode_templates() const {
+    return tim_templates_.get();
+}
+
+bool CodecContext::process( const void* buffer, std::size_t length, std::ostream& output_message_stream ) {
+    static const char* fnname = "process()";
+
+    // everything the asn1c runtime allocates for this message is released when the scope ends; pugixml's pages are
+    // recycled by the pool.
+    Asn1Arena::Scope arena_scope{ arena_.get() };
+    XmlPagePool::Scope pool_scope{ xml_pool_.get() };
+
+    try {
+
+        metadata_.clear();
+        message_id_ = -1;
+        error_type_ = Asn1ErrorType::SUCCESS;
+        message_key_.clear();
+        signatures_.clear();
+        reset_verdict();
+        if ( stage_timing_ ) stage_times_ = StageTimes{};
+
+        input_buffer_ = static_cast<const char*>( buffer );
+        input_length_ = length;
+
+        start_budget( length );                                         // throws.
+
+        // the common decode requests never build the DOM; the XER is always spliced into the copied envelope.
+        if ( decode_functionality_ && scan_envelope_ && splice_output_ && !json_output_ && decode_envelope( input_buffer_, input_length_, output_message_stream ) ) {
+            return true;
+        }
+
+        // pugi resets the document as part of load_buffer; it is parsed in place in a copy this context keeps.
+        pugi::xml_parse_result result;
+        {
+            StageClock clock{ timing(), CodecStage::ENVELOPE };
+            input_copy_.assign( input_buffer_, input_buffer_ + input_length_ );
+            result = input_doc.load_buffer_inplace( input_copy_.data(), input_copy_.size(), xml_parse_options );
+        }
+
+        // garbage input is the common error during upstream incidents; it is rejected without unwinding.
+        if (!result) {
+            std::string message = std::string{ "Input file parse error: " } + result.description() + " at offset " + std::to_string( result.offset );
+            SPDLOG_TRACE(elogger, "{}: UnparseableInputError {}", fnname , message );
+            save_error( Asn1DataType::ODE, Asn1ErrorType::REQUEST, message, output_message_stream );
+            return false;
+        } 
+
+        // examine the input xml encodings information and set the flags and requirements needed to properly parse the byte strings.
+        {
+            StageClock clock{ timing(), CodecStage::REQUIREMENTS };
+            set_codec_requirements( input_doc );        // throws.
+        }
+
+        // Retain this node reference. It is where the decoded result will be inserted.
+        payload_node_ = ode_payload_query.evaluate_node( input_doc ).node();
+
+        if ( !payload_node_ ) {
+            static const std::string message{ "Failed to find path: OdeAsn1Data/payload/data in the input document." };
+            SPDLOG_TRACE(elogger, "{}: UnparseableInputError {}", fnname , message );
+            save_error( Asn1DataType::ODE, Asn1ErrorType::REQUEST, message, output_message_stream );
+            return false;
+        } 
+
+        if ( decode_functionality_ ) {
+            decode_message( payload_node_, output_message_stream );          // throws
+        } else {
+            encode_message( output_message_stream );                         // throws
+        }
+
+    } catch (const UnparseableInputError& e) {
+
+        SPDLOG_TRACE(elogger, "{}: UnparseableInputError {}", fnname , e.what() );
+        save_error( e.data_type(), e.error_type(), e.what(), output_message_stream );
+        return false;
+
+    } catch (const MissingInputElementError& e) {
+
+        SPDLOG_TRACE(elogger, "{}: MissingInputElementError {}", fnname , e.what() );
+        save_error( e.data_type(), e.error_type(), e.what(), output_message_stream );
+        return false;
+
+    } catch (const pugi::xpath_exception& e ) {
+
+        SPDLOG_TRACE(elogger, "{}: pugi::xpath_exception {}", fnname, e.what() );
+        save_error( Asn1DataType::ODE, Asn1ErrorType::REQUEST, e.what(), output_message_stream );
+        return false;
+
+    } catch (const Asn1CodecError& e) {
+
+        SPDLOG_TRACE(elogger, "{}: Asn1CodecError {}", fnname , e.what() );
+        error_type_ = e.error_type();
+        add_error_xml( input_doc, e.data_type(), e.error_type(), e.what(), false );
+        save_document( input_doc, output_message_stream );
+        return false;
+    }
+
+    return true;
+}
+
+bool CodecContext::process_bytes( const void* bytes, std::size_t length, const char* encodings, std::size_t encodings_length, std::ostream& output_message_stream, std::size_t* consumed ) {
+    static const char* fnname = "process_bytes()";
+
+    // an error leaves no way to find the next PDU.
+    if ( consumed ) *consumed = length;
+
+    Asn1Arena::Scope arena_scope{ arena_.get() };
+    XmlPagePool::Scope pool_scope{ xml_pool_.get() };
+
+    try {
+
+        metadata_.clear();
+        message_id_ = -1;
+        error_type_ = Asn1ErrorType::SUCCESS;
+        message_key_.clear();
+        signatures_.clear();
+        reset_verdict();
+        if ( stage_timing_ ) stage_times_ = StageTimes{};
+
+        if ( !decode_functionality_ ) {
+            throw UnparseableInputError{ "Binary input can only be decoded." };
+        }
+
+        start_budget( length );                                         // throws.
+
+        {
+            StageClock clock{ timing(), CodecStage::REQUIREMENTS };
+            set_codec_requirements( encodings, encodings_length );     // throws.
+        }
+
+        if ( !decoding() ) {
+            throw MissingInputElementError{"An decoder was not specified in the encodings that this module understands."};
+        }
+
+        if ( length == 0 ) {
+            throw Asn1CodecError{ "failed attempt to decode binary input: no bytes." };
+        }
+
+        buffer_structure_t* xml_buffer = decode_messageframe ? &xer_buffer_ : nullptr;
+
+        bool complete = decode_layers( bytes, length, xml_buffer, consumed );             // throws.
+
+        if ( !complete ) {
+            // only the beginning of a PDU; the caller keeps it for the rest.
+            return true;
+        }
+
+        if ( verdict_ == BsmFilter::Verdict::DROP ) {
+            SPDLOG_TRACE(ilogger, "{}: every BSM was filtered; no response.", fnname );
+            return true;
+        }
+
+        if ( payload_only_ && decode_messageframe ) {
+            metadata_.data_type = asn1datatypes[static_cast<int>(Asn1DataType::XML)];
+            metadata_.encodings.assign( encodings, encodings_length );
+            save_payload( output_message_stream );
+        } else {
+            save_decoded( output_message_stream );
+        }
+
+    } catch (const UnparseableInputError& e) {
+
+        SPDLOG_TRACE(elogger, "{}: UnparseableInputError {}", fnname , e.what() );
+        save_error( e.data_type(), e.error_type(), e.what(), output_message_stream );
+        return false;
+
+    } catch (const MissingInputElementError& e) {
+
+        SPDLOG_TRACE(elogger, "{}: MissingInputElementError {}", fnname , e.what() );
+        save_error( e.data_type(), e.error_type(), e.what(), output_message_stream );
+        return false;
+
+    } catch (const Asn1CodecError& e) {
+
+        // there is no input document; the error template carries the failure.
+        SPDLOG_TRACE(elogger, "{}: Asn1CodecError {}", fnname , e.what() );
+        save_error( e.data_type(), e.error_type(), e.what(), output_message_stream );
+        return false;
+    }
+
+    return true;
+}
+
+std::size_t CodecContext::process_stream( const std::string& stream, const void* bytes, std::size_t length, const char* encodings, std::size_t encodings_length,
+        std::ostream& output_message_stream, const std::function<void( bool )>& respond ) {
+
+    std::vector<uint8_t>& carry = carry_[stream];
+
+    // without carried bytes the message is decoded where it is.
+    const uint8_t* data = static_cast<const uint8_t*>( bytes );
+    std::size_t size = length;
+
+    if ( !carry.empty() ) {
+        carry.insert( carry.end(), data, data + length );
+        data = carry.data();
+        size = carry.size();
+    }
+
+    std::size_t offset = 0;
+    std::size_t responses = 0;
+
+    while ( offset < size ) {
+        std::size_t consumed;
+        bool success = process_bytes( data + offset, size - offset, encodings, encodings_length, output_message_stream, &consumed );
+        if ( consumed == 0 ) break;
+
+        offset += consumed;
+        ++responses;
+        respond( success );
+    }
+
+    if ( size - offset > max_carried_pdu ) {
+        // the stream is not what its encodings say; start again with the next message.
+        save_error( Asn1DataType::ODE, Asn1ErrorType::DATA, "failed ASN.1 binary decoding: a PDU is split over more than " + std::to_string( max_carried_pdu ) + " bytes.", output_message_stream );
+        offset = size;
+        ++responses;
+        respond( false );
+    }
+
+    if ( carry.empty() ) {
+        carry.assign( data + offset, data + size );
+    } else {
+        carry.erase( carry.begin(), carry.begin() + offset );
+    }
+
+    return responses;
+}
+
+std::size_t CodecContext::carried_bytes( const std::string& stream ) const {
+    auto it = carry_.find( stream );
+    return it == carry_.end() ? 0 : it->second.size();
+}
+
+void CodecContext::save_decoded( std::ostream& output_message_stream ) {
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    const char* data_type = asn1datatypes[static_cast<int>(Asn1DataType::XML)];
+
+    if ( json_output_ ) {
+        json_envelope_.Clear();
+        json_writer_.Reset( json_envelope_ );
+
+        json_writer_.StartObject();
+        json_writer_.Key( "OdeAsn1Data" );
+        json_writer_.StartObject();
+        json_writer_.Key( "payload" );
+        json_writer_.StartObject();
+        json_writer_.Key( "dataType" );
+        json_writer_.String( data_type );
+        json_writer_.Key( "data" );
+        if ( decode_messageframe ) {
+            json_writer_.RawValue( json_buffer_.GetString(), json_buffer_.GetSize(), rapidjson::kObjectType );
+        } else {
+            json_writer_.String( "" );
+        }
+        json_writer_.EndObject();
+        json_writer_.EndObject();
+        json_writer_.EndObject();
+
+        output_message_stream.write( json_envelope_.GetString(), json_envelope_.GetSize() );
+        return;
+    }
+
+    output_message_stream << "<?xml version=\"1.0\"?>\n<OdeAsn1Data><payload><dataType>" << data_type << "</dataType><data>";
+    if ( decode_messageframe ) {
+        output_message_stream.write( xer_buffer_.buffer, xer_buffer_.buffer_size );
+    }
+    output_message_stream << "</data></payload></OdeAsn1Data>";
+}
+
+void CodecContext::ResponseMetadata::clear() {
+    payload_type.clear();
+    data_type.clear();
+    generated_at.clear();
+    encodings.clear();
+}
+
+void CodecContext::set_payload_only( bool payload_only ) {
+    payload_only_ = payload_only;
+}
+
+const CodecContext::ResponseMetadata& CodecContext::response_metadata() const {
+    return metadata_;
+}
+
+int32_t CodecContext::message_id() const {
+    return message_id_;
+}
+
+Asn1ErrorType CodecContext::error_type() const {
+    return error_type_;
+}
+
+void CodecContext::set_message_key( uint32_t fields ) {
+    // the MAP cache keeps the keys of its revisions.
+    if ( map_cache_ && fields != key_fields_ ) map_cache_->clear();
+    key_fields_ = fields;
+}
+
+const std::string& CodecContext::message_key() const {
+    return message_key_;
+}
+
+void CodecContext::key_frame( const MessageFrame_t& frame ) {
+    frame_key_.clear();
+    if ( !key_fields_ ) return;
+
+    const auto& value = frame.value.choice;
+    const IntersectionReferenceID_t* intersection = nullptr;
+
+    switch ( frame.value.present ) {
+        case MessageFrame__value_PR_BasicSafetyMessage:
+            if ( ( key_fields_ & static_cast<uint32_t>( MessageKey::BSM_ID ) ) && value.BasicSafetyMessage.coreData.id.buf ) {
+                hex_codec::encode( value.BasicSafetyMessage.coreData.id.buf, value.BasicSafetyMessage.coreData.id.size, frame_key_ );
+            }
+            break;
+        case MessageFrame__value_PR_MapData:
+            if ( value.MapData.intersections && value.MapData.intersections->list.count > 0 ) {
+                intersection = &value.MapData.intersections->list.array[0]->id;
+            }
+            break;
+        case MessageFrame__value_PR_SPAT:
+            if ( value.SPAT.intersections.list.count > 0 ) intersection = &value.SPAT.intersections.list.array[0]->id;
+            break;
+        case MessageFrame__value_PR_TravelerInformation:
+            if ( ( key_fields_ & static_cast<uint32_t>( MessageKey::TIM_PACKET_ID ) ) && value.TravelerInformation.packetID ) {
+                hex_codec::encode( value.TravelerInformation.packetID->buf, value.TravelerInformation.packetID->size, frame_key_ );
+            }
+            break;
+        default:
+            break;
+    }
+
+    if ( intersection && ( key_fields_ & static_cast<uint32_t>( MessageKey::INTERSECTION_ID ) ) ) {
+        if ( intersection->region ) frame_key_ = std::to_string( *intersection->region ) + ":";
+        frame_key_ += std::to_string( intersection->id );
+    }
+
+    if ( message_key_.empty() ) message_key_ = frame_key_;
+}
+
+void CodecContext::key_bsm( const uint8_t* id ) {
+    if ( ( key_fields_ & static_cast<uint32_t>( MessageKey::BSM_ID ) ) && message_key_.empty() ) hex_codec::encode( id, 4, message_key_ );
+}
+
+void CodecContext::save_payload( std::ostream& output_message_stream ) {
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    if ( json_output_ ) {
+        output_message_stream.write( json_buffer_.GetString(), json_buffer_.GetSize() );
+    } else {
+        output_message_stream.write( xer_buffer_.buffer, xer_buffer_.buffer_size );
+    }
+}
+
+void CodecContext::set_response_metadata( const pugi::xml_document& doc ) {
+    pugi::xml_node metadata = doc.child("OdeAsn1Data").child("metadata");
+
+    metadata_.payload_type = metadata.child("payloadType").text().get();
+    metadata_.generated_at = metadata.child("generatedAt").text().get();
+    metadata_.data_type = doc.child("OdeAsn1Data").child("payload").child("dataType").text().get();
+
+    metadata_.encodings.clear();
+    for ( pugi::xml_node n = metadata.child("encodings").first_child(); n; n = n.next_sibling() ) {
+        if ( !metadata_.encodings.empty() ) metadata_.encodings += ',';
+        metadata_.encodings += n.child("elementType").text().get();
+        metadata_.encodings += ':';
+        metadata_.encodings += n.child("encodingRule").text().get();
+    }
+}
+
+void CodecContext::set_response_metadata( const OdeEnvelope& envelope ) {
+    OdeEnvelope::Range payload_type = envelope.payload_type();
+    OdeEnvelope::Range generated_at = envelope.generated_at();
+
+    metadata_.payload_type.assign( payload_type.begin ? payload_type.begin : "", payload_type.size );
+    metadata_.generated_at.assign( generated_at.begin ? generated_at.begin : "", generated_at.size );
+    metadata_.data_type = asn1datatypes[static_cast<int>(Asn1DataType::XML)];
+
+    metadata_.encodings.clear();
+    for ( const OdeEnvelope::Encoding& encoding : envelope.encodings() ) {
+        if ( !metadata_.encodings.empty() ) metadata_.encodings += ',';
+        metadata_.encodings.append( encoding.element_type.begin ? encoding.element_type.begin : "", encoding.element_type.size );
+        metadata_.encodings += ':';
+        metadata_.encodings.append( encoding.encoding_rule.begin ? encoding.encoding_rule.begin : "", encoding.encoding_rule.size );
+    }
+}
+
+const std::string& CodecContext::get_current_time() const {
+    return clock_.now();
+}
+
+    /**
+     * Update the error information in the doc provided. The doc will have to conform to the schema below or this method
+     * will not do anything.
+     *
+     *
+     *
+     *
+     *
+     * Modify the following parts:
+     *      <?xml version="1.0"?>
+     *      <OdeAsn1Data>
+     *        <metadata>
+     *          <payloadType>us.dot.its.jpo.ode.model.OdeAsn1Payload</payloadType>
+     *          <serialId>
+     *            <streamId></streamId>
+     *            <bundleSize></bundleSize>
+     *            <bundleId></bundleId>
+     *            <recordId></recordId>
+     *            <serialNumber></serialNumber>
+     *          </serialId>
+     * >>>         <receivedAt>[TIMESTAMP]</receivedAt>
+     *          <schemaVersion>2</schemaVersion>
+     * >>>         <generatedAt>[TIMESTAMP]</generatedAt>
+     *          <logFileName></logFileName>
+     *          <validSignature></validSignature>
+     *          <sanitized></sanitized>
+     *          <encodings>
+     *          </encodings>
+     *        </metadata>
+     *        <payload>
+     * >>>         <dataType>us.dot.its.jpo.ode.model.OdeStatus</dataType>
+     *          <data>
+     * >>>             <code></code>
+     * >>>             <message></message>
+     *          </data>
+     *        </payload>
+     *      </OdeAsn1Data>
+     *
+     *
+     * doc:
+     * dt:
+     * et:
+     * message: this string will be COPIED INTO the xml dom by pugixml.
+     */
+
+bool CodecContext::add_error_xml( pugi::xml_document& doc, Asn1DataType dt, Asn1ErrorType et, std::string message, bool update_time ) {
+
+	static const char* fnname = "add_error_xml()";
+	bool r = true;
+
+	// Attempt to set all these fields; log the errors; return false if any fail.
+
+	// access this directly because we remove the bytes branch.
+	pugi::xml_node metadata_node = doc.child("OdeAsn1Data").child("metadata");
+	if ( !metadata_node ) {
+		//elogger->error("{}: Cannot find OdeAsn1Data/metadata nodes in function input document.", fnname );
+		return false;
+	}
+
+	pugi::xml_node payload_node  = doc.child("OdeAsn1Data").child("payload");
+	if ( !payload_node ) {
+		//elogger->error("{}: Cannot find OdeAsn1Data/payload nodes in function input document.", fnname );
+		return false;
+	}
+
+	if ( !metadata_node.child("payloadType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::PAYLOAD)]  ) ) {
+		//elogger->error("{}: Failure to update the payloadType field of the error xml", fnname );
+		r = false;
+	}
+
+	// receivedAt is only updatable if update_time is true.
+	if ( update_time && !metadata_node.child("receivedAt").text().set( get_current_time().c_str() ) ) {
+		//elogger->error("{}: Failure to update the receivedAt field of the error xml", fnname );
+		r = false;
+	}
+
+	// generateAt time is always updated; it is the time of generating this message.
+	if ( !metadata_node.child("generatedAt").text().set( get_current_time().c_str() ) ) {
+		//elogger->error("{}: Failure to update the generatedAt field of the error xml", fnname );
+		r = false;
+	}
+
+	if ( !payload_node.child("dataType").text().set( asn1datatypes[static_cast<int>(dt)]  ) ) {
+		//elogger->error("{}: Failure to update the dataType field of the error xml", fnname );
+		r = false;
+	}
+
+	pugi::xml_node data_node = payload_node.child("data");
+
+	// when bytes doesn't exist this is effectively a noop.
+	bool result = data_node.remove_child("bytes");
+
+	if ( !data_node.child("code") ) {
+		data_node.append_child("code");
+	}
+
+	if ( !data_node.child("message") ) {
+		data_node.append_child("message");
+	}
+
+	if ( !data_node.child("code").text().set( asn1errortypes[static_cast<int>(et)]  ) ) {
+		//elogger->error("{}: Failure to update the data/code field of the error xml", fnname );
+		r = false;
+	}
+
+	if ( !data_node.child("message").text().set( message.c_str() ) ) {
+		//elogger->error("{}: Failure to update the data/message field of the error xml", fnname );
+		r = false;
+	}
+
+	return r;
+}
+
+enum asn_transfer_syntax CodecContext::get_ats_transfer_syntax( const char* ats ) {
+
+    enum asn_transfer_syntax r = ATS_INVALID;
+
+    if ( std::strcmp( ats, "UPER" ) == 0 ) {
+
+        r = ATS_UNALIGNED_BASIC_PER;
+
+    } else if ( std::strcmp( ats, "COER" ) == 0 ) {
+
+        r = ATS_CANONICAL_OER;
+
+    } else if ( std::strcmp( ats, "XER" ) == 0 ) {
+
+        r = ATS_BASIC_XER;
+
+    } else if ( std::strcmp( ats, "CPER" ) == 0 ) {
+
+        r = ATS_UNALIGNED_CANONICAL_PER;
+
+    } else if ( std::strcmp( ats, "CXER" ) == 0 ) {
+        
+        r = ATS_CANONICAL_XER;
+
+    } else if ( std::strcmp( ats, "BER" ) == 0 ) {
+
+        r = ATS_BER;
+
+    } else if ( std::strcmp( ats, "DER" ) == 0 ) {
+
+        r = ATS_DER;
+
+    } else if ( std::strcmp( ats, "CER" ) == 0 ) {
+
+        r = ATS_CER;
+
+    }
+
+    return r;
+}
+
+constexpr const char* CodecContext::xer_placeholder;
+
+namespace {
+
+    // collects the serialized envelope; the string keeps its capacity between messages.
+    struct StringWriter : pugi::xml_writer {
+        std::string& out;
+
+        explicit StringWriter( std::string& s ) : out( s ) {}
+
+        void write( const void* data, size_t size ) override {
+            out.append( static_cast<const char*>( data ), size );
+        }
+    };
+}
+
+void CodecContext::save_with_xer( std::ostream& output_message_stream, const buffer_structure_t& xer ) {
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    envelope_.clear();
+    StringWriter writer{ envelope_ };
+    input_doc.save( writer, "", pugi::format_raw );
+
+    // a processing instruction without a value is serialized as <?name?>.
+    std::string marker = std::string{ "<?" } + xer_placeholder + "?>";
+    std::size_t pos = envelope_.find( marker );
+
+    if ( pos == std::string::npos ) {
+        throw Asn1CodecError{ "J2735 decoded XER could not be placed in the output document." };
+    }
+
+    output_message_stream.write( envelope_.data(), pos );
+    output_message_stream.write( xer.buffer, xer.buffer_size );
+    output_message_stream.write( envelope_.data() + pos + marker.size(), envelope_.size() - pos - marker.size() );
+}
+
+void CodecContext::save_document( const pugi::xml_document& doc, std::ostream& output_message_stream, const rapidjson::StringBuffer* json ) {
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    if ( !json_output_ ) {
+        doc.save( output_message_stream, "", pugi::format_raw );
+        return;
+    }
+
+    json_envelope_.Clear();
+    json_writer_.Reset( json_envelope_ );
+
+    if ( json ) {
+        asn1_json::write_xml( doc, json_writer_, xer_placeholder, json->GetString(), json->GetSize() );
+    } else {
+        asn1_json::write_xml( doc, json_writer_ );
+    }
+
+    output_message_stream.write( json_envelope_.GetString(), json_envelope_.GetSize() );
+}
+
+namespace {
+
+    // the text escapes pugixml uses for PCDATA.
+    void write_escaped( std::ostream& os, const std::string& text ) {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        const char* run = p;
+
+        for ( ; p < end; ++p ) {
+            unsigned char c = static_cast<unsigned char>( *p );
+            if ( c != '&' && c != '<' && c != '>' && ( c >= 32 || c == '\t' || c == '\n' || c == '\r' ) ) continue;
+
+            os.write( run, p - run );
+            run = p + 1;
+
+            if ( c == '&' ) {
+                os << "&amp;";
+            } else if ( c == '<' ) {
+                os << "&lt;";
+            } else if ( c == '>' ) {
+                os << "&gt;";
+            } else {
+                os << "&#" << static_cast<unsigned>( c ) << ';';
+            }
+        }
+
+        os.write( run, end - run );
+    }
+}
+
+void CodecContext::render_error_template() {
+    // in ErrorField order.
+    static const char* field_paths[] = {
+        "OdeAsn1Data/metadata/receivedAt",                              // RECEIVED_AT
+        "OdeAsn1Data/metadata/generatedAt",                             // GENERATED_AT
+        "OdeAsn1Data/payload/dataType",                                 // DATA_TYPE
+        "OdeAsn1Data/payload/data/code",                                // CODE
+        "OdeAsn1Data/payload/data/message"                              // MESSAGE
+    };
+    static_assert( sizeof( field_paths ) / sizeof( field_paths[0] ) == static_cast<std::size_t>( ErrorField::COUNT ),
+            "a path for every ErrorField" );
+
+    error_text_.clear();
+    error_splices_.clear();
+
+    // the fixed fields (payloadType, no bytes, code and message elements) are set once; a processing instruction
+    // marks where each variable field is written.
+    if ( !add_error_xml( error_doc, Asn1DataType::ODE, Asn1ErrorType::REQUEST, "", true ) ) return;
+
+    pugi::xml_document rendered;
+    rendered.reset( error_doc );
+
+    for ( int f = 0; f < static_cast<int>(ErrorField::COUNT); ++f ) {
+        pugi::xml_node node = rendered.first_element_by_path( field_paths[f] );
+        if ( !node ) return;
+
+        while ( node.first_child() ) node.remove_child( node.first_child() );
+
+        std::string marker = std::string{ xer_placeholder } + "-" + std::to_string( f );
+        node.append_child( pugi::node_pi ).set_name( marker.c_str() );
+    }
+
+    std::string text;
+    StringWriter writer{ text };
+    rendered.save( writer, "", pugi::format_raw );
+
+    for ( int f = 0; f < static_cast<int>(ErrorField::COUNT); ++f ) {
+        std::string marker = std::string{ "<?" } + xer_placeholder + "-" + std::to_string( f ) + "?>";
+        std::size_t pos = text.find( marker );
+        if ( pos == std::string::npos ) {
+            error_splices_.clear();
+            return;
+        }
+        error_splices_.push_back( { pos, static_cast<ErrorField>( f ) } );
+    }
+
+    std::sort( error_splices_.begin(), error_splices_.end(), []( const ErrorSplice& a, const ErrorSplice& b ) { return a.offset < b.offset; } );
+
+    // cut the markers out; the offsets move to the remaining text.
+    std::size_t removed = 0;
+    std::size_t from = 0;
+    for ( ErrorSplice& splice : error_splices_ ) {
+        std::size_t marker_length = std::strlen( xer_placeholder ) + 5 + std::to_string( static_cast<int>( splice.field ) ).size();
+        error_text_.append( text, from, splice.offset - from );
+        from = splice.offset + marker_length;
+        splice.offset -= removed;
+        removed += marker_length;
+    }
+    error_text_.append( text, from, std::string::npos );
+}
+
+void CodecContext::save_error( Asn1DataType dt, Asn1ErrorType et, const std::string& message, std::ostream& output_message_stream ) {
+    // an error response is not the message type it failed to be, and it is always written.
+    message_id_ = -1;
+    error_type_ = et;
+    message_key_.clear();
+    signatures_.clear();
+    verdict_ = BsmFilter::Verdict::PASS;
+
+    if ( json_output_ || error_splices_.empty() ) {
+        add_error_xml( error_doc, dt, et, message, true );
+        save_document( error_doc, output_message_stream );
+        return;
+    }
+
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    const std::string& now = get_current_time();
+    std::size_t from = 0;
+
+    for ( const ErrorSplice& splice : error_splices_ ) {
+        output_message_stream.write( error_text_.data() + from, splice.offset - from );
+        from = splice.offset;
+
+        switch ( splice.field ) {
+            case ErrorField::RECEIVED_AT:
+            case ErrorField::GENERATED_AT:
+                output_message_stream << now;
+                break;
+            case ErrorField::DATA_TYPE:
+                output_message_stream << asn1datatypes[static_cast<int>(dt)];
+                break;
+            case ErrorField::CODE:
+                output_message_stream << asn1errortypes[static_cast<int>(et)];
+                break;
+            default:
+                write_escaped( output_message_stream, message );
+                break;
+        }
+    }
+
+    output_message_stream.write( error_text_.data() + from, error_text_.size() - from );
+}
+
+void CodecContext::set_splice_output( bool splice ) {
+    splice_output_ = splice;
+}
+
+void CodecContext::set_slice_input( bool slice ) {
+    slice_input_ = slice;
+}
+
+void CodecContext::set_dom_input( bool dom ) {
+    dom_input_ = dom;
+}
+
+void CodecContext::set_base64_output( bool base64 ) {
+    base64_output_ = base64;
+}
+
+void CodecContext::set_scan_envelope( bool scan ) {
+    scan_envelope_ = scan;
+}
+
+void CodecContext::set_json_output( bool json ) {
+    json_output_ = json;
+}
+
+void CodecContext::set_projection( const std::string& paths ) {
+    projection_.reset( paths.empty() ? nullptr : new Asn1Projection{ paths } );      // throws.
+
+    // the cached output was written with the previous fields.
+    if ( decode_cache_ ) decode_cache_->clear();
+}
+
+void CodecContext::set_bsm_fast_path( bool fast ) {
+    bsm_fast_path_ = fast;
+}
+
+void CodecContext::set_compact_xer( bool compact ) {
+    compact_xer_ = compact;
+}
+
+void CodecContext::set_archive( BsmArchive* archive ) {
+    archive_ = archive;
+}
+
+BsmArchive* CodecContext::archive() const {
+    return archive_;
+}
+
+void CodecContext::add_filter( BsmFilter* filter ) {
+    if ( filter ) filters_.push_back( filter );
+}
+
+void CodecContext::clear_filters() {
+    filters_.clear();
+}
+
+BsmFilter::Verdict CodecContext::verdict() const {
+    return verdict_;
+}
+
+std::size_t CodecContext::dropped_frames() const {
+    return dropped_frames_;
+}
+
+std::size_t CodecContext::dropped_bytes() const {
+    return dropped_bytes_;
+}
+
+void CodecContext::reset_verdict() {
+    verdict_ = BsmFilter::Verdict::PASS;
+    dropped_frames_ = 0;
+    dropped_bytes_ = 0;
+}
+
+BsmFilter::Verdict CodecContext::filter_bsm( std::size_t bytes ) {
+    BsmFilter::Verdict r = BsmFilter::Verdict::PASS;
+
+    for ( BsmFilter* filter : filters_ ) {
+        BsmFilter::Verdict v = filter->test( fast_bsm_ );
+        if ( v == BsmFilter::Verdict::DROP ) {
+            ++dropped_frames_;
+            dropped_bytes_ += bytes;
+            r = v;
+            break;
+        }
+        if ( v == BsmFilter::Verdict::DIVERT ) r = v;
+    }
+
+    if ( r > verdict_ ) verdict_ = r;
+    return r;
+}
+
+void CodecContext::set_concatenated_pdus( bool concatenated ) {
+    concatenated_pdus_ = concatenated;
+}
+
+/**
+ * @brief Whether the encoding attribute of a payload's bytes element selects base64; no value and "hex" select hex.
+ */
+// throws Asn1CodecError ONLY!
+static bool base64_encoding( const char* value, std::size_t size ) {
+    if ( size == 0 || ( size == 3 && std::memcmp( value, "hex", 3 ) == 0 ) ) return false;
+    if ( size == 6 && std::memcmp( value, "base64", 6 ) == 0 ) return true;
+    throw Asn1CodecError{ "unknown encoding of the payload bytes: " + std::string{ value, size } + "; expected hex or base64." };
+}
+
+/**
+ * @brief Convert the text of a payload's bytes in either encoding.
+ *
+ * @return npos on success; otherwise the offset of the first bad character.
+ */
+static std::size_t text_to_bytes( const std::string& text, bool base64, std::vector<char>& bytes ) {
+    return base64 ? base64_codec::decode( text, bytes ) : hex_codec::decode( text, bytes );
+}
+
+bool CodecContext::decode_message( pugi::xml_node& payload_node, std::ostream& output_message_stream ) {
+
+    static const char* fnname = "decode_message()";
+    bool success = true;
+    pugi::xml_parse_result parse_result;
+
+    SPDLOG_TRACE(ilogger, "{}: starting...", fnname);
+
+    if ( !decoding() ) {
+        // if none of these is set, this function becomes a noop and nothing will be returned, so this is an
+        // exception.
+        throw MissingInputElementError{"An decoder was not specified in the encodingType tag that this module understands."};
+    }
+
+    // access this directly because we remove the bytes branch.
+    pugi::xml_node bytes_node = payload_node.child("bytes");
+    pugi::xml_text text = bytes_node.text();
+
+    if ( text ) {
+        // store the bytes and remove the bytes node since we replace it.
+        std::string hstr{ text.get() };
+        const char* encoding = bytes_node.attribute("encoding").value();
+        bool base64 = base64_encoding( encoding, std::strlen( encoding ) );                 // throws.
+        payload_node.remove_child("bytes");
+
+        // the ASD and the Ieee 1609.2 frame are containers; the bytes of each inner layer are decoded from the structure
+        // around it without a round trip through XER, XML, and hex.
+		decode_hex_data( hstr, decode_messageframe ? &xer_buffer_ : nullptr, base64 );      // throws.
+
+		if ( verdict_ == BsmFilter::Verdict::DROP ) {
+			SPDLOG_TRACE(ilogger, "{}: every BSM was filtered; no response.", fnname);
+			return success;
+		}
+
+		if ( success && decode_messageframe ) {
+
+			// eliminate the original hex string, so the new XML can be inserted.
+			payload_node.text().set("");
+
+			if ( !payload_node.parent().child("dataType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::XML)] ) ) {
+				throw MissingInputElementError{"Could not update the dataType field of the payload section."};
+			}
+
+			if ( payload_only_ ) {
+				// the envelope travels separately; only the decoded MessageFrame is written.
+				set_response_metadata( input_doc );
+				save_payload( output_message_stream );
+
+				SPDLOG_TRACE(ilogger, "{}: finished...", fnname);
+				return success;
+			}
+
+			if ( splice_output_ || json_output_ ) {
+				// the canonical XER (or JSON) is written where the placeholder is serialized; it is never parsed or copied into the DOM.
+				pugi::xml_node placeholder = payload_node.append_child( pugi::node_pi );
+				placeholder.set_name( xer_placeholder );
+
+				try {
+					if ( json_output_ ) {
+						save_document( input_doc, output_message_stream, &json_buffer_ );
+					} else {
+						save_with_xer( output_message_stream, xer_buffer_ );
+					}
+				} catch ( ... ) {
+					payload_node.remove_child( placeholder );
+					throw;
+				}
+
+				payload_node.remove_child( placeholder );
+
+				SPDLOG_TRACE(ilogger, "{}: finished...", fnname);
+				return success;
+			}
+
+			StageClock clock{ timing(), CodecStage::SERIALIZE };
+			// the XER is not used after it is copied into the payload, so it is parsed in place.
+			parse_result = internal_doc.load_buffer_inplace( static_cast<void *>( xer_buffer_.buffer), xer_buffer_.buffer_size );
+
+			if ( !parse_result ) {
+				erroross.str("");
+				erroross <<"J2735 decoded XER cannot be parsed/loaded as a valid document: "<< parse_result.description() << " at offset " << parse_result.offset;
+				throw Asn1CodecError{ erroross.str() };
+			}
+
+			payload_node.append_copy( internal_doc.document_element() );
+		}
+
+    } else {
+        throw MissingInputElementError{"failure accessing input XML bytes node."};
+    }
+
+    // convert DOM to a RAW string representation: no spaces, no tabs.
+    save_document( input_doc, output_message_stream );
+    SPDLOG_TRACE(ilogger, "{}: finished...", fnname);
+    return success;
+} 
+
+const CodecContext::EncodePlan& CodecContext::encode_plan( uint32_t ops ) {
+
+    // Built once, on first use, for every opsflag combination; the plans are immutable afterwards. Each plan encodes
+    // the innermost layer first and places its bytes in the enclosing layer, which is encoded next.
+    static const std::vector<EncodePlan> plans = []() {
+        std::vector<EncodePlan> p( ASDFRAME_IEEE1609DOT2_J2735MESSAGEFRAME + 1 );
+
+        p[IEEE1609DOT2] = {
+            { IEEE1609DOT2, &asn_DEF_Ieee1609Dot2Data, { "Ieee1609Dot2Data" }, "Ieee1609Dot2Data", false }
+        };
+
+        p[J2735MESSAGEFRAME] = {
+            { J2735MESSAGEFRAME, &asn_DEF_MessageFrame, { "MessageFrame" }, "MessageFrame", false }
+        };
+
+        p[IEEE1609DOT2_J2735MESSAGEFRAME] = {
+            { J2735MESSAGEFRAME, &asn_DEF_MessageFrame, { "Ieee1609Dot2Data", "content", "unsecuredData", "MessageFrame" }, "Ieee1609Dot2Data/content/unsecuredData/MessageFrame", true },
+            { IEEE1609DOT2, &asn_DEF_Ieee1609Dot2Data, { "Ieee1609Dot2Data" }, "Ieee1609Dot2Data", false }
+        };
+
+        p[ASDFRAME] = {
+            { ASDFRAME, &asn_DEF_AdvisorySituationData, { "AdvisorySituationData" }, "AdvisorySituationData", false }
+        };
+
+        p[ASDFRAME_IEEE1609DOT2] = {
+            { IEEE1609DOT2, &asn_DEF_Ieee1609Dot2Data, { "AdvisorySituationData", "asdmDetails", "advisoryMessage", "Ieee1609Dot2Data" }, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data", true },
+            { ASDFRAME, &asn_DEF_AdvisorySituationData, { "AdvisorySituationData" }, "AdvisorySituationData", false }
+        };
+
+        p[ASDFRAME_J2735MESSAGEFRAME] = {
+            { J2735MESSAGEFRAME, &asn_DEF_MessageFrame, { "AdvisorySituationData", "asdmDetails", "advisoryMessage", "MessageFrame" }, "AdvisorySituationData/asdmDetails/advisoryMessage/MessageFrame", true },
+            { ASDFRAME, &asn_DEF_AdvisorySituationData, { "AdvisorySituationData" }, "AdvisorySituationData", false }
+        };
+
+        p[ASDFRAME_IEEE1609DOT2_J2735MESSAGEFRAME] = {
+            { J2735MESSAGEFRAME, &asn_DEF_MessageFrame, { "AdvisorySituationData", "asdmDetails", "advisoryMessage", "Ieee1609Dot2Data", "content", "unsecuredData", "MessageFrame" }, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data/content/unsecuredData/MessageFrame", true },
+            { IEEE1609DOT2, &asn_DEF_Ieee1609Dot2Data, { "AdvisorySituationData", "asdmDetails", "advisoryMessage", "Ieee1609Dot2Data" }, "AdvisorySituationData/asdmDetails/advisoryMessage/Ieee1609Dot2Data", true },
+            { ASDFRAME, &asn_DEF_AdvisorySituationData, { "AdvisorySituationData" }, "AdvisorySituationData", false }
+        };
+
+        return p;
+    }();
+
+    static const EncodePlan none{};
+    return ( ops < plans.size() ) ? plans[ops] : none;
+}
+
+enum asn_transfer_syntax CodecContext::transfer_syntax( uint32_t op ) const {
+    const PduType* t = ( op < sizeof( pdu_ops ) / sizeof( pdu_ops[0] ) ) ? pdu_ops[op] : nullptr;
+    return t ? this->*t->syntax : ATS_INVALID;
+}
+
+bool CodecContext::input_slice( const pugi::xml_node& node, const char*& xml, std::size_t& length ) const {
+    std::ptrdiff_t name_offset = node.offset_debug();
+    const char* name = node.name();
+    std::size_t name_length = std::strlen( name );
+
+    // the name must be where the parser found it in the original message.
+    if ( !input_buffer_ || name_offset < 1 || static_cast<std::size_t>( name_offset ) + name_length > input_length_ ) return false;
+
+    const char* begin = input_buffer_ + name_offset - 1;
+    const char* end = input_buffer_ + input_length_;
+
+    if ( *begin != '<' || std::memcmp( begin + 1, name, name_length ) != 0 ) return false;
+
+    // scan the tags after the start tag counting nested elements with the same name; anything other than elements
+    // and text (comments, CDATA, processing instructions) is left to the DOM.
+    int depth = 0;
+    const char* p = begin;
+
+    while ( p < end ) {
+        if ( *p != '<' ) {
+            p = static_cast<const char*>( std::memchr( p, '<', end - p ) );
+            if ( !p ) return false;
+            continue;
+        }
+
+        bool closing = ( p + 1 < end && p[1] == '/' );
+        const char* tag_name = p + ( closing ? 2 : 1 );
+
+        if ( tag_name < end && ( *tag_name == '!' || *tag_name == '?' ) ) return false;
+
+        const char* gt = tag_name;
+        char quote = 0;
+        for ( ; gt < end; ++gt ) {
+            if ( quote ) {
+                if ( *gt == quote ) quote = 0;
+            } else if ( *gt == '"' || *gt == '\'' ) {
+                quote = *gt;
+            } else if ( *gt == '>' ) {
+                break;
+            }
+        }
+        if ( gt == end ) return false;
+
+        bool same_name = ( static_cast<std::size_t>( gt - tag_name ) >= name_length
+                && std::memcmp( tag_name, name, name_length ) == 0
+                && ( tag_name[name_length] == '>' || tag_name[name_length] == '/' || std::isspace( static_cast<unsigned char>( tag_name[name_length] ) ) ) );
+
+        if ( same_name ) {
+            if ( closing ) {
+                --depth;
+            } else if ( gt[-1] != '/' ) {
+                ++depth;
+            }
+
+            if ( depth == 0 ) {
+                xml = begin;
+                length = static_cast<std::size_t>( gt + 1 - begin );
+                return true;
+            }
+        }
+
+        p = gt + 1;
+    }
+
+    return false;
+}
+
+void CodecContext::encode_node( const EncodeStep& step, pugi::xml_node pdu, bool pristine, const std::string* inner, std::string& bytes ) {
+
+    // follow the pre-split path below the PDU element (its first segment); no path parsing or string building unless it
+    // fails.
+    pugi::xml_node node = pdu;
+    for ( std::size_t i = 1; node && i < step.path.size(); ++i ) {
+        node = node.child( step.path[i] );
+    }
+
+    if (!node) {
+        throw MissingInputElementError{std::string{"Failed to find path: "} + step.path_name + "in the input document."};
+    }
+
+    pugi::xml_node parent_node = node.parent();
+
+    if (!parent_node) {
+        throw MissingInputElementError{std::string{"Failed to find parent node for: "} + step.path_name + "in the input document."};
+    }
+
+    // the structure is filled from the document unless the encode cache needs the element's XML as its key; until the
+    // document is modified that XML is already in the input message, otherwise serialize the child.
+    const char* xml = nullptr;
+    std::size_t xml_length = 0;
+    void* filled = nullptr;
+    bool owned = true;
+    bool valid = true;
+
+    if ( tim_templates_ && !inner && step.type == &asn_DEF_MessageFrame && slice_input_ && pristine
+            && input_slice( node, xml, xml_length ) && tim_templates_->split( xml, xml_length ) ) {
+        filled = tim_templates_->find();
+
+        if ( !filled ) {
+            // the template outlives the message, so it is not decoded into the message's arena; a TIM that does not
+            // decode is left to the usual path for its error.
+            StageClock clock{ timing(), CodecStage::XER };
+            Asn1Arena::Suspend heap;
+            asn_dec_rval_t rval = xer_decode( &codec_ctx_, &asn_DEF_MessageFrame, &filled, xml, xml_length );
+            if ( rval.code == RC_OK ) {
+                tim_templates_->insert( static_cast<MessageFrame_t*>( filled ) );
+            } else {
+                ASN_STRUCT_FREE( asn_DEF_MessageFrame, filled );
+                filled = nullptr;
+            }
+        }
+
+        owned = filled == nullptr;
+    } else if ( dom_input_ && !encode_cache_ ) {
+        StageClock clock{ timing(), CodecStage::XER };
+        valid = asn1_dom::fill( step.type, node, &filled, &codec_ctx_ );
+    } else if ( !( slice_input_ && pristine && input_slice( node, xml, xml_length ) ) ) {
+        StageClock clock{ timing(), CodecStage::SERIALIZE };
+        envelope_.clear();
+        StringWriter writer{ envelope_ };
+        node.print( writer, "", pugi::format_raw );
+        xml = envelope_.data();
+        xml_length = envelope_.size();
+    }
+
+    // remove the child node from parent; the enclosing layer gets the encoding in its structure, not as hex text in the
+    // document it is decoded from.
+    if ( !parent_node.remove_child(node) ) {
+        if ( filled && owned ) ASN_STRUCT_FREE( *step.type, filled );
+        throw MissingInputElementError{"Failed to find child node in the input document."};
+    }
+
+    // the element is removed from the document in an error response too.
+    if ( !valid ) {
+        check_budget();                                                 // throws.
+        throw Asn1CodecError{ std::string{"failed ASN.1 decoding of XML element "} + step.type->name + ": bad data." };
+    }
+
+    // do the encoding
+    encode_frame_data(step, xml, xml_length, inner, bytes, filled, owned);
+}
+
+void CodecContext::encode_for_protocol( const EncodePlan& plan, pugi::xml_node pdu ) {
+    // the encodings keep their capacity between messages.
+    if ( encoded_data_.size() < plan.size() ) encoded_data_.resize( plan.size() );
+
+    for ( std::size_t i = 0; i < plan.size(); ++i ) {
+        // only the first step sees the PDU as it was parsed; a step encloses the encoding of the step before it when
+        // that one was replaced.
+        const std::string* inner = ( i > 0 && plan[i - 1].replace ) ? &encoded_data_[i - 1] : nullptr;
+        encode_node( plan[i], pdu, i == 0, inner, encoded_data_[i] );
+    }
+
+    // hex is produced only for the output.
+    for ( std::size_t i = 0; i < plan.size(); ++i ) {
+        const char* node_name = plan[i].path.back();
+
+        {
+            StageClock clock{ timing(), CodecStage::HEX };
+            if ( base64_output_ ) {
+                base64_codec::encode( encoded_data_[i].data(), encoded_data_[i].size(), encode_hex_ );
+            } else {
+                hex_codec::encode( encoded_data_[i].data(), encoded_data_[i].size(), encode_hex_ );
+            }
+        }
+
+        pugi::xml_node bytes_node = payload_node_.append_child(node_name).append_child("bytes");
+        if ( base64_output_ ) bytes_node.append_attribute("encoding").set_value("base64");
+
+        if ( !bytes_node.text().set(encode_hex_.c_str()) ) {
+            throw MissingInputElementError{std::string{"Failure to append path: OdeAsn1Data/payload/data/"} + node_name + "/bytes to the output document."};
+        }
+    }
+
+    if (!payload_node_.parent().child("dataType").text().set( asn1datatypes[static_cast<int>(Asn1DataType::HEX)] ) ) {
+            throw MissingInputElementError{"Failure to update path: OdeAsn1Data/payload/dataType in the output document."};
+    }
+}
+
+// throws MissingInputElementError or Asn1CodecError (from encode_messageframe_data call) ONLY!
+bool CodecContext::encode_message( std::ostream& output_message_stream ) {
+
+    const EncodePlan& plan = encode_plan( opsflag );
+
+    if ( plan.empty() ) {
+        throw MissingInputElementError{"An encoder was not specified in the encodingType tag that this module understands."};
+    }
+
+    // a batch request holds several PDUs in data; they share the encodings, so each is encoded with the same plan and
+    // the encoded PDUs replace them in order. The PDUs are found first because encoding removes them.
+    const char* pdu_name = plan.front().path.front();
+    encode_pdus_.clear();
+    for ( pugi::xml_node pdu = payload_node_.child( pdu_name ); pdu; pdu = pdu.next_sibling( pdu_name ) ) {
+        encode_pdus_.push_back( pdu );
+    }
+
+    if ( encode_pdus_.empty() ) {
+        encode_for_protocol( plan, pugi::xml_node{} );      // throws the missing element error.
+    }
+
+    for ( pugi::xml_node& pdu : encode_pdus_ ) {
+        encode_for_protocol( plan, pdu );
+    }
+
+    // convert DOM to a RAW string representation: no spaces, no tabs.
+    // for testing.
+    save_document( input_doc, output_message_stream );
+
+    return true;
+}
+
+/**
+ * @brief Find the unsecuredData of a decoded IEEE 1609.2 structure; this is the search performed by the XPath
+ * Ieee1609Dot2Data/content//unsecuredData: unsecured content, or the unsecured content of a signed payload.
+ *
+ * @return the unsecuredData OCTET STRING or nullptr if there is none.
+ */
+static const OCTET_STRING_t* find_unsecured_data( const Ieee1609Dot2Data_t* data ) {
+    while ( data && data->content ) {
+        const Ieee1609Dot2Content_t* content = data->content;
+
+        switch ( content->present ) {
+            case Ieee1609Dot2Content_PR_unsecuredData:
+                return &content->choice.unsecuredData;
+
+            case Ieee1609Dot2Content_PR_signedData:
+                if ( !content->choice.signedData || !content->choice.signedData->tbsData || !content->choice.signedData->tbsData->payload ) {
+                    return nullptr;
+                }
+                data = content->choice.signedData->tbsData->payload->data;
+                break;
+
+            default:
+                // encrypted data and certificate requests do not contain a MessageFrame.
+                return nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+/** 
+ * Decodes the ASN.1 bytes represented by the hex (or, when base64 is set, base64) string as the requested layers: the outermost requested type of
+ * pdu_layers into its C structure, and the OCTET STRING that holds each next layer from the structure around it, down to
+ * the MessageFrame whose XML is put into the xml_buffer; when xml_buffer is nullptr the containers are only checked.
+ *
+ * This method does not modify the input_doc; failures throw Asn1CodecError.
+ */
+// throws Asn1CodecError ONLY!
+bool CodecContext::decode_hex_data( std::string& data_as_hex, buffer_structure_t* xml_buffer, bool base64 ) {
+    static const char* fnname = "decode_hex_data()";
+
+    SPDLOG_TRACE(ilogger, "{}: starting...", fnname);
+
+    std::size_t layer = next_layer( 0 );
+    const char* name = layer < pdu_type_count ? pdu_layers[layer]->name : "";
+
+    {
+        StageClock clock{ timing(), CodecStage::HEX };
+
+        const char* kind = base64 ? "base64" : "hex";
+
+        // whitespace, e.g., line breaks, may separate the characters; the string is copied without it only when the
+        // first conversion stops at some.
+        std::size_t bad_offset = text_to_bytes( data_as_hex, base64, byte_buffer );
+        if ( bad_offset != hex_codec::npos && std::isspace( static_cast<unsigned char>( data_as_hex[bad_offset] ) ) ) {
+            data_as_hex.erase( remove_if ( data_as_hex.begin(), data_as_hex.end(), isspace), data_as_hex.end());
+            bad_offset = text_to_bytes( data_as_hex, base64, byte_buffer );
+        }
+
+        if (data_as_hex.empty()) {
+            erroross.str("");
+            erroross << "failed attempt to decode " << name << " " << kind << " string: string empty.";
+            throw Asn1CodecError{ erroross.str() };
+        }
+
+        SPDLOG_TRACE(ilogger, "{}: success extracting {} {} string: {}", fnname , name, kind, data_as_hex );
+
+        if ( bad_offset != hex_codec::npos ) {
+            erroross.str("");
+            erroross << "failed attempt to decode " << name << " " << kind << " string: cannot convert to bytes; invalid character at offset " << bad_offset << ".";
+            throw Asn1CodecError{ erroross.str() };
+        }
+    }
+
+    SPDLOG_TRACE(ilogger, "{}: successful conversion to raw byte buffer.", fnname );
+
+    return decode_payload( byte_buffer.data(), byte_buffer.size(), xml_buffer );
+}
+
+/**
+ * @brief Copy the x coordinate of a P-256 point, e.g., the R of a signature.
+ *
+ * @return false when the point does not have a 32 byte x coordinate.
+ */
+static bool point_x( const EccP256CurvePoint_t& point, uint8_t x[32] ) {
+    const OCTET_STRING_t* coordinate;
+
+    switch ( point.present ) {
+        case EccP256CurvePoint_PR_x_only:           coordinate = &point.choice.x_only; break;
+        case EccP256CurvePoint_PR_compressed_y_0:   coordinate = &point.choice.compressed_y_0; break;
+        case EccP256CurvePoint_PR_compressed_y_1:   coordinate = &point.choice.compressed_y_1; break;
+        case EccP256CurvePoint_PR_uncompressedP256: coordinate = &point.choice.uncompressedP256.x; break;
+        default:                                    return false;
+    }
+
+    if ( coordinate->size != 32 ) return false;
+    std::memcpy( x, coordinate->buf, 32 );
+    return true;
+}
+
+/**
+ * @brief Write the SEC 1 encoding of a P-256 public key, 33 bytes when it is compressed and 65 otherwise.
+ *
+ * @return false when the key is only an x coordinate, which cannot be a public key.
+ */
+static bool point_key( const EccP256CurvePoint_t& point, uint8_t key[65], std::size_t& size ) {
+    uint8_t prefix;
+
+    switch ( point.present ) {
+        case EccP256CurvePoint_PR_compressed_y_0:   prefix = 0x02; break;
+        case EccP256CurvePoint_PR_compressed_y_1:   prefix = 0x03; break;
+        case EccP256CurvePoint_PR_uncompressedP256: prefix = 0x04; break;
+        default:                                    return false;
+    }
+
+    key[0] = prefix;
+    if ( !point_x( point, key + 1 ) ) return false;
+    size = 33;
+
+    if ( prefix == 0x04 ) {
+        if ( point.choice.uncompressedP256.y.size != 32 ) return false;
+        std::memcpy( key + 33, point.choice.uncompressedP256.y.buf, 32 );
+        size = 65;
+    }
+    return true;
+}
+
+bool CodecContext::hash_coer( const asn_TYPE_descriptor_t& type, const void* structure, uint8_t hash[32] ) {
+    signed_buffer_.buffer_size = 0;
+
+    asn_enc_rval_t erval = asn_encode( 0, ATS_CANONICAL_OER, &type, structure, dynamic_buffer_append, static_cast<void *>(&signed_buffer_) );
+    if ( erval.encoded < 0 ) return false;
+
+    SignatureVerifier::sha256( signed_buffer_.buffer, signed_buffer_.buffer_size, hash );
+    return true;
+}
+
+/**
+ * @brief The end of a certificate's validity period in Time32 seconds; a year is 31556952 seconds.
+ */
+static uint32_t validity_end( const ValidityPeriod_t& period ) {
+    uint64_t seconds;
+
+    switch ( period.duration.present ) {
+        case Duration_PR_microseconds:  seconds = period.duration.choice.microseconds / 1000000; break;
+        case Duration_PR_milliseconds:  seconds = period.duration.choice.milliseconds / 1000; break;
+        case Duration_PR_seconds:       seconds = period.duration.choice.seconds; break;
+        case Duration_PR_minutes:       seconds = period.duration.choice.minutes * 60ULL; break;
+        case Duration_PR_hours:         seconds = period.duration.choice.hours * 3600ULL; break;
+        case Duration_PR_sixtyHours:    seconds = period.duration.choice.sixtyHours * 216000ULL; break;
+        case Duration_PR_years:         seconds = period.duration.choice.years * 31556952ULL; break;
+        default:                        seconds = 0; break;
+    }
+
+    return static_cast<uint32_t>( std::min<uint64_t>( static_cast<uint64_t>( period.start ) + seconds, UINT32_MAX ) );
+}
+
+UnvalidatedCertificateCache::Entry CodecContext::find_signer( const SignerIdentifier_t& signer, SignatureVerifier::Status& failure ) {
+    UnvalidatedCertificateCache& certificates = verifier_->certificates();
+
+    switch ( signer.present ) {
+        case SignerIdentifier_PR_digest:
+            // the certificate must have come whole in an earlier frame.
+            if ( signer.choice.digest.size != sizeof( UnvalidatedCertificateCache::Certificate::id ) ) {
+                failure = SignatureVerifier::Status::UNSUPPORTED;
+                return nullptr;
+            }
+            failure = SignatureVerifier::Status::UNKNOWN_SIGNER;
+            return certificates.find( signer.choice.digest.buf );
+
+        case SignerIdentifier_PR_certificate:
+            break;
+
+        default:
+            // a self signed frame has no key to verify it with.
+            failure = SignatureVerifier::Status::UNSUPPORTED;
+            return nullptr;
+    }
+
+    failure = SignatureVerifier::Status::UNSUPPORTED;
+
+    // the first certificate of the chain is the signer's.
+    if ( signer.choice.certificate.list.count < 1 ) return nullptr;
+
+    const Certificate_t* certificate = signer.choice.certificate.list.array[0];
+    const ToBeSignedCertificate_t& tbs = certificate->toBeSigned;
+    const VerificationKeyIndicator_t& indicator = tbs.verifyKeyIndicator;
+
+    // an implicit certificate's key is reconstructed with its issuer's, which the ACM does not have.
+    if ( indicator.present != VerificationKeyIndicator_PR_verificationKey
+            || indicator.choice.verificationKey.present != PublicVerificationKey_PR_ecdsaNistP256 ) {
+        return nullptr;
+    }
+
+    // a certificate seen before is known by its own hash, so another certificate with the same key and validity never
+    // takes its HashedId8 or revocation; its key is not parsed again.
+    UnvalidatedCertificateCache::Entry received = std::make_shared<UnvalidatedCertificateCache::Certificate>();
+    if ( !hash_coer( asn_DEF_Certificate, certificate, received->hash ) ) return nullptr;
+
+    UnvalidatedCertificateCache::Entry kept = certificates.find_hash( received->hash );
+    if ( kept ) return kept;
+
+    if ( !point_key( indicator.choice.verificationKey.choice.ecdsaNistP256, received->key, received->key_size ) ) return nullptr;
+
+    // a HashedId8 is the low 8 bytes of the hash.
+    std::memcpy( received->id, received->hash + 24, sizeof( received->id ) );
+    received->start = static_cast<uint32_t>( tbs.validityPeriod.start );
+    received->end = validity_end( tbs.validityPeriod );
+    return certificates.insert( received );
+}
+
+void CodecContext::verify_signature( const SignedData_t& signed_data ) {
+    using Status = SignatureVerifier::Status;
+
+    auto resolve = [this]( Status status ) {
+        signatures_.push_back( verifier_->resolve( status ) );
+    };
+
+    // the signer is found, and a new certificate kept, before the frame is sampled, so the frames signed with the
+    // digest of a certificate that came in a skipped frame are verified too.
+    Status failure;
+    SignatureVerifier::Request request;
+    request.signer = find_signer( signed_data.signer, failure );
+
+    if ( !request.signer ) return resolve( failure );
+    if ( request.signer->revoked.load( std::memory_order_relaxed ) ) return resolve( Status::REVOKED );
+    if ( !request.signer->current( UnvalidatedCertificateCache::now() ) ) return resolve( Status::EXPIRED );
+    if ( !verifier_->sample() ) return resolve( Status::SKIPPED );
+
+    // IEEE 1609.2 signs SHA-256( SHA-256( COER tbsData ) || SHA-256( COER signer certificate ) ); ECDSA with NIST P-256
+    // is the only signature the SCMS issues certificates for.
+    const Signature_t& signature = signed_data.signature;
+
+    if ( signed_data.hashId != HashAlgorithm_sha256 || signature.present != Signature_PR_ecdsaNistP256Signature
+            || !point_x( signature.choice.ecdsaNistP256Signature.rSig, request.r )
+            || signature.choice.ecdsaNistP256Signature.sSig.size != sizeof( request.s )
+            || !hash_coer( asn_DEF_ToBeSignedData, signed_data.tbsData, request.tbs_hash ) ) {
+        return resolve( Status::UNSUPPORTED );
+    }
+    std::memcpy( request.s, signature.choice.ecdsaNistP256Signature.sSig.buf, sizeof( request.s ) );
+
+    signatures_.push_back( verifier_->submit( request ) );
+}
+
+void CodecContext::visit_1609dot2( const void* structure ) {
+    const Ieee1609Dot2Data_t* ieee1609data = static_cast<const Ieee1609Dot2Data_t*>( structure );
+
+    // the signature is verified on the verifier's threads while the inner layers are decoded on this one.
+    if ( verifier_ && ieee1609data->content->present == Ieee1609Dot2Content_PR_signedData ) {
+        verify_signature( *ieee1609data->content->choice.signedData );
+    }
+}
+
+void CodecContext::set_lazy_decode( const LazyDecode& lazy ) {
+    lazy_decode_ = lazy;
+
+    // the output of a payload depends on the setting.
+    if ( decode_cache_ ) decode_cache_->clear();
+}
+
+bool CodecContext::decode_lazy( const Ieee1609Dot2Data_t& data, const OCTET_STRING_t& unsecured, buffer_structure_t* xml_buffer, bool append ) {
+    // the header of the outermost signed frame; unsecured content has none, so its PSID is unknown and it is lazy.
+    const HeaderInfo_t* header = nullptr;
+    const SignerIdentifier_t* signer = nullptr;
+
+    if ( data.content->present == Ieee1609Dot2Content_PR_signedData && data.content->choice.signedData->tbsData ) {
+        header = &data.content->choice.signedData->tbsData->headerInfo;
+        signer = &data.content->choice.signedData->signer;
+    }
+
+    uintmax_t psid = 0;
+    bool has_psid = header && asn_INTEGER2umax( &header->psid, &psid ) == 0;
+
+    if ( has_psid && !lazy_decode_.lazy( psid ) ) return false;
+
+    // a certificate is named by its HashedId8, the low 8 bytes of its hash, as a digest names it.
+    const char* signer_kind = nullptr;
+    uint8_t signer_id[32];
+    std::size_t signer_id_size = 0;
+
+    if ( signer ) {
+        switch ( signer->present ) {
+            case SignerIdentifier_PR_digest:
+                signer_kind = "digest";
+                std::memcpy( signer_id, signer->choice.digest.buf, std::min<std::size_t>( signer->choice.digest.size, sizeof( signer_id ) ) );
+                signer_id_size = std::min<std::size_t>( signer->choice.digest.size, sizeof( signer_id ) );
+                break;
+
+            case SignerIdentifier_PR_certificate:
+                signer_kind = "certificate";
+                if ( signer->choice.certificate.list.count > 0 && hash_coer( asn_DEF_Certificate, signer->choice.certificate.list.array[0], signer_id ) ) {
+                    std::memmove( signer_id, signer_id + 24, 8 );
+                    signer_id_size = 8;
+                }
+                break;
+
+            case SignerIdentifier_PR_self:
+                signer_kind = "self";
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    StageClock clock{ timing(), CodecStage::XER };
+
+    if ( json_output_ ) {
+        if ( !append ) {
+            json_buffer_.Clear();
+            json_writer_.Reset( json_buffer_ );
+        }
+
+        json_writer_.StartObject();
+        json_writer_.Key( "Ieee1609Dot2Header" );
+        json_writer_.StartObject();
+        json_writer_.Key( "protocolVersion" );
+        json_writer_.Int64( data.protocolVersion );
+        if ( has_psid ) {
+            json_writer_.Key( "psid" );
+            json_writer_.Uint64( psid );
+        }
+        if ( header && header->generationTime ) {
+            json_writer_.Key( "generationTime" );
+            json_writer_.Uint64( static_cast<uint64_t>( *header->generationTime ) );
+        }
+        if ( signer_kind ) {
+            json_writer_.Key( "signer" );
+            json_writer_.StartObject();
+            json_writer_.Key( signer_kind );
+            if ( signer_id_size ) {
+                hex_codec::encode( signer_id, signer_id_size, lazy_hex_ );
+                json_writer_.String( lazy_hex_.data(), static_cast<rapidjson::SizeType>( lazy_hex_.size() ) );
+            } else {
+                json_writer_.Null();
+            }
+            json_writer_.EndObject();
+        }
+        hex_codec::encode( unsecured.buf, unsecured.size, lazy_hex_ );
+        json_writer_.Key( "unsecuredData" );
+        json_writer_.String( lazy_hex_.data(), static_cast<rapidjson::SizeType>( lazy_hex_.size() ) );
+        json_writer_.EndObject();
+        json_writer_.EndObject();
+        return true;
+    }
+
+    if ( !append ) prepare_output_buffer( xml_buffer, &asn_DEF_Ieee1609Dot2Data, ATS_CANONICAL_XER );
+    std::size_t start = xml_buffer->buffer_size;
+
+    // the same layout as the XER of the fields.
+    std::string& xml = lazy_xml_;
+    xml.assign( "<Ieee1609Dot2Header><protocolVersion>" );
+    xml += std::to_string( data.protocolVersion );
+    xml += "</protocolVersion>";
+    if ( has_psid ) {
+        xml += "<psid>";
+        xml += std::to_string( psid );
+        xml += "</psid>";
+    }
+    if ( header && header->generationTime ) {
+        xml += "<generationTime>";
+        xml += std::to_string( static_cast<uint64_t>( *header->generationTime ) );
+        xml += "</generationTime>";
+    }
+    if ( signer_kind ) {
+        xml += "<signer><";
+        xml += signer_kind;
+        if ( signer_id_size ) {
+            hex_codec::encode( signer_id, signer_id_size, lazy_hex_ );
+            xml += ">";
+            xml += lazy_hex_;
+            xml += "</";
+            xml += signer_kind;
+            xml += ">";
+        } else {
+            xml += "/>";
+        }
+        xml += "</signer>";
+    }
+    hex_codec::encode( unsecured.buf, unsecured.size, lazy_hex_ );
+    xml += "<unsecuredData>";
+    xml += lazy_hex_;
+    xml += "</unsecuredData></Ieee1609Dot2Header>";
+
+    if ( dynamic_buffer_append( xml.data(), xml.size(), static_cast<void *>(xml_buffer) ) != 0 ) {
+        throw Asn1CodecError{ "failed to write the IEEE 1609.2 header." };
+    }
+
+    if ( !append ) record_output_size( &asn_DEF_Ieee1609Dot2Data, ATS_CANONICAL_XER, xml_buffer->buffer_size - start );
+    return true;
+}
+
+bool CodecContext::decoding() const {
+    return next_layer( 0 ) < pdu_type_count;
+}
+
+std::size_t CodecContext::next_layer( std::size_t layer ) const {
+    while ( layer < pdu_type_count && !(this->*pdu_layers[layer]->enabled) ) {
+        ++layer;
+    }
+    return layer;
+}
+
+// throws Asn1CodecError ONLY!
+bool CodecContext::decode_layers( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append, std::size_t layer ) {
+    static const char* fnname = "decode_layers()";
+
+    layer = next_layer( layer );
+    if ( layer == pdu_type_count ) {
+        throw Asn1CodecError{ "failed attempt to decode binary input: no decoder was requested." };
+    }
+
+    const PduType& t = *pdu_layers[layer];
+
+    // the innermost layer writes the output.
+    if ( !t.inner ) {
+        return decode_messageframe_bytes( bytes, length, xml_buffer, consumed, append );
+    }
+
+    // enum asn_dec_rval_code_e {
+    // 	RC_OK,		                                  // successful decoding.
+    // 	RC_WMORE,	                                  // more data expected.
+    // 	RC_FAIL		                                  // failure to decode data.
+    // };
+    //
+    // typedef struct asn_dec_rval_s {
+    // 	enum asn_dec_rval_code_e code;                // one of the above codes.
+    // 	size_t consumed;		                      // number of bytes consumed.
+    // } asn_dec_rval_t;
+    asn_dec_rval_t decode_rval;
+
+    errlen = max_errbuf_size;
+
+    void *structure = 0;                         // must initialize to 0 according to asn.1 instructions.
+
+    // Decode the container bytes (an ASD or a 1609.2 Frame) into the appropriate structure.
+    {
+        StageClock clock{ timing(), CodecStage::BINARY };
+        decode_rval = asn_decode( 
+                &codec_ctx_, 
+                this->*t.syntax, 
+                t.type, 
+                &structure, 
+                bytes, 
+                length 
+                );
+    }
+
+    if ( consumed && !pdu_consumed( decode_rval, length, consumed ) ) {
+        ASN_STRUCT_FREE(*t.type, structure);
+        return false;
+    }
+
+    if ( decode_rval.code != RC_OK ) {
+        ASN_STRUCT_FREE(*t.type, structure);
+        check_budget();                                                 // throws.
+        erroross.str("");
+        erroross << "failed ASN.1 binary decoding of element " << t.type->name << ": ";
+        if ( decode_rval.code == RC_FAIL ) {
+            erroross << "bad data.";
+        } else {
+            erroross << "more data expected.";
+        }
+        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    SPDLOG_TRACE(ilogger, "{}: ASN.1 binary decode of {} success.", fnname, t.name );
+
+    // check the data in the returned structure against the ASN.1 specification constraints.
+    if (check_constraints( t.type, structure )) {
+        erroross.str("");
+        erroross << "failed ASN.1 constraints check of element " << t.type->name << ": ";
+        erroross.write( errbuf, errlen );
+        ASN_STRUCT_FREE(*t.type, structure);
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    const OCTET_STRING_t* inner = t.inner( structure );
+
+    if ( !inner ) {
+        ASN_STRUCT_FREE(*t.type, structure);
+        throw Asn1CodecError{ t.missing };
+    }
+
+    if ( t.visit ) {
+        (this->*t.visit)( structure );
+    }
+
+    std::size_t next = next_layer( layer + 1 );
+
+    // a lazy frame's MessageFrame is written as the bytes received.
+    if ( lazy_decode_.enabled && t.op == Asn1OpsType::IEEE1609DOT2 && next < pdu_type_count && !pdu_layers[next]->inner && xml_buffer ) {
+        bool lazy;
+        try {
+            lazy = decode_lazy( *static_cast<const Ieee1609Dot2Data_t*>( structure ), *inner, xml_buffer, append );
+        } catch ( ... ) {
+            ASN_STRUCT_FREE(*t.type, structure);
+            throw;
+        }
+
+        if ( lazy ) {
+            ASN_STRUCT_FREE(*t.type, structure);
+            SPDLOG_TRACE(ilogger, "{}: finished the lazy {}.", fnname, t.name );
+            return true;
+        }
+    }
+
+    if ( next < pdu_type_count ) {
+        // the decoded OCTET STRING is the encoding of the next layer; it must be decoded before this structure is freed.
+        try {
+            check_budget();                                             // throws.
+            decode_layers( inner->buf, inner->size, xml_buffer, nullptr, append, next );
+        } catch ( ... ) {
+            ASN_STRUCT_FREE(*t.type, structure);
+            throw;
+        }
+    }
+
+    ASN_STRUCT_FREE(*t.type, structure);
+
+    SPDLOG_TRACE(ilogger, "{}: finished {}.", fnname, t.name );
+    return true;
+}
+
+uint64_t CodecContext::decode_signature() const {
+    return static_cast<uint64_t>( opsflag )
+        | static_cast<uint64_t>( decode_1609dot2_type ) << 8
+        | static_cast<uint64_t>( decode_messageframe_type ) << 16
+        | static_cast<uint64_t>( concatenated_pdus_ ) << 24
+        | static_cast<uint64_t>( json_output_ ) << 25
+        | static_cast<uint64_t>( key_fields_ ) << 26
+        | static_cast<uint64_t>( decode_asdframe_type ) << 32;
+}
+
+bool CodecContext::decode_payload( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer ) {
+    // without a MessageFrame there is no output to keep; a filter or the verifier decides each message again. The SPaT
+    // delta only decides the SPaTs again: they are never kept, so they are never found either.
+    bool cached = decode_cache_ && xml_buffer && filters_.empty() && !verifier_;
+    uint64_t signature = cached ? decode_signature() : 0;
+    spat_reduced_ = false;
+
+    if ( cached ) {
+        const std::string* output = decode_cache_->find( signature, bytes, length, &message_id_, &message_key_ );
+
+        if ( output ) {
+            if ( json_output_ ) {
+                json_buffer_.Clear();
+                std::memcpy( json_buffer_.Push( output->size() ), output->data(), output->size() );
+            } else {
+                xml_buffer->buffer_size = 0;
+                if ( dynamic_buffer_append( output->data(), output->size(), static_cast<void *>(xml_buffer) ) != 0 ) {
+                    throw Asn1CodecError{ "failed to copy the cached MessageFrame XER." };
+                }
+            }
+            return true;
+        }
+    }
+
+    if ( concatenated_pdus_ ) {
+        decode_pdus( bytes, length, xml_buffer );                       // throws.
+    } else {
+        decode_layers( bytes, length, xml_buffer );                     // throws.
+    }
+
+    if ( cached && !spat_reduced_ ) {
+        if ( json_output_ ) {
+            decode_cache_->insert( signature, bytes, length, json_buffer_.GetString(), json_buffer_.GetSize(), message_id_, message_key_ );
+        } else {
+            decode_cache_->insert( signature, bytes, length, xml_buffer->buffer, xml_buffer->buffer_size, message_id_, message_key_ );
+        }
+    }
+
+    return true;
+}
+
+bool CodecContext::decode_pdus( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer ) {
+    const uint8_t* data = static_cast<const uint8_t*>( bytes );
+    std::size_t offset = 0;
+    std::size_t count = 0;
+
+    // each PDU appends its output, so the buffers are prepared once for all of them.
+    if ( xml_buffer ) {
+        if ( json_output_ ) {
+            json_buffer_.Clear();
+            json_writer_.Reset( json_buffer_ );
+            json_writer_.StartArray();
+        } else {
+            prepare_output_buffer( xml_buffer, &asn_DEF_MessageFrame, ATS_CANONICAL_XER );
+        }
+    }
+
+    // the message is dropped only when all of its BSMs are.
+    bool kept = false;
+    bool diverted = false;
+
+    while ( offset < length ) {
+        std::size_t consumed;
+        bool complete;
+
+        verdict_ = BsmFilter::Verdict::PASS;
+
+        complete = decode_layers( data + offset, length - offset, xml_buffer, &consumed, true );   // throws.
+
+        if ( !complete ) {
+            erroross.str("");
+            erroross << "failed ASN.1 binary decoding: more data expected after " << count << " PDUs and " << offset << " bytes.";
+            throw Asn1CodecError{ erroross.str() };
+        }
+
+        kept = kept || verdict_ != BsmFilter::Verdict::DROP;
+        diverted = diverted || verdict_ == BsmFilter::Verdict::DIVERT;
+
+        offset += consumed;
+        ++count;
+    }
+
+    verdict_ = !kept ? BsmFilter::Verdict::DROP : diverted ? BsmFilter::Verdict::DIVERT : BsmFilter::Verdict::PASS;
+
+    if ( xml_buffer ) {
+        if ( json_output_ ) {
+            json_writer_.EndArray();
+        } else {
+            record_output_size( &asn_DEF_MessageFrame, ATS_CANONICAL_XER, xml_buffer->buffer_size );
+        }
+    }
+
+    return true;
+}
+
+bool CodecContext::decode_bsm_fast( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append ) {
+    if ( !bsm_fast_path_ || decode_messageframe_type != ATS_UNALIGNED_BASIC_PER || json_output_ || projection_ || !xml_buffer ) {
+        return false;
+    }
+
+    std::size_t used;
+    {
+        StageClock clock{ timing(), CodecStage::BINARY };
+        if ( !bsm_fast_path::decode( bytes, length, fast_bsm_, &used ) ) return false;
+    }
+
+    // every constraint was checked while decoding; the policy is only counted.
+    validation_due( &asn_DEF_MessageFrame );
+
+    if ( !filters_.empty() && filter_bsm( used ) == BsmFilter::Verdict::DROP ) {
+        message_id_ = 20;
+        if ( consumed ) *consumed = used;
+        return true;
+    }
+
+    if ( archive_ ) archive_->append( fast_bsm_ );
+    key_bsm( fast_bsm_.id );
+
+    if ( !append ) prepare_output_buffer( xml_buffer, &asn_DEF_MessageFrame, ATS_CANONICAL_XER );
+
+    {
+        StageClock clock{ timing(), CodecStage::XER };
+        fast_xer_.clear();
+        bsm_fast_path::write_xer( fast_bsm_, fast_xer_, compact_xer_ );
+        if ( dynamic_buffer_append( fast_xer_.data(), fast_xer_.size(), static_cast<void *>(xml_buffer) ) != 0 ) {
+            throw Asn1CodecError{ "failed to copy the fast path MessageFrame XER." };
+        }
+    }
+
+    if ( !append ) record_output_size( &asn_DEF_MessageFrame, ATS_CANONICAL_XER, xml_buffer->buffer_size );
+
+    message_id_ = 20;
+    if ( consumed ) *consumed = used;
+    return true;
+}
+
+bool CodecContext::decode_map_cached( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append, map_frame::Header& header, bool& is_map ) {
+    // the cached XER is canonical and complete.
+    is_map = map_cache_ && xml_buffer && decode_messageframe_type == ATS_UNALIGNED_BASIC_PER && !json_output_ && !projection_
+        && map_frame::parse( bytes, length, header );
+    if ( !is_map ) return false;
+
+    const std::string* cached;
+    {
+        StageClock clock{ timing(), CodecStage::BINARY };
+        map_frame::revision_key( bytes, header, map_key_ );
+        cached = map_cache_->find( 0, map_key_.data(), map_key_.size(), nullptr, &frame_key_ );
+        if ( !cached ) return false;
+
+        map_xer_.clear();
+        if ( !map_frame::restamp( *cached, header, map_xer_ ) ) return false;
+    }
+
+    if ( !append ) prepare_output_buffer( xml_buffer, &asn_DEF_MessageFrame, ATS_CANONICAL_XER );
+
+    if ( dynamic_buffer_append( map_xer_.data(), map_xer_.size(), static_cast<void *>(xml_buffer) ) != 0 ) {
+        throw Asn1CodecError{ "failed to copy the cached MAP XER." };
+    }
+
+    if ( !append ) record_output_size( &asn_DEF_MessageFrame, ATS_CANONICAL_XER, xml_buffer->buffer_size );
+
+    message_id_ = 18;
+    if ( message_key_.empty() ) message_key_ = frame_key_;
+    if ( consumed ) *consumed = header.bytes;
+    return true;
+}
+
+// throws Asn1CodecError ONLY!
+bool CodecContext::decode_messageframe_bytes( const void* bytes, std::size_t length, buffer_structure_t* xml_buffer, std::size_t* consumed, bool append ) {
+    static const char* fnname = "decode_messageframe_bytes()";
+
+    asn_dec_rval_t decode_rval;
+    asn_enc_rval_t encode_rval;
+
+    errlen = max_errbuf_size;
+
+    MessageFrame_t *messageframe = 0;           // must be initialized to 0.
+
+    SPDLOG_TRACE(ilogger, "{}: starting...", fnname);
+
+    if ( decode_bsm_fast( bytes, length, xml_buffer, consumed, append ) ) {
+        SPDLOG_TRACE(ilogger, "{}: finished on the BSM fast path.", fnname );
+        return true;
+    }
+
+    map_frame::Header map;
+    bool is_map = false;
+    if ( decode_map_cached( bytes, length, xml_buffer, consumed, append, map, is_map ) ) {
+        SPDLOG_TRACE(ilogger, "{}: revision {} of the MAP was cached.", fnname, map.revision );
+        return true;
+    }
+
+    {
+        StageClock clock{ timing(), CodecStage::BINARY };
+        decode_rval = asn_decode( 
+                &codec_ctx_, 
+                decode_messageframe_type, 
+                &asn_DEF_MessageFrame,
+                (void **)&messageframe,
+                bytes, 
+                length 
+                );
+    }
+
+    if ( consumed && !pdu_consumed( decode_rval, length, consumed ) ) {
+        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+        return false;
+    }
+
+    if ( decode_rval.code != RC_OK ) {
+        check_budget();                                                 // throws.
+        erroross.str("");
+        erroross << "failed ASN.1 binary decoding of element " << asn_DEF_MessageFrame.name << ": ";
+        if ( decode_rval.code == RC_FAIL ) {
+            erroross << "bad data.";
+        } else {
+            erroross << "more data expected.";
+        }
+        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    SPDLOG_TRACE(ilogger, "{}: ASN.1 binary decode successful.", fnname );
+
+    if (check_constraints( &asn_DEF_MessageFrame, messageframe )) {
+        erroross.str("");
+        erroross << "failed ASN.1 constraints check of element " << asn_DEF_MessageFrame.name << ": ";
+        erroross.write( errbuf, errlen );
+        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    message_id_ = static_cast<int32_t>( messageframe->messageId );
+
+    // only the core data is filtered and archived; the fast path structure holds it.
+    bool core = ( archive_ || !filters_.empty() ) && BsmArchive::core_data( messageframe, fast_bsm_ );
+
+    if ( core && !filters_.empty() && filter_bsm( decode_rval.consumed ) == BsmFilter::Verdict::DROP ) {
+        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+        SPDLOG_TRACE(ilogger, "{}: the BSM was filtered.", fnname );
+        return true;
+    }
+
+    if ( core && archive_ ) archive_->append( fast_bsm_ );
+
+    spat_reduced_ = spat_reduced_ || ( spat_delta_ && messageframe->value.present == MessageFrame__value_PR_SPAT );
+    if ( spat_delta_ && messageframe->value.present == MessageFrame__value_PR_SPAT && !spat_delta_->reduce( messageframe->value.choice.SPAT ) ) {
+        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+        verdict_ = BsmFilter::Verdict::DROP;
+        ++dropped_frames_;
+        dropped_bytes_ += decode_rval.consumed;
+        SPDLOG_TRACE(ilogger, "{}: the SPaT did not change.", fnname );
+        return true;
+    }
+
+    key_frame( *messageframe );
+
+    if ( json_output_ ) {
+        // the JSON is written from the C structure; no XER is produced.
+        {
+            StageClock clock{ timing(), CodecStage::XER };
+            if ( !append ) {
+                json_buffer_.Clear();
+                json_writer_.Reset( json_buffer_ );
+            }
+            if ( projection_ ) {
+                projection_->write_json( &asn_DEF_MessageFrame, messageframe, json_writer_ );
+            } else {
+                asn1_json::write( &asn_DEF_MessageFrame, messageframe, json_writer_ );
+            }
+        }
+        ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+
+        SPDLOG_TRACE(ilogger, "{}: finished.", fnname );
+        return true;
+    }
+
+    // Encode the Ieee1609Dot2Data ASN.1 C struct into XML, so we can extract out the BSM.
+    if ( !append ) prepare_output_buffer( xml_buffer, &asn_DEF_MessageFrame, ATS_CANONICAL_XER );
+    std::size_t xer_start = xml_buffer->buffer_size;
+
+    {
+        StageClock clock{ timing(), CodecStage::XER };
+        if ( projection_ ) {
+            encode_rval.encoded = projection_->write_xer( &asn_DEF_MessageFrame, messageframe, dynamic_buffer_append, static_cast<void *>(xml_buffer) );
+            encode_rval.failed_type = &asn_DEF_MessageFrame;
+        } else if ( compact_xer_ ) {
+            encode_rval.encoded = asn1_xer::write_compact( &asn_DEF_MessageFrame, messageframe, dynamic_buffer_append, static_cast<void *>(xml_buffer) );
+            encode_rval.failed_type = &asn_DEF_MessageFrame;
+        } else {
+            encode_rval = xer_encode( 
+                    &asn_DEF_MessageFrame, 
+                    messageframe, 
+                    XER_F_CANONICAL, 
+                    dynamic_buffer_append, 
+                    static_cast<void *>(xml_buffer) 
+                    );
+        }
+    }
+
+    ASN_STRUCT_FREE(asn_DEF_MessageFrame, messageframe);
+
+    if ( encode_rval.encoded == -1 ) {
+        erroross.str("");
+        erroross << "failed ASN.1 XML encoding of MessageFrame element " << encode_rval.failed_type->name;
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    if ( is_map ) {
+        map_cache_->insert( 0, map_key_.data(), map_key_.size(), xml_buffer->buffer + xer_start, xml_buffer->buffer_size - xer_start, message_id_, frame_key_ );
+    }
+
+    if ( !append ) record_output_size( &asn_DEF_MessageFrame, ATS_CANONICAL_XER, xml_buffer->buffer_size );
+
+    SPDLOG_TRACE(ilogger, "{}: finished.", fnname );
+    return true;
+}
+        
+void CodecContext::encode_frame_data(const EncodeStep& step, const char* data_as_xml, std::size_t length, const std::string* inner, std::string& bytes, void* filled, bool owned) {
+    static const char* fnname = "encode_frame_data()";
+
+    asn_dec_rval_t decode_rval;
+    asn_enc_rval_t encode_rval;
+
+    struct asn_TYPE_descriptor_s* data_struct = const_cast<struct asn_TYPE_descriptor_s*>( step.type );
+    enum asn_transfer_syntax syntax = transfer_syntax( step.op );
+    void *frame_data = filled;
+
+    errlen = max_errbuf_size;
+
+    // the encoding of an element depends only on its XML, the layer it encloses, its type, and the transfer syntax.
+    uint64_t signature = static_cast<uint64_t>( step.op ) | static_cast<uint64_t>( syntax ) << 8;
+    const char* key = data_as_xml;
+    std::size_t key_length = length;
+
+    if ( encode_cache_ && !filled ) {
+        if ( inner ) {
+            encode_key_.assign( data_as_xml, length );
+            encode_key_.push_back( '\0' );
+            encode_key_.append( *inner );
+            key = encode_key_.data();
+            key_length = encode_key_.size();
+        }
+
+        int32_t tag = -1;
+        const std::string* cached = encode_cache_->find( signature, key, key_length, &tag );
+        if ( cached ) {
+            if ( tag >= 0 ) message_id_ = tag;
+            bytes.assign( *cached );
+            return;
+        }
+    }
+
+    if ( !filled ) {
+        StageClock clock{ timing(), CodecStage::XER };
+        decode_rval = xer_decode( 
+                &codec_ctx_
+    			, data_struct
+                , (void **)&frame_data
+                , data_as_xml
+                , length
+                );
+    }
+
+    if ( !filled && decode_rval.code != RC_OK ) {
+        check_budget();                                                 // throws.
+        erroross.str("");
+        erroross << "failed ASN.1 decoding of XML element " << data_struct->name << ": ";
+        if ( decode_rval.code == RC_FAIL ) {
+            erroross << "bad data.";
+        } else {
+            erroross << "more data expected.";
+        }
+        erroross << " Successfully decoded " << decode_rval.consumed << " bytes.";
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    if ( inner ) {
+        // the OCTET STRING the enclosed layer was removed from is empty in the XER; its bytes go in directly.
+        const PduType* t = pdu_ops[step.op];
+        OCTET_STRING_t* octets = const_cast<OCTET_STRING_t*>( t->inner( frame_data ) );
+
+        if ( !octets || OCTET_STRING_fromBuf( octets, inner->data(), static_cast<int>( inner->size() ) ) != 0 ) {
+            if ( owned ) ASN_STRUCT_FREE(*data_struct, frame_data);
+            erroross.str("");
+            erroross << "failed to place the enclosed encoding in element " << data_struct->name << ": " << t->missing;
+            throw Asn1CodecError{ erroross.str() };
+        }
+    }
+
+    if (check_constraints( data_struct, frame_data )) {
+        erroross.str("");
+        erroross << "failed ASN.1 constraints check of element " << data_struct->name << ": ";
+        erroross.write( errbuf, errlen );
+        if ( owned ) ASN_STRUCT_FREE(*data_struct, frame_data);
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    prepare_output_buffer( &encode_buffer_, data_struct, syntax );
+
+    {
+        StageClock clock{ timing(), CodecStage::BINARY };
+        encode_rval = asn_encode(
+            0,
+            syntax,
+            data_struct,
+            frame_data, 
+            dynamic_buffer_append, 
+            static_cast<void *>(&encode_buffer_) 
+            );
+    }
+
+    // the MessageFrame of a wrapped message is encoded first, so its messageId is known once the message is done.
+    int32_t tag = -1;
+    if ( data_struct == &asn_DEF_MessageFrame ) {
+        tag = static_cast<int32_t>( static_cast<MessageFrame_t*>( frame_data )->messageId );
+        message_id_ = tag;
+    }
+
+    if ( owned ) ASN_STRUCT_FREE(*data_struct, frame_data);
+
+    if ( encode_rval.encoded == -1 ) {
+        erroross.str("");
+        erroross << "failed ASN.1 encoding of SDWTIM element " << encode_rval.failed_type->name;
+        throw Asn1CodecError{ erroross.str() };
+    }
+
+    record_output_size( data_struct, syntax, encode_buffer_.buffer_size );
+
+    bytes.assign( encode_buffer_.buffer, encode_buffer_.buffer_size );
+
+    if ( encode_cache_ && !filled ) {
+        encode_cache_->insert( signature, key, key_length, bytes.data(), bytes.size(), tag );
+    }
+}
+
+bool CodecContext::set_codec_requirements( pugi::xml_document& doc ) {
+
+    static const char* fnname = "set_codec_requirements()";
+
+    enum asn_transfer_syntax atstype = ATS_INVALID;
+
+    // Determine which decodings are needed.
+    // TODO: Think aobut using a xpath_nodeset structure and iterating.
+    pugi::xpath_node encodings_xpath_node = ode_encodings_query.evaluate_node( input_doc );
+    if (!encodings_xpath_node) {
+        throw UnparseableInputError{"Failed to find path: OdeAsn1Data/metadata/encodings in the input file."};
+    }
+
+    // the text of the block in the input message is the cache key; without it the block is always resolved.
+    const char* block = nullptr;
+    std::size_t block_length = 0;
+    std::size_t hash = 0;
+    bool cacheable = input_slice( encodings_xpath_node.node(), block, block_length );
+
+    if ( cacheable && apply_cached_requirements( block, block_length, hash ) ) {
+        return true;
+    }
+
+    reset_codec_requirements();
+
+    for ( pugi::xml_node n = encodings_xpath_node.node().first_child(); n; n = n.next_sibling()) {
+
+        pugi::xml_text ats_node = n.child("encodingRule").text();
+        if ( ats_node ) {
+            // the XML file contains the rule specification and we should use it.
+            atstype = get_ats_transfer_syntax( ats_node.get() );
+        }
+
+        const char* element_type = n.child("elementType").text().get();
+        add_codec_requirement( element_type, std::strlen( element_type ), atstype );
+    }
+
+    if (!opsflag) {
+        throw UnparseableInputError{"Input file did not specify any encoding/decoding operations."};
+    }
+
+    if ( cacheable ) {
+        cache_requirements( block, block_length, hash );
+    }
+
+    return true;
+}
+
+bool CodecContext::apply_cached_requirements( const char* block, std::size_t length, std::size_t& hash ) {
+    // FNV-1a; the entries are also compared byte for byte, so collisions only cost a comparison.
+    uint64_t h = 14695981039346656037ULL;
+    for ( std::size_t i = 0; i < length; ++i ) {
+        h = ( h ^ static_cast<unsigned char>( block[i] ) ) * 1099511628211ULL;
+    }
+    hash = static_cast<std::size_t>( h );
+
+    for ( const CodecRequirements& r : requirements_cache_ ) {
+        if ( r.hash == hash && r.encodings.size() == length && std::memcmp( r.encodings.data(), block, length ) == 0 ) {
+            opsflag = r.opsflag;
+            decode_1609dot2 = r.decode_1609dot2;
+            decode_messageframe = r.decode_messageframe;
+            decode_asdframe = r.decode_asdframe;
+            decode_1609dot2_type = r.decode_1609dot2_type;
+            decode_messageframe_type = r.decode_messageframe_type;
+            decode_asdframe_type = r.decode_asdframe_type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CodecContext::cache_requirements( const char* block, std::size_t length, std::size_t hash ) {
+    CodecRequirements r{ std::string{ block, length }, hash, opsflag, decode_1609dot2, decode_messageframe, decode_asdframe,
+        decode_1609dot2_type, decode_messageframe_type, decode_asdframe_type };
+
+    if ( requirements_cache_.size() < max_cached_requirements ) {
+        requirements_cache_.push_back( std::move( r ) );
+    } else {
+        requirements_cache_[ requirements_next_ ] = std::move( r );
+        requirements_next_ = ( requirements_next_ + 1 ) % max_cached_requirements;
+    }
+}
+
+bool CodecContext::set_codec_requirements( const char* encodings, std::size_t length ) {
+    std::size_t hash = 0;
+
+    if ( apply_cached_requirements( encodings, length, hash ) ) {
+        return true;
+    }
+
+    reset_codec_requirements();
+
+    // elementType:encodingRule pairs separated by commas, e.g., Ieee1609Dot2Data:COER,MessageFrame:UPER
+    const char* end = encodings + length;
+    for ( const char* p = encodings; p < end; ) {
+        const char* next = static_cast<const char*>( std::memchr( p, ',', end - p ) );
+        if ( !next ) next = end;
+
+        const char* colon = static_cast<const char*>( std::memchr( p, ':', next - p ) );
+        if ( !colon ) {
+            throw UnparseableInputError{"Invalid encodings: each one must be elementType:encodingRule."};
+        }
+
+        enum asn_transfer_syntax atstype = ATS_INVALID;
+        char rule[8];
+        std::size_t rule_length = next - colon - 1;
+
+        // the rule names are short; anything longer is not a rule.
+        if ( rule_length < sizeof( rule ) ) {
+            std::memcpy( rule, colon + 1, rule_length );
+            rule[ rule_length ] = '\0';
+            atstype = get_ats_transfer_syntax( rule );
+        }
+
+        add_codec_requirement( p, colon - p, atstype );
+        p = next + 1;
+    }
+
+    if (!opsflag) {
+        throw UnparseableInputError{"Input did not specify any encoding/decoding operations."};
+    }
+
+    cache_requirements( encodings, length, hash );
+    return true;
+}
+
+namespace {
+
+    constexpr std::size_t name_length( const char* name ) {
+        return *name ? 1 + name_length( name + 1 ) : 0;
+    }
+
+    const OCTET_STRING_t* unsecured_data( const void* structure ) {
+        return find_unsecured_data( static_cast<const Ieee1609Dot2Data_t*>( structure ) );
+    }
+
+    const OCTET_STRING_t* advisory_message( const void* structure ) {
+        return &static_cast<const AdvisorySituationData_t*>( structure )->asdmDetails.advisoryMessage;
+    }
+}
+
+constexpr std::size_t CodecContext::pdu_type_count;
+constexpr std::size_t CodecContext::pdu_slot_count;
+
+const CodecContext::PduType CodecContext::pdu_types[pdu_type_count] = {
+    { "Ieee1609Dot2Data", name_length( "Ieee1609Dot2Data" ), Asn1OpsType::IEEE1609DOT2, &asn_DEF_Ieee1609Dot2Data, ATS_CANONICAL_OER,
+        &CodecContext::decode_1609dot2, &CodecContext::decode_1609dot2_type,
+        unsecured_data, "IEEE 1609.2 unsecuredData element could not be found.", &CodecContext::visit_1609dot2 },
+    { "MessageFrame", name_length( "MessageFrame" ), Asn1OpsType::J2735MESSAGEFRAME, &asn_DEF_MessageFrame, ATS_UNALIGNED_BASIC_PER,
+        &CodecContext::decode_messageframe, &CodecContext::decode_messageframe_type,
+        nullptr, nullptr, nullptr },
+    { "AdvisorySituationData", name_length( "AdvisorySituationData" ), Asn1OpsType::ASDFRAME, &asn_DEF_AdvisorySituationData, ATS_UNALIGNED_BASIC_PER,
+        &CodecContext::decode_asdframe, &CodecContext::decode_asdframe_type,
+        advisory_message, "AdvisorySituationData advisoryMessage element could not be found.", nullptr }
+};
+
+const CodecContext::PduType* const CodecContext::pdu_slots[pdu_slot_count] = {
+    &pdu_types[0], nullptr, nullptr, nullptr, &pdu_types[1], &pdu_types[2], nullptr, nullptr
+};
+
+const CodecContext::PduType* const CodecContext::pdu_ops[static_cast<uint32_t>(Asn1OpsType::ASDFRAME) + 1] = {
+    nullptr, &pdu_types[0], &pdu_types[1], nullptr, &pdu_types[2]
+};
+
+const CodecContext::PduType* const CodecContext::pdu_layers[pdu_type_count] = {
+    &pdu_types[2], &pdu_types[0], &pdu_types[1]
+};
+
+const CodecContext::PduType* CodecContext::find_pdu_type( const char* name, std::size_t length ) {
+    // the slots are checked when the module is compiled; a new type whose slot is taken needs a larger pdu_slot_count.
+    static_assert( name_length( "Ieee1609Dot2Data" ) % pdu_slot_count == 0, "Ieee1609Dot2Data is not in slot 0." );
+    static_assert( name_length( "MessageFrame" ) % pdu_slot_count == 4, "MessageFrame is not in slot 4." );
+    static_assert( name_length( "AdvisorySituationData" ) % pdu_slot_count == 5, "AdvisorySituationData is not in slot 5." );
+
+    const PduType* t = pdu_slots[ length % pdu_slot_count ];
+    return ( t && t->length == length && std::memcmp( t->name, name, length ) == 0 ) ? t : nullptr;
+}
+
+void CodecContext::reset_codec_requirements() {
+	opsflag = 0;
+
+    // re-establish defaults.
+    for ( const PduType& t : pdu_types ) {
+        this->*t.enabled = false;
+        this->*t.syntax = t.default_syntax;
+    }
+}
+
+void CodecContext::add_codec_requirement( const char* element_type, std::size_t length, enum asn_transfer_syntax atstype ) {
+
+    if ( atstype == ATS_INVALID ) {
+        throw UnparseableInputError{"Invalid encoding rule in input file."};
+    }
+
+    // element types this module does not know are ignored.
+    const PduType* t = find_pdu_type( element_type, length );
+    if ( t ) {
+        opsflag |= static_cast<uint32_t>( t->op );
+        this->*t->enabled = true;
+        this->*t->syntax = atstype;
+    }
+}
+
+bool CodecContext::decode_envelope( const char* buffer, std::size_t length, std::ostream& output_message_stream ) {
+    static const char* fnname = "decode_envelope()";
+
+    {
+        StageClock clock{ timing(), CodecStage::ENVELOPE };
+        if ( !envelope_scanner_.scan( buffer, length ) ) {
+            return false;
+        }
+    }
+
+    try {
+        {
+            StageClock clock{ timing(), CodecStage::REQUIREMENTS };
+
+            OdeEnvelope::Range block = envelope_scanner_.encodings_block();
+            std::size_t hash = 0;
+
+            if ( !apply_cached_requirements( block.begin, block.size, hash ) ) {
+                enum asn_transfer_syntax atstype = ATS_INVALID;
+                char rule[8];
+
+                reset_codec_requirements();
+
+                for ( const OdeEnvelope::Encoding& encoding : envelope_scanner_.encodings() ) {
+                    if ( encoding.encoding_rule.begin ) {
+                        // the rule names are short; anything longer is not a rule.
+                        if ( encoding.encoding_rule.size >= sizeof( rule ) ) return false;
+                        std::memcpy( rule, encoding.encoding_rule.begin, encoding.encoding_rule.size );
+                        rule[ encoding.encoding_rule.size ] = '\0';
+                        atstype = get_ats_transfer_syntax( rule );
+                    }
+
+                    add_codec_requirement( encoding.element_type.begin ? encoding.element_type.begin : "", encoding.element_type.size, atstype );
+                }
+
+                if ( opsflag ) {
+                    cache_requirements( block.begin, block.size, hash );
+                }
+            }
+        }
+
+        // only the decodings that produce XER are written without the DOM.
+        if ( !decode_messageframe ) {
+            return false;
+        }
+
+        OdeEnvelope::Range bytes = envelope_scanner_.bytes();
+        byte_hex_.assign( bytes.begin, bytes.size );
+
+        OdeEnvelope::Range encoding = envelope_scanner_.bytes_encoding();
+        decode_hex_data( byte_hex_, &xer_buffer_, base64_encoding( encoding.begin, encoding.size ) );
+
+    } catch ( const std::exception& e ) {
+        // the DOM produces the error response.
+        SPDLOG_TRACE(ilogger, "{}: falling back to the DOM: {}", fnname, e.what() );
+        reset_verdict();
+        return false;
+    }
+
+    if ( verdict_ == BsmFilter::Verdict::DROP ) return true;
+
+    if ( payload_only_ ) {
+        set_response_metadata( envelope_scanner_ );
+        save_payload( output_message_stream );
+        return true;
+    }
+
+    StageClock clock{ timing(), CodecStage::SERIALIZE };
+
+    // the envelope is copied as it is; only the dataType text and the content of data change.
+    OdeEnvelope::Range data_type = envelope_scanner_.data_type();
+    OdeEnvelope::Range data = envelope_scanner_.data();
+    const char* xml_type = asn1datatypes[static_cast<int>(Asn1DataType::XML)];
+
+    output_message_stream.write( buffer, data_type.begin - buffer );
+    output_message_stream.write( xml_type, std::strlen( xml_type ) );
+    output_message_stream.write( data_type.end(), data.begin - data_type.end() );
+    output_message_stream.write( xer_buffer_.buffer, xer_buffer_.buffer_size );
+    output_message_stream.write( data.end(), buffer + length - data.end() );
+
+    return true;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+/**
+ * acm_corpus: write a benchmark corpus of generated J2735 MessageFrames.
+ *
+ * usage: acm_corpus [-n messages] [-m mix] [-s seed] [-v vehicles] [-i intersections] [-f uper|coer|xml] [-l] [-o file]
+ *
+ *    -n  the number of messages (default 100000).
+ *    -m  the weights of the message kinds (default bsm=70,tim=10,map=10,spat=10).
+ *    -s  the seed; the same seed writes the same corpus (default 1).
+ *    -v  the vehicles that send the BSMs (default 256).
+ *    -i  the intersections of the MAPs and SPaTs (default 32).
+ *    -f  uper: MessageFrames; coer: IEEE 1609.2 frames holding them; xml: ODE XML decode requests, one a line.
+ *    -l  start each uper or coer message with its 4 byte big-endian length.
+ *    -o  the output file (default stdout).
+ *
+ * The uper and coer corpora are concatenated PDUs, as acm-blob-producer -P and acm.input.stream cut them; with -l they
+ * are the length framing of batch mode. The xml corpus is the lines framing of batch mode and the request corpus of
+ * kafka_tool -R -c.
+ */
+
+#include "corpus_generator.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+    void usage( const char* name ) {
+        std::cerr << "usage: " << name << " [-n messages] [-m mix] [-s seed] [-v vehicles] [-i intersections]"
+            " [-f uper|coer|xml] [-l] [-o file]\n";
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    uint64_t messages = 100000;
+    std::string mix;
+    uint64_t seed = 1;
+    std::size_t vehicles = 256;
+    std::size_t intersections = 32;
+    std::string format_name = "uper";
+    bool length_prefix = false;
+    std::string output_file;
+
+    for ( int i = 1; i < argc; ++i ) {
+        if ( std::strcmp( argv[i], "-n" ) == 0 && i + 1 < argc ) {
+            messages = std::strtoull( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-m" ) == 0 && i + 1 < argc ) {
+            mix = argv[++i];
+        } else if ( std::strcmp( argv[i], "-s" ) == 0 && i + 1 < argc ) {
+            seed = std::strtoull( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-v" ) == 0 && i + 1 < argc ) {
+            vehicles = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-i" ) == 0 && i + 1 < argc ) {
+            intersections = std::strtoul( argv[++i], nullptr, 10 );
+        } else if ( std::strcmp( argv[i], "-f" ) == 0 && i + 1 < argc ) {
+            format_name = argv[++i];
+        } else if ( std::strcmp( argv[i], "-l" ) == 0 ) {
+            length_prefix = true;
+        } else if ( std::strcmp( argv[i], "-o" ) == 0 && i + 1 < argc ) {
+            output_file = argv[++i];
+        } else {
+            usage( argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( messages == 0 || vehicles == 0 || intersections == 0 ) {
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream file;
+    if ( !output_file.empty() ) {
+        file.open( output_file, std::ios::binary | std::ios::trunc );
+        if ( !file ) {
+            std::cerr << "cannot write " << output_file << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& os = output_file.empty() ? std::cout : file;
+
+    uint64_t kinds[ static_cast<std::size_t>( CorpusGenerator::Kind::COUNT ) ] = {};
+    uint64_t bytes = 0;
+
+    try {
+        CorpusGenerator::Format format = CorpusGenerator::parse_format( format_name );
+        CorpusGenerator generator{ seed, vehicles, intersections };
+        if ( !mix.empty() ) generator.set_mix( mix );
+
+        std::string message;
+        for ( uint64_t n = 0; n < messages; ++n ) {
+            CorpusGenerator::Kind kind = generator.next( format, message );
+            ++kinds[ static_cast<std::size_t>( kind ) ];
+
+            if ( format == CorpusGenerator::Format::XML ) {
+                message += '\n';
+            } else if ( length_prefix ) {
+                uint32_t length = static_cast<uint32_t>( message.size() );
+                char prefix[4] = { static_cast<char>( length >> 24 ), static_cast<char>( length >> 16 ),
+                    static_cast<char>( length >> 8 ), static_cast<char>( length ) };
+                os.write( prefix, sizeof( prefix ) );
+                bytes += sizeof( prefix );
+            }
+
+            os.write( message.data(), message.size() );
+            bytes += message.size();
+        }
+    } catch ( const std::exception& e ) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    os.flush();
+    if ( !os ) {
+        std::cerr << "cannot write the corpus.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << messages << " messages, " << bytes << " bytes:";
+    for ( std::size_t k = 0; k < static_cast<std::size_t>( CorpusGenerator::Kind::COUNT ); ++k ) {
+        std::cerr << ' ' << CorpusGenerator::name( static_cast<CorpusGenerator::Kind>( k ) ) << '=' << kinds[k];
+    }
+    std::cerr << '\n';
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "alloc_counter.hpp"
+
+#ifdef ACM_ALLOC_COUNTING
+
+#include <cerrno>
+#include <cstdlib>
+
+// the glibc allocator, which the replacements below call; these names are exported for exactly this use.
+extern "C" {
+    void* __libc_malloc( std::size_t size );
+    void* __libc_calloc( std::size_t nmemb, std::size_t size );
+    void* __libc_realloc( void* ptr, std::size_t size );
+    void* __libc_memalign( std::size_t alignment, std::size_t size );
+    void __libc_free( void* ptr );
+}
+
+namespace {
+
+    // trivial and initial-exec, so reading it never allocates; the allocator is called before any constructor runs.
+    thread_local AllocCounter::Counts thread_allocs __attribute__(( tls_model( "initial-exec" ) )) = { 0, 0, 0, 0, 0 };
+
+    inline void count( std::size_t size ) {
+        ++thread_allocs.allocations;
+        thread_allocs.bytes += size;
+    }
+}
+
+extern "C" {
+
+void* malloc( std::size_t size ) noexcept
+{
+    count( size );
+    return __libc_malloc( size );
+}
+
+void* calloc( std::size_t nmemb, std::size_t size ) noexcept
+{
+    count( nmemb * size );
+    return __libc_calloc( nmemb, size );
+}
+
+void* realloc( void* ptr, std::size_t size ) noexcept
+{
+    count( size );
+    return __libc_realloc( ptr, size );
+}
+
+void free( void* ptr ) noexcept
+{
+    if ( ptr ) ++thread_allocs.frees;
+    __libc_free( ptr );
+}
+
+int posix_memalign( void** ptr, std::size_t alignment, std::size_t size ) noexcept
+{
+    count( size );
+    void* p = __libc_memalign( alignment, size );
+    if ( !p ) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+void* aligned_alloc( std::size_t alignment, std::size_t size ) noexcept
+{
+    count( size );
+    return __libc_memalign( alignment, size );
+}
+
+void* memalign( std::size_t alignment, std::size_t size ) noexcept
+{
+    count( size );
+    return __libc_memalign( alignment, size );
+}
+
+}
+
+bool AllocCounter::enabled() {
+    return true;
+}
+
+AllocCounter::Counts AllocCounter::thread_counts() {
+    return thread_allocs;
+}
+
+void AllocCounter::count_asn1( std::size_t size ) {
+    ++thread_allocs.asn1_allocations;
+    thread_allocs.asn1_bytes += size;
+}
+
+#else
+
+bool AllocCounter::enabled() {
+    return false;
+}
+
+AllocCounter::Counts AllocCounter::thread_counts() {
+    return Counts{ 0, 0, 0, 0, 0 };
+}
+
+void AllocCounter::count_asn1( std::size_t ) {
+}
+
+#endif
+
+AllocCounter::AllocCounter() :
+    start_( thread_counts() )
+{}
+
+AllocCounter::Counts AllocCounter::counts() const {
+    Counts now = thread_counts();
+    return Counts{
+        now.allocations - start_.allocations,
+        now.bytes - start_.bytes,
+        now.frees - start_.frees,
+        now.asn1_allocations - start_.asn1_allocations,
+        now.asn1_bytes - start_.asn1_bytes };
+}
+
+void AllocCounter::restart() {
+    start_ = thread_counts();
+}
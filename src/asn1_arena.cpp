@@ -0,0 +1,333 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "asn1_arena.hpp"
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+    // every allocation is preceded by a header holding its size, so REALLOC can copy the old contents.
+    constexpr std::size_t alignment = 16;
+    constexpr std::size_t header_size = alignment;
+    constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+    inline std::size_t round_up( std::size_t n, std::size_t to )
+    {
+        return ( n + to - 1 ) / to * to;
+    }
+
+    inline std::size_t& size_of( void* ptr )
+    {
+        return *reinterpret_cast<std::size_t*>( static_cast<char*>( ptr ) - header_size );
+    }
+
+    thread_local Asn1Arena* current_arena = nullptr;
+}
+
+Asn1Arena::Scope::Scope( Asn1Arena* arena ) :
+    arena_{ arena }
+    , previous_{ current_arena }
+{
+    if ( arena_ ) current_arena = arena_;
+}
+
+Asn1Arena::Scope::~Scope()
+{
+    if ( arena_ ) {
+        arena_->reset();
+        current_arena = previous_;
+    }
+}
+
+Asn1Arena::Suspend::Suspend() :
+    previous_{ current_arena }
+{
+    current_arena = nullptr;
+}
+
+Asn1Arena::Suspend::~Suspend()
+{
+    current_arena = previous_;
+}
+
+Asn1Arena::Asn1Arena( std::size_t chunk_size ) :
+    chunk_size_{ round_up( chunk_size ? chunk_size : 1, 4096 ) }
+    , chunks_{}
+    , curr_{ 0 }
+    , offset_{ 0 }
+    , allocated_{ 0 }
+    , limit_{ 0 }
+    , timed_{ false }
+    , deadline_{}
+    , calls_{ 0 }
+    , exceeded_{ Exceeded::NONE }
+    , retain_{ 0 }
+{}
+
+Asn1Arena::~Asn1Arena()
+{
+    for ( auto& chunk : chunks_ ) release( chunk );
+}
+
+Asn1Arena* Asn1Arena::current()
+{
+    return current_arena;
+}
+
+bool Asn1Arena::add_chunk( std::size_t minimum )
+{
+    Chunk chunk{ nullptr, round_up( minimum > chunk_size_ ? minimum : chunk_size_, 4096 ), false, false };
+
+#ifdef __linux__
+#ifdef MAP_HUGETLB
+    // explicit huge pages are only available when the administrator has reserved them.
+    std::size_t huge_size = round_up( chunk.size, huge_page_size );
+    void* p = mmap( nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+    if ( p != MAP_FAILED ) {
+        chunk.base = static_cast<char*>( p );
+        chunk.size = huge_size;
+        chunk.mapped = true;
+        chunk.huge = true;
+    }
+#endif
+    if ( !chunk.base ) {
+        void* p = mmap( nullptr, chunk.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( p != MAP_FAILED ) {
+            chunk.base = static_cast<char*>( p );
+            chunk.mapped = true;
+#ifdef MADV_HUGEPAGE
+            // otherwise ask for transparent huge pages.
+            madvise( p, chunk.size, MADV_HUGEPAGE );
+#endif
+        }
+    }
+#endif
+
+    if ( !chunk.base ) {
+        chunk.base = static_cast<char*>( std::malloc( chunk.size ) );
+        if ( !chunk.base ) return false;
+    }
+
+    chunks_.push_back( chunk );
+    return true;
+}
+
+void Asn1Arena::release( Chunk& chunk )
+{
+#ifdef __linux__
+    if ( chunk.mapped ) {
+        munmap( chunk.base, chunk.size );
+        return;
+    }
+#endif
+    std::free( chunk.base );
+}
+
+void* Asn1Arena::allocate( std::size_t size )
+{
+    // the clock is read once every 64 allocations; a failed allocation makes the decoder return RC_FAIL.
+    if ( limit_ > 0 && allocated_ + size > limit_ ) {
+        exceeded_ = Exceeded::MEMORY;
+        return nullptr;
+    }
+
+    if ( timed_ && ( ++calls_ & 63 ) == 0 && std::chrono::steady_clock::now() > deadline_ ) {
+        exceeded_ = Exceeded::TIME;
+        timed_ = false;
+    }
+
+    if ( exceeded_ != Exceeded::NONE ) return nullptr;
+
+    std::size_t needed = header_size + round_up( size ? size : 1, alignment );
+
+    // use the current chunk, then any retained chunk that is large enough, then a new chunk.
+    while ( curr_ < chunks_.size() && chunks_[curr_].size - offset_ < needed ) {
+        ++curr_;
+        offset_ = 0;
+    }
+
+    if ( curr_ == chunks_.size() && !add_chunk( needed ) ) {
+        return nullptr;
+    }
+
+    void* ptr = chunks_[curr_].base + offset_ + header_size;
+    size_of( ptr ) = size;
+    offset_ += needed;
+    allocated_ += size;
+    return ptr;
+}
+
+void* Asn1Arena::reallocate( void* ptr, std::size_t size )
+{
+    if ( !ptr ) return allocate( size );
+
+    std::size_t old_size = size_of( ptr );
+
+    if ( exceeded_ != Exceeded::NONE ) return nullptr;
+    if ( limit_ > 0 && size > old_size && allocated_ + size - old_size > limit_ ) {
+        exceeded_ = Exceeded::MEMORY;
+        return nullptr;
+    }
+
+    char* end = static_cast<char*>( ptr ) + round_up( old_size ? old_size : 1, alignment );
+
+    // the most recent allocation grows in place when the chunk has room.
+    if ( curr_ < chunks_.size() && end == chunks_[curr_].base + offset_ ) {
+        std::size_t grown = round_up( size ? size : 1, alignment );
+        std::size_t start = static_cast<char*>( ptr ) - chunks_[curr_].base;
+        if ( start + grown <= chunks_[curr_].size ) {
+            offset_ = start + grown;
+            allocated_ += size - old_size;
+            size_of( ptr ) = size;
+            return ptr;
+        }
+    }
+
+    void* r = allocate( size );
+    if ( r ) std::memcpy( r, ptr, old_size < size ? old_size : size );
+    return r;
+}
+
+bool Asn1Arena::owns( const void* ptr ) const
+{
+    const char* p = static_cast<const char*>( ptr );
+    for ( std::size_t i = 0; i <= curr_ && i < chunks_.size(); ++i ) {
+        if ( p >= chunks_[i].base && p < chunks_[i].base + chunks_[i].size ) return true;
+    }
+    return false;
+}
+
+void Asn1Arena::reset()
+{
+    curr_ = 0;
+    offset_ = 0;
+    allocated_ = 0;
+    timed_ = false;
+    calls_ = 0;
+    exceeded_ = Exceeded::NONE;
+
+    if ( retain_ > 0 ) {
+        std::size_t reserved = bytes_reserved();
+        while ( chunks_.size() > 1 && reserved > retain_ ) {
+            reserved -= chunks_.back().size;
+            release( chunks_.back() );
+            chunks_.pop_back();
+        }
+    }
+}
+
+void Asn1Arena::set_limit( std::size_t max_bytes )
+{
+    limit_ = max_bytes;
+}
+
+void Asn1Arena::set_deadline( std::chrono::steady_clock::time_point deadline )
+{
+    timed_ = true;
+    deadline_ = deadline;
+}
+
+Asn1Arena::Exceeded Asn1Arena::exceeded() const
+{
+    return exceeded_;
+}
+
+void Asn1Arena::set_retain( std::size_t max_bytes )
+{
+    retain_ = max_bytes;
+}
+
+std::size_t Asn1Arena::bytes_allocated() const
+{
+    return allocated_;
+}
+
+std::size_t Asn1Arena::bytes_reserved() const
+{
+    std::size_t n = 0;
+    for ( auto& chunk : chunks_ ) n += chunk.size;
+    return n;
+}
+
+std::size_t Asn1Arena::huge_page_chunks() const
+{
+    std::size_t n = 0;
+    for ( auto& chunk : chunks_ ) n += chunk.huge ? 1 : 0;
+    return n;
+}
+
+extern "C" {
+
+void* acm_asn_calloc( std::size_t nmemb, std::size_t size )
+{
+#ifdef ACM_ALLOC_COUNTING
+    AllocCounter::count_asn1( nmemb * size );
+#endif
+
+    Asn1Arena* arena = current_arena;
+    if ( !arena ) return std::calloc( nmemb, size );
+
+    if ( size && nmemb > static_cast<std::size_t>( -1 ) / size ) return nullptr;
+    void* p = arena->allocate( nmemb * size );
+    if ( p ) std::memset( p, 0, nmemb * size );
+    return p;
+}
+
+void* acm_asn_malloc( std::size_t size )
+{
+#ifdef ACM_ALLOC_COUNTING
+    AllocCounter::count_asn1( size );
+#endif
+
+    Asn1Arena* arena = current_arena;
+    return arena ? arena->allocate( size ) : std::malloc( size );
+}
+
+void* acm_asn_realloc( void* ptr, std::size_t size )
+{
+#ifdef ACM_ALLOC_COUNTING
+    AllocCounter::count_asn1( size );
+#endif
+
+    Asn1Arena* arena = current_arena;
+
+    // memory from the C library stays in the C library.
+    if ( arena && ( !ptr || arena->owns( ptr ) ) ) return arena->reallocate( ptr, size );
+    return std::realloc( ptr, size );
+}
+
+void acm_asn_free( void* ptr )
+{
+    Asn1Arena* arena = current_arena;
+
+    // arena memory is released all at once when the message scope ends.
+    if ( arena && arena->owns( ptr ) ) return;
+    std::free( ptr );
+}
+
+}
@@ -0,0 +1,474 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "asn1_dom.hpp"
+
+#include "asn_internal.h"
+#include "constr_SEQUENCE.h"
+#include "constr_CHOICE.h"
+#include "constr_SEQUENCE_OF.h"
+#include "constr_SET_OF.h"
+#include "asn_SET_OF.h"
+#include "OPEN_TYPE.h"
+#include "INTEGER.h"
+#include "NativeInteger.h"
+#include "NativeEnumerated.h"
+#include "BOOLEAN.h"
+#include "NULL.h"
+#include "OCTET_STRING.h"
+#include "BIT_STRING.h"
+#include "IA5String.h"
+#include "UTF8String.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+    // OTHER: the element is not in a form the walk handles; the type's asn1c XER decoder is given its XML instead.
+    enum class Fill { DONE, FAILED, OTHER };
+
+    struct StringWriter : pugi::xml_writer {
+        std::string& out;
+
+        explicit StringWriter( std::string& s ) : out( s ) {}
+
+        void write( const void* data, size_t size ) override
+        {
+            out.append( static_cast<const char*>( data ), size );
+        }
+    };
+
+    thread_local std::string scratch;
+
+    bool fill_value( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void** sptr, const asn_codec_ctx_t* ctx );
+
+    void release( const asn_TYPE_descriptor_t* td, void* sptr )
+    {
+        td->op->free_struct( td, sptr, ASFM_FREE_EVERYTHING );
+    }
+
+    // the size of a type's structure; 0 when the walk does not build that type. An open type is built by the SEQUENCE
+    // that holds it.
+    std::size_t struct_size( const asn_TYPE_descriptor_t* td )
+    {
+        const asn_TYPE_operation_t* op = td->op;
+
+        if ( op == &asn_OP_SEQUENCE ) {
+            const asn_SEQUENCE_specifics_t* specs = static_cast<const asn_SEQUENCE_specifics_t*>( td->specifics );
+            return specs ? specs->struct_size : 0;
+        }
+
+        if ( op == &asn_OP_CHOICE ) {
+            const asn_CHOICE_specifics_t* specs = static_cast<const asn_CHOICE_specifics_t*>( td->specifics );
+            return specs ? specs->struct_size : 0;
+        }
+
+        if ( op == &asn_OP_SEQUENCE_OF || op == &asn_OP_SET_OF ) {
+            const asn_SET_OF_specifics_t* specs = static_cast<const asn_SET_OF_specifics_t*>( td->specifics );
+            return specs ? specs->struct_size : 0;
+        }
+
+        if ( op == &asn_OP_NativeInteger || op == &asn_OP_NativeEnumerated ) return sizeof( long );
+        if ( op == &asn_OP_INTEGER ) return sizeof( INTEGER_t );
+        if ( op == &asn_OP_BOOLEAN ) return sizeof( BOOLEAN_t );
+        if ( op == &asn_OP_NULL ) return sizeof( NULL_t );
+
+        if ( op == &asn_OP_OCTET_STRING || op == &asn_OP_IA5String || op == &asn_OP_UTF8String || op == &asn_OP_BIT_STRING ) {
+            const asn_OCTET_STRING_specifics_t* specs = static_cast<const asn_OCTET_STRING_specifics_t*>( td->specifics );
+            if ( specs ) return specs->struct_size;
+            return op == &asn_OP_BIT_STRING ? sizeof( BIT_STRING_t ) : sizeof( OCTET_STRING_t );
+        }
+
+        return 0;
+    }
+
+    // the members of a structure are either embedded or, for OPTIONAL and recursive members, pointers that are
+    // allocated when the member is present; the asn1c decoders take the address of either.
+    void** slot( const asn_TYPE_member_t& elm, void* sptr, void*& embedded )
+    {
+        char* field = static_cast<char*>( sptr ) + elm.memb_offset;
+        if ( elm.flags & ATF_POINTER ) {
+            return reinterpret_cast<void**>( field );
+        }
+        embedded = field;
+        return &embedded;
+    }
+
+    // the text of a value without elements; false when the element has any.
+    bool text( const pugi::xml_node& node, const char*& value )
+    {
+        pugi::xml_node child = node.first_child();
+        value = "";
+        if ( !child ) return true;
+        if ( child.next_sibling() || ( child.type() != pugi::node_pcdata && child.type() != pugi::node_cdata ) ) return false;
+        value = child.value();
+        return true;
+    }
+
+    // the only child of a value without text, e.g., <true/> or the alternative of a CHOICE; empty when there is not
+    // exactly one element.
+    pugi::xml_node only_element( const pugi::xml_node& node )
+    {
+        pugi::xml_node child = node.first_child();
+        if ( !child || child.next_sibling() || child.type() != pugi::node_element ) return pugi::xml_node{};
+        return child;
+    }
+
+    // the name of an empty element without attributes, e.g., <neutral/>; null otherwise.
+    const char* empty_element( const pugi::xml_node& node )
+    {
+        pugi::xml_node child = only_element( node );
+        if ( !child || child.first_child() || child.first_attribute() ) return nullptr;
+        return child.name();
+    }
+
+    bool is_digit( char c )
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool is_space( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // decimal digits with an optional minus sign; anything else, e.g., a named number, is left to asn1c.
+    bool parse_long( const char* s, long& value )
+    {
+        const char* p = ( *s == '-' ) ? s + 1 : s;
+        if ( !is_digit( *p ) ) return false;
+        while ( is_digit( *p ) ) ++p;
+        if ( *p ) return false;
+
+        errno = 0;
+        value = std::strtol( s, nullptr, 10 );
+        return errno == 0;
+    }
+
+    bool parse_ulong( const char* s, unsigned long& value )
+    {
+        const char* p = s;
+        if ( !is_digit( *p ) ) return false;
+        while ( is_digit( *p ) ) ++p;
+        if ( *p ) return false;
+
+        errno = 0;
+        value = std::strtoul( s, nullptr, 10 );
+        return errno == 0;
+    }
+
+    int nibble( char c )
+    {
+        if ( c >= '0' && c <= '9' ) return c - '0';
+        if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+        if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+        return -1;
+    }
+
+    // OCTET STRING XER is hex, possibly with white space between the digits.
+    Fill fill_hex( OCTET_STRING_t* os, const char* s )
+    {
+        uint8_t* buf = static_cast<uint8_t*>( CALLOC( 1, std::strlen( s ) / 2 + 1 ) );
+        if ( !buf ) return Fill::FAILED;
+
+        std::size_t size = 0;
+        int high = -1;
+        for ( ; *s; ++s ) {
+            if ( is_space( *s ) ) continue;
+
+            int low = nibble( *s );
+            if ( low < 0 ) {
+                FREEMEM( buf );
+                return Fill::OTHER;
+            }
+
+            if ( high < 0 ) {
+                high = low;
+            } else {
+                buf[size++] = static_cast<uint8_t>( high << 4 | low );
+                high = -1;
+            }
+        }
+
+        if ( high >= 0 ) {
+            FREEMEM( buf );
+            return Fill::OTHER;
+        }
+
+        os->buf = buf;
+        os->size = size;
+        return Fill::DONE;
+    }
+
+    // BIT STRING XER is the bits as 0 and 1 characters, first bit first.
+    Fill fill_bits( BIT_STRING_t* bs, const char* s )
+    {
+        uint8_t* buf = static_cast<uint8_t*>( CALLOC( 1, std::strlen( s ) / 8 + 1 ) );
+        if ( !buf ) return Fill::FAILED;
+
+        std::size_t bits = 0;
+        for ( ; *s; ++s ) {
+            if ( is_space( *s ) ) continue;
+
+            if ( *s == '1' ) {
+                buf[bits >> 3] |= static_cast<uint8_t>( 0x80 >> ( bits & 7 ) );
+            } else if ( *s != '0' ) {
+                FREEMEM( buf );
+                return Fill::OTHER;
+            }
+            ++bits;
+        }
+
+        bs->buf = buf;
+        bs->size = ( bits + 7 ) / 8;
+        bs->bits_unused = static_cast<int>( ( 8 - bits % 8 ) % 8 );
+        return Fill::DONE;
+    }
+
+    // SEQUENCE members are in order; only OPTIONAL ones may be left out.
+    Fill fill_sequence( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void* sptr, const asn_codec_ctx_t* ctx );
+
+    // an open type holds the alternative its SEQUENCE's selector picks, e.g., the value of a MessageFrame by its
+    // messageId, in an element of that alternative's type.
+    Fill fill_open_type( const asn_TYPE_descriptor_t* parent, const asn_TYPE_member_t& elm, const pugi::xml_node& node,
+                         void* parent_sptr, void** sptr, const asn_codec_ctx_t* ctx )
+    {
+        if ( !elm.type_selector || node.first_attribute() ) return Fill::OTHER;
+
+        asn_type_selector_result_t selected = elm.type_selector( parent, parent_sptr );
+        pugi::xml_node child = only_element( node );
+        if ( !child || !selected.type_descriptor || selected.presence_index == 0 ||
+                selected.presence_index > elm.type->elements_count ||
+                std::strcmp( child.name(), selected.type_descriptor->xml_tag ) != 0 ) {
+            return Fill::OTHER;
+        }
+
+        if ( !*sptr ) {
+            const asn_CHOICE_specifics_t* specs = static_cast<const asn_CHOICE_specifics_t*>( elm.type->specifics );
+            *sptr = CALLOC( 1, specs->struct_size );
+            if ( !*sptr ) return Fill::FAILED;
+        }
+
+        // the alternative is marked present first so it is freed with the structure if it is not filled.
+        if ( CHOICE_variant_set_presence( elm.type, *sptr, selected.presence_index ) != 0 ) return Fill::FAILED;
+
+        const asn_TYPE_member_t& alternative = elm.type->elements[selected.presence_index - 1];
+        void* embedded = nullptr;
+        return fill_value( alternative.type, child, slot( alternative, *sptr, embedded ), ctx ) ? Fill::DONE : Fill::FAILED;
+    }
+
+    Fill fill_sequence( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void* sptr, const asn_codec_ctx_t* ctx )
+    {
+        unsigned edx = 0;
+
+        for ( pugi::xml_node child = node.first_child(); child; child = child.next_sibling() ) {
+            if ( child.type() != pugi::node_element ) return Fill::OTHER;
+
+            while ( edx < td->elements_count && std::strcmp( td->elements[edx].name, child.name() ) != 0 ) {
+                if ( !td->elements[edx].optional ) return Fill::OTHER;
+                ++edx;
+            }
+            if ( edx == td->elements_count ) return Fill::OTHER;
+
+            const asn_TYPE_member_t& elm = td->elements[edx++];
+            void* embedded = nullptr;
+            void** field = slot( elm, sptr, embedded );
+
+            if ( elm.flags & ATF_OPEN_TYPE ) {
+                Fill filled = fill_open_type( td, elm, child, sptr, field, ctx );
+                if ( filled != Fill::DONE ) return filled;
+            } else if ( !fill_value( elm.type, child, field, ctx ) ) {
+                return Fill::FAILED;
+            }
+        }
+
+        for ( ; edx < td->elements_count; ++edx ) {
+            if ( !td->elements[edx].optional ) return Fill::OTHER;
+        }
+
+        return Fill::DONE;
+    }
+
+    Fill fill_choice( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void* sptr, const asn_codec_ctx_t* ctx )
+    {
+        pugi::xml_node child = only_element( node );
+        if ( !child ) return Fill::OTHER;
+
+        for ( unsigned i = 0; i < td->elements_count; ++i ) {
+            const asn_TYPE_member_t& elm = td->elements[i];
+            if ( std::strcmp( elm.name, child.name() ) != 0 ) continue;
+
+            // the alternative is marked present first so it is freed with the structure if it is not filled.
+            if ( CHOICE_variant_set_presence( td, sptr, i + 1 ) != 0 ) return Fill::FAILED;
+
+            void* embedded = nullptr;
+            return fill_value( elm.type, child, slot( elm, sptr, embedded ), ctx ) ? Fill::DONE : Fill::FAILED;
+        }
+
+        return Fill::OTHER;
+    }
+
+    Fill fill_list( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void* sptr, const asn_codec_ctx_t* ctx )
+    {
+        // a list of ENUMERATED or BOOLEAN values has no item elements.
+        const asn_SET_OF_specifics_t* specs = static_cast<const asn_SET_OF_specifics_t*>( td->specifics );
+        if ( specs->as_XMLValueList ) return Fill::OTHER;
+
+        const asn_TYPE_member_t& elm = td->elements[0];
+        const char* name = ( elm.name && *elm.name ) ? elm.name : elm.type->xml_tag;
+
+        for ( pugi::xml_node child = node.first_child(); child; child = child.next_sibling() ) {
+            if ( child.type() != pugi::node_element || std::strcmp( child.name(), name ) != 0 ) return Fill::OTHER;
+
+            void* item = nullptr;
+            if ( !fill_value( elm.type, child, &item, ctx ) || asn_set_add( sptr, item ) != 0 ) {
+                if ( item ) release( elm.type, item );
+                return Fill::FAILED;
+            }
+        }
+
+        return Fill::DONE;
+    }
+
+    Fill fill_structure( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void* sptr, const asn_codec_ctx_t* ctx )
+    {
+        const asn_TYPE_operation_t* op = td->op;
+
+        if ( op == &asn_OP_SEQUENCE ) return fill_sequence( td, node, sptr, ctx );
+        if ( op == &asn_OP_CHOICE ) return fill_choice( td, node, sptr, ctx );
+        if ( op == &asn_OP_SEQUENCE_OF || op == &asn_OP_SET_OF ) return fill_list( td, node, sptr, ctx );
+
+        if ( op == &asn_OP_NativeInteger || op == &asn_OP_INTEGER ) {
+            const asn_INTEGER_specifics_t* specs = static_cast<const asn_INTEGER_specifics_t*>( td->specifics );
+            const char* value;
+            if ( !text( node, value ) ) return Fill::OTHER;
+
+            if ( specs && specs->field_unsigned ) {
+                unsigned long u;
+                if ( !parse_ulong( value, u ) ) return Fill::OTHER;
+                if ( op == &asn_OP_NativeInteger ) {
+                    *static_cast<unsigned long*>( sptr ) = u;
+                    return Fill::DONE;
+                }
+                return asn_ulong2INTEGER( static_cast<INTEGER_t*>( sptr ), u ) == 0 ? Fill::DONE : Fill::FAILED;
+            }
+
+            long l;
+            if ( !parse_long( value, l ) ) return Fill::OTHER;
+            if ( op == &asn_OP_NativeInteger ) {
+                *static_cast<long*>( sptr ) = l;
+                return Fill::DONE;
+            }
+            return asn_long2INTEGER( static_cast<INTEGER_t*>( sptr ), l ) == 0 ? Fill::DONE : Fill::FAILED;
+        }
+
+        if ( op == &asn_OP_NativeEnumerated ) {
+            const asn_INTEGER_specifics_t* specs = static_cast<const asn_INTEGER_specifics_t*>( td->specifics );
+            const char* name = empty_element( node );
+            if ( !name || !specs ) return Fill::OTHER;
+
+            std::size_t length = std::strlen( name );
+            for ( int i = 0; i < specs->map_count; ++i ) {
+                const asn_INTEGER_enum_map_t& e = specs->value2enum[i];
+                if ( e.enum_len == length && std::memcmp( e.enum_name, name, length ) == 0 ) {
+                    *static_cast<long*>( sptr ) = e.nat_value;
+                    return Fill::DONE;
+                }
+            }
+            return Fill::OTHER;
+        }
+
+        if ( op == &asn_OP_BOOLEAN ) {
+            const char* name = empty_element( node );
+            if ( !name ) return Fill::OTHER;
+
+            if ( std::strcmp( name, "true" ) == 0 ) {
+                *static_cast<BOOLEAN_t*>( sptr ) = 1;
+            } else if ( std::strcmp( name, "false" ) == 0 ) {
+                *static_cast<BOOLEAN_t*>( sptr ) = 0;
+            } else {
+                return Fill::OTHER;
+            }
+            return Fill::DONE;
+        }
+
+        if ( op == &asn_OP_NULL ) {
+            return node.first_child() ? Fill::OTHER : Fill::DONE;
+        }
+
+        const char* value;
+        if ( !text( node, value ) ) return Fill::OTHER;
+
+        if ( op == &asn_OP_OCTET_STRING ) return fill_hex( static_cast<OCTET_STRING_t*>( sptr ), value );
+        if ( op == &asn_OP_BIT_STRING ) return fill_bits( static_cast<BIT_STRING_t*>( sptr ), value );
+
+        // IA5String and UTF8String; the document already has the XML escapes replaced.
+        return OCTET_STRING_fromBuf( static_cast<OCTET_STRING_t*>( sptr ), value, -1 ) == 0 ? Fill::DONE : Fill::FAILED;
+    }
+
+    // the element's XML is decoded by its type's asn1c XER decoder, into the structure when it is already allocated.
+    bool fallback( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void** sptr, const asn_codec_ctx_t* ctx )
+    {
+        if ( !td->op->xer_decoder ) return false;
+        if ( *sptr ) td->op->free_struct( td, *sptr, ASFM_FREE_UNDERLYING_AND_RESET );
+
+        scratch.clear();
+        StringWriter writer{ scratch };
+        node.print( writer, "", pugi::format_raw );
+
+        asn_dec_rval_t rval = td->op->xer_decoder( ctx, td, sptr, node.name(), scratch.data(), scratch.size() );
+        return rval.code == RC_OK;
+    }
+
+    bool fill_value( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void** sptr, const asn_codec_ctx_t* ctx )
+    {
+        std::size_t size = struct_size( td );
+        if ( size == 0 || node.first_attribute() ) return fallback( td, node, sptr, ctx );
+
+        if ( !*sptr ) {
+            *sptr = CALLOC( 1, size );
+            if ( !*sptr ) return false;
+        }
+
+        Fill filled = fill_structure( td, node, *sptr, ctx );
+        if ( filled == Fill::OTHER ) return fallback( td, node, sptr, ctx );
+        return filled == Fill::DONE;
+    }
+}
+
+namespace asn1_dom {
+
+    bool fill( const asn_TYPE_descriptor_t* td, const pugi::xml_node& node, void** sptr, const asn_codec_ctx_t* ctx )
+    {
+        if ( std::strcmp( node.name(), td->xml_tag ) == 0 && fill_value( td, node, sptr, ctx ) ) return true;
+
+        if ( *sptr ) {
+            release( td, *sptr );
+            *sptr = nullptr;
+        }
+        return false;
+    }
+}
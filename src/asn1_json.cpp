@@ -0,0 +1,259 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "asn1_json.hpp"
+#include "hex_codec.hpp"
+
+#include "constr_SEQUENCE.h"
+#include "constr_CHOICE.h"
+#include "constr_SEQUENCE_OF.h"
+#include "constr_SET_OF.h"
+#include "asn_SET_OF.h"
+#include "OPEN_TYPE.h"
+#include "INTEGER.h"
+#include "NativeInteger.h"
+#include "NativeEnumerated.h"
+#include "BOOLEAN.h"
+#include "NULL.h"
+#include "OCTET_STRING.h"
+#include "BIT_STRING.h"
+#include "IA5String.h"
+#include "UTF8String.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+    using asn1_json::Writer;
+
+    // scratch space for hex and bit strings; each thread writes one message at a time.
+    thread_local std::string scratch;
+
+    int append( const void* buffer, size_t size, void* key )
+    {
+        static_cast<std::string*>( key )->append( static_cast<const char*>( buffer ), size );
+        return 0;
+    }
+
+    // the members of a structure are either embedded or, for OPTIONAL and recursive members, pointers.
+    const void* member( const asn_TYPE_member_t& elm, const void* sptr )
+    {
+        const void* field = static_cast<const char*>( sptr ) + elm.memb_offset;
+        if ( elm.flags & ATF_POINTER ) {
+            field = *static_cast<const void* const*>( field );
+        }
+        return field;
+    }
+
+    void write_value( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w );
+
+    void write_sequence( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w )
+    {
+        w.StartObject();
+        for ( unsigned i = 0; i < td->elements_count; ++i ) {
+            const asn_TYPE_member_t& elm = td->elements[i];
+            const void* field = member( elm, sptr );
+            if ( !field ) continue;
+
+            w.Key( elm.name );
+            write_value( elm.type, field, w );
+        }
+        w.EndObject();
+    }
+
+    void write_choice( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w )
+    {
+        unsigned present = CHOICE_variant_get_presence( td, sptr );
+        const void* field = ( present > 0 && present <= td->elements_count ) ? member( td->elements[present - 1], sptr ) : nullptr;
+
+        if ( !field ) {
+            w.Null();
+            return;
+        }
+
+        w.StartObject();
+        w.Key( td->elements[present - 1].name );
+        write_value( td->elements[present - 1].type, field, w );
+        w.EndObject();
+    }
+
+    void write_list( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w )
+    {
+        const asn_anonymous_set_* list = _A_CSET_FROM_VOID( sptr );
+
+        w.StartArray();
+        for ( int i = 0; i < list->count; ++i ) {
+            if ( list->array[i] ) write_value( td->elements[0].type, list->array[i], w );
+        }
+        w.EndArray();
+    }
+
+    void write_enumerated( const asn_TYPE_descriptor_t* td, long value, Writer& w )
+    {
+        const asn_INTEGER_specifics_t* specs = static_cast<const asn_INTEGER_specifics_t*>( td->specifics );
+        const asn_INTEGER_enum_map_t* map = specs ? INTEGER_map_value2enum( specs, value ) : nullptr;
+
+        if ( map ) {
+            w.String( map->enum_name, static_cast<rapidjson::SizeType>( map->enum_len ) );
+        } else {
+            w.Int64( value );
+        }
+    }
+
+    // types without a JSON form are written as a string holding their canonical XER.
+    void write_xer( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w )
+    {
+        scratch.clear();
+        xer_encode( td, sptr, XER_F_CANONICAL, append, &scratch );
+        w.String( scratch.data(), static_cast<rapidjson::SizeType>( scratch.size() ) );
+    }
+
+    void write_value( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& w )
+    {
+        const asn_TYPE_operation_t* op = td->op;
+
+        if ( op == &asn_OP_SEQUENCE ) {
+            write_sequence( td, sptr, w );
+
+        } else if ( op == &asn_OP_CHOICE || op == &asn_OP_OPEN_TYPE ) {
+            write_choice( td, sptr, w );
+
+        } else if ( op == &asn_OP_SEQUENCE_OF || op == &asn_OP_SET_OF ) {
+            write_list( td, sptr, w );
+
+        } else if ( op == &asn_OP_NativeInteger ) {
+            const asn_INTEGER_specifics_t* specs = static_cast<const asn_INTEGER_specifics_t*>( td->specifics );
+            if ( specs && specs->field_unsigned ) {
+                w.Uint64( *static_cast<const unsigned long*>( sptr ) );
+            } else {
+                w.Int64( *static_cast<const long*>( sptr ) );
+            }
+
+        } else if ( op == &asn_OP_NativeEnumerated ) {
+            write_enumerated( td, *static_cast<const long*>( sptr ), w );
+
+        } else if ( op == &asn_OP_INTEGER ) {
+            long value = 0;
+            if ( asn_INTEGER2long( static_cast<const INTEGER_t*>( sptr ), &value ) == 0 ) {
+                w.Int64( value );
+            } else {
+                write_xer( td, sptr, w );
+            }
+
+        } else if ( op == &asn_OP_BOOLEAN ) {
+            w.Bool( *static_cast<const BOOLEAN_t*>( sptr ) != 0 );
+
+        } else if ( op == &asn_OP_NULL ) {
+            w.Null();
+
+        } else if ( op == &asn_OP_IA5String || op == &asn_OP_UTF8String ) {
+            const OCTET_STRING_t* s = static_cast<const OCTET_STRING_t*>( sptr );
+            w.String( reinterpret_cast<const char*>( s->buf ), static_cast<rapidjson::SizeType>( s->size ) );
+
+        } else if ( op == &asn_OP_OCTET_STRING ) {
+            const OCTET_STRING_t* s = static_cast<const OCTET_STRING_t*>( sptr );
+            hex_codec::encode( s->buf, s->size, scratch );
+            w.String( scratch.data(), static_cast<rapidjson::SizeType>( scratch.size() ) );
+
+        } else if ( op == &asn_OP_BIT_STRING ) {
+            const BIT_STRING_t* s = static_cast<const BIT_STRING_t*>( sptr );
+            std::size_t bits = s->size * 8 - ( s->size ? s->bits_unused : 0 );
+            scratch.resize( bits );
+            for ( std::size_t i = 0; i < bits; ++i ) {
+                scratch[i] = ( s->buf[i / 8] & ( 0x80 >> ( i % 8 ) ) ) ? '1' : '0';
+            }
+            w.String( scratch.data(), static_cast<rapidjson::SizeType>( scratch.size() ) );
+
+        } else {
+            write_xer( td, sptr, w );
+        }
+    }
+
+    bool has_raw( const pugi::xml_node& node, const char* raw_pi )
+    {
+        if ( !raw_pi ) return false;
+        for ( pugi::xml_node c = node.first_child(); c; c = c.next_sibling() ) {
+            if ( c.type() == pugi::node_pi && std::strcmp( c.name(), raw_pi ) == 0 ) return true;
+        }
+        return false;
+    }
+
+    void write_element( const pugi::xml_node& node, Writer& w, const char* raw_pi, const char* raw, std::size_t raw_length )
+    {
+        if ( has_raw( node, raw_pi ) ) {
+            w.RawValue( raw, raw_length, rapidjson::kObjectType );
+            return;
+        }
+
+        if ( !node.find_child( []( const pugi::xml_node& c ) { return c.type() == pugi::node_element; } ) ) {
+            w.String( node.child_value() );
+            return;
+        }
+
+        w.StartObject();
+        for ( pugi::xml_node c = node.first_child(); c; c = c.next_sibling() ) {
+            if ( c.type() != pugi::node_element ) continue;
+
+            // repeated children are written together, as an array, where the first one appears.
+            if ( c.previous_sibling( c.name() ) ) continue;
+
+            w.Key( c.name() );
+            if ( c.next_sibling( c.name() ) ) {
+                w.StartArray();
+                for ( pugi::xml_node s = c; s; s = s.next_sibling( c.name() ) ) {
+                    write_element( s, w, raw_pi, raw, raw_length );
+                }
+                w.EndArray();
+            } else {
+                write_element( c, w, raw_pi, raw, raw_length );
+            }
+        }
+        w.EndObject();
+    }
+}
+
+namespace asn1_json {
+
+    void write( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& writer )
+    {
+        writer.StartObject();
+        writer.Key( td->xml_tag );
+        write_value( td, sptr, writer );
+        writer.EndObject();
+    }
+
+    void write_content( const asn_TYPE_descriptor_t* td, const void* sptr, Writer& writer )
+    {
+        write_value( td, sptr, writer );
+    }
+
+    void write_xml( const pugi::xml_node& node, Writer& writer, const char* raw_pi, const char* raw, std::size_t raw_length )
+    {
+        // a document is written as an object holding its root element.
+        pugi::xml_node element = ( node.type() == pugi::node_document ) ? node.document_element() : node;
+
+        writer.StartObject();
+        writer.Key( element.name() );
+        write_element( element, writer, raw_pi, raw, raw_length );
+        writer.EndObject();
+    }
+}
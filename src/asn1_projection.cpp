@@ -0,0 +1,262 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "asn1_projection.hpp"
+
+#include "constr_SEQUENCE.h"
+#include "constr_CHOICE.h"
+#include "constr_SEQUENCE_OF.h"
+#include "constr_SET_OF.h"
+#include "asn_SET_OF.h"
+#include "OPEN_TYPE.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+    // the members of a structure are either embedded or, for OPTIONAL and recursive members, pointers.
+    const void* member( const asn_TYPE_member_t& elm, const void* sptr )
+    {
+        const void* field = static_cast<const char*>( sptr ) + elm.memb_offset;
+        if ( elm.flags & ATF_POINTER ) {
+            field = *static_cast<const void* const*>( field );
+        }
+        return field;
+    }
+
+    bool is_choice( const asn_TYPE_descriptor_t* td )
+    {
+        return td->op == &asn_OP_CHOICE || td->op == &asn_OP_OPEN_TYPE;
+    }
+
+    bool is_list( const asn_TYPE_descriptor_t* td )
+    {
+        return td->op == &asn_OP_SEQUENCE_OF || td->op == &asn_OP_SET_OF;
+    }
+
+    // the element name of a SEQUENCE OF item in XER.
+    const char* item_name( const asn_TYPE_descriptor_t* td )
+    {
+        const asn_TYPE_member_t& elm = td->elements[0];
+        return ( elm.name && *elm.name ) ? elm.name : elm.type->xml_tag;
+    }
+}
+
+struct Asn1Projection::Sink {
+    asn_app_consume_bytes_f* cb;
+    void* key;
+    ssize_t written;
+
+    bool write( const char* data, std::size_t size )
+    {
+        if ( cb( data, size, key ) < 0 ) return false;
+        written += static_cast<ssize_t>( size );
+        return true;
+    }
+
+    bool tag( const char* name, bool closing )
+    {
+        return write( closing ? "</" : "<", closing ? 2 : 1 ) && write( name, std::strlen( name ) ) && write( ">", 1 );
+    }
+
+    static int count( const void* buffer, size_t size, void* key )
+    {
+        Sink* sink = static_cast<Sink*>( key );
+        return sink->write( static_cast<const char*>( buffer ), size ) ? 0 : -1;
+    }
+};
+
+Asn1Projection::Asn1Projection( const std::string& paths ) :
+    root_{}
+    , size_{ 0 }
+{
+    std::vector<std::string> segments;
+
+    for ( std::size_t begin = 0; begin <= paths.size(); ) {
+        std::size_t end = paths.find( ',', begin );
+        if ( end == std::string::npos ) end = paths.size();
+
+        // spaces around a path are allowed; an empty path is skipped.
+        std::size_t first = paths.find_first_not_of( " \t", begin );
+        std::size_t last = paths.find_last_not_of( " \t", end - 1 );
+        std::string path = ( first < end && last != std::string::npos && last >= first ) ? paths.substr( first, last + 1 - first ) : "";
+        begin = end + 1;
+
+        if ( path.empty() ) continue;
+
+        segments.clear();
+        for ( std::size_t s = 0; s <= path.size(); ) {
+            std::size_t e = path.find( '/', s );
+            if ( e == std::string::npos ) e = path.size();
+            if ( e == s ) {
+                throw std::invalid_argument{ "the projection path " + path + " has an empty segment." };
+            }
+            segments.push_back( path.substr( s, e - s ) );
+            s = e + 1;
+        }
+
+        Node* node = &root_;
+        for ( const std::string& segment : segments ) {
+            Node* child = const_cast<Node*>( find( *node, segment.c_str() ) );
+            if ( !child ) {
+                node->children.push_back( Node{ segment, {}, false } );
+                child = &node->children.back();
+            }
+            node = child;
+
+            // a field that is written completely covers the paths below it.
+            if ( node->whole ) break;
+        }
+
+        node->whole = true;
+        node->children.clear();
+        ++size_;
+    }
+
+    if ( size_ == 0 ) {
+        throw std::invalid_argument{ "the projection has no paths." };
+    }
+}
+
+std::size_t Asn1Projection::size() const {
+    return size_;
+}
+
+const Asn1Projection::Node* Asn1Projection::find( const Node& node, const char* name ) {
+    for ( const Node& child : node.children ) {
+        if ( child.name == name ) return &child;
+    }
+    return nullptr;
+}
+
+void Asn1Projection::write_json( const asn_TYPE_descriptor_t* td, const void* sptr, asn1_json::Writer& writer ) const {
+    writer.StartObject();
+    writer.Key( td->xml_tag );
+    write_json( root_, td, sptr, writer );
+    writer.EndObject();
+}
+
+void Asn1Projection::write_json( const Node& node, const asn_TYPE_descriptor_t* td, const void* sptr, asn1_json::Writer& w ) const {
+    if ( node.whole ) {
+        asn1_json::write_content( td, sptr, w );
+        return;
+    }
+
+    if ( is_list( td ) ) {
+        // the items are selected by their element name, as in the XER.
+        const Node* item = find( node, item_name( td ) );
+        const asn_anonymous_set_* list = _A_CSET_FROM_VOID( sptr );
+
+        w.StartArray();
+        for ( int i = 0; item && i < list->count; ++i ) {
+            if ( list->array[i] ) write_json( *item, td->elements[0].type, list->array[i], w );
+        }
+        w.EndArray();
+        return;
+    }
+
+    w.StartObject();
+
+    if ( is_choice( td ) ) {
+        unsigned present = CHOICE_variant_get_presence( td, sptr );
+        if ( present > 0 && present <= td->elements_count ) {
+            const asn_TYPE_member_t& elm = td->elements[present - 1];
+            const Node* child = find( node, elm.name );
+            const void* field = member( elm, sptr );
+            if ( child && field ) {
+                w.Key( elm.name );
+                write_json( *child, elm.type, field, w );
+            }
+        }
+    } else {
+        // a SEQUENCE; other types have no members to select, so they are written as empty objects.
+        for ( unsigned i = 0; td->op == &asn_OP_SEQUENCE && i < td->elements_count; ++i ) {
+            const asn_TYPE_member_t& elm = td->elements[i];
+            const Node* child = find( node, elm.name );
+            const void* field = child ? member( elm, sptr ) : nullptr;
+            if ( !field ) continue;
+
+            w.Key( elm.name );
+            write_json( *child, elm.type, field, w );
+        }
+    }
+
+    w.EndObject();
+}
+
+ssize_t Asn1Projection::write_xer( const asn_TYPE_descriptor_t* td, const void* sptr, asn_app_consume_bytes_f* cb, void* key ) const {
+    Sink sink{ cb, key, 0 };
+
+    if ( !sink.tag( td->xml_tag, false ) || !write_xer( root_, td, sptr, sink ) || !sink.tag( td->xml_tag, true ) ) {
+        return -1;
+    }
+
+    return sink.written;
+}
+
+bool Asn1Projection::write_xer( const Node& node, const asn_TYPE_descriptor_t* td, const void* sptr, Sink& sink ) const {
+    if ( node.whole ) {
+        // the type's XER encoder writes the content; the element around it is written by the caller.
+        asn_enc_rval_t rval = td->op->xer_encoder( td, sptr, 1, XER_F_CANONICAL, Sink::count, &sink );
+        return rval.encoded != -1;
+    }
+
+    if ( is_list( td ) ) {
+        const char* name = item_name( td );
+        const Node* item = find( node, name );
+        const asn_anonymous_set_* list = _A_CSET_FROM_VOID( sptr );
+
+        for ( int i = 0; item && i < list->count; ++i ) {
+            if ( !list->array[i] ) continue;
+            if ( !sink.tag( name, false ) || !write_xer( *item, td->elements[0].type, list->array[i], sink ) || !sink.tag( name, true ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if ( is_choice( td ) ) {
+        unsigned present = CHOICE_variant_get_presence( td, sptr );
+        if ( present == 0 || present > td->elements_count ) return true;
+
+        const asn_TYPE_member_t& elm = td->elements[present - 1];
+        const Node* child = find( node, elm.name );
+        const void* field = member( elm, sptr );
+        if ( !child || !field ) return true;
+
+        return sink.tag( elm.name, false ) && write_xer( *child, elm.type, field, sink ) && sink.tag( elm.name, true );
+    }
+
+    for ( unsigned i = 0; td->op == &asn_OP_SEQUENCE && i < td->elements_count; ++i ) {
+        const asn_TYPE_member_t& elm = td->elements[i];
+        const Node* child = find( node, elm.name );
+        const void* field = child ? member( elm, sptr ) : nullptr;
+        if ( !field ) continue;
+
+        if ( !sink.tag( elm.name, false ) || !write_xer( *child, elm.type, field, sink ) || !sink.tag( elm.name, true ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
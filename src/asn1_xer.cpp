@@ -0,0 +1,158 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "asn1_xer.hpp"
+
+#include "constr_SEQUENCE.h"
+#include "constr_CHOICE.h"
+#include "constr_SEQUENCE_OF.h"
+#include "constr_SET_OF.h"
+#include "asn_SET_OF.h"
+#include "OPEN_TYPE.h"
+#include "NativeEnumerated.h"
+#include "BOOLEAN.h"
+
+#include <cstring>
+
+namespace {
+
+    // the members of a structure are either embedded or, for OPTIONAL and recursive members, pointers.
+    const void* member( const asn_TYPE_member_t& elm, const void* sptr )
+    {
+        const void* field = static_cast<const char*>( sptr ) + elm.memb_offset;
+        if ( elm.flags & ATF_POINTER ) {
+            field = *static_cast<const void* const*>( field );
+        }
+        return field;
+    }
+
+    // the > of a start tag is held back until the element has content, so an element without any is closed with />.
+    struct Sink {
+        asn_app_consume_bytes_f* cb;
+        void* key;
+        ssize_t written;
+        bool open;
+
+        bool raw( const char* data, std::size_t size )
+        {
+            if ( cb( data, size, key ) < 0 ) return false;
+            written += static_cast<ssize_t>( size );
+            return true;
+        }
+
+        bool write( const char* data, std::size_t size )
+        {
+            if ( size == 0 ) return true;
+            if ( open ) {
+                open = false;
+                if ( !raw( ">", 1 ) ) return false;
+            }
+            return raw( data, size );
+        }
+
+        bool start( const char* name )
+        {
+            if ( !write( "<", 1 ) || !raw( name, std::strlen( name ) ) ) return false;
+            open = true;
+            return true;
+        }
+
+        bool end( const char* name )
+        {
+            if ( open ) {
+                open = false;
+                return raw( "/>", 2 );
+            }
+            return raw( "</", 2 ) && raw( name, std::strlen( name ) ) && raw( ">", 1 );
+        }
+
+        static int consume( const void* buffer, size_t size, void* key )
+        {
+            return static_cast<Sink*>( key )->write( static_cast<const char*>( buffer ), size ) ? 0 : -1;
+        }
+    };
+
+    bool write_value( const asn_TYPE_descriptor_t* td, const void* sptr, Sink& sink );
+
+    bool write_element( const char* name, const asn_TYPE_descriptor_t* td, const void* sptr, Sink& sink )
+    {
+        return sink.start( name ) && write_value( td, sptr, sink ) && sink.end( name );
+    }
+
+    bool write_value( const asn_TYPE_descriptor_t* td, const void* sptr, Sink& sink )
+    {
+        const asn_TYPE_operation_t* op = td->op;
+
+        if ( op == &asn_OP_SEQUENCE ) {
+            for ( unsigned i = 0; i < td->elements_count; ++i ) {
+                const asn_TYPE_member_t& elm = td->elements[i];
+                const void* field = member( elm, sptr );
+                if ( field && !write_element( elm.name, elm.type, field, sink ) ) return false;
+            }
+            return true;
+        }
+
+        if ( op == &asn_OP_CHOICE || op == &asn_OP_OPEN_TYPE ) {
+            unsigned present = CHOICE_variant_get_presence( td, sptr );
+            if ( present == 0 || present > td->elements_count ) return false;
+
+            const asn_TYPE_member_t& elm = td->elements[present - 1];
+            const void* field = member( elm, sptr );
+            return field && write_element( elm.name, elm.type, field, sink );
+        }
+
+        const asn_SET_OF_specifics_t* list_specs = static_cast<const asn_SET_OF_specifics_t*>( td->specifics );
+        if ( ( op == &asn_OP_SEQUENCE_OF || op == &asn_OP_SET_OF ) && !( list_specs && list_specs->as_XMLValueList ) ) {
+            const asn_TYPE_member_t& elm = td->elements[0];
+            const char* name = ( elm.name && *elm.name ) ? elm.name : elm.type->xml_tag;
+            const asn_anonymous_set_* list = _A_CSET_FROM_VOID( sptr );
+
+            for ( int i = 0; i < list->count; ++i ) {
+                if ( list->array[i] && !write_element( name, elm.type, list->array[i], sink ) ) return false;
+            }
+            return true;
+        }
+
+        if ( op == &asn_OP_NativeEnumerated ) {
+            const asn_INTEGER_specifics_t* specs = static_cast<const asn_INTEGER_specifics_t*>( td->specifics );
+            const asn_INTEGER_enum_map_t* map = specs ? INTEGER_map_value2enum( specs, *static_cast<const long*>( sptr ) ) : nullptr;
+            return map && sink.write( map->enum_name, map->enum_len );
+        }
+
+        if ( op == &asn_OP_BOOLEAN ) {
+            return *static_cast<const BOOLEAN_t*>( sptr ) ? sink.write( "true", 4 ) : sink.write( "false", 5 );
+        }
+
+        // the type's XER encoder writes the content; the element around it is written by the caller.
+        asn_enc_rval_t rval = op->xer_encoder( td, sptr, 1, XER_F_CANONICAL, Sink::consume, &sink );
+        return rval.encoded != -1;
+    }
+}
+
+namespace asn1_xer {
+
+    ssize_t write_compact( const asn_TYPE_descriptor_t* td, const void* sptr, asn_app_consume_bytes_f* cb, void* key )
+    {
+        Sink sink{ cb, key, 0, false };
+        return write_element( td->xml_tag, td, sptr, sink ) ? sink.written : -1;
+    }
+}
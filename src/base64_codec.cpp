@@ -0,0 +1,339 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "base64_codec.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ACM_BASE64_AVX2 1
+#define ACM_BASE64_SSSE3 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define ACM_BASE64_SSSE3 1
+#endif
+
+namespace base64_codec {
+
+namespace {
+
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // 6 bit value of each character; 0xFF marks a character that is not in the alphabet.
+    struct DecodeTable {
+        uint8_t value[256];
+
+        DecodeTable() {
+            for ( int i = 0; i < 256; ++i ) value[i] = 0xFF;
+            for ( int i = 0; i < 64; ++i ) value[ static_cast<uint8_t>( alphabet[i] ) ] = static_cast<uint8_t>( i );
+        }
+    };
+
+    const DecodeTable decode_table;
+
+    void encode_scalar( const uint8_t* in, std::size_t length, char* out )
+    {
+        std::size_t i = 0;
+
+        for ( ; i + 3 <= length; i += 3 ) {
+            uint32_t v = ( static_cast<uint32_t>( in[i] ) << 16 ) | ( static_cast<uint32_t>( in[i+1] ) << 8 ) | in[i+2];
+            *out++ = alphabet[ v >> 18 ];
+            *out++ = alphabet[ ( v >> 12 ) & 0x3F ];
+            *out++ = alphabet[ ( v >> 6 ) & 0x3F ];
+            *out++ = alphabet[ v & 0x3F ];
+        }
+
+        if ( i + 1 == length ) {
+            *out++ = alphabet[ in[i] >> 2 ];
+            *out++ = alphabet[ ( in[i] & 0x03 ) << 4 ];
+            *out++ = '=';
+            *out++ = '=';
+        } else if ( i + 2 == length ) {
+            *out++ = alphabet[ in[i] >> 2 ];
+            *out++ = alphabet[ ( ( in[i] & 0x03 ) << 4 ) | ( in[i+1] >> 4 ) ];
+            *out++ = alphabet[ ( in[i+1] & 0x0F ) << 2 ];
+            *out++ = '=';
+        }
+    }
+
+    // returns npos or the offset (relative to text) of the first bad character; written is the number of bytes.
+    std::size_t decode_scalar( const char* text, std::size_t length, uint8_t* out, std::size_t& written )
+    {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>( text );
+        const uint8_t* value = decode_table.value;
+        uint8_t* start = out;
+        std::size_t i = 0;
+
+        for ( ; i + 4 <= length; i += 4 ) {
+            uint8_t a = value[ in[i] ], b = value[ in[i+1] ], c = value[ in[i+2] ], d = value[ in[i+3] ];
+            if ( ( a | b | c | d ) & 0xC0 ) break;
+            *out++ = static_cast<uint8_t>( ( a << 2 ) | ( b >> 4 ) );
+            *out++ = static_cast<uint8_t>( ( b << 4 ) | ( c >> 2 ) );
+            *out++ = static_cast<uint8_t>( ( c << 6 ) | d );
+        }
+
+        written = out - start;
+
+        // the final group: unpadded, padded, or the group holding a bad character.
+        std::size_t rest = length - i < 4 ? length - i : 4;
+        std::size_t n = 0;
+        while ( n < rest && !( value[ in[i+n] ] & 0xC0 ) ) ++n;
+
+        if ( n < rest ) {
+            // only the final group of four may be padded, and only after two characters.
+            if ( i + 4 != length || n < 2 ) return i + n;
+            for ( std::size_t j = n; j < 4; ++j ) {
+                if ( in[i+j] != '=' ) return i + j;
+            }
+        }
+
+        if ( n == 0 ) return npos;
+        if ( n == 1 ) return i;
+
+        uint8_t a = value[ in[i] ], b = value[ in[i+1] ];
+        *out++ = static_cast<uint8_t>( ( a << 2 ) | ( b >> 4 ) );
+        if ( n == 3 ) {
+            uint8_t c = value[ in[i+2] ];
+            *out++ = static_cast<uint8_t>( ( b << 4 ) | ( c >> 2 ) );
+        }
+
+        written = out - start;
+        return npos;
+    }
+
+#if defined(ACM_BASE64_SSSE3)
+
+    // the shuffles that map between characters and 6 bit values are due to Wojciech Mula and Daniel Lemire.
+
+    // each 32 bit lane (b1, b0, b2, b1) into the four 6 bit values of b0 b1 b2, a byte each.
+    inline __m128i split_ssse3( __m128i v )
+    {
+        __m128i ac = _mm_mulhi_epu16( _mm_and_si128( v, _mm_set1_epi32( 0x0FC0FC00 ) ), _mm_set1_epi32( 0x04000040 ) );
+        __m128i bd = _mm_mullo_epi16( _mm_and_si128( v, _mm_set1_epi32( 0x003F03F0 ) ), _mm_set1_epi32( 0x01000010 ) );
+        return _mm_or_si128( ac, bd );
+    }
+
+    // 6 bit values into characters: the range of a value selects the offset added to it.
+    inline __m128i characters_ssse3( __m128i values )
+    {
+        const __m128i offsets = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+
+        __m128i range = _mm_subs_epu8( values, _mm_set1_epi8( 51 ) );
+        range = _mm_or_si128( range, _mm_and_si128( _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), values ), _mm_set1_epi8( 13 ) ) );
+        return _mm_add_epi8( values, _mm_shuffle_epi8( offsets, range ) );
+    }
+
+    // 12 bytes into 16 characters; 16 bytes are read.
+    inline void encode_ssse3( const uint8_t* in, char* out )
+    {
+        const __m128i order = _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+        __m128i v = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( in ) ), order );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), characters_ssse3( split_ssse3( v ) ) );
+    }
+
+    // characters into 6 bit values; false if any character is not in the alphabet. The low and high nibble of each
+    // character select bit masks that share a bit only for characters outside of the alphabet.
+    inline bool values_ssse3( __m128i& v )
+    {
+        const __m128i lo_masks = _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+        const __m128i hi_masks = _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+        const __m128i offsets = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+        const __m128i nibble = _mm_set1_epi8( 0x0F );
+
+        __m128i hi = _mm_and_si128( _mm_srli_epi32( v, 4 ), nibble );
+        __m128i bad = _mm_and_si128( _mm_shuffle_epi8( lo_masks, _mm_and_si128( v, nibble ) ), _mm_shuffle_epi8( hi_masks, hi ) );
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi8( bad, _mm_setzero_si128() ) ) != 0xFFFF ) return false;
+
+        // '/' shares its high nibble with '+'; it uses the offset before it.
+        __m128i slash = _mm_cmpeq_epi8( v, _mm_set1_epi8( '/' ) );
+        v = _mm_add_epi8( v, _mm_shuffle_epi8( offsets, _mm_add_epi8( slash, hi ) ) );
+        return true;
+    }
+
+    // 16 characters into 12 bytes; false if any character is not in the alphabet.
+    inline bool decode_ssse3( const char* text, uint8_t* out )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text ) );
+        if ( !values_ssse3( v ) ) return false;
+
+        // join the four 6 bit values in each 32 bit lane, then gather the three bytes of each lane in order.
+        v = _mm_madd_epi16( _mm_maddubs_epi16( v, _mm_set1_epi32( 0x01400140 ) ), _mm_set1_epi32( 0x00011000 ) );
+        v = _mm_shuffle_epi8( v, _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( out ), v );
+        uint32_t last = static_cast<uint32_t>( _mm_cvtsi128_si32( _mm_srli_si128( v, 8 ) ) );
+        std::memcpy( out + 8, &last, 4 );
+        return true;
+    }
+
+#endif
+
+#if defined(ACM_BASE64_AVX2)
+
+    inline __m256i split_avx2( __m256i v )
+    {
+        __m256i ac = _mm256_mulhi_epu16( _mm256_and_si256( v, _mm256_set1_epi32( 0x0FC0FC00 ) ), _mm256_set1_epi32( 0x04000040 ) );
+        __m256i bd = _mm256_mullo_epi16( _mm256_and_si256( v, _mm256_set1_epi32( 0x003F03F0 ) ), _mm256_set1_epi32( 0x01000010 ) );
+        return _mm256_or_si256( ac, bd );
+    }
+
+    inline __m256i characters_avx2( __m256i values )
+    {
+        const __m256i offsets = _mm256_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+
+        __m256i range = _mm256_subs_epu8( values, _mm256_set1_epi8( 51 ) );
+        range = _mm256_or_si256( range, _mm256_and_si256( _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), values ), _mm256_set1_epi8( 13 ) ) );
+        return _mm256_add_epi8( values, _mm256_shuffle_epi8( offsets, range ) );
+    }
+
+    // 24 bytes into 32 characters; 28 bytes are read.
+    inline void encode_avx2( const uint8_t* in, char* out )
+    {
+        // the shuffle works within each 128 bit lane, so each lane is loaded with its own 12 bytes.
+        const __m256i order = _mm256_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+        __m256i v = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( in ) ) ),
+            _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + 12 ) ), 1 );
+        v = _mm256_shuffle_epi8( v, order );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out ), characters_avx2( split_avx2( v ) ) );
+    }
+
+    inline bool values_avx2( __m256i& v )
+    {
+        const __m256i lo_masks = _mm256_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+        const __m256i hi_masks = _mm256_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+        const __m256i offsets = _mm256_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 );
+        const __m256i nibble = _mm256_set1_epi8( 0x0F );
+
+        __m256i hi = _mm256_and_si256( _mm256_srli_epi32( v, 4 ), nibble );
+        __m256i lo = _mm256_shuffle_epi8( lo_masks, _mm256_and_si256( v, nibble ) );
+        if ( !_mm256_testz_si256( lo, _mm256_shuffle_epi8( hi_masks, hi ) ) ) return false;
+
+        __m256i slash = _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '/' ) );
+        v = _mm256_add_epi8( v, _mm256_shuffle_epi8( offsets, _mm256_add_epi8( slash, hi ) ) );
+        return true;
+    }
+
+    // 32 characters into 24 bytes.
+    inline bool decode_avx2( const char* text, uint8_t* out )
+    {
+        __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( text ) );
+        if ( !values_avx2( v ) ) return false;
+
+        v = _mm256_madd_epi16( _mm256_maddubs_epi16( v, _mm256_set1_epi32( 0x01400140 ) ), _mm256_set1_epi32( 0x00011000 ) );
+        v = _mm256_shuffle_epi8( v, _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+
+        // the 12 bytes of each lane next to each other.
+        v = _mm256_permutevar8x32_epi32( v, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 3, 7 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), _mm256_castsi256_si128( v ) );
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( out + 16 ), _mm256_extracti128_si256( v, 1 ) );
+        return true;
+    }
+
+#endif
+
+}   // namespace
+
+const char* implementation()
+{
+#if defined(ACM_BASE64_AVX2)
+    return "avx2";
+#elif defined(ACM_BASE64_SSSE3)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+}
+
+void encode( const void* bytes, std::size_t length, char* out )
+{
+    const uint8_t* in = static_cast<const uint8_t*>( bytes );
+    std::size_t i = 0;
+    std::size_t o = 0;
+
+    // the vector paths read past the bytes they encode, so they stop while the block they read is within the input.
+#if defined(ACM_BASE64_AVX2)
+    for ( ; i + 28 <= length; i += 24, o += 32 ) encode_avx2( in + i, out + o );
+#endif
+#if defined(ACM_BASE64_SSSE3)
+    for ( ; i + 16 <= length; i += 12, o += 16 ) encode_ssse3( in + i, out + o );
+#endif
+
+    encode_scalar( in + i, length - i, out + o );
+}
+
+void encode( const void* bytes, std::size_t length, std::string& text )
+{
+    text.resize( encoded_length( length ) );
+    if ( length > 0 ) encode( bytes, length, &text[0] );
+}
+
+std::size_t decode( const char* text, std::size_t length, void* bytes, std::size_t& written )
+{
+    uint8_t* out = static_cast<uint8_t*>( bytes );
+    std::size_t i = 0;
+    std::size_t o = 0;
+
+    // a vector block containing padding or a bad character stops the vector loop; the scalar loop finishes the text and
+    // finds the exact offset.
+#if defined(ACM_BASE64_AVX2)
+    for ( ; i + 32 <= length; i += 32, o += 24 ) {
+        if ( !decode_avx2( text + i, out + o ) ) break;
+    }
+#endif
+#if defined(ACM_BASE64_SSSE3)
+    for ( ; i + 16 <= length; i += 16, o += 12 ) {
+        if ( !decode_ssse3( text + i, out + o ) ) break;
+    }
+#endif
+
+    std::size_t r = decode_scalar( text + i, length - i, out + o, written );
+    written += o;
+    return ( r == npos ) ? npos : i + r;
+}
+
+std::size_t decode( const std::string& text, std::vector<char>& bytes )
+{
+    bytes.resize( decoded_length( text.size() ) );
+    std::size_t written = 0;
+    std::size_t r = text.empty() ? npos : decode( text.data(), text.size(), bytes.data(), written );
+    bytes.resize( written );
+    return r;
+}
+
+}   // namespace base64_codec
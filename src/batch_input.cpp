@@ -0,0 +1,206 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "batch_input.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+BatchInput::Framing BatchInput::parse_framing( const std::string& name )
+{
+    if ( name == "lines" ) return Framing::LINES;
+    if ( name == "length" ) return Framing::LENGTH;
+    if ( name == "timed" ) return Framing::TIMED;
+    throw std::invalid_argument( "unknown batch framing: " + name );
+}
+
+void BatchInput::append_timed( std::string& out, int64_t timestamp, int32_t partition, const void* data, std::size_t length )
+{
+    uint64_t t = static_cast<uint64_t>( timestamp );
+    uint32_t p = static_cast<uint32_t>( partition );
+    uint32_t n = static_cast<uint32_t>( length );
+
+    for ( int shift = 56; shift >= 0; shift -= 8 ) out.push_back( static_cast<char>( t >> shift ) );
+    for ( int shift = 24; shift >= 0; shift -= 8 ) out.push_back( static_cast<char>( p >> shift ) );
+    for ( int shift = 24; shift >= 0; shift -= 8 ) out.push_back( static_cast<char>( n >> shift ) );
+    out.append( static_cast<const char*>( data ), length );
+}
+
+BatchInput::BatchInput( Framing framing ) :
+    framing_{ framing }
+    , data_{ nullptr }
+    , size_{ 0 }
+    , pos_{ 0 }
+    , mapped_{ false }
+    , truncated_{ false }
+    , buffer_{}
+{}
+
+BatchInput::~BatchInput()
+{
+    close();
+}
+
+bool BatchInput::open( const std::string& path )
+{
+    close();
+
+    if ( path == "-" ) {
+        char block[65536];
+        std::size_t n;
+        while ( ( n = std::fread( block, 1, sizeof( block ), stdin ) ) > 0 ) {
+            buffer_.insert( buffer_.end(), block, block + n );
+        }
+        if ( std::ferror( stdin ) ) return false;
+
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        return true;
+    }
+
+    int fd = ::open( path.c_str(), O_RDONLY );
+    if ( fd < 0 ) return false;
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 ) {
+        int e = errno;
+        ::close( fd );
+        errno = e;
+        return false;
+    }
+
+    size_ = static_cast<std::size_t>( info.st_size );
+    if ( size_ > 0 ) {
+        void* p = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( p == MAP_FAILED ) {
+            int e = errno;
+            ::close( fd );
+            size_ = 0;
+            errno = e;
+            return false;
+        }
+
+        // the records are read once, front to back.
+        madvise( p, size_, MADV_SEQUENTIAL );
+        data_ = static_cast<const uint8_t*>( p );
+        mapped_ = true;
+    }
+
+    // the mapping holds its own reference to the file.
+    ::close( fd );
+    return true;
+}
+
+void BatchInput::assign( const uint8_t* data, std::size_t length )
+{
+    close();
+    data_ = data;
+    size_ = length;
+}
+
+void BatchInput::close()
+{
+    if ( mapped_ ) munmap( const_cast<uint8_t*>( data_ ), size_ );
+
+    data_ = nullptr;
+    size_ = 0;
+    pos_ = 0;
+    mapped_ = false;
+    truncated_ = false;
+    buffer_.clear();
+}
+
+bool BatchInput::next( Record& record )
+{
+    record.timestamp = 0;
+    record.partition = -1;
+
+    if ( framing_ != Framing::LINES ) {
+        // a timed frame's header ends with the length.
+        std::size_t header = framing_ == Framing::TIMED ? 16 : 4;
+
+        if ( pos_ == size_ ) return false;
+
+        if ( size_ - pos_ < header ) {
+            truncated_ = true;
+            return false;
+        }
+
+        const uint8_t* p = data_ + pos_;
+        if ( framing_ == Framing::TIMED ) {
+            uint64_t t = 0;
+            for ( int i = 0; i < 8; ++i ) t = t << 8 | p[i];
+            record.timestamp = static_cast<int64_t>( t );
+            record.partition = static_cast<int32_t>( ( uint32_t{ p[8] } << 24 ) | ( uint32_t{ p[9] } << 16 ) | ( uint32_t{ p[10] } << 8 ) | p[11] );
+            p += 12;
+        }
+
+        std::size_t length = ( std::size_t{ p[0] } << 24 ) | ( std::size_t{ p[1] } << 16 ) | ( std::size_t{ p[2] } << 8 ) | p[3];
+        if ( size_ - pos_ - header < length ) {
+            truncated_ = true;
+            return false;
+        }
+
+        record.data = p + 4;
+        record.length = length;
+        pos_ += header + length;
+        return true;
+    }
+
+    while ( pos_ < size_ ) {
+        const uint8_t* start = data_ + pos_;
+        const uint8_t* end = static_cast<const uint8_t*>( std::memchr( start, '\n', size_ - pos_ ) );
+        std::size_t length = end ? static_cast<std::size_t>( end - start ) : size_ - pos_;
+
+        pos_ += end ? length + 1 : length;
+
+        if ( length > 0 && start[length - 1] == '\r' ) --length;
+        if ( length == 0 ) continue;
+
+        record.data = start;
+        record.length = length;
+        return true;
+    }
+
+    return false;
+}
+
+bool BatchInput::truncated() const
+{
+    return truncated_;
+}
+
+std::size_t BatchInput::size() const
+{
+    return size_;
+}
+
+std::size_t BatchInput::position() const
+{
+    return pos_;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "batch_tuner.hpp"
+
+#include <algorithm>
+
+BatchTuner::BatchTuner( uint64_t target_p99, const Settings& max ) :
+    target_{ target_p99 }
+    , max_( max )
+    , latencies_{}
+    , snapshot_{}
+    , batches_{ 0 }
+    , full_batches_{ 0 }
+    , backlog_{ 0 }
+    , last_p99_{ 0 }
+{
+    max_.batch_size = std::max<std::size_t>( max_.batch_size, 1 );
+    max_.batch_timeout = std::max( max_.batch_timeout, 0 );
+}
+
+void BatchTuner::record( uint64_t ns )
+{
+    latencies_.record( ns );
+}
+
+void BatchTuner::consumed( bool full, std::size_t backlog )
+{
+    ++batches_;
+    if ( full ) ++full_batches_;
+    backlog_ += backlog;
+}
+
+bool BatchTuner::adjust( Settings& settings )
+{
+    latencies_.take( snapshot_ );
+
+    std::size_t batches = batches_;
+    std::size_t full_batches = full_batches_;
+    std::size_t backlog = batches ? backlog_ / batches : 0;
+    batches_ = full_batches_ = backlog_ = 0;
+
+    if ( snapshot_.count == 0 ) return false;
+
+    last_p99_ = snapshot_.percentile( 0.99 );
+    Settings before = settings;
+
+    if ( last_p99_ > target_ ) {
+        settings.batch_timeout /= 2;
+        if ( backlog < settings.batch_size ) {
+            settings.batch_size = std::max<std::size_t>( settings.batch_size / 2, 1 );
+        }
+    } else if ( last_p99_ < target_ / 4 * 3 && full_batches * 2 >= batches ) {
+        settings.batch_size = std::min( settings.batch_size + std::max<std::size_t>( settings.batch_size / 4, 1 ), max_.batch_size );
+
+        // half of the target, in milliseconds.
+        int limit = static_cast<int>( std::min<uint64_t>( max_.batch_timeout, target_ / 2000000 ) );
+        if ( settings.batch_timeout < limit ) {
+            settings.batch_timeout = std::min( settings.batch_timeout + std::max( settings.batch_timeout / 4, 1 ), limit );
+        }
+    }
+
+    return settings.batch_size != before.batch_size || settings.batch_timeout != before.batch_timeout;
+}
+
+uint64_t BatchTuner::last_p99() const
+{
+    return last_p99_;
+}
+
+uint64_t BatchTuner::target_p99() const
+{
+    return target_;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "bsm_archive.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#ifdef ACM_PARQUET
+#include <arrow/api.h>
+#include <arrow/filesystem/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#endif
+
+namespace {
+
+    // the bits of a BIT STRING as an integer, its first bit highest; missing bits are 0.
+    uint32_t bit_value( const BIT_STRING_t& bits, unsigned n ) {
+        uint32_t value = 0;
+        std::size_t present = bits.size * 8 - static_cast<std::size_t>( bits.bits_unused );
+        for ( unsigned i = 0; i < n; ++i ) {
+            value <<= 1;
+            if ( i < present ) value |= ( bits.buf[i / 8] >> ( 7 - i % 8 ) ) & 1;
+        }
+        return value;
+    }
+
+    std::string utc_stamp( std::chrono::system_clock::time_point when ) {
+        std::time_t t = std::chrono::system_clock::to_time_t( when );
+        struct tm utc;
+        gmtime_r( &t, &utc );
+        char stamp[32];
+        std::strftime( stamp, sizeof( stamp ), "%Y%m%dT%H%M%SZ", &utc );
+        return stamp;
+    }
+}
+
+bool BsmArchive::core_data( const MessageFrame_t* frame, bsm_fast_path::Bsm& bsm ) {
+    if ( !frame || frame->value.present != MessageFrame__value_PR_BasicSafetyMessage ) return false;
+
+    const BSMcoreData_t& core = frame->value.choice.BasicSafetyMessage.coreData;
+    if ( core.id.size != sizeof( bsm.id ) ) return false;
+
+    bsm.msg_cnt = static_cast<uint8_t>( core.msgCnt );
+    std::memcpy( bsm.id, core.id.buf, sizeof( bsm.id ) );
+    bsm.sec_mark = static_cast<uint16_t>( core.secMark );
+    bsm.lat = static_cast<int32_t>( core.lat );
+    bsm.lon = static_cast<int32_t>( core.Long );
+    bsm.elev = static_cast<int32_t>( core.elev );
+    bsm.accuracy.semi_major = static_cast<uint8_t>( core.accuracy.semiMajor );
+    bsm.accuracy.semi_minor = static_cast<uint8_t>( core.accuracy.semiMinor );
+    bsm.accuracy.orientation = static_cast<uint16_t>( core.accuracy.orientation );
+    bsm.transmission = static_cast<uint8_t>( core.transmission );
+    bsm.speed = static_cast<uint16_t>( core.speed );
+    bsm.heading = static_cast<uint16_t>( core.heading );
+    bsm.angle = static_cast<int16_t>( core.angle );
+    bsm.accel_long = static_cast<int16_t>( core.accelSet.Long );
+    bsm.accel_lat = static_cast<int16_t>( core.accelSet.lat );
+    bsm.accel_vert = static_cast<int16_t>( core.accelSet.vert );
+    bsm.accel_yaw = static_cast<int16_t>( core.accelSet.yaw );
+    bsm.wheel_brakes = static_cast<uint8_t>( bit_value( core.brakes.wheelBrakes, 5 ) );
+    bsm.traction = static_cast<uint8_t>( core.brakes.traction );
+    bsm.abs = static_cast<uint8_t>( core.brakes.abs );
+    bsm.scs = static_cast<uint8_t>( core.brakes.scs );
+    bsm.brake_boost = static_cast<uint8_t>( core.brakes.brakeBoost );
+    bsm.aux_brakes = static_cast<uint8_t>( core.brakes.auxBrakes );
+    bsm.width = static_cast<uint16_t>( core.size.width );
+    bsm.length = static_cast<uint16_t>( core.size.length );
+    return true;
+}
+
+#ifdef ACM_PARQUET
+
+namespace {
+
+    void check( const arrow::Status& status ) {
+        if ( !status.ok() ) throw std::runtime_error{ status.ToString() };
+    }
+
+    template <typename T>
+    T check( arrow::Result<T> result ) {
+        check( result.status() );
+        return std::move( result ).ValueUnsafe();
+    }
+}
+
+struct BsmArchive::Writer {
+    std::shared_ptr<arrow::Schema> schema;
+    std::shared_ptr<parquet::WriterProperties> properties;
+    std::shared_ptr<arrow::fs::FileSystem> fs;
+    std::string directory;
+
+    // the columns of the record batch being filled, in schema order.
+    arrow::TimestampBuilder decoded_at{ arrow::timestamp( arrow::TimeUnit::MILLI, "UTC" ), arrow::default_memory_pool() };
+    arrow::UInt8Builder msg_cnt;
+    arrow::FixedSizeBinaryBuilder id{ arrow::fixed_size_binary( 4 ) };
+    arrow::UInt16Builder sec_mark;
+    arrow::Int32Builder lat, lon, elev;
+    arrow::UInt8Builder semi_major, semi_minor;
+    arrow::UInt16Builder orientation;
+    arrow::UInt8Builder transmission;
+    arrow::UInt16Builder speed, heading;
+    arrow::Int16Builder angle, accel_long, accel_lat, accel_vert, accel_yaw;
+    arrow::UInt8Builder wheel_brakes, traction, abs, scs, brake_boost, aux_brakes;
+    arrow::UInt16Builder width, length;
+    int64_t buffered = 0;
+
+    // the open file; written under a hidden name until it is closed.
+    std::shared_ptr<arrow::io::OutputStream> out;
+    std::unique_ptr<parquet::arrow::FileWriter> file;
+    std::string path;
+    std::string hidden_path;
+    std::chrono::steady_clock::time_point opened;
+
+    std::vector<arrow::ArrayBuilder*> builders() {
+        return { &decoded_at, &msg_cnt, &id, &sec_mark, &lat, &lon, &elev, &semi_major, &semi_minor, &orientation,
+            &transmission, &speed, &heading, &angle, &accel_long, &accel_lat, &accel_vert, &accel_yaw, &wheel_brakes,
+            &traction, &abs, &scs, &brake_boost, &aux_brakes, &width, &length };
+    }
+
+    void append( const bsm_fast_path::Bsm& bsm, int64_t now_ms ) {
+        check( decoded_at.Append( now_ms ) );
+        check( msg_cnt.Append( bsm.msg_cnt ) );
+        check( id.Append( bsm.id ) );
+        check( sec_mark.Append( bsm.sec_mark ) );
+        check( lat.Append( bsm.lat ) );
+        check( lon.Append( bsm.lon ) );
+        check( elev.Append( bsm.elev ) );
+        check( semi_major.Append( bsm.accuracy.semi_major ) );
+        check( semi_minor.Append( bsm.accuracy.semi_minor ) );
+        check( orientation.Append( bsm.accuracy.orientation ) );
+        check( transmission.Append( bsm.transmission ) );
+        check( speed.Append( bsm.speed ) );
+        check( heading.Append( bsm.heading ) );
+        check( angle.Append( bsm.angle ) );
+        check( accel_long.Append( bsm.accel_long ) );
+        check( accel_lat.Append( bsm.accel_lat ) );
+        check( accel_vert.Append( bsm.accel_vert ) );
+        check( accel_yaw.Append( bsm.accel_yaw ) );
+        check( wheel_brakes.Append( bsm.wheel_brakes ) );
+        check( traction.Append( bsm.traction ) );
+        check( abs.Append( bsm.abs ) );
+        check( scs.Append( bsm.scs ) );
+        check( brake_boost.Append( bsm.brake_boost ) );
+        check( aux_brakes.Append( bsm.aux_brakes ) );
+        check( width.Append( bsm.width ) );
+        check( length.Append( bsm.length ) );
+        ++buffered;
+    }
+
+    void open( const std::string& name ) {
+        // numbered across the archives of the process, so a rebuilt archive never reuses a name.
+        static std::atomic<uint64_t> sequence{ 0 };
+        std::string base = "bsm-" + name + '-' + utc_stamp( std::chrono::system_clock::now() ) + '-' + std::to_string( ++sequence ) + ".parquet";
+        path = directory + '/' + base;
+        hidden_path = directory + "/." + base;
+        out = check( fs->OpenOutputStream( hidden_path ) );
+        file = check( parquet::arrow::FileWriter::Open( *schema, arrow::default_memory_pool(), out, properties ) );
+        opened = std::chrono::steady_clock::now();
+    }
+
+    // the buffered rows become one record batch and one row group.
+    void write_batch() {
+        std::vector<std::shared_ptr<arrow::Array>> columns;
+        for ( arrow::ArrayBuilder* builder : builders() ) {
+            std::shared_ptr<arrow::Array> column;
+            check( builder->Finish( &column ) );
+            columns.push_back( column );
+        }
+
+        std::shared_ptr<arrow::RecordBatch> batch = arrow::RecordBatch::Make( schema, buffered, columns );
+        buffered = 0;
+        std::shared_ptr<arrow::Table> table = check( arrow::Table::FromRecordBatches( schema, { batch } ) );
+        check( file->WriteTable( *table, batch->num_rows() ) );
+    }
+
+    void close() {
+        check( file->Close() );
+        check( out->Close() );
+        file.reset();
+        out.reset();
+        check( fs->Move( hidden_path, path ) );
+    }
+
+    void drop() {
+        for ( arrow::ArrayBuilder* builder : builders() ) builder->Reset();
+        buffered = 0;
+        if ( file ) {
+            file.reset();
+            if ( out ) static_cast<void>( out->Close() );
+            out.reset();
+            static_cast<void>( fs->DeleteFile( hidden_path ) );
+        }
+    }
+};
+
+bool BsmArchive::available() {
+    return true;
+}
+
+BsmArchive::BsmArchive( const Settings& settings, const std::string& name, std::shared_ptr<spdlog::logger> elogger ) :
+    settings_{ settings }
+    , name_{ name }
+    , elogger_{ elogger }
+    , writer_{ new Writer }
+    , rows_{ 0 }
+    , files_{ 0 }
+    , failures_{ 0 }
+{
+    writer_->schema = arrow::schema( {
+            arrow::field( "decoded_at", arrow::timestamp( arrow::TimeUnit::MILLI, "UTC" ), false ),
+            arrow::field( "msg_cnt", arrow::uint8(), false ),
+            arrow::field( "id", arrow::fixed_size_binary( 4 ), false ),
+            arrow::field( "sec_mark", arrow::uint16(), false ),
+            arrow::field( "lat", arrow::int32(), false ),
+            arrow::field( "lon", arrow::int32(), false ),
+            arrow::field( "elev", arrow::int32(), false ),
+            arrow::field( "semi_major", arrow::uint8(), false ),
+            arrow::field( "semi_minor", arrow::uint8(), false ),
+            arrow::field( "orientation", arrow::uint16(), false ),
+            arrow::field( "transmission", arrow::uint8(), false ),
+            arrow::field( "speed", arrow::uint16(), false ),
+            arrow::field( "heading", arrow::uint16(), false ),
+            arrow::field( "angle", arrow::int16(), false ),
+            arrow::field( "accel_long", arrow::int16(), false ),
+            arrow::field( "accel_lat", arrow::int16(), false ),
+            arrow::field( "accel_vert", arrow::int16(), false ),
+            arrow::field( "accel_yaw", arrow::int16(), false ),
+            arrow::field( "wheel_brakes", arrow::uint8(), false ),
+            arrow::field( "traction", arrow::uint8(), false ),
+            arrow::field( "abs", arrow::uint8(), false ),
+            arrow::field( "scs", arrow::uint8(), false ),
+            arrow::field( "brake_boost", arrow::uint8(), false ),
+            arrow::field( "aux_brakes", arrow::uint8(), false ),
+            arrow::field( "width", arrow::uint16(), false ),
+            arrow::field( "length", arrow::uint16(), false )
+        } );
+
+    arrow::Compression::type codec;
+    if ( settings_.compression == "zstd" ) codec = arrow::Compression::ZSTD;
+    else if ( settings_.compression == "snappy" ) codec = arrow::Compression::SNAPPY;
+    else if ( settings_.compression == "gzip" ) codec = arrow::Compression::GZIP;
+    else if ( settings_.compression == "none" ) codec = arrow::Compression::UNCOMPRESSED;
+    else throw std::runtime_error{ "unknown archive compression: " + settings_.compression };
+
+    writer_->properties = parquet::WriterProperties::Builder().compression( codec )->build();
+    writer_->fs = check( arrow::fs::FileSystemFromUriOrPath( settings_.uri, &writer_->directory ) );
+    check( writer_->fs->CreateDir( writer_->directory, true ) );
+}
+
+BsmArchive::~BsmArchive() {
+    close();
+}
+
+void BsmArchive::append( const bsm_fast_path::Bsm& bsm ) {
+    static const char* fnname = "BsmArchive::append()";
+
+    try {
+        // the file is opened with its first row, so its age counts from then.
+        if ( !writer_->file ) writer_->open( name_ );
+
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+        writer_->append( bsm, now_ms );
+        ++rows_;
+
+        if ( writer_->buffered >= static_cast<int64_t>( settings_.row_group ) ) writer_->write_batch();
+
+        if ( writer_->file && ( static_cast<std::size_t>( check( writer_->out->Tell() ) ) >= settings_.max_bytes
+                    || std::chrono::steady_clock::now() - writer_->opened >= std::chrono::seconds( settings_.max_seconds ) ) ) {
+            close();
+        }
+
+    } catch ( const std::exception& e ) {
+        ++failures_;
+        if ( elogger_ ) elogger_->error("{}: the rows of {} were dropped: {}", fnname, name_, e.what() );
+        writer_->drop();
+    }
+}
+
+void BsmArchive::close() {
+    static const char* fnname = "BsmArchive::close()";
+
+    try {
+        if ( writer_->file ) {
+            if ( writer_->buffered > 0 ) writer_->write_batch();
+            writer_->close();
+            ++files_;
+        }
+
+    } catch ( const std::exception& e ) {
+        ++failures_;
+        if ( elogger_ ) elogger_->error("{}: cannot close the archive file of {}: {}", fnname, name_, e.what() );
+        writer_->drop();
+    }
+}
+
+#else
+
+struct BsmArchive::Writer {};
+
+bool BsmArchive::available() {
+    return false;
+}
+
+BsmArchive::BsmArchive( const Settings& settings, const std::string& name, std::shared_ptr<spdlog::logger> elogger ) :
+    settings_{ settings }
+    , name_{ name }
+    , elogger_{ elogger }
+    , writer_{}
+    , rows_{ 0 }
+    , files_{ 0 }
+    , failures_{ 0 }
+{
+    throw std::runtime_error{ "the ACM is built without Parquet support; cmake -DACM_PARQUET=ON" };
+}
+
+BsmArchive::~BsmArchive() {}
+
+void BsmArchive::append( const bsm_fast_path::Bsm& ) {}
+
+void BsmArchive::close() {}
+
+#endif
+
+uint64_t BsmArchive::rows() const {
+    return rows_;
+}
+
+uint64_t BsmArchive::files() const {
+    return files_;
+}
+
+uint64_t BsmArchive::failures() const {
+    return failures_;
+}
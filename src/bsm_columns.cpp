@@ -0,0 +1,203 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "bsm_columns.hpp"
+#include "bsm_archive.hpp"
+#include "MessageFrame.h"
+
+#include <cstring>
+
+namespace {
+
+    /**
+     * @brief The bytes of a column of capacity elements of size bytes, rounded up to the alignment.
+     */
+    std::size_t column_bytes( std::size_t capacity, std::size_t size ) {
+        return ( capacity * size + BsmColumns::alignment - 1 ) / BsmColumns::alignment * BsmColumns::alignment;
+    }
+
+    template <typename T>
+    T* place( unsigned char*& at, std::size_t capacity ) {
+        T* column = reinterpret_cast<T*>( at );
+        at += column_bytes( capacity, sizeof( T ) );
+        return column;
+    }
+
+    template <typename T>
+    void move_column( T* to, const T* from, std::size_t rows ) {
+        if ( rows ) std::memcpy( to, from, rows * sizeof( T ) );
+    }
+}
+
+constexpr std::size_t BsmColumns::alignment;
+
+BsmColumns::BsmColumns( std::size_t capacity ) :
+    size_{ 0 }
+    , capacity_{ 0 }
+    , block_{}
+    , input_{ nullptr }
+    , id_{ nullptr }
+    , sec_mark_{ nullptr }
+    , lat_{ nullptr }
+    , lon_{ nullptr }
+    , elev_{ nullptr }
+    , speed_{ nullptr }
+    , heading_{ nullptr }
+    , accel_{ nullptr }
+    , bsm_{}
+{
+    reserve( capacity );
+}
+
+std::size_t BsmColumns::decode( const void* const* payloads, const std::size_t* lengths, std::size_t count ) {
+    clear();
+    reserve( count );
+
+    for ( std::size_t i = 0; i < count; ++i ) {
+        if ( payloads[i] && decode_core( payloads[i], lengths[i], bsm_ ) ) append( bsm_, static_cast<uint32_t>( i ) );
+    }
+
+    return size_;
+}
+
+void BsmColumns::append( const bsm_fast_path::Bsm& bsm, uint32_t input ) {
+    if ( size_ == capacity_ ) reserve( capacity_ ? 2 * capacity_ : 64 );
+
+    input_[size_] = input;
+    id_[size_] = id_value( bsm );
+    sec_mark_[size_] = bsm.sec_mark;
+    lat_[size_] = bsm.lat;
+    lon_[size_] = bsm.lon;
+    elev_[size_] = bsm.elev;
+    speed_[size_] = bsm.speed;
+    heading_[size_] = bsm.heading;
+    accel_[size_] = bsm.accel_long;
+    ++size_;
+}
+
+void BsmColumns::reserve( std::size_t capacity ) {
+    if ( capacity <= capacity_ ) return;
+
+    std::size_t bytes = 5 * column_bytes( capacity, sizeof( uint32_t ) ) + 4 * column_bytes( capacity, sizeof( uint16_t ) );
+    std::unique_ptr<unsigned char[]> block{ new unsigned char[ bytes + alignment ] };
+
+    unsigned char* at = block.get();
+    at += ( alignment - reinterpret_cast<std::uintptr_t>( at ) % alignment ) % alignment;
+
+    // the widest columns first; each column's bytes are a multiple of the alignment, so every one starts aligned.
+    uint32_t* input = place<uint32_t>( at, capacity );
+    uint32_t* id = place<uint32_t>( at, capacity );
+    int32_t* lat = place<int32_t>( at, capacity );
+    int32_t* lon = place<int32_t>( at, capacity );
+    int32_t* elev = place<int32_t>( at, capacity );
+    uint16_t* sec_mark = place<uint16_t>( at, capacity );
+    uint16_t* speed = place<uint16_t>( at, capacity );
+    uint16_t* heading = place<uint16_t>( at, capacity );
+    int16_t* accel = place<int16_t>( at, capacity );
+
+    move_column( input, input_, size_ );
+    move_column( id, id_, size_ );
+    move_column( lat, lat_, size_ );
+    move_column( lon, lon_, size_ );
+    move_column( elev, elev_, size_ );
+    move_column( sec_mark, sec_mark_, size_ );
+    move_column( speed, speed_, size_ );
+    move_column( heading, heading_, size_ );
+    move_column( accel, accel_, size_ );
+
+    input_ = input;
+    id_ = id;
+    lat_ = lat;
+    lon_ = lon;
+    elev_ = elev;
+    sec_mark_ = sec_mark;
+    speed_ = speed;
+    heading_ = heading;
+    accel_ = accel;
+    block_ = std::move( block );
+    capacity_ = capacity;
+}
+
+void BsmColumns::clear() {
+    size_ = 0;
+}
+
+std::size_t BsmColumns::size() const {
+    return size_;
+}
+
+std::size_t BsmColumns::capacity() const {
+    return capacity_;
+}
+
+const uint32_t* BsmColumns::input() const {
+    return input_;
+}
+
+const uint32_t* BsmColumns::id() const {
+    return id_;
+}
+
+const uint16_t* BsmColumns::sec_mark() const {
+    return sec_mark_;
+}
+
+const int32_t* BsmColumns::lat() const {
+    return lat_;
+}
+
+const int32_t* BsmColumns::lon() const {
+    return lon_;
+}
+
+const int32_t* BsmColumns::elev() const {
+    return elev_;
+}
+
+const uint16_t* BsmColumns::speed() const {
+    return speed_;
+}
+
+const uint16_t* BsmColumns::heading() const {
+    return heading_;
+}
+
+const int16_t* BsmColumns::accel() const {
+    return accel_;
+}
+
+bool BsmColumns::decode_core( const void* bytes, std::size_t length, bsm_fast_path::Bsm& bsm ) {
+    if ( bsm_fast_path::decode( bytes, length, bsm ) ) return true;
+
+    // the frames the fast path leaves, e.g., with other Part II content, are decoded in full.
+    MessageFrame_t* frame = nullptr;
+    asn_dec_rval_t rval = asn_decode( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MessageFrame, (void **)&frame, bytes, length );
+    bool core = rval.code == RC_OK && BsmArchive::core_data( frame, bsm );
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+    return core;
+}
+
+uint32_t BsmColumns::id_value( const bsm_fast_path::Bsm& bsm ) {
+    return static_cast<uint32_t>( bsm.id[0] ) << 24 | static_cast<uint32_t>( bsm.id[1] ) << 16
+        | static_cast<uint32_t>( bsm.id[2] ) << 8 | bsm.id[3];
+}
@@ -0,0 +1,86 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "bsm_deduplicator.hpp"
+
+#include <algorithm>
+
+BsmDeduplicator::BsmDeduplicator( uint32_t window_ms, std::size_t capacity ) :
+    slice_{ std::max<uint64_t>( 1, ( static_cast<uint64_t>( window_ms ) + bucket_count - 2 ) / ( bucket_count - 1 ) ) }
+    , mask_{ 0 }
+    , shards_{ new Shard[ shard_count ] }
+{
+    std::size_t slots = max_probes;
+    while ( slots * shard_count * bucket_count < capacity ) slots <<= 1;
+    mask_ = slots - 1;
+
+    for ( std::size_t i = 0; i < shard_count; ++i ) {
+        std::fill( shards_[i].slices, shards_[i].slices + bucket_count, 0 );
+        shards_[i].keys.assign( slots * bucket_count, 0 );
+    }
+}
+
+BsmFilter::Verdict BsmDeduplicator::test( const bsm_fast_path::Bsm& bsm ) {
+    return test( bsm_filter::vehicle_id( bsm ), bsm.msg_cnt, bsm.sec_mark, bsm_filter::steady_ms() );
+}
+
+BsmFilter::Verdict BsmDeduplicator::test( uint32_t id, uint8_t msg_cnt, uint16_t sec_mark, uint64_t now_ms ) {
+    // 56 bits, and 1 more so no key is 0.
+    uint64_t key = ( static_cast<uint64_t>( id ) << 24 | static_cast<uint64_t>( msg_cnt ) << 16 | sec_mark ) + 1;
+    Shard& shard = shards_[ bsm_filter::shard_of<shard_count>( key ) ];
+    std::size_t first = static_cast<std::size_t>( bsm_filter::spread( key ) >> 28 );
+
+    // slices start at 1, so the 0 of an unused bucket is never live.
+    uint64_t slice = now_ms / slice_ + 1;
+    std::size_t current = static_cast<std::size_t>( slice % bucket_count );
+    std::size_t slots = mask_ + 1;
+
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+
+    // a time behind the bucket's slice uses the newer bucket.
+    if ( shard.slices[current] < slice ) {
+        std::fill( shard.keys.begin() + current * slots, shard.keys.begin() + ( current + 1 ) * slots, 0 );
+        shard.slices[current] = slice;
+    }
+
+    for ( std::size_t b = 0; b < bucket_count; ++b ) {
+        if ( shard.slices[b] + bucket_count <= slice ) continue;
+
+        const uint64_t* bucket = shard.keys.data() + b * slots;
+        for ( std::size_t i = 0; i < max_probes; ++i ) {
+            uint64_t k = bucket[ ( first + i ) & mask_ ];
+            if ( k == key ) return Verdict::DROP;
+            if ( k == 0 ) break;
+        }
+    }
+
+    uint64_t* bucket = shard.keys.data() + current * slots;
+    std::size_t i = 0;
+    while ( i < max_probes && bucket[ ( first + i ) & mask_ ] != 0 ) ++i;
+    bucket[ ( first + ( i < max_probes ? i : 0 ) ) & mask_ ] = key;
+
+    return Verdict::PASS;
+}
+
+std::size_t BsmDeduplicator::capacity() const {
+    return shard_count * bucket_count * ( mask_ + 1 );
+}
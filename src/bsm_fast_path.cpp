@@ -0,0 +1,401 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "bsm_fast_path.hpp"
+
+#include <cstring>
+
+namespace {
+
+    /**
+     * Reads an unaligned PER bit stream, most significant bit first, from 64-bit big-endian words: a field is one shift
+     * and mask of the word holding it, whatever its alignment. Reading past the end returns zeros and sets failed; the
+     * decoder checks it before it accepts a value.
+     *
+     * Only the BSM fast path reads with it. Every other UPER decode, including the TIMs and MAPs and the BSMs the fast
+     * path hands back, still reads its bits with asn1c's per_get_few_bits, which is in the asn1c skeletons and not in
+     * this tree.
+     */
+    class FastPathBitReader {
+
+        public:
+
+            FastPathBitReader( const uint8_t* data, std::size_t length ) :
+                data_{ data }
+                , length_{ length }
+                , bits_{ length * 8 }
+                , position_{ 0 }
+                , failed_{ false }
+            {}
+
+            // 1 to 32 bits; with at most 7 bits of offset the field always lies within the word at its first byte.
+            uint32_t read( unsigned n ) {
+                if ( n > bits_ - position_ ) {
+                    failed_ = true;
+                    position_ = bits_;
+                    return 0;
+                }
+
+                uint64_t word = load( position_ >> 3 ) << ( position_ & 7 );
+                position_ += n;
+                return static_cast<uint32_t>( word >> ( 64 - n ) );
+            }
+            std::size_t position() const { return position_; }
+            std::size_t remaining() const { return bits_ - position_; }
+            void seek( std::size_t position ) { position_ = position; }
+            bool failed() const { return failed_; }
+
+        private:
+
+            const uint8_t* data_;
+            std::size_t length_;
+            std::size_t bits_;
+            std::size_t position_;
+            bool failed_;
+
+            // the 8 bytes from offset; those past the end of the data are zero.
+            uint64_t load( std::size_t offset ) const {
+                uint64_t word = 0;
+                if ( offset + 8 <= length_ ) {
+                    std::memcpy( &word, data_ + offset, 8 );
+                    return big_endian( word );
+                }
+
+                for ( std::size_t i = 0; i < 8; ++i ) {
+                    word = word << 8 | ( offset + i < length_ ? data_[ offset + i ] : 0 );
+                }
+                return word;
+            }
+
+            static uint64_t big_endian( uint64_t word ) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return word;
+#elif defined(__GNUC__)
+                return __builtin_bswap64( word );
+#else
+                word = ( word & 0x00000000FFFFFFFFull ) << 32 | ( word & 0xFFFFFFFF00000000ull ) >> 32;
+                word = ( word & 0x0000FFFF0000FFFFull ) << 16 | ( word & 0xFFFF0000FFFF0000ull ) >> 16;
+                return ( word & 0x00FF00FF00FF00FFull ) << 8 | ( word & 0xFF00FF00FF00FF00ull ) >> 8;
+#endif
+            }
+    };
+
+    // a constrained whole number lo..hi in n bits; false when it is outside the constraint.
+    template <typename T>
+    bool constrained( FastPathBitReader& in, unsigned n, int64_t lo, int64_t hi, T& out ) {
+        int64_t value = lo + static_cast<int64_t>( in.read( n ) );
+        out = static_cast<T>( value );
+        return value <= hi;
+    }
+
+    // the start of an open type: its length in bytes; asn1c handles the fragmented lengths of 16K and more.
+    bool open_type( FastPathBitReader& in, std::size_t& bytes, std::size_t& start ) {
+        if ( in.read( 1 ) == 0 ) {
+            bytes = in.read( 7 );
+        } else if ( in.read( 1 ) == 0 ) {
+            bytes = in.read( 14 );
+        } else {
+            return false;
+        }
+
+        start = in.position();
+        return !in.failed() && bytes * 8 <= in.remaining();
+    }
+
+    // the end of an open type; its value must fill the bytes, apart from the padding of the last one.
+    bool close_open_type( FastPathBitReader& in, std::size_t bytes, std::size_t start ) {
+        if ( in.failed() || ( in.position() - start + 7 ) / 8 != bytes ) return false;
+        in.seek( start + bytes * 8 );
+        return true;
+    }
+
+    bool decode_accuracy( FastPathBitReader& in, bsm_fast_path::PositionalAccuracy& accuracy ) {
+        return constrained( in, 8, 0, 255, accuracy.semi_major )
+            && constrained( in, 8, 0, 255, accuracy.semi_minor )
+            && constrained( in, 16, 0, 65535, accuracy.orientation );
+    }
+
+    bool decode_core( FastPathBitReader& in, bsm_fast_path::Bsm& bsm ) {
+        if ( !constrained( in, 7, 0, 127, bsm.msg_cnt ) ) return false;
+
+        for ( uint8_t& byte : bsm.id ) {
+            byte = static_cast<uint8_t>( in.read( 8 ) );
+        }
+
+        return constrained( in, 16, 0, 65535, bsm.sec_mark )
+            && constrained( in, 31, -900000000, 900000001, bsm.lat )
+            && constrained( in, 32, -1799999999, 1800000001, bsm.lon )
+            && constrained( in, 16, -4096, 61439, bsm.elev )
+            && decode_accuracy( in, bsm.accuracy )
+            && constrained( in, 3, 0, 7, bsm.transmission )
+            && constrained( in, 13, 0, 8191, bsm.speed )
+            && constrained( in, 15, 0, 28800, bsm.heading )
+            && constrained( in, 8, -126, 127, bsm.angle )
+            && constrained( in, 12, -2000, 2001, bsm.accel_long )
+            && constrained( in, 12, -2000, 2001, bsm.accel_lat )
+            && constrained( in, 8, -127, 127, bsm.accel_vert )
+            && constrained( in, 16, -32767, 32767, bsm.accel_yaw )
+            && constrained( in, 5, 0, 31, bsm.wheel_brakes )
+            && constrained( in, 2, 0, 3, bsm.traction )
+            && constrained( in, 2, 0, 3, bsm.abs )
+            && constrained( in, 2, 0, 3, bsm.scs )
+            && constrained( in, 2, 0, 2, bsm.brake_boost )
+            && constrained( in, 2, 0, 3, bsm.aux_brakes )
+            && constrained( in, 10, 0, 1023, bsm.width )
+            && constrained( in, 12, 0, 4095, bsm.length );
+    }
+
+    bool decode_crumb( FastPathBitReader& in, bsm_fast_path::PathHistoryPoint& point ) {
+        if ( in.read( 1 ) != 0 ) return false;
+
+        point.has_speed = in.read( 1 );
+        point.has_pos_accuracy = in.read( 1 );
+        point.has_heading = in.read( 1 );
+
+        return constrained( in, 18, -131072, 131071, point.lat_offset )
+            && constrained( in, 18, -131072, 131071, point.lon_offset )
+            && constrained( in, 12, -2048, 2047, point.elevation_offset )
+            && constrained( in, 16, 1, 65535, point.time_offset )
+            && ( !point.has_speed || constrained( in, 13, 0, 8191, point.speed ) )
+            && ( !point.has_pos_accuracy || decode_accuracy( in, point.pos_accuracy ) )
+            && ( !point.has_heading || constrained( in, 8, 0, 240, point.heading ) );
+    }
+
+    // VehicleSafetyExtensions without extensions; the path history has neither an initial position nor a GNSS status.
+    bool decode_safety_extensions( FastPathBitReader& in, bsm_fast_path::Bsm& bsm ) {
+        if ( in.read( 1 ) != 0 ) return false;
+
+        bsm.has_events = in.read( 1 );
+        bsm.has_path_history = in.read( 1 );
+        bsm.has_path_prediction = in.read( 1 );
+        bsm.has_lights = in.read( 1 );
+
+        // the extensible sizes of the bit strings must be the root size.
+        if ( bsm.has_events ) {
+            if ( in.read( 1 ) != 0 ) return false;
+            bsm.events = static_cast<uint16_t>( in.read( 13 ) );
+        }
+
+        if ( bsm.has_path_history ) {
+            if ( in.read( 3 ) != 0 ) return false;
+            if ( !constrained( in, 5, 1, bsm_fast_path::max_crumbs, bsm.crumb_count ) ) return false;
+
+            for ( std::size_t i = 0; i < bsm.crumb_count; ++i ) {
+                if ( !decode_crumb( in, bsm.crumbs[i] ) ) return false;
+            }
+        }
+
+        if ( bsm.has_path_prediction ) {
+            if ( in.read( 1 ) != 0 ) return false;
+            if ( !constrained( in, 16, -32767, 32767, bsm.radius_of_curve ) || !constrained( in, 8, 0, 200, bsm.confidence ) ) return false;
+        }
+
+        if ( bsm.has_lights ) {
+            if ( in.read( 1 ) != 0 ) return false;
+            bsm.lights = static_cast<uint16_t>( in.read( 9 ) );
+        }
+
+        return !in.failed();
+    }
+
+    // BasicSafetyMessage without extensions or regional content; its Part II is one VehicleSafetyExtensions.
+    bool decode_bsm( FastPathBitReader& in, bsm_fast_path::Bsm& bsm ) {
+        if ( in.read( 1 ) != 0 ) return false;
+
+        bool part2 = in.read( 1 );
+        if ( in.read( 1 ) != 0 ) return false;
+
+        if ( !decode_core( in, bsm ) ) return false;
+
+        bsm.has_safety_extensions = part2;
+        if ( !part2 ) return !in.failed();
+
+        // one PartIIcontent, with the partII-Id of the VehicleSafetyExtensions (0).
+        if ( in.read( 3 ) != 0 || in.read( 6 ) != 0 ) return false;
+
+        std::size_t bytes, start;
+        return open_type( in, bytes, start ) && decode_safety_extensions( in, bsm ) && close_open_type( in, bytes, start );
+    }
+
+    const char* const transmission_states[] = { "neutral", "park", "forwardGears", "reverseGears", "reserved1", "reserved2", "reserved3", "unavailable" };
+    const char* const brake_states[] = { "unavailable", "off", "on", "engaged" };     // traction, abs, and scs.
+    const char* const brake_boost_states[] = { "unavailable", "off", "on" };
+    const char* const aux_brake_states[] = { "unavailable", "off", "on", "reserved" };
+
+    void append_number( std::string& xer, int64_t value ) {
+        char digits[24];
+        char* end = digits + sizeof( digits );
+        char* p = end;
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>( value ) : static_cast<uint64_t>( value );
+
+        do {
+            *--p = static_cast<char>( '0' + magnitude % 10 );
+            magnitude /= 10;
+        } while ( magnitude > 0 );
+
+        if ( value < 0 ) *--p = '-';
+        xer.append( p, end - p );
+    }
+
+    void number( std::string& xer, const char* name, int64_t value ) {
+        xer.append( "<" ).append( name ).append( ">" );
+        append_number( xer, value );
+        xer.append( "</" ).append( name ).append( ">" );
+    }
+
+    // compact XER writes the value as the element's text.
+    void enumerated( std::string& xer, const char* name, const char* value, bool compact ) {
+        if ( compact ) {
+            xer.append( "<" ).append( name ).append( ">" ).append( value ).append( "</" ).append( name ).append( ">" );
+        } else {
+            xer.append( "<" ).append( name ).append( "><" ).append( value ).append( "/></" ).append( name ).append( ">" );
+        }
+    }
+
+    // a fixed size bit string, first bit highest.
+    void bits( std::string& xer, const char* name, uint32_t value, unsigned n ) {
+        xer.append( "<" ).append( name ).append( ">" );
+        while ( n > 0 ) {
+            --n;
+            xer.push_back( ( value >> n ) & 1 ? '1' : '0' );
+        }
+        xer.append( "</" ).append( name ).append( ">" );
+    }
+
+    void write_accuracy( std::string& xer, const char* name, const bsm_fast_path::PositionalAccuracy& accuracy ) {
+        xer.append( "<" ).append( name ).append( ">" );
+        number( xer, "semiMajor", accuracy.semi_major );
+        number( xer, "semiMinor", accuracy.semi_minor );
+        number( xer, "orientation", accuracy.orientation );
+        xer.append( "</" ).append( name ).append( ">" );
+    }
+
+    void write_core( std::string& xer, const bsm_fast_path::Bsm& bsm, bool compact ) {
+        static const char hex[] = "0123456789ABCDEF";
+
+        xer.append( "<coreData>" );
+        number( xer, "msgCnt", bsm.msg_cnt );
+
+        // an OCTET STRING is upper case hex in canonical XER.
+        xer.append( "<id>" );
+        for ( uint8_t byte : bsm.id ) {
+            xer.push_back( hex[ byte >> 4 ] );
+            xer.push_back( hex[ byte & 0x0F ] );
+        }
+        xer.append( "</id>" );
+
+        number( xer, "secMark", bsm.sec_mark );
+        number( xer, "lat", bsm.lat );
+        number( xer, "long", bsm.lon );
+        number( xer, "elev", bsm.elev );
+        write_accuracy( xer, "accuracy", bsm.accuracy );
+        enumerated( xer, "transmission", transmission_states[ bsm.transmission ], compact );
+        number( xer, "speed", bsm.speed );
+        number( xer, "heading", bsm.heading );
+        number( xer, "angle", bsm.angle );
+
+        xer.append( "<accelSet>" );
+        number( xer, "long", bsm.accel_long );
+        number( xer, "lat", bsm.accel_lat );
+        number( xer, "vert", bsm.accel_vert );
+        number( xer, "yaw", bsm.accel_yaw );
+        xer.append( "</accelSet>" );
+
+        xer.append( "<brakes>" );
+        bits( xer, "wheelBrakes", bsm.wheel_brakes, 5 );
+        enumerated( xer, "traction", brake_states[ bsm.traction ], compact );
+        enumerated( xer, "abs", brake_states[ bsm.abs ], compact );
+        enumerated( xer, "scs", brake_states[ bsm.scs ], compact );
+        enumerated( xer, "brakeBoost", brake_boost_states[ bsm.brake_boost ], compact );
+        enumerated( xer, "auxBrakes", aux_brake_states[ bsm.aux_brakes ], compact );
+        xer.append( "</brakes>" );
+
+        xer.append( "<size>" );
+        number( xer, "width", bsm.width );
+        number( xer, "length", bsm.length );
+        xer.append( "</size>" );
+
+        xer.append( "</coreData>" );
+    }
+
+    void write_safety_extensions( std::string& xer, const bsm_fast_path::Bsm& bsm ) {
+        xer.append( "<VehicleSafetyExtensions>" );
+
+        if ( bsm.has_events ) bits( xer, "events", bsm.events, 13 );
+
+        if ( bsm.has_path_history ) {
+            xer.append( "<pathHistory><crumbData>" );
+            for ( std::size_t i = 0; i < bsm.crumb_count; ++i ) {
+                const bsm_fast_path::PathHistoryPoint& point = bsm.crumbs[i];
+                xer.append( "<PathHistoryPoint>" );
+                number( xer, "latOffset", point.lat_offset );
+                number( xer, "lonOffset", point.lon_offset );
+                number( xer, "elevationOffset", point.elevation_offset );
+                number( xer, "timeOffset", point.time_offset );
+                if ( point.has_speed ) number( xer, "speed", point.speed );
+                if ( point.has_pos_accuracy ) write_accuracy( xer, "posAccuracy", point.pos_accuracy );
+                if ( point.has_heading ) number( xer, "heading", point.heading );
+                xer.append( "</PathHistoryPoint>" );
+            }
+            xer.append( "</crumbData></pathHistory>" );
+        }
+
+        if ( bsm.has_path_prediction ) {
+            xer.append( "<pathPrediction>" );
+            number( xer, "radiusOfCurve", bsm.radius_of_curve );
+            number( xer, "confidence", bsm.confidence );
+            xer.append( "</pathPrediction>" );
+        }
+
+        if ( bsm.has_lights ) bits( xer, "lights", bsm.lights, 9 );
+
+        xer.append( "</VehicleSafetyExtensions>" );
+    }
+}
+
+bool bsm_fast_path::decode( const void* bytes, std::size_t length, Bsm& bsm, std::size_t* consumed ) {
+    FastPathBitReader in{ static_cast<const uint8_t*>( bytes ), length };
+
+    // MessageFrame without extensions and with the messageId of a BasicSafetyMessage (20).
+    if ( in.read( 1 ) != 0 || in.read( 15 ) != 20 ) return false;
+
+    std::size_t value_bytes, value_start;
+    if ( !open_type( in, value_bytes, value_start ) || !decode_bsm( in, bsm ) || !close_open_type( in, value_bytes, value_start ) ) {
+        return false;
+    }
+
+    if ( consumed ) *consumed = in.position() / 8;
+    return true;
+}
+
+void bsm_fast_path::write_xer( const Bsm& bsm, std::string& xer, bool compact ) {
+    xer.append( "<MessageFrame><messageId>20</messageId><value><BasicSafetyMessage>" );
+    write_core( xer, bsm, compact );
+
+    if ( bsm.has_safety_extensions ) {
+        xer.append( "<partII><PartIIcontent><partII-Id>0</partII-Id><partII-Value>" );
+        write_safety_extensions( xer, bsm );
+        xer.append( "</partII-Value></PartIIcontent></partII>" );
+    }
+
+    xer.append( "</BasicSafetyMessage></value></MessageFrame>" );
+}
@@ -0,0 +1,96 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "bsm_rate_limiter.hpp"
+
+#include <algorithm>
+
+namespace {
+
+    uint64_t elapsed( uint64_t now, uint64_t then ) {
+        return now > then ? now - then : 0;
+    }
+}
+
+BsmRateLimiter::BsmRateLimiter( uint32_t interval_ms, std::size_t capacity, uint32_t idle_ms ) :
+    interval_{ interval_ms }
+    , idle_{ std::max( idle_ms, interval_ms ) }
+    , mask_{ 0 }
+    , shards_{ new Shard[ shard_count ] }
+{
+    std::size_t slots = max_probes;
+    while ( slots * shard_count < capacity ) slots <<= 1;
+    mask_ = slots - 1;
+
+    for ( std::size_t i = 0; i < shard_count; ++i ) {
+        shards_[i].slots.assign( slots, Slot{ 0, 0 } );
+    }
+}
+
+BsmFilter::Verdict BsmRateLimiter::test( const bsm_fast_path::Bsm& bsm ) {
+    return test( bsm_filter::vehicle_id( bsm ), bsm_filter::steady_ms() );
+}
+
+BsmFilter::Verdict BsmRateLimiter::test( uint32_t id, uint64_t now_ms ) {
+    // 0 marks a free slot.
+    uint64_t now = now_ms + 1;
+
+    // the top bits choose the shard and the next bits the first slot.
+    Shard& shard = shards_[ bsm_filter::shard_of<shard_count>( id ) ];
+    std::size_t first = static_cast<std::size_t>( bsm_filter::spread( id ) >> 28 );
+
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+
+    // slots are never freed, only reused, so a vehicle is never after a free slot.
+    Slot* reuse = nullptr;
+    Slot* oldest = nullptr;
+
+    for ( std::size_t i = 0; i < max_probes; ++i ) {
+        Slot& slot = shard.slots[ ( first + i ) & mask_ ];
+
+        if ( slot.last == 0 ) {
+            if ( !reuse ) reuse = &slot;
+            break;
+        }
+
+        if ( slot.id == id ) {
+            if ( elapsed( now, slot.last ) < interval_ ) return Verdict::DROP;
+            slot.last = now;
+            return Verdict::PASS;
+        }
+
+        if ( elapsed( now, slot.last ) >= idle_ ) {
+            if ( !reuse ) reuse = &slot;
+        } else if ( !oldest || slot.last < oldest->last ) {
+            oldest = &slot;
+        }
+    }
+
+    Slot* slot = reuse ? reuse : oldest;
+    slot->id = id;
+    slot->last = now;
+    return Verdict::PASS;
+}
+
+std::size_t BsmRateLimiter::capacity() const {
+    return shard_count * ( mask_ + 1 );
+}
@@ -0,0 +1,48 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "coarse_clock.hpp"
+
+CoarseClock::CoarseClock() :
+    second_{ -1 }
+    , text_{}
+{}
+
+const std::string& CoarseClock::now() {
+    std::time_t t = std::time( nullptr );
+
+    if ( t != second_ ) {
+        // gmtime_r, not gmtime: every worker thread has a clock.
+        struct tm utc;
+        char buf[50];
+
+        if ( gmtime_r( &t, &utc ) && std::strftime( buf, sizeof( buf ), "%Y-%m-%dT%TZ[UTC]", &utc ) ) {
+            text_.assign( buf );
+        } else {
+            text_.clear();
+        }
+
+        second_ = t;
+    }
+
+    return text_;
+}
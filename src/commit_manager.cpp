@@ -0,0 +1,131 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "commit_manager.hpp"
+
+CommitManager::CommitManager() :
+    partitions_{}
+    , failures_{ 0 }
+    , mutex_{}
+{}
+
+CommitManager::Token* CommitManager::track( const std::string& topic, int32_t partition, int64_t offset )
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    std::unique_ptr<Partition>& p = partitions_[ std::make_pair( topic, partition ) ];
+    if ( !p ) {
+        p.reset( new Partition{ topic, partition, std::deque<Entry>{}, -1, false } );
+    }
+
+    p->entries.push_back( Entry{ offset, false, p.get() } );
+    return &p->entries.back();
+}
+
+void CommitManager::complete( Token* token, bool delivered )
+{
+    if ( !token ) return;
+
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    token->done = true;
+    if ( !delivered ) ++failures_;
+
+    // everything up to the first message still in flight can be committed.
+    Partition* p = token->partition;
+    while ( !p->entries.empty() && p->entries.front().done ) {
+        p->next = p->entries.front().offset + 1;
+        p->advanced = true;
+        p->entries.pop_front();
+    }
+}
+
+std::size_t CommitManager::take_commits( std::vector<Offset>& offsets )
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    offsets.clear();
+    for ( auto& kv : partitions_ ) {
+        Partition& p = *kv.second;
+        if ( p.advanced ) {
+            offsets.push_back( Offset{ p.topic, p.partition, p.next } );
+            p.advanced = false;
+        }
+    }
+
+    return offsets.size();
+}
+
+uint64_t CommitManager::failures() const
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return failures_;
+}
+
+std::size_t CommitManager::pending() const
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    std::size_t n = 0;
+    for ( auto& kv : partitions_ ) n += kv.second->entries.size();
+    return n;
+}
+
+std::size_t CommitManager::pending( const std::string& topic, int32_t partition ) const
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    auto it = partitions_.find( std::make_pair( topic, partition ) );
+    return it == partitions_.end() ? 0 : it->second->entries.size();
+}
+
+std::vector<CommitManager::Position> CommitManager::positions() const
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    std::vector<Position> positions;
+    positions.reserve( partitions_.size() );
+    for ( const auto& entry : partitions_ ) {
+        const Partition& p = *entry.second;
+        bool empty = p.entries.empty();
+        positions.push_back( Position{ p.topic, p.partition, p.next, empty ? -1 : p.entries.front().offset,
+                empty ? -1 : p.entries.back().offset, p.entries.size() } );
+    }
+    return positions;
+}
+
+bool CommitManager::release( const std::string& topic, int32_t partition, Offset& offset )
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    auto it = partitions_.find( std::make_pair( topic, partition ) );
+    if ( it == partitions_.end() ) return false;
+
+    Partition& p = *it->second;
+    bool advanced = p.advanced;
+    if ( advanced ) {
+        offset = Offset{ p.topic, p.partition, p.next };
+        p.advanced = false;
+    }
+
+    if ( p.entries.empty() ) partitions_.erase( it );
+    return advanced;
+}
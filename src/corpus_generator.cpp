@@ -0,0 +1,558 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "corpus_generator.hpp"
+#include "hex_codec.hpp"
+#include "MessageFrame.h"
+#include "Ieee1609Dot2Data.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+    const char* const kind_names[] = { "bsm", "tim", "map", "spat" };
+
+    // an area the size of a city around Cheyenne, WY; 1/10 micro degrees.
+    constexpr int64_t center_lat = 411400000;
+    constexpr int64_t center_lon = -1048200000;
+    constexpr int64_t spread = 500000;
+    constexpr double pi = 3.14159265358979323846;
+
+    constexpr const char* transmissions[] = { "neutral", "park", "forwardGears", "reverseGears" };
+    constexpr const char* brake_states[] = { "unavailable", "off", "on", "engaged" };
+    constexpr const char* frame_types[] = { "advisory", "roadSignage", "commercialSignage" };
+    constexpr const char* mutcd_codes[] = { "regulatory", "warning", "maintenance", "motoristService", "guide" };
+    constexpr const char* directions[] = { "forward", "reverse", "both" };
+
+    // J2735 MovementPhaseState values; a signal group cycles through the first four.
+    constexpr const char* phase_names[] = { "stop-And-Remain", "protected-Movement-Allowed", "protected-clearance",
+        "permissive-Movement-Allowed", "stop-Then-Proceed", "dark" };
+
+    // ITIS codes a TIM commonly carries: closures, incidents, speed limits, weather, and work zones.
+    constexpr int64_t itis_codes[] = { 257, 268, 513, 531, 770, 1025, 1281, 1537, 2564, 4868, 5127, 6952, 7186, 8720,
+        12554, 13569 };
+
+    template <typename T, std::size_t N>
+    constexpr std::size_t count( const T (&)[N] ) { return N; }
+
+    void element( std::string& xer, const char* name, int64_t value ) {
+        xer += '<';
+        xer += name;
+        xer += '>';
+        xer += std::to_string( value );
+        xer += "</";
+        xer += name;
+        xer += '>';
+    }
+
+    void element( std::string& xer, const char* name, const char* value ) {
+        xer += '<';
+        xer += name;
+        xer += '>';
+        xer += value;
+        xer += "</";
+        xer += name;
+        xer += '>';
+    }
+
+    // an ENUMERATED or a BOOLEAN value.
+    void choice( std::string& xer, const char* name, const char* value ) {
+        xer += '<';
+        xer += name;
+        xer += "><";
+        xer += value;
+        xer += "/></";
+        xer += name;
+        xer += '>';
+    }
+
+    int append_bytes( const void* buffer, size_t size, void* key ) {
+        static_cast<std::string*>( key )->append( static_cast<const char*>( buffer ), size );
+        return 0;
+    }
+
+    // the ODE decode request around the hex of a UPER MessageFrame; {{payload}} and {{serial}} are filled in.
+    const char envelope_prefix[] = "<?xml version=\"1.0\"?><OdeAsn1Data><metadata><payloadType>us.dot.its.jpo.ode.model.OdeAsn1Payload"
+        "</payloadType><serialId><streamId>acm-corpus</streamId><bundleSize>1</bundleSize><bundleId>0</bundleId>"
+        "<recordId>0</recordId><serialNumber>";
+    const char envelope_middle[] = "</serialNumber></serialId><receivedAt>2017-10-04T13:41:47.862Z[UTC]</receivedAt>"
+        "<schemaVersion>2</schemaVersion><sanitized>false</sanitized><encodings><encodings><elementName>root</elementName>"
+        "<elementType>MessageFrame</elementType><encodingRule>UPER</encodingRule></encodings></encodings></metadata>"
+        "<payload><dataType>us.dot.its.jpo.ode.model.OdeHexByteArray</dataType><data><bytes>";
+    const char envelope_suffix[] = "</bytes></data></payload></OdeAsn1Data>";
+}
+
+const char* CorpusGenerator::name( Kind kind ) {
+    return kind < Kind::COUNT ? kind_names[ static_cast<std::size_t>( kind ) ] : "";
+}
+
+CorpusGenerator::Format CorpusGenerator::parse_format( const std::string& name ) {
+    if ( name == "uper" ) return Format::UPER;
+    if ( name == "coer" ) return Format::COER;
+    if ( name == "xml" ) return Format::XML;
+    throw std::invalid_argument{ "unknown corpus format: " + name + "; use uper, coer, or xml" };
+}
+
+void CorpusGenerator::encode( const struct asn_TYPE_descriptor_s* type, enum asn_transfer_syntax syntax, const std::string& xer, std::string& bytes ) {
+    void* structure = nullptr;
+
+    asn_dec_rval_t rval = xer_decode( 0, type, &structure, xer.data(), xer.size() );
+    if ( rval.code != RC_OK ) {
+        ASN_STRUCT_FREE( *type, structure );
+        throw std::runtime_error{ std::string{ "the generated XER of " } + type->name + " does not decode." };
+    }
+
+    char errbuf[256];
+    std::size_t errlen = sizeof( errbuf );
+    if ( asn_check_constraints( type, structure, errbuf, &errlen ) ) {
+        ASN_STRUCT_FREE( *type, structure );
+        throw std::runtime_error{ std::string{ "the generated " } + type->name + " violates a constraint: " + std::string{ errbuf, errlen } };
+    }
+
+    bytes.clear();
+    asn_enc_rval_t erval = asn_encode( 0, syntax, type, structure, append_bytes, &bytes );
+    ASN_STRUCT_FREE( *type, structure );
+
+    if ( erval.encoded == -1 ) {
+        throw std::runtime_error{ std::string{ "the generated " } + type->name + " does not encode." };
+    }
+}
+
+CorpusGenerator::CorpusGenerator( uint64_t seed, std::size_t vehicles, std::size_t intersections ) :
+    rng_{ seed }
+    , weights_{ 70, 10, 10, 10 }
+    , vehicles_{}
+    , intersections_{}
+    , generated_{ 0 }
+    , minute_{ 0 }
+    , xer_{}
+    , frame_{}
+    , hex_{}
+{
+    minute_ = uniform( 0, 527039 );
+
+    vehicles_.reserve( vehicles );
+    for ( std::size_t i = 0; i < vehicles; ++i ) {
+        Vehicle v;
+        v.id = static_cast<uint32_t>( rng_() );
+        v.lat = center_lat + uniform( -spread, spread );
+        v.lon = center_lon + uniform( -spread, spread );
+        v.elev = uniform( 18000, 19500 );
+        v.speed = uniform( 0, 1500 );
+        v.heading = uniform( 0, 28799 );
+        v.msg_count = uniform( 0, 127 );
+        v.sec_mark = uniform( 0, 59999 );
+        v.part2 = uniform( 0, 99 ) < 60;
+        vehicles_.push_back( v );
+    }
+
+    intersections_.reserve( intersections );
+    for ( std::size_t i = 0; i < intersections; ++i ) {
+        Intersection x;
+        x.id = 1000 + static_cast<int64_t>( i );
+        x.lat = center_lat + uniform( -spread, spread );
+        x.lon = center_lon + uniform( -spread, spread );
+        x.revision = uniform( 0, 127 );
+        x.geometry = rng_();
+        x.phases.assign( static_cast<std::size_t>( uniform( 2, 8 ) ), 0 );
+        for ( uint8_t& phase : x.phases ) phase = static_cast<uint8_t>( uniform( 0, 3 ) );
+        intersections_.push_back( x );
+    }
+}
+
+void CorpusGenerator::set_mix( const std::string& mix ) {
+    std::vector<uint32_t> weights( static_cast<std::size_t>( Kind::COUNT ), 0 );
+    uint64_t total = 0;
+    std::size_t begin = 0;
+
+    while ( begin <= mix.size() ) {
+        std::size_t end = mix.find( ',', begin );
+        if ( end == std::string::npos ) end = mix.size();
+
+        std::string item = mix.substr( begin, end - begin );
+        std::size_t equals = item.find( '=' );
+        std::string kind = item.substr( 0, equals );
+
+        std::size_t k = 0;
+        while ( k < weights.size() && kind != kind_names[k] ) ++k;
+        if ( k == weights.size() ) {
+            throw std::invalid_argument{ "unknown message kind in the corpus mix: " + kind + "; use bsm, tim, map, or spat" };
+        }
+
+        std::size_t digits = 0;
+        unsigned long weight = 0;
+        std::string value = equals == std::string::npos ? "" : item.substr( equals + 1 );
+        try {
+            weight = std::stoul( value, &digits );
+        } catch ( const std::exception& ) {
+            digits = 0;
+        }
+        if ( value.empty() || digits != value.size() || weight > 1000000 ) {
+            throw std::invalid_argument{ "bad weight in the corpus mix: " + item };
+        }
+
+        weights[k] = static_cast<uint32_t>( weight );
+        total += weight;
+        begin = end + 1;
+    }
+
+    if ( total == 0 ) {
+        throw std::invalid_argument{ "the corpus mix has no weight: " + mix };
+    }
+
+    weights_ = weights;
+}
+
+int64_t CorpusGenerator::uniform( int64_t low, int64_t high ) {
+    return std::uniform_int_distribution<int64_t>{ low, high }( rng_ );
+}
+
+CorpusGenerator::Kind CorpusGenerator::next_kind() {
+    uint64_t total = 0;
+    for ( uint32_t w : weights_ ) total += w;
+
+    int64_t pick = uniform( 0, static_cast<int64_t>( total ) - 1 );
+    std::size_t k = 0;
+    while ( pick >= weights_[k] ) pick -= weights_[k++];
+    return static_cast<Kind>( k );
+}
+
+void CorpusGenerator::xer( Kind kind, std::string& xer ) {
+    xer.clear();
+
+    // the minute of the year moves on about every 600 messages, a feed of 10 messages a second.
+    if ( uniform( 0, 599 ) == 0 ) minute_ = ( minute_ + 1 ) % 527040;
+
+    switch ( kind ) {
+        case Kind::BSM: bsm_xer( xer ); break;
+        case Kind::TIM: tim_xer( xer ); break;
+        case Kind::MAP: map_xer( xer ); break;
+        case Kind::SPAT: spat_xer( xer ); break;
+        default: throw std::invalid_argument{ "unknown message kind." };
+    }
+}
+
+CorpusGenerator::Kind CorpusGenerator::next( Format format, std::string& message ) {
+    Kind kind = next_kind();
+    xer( kind, xer_ );
+
+    switch ( format ) {
+        case Format::UPER:
+            encode( &asn_DEF_MessageFrame, ATS_UNALIGNED_BASIC_PER, xer_, message );
+            break;
+
+        case Format::COER:
+            encode( &asn_DEF_MessageFrame, ATS_UNALIGNED_BASIC_PER, xer_, frame_ );
+            hex_codec::encode( frame_.data(), frame_.size(), hex_ );
+            xer_ = "<Ieee1609Dot2Data><protocolVersion>3</protocolVersion><content><unsecuredData>" + hex_
+                + "</unsecuredData></content></Ieee1609Dot2Data>";
+            encode( &asn_DEF_Ieee1609Dot2Data, ATS_CANONICAL_OER, xer_, message );
+            break;
+
+        case Format::XML:
+            encode( &asn_DEF_MessageFrame, ATS_UNALIGNED_BASIC_PER, xer_, frame_ );
+            hex_codec::encode( frame_.data(), frame_.size(), hex_ );
+            message = envelope_prefix;
+            message += std::to_string( generated_ );
+            message += envelope_middle;
+            message += hex_;
+            message += envelope_suffix;
+            break;
+    }
+
+    ++generated_;
+    return kind;
+}
+
+uint64_t CorpusGenerator::generated() const {
+    return generated_;
+}
+
+void CorpusGenerator::bsm_xer( std::string& xer ) {
+    Vehicle& v = vehicles_[ static_cast<std::size_t>( uniform( 0, static_cast<int64_t>( vehicles_.size() ) - 1 ) ) ];
+
+    // 100 ms later the vehicle has moved on along its heading; the speed and heading drift.
+    double radians = v.heading * 0.0125 * pi / 180.0;
+    double meters = v.speed * 0.02 * 0.1;
+    v.lat += static_cast<int64_t>( meters * std::cos( radians ) / 0.0111 );
+    v.lon += static_cast<int64_t>( meters * std::sin( radians ) / ( 0.0111 * std::cos( v.lat * 1e-7 * pi / 180.0 ) ) );
+    if ( v.lat < center_lat - 2 * spread || v.lat > center_lat + 2 * spread ) v.lat = center_lat;
+    if ( v.lon < center_lon - 2 * spread || v.lon > center_lon + 2 * spread ) v.lon = center_lon;
+    v.speed = std::min<int64_t>( 1800, std::max<int64_t>( 0, v.speed + uniform( -25, 25 ) ) );
+    v.heading = ( v.heading + uniform( -80, 80 ) + 28800 ) % 28800;
+    v.msg_count = ( v.msg_count + 1 ) % 128;
+    v.sec_mark = ( v.sec_mark + 100 ) % 60000;
+
+    char id[9];
+    std::snprintf( id, sizeof( id ), "%08X", v.id );
+
+    xer += "<MessageFrame><messageId>20</messageId><value><BasicSafetyMessage><coreData>";
+    element( xer, "msgCnt", v.msg_count );
+    element( xer, "id", id );
+    element( xer, "secMark", v.sec_mark );
+    element( xer, "lat", v.lat );
+    element( xer, "long", v.lon );
+    element( xer, "elev", v.elev );
+    xer += "<accuracy>";
+    element( xer, "semiMajor", uniform( 0, 255 ) );
+    element( xer, "semiMinor", uniform( 0, 255 ) );
+    element( xer, "orientation", uniform( 0, 65535 ) );
+    xer += "</accuracy>";
+    choice( xer, "transmission", v.speed == 0 ? transmissions[ uniform( 0, 1 ) ] : transmissions[2] );
+    element( xer, "speed", v.speed );
+    element( xer, "heading", v.heading );
+    element( xer, "angle", uniform( -126, 127 ) );
+    xer += "<accelSet>";
+    element( xer, "long", uniform( -2000, 2001 ) );
+    element( xer, "lat", uniform( -2000, 2001 ) );
+    element( xer, "vert", uniform( -127, 127 ) );
+    element( xer, "yaw", uniform( -32767, 32767 ) );
+    xer += "</accelSet><brakes>";
+    element( xer, "wheelBrakes", uniform( 0, 3 ) == 0 ? "01111" : "00000" );
+    choice( xer, "traction", brake_states[ uniform( 0, 3 ) ] );
+    choice( xer, "abs", brake_states[ uniform( 0, 3 ) ] );
+    choice( xer, "scs", brake_states[ uniform( 0, 3 ) ] );
+    choice( xer, "brakeBoost", brake_states[ uniform( 0, 2 ) ] );
+    choice( xer, "auxBrakes", brake_states[ uniform( 0, 2 ) ] );
+    xer += "</brakes><size>";
+    element( xer, "width", uniform( 150, 260 ) );
+    element( xer, "length", uniform( 300, 1800 ) );
+    xer += "</size></coreData>";
+
+    if ( v.part2 ) {
+        xer += "<partII><PartIIcontent><partII-Id>0</partII-Id><partII-Value><VehicleSafetyExtensions><pathHistory><crumbData>";
+
+        int64_t points = uniform( 1, 15 );
+        int64_t time_offset = 0;
+        for ( int64_t i = 0; i < points; ++i ) {
+            time_offset += uniform( 50, 3000 );
+            xer += "<PathHistoryPoint>";
+            element( xer, "latOffset", uniform( -131071, 131071 ) );
+            element( xer, "lonOffset", uniform( -131071, 131071 ) );
+            element( xer, "elevationOffset", uniform( -2047, 2047 ) );
+            element( xer, "timeOffset", std::min<int64_t>( time_offset, 65535 ) );
+            xer += "</PathHistoryPoint>";
+        }
+
+        xer += "</crumbData></pathHistory>";
+
+        if ( uniform( 0, 1 ) ) {
+            xer += "<pathPrediction>";
+            element( xer, "radiusOfCurve", uniform( -32767, 32767 ) );
+            element( xer, "confidence", uniform( 0, 200 ) );
+            xer += "</pathPrediction>";
+        }
+
+        if ( uniform( 0, 2 ) == 0 ) {
+            element( xer, "lights", uniform( 0, 1 ) ? "000000001" : "100000000" );
+        }
+
+        xer += "</VehicleSafetyExtensions></partII-Value></PartIIcontent></partII>";
+    }
+
+    xer += "</BasicSafetyMessage></value></MessageFrame>";
+}
+
+void CorpusGenerator::tim_xer( std::string& xer ) {
+    xer += "<MessageFrame><messageId>31</messageId><value><TravelerInformation>";
+    element( xer, "msgCnt", uniform( 0, 127 ) );
+    element( xer, "timeStamp", minute_ );
+
+    char packet[19];
+    std::snprintf( packet, sizeof( packet ), "%02X%016llX", static_cast<unsigned>( uniform( 0, 255 ) ),
+            static_cast<unsigned long long>( rng_() ) );
+    element( xer, "packetID", packet );
+
+    xer += "<dataFrames>";
+
+    int64_t frames = uniform( 1, 2 );
+    for ( int64_t f = 0; f < frames; ++f ) {
+        int64_t lat = center_lat + uniform( -spread, spread );
+        int64_t lon = center_lon + uniform( -spread, spread );
+        int64_t elevation = uniform( 18000, 19500 );
+
+        xer += "<TravelerDataFrame>";
+        element( xer, "sspTimRights", uniform( 0, 31 ) );
+        choice( xer, "frameType", frame_types[ uniform( 0, count( frame_types ) - 1 ) ] );
+        xer += "<msgId><roadSignID><position>";
+        element( xer, "lat", lat );
+        element( xer, "long", lon );
+        element( xer, "elevation", elevation );
+        xer += "</position>";
+        element( xer, "viewAngle", uniform( 0, 1 ) ? "0101010101010100" : "1111111111111111" );
+        if ( uniform( 0, 1 ) ) choice( xer, "mutcdCode", mutcd_codes[ uniform( 0, count( mutcd_codes ) - 1 ) ] );
+        xer += "</roadSignID></msgId>";
+        element( xer, "startYear", 2026 );
+        element( xer, "startTime", std::max<int64_t>( 0, minute_ - uniform( 0, 1440 ) ) );
+        element( xer, "duratonTime", uniform( 1, 32000 ) );
+        element( xer, "priority", uniform( 0, 7 ) );
+        element( xer, "sspLocationRights", uniform( 0, 31 ) );
+        xer += "<regions><GeographicalPath>";
+        if ( uniform( 0, 1 ) ) {
+            std::string name = "Corpus TIM " + std::to_string( uniform( 1, 9999 ) );
+            element( xer, "name", name.c_str() );
+        }
+        xer += "<id>";
+        element( xer, "region", "0" );
+        element( xer, "id", uniform( 0, 65535 ) );
+        xer += "</id><anchor>";
+        element( xer, "lat", lat );
+        element( xer, "long", lon );
+        element( xer, "elevation", elevation );
+        xer += "</anchor>";
+        element( xer, "laneWidth", uniform( 300, 1200 ) );
+        choice( xer, "directionality", directions[ uniform( 0, count( directions ) - 1 ) ] );
+        choice( xer, "closedPath", "false" );
+        element( xer, "direction", "0000000000010100" );
+        xer += "<description><path>";
+        element( xer, "scale", "0" );
+        xer += "<offset><ll><nodes>";
+
+        int64_t nodes = uniform( 2, 24 );
+        for ( int64_t n = 0; n < nodes; ++n ) {
+            xer += "<NodeLL><delta><node-LL3>";
+            element( xer, "lon", uniform( -30000, 30000 ) );
+            element( xer, "lat", uniform( -30000, 30000 ) );
+            xer += "</node-LL3></delta></NodeLL>";
+        }
+
+        xer += "</nodes></ll></offset></path></description></GeographicalPath></regions>";
+        element( xer, "sspMsgRights1", uniform( 0, 31 ) );
+        element( xer, "sspMsgRights2", uniform( 0, 31 ) );
+        xer += "<content><advisory>";
+
+        int64_t items = uniform( 1, 4 );
+        for ( int64_t i = 0; i < items; ++i ) {
+            xer += "<SEQUENCE><item>";
+            element( xer, "itis", itis_codes[ uniform( 0, count( itis_codes ) - 1 ) ] );
+            xer += "</item></SEQUENCE>";
+        }
+
+        xer += "</advisory></content></TravelerDataFrame>";
+    }
+
+    xer += "</dataFrames></TravelerInformation></value></MessageFrame>";
+}
+
+void CorpusGenerator::map_xer( std::string& xer ) {
+    Intersection& x = intersections_[ static_cast<std::size_t>( uniform( 0, static_cast<int64_t>( intersections_.size() ) - 1 ) ) ];
+
+    // an intersection is rebroadcast with the same geometry until its revision changes.
+    if ( uniform( 0, 999 ) == 0 ) {
+        x.revision = ( x.revision + 1 ) % 128;
+        x.geometry = rng_();
+    }
+
+    std::mt19937_64 geometry{ x.geometry };
+    auto draw = [&geometry]( int64_t low, int64_t high ) {
+        return std::uniform_int_distribution<int64_t>{ low, high }( geometry );
+    };
+
+    xer += "<MessageFrame><messageId>18</messageId><value><MapData>";
+    element( xer, "timeStamp", minute_ );
+    element( xer, "msgIssueRevision", x.revision );
+    xer += "<intersections><IntersectionGeometry><id>";
+    element( xer, "id", x.id );
+    xer += "</id>";
+    element( xer, "revision", x.revision );
+    xer += "<refPoint>";
+    element( xer, "lat", x.lat );
+    element( xer, "long", x.lon );
+    xer += "</refPoint>";
+    element( xer, "laneWidth", draw( 300, 400 ) );
+    xer += "<laneSet>";
+
+    int64_t lanes = draw( 4, 16 );
+    for ( int64_t lane = 1; lane <= lanes; ++lane ) {
+        bool ingress = lane % 2 == 1;
+
+        xer += "<GenericLane>";
+        element( xer, "laneID", lane );
+        element( xer, ingress ? "ingressApproach" : "egressApproach", ( lane - 1 ) / 4 + 1 );
+        xer += "<laneAttributes>";
+        element( xer, "directionalUse", ingress ? "10" : "01" );
+        element( xer, "sharedWith", "0000000000" );
+        xer += "<laneType>";
+        element( xer, "vehicle", "00000000" );
+        xer += "</laneType></laneAttributes>";
+        if ( ingress ) element( xer, "maneuvers", draw( 0, 1 ) ? "100000000000" : "110000000000" );
+        xer += "<nodeList><nodes>";
+
+        int64_t nodes = draw( 2, 8 );
+        for ( int64_t n = 0; n < nodes; ++n ) {
+            xer += "<NodeXY><delta><node-XY3>";
+            element( xer, "x", draw( -2000, 2000 ) );
+            element( xer, "y", draw( -2000, 2000 ) );
+            xer += "</node-XY3></delta></NodeXY>";
+        }
+
+        xer += "</nodes></nodeList>";
+
+        if ( ingress && lane < lanes ) {
+            xer += "<connectsTo><Connection><connectingLane>";
+            element( xer, "lane", lane + 1 );
+            xer += "</connectingLane>";
+            element( xer, "signalGroup", 1 + ( lane - 1 ) / 2 % static_cast<int64_t>( x.phases.size() ) );
+            xer += "</Connection></connectsTo>";
+        }
+
+        xer += "</GenericLane>";
+    }
+
+    xer += "</laneSet></IntersectionGeometry></intersections></MapData></value></MessageFrame>";
+}
+
+void CorpusGenerator::spat_xer( std::string& xer ) {
+    Intersection& x = intersections_[ static_cast<std::size_t>( uniform( 0, static_cast<int64_t>( intersections_.size() ) - 1 ) ) ];
+
+    xer += "<MessageFrame><messageId>19</messageId><value><SPAT>";
+    element( xer, "timeStamp", minute_ );
+    xer += "<intersections><IntersectionState><id>";
+    element( xer, "id", x.id );
+    xer += "</id>";
+    element( xer, "revision", x.revision );
+    element( xer, "status", "0000000000000000" );
+    element( xer, "moy", minute_ );
+    element( xer, "timeStamp", uniform( 0, 59999 ) );
+    xer += "<states>";
+
+    for ( std::size_t g = 0; g < x.phases.size(); ++g ) {
+        // most signal groups keep their phase from one SPaT to the next.
+        if ( uniform( 0, 9 ) == 0 ) x.phases[g] = static_cast<uint8_t>( ( x.phases[g] + 1 ) % 4 );
+        if ( uniform( 0, 99 ) == 0 ) x.phases[g] = static_cast<uint8_t>( uniform( 4, count( phase_names ) - 1 ) );
+
+        int64_t min_end = uniform( 0, 36000 );
+
+        xer += "<MovementState>";
+        element( xer, "signalGroup", static_cast<int64_t>( g + 1 ) );
+        xer += "<state-time-speed><MovementEvent>";
+        choice( xer, "eventState", phase_names[ x.phases[g] ] );
+        xer += "<timing>";
+        element( xer, "minEndTime", min_end );
+        if ( uniform( 0, 1 ) ) element( xer, "maxEndTime", std::min<int64_t>( 36000, min_end + uniform( 0, 600 ) ) );
+        xer += "</timing></MovementEvent></state-time-speed></MovementState>";
+    }
+
+    xer += "</states></IntersectionState></intersections></SPAT></value></MessageFrame>";
+}
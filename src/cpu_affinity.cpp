@@ -0,0 +1,115 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "cpu_affinity.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu_affinity {
+
+namespace {
+
+    int parse_cpu( const std::string& list, std::size_t& pos ) {
+        std::size_t begin = pos;
+        int cpu = 0;
+
+        while ( pos < list.size() && std::isdigit( static_cast<unsigned char>( list[pos] ) ) ) {
+            cpu = cpu * 10 + ( list[pos] - '0' );
+            if ( cpu > 4095 ) throw std::invalid_argument{ "CPU number out of range in: " + list };
+            ++pos;
+        }
+
+        if ( pos == begin ) throw std::invalid_argument{ "expected a CPU number at offset " + std::to_string( begin ) + " in: " + list };
+        return cpu;
+    }
+}
+
+std::vector<int> parse( const std::string& list ) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+
+    while ( pos < list.size() && std::isspace( static_cast<unsigned char>( list[pos] ) ) ) ++pos;
+    if ( pos == list.size() ) return cpus;
+
+    for ( ;; ) {
+        while ( pos < list.size() && std::isspace( static_cast<unsigned char>( list[pos] ) ) ) ++pos;
+
+        int first = parse_cpu( list, pos );
+        int last = first;
+
+        if ( pos < list.size() && list[pos] == '-' ) {
+            ++pos;
+            last = parse_cpu( list, pos );
+            if ( last < first ) throw std::invalid_argument{ "descending CPU range in: " + list };
+        }
+
+        for ( int cpu = first; cpu <= last; ++cpu ) cpus.push_back( cpu );
+
+        while ( pos < list.size() && std::isspace( static_cast<unsigned char>( list[pos] ) ) ) ++pos;
+        if ( pos == list.size() ) return cpus;
+
+        if ( list[pos] != ',' ) throw std::invalid_argument{ "expected a comma at offset " + std::to_string( pos ) + " in: " + list };
+        ++pos;
+    }
+}
+
+bool pin_current_thread( const std::vector<int>& cpus ) {
+    if ( cpus.empty() ) return true;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO( &set );
+
+    for ( int cpu : cpus ) {
+        if ( cpu >= CPU_SETSIZE ) return false;
+        CPU_SET( cpu, &set );
+    }
+
+    return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+    return false;
+#endif
+}
+
+std::vector<int> current_cpus() {
+    std::vector<int> cpus;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    if ( pthread_getaffinity_np( pthread_self(), sizeof( set ), &set ) != 0 ) return cpus;
+
+    for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+        if ( CPU_ISSET( cpu, &set ) ) cpus.push_back( cpu );
+    }
+#endif
+
+    return cpus;
+}
+
+}  // end namespace.
@@ -0,0 +1,120 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "error_breaker.hpp"
+#include "bsm_filter.hpp"
+
+#include <algorithm>
+
+ErrorBreaker::ErrorBreaker( uint32_t threshold, uint32_t window_ms, uint32_t sample ) :
+    threshold_{ std::max<uint32_t>( threshold, 1 ) }
+    , window_{ std::max<uint32_t>( window_ms, 1 ) }
+    , sample_{ std::max<uint32_t>( sample, 1 ) }
+    , mutex_{}
+    , sources_{}
+    , suppressed_{ 0 }
+{}
+
+bool ErrorBreaker::report( const std::string& topic, int32_t partition, uint32_t code ) {
+    return report( topic, partition, code, bsm_filter::steady_ms() );
+}
+
+bool ErrorBreaker::report( const std::string& topic, int32_t partition, uint32_t code, uint64_t now_ms ) {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    auto inserted = sources_.emplace( std::make_pair( topic, partition ), Source{} );
+    Source& source = inserted.first->second;
+    if ( inserted.second ) source.window_start = now_ms;
+
+    roll( source, now_ms );
+
+    ++source.window_errors;
+    ++source.errors;
+
+    if ( !source.open && source.window_errors >= threshold_ ) {
+        source.open = true;
+        source.tripped = true;
+        source.open_errors = 0;
+    }
+
+    // the error that opens the breaker is the first sample.
+    if ( !source.open || source.open_errors++ % sample_ == 0 ) {
+        ++source.reported;
+        return true;
+    }
+
+    ++source.suppressed[ std::min<std::size_t>( code, codes - 1 ) ];
+    ++suppressed_;
+    return false;
+}
+
+std::vector<ErrorBreaker::Summary> ErrorBreaker::summaries() {
+    return summaries( bsm_filter::steady_ms() );
+}
+
+std::vector<ErrorBreaker::Summary> ErrorBreaker::summaries( uint64_t now_ms ) {
+    std::vector<Summary> result;
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    for ( auto it = sources_.begin(); it != sources_.end(); ) {
+        Source& source = it->second;
+        roll( source, now_ms );
+
+        if ( source.tripped ) {
+            Summary summary{ it->first.first, it->first.second, source.errors, source.reported, {}, source.open };
+            std::copy( source.suppressed, source.suppressed + codes, summary.suppressed );
+            result.push_back( std::move( summary ) );
+        }
+
+        source.tripped = source.open;
+        source.errors = 0;
+        source.reported = 0;
+        std::fill( source.suppressed, source.suppressed + codes, 0 );
+
+        // a closed source without errors in its window starts again from nothing.
+        if ( !source.open && source.window_errors == 0 ) {
+            it = sources_.erase( it );
+        } else {
+            ++it;
+        }
+    }
+
+    return result;
+}
+
+uint64_t ErrorBreaker::suppressed() const {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return suppressed_;
+}
+
+uint64_t ErrorBreaker::window() const {
+    return window_;
+}
+
+void ErrorBreaker::roll( Source& source, uint64_t now ) const {
+    if ( now < source.window_start || now - source.window_start < window_ ) return;
+
+    // a gap of more than one window holds quiet windows, which close the breaker too.
+    if ( source.window_errors < threshold_ || now - source.window_start >= 2 * window_ ) source.open = false;
+
+    source.window_start = now;
+    source.window_errors = 0;
+}
@@ -0,0 +1,248 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "geofence.hpp"
+
+#include "rapidjson/document.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+    using Polygon = GeofenceIndex::Polygon;
+
+    constexpr int64_t max_lat = 900000000;
+    constexpr int64_t max_lon = 1800000000;
+
+    int32_t units( const rapidjson::Value& degrees, int64_t limit ) {
+        if ( !degrees.IsNumber() ) throw std::invalid_argument{ "a GeoJSON coordinate is not a number." };
+        double value = std::round( degrees.GetDouble() * 1e7 );
+        if ( !( value >= -limit && value <= limit ) ) throw std::invalid_argument{ "a GeoJSON coordinate is out of range." };
+        return static_cast<int32_t>( value );
+    }
+
+    // GeoJSON positions are [ longitude, latitude ].
+    Polygon polygon( const rapidjson::Value& coordinates ) {
+        if ( !coordinates.IsArray() ) throw std::invalid_argument{ "the coordinates of a GeoJSON Polygon are not an array." };
+
+        Polygon r;
+        for ( const auto& ring : coordinates.GetArray() ) {
+            if ( !ring.IsArray() ) throw std::invalid_argument{ "a GeoJSON linear ring is not an array." };
+            r.emplace_back();
+            for ( const auto& position : ring.GetArray() ) {
+                if ( !position.IsArray() || position.Size() < 2 ) throw std::invalid_argument{ "a GeoJSON position is not [ longitude, latitude ]." };
+                r.back().push_back( GeofenceIndex::Point{ units( position[1], max_lat ), units( position[0], max_lon ) } );
+            }
+        }
+        return r;
+    }
+
+    void collect( const rapidjson::Value& object, std::vector<Polygon>& polygons ) {
+        if ( !object.IsObject() ) return;
+
+        auto type = object.FindMember( "type" );
+        if ( type == object.MemberEnd() || !type->value.IsString() ) return;
+        std::string name{ type->value.GetString(), type->value.GetStringLength() };
+
+        auto member = [&]( const char* key ) -> const rapidjson::Value* {
+            auto it = object.FindMember( key );
+            return it == object.MemberEnd() ? nullptr : &it->value;
+        };
+
+        if ( name == "FeatureCollection" ) {
+            const rapidjson::Value* features = member( "features" );
+            if ( features && features->IsArray() ) {
+                for ( const auto& feature : features->GetArray() ) collect( feature, polygons );
+            }
+        } else if ( name == "Feature" ) {
+            const rapidjson::Value* geometry = member( "geometry" );
+            if ( geometry ) collect( *geometry, polygons );
+        } else if ( name == "GeometryCollection" ) {
+            const rapidjson::Value* geometries = member( "geometries" );
+            if ( geometries && geometries->IsArray() ) {
+                for ( const auto& geometry : geometries->GetArray() ) collect( geometry, polygons );
+            }
+        } else if ( name == "Polygon" ) {
+            const rapidjson::Value* coordinates = member( "coordinates" );
+            if ( coordinates ) polygons.push_back( polygon( *coordinates ) );
+        } else if ( name == "MultiPolygon" ) {
+            const rapidjson::Value* coordinates = member( "coordinates" );
+            if ( coordinates && coordinates->IsArray() ) {
+                for ( const auto& p : coordinates->GetArray() ) polygons.push_back( polygon( p ) );
+            }
+        }
+    }
+
+    std::size_t clamp_index( int64_t offset, int64_t size, std::size_t cells ) {
+        return std::min<std::size_t>( static_cast<std::size_t>( offset / size ), cells - 1 );
+    }
+}
+
+GeofenceIndex::GeofenceIndex( const std::vector<Polygon>& polygons, std::size_t cells ) :
+    cells_{ std::max<std::size_t>( cells, 1 ) }
+    , polygons_{ polygons.size() }
+    , edges_{ 0 }
+    , min_lat_{ max_lat }
+    , min_lon_{ max_lon }
+    , cell_lat_{ 1 }
+    , cell_lon_{ 1 }
+    , states_( cells_ * cells_, OUTSIDE )
+    , rows_( cells_ )
+{
+    if ( polygons.empty() ) throw std::invalid_argument{ "a geofence needs at least one polygon." };
+
+    int64_t top = -max_lat;
+    int64_t right = -max_lon;
+
+    for ( const Polygon& p : polygons ) {
+        if ( p.empty() ) throw std::invalid_argument{ "a geofence polygon has no rings." };
+        for ( const Ring& ring : p ) {
+            if ( ring.size() < 3 ) throw std::invalid_argument{ "a geofence ring has fewer than 3 points." };
+            for ( const Point& point : ring ) {
+                if ( std::abs( static_cast<int64_t>( point.lat ) ) > max_lat || std::abs( static_cast<int64_t>( point.lon ) ) > max_lon ) {
+                    throw std::invalid_argument{ "a geofence point is not a latitude and longitude." };
+                }
+                min_lat_ = std::min<int64_t>( min_lat_, point.lat );
+                min_lon_ = std::min<int64_t>( min_lon_, point.lon );
+                top = std::max<int64_t>( top, point.lat );
+                right = std::max<int64_t>( right, point.lon );
+            }
+        }
+    }
+
+    int64_t n = static_cast<int64_t>( cells_ );
+    cell_lat_ = std::max<int64_t>( 1, ( top - min_lat_ + n ) / n );
+    cell_lon_ = std::max<int64_t>( 1, ( right - min_lon_ + n ) / n );
+
+    // each edge is listed in every row it reaches; the cells of its bounding box are boundary cells.
+    for ( uint32_t id = 0; id < polygons.size(); ++id ) {
+        for ( const Ring& ring : polygons[id] ) {
+            for ( std::size_t i = 0; i < ring.size(); ++i ) {
+                const Point& a = ring[i];
+                const Point& b = ring[ ( i + 1 ) % ring.size() ];
+                if ( a.lat == b.lat && a.lon == b.lon ) continue;
+
+                std::size_t row1 = clamp_index( std::min( a.lat, b.lat ) - min_lat_, cell_lat_, cells_ );
+                std::size_t row2 = clamp_index( std::max( a.lat, b.lat ) - min_lat_, cell_lat_, cells_ );
+                std::size_t col1 = clamp_index( std::min( a.lon, b.lon ) - min_lon_, cell_lon_, cells_ );
+                std::size_t col2 = clamp_index( std::max( a.lon, b.lon ) - min_lon_, cell_lon_, cells_ );
+
+                for ( std::size_t row = row1; row <= row2; ++row ) {
+                    rows_[row].push_back( Edge{ a.lat, a.lon, b.lat, b.lon, id } );
+                    for ( std::size_t col = col1; col <= col2; ++col ) states_[ row * cells_ + col ] = BOUNDARY;
+                }
+                ++edges_;
+            }
+        }
+    }
+
+    // a cell without edges is on one side of every edge; its center decides.
+    for ( std::size_t row = 0; row < cells_; ++row ) {
+        int32_t lat = static_cast<int32_t>( min_lat_ + static_cast<int64_t>( row ) * cell_lat_ + cell_lat_ / 2 );
+        for ( std::size_t col = 0; col < cells_; ++col ) {
+            uint8_t& state = states_[ row * cells_ + col ];
+            if ( state == BOUNDARY ) continue;
+            int32_t lon = static_cast<int32_t>( min_lon_ + static_cast<int64_t>( col ) * cell_lon_ + cell_lon_ / 2 );
+            state = row_contains( row, lat, lon ) ? INSIDE : OUTSIDE;
+        }
+    }
+}
+
+std::shared_ptr<const GeofenceIndex> GeofenceIndex::from_geojson( const std::string& json, std::size_t cells ) {
+    rapidjson::Document doc;
+    doc.Parse( json.data(), json.size() );
+    if ( doc.HasParseError() || !doc.IsObject() ) throw std::invalid_argument{ "the geofence is not a GeoJSON object." };
+
+    std::vector<Polygon> polygons;
+    collect( doc, polygons );
+
+    return std::make_shared<const GeofenceIndex>( polygons, cells );
+}
+
+std::shared_ptr<const GeofenceIndex> GeofenceIndex::load( const std::string& path, std::size_t cells ) {
+    std::ifstream file{ path, std::ios::binary };
+    if ( !file ) throw std::invalid_argument{ "cannot read the geofence file " + path };
+
+    std::string json{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    return from_geojson( json, cells );
+}
+
+bool GeofenceIndex::contains( int32_t lat, int32_t lon ) const {
+    int64_t dlat = static_cast<int64_t>( lat ) - min_lat_;
+    int64_t dlon = static_cast<int64_t>( lon ) - min_lon_;
+    if ( dlat < 0 || dlon < 0 ) return false;
+
+    std::size_t row = static_cast<std::size_t>( dlat / cell_lat_ );
+    std::size_t col = static_cast<std::size_t>( dlon / cell_lon_ );
+    if ( row >= cells_ || col >= cells_ ) return false;
+
+    uint8_t state = states_[ row * cells_ + col ];
+    if ( state != BOUNDARY ) return state == INSIDE;
+
+    return row_contains( row, lat, lon );
+}
+
+std::size_t GeofenceIndex::polygons() const {
+    return polygons_;
+}
+
+std::size_t GeofenceIndex::edges() const {
+    return edges_;
+}
+
+bool GeofenceIndex::row_contains( std::size_t row, int32_t lat, int32_t lon ) const {
+    // a ray to the east crosses the edges of a polygon an odd number of times when the point is inside it; the edges
+    // of the row are grouped by polygon. The products fit in 64 bits for every latitude and longitude.
+    bool inside = false;
+    uint32_t polygon = 0;
+
+    for ( const Edge& e : rows_[row] ) {
+        if ( e.polygon != polygon ) {
+            if ( inside ) return true;
+            polygon = e.polygon;
+        }
+
+        if ( ( e.lat1 > lat ) == ( e.lat2 > lat ) ) continue;
+
+        int64_t height = static_cast<int64_t>( e.lat2 ) - e.lat1;
+        int64_t west = ( static_cast<int64_t>( lon ) - e.lon1 ) * height;
+        int64_t crossing = ( static_cast<int64_t>( lat ) - e.lat1 ) * ( static_cast<int64_t>( e.lon2 ) - e.lon1 );
+
+        if ( height > 0 ? west < crossing : west > crossing ) inside = !inside;
+    }
+
+    return inside;
+}
+
+GeofenceFilter::GeofenceFilter( std::shared_ptr<const GeofenceIndex> index, Verdict outside ) :
+    index_{ std::move( index ) }
+    , outside_{ outside }
+{}
+
+BsmFilter::Verdict GeofenceFilter::test( const bsm_fast_path::Bsm& bsm ) {
+    return index_->contains( bsm.lat, bsm.lon ) ? Verdict::PASS : outside_;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "hex_codec.hpp"
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ACM_HEX_AVX2 1
+#define ACM_HEX_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define ACM_HEX_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ACM_HEX_NEON 1
+#endif
+
+namespace hex_codec {
+
+namespace {
+
+    const char digits[] = "0123456789ABCDEF";
+
+    // nibble value of each character; 0xFF marks a character that is not a hex digit.
+    struct DecodeTable {
+        uint8_t value[256];
+
+        DecodeTable() {
+            for ( int i = 0; i < 256; ++i ) value[i] = 0xFF;
+            for ( int i = 0; i < 10; ++i ) value['0' + i] = static_cast<uint8_t>( i );
+            for ( int i = 0; i < 6; ++i ) {
+                value['A' + i] = static_cast<uint8_t>( 10 + i );
+                value['a' + i] = static_cast<uint8_t>( 10 + i );
+            }
+        }
+    };
+
+    const DecodeTable decode_table;
+
+    void encode_scalar( const uint8_t* in, std::size_t length, char* out )
+    {
+        for ( std::size_t i = 0; i < length; ++i ) {
+            out[2*i]   = digits[ in[i] >> 4 ];
+            out[2*i+1] = digits[ in[i] & 0x0F ];
+        }
+    }
+
+    // returns npos or the offset (relative to hex) of the first bad character.
+    std::size_t decode_scalar( const char* hex, std::size_t length, uint8_t* out )
+    {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>( hex );
+        std::size_t i = 0;
+
+        for ( ; i + 1 < length; i += 2 ) {
+            uint8_t h = decode_table.value[ in[i] ];
+            uint8_t l = decode_table.value[ in[i+1] ];
+            if ( ( h | l ) & 0xF0 ) return ( h & 0xF0 ) ? i : i + 1;
+            *out++ = static_cast<uint8_t>( ( h << 4 ) | l );
+        }
+
+        if ( i < length ) {
+            // odd length; the last character is the high order nibble.
+            uint8_t h = decode_table.value[ in[i] ];
+            if ( h & 0xF0 ) return i;
+            *out = static_cast<uint8_t>( h << 4 );
+        }
+
+        return npos;
+    }
+
+#if defined(ACM_HEX_SSE2)
+
+    // 16 bytes into 32 characters.
+    inline void encode_sse2( const uint8_t* in, char* out )
+    {
+        const __m128i mask = _mm_set1_epi8( 0x0F );
+        const __m128i nine = _mm_set1_epi8( 9 );
+        const __m128i zero = _mm_set1_epi8( '0' );
+        const __m128i gap  = _mm_set1_epi8( 'A' - '0' - 10 );
+
+        __m128i v  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in ) );
+        __m128i hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), mask );
+        __m128i lo = _mm_and_si128( v, mask );
+
+        hi = _mm_add_epi8( _mm_add_epi8( hi, zero ), _mm_and_si128( _mm_cmpgt_epi8( hi, nine ), gap ) );
+        lo = _mm_add_epi8( _mm_add_epi8( lo, zero ), _mm_and_si128( _mm_cmpgt_epi8( lo, nine ), gap ) );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out ),      _mm_unpacklo_epi8( hi, lo ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 16 ), _mm_unpackhi_epi8( hi, lo ) );
+    }
+
+    // 16 characters into 16 nibbles; valid is set to the movemask of the hex digit lanes.
+    inline __m128i nibbles_sse2( __m128i v, int& valid )
+    {
+        // signed compares are safe: every byte >= 0x80 falls outside both ranges.
+        const __m128i neg  = _mm_set1_epi8( -1 );
+        const __m128i ten  = _mm_set1_epi8( 10 );
+        const __m128i six  = _mm_set1_epi8( 6 );
+
+        __m128i d  = _mm_sub_epi8( v, _mm_set1_epi8( '0' ) );
+        __m128i l  = _mm_sub_epi8( _mm_or_si128( v, _mm_set1_epi8( 0x20 ) ), _mm_set1_epi8( 'a' ) );
+        __m128i isd = _mm_and_si128( _mm_cmpgt_epi8( d, neg ), _mm_cmplt_epi8( d, ten ) );
+        __m128i isl = _mm_and_si128( _mm_cmpgt_epi8( l, neg ), _mm_cmplt_epi8( l, six ) );
+
+        valid = _mm_movemask_epi8( _mm_or_si128( isd, isl ) );
+        return _mm_or_si128( _mm_and_si128( d, isd ), _mm_and_si128( _mm_add_epi8( l, ten ), isl ) );
+    }
+
+    // combine the (high, low) nibble pairs in each 16 bit lane into a byte in the low half of the lane.
+    inline __m128i pairs_sse2( __m128i n )
+    {
+        return _mm_or_si128( _mm_slli_epi16( _mm_and_si128( n, _mm_set1_epi16( 0x00FF ) ), 4 ), _mm_srli_epi16( n, 8 ) );
+    }
+
+    // 32 characters into 16 bytes; false if any character is not a hex digit.
+    inline bool decode_sse2( const char* hex, uint8_t* out )
+    {
+        int va, vb;
+        __m128i a = nibbles_sse2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( hex ) ), va );
+        __m128i b = nibbles_sse2( _mm_loadu_si128( reinterpret_cast<const __m128i*>( hex + 16 ) ), vb );
+        if ( ( va & vb ) != 0xFFFF ) return false;
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), _mm_packus_epi16( pairs_sse2( a ), pairs_sse2( b ) ) );
+        return true;
+    }
+
+#endif
+
+#if defined(ACM_HEX_AVX2)
+
+    // 32 bytes into 64 characters.
+    inline void encode_avx2( const uint8_t* in, char* out )
+    {
+        const __m256i mask = _mm256_set1_epi8( 0x0F );
+        const __m256i nine = _mm256_set1_epi8( 9 );
+        const __m256i zero = _mm256_set1_epi8( '0' );
+        const __m256i gap  = _mm256_set1_epi8( 'A' - '0' - 10 );
+
+        __m256i v  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in ) );
+        __m256i hi = _mm256_and_si256( _mm256_srli_epi16( v, 4 ), mask );
+        __m256i lo = _mm256_and_si256( v, mask );
+
+        hi = _mm256_add_epi8( _mm256_add_epi8( hi, zero ), _mm256_and_si256( _mm256_cmpgt_epi8( hi, nine ), gap ) );
+        lo = _mm256_add_epi8( _mm256_add_epi8( lo, zero ), _mm256_and_si256( _mm256_cmpgt_epi8( lo, nine ), gap ) );
+
+        // the unpacks work within each 128 bit lane; reorder the lanes so the output is sequential.
+        __m256i a = _mm256_unpacklo_epi8( hi, lo );
+        __m256i b = _mm256_unpackhi_epi8( hi, lo );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out ),      _mm256_permute2x128_si256( a, b, 0x20 ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + 32 ), _mm256_permute2x128_si256( a, b, 0x31 ) );
+    }
+
+    inline __m256i nibbles_avx2( __m256i v, uint32_t& valid )
+    {
+        const __m256i neg  = _mm256_set1_epi8( -1 );
+        const __m256i ten  = _mm256_set1_epi8( 10 );
+        const __m256i six  = _mm256_set1_epi8( 6 );
+
+        __m256i d  = _mm256_sub_epi8( v, _mm256_set1_epi8( '0' ) );
+        __m256i l  = _mm256_sub_epi8( _mm256_or_si256( v, _mm256_set1_epi8( 0x20 ) ), _mm256_set1_epi8( 'a' ) );
+        __m256i isd = _mm256_and_si256( _mm256_cmpgt_epi8( d, neg ), _mm256_cmpgt_epi8( ten, d ) );
+        __m256i isl = _mm256_and_si256( _mm256_cmpgt_epi8( l, neg ), _mm256_cmpgt_epi8( six, l ) );
+
+        valid = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_or_si256( isd, isl ) ) );
+        return _mm256_or_si256( _mm256_and_si256( d, isd ), _mm256_and_si256( _mm256_add_epi8( l, ten ), isl ) );
+    }
+
+    inline __m256i pairs_avx2( __m256i n )
+    {
+        return _mm256_or_si256( _mm256_slli_epi16( _mm256_and_si256( n, _mm256_set1_epi16( 0x00FF ) ), 4 ), _mm256_srli_epi16( n, 8 ) );
+    }
+
+    // 64 characters into 32 bytes.
+    inline bool decode_avx2( const char* hex, uint8_t* out )
+    {
+        uint32_t va, vb;
+        __m256i a = nibbles_avx2( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( hex ) ), va );
+        __m256i b = nibbles_avx2( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( hex + 32 ) ), vb );
+        if ( ( va & vb ) != 0xFFFFFFFFu ) return false;
+
+        // the pack interleaves the 64 bit quarters of a and b; put them back in order.
+        __m256i r = _mm256_packus_epi16( pairs_avx2( a ), pairs_avx2( b ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out ), _mm256_permute4x64_epi64( r, 0xD8 ) );
+        return true;
+    }
+
+#endif
+
+#if defined(ACM_HEX_NEON)
+
+    inline uint8x16_t to_digits_neon( uint8x16_t n )
+    {
+        uint8x16_t r = vaddq_u8( n, vdupq_n_u8( '0' ) );
+        return vaddq_u8( r, vandq_u8( vcgtq_u8( n, vdupq_n_u8( 9 ) ), vdupq_n_u8( 'A' - '0' - 10 ) ) );
+    }
+
+    // 16 bytes into 32 characters.
+    inline void encode_neon( const uint8_t* in, char* out )
+    {
+        uint8x16_t v = vld1q_u8( in );
+        uint8x16x2_t r;
+        r.val[0] = to_digits_neon( vshrq_n_u8( v, 4 ) );
+        r.val[1] = to_digits_neon( vandq_u8( v, vdupq_n_u8( 0x0F ) ) );
+        vst2q_u8( reinterpret_cast<uint8_t*>( out ), r );           // interleaves high and low characters.
+    }
+
+    // unsigned compares: characters below the range wrap to large values.
+    inline uint8x16_t nibbles_neon( uint8x16_t v, uint8x16_t& valid )
+    {
+        uint8x16_t d = vsubq_u8( v, vdupq_n_u8( '0' ) );
+        uint8x16_t l = vsubq_u8( vorrq_u8( v, vdupq_n_u8( 0x20 ) ), vdupq_n_u8( 'a' ) );
+        uint8x16_t isd = vcltq_u8( d, vdupq_n_u8( 10 ) );
+        uint8x16_t isl = vcltq_u8( l, vdupq_n_u8( 6 ) );
+
+        valid = vorrq_u8( isd, isl );
+        return vorrq_u8( vandq_u8( d, isd ), vandq_u8( vaddq_u8( l, vdupq_n_u8( 10 ) ), isl ) );
+    }
+
+    // 32 characters into 16 bytes.
+    inline bool decode_neon( const char* hex, uint8_t* out )
+    {
+        uint8x16x2_t v = vld2q_u8( reinterpret_cast<const uint8_t*>( hex ) );   // even (high) and odd (low) characters.
+        uint8x16_t vh, vl;
+        uint8x16_t h = nibbles_neon( v.val[0], vh );
+        uint8x16_t l = nibbles_neon( v.val[1], vl );
+
+        uint8x16_t valid = vandq_u8( vh, vl );
+        uint8x8_t folded = vand_u8( vget_low_u8( valid ), vget_high_u8( valid ) );
+        if ( vget_lane_u64( vreinterpret_u64_u8( folded ), 0 ) != ~static_cast<uint64_t>( 0 ) ) return false;
+
+        vst1q_u8( out, vorrq_u8( vshlq_n_u8( h, 4 ), l ) );
+        return true;
+    }
+
+#endif
+
+}   // namespace
+
+const char* implementation()
+{
+#if defined(ACM_HEX_AVX2)
+    return "avx2";
+#elif defined(ACM_HEX_SSE2)
+    return "sse2";
+#elif defined(ACM_HEX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void encode( const void* bytes, std::size_t length, char* out )
+{
+    const uint8_t* in = static_cast<const uint8_t*>( bytes );
+    std::size_t i = 0;
+
+#if defined(ACM_HEX_AVX2)
+    for ( ; i + 32 <= length; i += 32 ) encode_avx2( in + i, out + 2*i );
+#endif
+#if defined(ACM_HEX_SSE2)
+    for ( ; i + 16 <= length; i += 16 ) encode_sse2( in + i, out + 2*i );
+#elif defined(ACM_HEX_NEON)
+    for ( ; i + 16 <= length; i += 16 ) encode_neon( in + i, out + 2*i );
+#endif
+
+    encode_scalar( in + i, length - i, out + 2*i );
+}
+
+void encode( const void* bytes, std::size_t length, std::string& hex )
+{
+    hex.resize( 2 * length );
+    if ( length > 0 ) encode( bytes, length, &hex[0] );
+}
+
+std::size_t decode( const char* hex, std::size_t length, void* bytes )
+{
+    uint8_t* out = static_cast<uint8_t*>( bytes );
+    std::size_t i = 0;
+
+    // a vector block containing a bad character stops the vector loop; the scalar loop finds its exact offset.
+#if defined(ACM_HEX_AVX2)
+    for ( ; i + 64 <= length; i += 64 ) {
+        if ( !decode_avx2( hex + i, out + i/2 ) ) break;
+    }
+#endif
+#if defined(ACM_HEX_SSE2)
+    for ( ; i + 32 <= length; i += 32 ) {
+        if ( !decode_sse2( hex + i, out + i/2 ) ) break;
+    }
+#elif defined(ACM_HEX_NEON)
+    for ( ; i + 32 <= length; i += 32 ) {
+        if ( !decode_neon( hex + i, out + i/2 ) ) break;
+    }
+#endif
+
+    std::size_t r = decode_scalar( hex + i, length - i, out + i/2 );
+    return ( r == npos ) ? npos : i + r;
+}
+
+std::size_t decode( const std::string& hex, std::vector<char>& bytes )
+{
+    bytes.resize( ( hex.size() + 1 ) / 2 );
+    if ( hex.empty() ) return npos;
+    return decode( hex.data(), hex.size(), bytes.data() );
+}
+
+}   // namespace hex_codec
@@ -0,0 +1,106 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "kafka_stats.hpp"
+
+#include "rapidjson/document.h"
+
+#include <algorithm>
+
+namespace {
+
+    int64_t int_member( const rapidjson::Value& object, const char* name )
+    {
+        auto it = object.FindMember( name );
+        return it != object.MemberEnd() && it->value.IsInt64() ? it->value.GetInt64() : 0;
+    }
+}
+
+KafkaStatistics::KafkaStatistics() :
+    type{}
+    , queued_messages{ 0 }
+    , queued_bytes{ 0 }
+    , reply_queue{ 0 }
+    , consumer_lag{ 0 }
+    , fetch_queue{ 0 }
+    , rtt_avg_us{ 0 }
+    , rtt_p99_us{ 0 }
+    , brokers{ 0 }
+    , partitions{ 0 }
+{}
+
+bool KafkaStatistics::parse( const char* json, std::size_t length, KafkaStatistics& stats )
+{
+    rapidjson::Document doc;
+    doc.Parse( json, length );
+    if ( doc.HasParseError() || !doc.IsObject() ) return false;
+
+    KafkaStatistics r;
+
+    auto it = doc.FindMember( "type" );
+    if ( it != doc.MemberEnd() && it->value.IsString() ) r.type.assign( it->value.GetString(), it->value.GetStringLength() );
+
+    r.queued_messages = int_member( doc, "msg_cnt" );
+    r.queued_bytes = int_member( doc, "msg_size" );
+    r.reply_queue = int_member( doc, "replyq" );
+
+    it = doc.FindMember( "brokers" );
+    if ( it != doc.MemberEnd() && it->value.IsObject() ) {
+        for ( auto& broker : it->value.GetObject() ) {
+            if ( !broker.value.IsObject() ) continue;
+
+            auto rtt = broker.value.FindMember( "rtt" );
+            if ( rtt == broker.value.MemberEnd() || !rtt->value.IsObject() || int_member( rtt->value, "cnt" ) == 0 ) continue;
+
+            // the slowest broker bounds the produce and fetch latency.
+            r.rtt_avg_us = std::max( r.rtt_avg_us, int_member( rtt->value, "avg" ) );
+            r.rtt_p99_us = std::max( r.rtt_p99_us, int_member( rtt->value, "p99" ) );
+            ++r.brokers;
+        }
+    }
+
+    it = doc.FindMember( "topics" );
+    if ( it != doc.MemberEnd() && it->value.IsObject() ) {
+        for ( auto& topic : it->value.GetObject() ) {
+            if ( !topic.value.IsObject() ) continue;
+
+            auto partitions = topic.value.FindMember( "partitions" );
+            if ( partitions == topic.value.MemberEnd() || !partitions->value.IsObject() ) continue;
+
+            for ( auto& partition : partitions->value.GetObject() ) {
+                // partition -1 is librdkafka's internal unassigned partition.
+                if ( !partition.value.IsObject() || int_member( partition.value, "partition" ) < 0 ) continue;
+
+                r.fetch_queue += int_member( partition.value, "fetchq_cnt" );
+
+                // the lag is -1 until the partition's offsets are known.
+                int64_t lag = int_member( partition.value, "consumer_lag" );
+                if ( lag >= 0 && partition.value.HasMember( "consumer_lag" ) ) {
+                    r.consumer_lag += lag;
+                    ++r.partitions;
+                }
+            }
+        }
+    }
+
+    stats = std::move( r );
+    return true;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "latency_histogram.hpp"
+
+constexpr unsigned LatencyHistogram::sub_bucket_bits;
+constexpr std::size_t LatencyHistogram::sub_buckets;
+constexpr std::size_t LatencyHistogram::bucket_count;
+
+LatencyHistogram::Snapshot::Snapshot() :
+    counts( bucket_count, 0 )
+    , count{ 0 }
+    , sum{ 0 }
+    , max{ 0 }
+{}
+
+uint64_t LatencyHistogram::Snapshot::percentile( double p ) const
+{
+    if ( count == 0 ) return 0;
+
+    uint64_t target = static_cast<uint64_t>( p * count + 0.5 );
+    if ( target == 0 ) target = 1;
+    if ( target > count ) target = count;
+
+    uint64_t seen = 0;
+    for ( std::size_t b = 0; b < counts.size(); ++b ) {
+        seen += counts[b];
+        if ( seen >= target ) {
+            uint64_t limit = bucket_limit( b );
+            return limit < max ? limit : max;
+        }
+    }
+
+    return max;
+}
+
+uint64_t LatencyHistogram::Snapshot::mean() const
+{
+    return count ? sum / count : 0;
+}
+
+LatencyHistogram::LatencyHistogram() :
+    sum_{ 0 }
+    , max_{ 0 }
+{
+    for ( auto& c : counts_ ) c.store( 0, std::memory_order_relaxed );
+}
+
+std::size_t LatencyHistogram::bucket( uint64_t ns )
+{
+    if ( ns < sub_buckets ) return static_cast<std::size_t>( ns );
+
+    // the position of the highest set bit selects the power of two; the next sub_bucket_bits bits the bucket in it.
+    unsigned msb = 63 - __builtin_clzll( ns );
+    unsigned shift = msb - sub_bucket_bits;
+    return ( shift + 1 ) * sub_buckets + static_cast<std::size_t>( ( ns >> shift ) & ( sub_buckets - 1 ) );
+}
+
+uint64_t LatencyHistogram::bucket_limit( std::size_t bucket )
+{
+    if ( bucket < sub_buckets ) return bucket;
+
+    unsigned shift = static_cast<unsigned>( bucket / sub_buckets - 1 );
+    uint64_t lower = static_cast<uint64_t>( sub_buckets + bucket % sub_buckets ) << shift;
+    return lower + ( ( uint64_t{ 1 } << shift ) - 1 );
+}
+
+void LatencyHistogram::record( uint64_t ns )
+{
+    counts_[ bucket( ns ) ].fetch_add( 1, std::memory_order_relaxed );
+    sum_.fetch_add( ns, std::memory_order_relaxed );
+
+    uint64_t m = max_.load( std::memory_order_relaxed );
+    while ( ns > m && !max_.compare_exchange_weak( m, ns, std::memory_order_relaxed ) ) {}
+}
+
+void LatencyHistogram::take( Snapshot& snapshot )
+{
+    snapshot.count = 0;
+
+    for ( std::size_t b = 0; b < bucket_count; ++b ) {
+        snapshot.counts[b] = counts_[b].exchange( 0, std::memory_order_relaxed );
+        snapshot.count += snapshot.counts[b];
+    }
+
+    snapshot.sum = sum_.exchange( 0, std::memory_order_relaxed );
+    snapshot.max = max_.exchange( 0, std::memory_order_relaxed );
+}
+
+void LatencyHistogram::peek( Snapshot& snapshot ) const
+{
+    snapshot.count = 0;
+
+    for ( std::size_t b = 0; b < bucket_count; ++b ) {
+        snapshot.counts[b] = counts_[b].load( std::memory_order_relaxed );
+        snapshot.count += snapshot.counts[b];
+    }
+
+    snapshot.sum = sum_.load( std::memory_order_relaxed );
+    snapshot.max = max_.load( std::memory_order_relaxed );
+}
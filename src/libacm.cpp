@@ -0,0 +1,248 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "libacm.h"
+#include "acm_codec.hpp"
+#include "bsm_columns.hpp"
+#include "hex_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <ostream>
+
+namespace {
+
+    /**
+     * Writes a response into the caller's buffer and counts the bytes that do not fit, so the caller learns the size
+     * the response needs.
+     */
+    class CallerBuffer : public std::streambuf {
+        public:
+            CallerBuffer( char* output, std::size_t capacity ) : excess_{ 0 } {
+                if ( output ) setp( output, output + capacity );
+            }
+
+            std::size_t size() const { return static_cast<std::size_t>( pptr() - pbase() ) + excess_; }
+            bool overflowed() const { return excess_ > 0; }
+
+        protected:
+            std::streamsize xsputn( const char* s, std::streamsize n ) override {
+                std::streamsize fit = std::min<std::streamsize>( n, epptr() - pptr() );
+                if ( fit > 0 ) {
+                    std::memcpy( pptr(), s, static_cast<std::size_t>( fit ) );
+                    pbump( static_cast<int>( fit ) );
+                }
+                excess_ += static_cast<std::size_t>( n - fit );
+                return n;
+            }
+
+            int_type overflow( int_type c ) override {
+                if ( c != traits_type::eof() ) ++excess_;
+                return traits_type::not_eof( c );
+            }
+
+        private:
+            std::size_t excess_;
+    };
+
+    void report( char* error, std::size_t error_size, const std::string& message ) {
+        if ( !error || error_size == 0 ) return;
+        std::size_t n = std::min( message.size(), error_size - 1 );
+        std::memcpy( error, message.data(), n );
+        error[n] = '\0';
+    }
+}
+
+/**
+ * The idle codec contexts of a handle, one list for decoding and one for encoding. A call takes a context from its
+ * list, or builds one, and gives it back when the response is written.
+ */
+struct acm_handle {
+    std::string error_template;
+    acm_options options;
+
+    std::mutex lock;
+    std::vector<std::unique_ptr<CodecContext>> idle[2];     ///> [0] encode, [1] decode.
+
+    std::unique_ptr<CodecContext> make_context( bool decode ) const {
+        std::unique_ptr<CodecContext> codec{ new CodecContext{ nullptr, nullptr, decode } };
+        codec->use_xml_pool( options.xml_pool_chunk_bytes );
+        codec->use_decode_cache( options.decode_cache_bytes );
+        codec->use_encode_cache( options.encode_cache_bytes );
+        codec->set_json_output( options.json_output != 0 );
+        if ( !codec->load_error_template( error_template ) ) return nullptr;
+        return codec;
+    }
+
+    std::unique_ptr<CodecContext> borrow( bool decode ) {
+        {
+            std::lock_guard<std::mutex> guard{ lock };
+            auto& contexts = idle[decode];
+            if ( !contexts.empty() ) {
+                std::unique_ptr<CodecContext> codec = std::move( contexts.back() );
+                contexts.pop_back();
+                return codec;
+            }
+        }
+        return make_context( decode );
+    }
+
+    void give_back( std::unique_ptr<CodecContext> codec ) {
+        std::lock_guard<std::mutex> guard{ lock };
+        idle[codec->decode_functionality()].push_back( std::move( codec ) );
+    }
+
+    template <typename Process>
+    int run( bool decode, char* output, std::size_t capacity, std::size_t* written, Process process ) {
+        if ( !written || ( !output && capacity > 0 ) ) return ACM_INVALID_ARGUMENT;
+        *written = 0;
+
+        try {
+            std::unique_ptr<CodecContext> codec = borrow( decode );
+            if ( !codec ) return ACM_FAILURE;
+
+            CallerBuffer buffer{ output, capacity };
+            std::ostream os{ &buffer };
+            bool success = process( *codec, os );
+            give_back( std::move( codec ) );
+
+            *written = buffer.size();
+            if ( buffer.overflowed() ) return ACM_BUFFER_TOO_SMALL;
+            return success ? ACM_OK : ACM_ERROR_RESPONSE;
+
+        } catch ( const std::exception& ) {
+            return ACM_FAILURE;
+        }
+    }
+};
+
+void acm_options_init( acm_options* options ) {
+    if ( !options ) return;
+    options->error_template = "./config/Output.error.xml";
+    options->decode_cache_bytes = 0;
+    options->encode_cache_bytes = 0;
+    options->xml_pool_chunk_bytes = 1 << 20;
+    options->json_output = 0;
+}
+
+acm_t* acm_create( const acm_options* options, char* error, size_t error_size ) {
+    try {
+        std::unique_ptr<acm_t> acm{ new acm_t };
+        acm_options_init( &acm->options );
+        if ( options ) acm->options = *options;
+        acm->error_template = acm->options.error_template ? acm->options.error_template : "";
+        acm->options.error_template = acm->error_template.c_str();
+
+        // a first context checks the settings; it is kept for the first decode.
+        std::unique_ptr<CodecContext> codec = acm->make_context( true );
+        if ( !codec ) {
+            report( error, error_size, "cannot load the error template: " + acm->error_template );
+            return nullptr;
+        }
+        acm->idle[1].push_back( std::move( codec ) );
+        return acm.release();
+
+    } catch ( const std::exception& e ) {
+        report( error, error_size, e.what() );
+        return nullptr;
+    }
+}
+
+void acm_destroy( acm_t* acm ) {
+    delete acm;
+}
+
+int acm_decode( acm_t* acm, const void* message, size_t length, char* output, size_t capacity, size_t* written ) {
+    if ( !acm || !message ) return ACM_INVALID_ARGUMENT;
+    return acm->run( true, output, capacity, written, [&]( CodecContext& codec, std::ostream& os ) {
+        return codec.process( message, length, os );
+    });
+}
+
+int acm_encode( acm_t* acm, const void* message, size_t length, char* output, size_t capacity, size_t* written ) {
+    if ( !acm || !message ) return ACM_INVALID_ARGUMENT;
+    return acm->run( false, output, capacity, written, [&]( CodecContext& codec, std::ostream& os ) {
+        return codec.process( message, length, os );
+    });
+}
+
+int acm_decode_bytes( acm_t* acm, const void* bytes, size_t length, const char* encodings, char* output,
+        size_t capacity, size_t* written ) {
+    if ( !acm || !bytes || !encodings ) return ACM_INVALID_ARGUMENT;
+    return acm->run( true, output, capacity, written, [&]( CodecContext& codec, std::ostream& os ) {
+        return codec.process_bytes( bytes, length, encodings, std::strlen( encodings ), os );
+    });
+}
+
+int acm_decode_bsm_columns( const void* const* payloads, const size_t* lengths, size_t count,
+        acm_bsm_columns* columns, size_t* rows ) {
+    if ( !rows || !columns || ( count > 0 && ( !payloads || !lengths ) ) ) return ACM_INVALID_ARGUMENT;
+    *rows = 0;
+    if ( columns->capacity < count ) return ACM_BUFFER_TOO_SMALL;
+
+    try {
+        bsm_fast_path::Bsm bsm;
+        std::size_t row = 0;
+
+        for ( std::size_t i = 0; i < count; ++i ) {
+            if ( !payloads[i] || !BsmColumns::decode_core( payloads[i], lengths[i], bsm ) ) continue;
+
+            if ( columns->input ) columns->input[row] = static_cast<uint32_t>( i );
+            if ( columns->id ) columns->id[row] = BsmColumns::id_value( bsm );
+            if ( columns->sec_mark ) columns->sec_mark[row] = bsm.sec_mark;
+            if ( columns->lat ) columns->lat[row] = bsm.lat;
+            if ( columns->lon ) columns->lon[row] = bsm.lon;
+            if ( columns->elev ) columns->elev[row] = bsm.elev;
+            if ( columns->speed ) columns->speed[row] = bsm.speed;
+            if ( columns->heading ) columns->heading[row] = bsm.heading;
+            if ( columns->accel ) columns->accel[row] = bsm.accel_long;
+            ++row;
+        }
+
+        *rows = row;
+        return ACM_OK;
+
+    } catch ( const std::exception& ) {
+        return ACM_FAILURE;
+    }
+}
+
+void acm_hex_encode( const void* bytes, size_t length, char* out ) {
+    hex_codec::encode( bytes, length, out );
+}
+
+int acm_hex_decode( const char* hex, size_t length, void* out ) {
+    return hex_codec::decode( hex, length, out ) == hex_codec::npos ? ACM_OK : ACM_INVALID_ARGUMENT;
+}
+
+const char* acm_status_string( int status ) {
+    switch ( status ) {
+        case ACM_OK:                return "success";
+        case ACM_ERROR_RESPONSE:    return "the response is an ODE error document";
+        case ACM_BUFFER_TOO_SMALL:  return "the output buffer is too small for the response";
+        case ACM_INVALID_ARGUMENT:  return "invalid argument";
+        case ACM_FAILURE:           return "the library failed to process the call";
+        default:                    return "unknown status";
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "map_frame.hpp"
+
+namespace {
+
+    // bit offset of a frame, most significant bit first; past the end reads zeros.
+    uint32_t bits( const uint8_t* data, std::size_t length, std::size_t offset, unsigned n ) {
+        uint32_t value = 0;
+        for ( unsigned i = 0; i < n; ++i, ++offset ) {
+            std::size_t byte = offset >> 3;
+            uint32_t bit = byte < length ? ( data[byte] >> ( 7 - ( offset & 7 ) ) ) & 1 : 0;
+            value = value << 1 | bit;
+        }
+        return value;
+    }
+
+    const std::string open_tag{ "<timeStamp>" };
+    const std::string close_tag{ "</timeStamp>" };
+}
+
+bool map_frame::parse( const void* bytes, std::size_t length, Header& header ) {
+    const uint8_t* data = static_cast<const uint8_t*>( bytes );
+
+    // MessageFrame without extensions and with the messageId of a MapData (18).
+    if ( length < 4 || bits( data, length, 0, 1 ) != 0 || bits( data, length, 1, 15 ) != 18 ) return false;
+
+    // the open type length; the fragmented lengths of 16K and more are left to asn1c.
+    std::size_t offset = 16;
+    std::size_t value_bytes;
+    if ( bits( data, length, offset, 1 ) == 0 ) {
+        value_bytes = bits( data, length, offset + 1, 7 );
+        offset += 8;
+    } else if ( bits( data, length, offset + 1, 1 ) == 0 ) {
+        value_bytes = bits( data, length, offset + 2, 14 );
+        offset += 16;
+    } else {
+        return false;
+    }
+
+    header.bytes = offset / 8 + value_bytes;
+    if ( value_bytes < 1 || header.bytes > length ) return false;
+
+    // MapData: the extension bit, then the presence bits of its 8 optional components; timeStamp is the first.
+    header.has_time_stamp = bits( data, length, offset + 1, 1 ) != 0;
+    offset += 9;
+
+    header.time_stamp_bit = offset;
+    if ( header.has_time_stamp ) {
+        header.time_stamp = bits( data, length, offset, 20 );
+        if ( header.time_stamp > 527040 ) return false;
+        offset += 20;
+    } else {
+        header.time_stamp = 0;
+    }
+
+    header.revision = static_cast<uint8_t>( bits( data, length, offset, 7 ) );
+    return offset + 7 <= header.bytes * 8;
+}
+
+void map_frame::revision_key( const void* bytes, const Header& header, std::string& key ) {
+    key.assign( static_cast<const char*>( bytes ), header.bytes );
+    if ( !header.has_time_stamp ) return;
+
+    for ( std::size_t offset = header.time_stamp_bit; offset < header.time_stamp_bit + 20; ++offset ) {
+        key[ offset >> 3 ] = static_cast<char>( key[ offset >> 3 ] & ~( 0x80 >> ( offset & 7 ) ) );
+    }
+}
+
+bool map_frame::restamp( const std::string& cached, const Header& header, std::string& xer ) {
+    std::size_t begin = cached.find( open_tag );
+    if ( ( begin != std::string::npos ) != header.has_time_stamp ) return false;
+
+    if ( !header.has_time_stamp ) {
+        xer.append( cached );
+        return true;
+    }
+
+    begin += open_tag.size();
+    std::size_t end = cached.find( close_tag, begin );
+    if ( end == std::string::npos ) return false;
+
+    xer.append( cached, 0, begin );
+    xer.append( std::to_string( header.time_stamp ) );
+    xer.append( cached, end, std::string::npos );
+    return true;
+}
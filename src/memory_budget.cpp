@@ -0,0 +1,162 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "memory_budget.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+    const char* component_names[] = { "batch", "queues", "caches", "arenas" };
+
+    const uint32_t default_percent[] = { 10, 40, 30, 20 };
+}
+
+const char* MemoryBudget::name( Component c ) {
+    return component_names[ static_cast<std::size_t>( c ) ];
+}
+
+MemoryBudget::MemoryBudget( std::size_t total ) :
+    total_{ total }
+    , waiting_{ 0 }
+{
+    for ( std::size_t i = 0; i < components; ++i ) {
+        percent_[i] = default_percent[i];
+        in_use_[i] = 0;
+        high_water_[i] = 0;
+    }
+}
+
+void MemoryBudget::set_total( std::size_t total, const std::string& split ) {
+    uint32_t percent[components] = {};
+    uint32_t sum = 0;
+    std::size_t begin = 0;
+
+    while ( !split.empty() && begin <= split.size() ) {
+        std::size_t end = split.find( ',', begin );
+        if ( end == std::string::npos ) end = split.size();
+
+        std::string item = split.substr( begin, end - begin );
+        std::size_t equals = item.find( '=' );
+        std::string component = item.substr( 0, equals );
+
+        std::size_t k = 0;
+        while ( k < components && component != component_names[k] ) ++k;
+        if ( k == components ) {
+            throw std::invalid_argument{ "unknown component in the memory budget split: " + component + "; use batch, queues, caches, or arenas" };
+        }
+
+        std::size_t digits = 0;
+        unsigned long value = 0;
+        std::string text = equals == std::string::npos ? "" : item.substr( equals + 1 );
+        try {
+            value = std::stoul( text, &digits );
+        } catch ( const std::exception& ) {
+            digits = 0;
+        }
+        if ( text.empty() || digits != text.size() || value > 100 ) {
+            throw std::invalid_argument{ "bad percent in the memory budget split: " + item };
+        }
+
+        percent[k] = static_cast<uint32_t>( value );
+        sum += percent[k];
+        begin = end + 1;
+    }
+
+    if ( sum > 100 ) {
+        throw std::invalid_argument{ "the memory budget split is over 100%: " + split };
+    }
+
+    if ( !split.empty() ) {
+        for ( std::size_t i = 0; i < components; ++i ) percent_[i] = percent[i];
+    }
+    total_ = total;
+
+    // a larger share may let the waiting reservations through.
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    released_.notify_all();
+}
+
+std::size_t MemoryBudget::total() const {
+    return total_;
+}
+
+std::size_t MemoryBudget::limit( Component c ) const {
+    std::size_t total = total_;
+    return total == 0 ? 0 : total / 100 * percent_[ static_cast<std::size_t>( c ) ] + total % 100 * percent_[ static_cast<std::size_t>( c ) ] / 100;
+}
+
+bool MemoryBudget::add( Component c, std::size_t bytes, bool limited ) {
+    std::size_t i = static_cast<std::size_t>( c );
+    std::size_t limit = limited ? this->limit( c ) : 0;
+    std::size_t used = in_use_[i].load();
+
+    // sequentially consistent with the count of waiting reservations, so a release never misses a waiter.
+    do {
+        if ( limit > 0 && used > 0 && used + bytes > limit ) return false;
+    } while ( !in_use_[i].compare_exchange_weak( used, used + bytes ) );
+
+    std::size_t high = high_water_[i].load( std::memory_order_relaxed );
+    while ( used + bytes > high && !high_water_[i].compare_exchange_weak( high, used + bytes, std::memory_order_relaxed ) ) {}
+    return true;
+}
+
+bool MemoryBudget::try_reserve( Component c, std::size_t bytes ) {
+    return add( c, bytes, true );
+}
+
+void MemoryBudget::reserve( Component c, std::size_t bytes ) {
+    if ( add( c, bytes, true ) ) return;
+
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    ++waiting_;
+    // the releases notify under the lock, so none is missed between the check and the wait.
+    while ( !add( c, bytes, true ) ) {
+        released_.wait( lock );
+    }
+    --waiting_;
+}
+
+void MemoryBudget::release( Component c, std::size_t bytes ) {
+    in_use_[ static_cast<std::size_t>( c ) ].fetch_sub( bytes );
+
+    if ( waiting_.load() > 0 ) {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        released_.notify_all();
+    }
+}
+
+void MemoryBudget::adjust( Component c, std::size_t from, std::size_t to ) {
+    if ( to > from ) {
+        add( c, to - from, false );
+    } else if ( from > to ) {
+        release( c, from - to );
+    }
+}
+
+std::size_t MemoryBudget::in_use( Component c ) const {
+    return in_use_[ static_cast<std::size_t>( c ) ].load( std::memory_order_relaxed );
+}
+
+std::size_t MemoryBudget::high_water( Component c ) const {
+    return high_water_[ static_cast<std::size_t>( c ) ].load( std::memory_order_relaxed );
+}
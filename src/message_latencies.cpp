@@ -0,0 +1,102 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "message_latencies.hpp"
+
+namespace {
+
+    std::atomic<uint64_t> generations{ 0 };
+
+    // a thread's copy of the lookups of the last MessageLatencies it used; one of another object is dropped.
+    struct Lookups {
+        uint64_t generation = 0;
+        std::map<std::pair<std::string, int32_t>, MessageLatencies::Partition*> partitions;
+        std::map<std::string, LatencyHistogram*> delivery;
+    };
+
+    Lookups& lookups( uint64_t generation ) {
+        thread_local Lookups cached;
+        if ( cached.generation != generation ) {
+            cached.partitions.clear();
+            cached.delivery.clear();
+            cached.generation = generation;
+        }
+        return cached;
+    }
+}
+
+MessageLatencies::MessageLatencies() :
+    generation_{ ++generations }
+    , mutex_{}
+    , partitions_{}
+    , delivery_{}
+    , snapshot_{}
+{}
+
+MessageLatencies::Partition& MessageLatencies::partition( const std::string& topic, int32_t partition )
+{
+    Lookups& cached = lookups( generation_ );
+    auto key = std::make_pair( topic, partition );
+
+    auto found = cached.partitions.find( key );
+    if ( found != cached.partitions.end() ) return *found->second;
+
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    std::unique_ptr<Partition>& p = partitions_[ key ];
+    if ( !p ) p.reset( new Partition{} );
+    cached.partitions.emplace( std::move( key ), p.get() );
+    return *p;
+}
+
+LatencyHistogram& MessageLatencies::delivery( const std::string& topic )
+{
+    Lookups& cached = lookups( generation_ );
+
+    auto found = cached.delivery.find( topic );
+    if ( found != cached.delivery.end() ) return *found->second;
+
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    std::unique_ptr<LatencyHistogram>& h = delivery_[ topic ];
+    if ( !h ) h.reset( new LatencyHistogram{} );
+    cached.delivery.emplace( topic, h.get() );
+    return *h;
+}
+
+void MessageLatencies::take( const Visitor& visit )
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    for ( auto& p : partitions_ ) {
+        std::string key = p.first.first + ":" + std::to_string( p.first.second );
+
+        p.second->kafka.take( snapshot_ );
+        if ( snapshot_.count > 0 ) visit( key, "kafka", snapshot_ );
+
+        p.second->acm.take( snapshot_ );
+        if ( snapshot_.count > 0 ) visit( key, "acm", snapshot_ );
+    }
+
+    for ( auto& d : delivery_ ) {
+        d.second->take( snapshot_ );
+        if ( snapshot_.count > 0 ) visit( d.first, "delivery", snapshot_ );
+    }
+}
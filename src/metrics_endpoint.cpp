@@ -0,0 +1,283 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "metrics_endpoint.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    // the headers of a request are read up to this size; a scrape sends a few hundred bytes.
+    const std::size_t max_request = 8192;
+
+    std::string format( double value )
+    {
+        if ( std::isnan( value ) ) return "NaN";
+        if ( std::isinf( value ) ) return value > 0 ? "+Inf" : "-Inf";
+
+        char buffer[32];
+        if ( value == std::floor( value ) && std::fabs( value ) < 9007199254740992.0 ) {
+            std::snprintf( buffer, sizeof( buffer ), "%lld", static_cast<long long>( value ) );
+        } else {
+            std::snprintf( buffer, sizeof( buffer ), "%.9g", value );
+        }
+        return buffer;
+    }
+
+    bool send_all( int fd, const std::string& data )
+    {
+        std::size_t sent = 0;
+        while ( sent < data.size() ) {
+            ssize_t n = ::send( fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) return false;
+            sent += static_cast<std::size_t>( n );
+        }
+        return true;
+    }
+}
+
+void MetricsText::family( const std::string& name, const char* type, const char* help )
+{
+    text_ += "# HELP " + name + ' ' + help + '\n';
+    text_ += "# TYPE " + name + ' ' + type + '\n';
+}
+
+void MetricsText::sample( const std::string& name, double value )
+{
+    text_ += name + ' ' + format( value ) + '\n';
+}
+
+void MetricsText::sample( const std::string& name, const Labels& labels, double value )
+{
+    text_ += name;
+    char separator = '{';
+    for ( const auto& label : labels ) {
+        text_ += separator;
+        text_ += label.first + "=\"";
+        for ( char c : label.second ) {
+            if ( c == '\\' || c == '"' ) {
+                text_ += '\\';
+                text_ += c;
+            } else if ( c == '\n' ) {
+                text_ += "\\n";
+            } else {
+                text_ += c;
+            }
+        }
+        text_ += '"';
+        separator = ',';
+    }
+    if ( !labels.empty() ) text_ += '}';
+    text_ += ' ' + format( value ) + '\n';
+}
+
+const std::string& MetricsText::str() const
+{
+    return text_;
+}
+
+MetricsEndpoint::MetricsEndpoint( const std::string& host, uint16_t port ) :
+    host_{ host }
+    , port_{ port }
+    , fd_{ -1 }
+    , running_{ false }
+    , thread_{}
+    , page_{}
+    , mutex_{}
+{}
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+    close();
+}
+
+bool MetricsEndpoint::open()
+{
+    if ( fd_ >= 0 ) return true;
+
+    // without a host the IPv6 wildcard also accepts IPv4; a host without IPv6 is left with the IPv4 wildcard.
+    bool bound = host_.empty() ? ( bind_to( AF_INET6 ) || bind_to( AF_INET ) ) : bind_to( AF_UNSPEC );
+    if ( !bound ) return false;
+
+    running_ = true;
+    thread_ = std::thread{ &MetricsEndpoint::serve, this };
+    return true;
+}
+
+void MetricsEndpoint::close()
+{
+    running_ = false;
+    if ( thread_.joinable() ) thread_.join();
+
+    if ( fd_ >= 0 ) {
+        ::close( fd_ );
+        fd_ = -1;
+    }
+}
+
+uint16_t MetricsEndpoint::port() const
+{
+    return fd_ >= 0 ? port_ : 0;
+}
+
+void MetricsEndpoint::publish( std::string page )
+{
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    page_.swap( page );
+}
+
+double MetricsEndpoint::drain_seconds( double lag, double consumed_per_s, double lag_per_s, double busy_ratio )
+{
+    if ( lag <= 0 ) return 0;
+    if ( consumed_per_s <= 0 || busy_ratio <= 0 ) return std::numeric_limits<double>::infinity();
+
+    // the threads could consume consumed_per_s / busy_ratio at full utilization; what arrives meanwhile is the rate
+    // consumed plus the growth of the backlog.
+    double spare = consumed_per_s / std::min( busy_ratio, 1.0 ) - ( consumed_per_s + lag_per_s );
+    return spare > 0 ? lag / spare : std::numeric_limits<double>::infinity();
+}
+
+bool MetricsEndpoint::bind_to( int family )
+{
+    struct addrinfo hints;
+    std::memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+    struct addrinfo* addresses = nullptr;
+    std::string service = std::to_string( port_ );
+    if ( getaddrinfo( host_.empty() ? nullptr : host_.c_str(), service.c_str(), &hints, &addresses ) != 0 ) {
+        errno = EADDRNOTAVAIL;
+        return false;
+    }
+
+    int e = EADDRNOTAVAIL;
+    for ( struct addrinfo* a = addresses; a != nullptr; a = a->ai_next ) {
+        fd_ = ::socket( a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol );
+        if ( fd_ < 0 ) {
+            e = errno;
+            continue;
+        }
+
+        // a restarted ACM binds its port again while the connections of the last one are in TIME_WAIT.
+        int on = 1;
+        int off = 0;
+        setsockopt( fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+        if ( a->ai_family == AF_INET6 ) setsockopt( fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof( off ) );
+
+        if ( ::bind( fd_, a->ai_addr, a->ai_addrlen ) == 0 && ::listen( fd_, 16 ) == 0 ) break;
+
+        e = errno;
+        ::close( fd_ );
+        fd_ = -1;
+    }
+    freeaddrinfo( addresses );
+
+    if ( fd_ < 0 ) {
+        errno = e;
+        return false;
+    }
+
+    // the port the kernel chose, when it was 0.
+    struct sockaddr_storage address;
+    socklen_t length = sizeof( address );
+    if ( getsockname( fd_, reinterpret_cast<struct sockaddr*>( &address ), &length ) == 0 ) {
+        if ( address.ss_family == AF_INET6 ) {
+            port_ = ntohs( reinterpret_cast<struct sockaddr_in6*>( &address )->sin6_port );
+        } else if ( address.ss_family == AF_INET ) {
+            port_ = ntohs( reinterpret_cast<struct sockaddr_in*>( &address )->sin_port );
+        }
+    }
+    return true;
+}
+
+void MetricsEndpoint::serve()
+{
+    while ( running_ ) {
+        // woken every 200 ms to notice close().
+        struct pollfd pfd{ fd_, POLLIN, 0 };
+        if ( poll( &pfd, 1, 200 ) <= 0 ) continue;
+
+        int client = ::accept4( fd_, nullptr, nullptr, SOCK_CLOEXEC );
+        if ( client < 0 ) continue;
+
+        answer( client );
+        ::close( client );
+    }
+}
+
+void MetricsEndpoint::answer( int fd )
+{
+    // a client that stops sending or reading cannot hold the endpoint for long.
+    struct timeval timeout{ 1, 0 };
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof( timeout ) );
+
+    std::string request;
+    char buffer[1024];
+    while ( request.size() < max_request && request.find( "\r\n\r\n" ) == std::string::npos && request.find( "\n\n" ) == std::string::npos ) {
+        ssize_t n = ::recv( fd, buffer, sizeof( buffer ), 0 );
+        if ( n < 0 && errno == EINTR ) continue;
+        if ( n <= 0 ) break;
+        request.append( buffer, static_cast<std::size_t>( n ) );
+    }
+
+    // the request line: method, target, version.
+    std::size_t end = request.find_first_of( "\r\n" );
+    std::string line = request.substr( 0, end );
+    std::size_t space = line.find( ' ' );
+    std::string method = line.substr( 0, space );
+    std::string target = space == std::string::npos ? std::string{} : line.substr( space + 1, line.find( ' ', space + 1 ) - space - 1 );
+    target = target.substr( 0, target.find( '?' ) );
+
+    std::string status = "200 OK";
+    std::string body;
+    if ( method != "GET" && method != "HEAD" ) {
+        status = "405 Method Not Allowed";
+    } else if ( target != "/metrics" ) {
+        status = "404 Not Found";
+    } else {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        body = page_;
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + std::to_string( body.size() ) + "\r\n"
+        "Connection: close\r\n\r\n";
+    if ( method != "HEAD" ) response += body;
+    send_all( fd, response );
+}
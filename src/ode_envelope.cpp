@@ -0,0 +1,313 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "ode_envelope.hpp"
+
+#include <cstring>
+
+namespace {
+
+    inline bool is_space( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline bool all_space( const char* begin, const char* end )
+    {
+        while ( begin < end && is_space( *begin ) ) ++begin;
+        return begin == end;
+    }
+
+    inline bool equals( const OdeEnvelope::Range& r, const char* s )
+    {
+        std::size_t n = std::strlen( s );
+        return r.size == n && std::memcmp( r.begin, s, n ) == 0;
+    }
+
+    inline bool equals( const OdeEnvelope::Range& a, const OdeEnvelope::Range& b )
+    {
+        return a.size == b.size && std::memcmp( a.begin, b.begin, a.size ) == 0;
+    }
+
+    // trims the text like parse_trim_pcdata; entity references would need decoding, so they are refused.
+    inline bool text( const char* begin, const char* end, OdeEnvelope::Range& r )
+    {
+        while ( begin < end && is_space( *begin ) ) ++begin;
+        while ( end > begin && is_space( end[-1] ) ) --end;
+        if ( std::memchr( begin, '&', end - begin ) ) return false;
+        r = OdeEnvelope::Range{ begin, static_cast<std::size_t>( end - begin ) };
+        return true;
+    }
+
+    // the '>' ending the tag that starts at p; quoted attribute values may contain '>'.
+    inline const char* tag_end( const char* p, const char* end )
+    {
+        char quote = 0;
+        for ( ; p < end; ++p ) {
+            if ( quote ) {
+                if ( *p == quote ) quote = 0;
+            } else if ( *p == '"' || *p == '\'' ) {
+                quote = *p;
+            } else if ( *p == '>' ) {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    // the value of the attribute name in the attributes of a start tag, [p, end); begin is null when it is absent.
+    inline OdeEnvelope::Range attribute( const char* p, const char* end, const char* name )
+    {
+        std::size_t n = std::strlen( name );
+
+        while ( p < end ) {
+            while ( p < end && is_space( *p ) ) ++p;
+            const char* key = p;
+            while ( p < end && *p != '=' && *p != '/' && !is_space( *p ) ) ++p;
+            const char* key_end = p;
+
+            while ( p < end && is_space( *p ) ) ++p;
+            if ( p == end || *p != '=' ) break;
+            ++p;
+            while ( p < end && is_space( *p ) ) ++p;
+            if ( p == end || ( *p != '"' && *p != '\'' ) ) break;
+
+            char quote = *p++;
+            const char* value = p;
+            while ( p < end && *p != quote ) ++p;
+            if ( p == end ) break;
+
+            if ( static_cast<std::size_t>( key_end - key ) == n && std::memcmp( key, name, n ) == 0 ) {
+                return OdeEnvelope::Range{ value, static_cast<std::size_t>( p - value ) };
+            }
+            ++p;
+        }
+
+        return OdeEnvelope::Range{ nullptr, 0 };
+    }
+}
+
+OdeEnvelope::OdeEnvelope() :
+    stack_{}
+    , encodings_{}
+    , encodings_block_{}
+    , encoding_{}
+    , payload_type_{}
+    , generated_at_{}
+    , data_type_{}
+    , data_{}
+    , bytes_{}
+    , bytes_encoding_{}
+    , bytes_start_{ nullptr }
+    , bytes_end_{ nullptr }
+    , found_encodings_{ 0 }
+{
+    stack_.reserve( 16 );
+}
+
+bool OdeEnvelope::scan( const char* buffer, std::size_t length )
+{
+    stack_.clear();
+    encodings_.clear();
+    encoding_ = Encoding{ Range{ nullptr, 0 }, Range{ nullptr, 0 } };
+    encodings_block_ = payload_type_ = generated_at_ = data_type_ = data_ = bytes_ = bytes_encoding_ = Range{ nullptr, 0 };
+    bytes_start_ = bytes_end_ = nullptr;
+    found_encodings_ = 0;
+
+    const char* p = buffer;
+    const char* end = buffer + length;
+    bool root_seen = false;
+
+    while ( p < end ) {
+        const char* lt = static_cast<const char*>( std::memchr( p, '<', end - p ) );
+
+        if ( !lt ) {
+            if ( !stack_.empty() || !all_space( p, end ) ) return false;
+            break;
+        }
+
+        // text outside of the root element.
+        if ( stack_.empty() && !all_space( p, lt ) ) return false;
+
+        if ( lt + 1 == end || lt[1] == '!' ) return false;
+
+        if ( lt[1] == '?' ) {
+            // only the XML declaration, before the root.
+            if ( root_seen || !stack_.empty() ) return false;
+            const char* pi_end = tag_end( lt + 2, end );
+            if ( !pi_end || pi_end[-1] != '?' ) return false;
+            p = pi_end + 1;
+            continue;
+        }
+
+        const char* gt = tag_end( lt + 1, end );
+        if ( !gt ) return false;
+
+        if ( lt[1] == '/' ) {
+            const char* name_end = gt;
+            while ( name_end > lt + 2 && is_space( name_end[-1] ) ) --name_end;
+
+            if ( stack_.empty() || !equals( stack_.back().name, Range{ lt + 2, static_cast<std::size_t>( name_end - lt - 2 ) } ) ) return false;
+            if ( !close( stack_.back(), lt, gt + 1 ) ) return false;
+            stack_.pop_back();
+
+        } else {
+            const char* name_end = lt + 1;
+            while ( name_end < gt && !is_space( *name_end ) && *name_end != '/' ) ++name_end;
+
+            Range name{ lt + 1, static_cast<std::size_t>( name_end - lt - 1 ) };
+            if ( name.size == 0 ) return false;
+
+            if ( stack_.empty() ) {
+                if ( root_seen || !equals( name, "OdeAsn1Data" ) ) return false;
+                root_seen = true;
+            } else {
+                ++stack_.back().children;
+            }
+
+            stack_.push_back( Element{ name, lt, gt + 1, 0 } );
+
+            if ( gt[-1] == '/' ) {
+                if ( !close( stack_.back(), gt + 1, gt + 1 ) ) return false;
+                stack_.pop_back();
+            }
+        }
+
+        p = gt + 1;
+    }
+
+    return root_seen && stack_.empty() && found_encodings_ == 1 && data_type_.begin && data_.begin && bytes_.begin;
+}
+
+bool OdeEnvelope::in( std::size_t depth, const char* name ) const
+{
+    return depth < stack_.size() && equals( stack_[depth].name, name );
+}
+
+bool OdeEnvelope::close( const Element& element, const char* content_end, const char* element_end )
+{
+    std::size_t depth = stack_.size() - 1;
+
+    if ( depth >= 2 && in( 1, "metadata" ) && in( 2, "encodings" ) ) {
+        if ( depth == 2 ) {
+            encodings_block_ = Range{ element.start, static_cast<std::size_t>( element_end - element.start ) };
+            return ++found_encodings_ == 1;
+        }
+
+        if ( depth == 3 ) {
+            encodings_.push_back( encoding_ );
+            encoding_ = Encoding{ Range{ nullptr, 0 }, Range{ nullptr, 0 } };
+            return true;
+        }
+
+        if ( depth == 4 ) {
+            Range* target = nullptr;
+            if ( equals( element.name, "elementType" ) ) target = &encoding_.element_type;
+            if ( equals( element.name, "encodingRule" ) ) target = &encoding_.encoding_rule;
+
+            if ( target ) {
+                if ( target->begin || element.children ) return false;
+                return text( element.content, content_end, *target );
+            }
+        }
+
+        return true;
+    }
+
+    if ( depth == 2 && in( 1, "metadata" ) ) {
+        Range* target = nullptr;
+        if ( equals( element.name, "payloadType" ) ) target = &payload_type_;
+        if ( equals( element.name, "generatedAt" ) ) target = &generated_at_;
+
+        if ( target ) {
+            if ( target->begin || element.children ) return false;
+            return text( element.content, content_end, *target );
+        }
+
+        return true;
+    }
+
+    if ( depth == 2 && in( 1, "payload" ) ) {
+        if ( equals( element.name, "dataType" ) ) {
+            if ( data_type_.begin || element.children ) return false;
+            return text( element.content, content_end, data_type_ );
+        }
+
+        if ( equals( element.name, "data" ) ) {
+            // the decoded XML replaces everything in data, so it must hold nothing but the bytes.
+            if ( data_.begin || element.children != 1 || !bytes_.begin ) return false;
+            if ( !all_space( element.content, bytes_start_ ) || !all_space( bytes_end_, content_end ) ) return false;
+            data_ = Range{ element.content, static_cast<std::size_t>( content_end - element.content ) };
+        }
+
+        return true;
+    }
+
+    if ( depth == 3 && in( 1, "payload" ) && in( 2, "data" ) && equals( element.name, "bytes" ) ) {
+        if ( bytes_.begin || element.children ) return false;
+        bytes_start_ = element.start;
+        bytes_end_ = element_end;
+        bytes_encoding_ = attribute( element.name.end(), element.content - 1, "encoding" );
+        return text( element.content, content_end, bytes_ );
+    }
+
+    return true;
+}
+
+const std::vector<OdeEnvelope::Encoding>& OdeEnvelope::encodings() const
+{
+    return encodings_;
+}
+
+OdeEnvelope::Range OdeEnvelope::encodings_block() const
+{
+    return encodings_block_;
+}
+
+OdeEnvelope::Range OdeEnvelope::payload_type() const
+{
+    return payload_type_;
+}
+
+OdeEnvelope::Range OdeEnvelope::generated_at() const
+{
+    return generated_at_;
+}
+
+OdeEnvelope::Range OdeEnvelope::data_type() const
+{
+    return data_type_;
+}
+
+OdeEnvelope::Range OdeEnvelope::data() const
+{
+    return data_;
+}
+
+OdeEnvelope::Range OdeEnvelope::bytes() const
+{
+    return bytes_;
+}
+
+OdeEnvelope::Range OdeEnvelope::bytes_encoding() const
+{
+    return bytes_encoding_;
+}
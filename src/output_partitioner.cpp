@@ -0,0 +1,83 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "output_partitioner.hpp"
+
+#include <stdexcept>
+
+constexpr int32_t OutputPartitioner::unassigned;
+
+OutputPartitioner::Strategy OutputPartitioner::parse( const std::string& name ) {
+    if ( name == "fixed" ) return Strategy::FIXED;
+    if ( name == "input" ) return Strategy::INPUT;
+    if ( name == "key" ) return Strategy::KEY;
+    if ( name == "sticky" ) return Strategy::STICKY;
+    throw std::invalid_argument{ "unknown partitioner: " + name };
+}
+
+const char* OutputPartitioner::name( Strategy strategy ) {
+    switch ( strategy ) {
+        case Strategy::FIXED: return "fixed";
+        case Strategy::INPUT: return "input";
+        case Strategy::KEY: return "key";
+        case Strategy::STICKY: return "sticky";
+    }
+    return "unknown";
+}
+
+OutputPartitioner::OutputPartitioner( Strategy strategy, int32_t fixed, uint32_t batch ) :
+    strategy_{ strategy }
+    , fixed_{ fixed }
+    , batch_{ batch ? batch : 1 }
+    , counts_{}
+    , produced_{}
+{}
+
+void OutputPartitioner::set_partitions( const std::vector<int32_t>& counts ) {
+    counts_ = counts;
+    produced_.reset( new std::atomic<uint64_t>[ counts_.size() ] );
+    for ( std::size_t i = 0; i < counts_.size(); ++i ) produced_[i] = 0;
+}
+
+int32_t OutputPartitioner::partition( std::size_t topic, int32_t input_partition ) {
+    switch ( strategy_ ) {
+        case Strategy::FIXED:
+            return fixed_;
+        case Strategy::INPUT:
+            return input_partition >= 0 ? input_partition : unassigned;
+        case Strategy::KEY:
+            return unassigned;
+        case Strategy::STICKY:
+            break;
+    }
+
+    // a topic without a known partition count is left to librdkafka.
+    if ( topic >= counts_.size() || counts_[topic] <= 0 ) return unassigned;
+
+    uint64_t n = produced_[topic].fetch_add( 1, std::memory_order_relaxed );
+    return static_cast<int32_t>( ( n / batch_ ) % static_cast<uint64_t>( counts_[topic] ) );
+}
+
+OutputPartitioner::Strategy OutputPartitioner::strategy() const {
+    return strategy_;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "result_cache.hpp"
+
+#include <cstring>
+#include <iterator>
+
+constexpr std::size_t ResultCache::entry_overhead;
+
+namespace {
+
+    // the xxHash64 primes.
+    constexpr uint64_t prime1 = 11400714785074694791ULL;
+    constexpr uint64_t prime2 = 14029467366897019727ULL;
+    constexpr uint64_t prime3 = 1609587929392839161ULL;
+    constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+    inline uint64_t rotl( uint64_t x, unsigned r ) {
+        return ( x << r ) | ( x >> ( 64 - r ) );
+    }
+}
+
+ResultCache::ResultCache( std::size_t capacity ) :
+    capacity_{ capacity }
+    , entries_{}
+    , index_{}
+    , stats_{ 0, 0, 0, 0, 0 }
+{}
+
+uint64_t ResultCache::hash( const void* bytes, std::size_t length ) {
+    const unsigned char* p = static_cast<const unsigned char*>( bytes );
+    const unsigned char* end = p + length;
+    uint64_t h = prime5 + length;
+
+    // one xxHash64 round per word; the payloads are a few hundred bytes, so one lane is enough.
+    for ( ; p + 8 <= end; p += 8 ) {
+        uint64_t w;
+        std::memcpy( &w, p, sizeof( w ) );
+        h ^= rotl( w * prime2, 31 ) * prime1;
+        h = rotl( h, 27 ) * prime1 + prime3;
+    }
+
+    for ( ; p < end; ++p ) {
+        h ^= *p * prime5;
+        h = rotl( h, 11 ) * prime1;
+    }
+
+    // the xxHash64 avalanche.
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t ResultCache::key( uint64_t signature, const void* input, std::size_t length ) {
+    return hash( input, length ) ^ ( signature * prime1 );
+}
+
+std::size_t ResultCache::charge( const Entry& entry ) {
+    return entry.input.size() + entry.output.size() + entry.label.size() + entry_overhead;
+}
+
+const std::string* ResultCache::find( uint64_t signature, const void* input, std::size_t length, int32_t* tag, std::string* label ) {
+    auto found = index_.find( key( signature, input, length ) );
+
+    if ( found == index_.end() ) {
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    EntryList::iterator it = found->second;
+
+    // a hash collision is only a miss.
+    if ( it->signature != signature || it->input.size() != length || std::memcmp( it->input.data(), input, length ) != 0 ) {
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    entries_.splice( entries_.begin(), entries_, it );
+    ++stats_.hits;
+    if ( tag ) *tag = it->tag;
+    if ( label ) *label = it->label;
+    return &it->output;
+}
+
+void ResultCache::insert( uint64_t signature, const void* input, std::size_t length, const char* output, std::size_t output_length, int32_t tag,
+        const std::string& label ) {
+    std::size_t needed = length + output_length + label.size() + entry_overhead;
+
+    // one huge message should not flush everything else.
+    if ( needed > capacity_ / 4 ) return;
+
+    uint64_t k = key( signature, input, length );
+
+    auto found = index_.find( k );
+    if ( found != index_.end() ) {
+        // the same input again, or a collision; the newer result replaces the entry.
+        erase( found->second );
+    }
+
+    while ( stats_.bytes + needed > capacity_ && !entries_.empty() ) {
+        erase( std::prev( entries_.end() ) );
+        ++stats_.evictions;
+    }
+
+    entries_.push_front( Entry{ k, signature, tag, std::string{ static_cast<const char*>( input ), length }, std::string{ output, output_length }, label } );
+    index_[k] = entries_.begin();
+
+    stats_.bytes += charge( entries_.front() );
+    ++stats_.entries;
+}
+
+void ResultCache::erase( EntryList::iterator it ) {
+    stats_.bytes -= charge( *it );
+    --stats_.entries;
+    index_.erase( it->key );
+    entries_.erase( it );
+}
+
+void ResultCache::clear() {
+    entries_.clear();
+    index_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+}
+
+std::size_t ResultCache::capacity() const {
+    return capacity_;
+}
+
+const ResultCache::Stats& ResultCache::stats() const {
+    return stats_;
+}
@@ -0,0 +1,302 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "shm_ring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "the ring's atomics are shared between processes." );
+
+namespace {
+
+    constexpr uint32_t ready_bit = 1u << 31;                            ///> the record is published.
+    constexpr uint32_t pad_bit = 1u << 30;                              ///> the record fills the end of the ring.
+    constexpr uint32_t length_mask = pad_bit - 1;
+    constexpr std::size_t max_capacity = std::size_t{ 1 } << 30;        ///> a padding record's length fits its header.
+    constexpr std::size_t min_capacity = 4096;
+
+    uint64_t record_bytes( std::size_t length ) {
+        return ( 8 + length + 7 ) & ~uint64_t{ 7 };
+    }
+
+    /**
+     * @brief The milliseconds left before the deadline; -1 when there is none.
+     */
+    class Deadline {
+        public:
+            explicit Deadline( int timeout_ms ) :
+                forever_{ timeout_ms < 0 }
+                , end_{ std::chrono::steady_clock::now() + std::chrono::milliseconds( std::max( timeout_ms, 0 ) ) }
+            {}
+
+            int left() const {
+                if ( forever_ ) return -1;
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>( end_ - std::chrono::steady_clock::now() ).count();
+                return left > 0 ? static_cast<int>( left ) : 0;
+            }
+
+        private:
+            bool forever_;
+            std::chrono::steady_clock::time_point end_;
+    };
+}
+
+ShmRing::ShmRing( const std::string& name, std::size_t capacity ) :
+    name_{ !name.empty() && name[0] == '/' ? name : '/' + name }
+    , requested_{ capacity }
+    , map_{ nullptr }
+    , map_bytes_{ 0 }
+    , control_{ nullptr }
+    , data_{ nullptr }
+    , mask_{ 0 }
+    , read_{ 0 }
+    , peeked_{ 0 }
+{}
+
+ShmRing::~ShmRing() {
+    if ( map_ ) munmap( map_, map_bytes_ );
+}
+
+bool ShmRing::open() {
+    int fd = -1;
+
+    // exactly one process makes the ring; the others wait for it to be ready.
+    if ( requested_ > 0 ) {
+        fd = shm_open( name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+        if ( fd < 0 && errno != EEXIST ) return false;
+
+        if ( fd >= 0 ) {
+            std::size_t capacity = min_capacity;
+            while ( capacity < std::min( requested_, max_capacity ) ) capacity <<= 1;
+
+            if ( ftruncate( fd, sizeof( Control ) + capacity ) != 0 || !attach( fd ) ) {
+                int error = errno;
+                ::close( fd );
+                shm_unlink( name_.c_str() );
+                errno = error;
+                return false;
+            }
+
+            // a new object is zeroed, so only the fields that are not 0 are stored; the magic tells the others it is done.
+            control_->capacity = capacity;
+            mask_ = capacity - 1;
+            control_->magic.store( magic, std::memory_order_release );
+            ::close( fd );
+            return true;
+        }
+    }
+
+    fd = shm_open( name_.c_str(), O_RDWR, 0 );
+    if ( fd < 0 ) return false;
+
+    bool attached = attach( fd );
+    int error = errno;
+    ::close( fd );
+    errno = error;
+    if ( !attached ) return false;
+
+    for ( int i = 0; i < 1000 && control_->magic.load( std::memory_order_acquire ) != magic; ++i ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+
+    uint64_t capacity = control_->capacity;
+    if ( control_->magic.load( std::memory_order_acquire ) != magic || capacity == 0 || ( capacity & ( capacity - 1 ) ) != 0
+            || sizeof( Control ) + capacity != map_bytes_ ) {
+        munmap( map_, map_bytes_ );
+        map_ = nullptr;
+        errno = EINVAL;
+        return false;
+    }
+
+    mask_ = capacity - 1;
+    read_ = control_->tail.load( std::memory_order_acquire );
+    return true;
+}
+
+bool ShmRing::attach( int fd ) {
+    struct stat st;
+
+    // the maker of the ring may not have sized it yet.
+    for ( int i = 0; ; ++i ) {
+        if ( fstat( fd, &st ) != 0 ) return false;
+        if ( static_cast<std::size_t>( st.st_size ) > sizeof( Control ) ) break;
+        if ( i == 1000 ) {
+            errno = EINVAL;
+            return false;
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+
+    void* map = mmap( nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if ( map == MAP_FAILED ) return false;
+
+    map_ = map;
+    map_bytes_ = st.st_size;
+    control_ = static_cast<Control*>( map );
+    data_ = static_cast<uint8_t*>( map ) + sizeof( Control );
+    return true;
+}
+
+std::atomic<uint32_t>& ShmRing::header( uint64_t position ) const {
+    return *reinterpret_cast<std::atomic<uint32_t>*>( data_ + ( position & mask_ ) );
+}
+
+bool ShmRing::push( const void* data, std::size_t length, int timeout_ms ) {
+    uint64_t capacity = mask_ + 1;
+    uint64_t need = record_bytes( length );
+
+    // with at most half the ring per record, a record and its padding always fit an empty ring.
+    if ( need > capacity / 2 ) {
+        errno = EMSGSIZE;
+        return false;
+    }
+
+    Deadline deadline{ timeout_ms };
+    uint64_t head = control_->head.load( std::memory_order_relaxed );
+    uint64_t pad;
+
+    for ( ;; ) {
+        uint64_t offset = head & mask_;
+        pad = capacity - offset < need ? capacity - offset : 0;
+        uint64_t tail = control_->tail.load( std::memory_order_acquire );
+
+        if ( head + pad + need - tail > capacity ) {
+            // full; the consumer wakes the producers when it gives space back.
+            int left = deadline.left();
+            if ( left == 0 ) {
+                errno = EAGAIN;
+                return false;
+            }
+
+            uint32_t seen = control_->space_signal.load();
+            control_->producers_waiting.fetch_add( 1 );
+            if ( control_->tail.load() == tail ) wait( control_->space_signal, seen, left );
+            control_->producers_waiting.fetch_sub( 1 );
+
+            head = control_->head.load( std::memory_order_relaxed );
+            continue;
+        }
+
+        if ( control_->head.compare_exchange_weak( head, head + pad + need, std::memory_order_acq_rel, std::memory_order_relaxed ) ) break;
+    }
+
+    if ( pad > 0 ) header( head ).store( ready_bit | pad_bit | static_cast<uint32_t>( pad ), std::memory_order_release );
+
+    uint64_t at = head + pad;
+    std::memcpy( data_ + ( at & mask_ ) + header_bytes, data, length );
+
+    // the header is published before the consumer's flag is read, and the consumer sets its flag before it reads the
+    // header, so one of them sees the other.
+    header( at ).store( ready_bit | static_cast<uint32_t>( length ) );
+    if ( control_->consumer_waiting.load() ) {
+        control_->data_signal.fetch_add( 1 );
+        wake( control_->data_signal, 1 );
+    }
+
+    return true;
+}
+
+const uint8_t* ShmRing::peek( std::size_t& length, int timeout_ms ) {
+    Deadline deadline{ timeout_ms };
+
+    for ( ;; ) {
+        if ( read_ != control_->head.load( std::memory_order_acquire ) ) {
+            uint32_t word = header( read_ ).load( std::memory_order_acquire );
+
+            if ( word & pad_bit ) {
+                peeked_ = word & length_mask;
+                pop();
+                continue;
+            }
+
+            if ( word & ready_bit ) {
+                length = word & length_mask;
+                peeked_ = record_bytes( length );
+                return data_ + ( read_ & mask_ ) + header_bytes;
+            }
+        }
+
+        // empty, or the next record is not published yet.
+        int left = deadline.left();
+        if ( left == 0 ) return nullptr;
+
+        uint32_t seen = control_->data_signal.load();
+        control_->consumer_waiting.store( 1 );
+        if ( read_ == control_->head.load() || header( read_ ).load() == 0 ) wait( control_->data_signal, seen, left );
+        control_->consumer_waiting.store( 0 );
+    }
+}
+
+void ShmRing::pop() {
+    if ( peeked_ == 0 ) return;
+
+    // the free space is all zeros, so a header is 0 until its record is published.
+    uint8_t* record = data_ + ( read_ & mask_ );
+    std::memset( record + header_bytes, 0, peeked_ - header_bytes );
+    header( read_ ).store( 0, std::memory_order_relaxed );
+
+    read_ += peeked_;
+    peeked_ = 0;
+
+    control_->tail.store( read_ );
+    if ( control_->producers_waiting.load() ) {
+        control_->space_signal.fetch_add( 1 );
+        wake( control_->space_signal, INT_MAX );
+    }
+}
+
+std::size_t ShmRing::capacity() const {
+    return static_cast<std::size_t>( mask_ + 1 );
+}
+
+const std::string& ShmRing::name() const {
+    return name_;
+}
+
+bool ShmRing::remove( const std::string& name ) {
+    std::string path = !name.empty() && name[0] == '/' ? name : '/' + name;
+    return shm_unlink( path.c_str() ) == 0;
+}
+
+bool ShmRing::wait( std::atomic<uint32_t>& signal, uint32_t seen, int timeout_ms ) {
+    struct timespec timeout{ timeout_ms / 1000, ( timeout_ms % 1000 ) * 1000000L };
+
+    // not FUTEX_PRIVATE_FLAG: the other side is another process.
+    long r = syscall( SYS_futex, reinterpret_cast<uint32_t*>( &signal ), FUTEX_WAIT, seen, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0 );
+    return r == 0 || errno != ETIMEDOUT;
+}
+
+void ShmRing::wake( std::atomic<uint32_t>& signal, int count ) {
+    syscall( SYS_futex, reinterpret_cast<uint32_t*>( &signal ), FUTEX_WAKE, count, nullptr, nullptr, 0 );
+}
@@ -0,0 +1,256 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "signature_verifier.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef ACM_VERIFY
+// the EC_KEY interface is deprecated by OpenSSL 3, but it is the one that parses a key once and keeps it.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/sha.h>
+#endif
+
+namespace {
+    constexpr int pending = -1;
+}
+
+struct SignatureVerifier::Job {
+    Request request;
+    std::atomic<int> status;                                            ///> a Status, or pending.
+};
+
+const char* SignatureVerifier::name( Status status ) {
+    static const char* names[statuses] = {
+        "", "matches_carried_key", "skipped", "unsupported", "unknown_signer", "expired", "revoked", "invalid"
+    };
+    return names[ static_cast<std::size_t>( status ) ];
+}
+
+SignatureVerifier::Status SignatureVerifier::combine( Status a, Status b ) {
+    return std::max( a, b );
+}
+
+bool SignatureVerifier::sample() {
+    // the count of verified frames goes up by one each time n * percent passes a multiple of 100, so any run of 100
+    // frames has the sampled percent in it.
+    uint64_t n = sampled_.fetch_add( 1, std::memory_order_relaxed );
+    return ( n * sample_percent_ ) / 100 != ( ( n + 1 ) * sample_percent_ ) / 100;
+}
+
+SignatureVerifier::Ticket SignatureVerifier::submit( const Request& request ) {
+    Ticket ticket = std::make_shared<Job>();
+    ticket->request = request;
+    ticket->status.store( pending, std::memory_order_relaxed );
+
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        queue_.push_back( ticket );
+    }
+    work_.notify_one();
+    return ticket;
+}
+
+SignatureVerifier::Ticket SignatureVerifier::resolve( Status status ) {
+    Ticket ticket = std::make_shared<Job>();
+    finish( *ticket, status );
+    return ticket;
+}
+
+SignatureVerifier::Status SignatureVerifier::wait( const Ticket& ticket ) const {
+    int status = ticket->status.load( std::memory_order_acquire );
+    if ( status == pending ) {
+        std::unique_lock<std::mutex> lock{ mutex_ };
+        done_.wait( lock, [&]() { return ( status = ticket->status.load( std::memory_order_acquire ) ) != pending; } );
+    }
+    return static_cast<Status>( status );
+}
+
+void SignatureVerifier::finish( Job& job, Status status ) {
+    counts_[ static_cast<std::size_t>( status ) ].fetch_add( 1, std::memory_order_relaxed );
+    job.status.store( static_cast<int>( status ), std::memory_order_release );
+}
+
+void SignatureVerifier::run() {
+    std::vector<Ticket> batch;
+    batch.reserve( batch_ );
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock{ mutex_ };
+            work_.wait( lock, [this]() { return stopping_ || !queue_.empty(); } );
+
+            // the requests already submitted are verified before the pool stops.
+            if ( queue_.empty() ) return;
+
+            while ( !queue_.empty() && batch.size() < batch_ ) {
+                batch.push_back( std::move( queue_.front() ) );
+                queue_.pop_front();
+            }
+        }
+
+        batches_.fetch_add( 1, std::memory_order_relaxed );
+        for ( const Ticket& job : batch ) {
+            finish( *job, verify( job->request ) );
+        }
+        batch.clear();
+
+        // taking the lock orders the results before the notification for a waiter that is checking its ticket.
+        { std::lock_guard<std::mutex> lock{ mutex_ }; }
+        done_.notify_all();
+    }
+}
+
+uint64_t SignatureVerifier::count( Status status ) const {
+    return counts_[ static_cast<std::size_t>( status ) ].load( std::memory_order_relaxed );
+}
+
+uint64_t SignatureVerifier::batches() const {
+    return batches_.load( std::memory_order_relaxed );
+}
+
+UnvalidatedCertificateCache& SignatureVerifier::certificates() {
+    return certificates_;
+}
+
+#ifdef ACM_VERIFY
+
+bool SignatureVerifier::available() {
+    return true;
+}
+
+SignatureVerifier::SignatureVerifier( std::size_t threads, std::size_t batch, uint32_t sample_percent, std::size_t certificates ) :
+    batch_{ batch ? batch : 1 }
+    , sample_percent_{ std::min<uint32_t>( sample_percent, 100 ) }
+    , sampled_{ 0 }
+    , certificates_{ certificates }
+    , counts_{ new std::atomic<uint64_t>[statuses] }
+    , batches_{ 0 }
+    , mutex_{}
+    , work_{}
+    , done_{}
+    , queue_{}
+    , stopping_{ false }
+    , threads_{}
+{
+    for ( std::size_t i = 0; i < statuses; ++i ) counts_[i] = 0;
+    for ( std::size_t i = 0; i < std::max<std::size_t>( threads, 1 ); ++i ) {
+        threads_.emplace_back( &SignatureVerifier::run, this );
+    }
+}
+
+SignatureVerifier::~SignatureVerifier() {
+    {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        stopping_ = true;
+    }
+    work_.notify_all();
+
+    for ( auto& t : threads_ ) {
+        if ( t.joinable() ) t.join();
+    }
+}
+
+SignatureVerifier::Status SignatureVerifier::verify( const Request& request ) {
+    UnvalidatedCertificateCache::Certificate& signer = *request.signer;
+
+    // a key is parsed, and a compressed key decompressed, the first time its certificate is used.
+    std::call_once( signer.parse_once, [&signer]() {
+        EC_KEY* key = EC_KEY_new_by_curve_name( NID_X9_62_prime256v1 );
+        if ( key && EC_KEY_oct2key( key, signer.key, signer.key_size, nullptr ) == 1 ) {
+            signer.parsed.reset( key, []( void* k ) { EC_KEY_free( static_cast<EC_KEY*>( k ) ); } );
+        } else {
+            EC_KEY_free( key );
+        }
+    } );
+
+    if ( !signer.parsed ) return Status::INVALID;
+
+    uint8_t hashes[64];
+    uint8_t digest[32];
+    std::memcpy( hashes, request.tbs_hash, 32 );
+    std::memcpy( hashes + 32, signer.hash, 32 );
+    sha256( hashes, sizeof( hashes ), digest );
+
+    ECDSA_SIG* signature = ECDSA_SIG_new();
+    if ( !signature ) return Status::UNSUPPORTED;
+
+    BIGNUM* r = BN_bin2bn( request.r, sizeof( request.r ), nullptr );
+    BIGNUM* s = BN_bin2bn( request.s, sizeof( request.s ), nullptr );
+    if ( !r || !s || ECDSA_SIG_set0( signature, r, s ) != 1 ) {
+        BN_free( r );
+        BN_free( s );
+        ECDSA_SIG_free( signature );
+        return Status::UNSUPPORTED;
+    }
+
+    int rc = ECDSA_do_verify( digest, sizeof( digest ), signature, static_cast<EC_KEY*>( signer.parsed.get() ) );
+    ECDSA_SIG_free( signature );
+
+    return rc == 1 ? Status::SIGNATURE_MATCHES_CARRIED_KEY : Status::INVALID;
+}
+
+void SignatureVerifier::sha256( const void* data, std::size_t size, uint8_t out[32] ) {
+    SHA256( static_cast<const unsigned char*>( data ), size, out );
+}
+
+#else
+
+bool SignatureVerifier::available() {
+    return false;
+}
+
+SignatureVerifier::SignatureVerifier( std::size_t, std::size_t batch, uint32_t sample_percent, std::size_t certificates ) :
+    batch_{ batch ? batch : 1 }
+    , sample_percent_{ std::min<uint32_t>( sample_percent, 100 ) }
+    , sampled_{ 0 }
+    , certificates_{ certificates }
+    , counts_{}
+    , batches_{ 0 }
+    , mutex_{}
+    , work_{}
+    , done_{}
+    , queue_{}
+    , stopping_{ false }
+    , threads_{}
+{
+    throw std::runtime_error{ "the ACM is built without signature verification; cmake -DACM_VERIFY=ON" };
+}
+
+SignatureVerifier::~SignatureVerifier() {}
+
+SignatureVerifier::Status SignatureVerifier::verify( const Request& ) {
+    return Status::UNSUPPORTED;
+}
+
+void SignatureVerifier::sha256( const void*, std::size_t, uint8_t* ) {
+    throw std::runtime_error{ "the ACM is built without signature verification; cmake -DACM_VERIFY=ON" };
+}
+
+#endif
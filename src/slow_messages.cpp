@@ -0,0 +1,78 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "slow_messages.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+    bool slower( const SlowMessages::Message& a, const SlowMessages::Message& b ) {
+        return a.ns > b.ns;
+    }
+}
+
+SlowMessages::SlowMessages( std::size_t capacity, uint32_t window_ms ) :
+    capacity_{ std::max<std::size_t>( capacity, 1 ) }
+    , window_ms_{ std::max<int64_t>( window_ms, 1 ) }
+    , threshold_{ 0 }
+    , window_end_{ 0 }
+    , current_{}
+    , previous_{}
+    , mutex_{}
+{}
+
+void SlowMessages::record( const std::string& topic, int32_t partition, int64_t offset, uint64_t ns, int64_t now_ms ) {
+    if ( ns <= threshold_.load( std::memory_order_relaxed ) && now_ms < window_end_.load( std::memory_order_relaxed ) ) return;
+
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    if ( now_ms >= window_end_.load( std::memory_order_relaxed ) ) {
+        // a window with no messages leaves none to the next.
+        if ( now_ms >= window_end_.load( std::memory_order_relaxed ) + window_ms_ ) current_.clear();
+        previous_.swap( current_ );
+        current_.clear();
+        threshold_.store( 0, std::memory_order_relaxed );
+        window_end_.store( now_ms + window_ms_, std::memory_order_relaxed );
+    }
+
+    if ( current_.size() == capacity_ ) {
+        // the fastest one kept is at the back.
+        if ( ns <= current_.back().ns ) return;
+        current_.pop_back();
+    }
+
+    Message message{ topic, partition, offset, ns, now_ms };
+    current_.insert( std::upper_bound( current_.begin(), current_.end(), message, slower ), message );
+
+    if ( current_.size() == capacity_ ) threshold_.store( current_.back().ns, std::memory_order_relaxed );
+}
+
+std::vector<SlowMessages::Message> SlowMessages::recent() const {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    std::vector<Message> messages;
+    messages.reserve( current_.size() + previous_.size() );
+    std::merge( current_.begin(), current_.end(), previous_.begin(), previous_.end(), std::back_inserter( messages ), slower );
+    return messages;
+}
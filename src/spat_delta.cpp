@@ -0,0 +1,148 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "spat_delta.hpp"
+#include "IntersectionState.h"
+#include "MovementState.h"
+
+#include <chrono>
+
+namespace {
+
+    constexpr uint64_t fnv_offset = 0xcbf29ce484222325ULL;
+    constexpr uint64_t fnv_prime = 0x100000001b3ULL;
+
+    uint64_t fnv1a( const void* data, std::size_t size, uint64_t h = fnv_offset ) {
+        const uint8_t* p = static_cast<const uint8_t*>( data );
+        for ( std::size_t i = 0; i < size; ++i ) {
+            h ^= p[i];
+            h *= fnv_prime;
+        }
+        return h;
+    }
+
+    int hash_bytes( const void* buffer, size_t size, void* key ) {
+        uint64_t* h = static_cast<uint64_t*>( key );
+        *h = fnv1a( buffer, size, *h );
+        return 0;
+    }
+
+    uint64_t intersection_key( const IntersectionReferenceID_t& id ) {
+        // the region is 16 bits; 0 in the high word is no region.
+        uint64_t region = id.region ? static_cast<uint64_t>( *id.region ) + 1 : 0;
+        return region << 32 | static_cast<uint32_t>( id.id );
+    }
+}
+
+SpatDelta::SpatDelta( uint32_t snapshot_seconds, std::size_t capacity ) :
+    snapshot_ms_{ static_cast<uint64_t>( snapshot_seconds ) * 1000 }
+    , capacity_{ capacity ? capacity : 1 }
+    , intersections_{}
+{}
+
+bool SpatDelta::reduce( SPAT_t& spat ) {
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    return reduce( spat, now );
+}
+
+bool SpatDelta::reduce( SPAT_t& spat, uint64_t now_ms ) {
+    auto& intersection_list = spat.intersections.list;
+    int kept = 0;
+
+    for ( int i = 0; i < intersection_list.count; ++i ) {
+        IntersectionState_t* state = intersection_list.array[i];
+        if ( !state ) continue;
+
+        uint64_t key = intersection_key( state->id );
+        auto it = intersections_.find( key );
+        if ( it == intersections_.end() ) {
+            if ( intersections_.size() >= capacity_ ) intersections_.clear();
+            it = intersections_.emplace( key, Intersection{} ).first;
+            it->second.snapshot_ms = 0;
+            it->second.revision = -1;                                   // MsgCount is 0 to 127.
+            it->second.status = 0;
+        }
+
+        Intersection& last = it->second;
+        uint64_t status = fnv1a( state->status.buf, state->status.size );
+        bool snapshot = last.revision != state->revision || now_ms >= last.snapshot_ms + snapshot_ms_;
+        bool changed = snapshot || status != last.status;
+
+        if ( snapshot ) {
+            last.movements.clear();
+            last.snapshot_ms = now_ms;
+            last.revision = state->revision;
+        }
+        last.status = status;
+
+        // an unchanged movement is kept aside, since a written intersection needs at least one (SIZE(1..255)).
+        auto& movement_list = state->states.list;
+        MovementState_t* spare = nullptr;
+        int movements = 0;
+        for ( int j = 0; j < movement_list.count; ++j ) {
+            MovementState_t* movement = movement_list.array[j];
+            if ( !movement ) continue;
+
+            uint64_t h = hash( *movement );
+            auto m = last.movements.find( movement->signalGroup );
+            if ( snapshot || m == last.movements.end() || m->second != h || h == 0 ) {
+                last.movements[ movement->signalGroup ] = h;
+                movement_list.array[ movements++ ] = movement;
+            } else if ( !spare ) {
+                spare = movement;
+            } else {
+                ASN_STRUCT_FREE( asn_DEF_MovementState, movement );
+            }
+        }
+
+        if ( movements == 0 && changed && spare ) {
+            movement_list.array[ movements++ ] = spare;
+        } else if ( spare ) {
+            ASN_STRUCT_FREE( asn_DEF_MovementState, spare );
+        }
+        movement_list.count = movements;
+
+        if ( changed || movements > 0 ) {
+            intersection_list.array[ kept++ ] = state;
+        } else {
+            ASN_STRUCT_FREE( asn_DEF_IntersectionState, state );
+        }
+    }
+
+    intersection_list.count = kept;
+    return kept > 0;
+}
+
+std::size_t SpatDelta::intersections() const {
+    return intersections_.size();
+}
+
+void SpatDelta::clear() {
+    intersections_.clear();
+}
+
+uint64_t SpatDelta::hash( const MovementState_t& movement ) {
+    uint64_t h = fnv_offset;
+    asn_enc_rval_t rval = asn_encode( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MovementState, &movement, hash_bytes, &h );
+    return rval.encoded < 0 ? 0 : h;
+}
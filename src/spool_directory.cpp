@@ -0,0 +1,194 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+#include "spool_directory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SpoolDirectory::SpoolDirectory( const std::string& path ) :
+    path_{ path }
+    , fd_{ -1 }
+    , watch_{ -1 }
+    , ready_{}
+    , queued_{}
+{}
+
+SpoolDirectory::~SpoolDirectory()
+{
+    if ( fd_ >= 0 ) ::close( fd_ );
+}
+
+const std::string& SpoolDirectory::path() const
+{
+    return path_;
+}
+
+bool SpoolDirectory::open()
+{
+    fd_ = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( fd_ < 0 ) return false;
+
+    // the watch starts before the scan, so a file that arrives in between is not missed.
+    watch_ = inotify_add_watch( fd_, path_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR );
+    if ( watch_ < 0 ) {
+        int e = errno;
+        ::close( fd_ );
+        fd_ = -1;
+        errno = e;
+        return false;
+    }
+
+    scan();
+    return true;
+}
+
+void SpoolDirectory::queue( const std::string& name )
+{
+    if ( name.empty() || name[0] == '.' ) return;
+    if ( queued_.insert( name ).second ) ready_.push_back( name );
+}
+
+void SpoolDirectory::scan()
+{
+    DIR* dir = opendir( path_.c_str() );
+    if ( !dir ) return;
+
+    std::vector<std::string> names;
+    struct dirent* entry;
+    while ( ( entry = readdir( dir ) ) != nullptr ) {
+        struct stat info;
+        std::string name{ entry->d_name };
+        if ( stat( ( path_ + '/' + name ).c_str(), &info ) == 0 && S_ISREG( info.st_mode ) ) names.push_back( name );
+    }
+    closedir( dir );
+
+    // without event times the name order is the best guess at the arrival order.
+    std::sort( names.begin(), names.end() );
+    for ( auto& name : names ) queue( name );
+}
+
+void SpoolDirectory::drain_events()
+{
+    alignas( struct inotify_event ) char buffer[ 64 * ( sizeof( struct inotify_event ) + NAME_MAX + 1 ) ];
+
+    for ( ;; ) {
+        ssize_t n = ::read( fd_, buffer, sizeof( buffer ) );
+        if ( n <= 0 ) return;
+
+        for ( char* p = buffer; p < buffer + n; ) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>( p );
+            p += sizeof( struct inotify_event ) + event->len;
+
+            if ( event->mask & IN_Q_OVERFLOW ) {
+                // events were lost; the directory itself says what is there.
+                scan();
+            } else if ( event->len > 0 && !( event->mask & IN_ISDIR ) ) {
+                queue( event->name );
+            }
+        }
+    }
+}
+
+std::size_t SpoolDirectory::wait( std::vector<std::string>& names, std::size_t max_files, int timeout_ms )
+{
+    if ( fd_ < 0 ) return 0;
+
+    if ( ready_.empty() ) {
+        struct pollfd pfd{ fd_, POLLIN, 0 };
+        if ( poll( &pfd, 1, timeout_ms ) <= 0 ) return 0;
+    }
+
+    drain_events();
+
+    std::size_t count = std::min( max_files, ready_.size() );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        queued_.erase( ready_[i] );
+        names.push_back( std::move( ready_[i] ) );
+    }
+    ready_.erase( ready_.begin(), ready_.begin() + count );
+
+    return count;
+}
+
+void SpoolDirectory::read( const std::vector<std::string>& names, std::vector<File>& files ) const
+{
+    std::vector<int> fds( names.size(), -1 );
+    files.clear();
+    files.resize( names.size() );
+
+    // open the whole batch and start the kernel reading every file before the first one is copied.
+    for ( std::size_t i = 0; i < names.size(); ++i ) {
+        files[i].name = names[i];
+        files[i].error = 0;
+
+        fds[i] = ::open( ( path_ + '/' + names[i] ).c_str(), O_RDONLY | O_CLOEXEC );
+        if ( fds[i] < 0 ) {
+            files[i].error = errno;
+            continue;
+        }
+
+        struct stat info;
+        if ( fstat( fds[i], &info ) != 0 ) {
+            files[i].error = errno;
+        } else if ( !S_ISREG( info.st_mode ) ) {
+            files[i].error = EISDIR;
+        }
+
+        if ( files[i].error ) {
+            ::close( fds[i] );
+            fds[i] = -1;
+            continue;
+        }
+
+        files[i].data.resize( static_cast<std::size_t>( info.st_size ) );
+        posix_fadvise( fds[i], 0, info.st_size, POSIX_FADV_WILLNEED );
+    }
+
+    for ( std::size_t i = 0; i < names.size(); ++i ) {
+        if ( fds[i] < 0 ) continue;
+
+        std::size_t done = 0;
+        std::vector<uint8_t>& data = files[i].data;
+
+        while ( done < data.size() ) {
+            ssize_t n = pread( fds[i], data.data() + done, data.size() - done, static_cast<off_t>( done ) );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) {
+                // a shorter file than fstat reported is read as it is.
+                if ( n < 0 ) files[i].error = errno;
+                break;
+            }
+            done += static_cast<std::size_t>( n );
+        }
+
+        data.resize( done );
+        ::close( fds[i] );
+    }
+}
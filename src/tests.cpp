@@ -3,6 +3,52 @@
 
 #include "acm.hpp"
 #include "utilities.hpp"
+#include "hex_codec.hpp"
+#include "base64_codec.hpp"
+#include "asn1_arena.hpp"
+#include "asn1_xer.hpp"
+#include "alloc_counter.hpp"
+#include "xml_page_pool.hpp"
+#include "bsm_fast_path.hpp"
+#include "bsm_archive.hpp"
+#include "bsm_columns.hpp"
+#include "map_frame.hpp"
+#include "geofence.hpp"
+#include "bsm_deduplicator.hpp"
+#include "bsm_rate_limiter.hpp"
+#include "trajectory_aggregator.hpp"
+#include "error_breaker.hpp"
+#include "memory_budget.hpp"
+#include "batch_input.hpp"
+#include "ode_envelope.hpp"
+#include "commit_manager.hpp"
+#include "spool_directory.hpp"
+#include "shm_ring.hpp"
+#include "udp_receiver.hpp"
+#include "kafka_stats.hpp"
+#include "latency_histogram.hpp"
+#include "slow_messages.hpp"
+#include "batch_tuner.hpp"
+#include "output_partitioner.hpp"
+#include "message_latencies.hpp"
+#include "metrics_endpoint.hpp"
+#include "coarse_clock.hpp"
+#include "result_cache.hpp"
+#include "unvalidated_certificate_cache.hpp"
+#include "signature_verifier.hpp"
+#include "corpus_generator.hpp"
+#include "libacm.h"
+#include "rapidjson/document.h"
+
+#include <netinet/in.h>
+
+#ifdef ACM_VERIFY
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#endif
 
 bool loadTestCases( const std::string& case_file, StrVector& case_data ) {
 
@@ -25,6 +71,35 @@ bool loadTestCases( const std::string& case_file, StrVector& case_data ) {
     return( !case_data.empty() );
 }
 
+/**
+ * @brief The bytes of a file; empty when it cannot be read.
+ */
+std::string read_file( const std::string& path ) {
+    std::ifstream ifs{ path, std::ios::binary };
+    return std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+}
+
+/**
+ * A decoding context for UPER MessageFrames, the input of most BSM tests.
+ */
+struct BsmCodec : CodecContext {
+    std::string encodings{ "MessageFrame:UPER" };
+
+    BsmCodec() : CodecContext{ nullptr, nullptr, true } {}
+
+    bool decode( const std::string& bytes, std::ostream& output ) {
+        return decode( bytes.data(), bytes.size(), output );
+    }
+
+    bool decode( const char* bytes, std::size_t length, std::ostream& output ) {
+        return process_bytes( bytes, length, encodings.data(), encodings.size(), output );
+    }
+
+    std::size_t decode_stream( const std::string& stream, const char* bytes, std::size_t length, std::ostream& output, const std::function<void( bool )>& respond ) {
+        return process_stream( stream, bytes, length, encodings.data(), encodings.size(), output, respond );
+    }
+};
+
 pugi::xpath_query ode_payload_query("OdeAsn1Data/payload/data");
 pugi::xml_document output_doc;
 pugi::xml_parse_result parse_result;
@@ -32,11 +107,13 @@ pugi::xml_node payload_node;
 pugi::xml_node byte_node;
 ASN1_Codec asn1_codec{"ASN1_Codec","ASN1 Processing Module"};
 
+// the encodings of an ASD wrapping the BSM MessageFrame and an ASD wrapping the 1609.2 frame of the BSM.
+static const char *ASD_BSM_HEX = "44400000000084782786283B90A7148D2B0A89C49F8A85A7763BF8423C13C2107E1C0C6F7E2C0C6F1620029015AAC5F50800073D1CE2E121F2CCBFC375986FFFFFFFFE0007775FBF43F4200FFFF000000000004042983820082FFFFFFFD049C20147FFFFFFFD128420408FFFFFFFD2454204D480287FFD2BAC2084680BAFFFD4EAC2064580B33FFD5BF42072380D6BFFD6FCC2079681407FFDA424206778115BFFDB34C205D0811CBFFDBC5C2057B8110BFFDBE142001780337FFEFE643FFFF800BBFFF8AB43FFFFFFFFFFFFBA3420080FFFFFFFFC345FFFC00000";
+static const char *ASD_ONE609_HEX = "44400000000084782786283B90A7148D2B0A89C49F8A85A7763BF8423C13C2107E1C0C6F7E2C0C6F16A070103620029015AAC5F50800073D1CE2E121F2CCBFC375986FFFFFFFFE0007775FBF43F4200FFFF000000000004042983820082FFFFFFFD049C20147FFFFFFFD128420408FFFFFFFD2454204D480287FFD2BAC2084680BAFFFD4EAC2064580B33FFD5BF42072380D6BFFD6FCC2079681407FFDA424206778115BFFDB34C205D0811CBFFDBC5C2057B8110BFFDBE142001780337FFEFE643FFFF800BBFFF8AB43FFFFFFFFFFFFBA3420080FFFFFFFFC345FFFC00000";
+
 TEST_CASE("ASN1_Codex Tests", "[encoding]" ) {
     const char *BSM_HEX = "001480AD562FA8400039E8E717090F9665FE1BACC37FFFFFFFF0003BBAFDFA1FA1007FFF8000000000020214C1C100417FFFFFFE824E100A3FFFFFFFE8942102047FFFFFFE922A1026A40143FFE95D610423405D7FFEA75610322C0599FFEADFA10391C06B5FFEB7E6103CB40A03FFED2121033BC08ADFFED9A6102E8408E5FFEDE2E102BDC0885FFEDF0A1000BC019BFFF7F321FFFFC005DFFFC55A1FFFFFFFFFFFFDD1A100407FFFFFFFE1A2FFFE0000";
-    const char *ASD_BSM_HEX = "44400000000084782786283B90A7148D2B0A89C49F8A85A7763BF8423C13C2107E1C0C6F7E2C0C6F1620029015AAC5F50800073D1CE2E121F2CCBFC375986FFFFFFFFE0007775FBF43F4200FFFF000000000004042983820082FFFFFFFD049C20147FFFFFFFD128420408FFFFFFFD2454204D480287FFD2BAC2084680BAFFFD4EAC2064580B33FFD5BF42072380D6BFFD6FCC2079681407FFDA424206778115BFFDB34C205D0811CBFFDBC5C2057B8110BFFDBE142001780337FFEFE643FFFF800BBFFF8AB43FFFFFFFFFFFFBA3420080FFFFFFFFC345FFFC00000";
     const char *ONE609_BSM_HEX = "038081B1001480AD562FA8400039E8E717090F9665FE1BACC37FFFFFFFF0003BBAFDFA1FA1007FFF8000000000020214C1C100417FFFFFFE824E100A3FFFFFFFE8942102047FFFFFFE922A1026A40143FFE95D610423405D7FFEA75610322C0599FFEADFA10391C06B5FFEB7E6103CB40A03FFED2121033BC08ADFFED9A6102E8408E5FFEDE2E102BDC0885FFEDF0A1000BC019BFFF7F321FFFFC005DFFFC55A1FFFFFFFFFFFFDD1A100407FFFFFFFE1A2FFFE0000";
-    const char *ASD_ONE609_HEX = "44400000000084782786283B90A7148D2B0A89C49F8A85A7763BF8423C13C2107E1C0C6F7E2C0C6F16A070103620029015AAC5F50800073D1CE2E121F2CCBFC375986FFFFFFFFE0007775FBF43F4200FFFF000000000004042983820082FFFFFFFD049C20147FFFFFFFD128420408FFFFFFFD2454204D480287FFD2BAC2084680BAFFFD4EAC2064580B33FFD5BF42072380D6BFFD6FCC2079681407FFDA424206778115BFFDB34C205D0811CBFFDBC5C2057B8110BFFDBE142001780337FFEFE643FFFF800BBFFF8AB43FFFFFFFFFFFFBA3420080FFFFFFFFC345FFFC00000";
 
     //<payload><data><AdvisorySituationData><bytes>
 
@@ -132,3 +209,2849 @@ TEST_CASE("ASN1_Codex Tests", "[encoding]" ) {
 
     // TODO check oracles with decoder
 }
+
+TEST_CASE("ProduceStream Tests", "[kafka]" ) {
+    ProduceStream pstream{ 4 };
+    std::size_t len;
+
+    pstream << "<OdeAsn1Data>" << 42 << "</OdeAsn1Data>";
+    CHECK(pstream.size() == 29);
+    CHECK(std::string(pstream.data(), pstream.size()) == "<OdeAsn1Data>42</OdeAsn1Data>");
+
+    // the released buffer belongs to the caller (librdkafka RK_MSG_FREE); the stream starts over.
+    char* buffer = pstream.release( len );
+    CHECK(len == 29);
+    CHECK(std::string(buffer, len) == "<OdeAsn1Data>42</OdeAsn1Data>");
+    CHECK(pstream.size() == 0);
+    std::free( buffer );
+
+    pstream << "abc";
+    pstream.reset();
+    CHECK(pstream.size() == 0);
+    pstream << 'x';
+    CHECK(std::string(pstream.data(), pstream.size()) == "x");
+}
+
+TEST_CASE("Output Buffer Pool Tests", "[kafka]" ) {
+    OutputBufferPool pool{ 8, 2 };
+    std::size_t len;
+
+    char* buffer = nullptr;
+    {
+        ProduceStream pstream{ 4096, &pool };
+        pstream << "<OdeAsn1Data>" << 42 << "</OdeAsn1Data>";
+
+        // the buffer grew past the pool's buffer size and keeps its capacity.
+        buffer = pstream.release( len );
+        CHECK(std::string(buffer, len) == "<OdeAsn1Data>42</OdeAsn1Data>");
+        CHECK(OutputBufferPool::capacity( buffer ) >= len);
+        CHECK(pool.available() == 0);
+    }
+
+    // the stream returned its unused buffer; the delivery report returns the produced one.
+    CHECK(pool.available() == 1);
+    pool.release( buffer );
+    CHECK(pool.available() == 2);
+
+    char* reused = pool.acquire();
+    CHECK((reused == buffer || OutputBufferPool::capacity( reused ) == 8));
+    pool.release( reused );
+
+    // beyond the retained limit buffers are freed.
+    char* extra = pool.acquire();
+    char* more = pool.acquire();
+    char* fresh = pool.acquire();
+    pool.release( extra );
+    pool.release( more );
+    pool.release( fresh );
+    CHECK(pool.available() == 2);
+}
+
+TEST_CASE("Ring Queue Tests", "[kafka]" ) {
+    RingQueue<std::unique_ptr<int>> queue{ 3 };
+    CHECK(queue.capacity() == 4);
+
+    // the items arrive once, in order, and the queue drains after it is closed.
+    std::thread producer{ [&queue]() {
+        for ( int i = 0; i < 1000; ++i ) {
+            queue.push( std::unique_ptr<int>{ new int{ i } } );
+        }
+        queue.close();
+    } };
+
+    std::unique_ptr<int> item;
+    int expected = 0;
+    while ( queue.pop( item ) ) {
+        CHECK(*item == expected);
+        ++expected;
+    }
+    producer.join();
+
+    CHECK(expected == 1000);
+    CHECK(queue.size() == 0);
+    CHECK(!queue.push( std::unique_ptr<int>{ new int{ 0 } } ));
+
+    // a full queue leaves the item with the caller.
+    RingQueue<std::unique_ptr<int>> full{ 2 };
+    std::unique_ptr<int> first{ new int{ 1 } };
+    std::unique_ptr<int> second{ new int{ 2 } };
+    std::unique_ptr<int> third{ new int{ 3 } };
+    CHECK(full.try_push( first ));
+    CHECK(full.try_push( second ));
+    CHECK(!full.try_push( third ));
+    CHECK(!first);
+    REQUIRE(third);
+    CHECK(*third == 3);
+    REQUIRE(full.try_pop( item ));
+    CHECK(full.try_push( third ));
+}
+
+TEST_CASE("Lane Queue Tests", "[kafka]" ) {
+    LaneQueue<int> queue{ 2, 16 };
+    int item;
+    std::size_t lane;
+
+    // strict: the normal lane waits until the priority lane is empty.
+    for ( int i = 0; i < 3; ++i ) queue.push( 100 + i, 1 );
+    for ( int i = 0; i < 2; ++i ) queue.push( i, 0 );
+    CHECK(queue.size() == 5);
+    CHECK(queue.size( 0 ) == 2);
+    std::vector<int> order;
+    for ( int i = 0; i < 5; ++i ) {
+        REQUIRE(queue.pop( item, &lane ));
+        CHECK(lane == ( item < 100 ? 0 : 1 ));
+        order.push_back( item );
+    }
+    CHECK(order == std::vector<int>( { 0, 1, 100, 101, 102 } ));
+
+    // weighted: two priority items, then one normal item.
+    queue.set_weight( 2 );
+    for ( int i = 0; i < 2; ++i ) queue.push( 100 + i, 1 );
+    for ( int i = 0; i < 5; ++i ) queue.push( i, 0 );
+    order.clear();
+    for ( int i = 0; i < 7; ++i ) {
+        REQUIRE(queue.pop( item ));
+        order.push_back( item );
+    }
+    CHECK(order == std::vector<int>( { 0, 1, 100, 2, 3, 101, 4 } ));
+
+    // a full normal lane refuses an item without moving from it, and the priority lane still takes items.
+    for ( int i = 0; i < 16; ++i ) {
+        item = 200 + i;
+        REQUIRE(queue.try_push( item, 1 ));
+    }
+    item = 216;
+    CHECK(!queue.try_push( item, 1 ));
+    CHECK(item == 216);
+    item = 9;
+    CHECK(queue.try_push( item, 0 ));
+    REQUIRE(queue.pop( item, &lane ));
+    CHECK(item == 9);
+    CHECK(lane == 0);
+    while ( queue.size() > 0 ) queue.pop( item );
+
+    // the lanes drain after the queue is closed.
+    queue.push( 7, 1 );
+    queue.close();
+    CHECK(!queue.push( 8, 0 ));
+    CHECK(queue.pop( item ));
+    CHECK(item == 7);
+    CHECK(!queue.pop( item ));
+}
+
+TEST_CASE("CPU Affinity Tests", "[kafka]" ) {
+    CHECK(cpu_affinity::parse( "" ).empty());
+    CHECK(cpu_affinity::parse( "0-3, 8,10-11" ) == std::vector<int>( { 0, 1, 2, 3, 8, 10, 11 } ));
+    CHECK(cpu_affinity::parse( "5" ) == std::vector<int>( { 5 } ));
+
+    CHECK_THROWS_AS(cpu_affinity::parse( "3-1" ), const std::invalid_argument&);
+    CHECK_THROWS_AS(cpu_affinity::parse( "1,,2" ), const std::invalid_argument&);
+    CHECK_THROWS_AS(cpu_affinity::parse( "a" ), const std::invalid_argument&);
+
+    CHECK(cpu_affinity::pin_current_thread( {} ));
+
+    // a thread's CPUs can be narrowed and given back; on its own thread, so the test's is not moved.
+    std::thread placed{ [] {
+        std::vector<int> cpus = cpu_affinity::current_cpus();
+        if ( cpus.empty() ) return;
+        CHECK(cpu_affinity::pin_current_thread( { cpus.back() } ));
+        CHECK(cpu_affinity::current_cpus() == std::vector<int>( { cpus.back() } ));
+        CHECK(cpu_affinity::pin_current_thread( cpus ));
+        CHECK(cpu_affinity::current_cpus() == cpus);
+    } };
+    placed.join();
+}
+
+TEST_CASE("Commit Manager Tests", "[kafka]" ) {
+    CommitManager commits;
+    std::vector<CommitManager::Offset> offsets;
+
+    CommitManager::Token* a = commits.track( "topic", 0, 10 );
+    CommitManager::Token* b = commits.track( "topic", 0, 11 );
+    CommitManager::Token* c = commits.track( "topic", 0, 12 );
+    CommitManager::Token* d = commits.track( "topic", 3, 7 );
+
+    // nothing is committable until the first message of a partition is delivered.
+    commits.complete( b );
+    CHECK(commits.take_commits( offsets ) == 0);
+
+    commits.complete( a );
+    REQUIRE(commits.take_commits( offsets ) == 1);
+    CHECK(offsets[0].topic == "topic");
+    CHECK(offsets[0].partition == 0);
+    CHECK(offsets[0].offset == 12);
+
+    // partitions that did not advance are not committed again.
+    CHECK(commits.take_commits( offsets ) == 0);
+    CHECK(commits.pending() == 2);
+
+    commits.complete( c );
+    REQUIRE(commits.take_commits( offsets ) == 1);
+    CHECK(offsets[0].offset == 13);
+    CHECK(commits.pending() == 1);
+
+    // a revoked partition is released once it has nothing in flight; its last offset is committed with it.
+    CommitManager::Offset offset;
+    commits.complete( commits.track( "topic", 0, 13 ) );
+    CHECK(commits.pending( "topic", 3 ) == 1);
+    CHECK(commits.pending( "topic", 0 ) == 0);
+    REQUIRE(commits.release( "topic", 0, offset ));
+    CHECK(offset.offset == 14);
+    CHECK(!commits.release( "topic", 0, offset ));
+    CHECK(!commits.release( "topic", 3, offset ));
+    CHECK(commits.pending( "topic", 3 ) == 1);
+
+    std::vector<CommitManager::Position> positions = commits.positions();
+    REQUIRE(positions.size() == 1);
+    CHECK(positions[0].partition == 3);
+    CHECK(positions[0].first == 7);
+    CHECK(positions[0].last == 7);
+    CHECK(positions[0].pending == 1);
+
+    // a failed delivery in front of later ones that succeed does not hold back its partition.
+    CommitManager::Token* failed = commits.track( "topic", 5, 20 );
+    CommitManager::Token* later = commits.track( "topic", 5, 21 );
+    CommitManager::Token* last = commits.track( "topic", 5, 22 );
+    commits.complete( later );
+    commits.complete( last );
+    CHECK(commits.take_commits( offsets ) == 0);
+    commits.complete( failed, false );
+    REQUIRE(commits.take_commits( offsets ) == 1);
+    CHECK(offsets[0].partition == 5);
+    CHECK(offsets[0].offset == 23);
+    CHECK(commits.pending( "topic", 5 ) == 0);
+    CHECK(commits.failures() == 1);
+}
+
+TEST_CASE("Hex Codec Tests", "[hex]" ) {
+    // long enough to use the vector paths plus a scalar remainder.
+    std::vector<char> bytes;
+    for ( int i = 0; i < 83; ++i ) bytes.push_back( static_cast<char>( i * 37 + 11 ) );
+
+    std::string hex;
+    hex_codec::encode( bytes.data(), bytes.size(), hex );
+    CHECK(hex.size() == 166);
+    CHECK(hex.substr(0,8) == "0B30557A");
+
+    std::vector<char> decoded;
+    CHECK(hex_codec::decode( hex, decoded ) == hex_codec::npos);
+    CHECK(decoded == bytes);
+
+    // lower case input is accepted.
+    std::string lower = hex;
+    for ( auto& c : lower ) c = std::tolower( c );
+    CHECK(hex_codec::decode( lower, decoded ) == hex_codec::npos);
+    CHECK(decoded == bytes);
+
+    // the exact offset of a bad character is reported.
+    hex[71] = 'G';
+    CHECK(hex_codec::decode( hex, decoded ) == 71);
+    hex[71] = '0';
+    hex[165] = ' ';
+    CHECK(hex_codec::decode( hex, decoded ) == 165);
+}
+
+TEST_CASE("Base64 Codec Tests", "[hex]" ) {
+    // long enough to use the vector paths plus a scalar remainder and padding.
+    std::vector<char> bytes;
+    for ( int i = 0; i < 83; ++i ) bytes.push_back( static_cast<char>( i * 37 + 11 ) );
+
+    std::string text;
+    base64_codec::encode( bytes.data(), bytes.size(), text );
+    CHECK(text.size() == 112);
+    CHECK(text.substr(0,8) == "CzBVep/E");
+    CHECK(text.substr(108) == "wOU=");
+
+    std::vector<char> decoded;
+    CHECK(base64_codec::decode( text, decoded ) == base64_codec::npos);
+    CHECK(decoded == bytes);
+
+    // the padding is optional.
+    CHECK(base64_codec::decode( text.substr( 0, 111 ), decoded ) == base64_codec::npos);
+    CHECK(decoded == bytes);
+
+    // the exact offset of a bad character is reported; padding only ends the text.
+    text[71] = '-';
+    CHECK(base64_codec::decode( text, decoded ) == 71);
+    text[71] = '=';
+    CHECK(base64_codec::decode( text, decoded ) == 71);
+    CHECK(base64_codec::decode( std::string{ "QUJDR" }, decoded ) == 4);
+}
+
+TEST_CASE("Asn1Arena Tests", "[arena]" ) {
+    Asn1Arena arena{ 4096 };
+
+    void* heap = acm_asn_malloc( 32 );              // no scope: C library memory.
+    CHECK(!arena.owns( heap ));
+
+    {
+        Asn1Arena::Scope scope{ &arena };
+        CHECK(Asn1Arena::current() == &arena);
+
+        char* p = static_cast<char*>( acm_asn_calloc( 10, 10 ) );
+        CHECK(arena.owns( p ));
+        CHECK(p[99] == 0);
+        std::memcpy( p, "arena", 6 );
+
+        // grows in place or moves; the contents are kept.
+        p = static_cast<char*>( acm_asn_realloc( p, 8192 ) );
+        CHECK(arena.owns( p ));
+        CHECK(std::strcmp( p, "arena" ) == 0);
+        CHECK(arena.bytes_allocated() >= 8192);
+
+        acm_asn_free( p );                          // no-op for arena memory.
+        acm_asn_free( heap );                       // C library memory is still freed.
+    }
+
+    CHECK(Asn1Arena::current() == nullptr);
+    CHECK(arena.bytes_allocated() == 0);
+    CHECK(arena.bytes_reserved() >= 8192);
+
+    // a message over its limit gets no more memory until the reset.
+    arena.set_limit( 1024 );
+    CHECK(arena.allocate( 512 ) != nullptr);
+    CHECK(arena.allocate( 1024 ) == nullptr);
+    CHECK(arena.exceeded() == Asn1Arena::Exceeded::MEMORY);
+    CHECK(arena.allocate( 1 ) == nullptr);
+    arena.reset();
+    CHECK(arena.exceeded() == Asn1Arena::Exceeded::NONE);
+    CHECK(arena.allocate( 512 ) != nullptr);
+
+    arena.set_deadline( std::chrono::steady_clock::now() - std::chrono::milliseconds{ 1 } );
+    for ( int i = 0; i < 64 && arena.allocate( 1 ); ++i ) {}
+    CHECK(arena.exceeded() == Asn1Arena::Exceeded::TIME);
+    arena.reset();
+
+    // the chunks of a large message are released at the reset; the first is kept.
+    arena.set_limit( 0 );
+    arena.set_retain( 4096 );
+    CHECK(arena.allocate( 3000 ) != nullptr);
+    CHECK(arena.allocate( 3000 ) != nullptr);
+    CHECK(arena.bytes_reserved() > 4096);
+    arena.reset();
+    CHECK(arena.bytes_reserved() <= 16384);
+    CHECK(arena.allocate( 16 ) != nullptr);
+    arena.reset();
+}
+
+TEST_CASE("XML Page Pool Tests", "[arena]" ) {
+    XmlPagePool pool{ 4096 };
+
+    void* page = pool.allocate( 32808 );
+    CHECK(pool.owns( page ));
+    pool.release( page );
+    CHECK(pool.allocate( 32800 ) == page);           // the same class is recycled.
+    CHECK(pool.blocks_recycled() == 1);
+    CHECK(pool.allocate( 1 << 20 ) == nullptr);      // larger than the largest class.
+
+    // a block freed on another thread goes back to its pool, and is reused when its class runs out.
+    void* away = pool.allocate( 100 );
+    std::thread{ [&pool, away] { pool.release_remote( away ); } }.join();
+    CHECK(pool.allocate( 100 ) == away);
+    CHECK(pool.blocks_recycled() == 2);
+
+    {
+        XmlPagePool::Scope scope{ &pool };
+        CHECK(XmlPagePool::current() == &pool);
+    }
+    CHECK(XmlPagePool::current() == nullptr);
+
+    // the documents of a context with a pool give the same responses as those without.
+    std::string input = read_file( "data/InputData.encoding.tim.xml" );
+    REQUIRE(!input.empty());
+
+    std::string responses[2];
+    for ( std::size_t chunk_size : { std::size_t{ 0 }, std::size_t{ 1 } << 16 } ) {
+        CodecContext codec{ nullptr, nullptr, false };
+        codec.use_xml_pool( chunk_size );
+        for ( int i = 0; i < 3; ++i ) {
+            std::stringstream output;
+            CHECK(codec.process( input.data(), input.size(), output ));
+            responses[ chunk_size > 0 ] = output.str();
+        }
+    }
+    CHECK(responses[0] == responses[1]);
+}
+
+TEST_CASE("Allocation Counter Tests", "[arena]" ) {
+    AllocCounter counter;
+    void* volatile p = std::malloc( 100 );
+    std::free( p );
+
+    AllocCounter::Counts counts = counter.counts();
+    if ( !AllocCounter::enabled() ) {
+        CHECK(counts.allocations == 0);
+        CHECK(counts.bytes == 0);
+        return;
+    }
+
+    CHECK(counts.allocations >= 1);
+    CHECK(counts.bytes >= 100);
+    CHECK(counts.frees >= 1);
+
+    // the steady state decode of a signed BSM; raise the bounds only for a change that needs the allocations.
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.use_xml_pool( 1 << 20 );
+
+    std::stringstream output;
+    for ( int i = 0; i < 10; ++i ) {
+        output.str( "" );
+        CHECK(codec.process( input.data(), input.size(), output ));
+    }
+
+    const int messages = 100;
+    counter.restart();
+    for ( int i = 0; i < messages; ++i ) {
+        output.str( "" );
+        codec.process( input.data(), input.size(), output );
+    }
+    counts = counter.counts();
+
+    CHECK(counts.allocations / messages <= 400);
+    CHECK(counts.bytes / messages <= 64 * 1024);
+}
+
+TEST_CASE("Decoded XER Splice Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+
+    std::stringstream spliced;
+    CHECK(codec.process( input.data(), input.size(), spliced ));
+
+    codec.set_splice_output( false );
+    std::stringstream parsed;
+    CHECK(codec.process( input.data(), input.size(), parsed ));
+
+    // both outputs have the same decoded MessageFrame.
+    pugi::xml_document spliced_doc;
+    pugi::xml_document parsed_doc;
+    CHECK(spliced_doc.load(spliced, pugi::parse_default | pugi::parse_trim_pcdata));
+    CHECK(parsed_doc.load(parsed, pugi::parse_default | pugi::parse_trim_pcdata));
+
+    std::stringstream spliced_frame;
+    std::stringstream parsed_frame;
+    ode_payload_query.evaluate_node(spliced_doc).node().child("MessageFrame").print(spliced_frame, "", pugi::format_raw);
+    ode_payload_query.evaluate_node(parsed_doc).node().child("MessageFrame").print(parsed_frame, "", pugi::format_raw);
+    CHECK(!spliced_frame.str().empty());
+    CHECK(spliced_frame.str() == parsed_frame.str());
+    CHECK(spliced.str().find("acm-xer") == std::string::npos);
+}
+
+TEST_CASE("Encode Input Slice Tests", "[encoding]" ) {
+    std::string input = read_file( "data/InputData.encoding.tim.pp.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, false };
+    codec.set_dom_input( false );
+
+    std::stringstream sliced;
+    CHECK(codec.process( input.data(), input.size(), sliced ));
+
+    codec.set_slice_input( false );
+    std::stringstream serialized;
+    CHECK(codec.process( input.data(), input.size(), serialized ));
+
+    // the slice of the pretty printed input encodes to the same bytes.
+    pugi::xml_document sliced_doc;
+    pugi::xml_document serialized_doc;
+    CHECK(sliced_doc.load(sliced));
+    CHECK(serialized_doc.load(serialized));
+
+    std::string sliced_hex = ode_payload_query.evaluate_node(sliced_doc).node().child("MessageFrame").child("bytes").text().get();
+    std::string serialized_hex = ode_payload_query.evaluate_node(serialized_doc).node().child("MessageFrame").child("bytes").text().get();
+    CHECK(!sliced_hex.empty());
+    CHECK(sliced_hex == serialized_hex);
+}
+
+TEST_CASE("Encode DOM Input Tests", "[encoding]" ) {
+    // filling the structures from the document encodes every layer to the same bytes as the XER decoder.
+    for ( const char* file : { "data/InputData.encoding.tim.pp.xml", "data/InputData.encoding.bsm.xml", "unit-test-data/1609_BSM.xml",
+                               "unit-test-data/ASD_1609_BSM.xml" } ) {
+        INFO( file );
+        std::string input = read_file( file );
+        REQUIRE(!input.empty());
+
+        CodecContext codec{ nullptr, nullptr, false };
+
+        std::stringstream filled;
+        CHECK(codec.process( input.data(), input.size(), filled ));
+
+        codec.set_dom_input( false );
+        std::stringstream decoded;
+        CHECK(codec.process( input.data(), input.size(), decoded ));
+
+        pugi::xml_document filled_doc;
+        pugi::xml_document decoded_doc;
+        CHECK(filled_doc.load(filled));
+        CHECK(decoded_doc.load(decoded));
+
+        std::stringstream filled_data, decoded_data;
+        ode_payload_query.evaluate_node(filled_doc).node().print( filled_data );
+        ode_payload_query.evaluate_node(decoded_doc).node().print( decoded_data );
+        CHECK(filled_data.str().find("bytes") != std::string::npos);
+        CHECK(filled_data.str() == decoded_data.str());
+    }
+
+    // an element asn1c does not accept is not accepted either.
+    std::string input = read_file( "data/InputData.encoding.tim.error.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, false };
+    std::stringstream filled;
+    CHECK_FALSE(codec.process( input.data(), input.size(), filled ));
+}
+
+TEST_CASE("Encode Cache Tests", "[encoding]" ) {
+    std::string input = read_file( "data/InputData.encoding.tim.pp.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, false };
+    codec.use_encode_cache( 1 << 20 );
+
+    std::stringstream first, second;
+    CHECK(codec.process( input.data(), input.size(), first ));
+    CHECK(codec.process( input.data(), input.size(), second ));
+    CHECK(codec.encode_cache_stats().misses == 1);
+    CHECK(codec.encode_cache_stats().hits == 1);
+    CHECK(codec.message_id() == 31);
+
+    pugi::xml_document first_doc;
+    pugi::xml_document second_doc;
+    CHECK(first_doc.load(first));
+    CHECK(second_doc.load(second));
+
+    std::string first_hex = ode_payload_query.evaluate_node(first_doc).node().child("MessageFrame").child("bytes").text().get();
+    std::string second_hex = ode_payload_query.evaluate_node(second_doc).node().child("MessageFrame").child("bytes").text().get();
+    CHECK(!first_hex.empty());
+    CHECK(first_hex == second_hex);
+
+    // each layer of a nested encode is kept with the encoding it encloses.
+    std::string nested = read_file( "unit-test-data/ASD_1609_BSM.xml" );
+    REQUIRE(!nested.empty());
+
+    CodecContext nested_codec{ nullptr, nullptr, false };
+    nested_codec.use_encode_cache( 1 << 20 );
+
+    std::stringstream nested_first, nested_second;
+    CHECK(nested_codec.process( nested.data(), nested.size(), nested_first ));
+    CHECK(nested_codec.process( nested.data(), nested.size(), nested_second ));
+    CHECK(nested_codec.encode_cache_stats().misses == 3);
+    CHECK(nested_codec.encode_cache_stats().hits == 3);
+
+    CHECK(second_doc.load(nested_second));
+    CHECK(std::strcmp(ode_payload_query.evaluate_node(second_doc).node().child("AdvisorySituationData").child("bytes").text().get(), ASD_ONE609_HEX) == 0);
+}
+
+TEST_CASE("Encode Template Tests", "[encoding]" ) {
+    std::string input = read_file( "data/InputData.encoding.tim.pp.xml" );
+    REQUIRE(!input.empty());
+
+    // the next deposit of the same TIM with its counters and times moved on.
+    std::string next = input;
+    for ( const auto& change : std::vector<std::pair<std::string, std::string>>{
+            { "<msgCnt>1<", "<msgCnt>2<" }, { "<timeStamp>309505<", "<timeStamp>309512<" },
+            { "<packetID>000000000000000000<", "<packetID>0102030405060708AB<" },
+            { "<startTime>308065<", "<startTime>308070<" }, { "<duratonTime>1<", "<duratonTime>30<" } } ) {
+        std::size_t at = next.find( change.first );
+        REQUIRE(at != std::string::npos);
+        next.replace( at, change.first.size(), change.second );
+    }
+
+    CodecContext codec{ nullptr, nullptr, false };
+    codec.use_encode_templates( 4 );
+
+    std::stringstream first, second;
+    CHECK(codec.process( input.data(), input.size(), first ));
+    CHECK(codec.process( next.data(), next.size(), second ));
+    REQUIRE(codec.encode_templates() != nullptr);
+    CHECK(codec.encode_templates()->misses() == 1);
+    CHECK(codec.encode_templates()->hits() == 1);
+    CHECK(codec.encode_templates()->size() == 1);
+    CHECK(codec.message_id() == 31);
+
+    // the patched template encodes to the bytes of the TIM decoded from its own XML.
+    CodecContext plain{ nullptr, nullptr, false };
+    std::stringstream expected;
+    CHECK(plain.process( next.data(), next.size(), expected ));
+
+    pugi::xml_document second_doc;
+    pugi::xml_document expected_doc;
+    CHECK(second_doc.load(second));
+    CHECK(expected_doc.load(expected));
+
+    std::string second_hex = ode_payload_query.evaluate_node(second_doc).node().child("MessageFrame").child("bytes").text().get();
+    std::string expected_hex = ode_payload_query.evaluate_node(expected_doc).node().child("MessageFrame").child("bytes").text().get();
+    CHECK(!second_hex.empty());
+    CHECK(second_hex == expected_hex);
+
+    // any other change is another template.
+    std::string other = next;
+    std::size_t at = other.find( "<startYear>2017<" );
+    REQUIRE(at != std::string::npos);
+    other.replace( at, 16, "<startYear>2018<" );
+
+    std::stringstream third;
+    CHECK(codec.process( other.data(), other.size(), third ));
+    CHECK(codec.encode_templates()->misses() == 2);
+    CHECK(codec.encode_templates()->size() == 2);
+
+    TimTemplates templates;
+    CHECK_FALSE(templates.split( "<MessageFrame><messageId>20</messageId></MessageFrame>", 54 ));
+}
+
+TEST_CASE("Batch Encode Tests", "[encoding]" ) {
+    std::string input = read_file( "data/InputData.encoding.tim.pp.xml" );
+    std::size_t begin = input.find( "<data>" ) + 6;
+    std::size_t end = input.find( "</data>" );
+    REQUIRE(begin < end);
+
+    // the same MessageFrame three times under one encodings block.
+    std::string batch = input;
+    std::string frame = input.substr( begin, end - begin );
+    batch.insert( end, frame + frame );
+
+    CodecContext codec{ nullptr, nullptr, false };
+
+    std::stringstream single;
+    CHECK(codec.process( input.data(), input.size(), single ));
+    std::stringstream batched;
+    CHECK(codec.process( batch.data(), batch.size(), batched ));
+
+    pugi::xml_document single_doc;
+    pugi::xml_document batched_doc;
+    CHECK(single_doc.load(single));
+    CHECK(batched_doc.load(batched));
+
+    std::string hex = ode_payload_query.evaluate_node(single_doc).node().child("MessageFrame").child("bytes").text().get();
+    CHECK(!hex.empty());
+
+    int count = 0;
+    for ( pugi::xml_node node = ode_payload_query.evaluate_node(batched_doc).node().first_child(); node; node = node.next_sibling() ) {
+        CHECK(std::string{ node.name() } == "MessageFrame");
+        CHECK(hex == node.child("bytes").text().get());
+        ++count;
+    }
+    CHECK(count == 3);
+}
+
+TEST_CASE("ODE Envelope Scanner Tests", "[decoding]" ) {
+    OdeEnvelope envelope;
+
+    std::string packed{ "<?xml version=\"1.0\"?><OdeAsn1Data><metadata><encodings><encodings><elementName>root</elementName><elementType>MessageFrame</elementType><encodingRule>UPER</encodingRule></encodings></encodings></metadata><payload><dataType>us.dot.its.jpo.ode.model.OdeHexByteArray</dataType><data><bytes> 0014 </bytes></data></payload></OdeAsn1Data>" };
+
+    REQUIRE(envelope.scan( packed.data(), packed.size() ));
+    REQUIRE(envelope.encodings().size() == 1);
+    CHECK(std::string( envelope.encodings()[0].element_type.begin, envelope.encodings()[0].element_type.size ) == "MessageFrame");
+    CHECK(std::string( envelope.encodings()[0].encoding_rule.begin, envelope.encodings()[0].encoding_rule.size ) == "UPER");
+    CHECK(std::string( envelope.data_type().begin, envelope.data_type().size ) == "us.dot.its.jpo.ode.model.OdeHexByteArray");
+    CHECK(std::string( envelope.bytes().begin, envelope.bytes().size ) == "0014");
+    CHECK(std::string( envelope.data().begin, envelope.data().size ) == "<bytes> 0014 </bytes>");
+
+    // envelopes that need the DOM.
+    std::string comment{ packed };
+    comment.insert( comment.find( "<payload>" ), "<!-- note -->" );
+    CHECK(!envelope.scan( comment.data(), comment.size() ));
+
+    std::string extra{ packed };
+    extra.insert( extra.find( "</data>" ), "<other/>" );
+    CHECK(!envelope.scan( extra.data(), extra.size() ));
+
+    CHECK(!envelope.scan( packed.data(), packed.size() - 1 ));
+
+    // a scanned decode has the same content as the DOM decode.
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+
+    std::stringstream scanned;
+    CHECK(codec.process( input.data(), input.size(), scanned ));
+
+    codec.set_scan_envelope( false );
+    std::stringstream loaded;
+    CHECK(codec.process( input.data(), input.size(), loaded ));
+
+    pugi::xml_document scanned_doc;
+    pugi::xml_document loaded_doc;
+    CHECK(scanned_doc.load(scanned, pugi::parse_default | pugi::parse_trim_pcdata));
+    CHECK(loaded_doc.load(loaded, pugi::parse_default | pugi::parse_trim_pcdata));
+
+    std::stringstream scanned_xml;
+    std::stringstream loaded_xml;
+    scanned_doc.save(scanned_xml, "", pugi::format_raw);
+    loaded_doc.save(loaded_xml, "", pugi::format_raw);
+    CHECK(scanned_xml.str() == loaded_xml.str());
+}
+
+TEST_CASE("Payload Text Encoding Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    std::size_t begin = input.find( "<bytes>" ) + 7;
+    std::size_t end = input.find( "</bytes>" );
+    std::string hex = input.substr( begin, end - begin );
+    std::vector<char> bytes;
+    REQUIRE(hex_codec::decode( hex, bytes ) == hex_codec::npos);
+
+    std::string base64;
+    base64_codec::encode( bytes.data(), bytes.size(), base64 );
+
+    std::string wrapped{ hex };
+    for ( std::size_t i = 64; i < wrapped.size(); i += 65 ) wrapped.insert( i, "\n" );
+
+    std::string spaced = input.substr( 0, begin ) + wrapped + input.substr( end );
+    std::string encoded = input.substr( 0, begin - 7 ) + "<bytes encoding=\"base64\">" + base64 + input.substr( end );
+    std::string unknown = input.substr( 0, begin - 7 ) + "<bytes encoding=\"base32\">" + hex + input.substr( end );
+
+    // hex with line breaks and base64 decode, scanned or loaded, to the same payload as the hex.
+    for ( bool scan : { true, false } ) {
+        CodecContext codec{ nullptr, nullptr, true };
+        codec.set_scan_envelope( scan );
+
+        std::stringstream expected;
+        CHECK(codec.process( input.data(), input.size(), expected ));
+        pugi::xml_document expected_doc;
+        CHECK(expected_doc.load(expected));
+        std::stringstream expected_data;
+        ode_payload_query.evaluate_node(expected_doc).node().print( expected_data );
+
+        for ( const std::string* message : { &spaced, &encoded } ) {
+            std::stringstream output;
+            CHECK(codec.process( message->data(), message->size(), output ));
+            pugi::xml_document doc;
+            CHECK(doc.load(output));
+            std::stringstream data;
+            ode_payload_query.evaluate_node(doc).node().print( data );
+            CHECK(data.str() == expected_data.str());
+        }
+
+        std::stringstream output;
+        CHECK_FALSE(codec.process( unknown.data(), unknown.size(), output ));
+    }
+
+    // the encoder writes base64 when asked; it is the same encoding as the hex.
+    std::string request = read_file( "data/InputData.encoding.bsm.xml" );
+    REQUIRE(!request.empty());
+
+    CodecContext codec{ nullptr, nullptr, false };
+    std::stringstream as_hex;
+    CHECK(codec.process( request.data(), request.size(), as_hex ));
+    codec.set_base64_output( true );
+    std::stringstream as_base64;
+    CHECK(codec.process( request.data(), request.size(), as_base64 ));
+
+    pugi::xml_document hex_doc;
+    pugi::xml_document base64_doc;
+    REQUIRE(hex_doc.load(as_hex));
+    REQUIRE(base64_doc.load(as_base64));
+    pugi::xml_node hex_bytes = ode_payload_query.evaluate_node(hex_doc).node().first_child().child("bytes");
+    pugi::xml_node base64_bytes = ode_payload_query.evaluate_node(base64_doc).node().first_child().child("bytes");
+    CHECK(std::string{ base64_bytes.attribute("encoding").value() } == "base64");
+
+    std::vector<char> from_hex, from_base64;
+    CHECK(hex_codec::decode( std::string{ hex_bytes.text().get() }, from_hex ) == hex_codec::npos);
+    CHECK(base64_codec::decode( std::string{ base64_bytes.text().get() }, from_base64 ) == base64_codec::npos);
+    CHECK(!from_hex.empty());
+    CHECK(from_hex == from_base64);
+}
+
+TEST_CASE("Cached Codec Requirements Tests", "[decoding]" ) {
+    std::vector<std::string> inputs;
+    for ( const char* file : { "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml", "data/InputData.TravelerInformation.packed.xml" } ) {
+        inputs.emplace_back( read_file( file ) );
+        REQUIRE(!inputs.back().empty());
+    }
+
+    CodecContext codec{ nullptr, nullptr, true };
+
+    // alternating encodings blocks through both the scanned and the DOM paths give the same output every time.
+    for ( bool scan : { true, false } ) {
+        codec.set_scan_envelope( scan );
+
+        std::vector<std::string> first;
+        for ( int i = 0; i < 4; ++i ) {
+            std::stringstream output;
+            CHECK(codec.process( inputs[i % 2].data(), inputs[i % 2].size(), output ));
+            CHECK(output.str().find("<MessageFrame>") != std::string::npos);
+
+            if ( i < 2 ) {
+                first.push_back( output.str() );
+            } else {
+                CHECK(output.str() == first[i % 2]);
+            }
+        }
+    }
+}
+
+TEST_CASE("JSON Output Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_json_output( true );
+
+    std::stringstream output;
+    CHECK(codec.process( input.data(), input.size(), output ));
+
+    rapidjson::Document doc;
+    REQUIRE(!doc.Parse( output.str().c_str() ).HasParseError());
+    REQUIRE(doc.HasMember("OdeAsn1Data"));
+
+    const rapidjson::Value& payload = doc["OdeAsn1Data"]["payload"];
+    CHECK(std::string{ payload["dataType"].GetString() } == "MessageFrame");
+
+    const rapidjson::Value& frame = payload["data"]["MessageFrame"];
+    CHECK(frame["messageId"].GetInt() == 20);
+    REQUIRE(frame["value"].HasMember("BasicSafetyMessage"));
+    CHECK(frame["value"]["BasicSafetyMessage"]["coreData"]["msgCnt"].IsInt());
+    CHECK(output.str().find("acm-xer") == std::string::npos);
+
+    // errors are JSON too.
+    std::string bad{ "<OdeAsn1Data>" };
+    std::stringstream error;
+    CHECK(!codec.process( bad.data(), bad.size(), error ));
+    CHECK(!doc.Parse( error.str().c_str() ).HasParseError());
+}
+
+TEST_CASE("Concatenated PDU Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    std::size_t begin = input.find( "<bytes>" ) + 7;
+    std::size_t end = input.find( "</bytes>" );
+    REQUIRE(begin < end);
+
+    std::string hex = input.substr( begin, end - begin );
+    std::string two = input;
+    two.insert( end, hex );
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_concatenated_pdus( true );
+
+    for ( bool scan : { true, false } ) {
+        codec.set_scan_envelope( scan );
+
+        std::stringstream output;
+        CHECK(codec.process( two.data(), two.size(), output ));
+
+        pugi::xml_document doc;
+        CHECK(doc.load(output));
+        pugi::xml_node frame = ode_payload_query.evaluate_node(doc).node().child("MessageFrame");
+        CHECK(frame);
+        CHECK(frame.next_sibling("MessageFrame"));
+        CHECK(!frame.next_sibling("MessageFrame").next_sibling("MessageFrame"));
+    }
+
+    // the bytes after the last complete PDU are an error.
+    std::string partial = input;
+    partial.insert( end, hex.substr( 0, 8 ) );
+    std::stringstream output;
+    CHECK(!codec.process( partial.data(), partial.size(), output ));
+}
+
+TEST_CASE("Decode Cache Tests", "[decoding]" ) {
+    ResultCache cache{ 1024 };
+    std::string a{ "0123456789abcdef0" }, b{ "0123456789abcdef1" };
+
+    CHECK(ResultCache::hash( a.data(), a.size() ) != ResultCache::hash( b.data(), b.size() ));
+    cache.insert( 1, a.data(), a.size(), "A", 1, 20, "key" );
+    int32_t tag = -1;
+    std::string label;
+    REQUIRE(cache.find( 1, a.data(), a.size(), &tag, &label ));
+    CHECK(tag == 20);
+    CHECK(label == "key");
+    CHECK(*cache.find( 1, a.data(), a.size() ) == "A");
+    CHECK(!cache.find( 2, a.data(), a.size() ));
+    CHECK(!cache.find( 1, b.data(), b.size() ));
+
+    // the least recently used entries make room for new ones.
+    for ( int i = 0; i < 16; ++i ) {
+        std::string input = std::to_string( i );
+        cache.insert( 1, input.data(), input.size(), "X", 1 );
+    }
+    CHECK(cache.stats().evictions > 0);
+    CHECK(cache.stats().bytes <= cache.capacity());
+    CHECK(!cache.find( 1, a.data(), a.size() ));
+
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.use_decode_cache( 1 << 20 );
+
+    // the messageId of a BSM, decoded and from the cache.
+    std::stringstream first, second;
+    CHECK(codec.process( input.data(), input.size(), first ));
+    CHECK(codec.message_id() == 20);
+    CHECK(codec.process( input.data(), input.size(), second ));
+    CHECK(codec.message_id() == 20);
+    CHECK(first.str() == second.str());
+    CHECK(codec.decode_cache_stats().hits == 1);
+    CHECK(codec.decode_cache_stats().misses == 1);
+
+    // the SPaT delta does not keep the other messages from the cache.
+    codec.use_spat_delta( true, 10 );
+    std::stringstream third;
+    CHECK(codec.process( input.data(), input.size(), third ));
+    CHECK(third.str() == first.str());
+    CHECK(codec.decode_cache_stats().hits == 2);
+    codec.use_spat_delta( false, 10 );
+
+    // JSON output is kept separately.
+    codec.set_json_output( true );
+    std::stringstream json;
+    CHECK(codec.process( input.data(), input.size(), json ));
+    CHECK(codec.decode_cache_stats().misses == 2);
+
+    rapidjson::Document jdoc;
+    CHECK(!jdoc.Parse( json.str().c_str() ).HasParseError());
+}
+
+TEST_CASE("Error Template Tests", "[decoding]" ) {
+    CodecContext codec{ nullptr, nullptr, true };
+    REQUIRE(codec.load_error_template( "data/Output.error.xml" ));
+
+    std::string garbage{ "<OdeAsn1Data><payload>&<" };
+    std::stringstream output;
+    CHECK(!codec.process( garbage.data(), garbage.size(), output ));
+    CHECK(codec.message_id() == -1);
+
+    pugi::xml_document doc;
+    CHECK(doc.load(output));
+    pugi::xml_node metadata = doc.child("OdeAsn1Data").child("metadata");
+    pugi::xml_node data = doc.child("OdeAsn1Data").child("payload").child("data");
+    CHECK(std::string{ data.child("code").text().get() } == "INVALID_REQUEST_TYPE_ERROR");
+    CHECK(std::string{ data.child("message").text().get() }.find( "Input file parse error" ) == 0);
+    CHECK(!data.child("bytes"));
+    CHECK(std::string{ metadata.child("receivedAt").text().get() } == metadata.child("generatedAt").text().get());
+    CHECK(std::string{ metadata.child("generatedAt").text().get() } != "[TIMESTAMP]");
+
+    // the JSON responses are still converted from the template document.
+    codec.set_json_output( true );
+    std::stringstream json;
+    CHECK(!codec.process( garbage.data(), garbage.size(), json ));
+
+    rapidjson::Document jdoc;
+    REQUIRE(!jdoc.Parse( json.str().c_str() ).HasParseError());
+    CHECK(std::string{ jdoc["OdeAsn1Data"]["payload"]["data"]["code"].GetString() } == "INVALID_REQUEST_TYPE_ERROR");
+}
+
+TEST_CASE("Binary Input Tests", "[decoding]" ) {
+    CodecContext codec{ nullptr, nullptr, true };
+
+    std::vector<std::pair<const char*, std::string>> inputs{
+        { "data/j2735.MessageFrame.Bsm.uper", "MessageFrame:UPER" },
+        { "data/Ieee1609Dot2Data.unsecuredData.Bsm.coer", "Ieee1609Dot2Data:COER,MessageFrame:UPER" }
+    };
+
+    for ( auto& input : inputs ) {
+        std::string bytes = read_file( input.first );
+        REQUIRE(!bytes.empty());
+
+        std::stringstream output;
+        CHECK(codec.process_bytes( bytes.data(), bytes.size(), input.second.data(), input.second.size(), output ));
+
+        pugi::xml_document doc;
+        CHECK(doc.load(output));
+        CHECK(ode_payload_query.evaluate_node(doc).node().child("MessageFrame"));
+    }
+
+    // encodings this module cannot use are errors.
+    std::string bytes{ "\x00\x14", 2 };
+    for ( std::string encodings : { "MessageFrame", "MessageFrame:XXXX", "BasicSafetyMessage:UPER" } ) {
+        std::stringstream output;
+        CHECK(!codec.process_bytes( bytes.data(), bytes.size(), encodings.data(), encodings.size(), output ));
+    }
+}
+
+TEST_CASE("Layered Decode Tests", "[decoding]" ) {
+    CodecContext codec{ nullptr, nullptr, true };
+
+    // each container is decoded once and its OCTET STRING holds the next layer.
+    std::vector<std::pair<const char*, std::string>> inputs{
+        { ASD_BSM_HEX, "AdvisorySituationData:UPER,MessageFrame:UPER" },
+        { ASD_ONE609_HEX, "AdvisorySituationData:UPER,Ieee1609Dot2Data:COER,MessageFrame:UPER" }
+    };
+
+    for ( auto& input : inputs ) {
+        std::vector<char> bytes;
+        REQUIRE(hex_codec::decode( input.first, bytes ) == hex_codec::npos);
+
+        std::stringstream output;
+        CHECK(codec.process_bytes( bytes.data(), bytes.size(), input.second.data(), input.second.size(), output ));
+
+        pugi::xml_document doc;
+        CHECK(doc.load(output));
+        CHECK(ode_payload_query.evaluate_node(doc).node().child("MessageFrame").child("value").child("BasicSafetyMessage"));
+    }
+
+    // the ASD alone is only checked; a truncated ASD is an error.
+    std::vector<char> bytes;
+    REQUIRE(hex_codec::decode( ASD_BSM_HEX, bytes ) == hex_codec::npos);
+
+    std::string encodings{ "AdvisorySituationData:UPER" };
+    std::stringstream checked;
+    CHECK(codec.process_bytes( bytes.data(), bytes.size(), encodings.data(), encodings.size(), checked ));
+
+    encodings = "AdvisorySituationData:UPER,MessageFrame:UPER";
+    std::stringstream error;
+    CHECK(!codec.process_bytes( bytes.data(), 20, encodings.data(), encodings.size(), error ));
+}
+
+TEST_CASE("BSM Fast Path Tests", "[decoding]" ) {
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    std::size_t consumed = 0;
+    bsm_fast_path::Bsm bsm;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), bsm, &consumed ));
+    CHECK(consumed == bytes.size());
+    CHECK(bsm.has_path_history);
+
+    std::string fast;
+    bsm_fast_path::write_xer( bsm, fast );
+
+    // the canonical XER of asn1c.
+    MessageFrame_t* frame = nullptr;
+    asn_dec_rval_t rval = asn_decode( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MessageFrame, (void **)&frame, bytes.data(), bytes.size() );
+    REQUIRE(rval.code == RC_OK);
+    std::string canonical;
+    xer_encode( &asn_DEF_MessageFrame, frame, XER_F_CANONICAL, []( const void* buffer, size_t size, void* key ) {
+        static_cast<std::string*>( key )->append( static_cast<const char*>( buffer ), size );
+        return 0;
+    }, &canonical );
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+    CHECK(fast == canonical);
+
+    // truncated bytes and other messages are left to asn1c.
+    CHECK(!bsm_fast_path::decode( bytes.data(), bytes.size() - 1, bsm ));
+    std::string other = bytes;
+    other[1] = 31;
+    CHECK(!bsm_fast_path::decode( other.data(), other.size(), bsm ));
+
+    // the responses are the same on both paths.
+    std::string responses[2];
+    for ( bool path : { true, false } ) {
+        BsmCodec codec;
+        codec.set_bsm_fast_path( path );
+        std::stringstream output;
+        CHECK(codec.decode( bytes, output ));
+        CHECK(codec.message_id() == 20);
+        responses[ path ] = output.str();
+    }
+    CHECK(responses[0] == responses[1]);
+}
+
+TEST_CASE("BSM Columns Tests", "[decoding]" ) {
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    bsm_fast_path::Bsm bsm;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), bsm ));
+
+    // the truncated payload has no row; the rows know their payloads.
+    const void* payloads[] = { bytes.data(), bytes.data(), bytes.data() };
+    const std::size_t lengths[] = { bytes.size(), 3, bytes.size() };
+
+    BsmColumns columns;
+    CHECK(columns.decode( payloads, lengths, 3 ) == 2);
+    REQUIRE(columns.size() == 2);
+    CHECK(columns.input()[0] == 0);
+    CHECK(columns.input()[1] == 2);
+    CHECK(columns.id()[1] == BsmColumns::id_value( bsm ));
+    CHECK(columns.sec_mark()[1] == bsm.sec_mark);
+    CHECK(columns.lat()[1] == bsm.lat);
+    CHECK(columns.lon()[1] == bsm.lon);
+    CHECK(columns.elev()[1] == bsm.elev);
+    CHECK(columns.speed()[1] == bsm.speed);
+    CHECK(columns.heading()[1] == bsm.heading);
+    CHECK(columns.accel()[1] == bsm.accel_long);
+    CHECK(reinterpret_cast<std::uintptr_t>( columns.lat() ) % BsmColumns::alignment == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>( columns.accel() ) % BsmColumns::alignment == 0);
+
+    // the rows are kept when the columns grow.
+    for ( int i = 0; i < 100; ++i ) columns.append( bsm, 3 );
+    CHECK(columns.size() == 102);
+    CHECK(columns.input()[1] == 2);
+    CHECK(columns.lat()[101] == bsm.lat);
+
+    // the C API writes the caller's arrays and skips the NULL ones.
+    int32_t lat[3] = { 0, 0, 0 };
+    uint32_t input[3] = { 9, 9, 9 };
+    acm_bsm_columns c_columns;
+    std::memset( &c_columns, 0, sizeof( c_columns ) );
+    c_columns.capacity = 3;
+    c_columns.lat = lat;
+    c_columns.input = input;
+
+    std::size_t rows = 0;
+    CHECK(acm_decode_bsm_columns( payloads, lengths, 3, &c_columns, &rows ) == ACM_OK);
+    CHECK(rows == 2);
+    CHECK(lat[1] == bsm.lat);
+    CHECK(input[1] == 2);
+    CHECK(input[2] == 9);
+
+    c_columns.capacity = 2;
+    CHECK(acm_decode_bsm_columns( payloads, lengths, 3, &c_columns, &rows ) == ACM_BUFFER_TOO_SMALL);
+    CHECK(acm_decode_bsm_columns( payloads, lengths, 3, &c_columns, nullptr ) == ACM_INVALID_ARGUMENT);
+}
+
+TEST_CASE("Compact XER Tests", "[decoding]" ) {
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    auto append = []( const void* buffer, size_t size, void* key ) {
+        static_cast<std::string*>( key )->append( static_cast<const char*>( buffer ), size );
+        return 0;
+    };
+
+    MessageFrame_t* frame = nullptr;
+    asn_dec_rval_t rval = asn_decode( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MessageFrame, (void **)&frame, bytes.data(), bytes.size() );
+    REQUIRE(rval.code == RC_OK);
+    std::string canonical, compact;
+    xer_encode( &asn_DEF_MessageFrame, frame, XER_F_CANONICAL, append, &canonical );
+    ssize_t written = asn1_xer::write_compact( &asn_DEF_MessageFrame, frame, append, &compact );
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+    CHECK(written == static_cast<ssize_t>( compact.size() ));
+    CHECK(compact.size() < canonical.size());
+
+    // the enumerations are text; everything else is as in canonical XER.
+    pugi::xml_document compact_doc, canonical_doc;
+    REQUIRE(compact_doc.load_string( compact.c_str() ));
+    REQUIRE(canonical_doc.load_string( canonical.c_str() ));
+    pugi::xml_node core = compact_doc.child("MessageFrame").child("value").child("BasicSafetyMessage").child("coreData");
+    pugi::xml_node canonical_core = canonical_doc.child("MessageFrame").child("value").child("BasicSafetyMessage").child("coreData");
+    CHECK(std::string{ core.child("transmission").text().get() } == canonical_core.child("transmission").first_child().name());
+    CHECK(std::string{ core.child("lat").text().get() } == canonical_core.child("lat").text().get());
+    CHECK(std::string{ core.child("id").text().get() } == canonical_core.child("id").text().get());
+
+    // the fast path writes the same compact XER.
+    bsm_fast_path::Bsm bsm;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), bsm ));
+    std::string fast;
+    bsm_fast_path::write_xer( bsm, fast, true );
+    CHECK(fast == compact);
+
+    std::string responses[2];
+    for ( bool path : { true, false } ) {
+        BsmCodec codec;
+        codec.set_bsm_fast_path( path );
+        codec.set_compact_xer( true );
+        std::stringstream output;
+        CHECK(codec.decode( bytes, output ));
+        responses[ path ] = output.str();
+    }
+    CHECK(responses[0] == responses[1]);
+    CHECK(responses[0].find( compact ) != std::string::npos);
+}
+
+TEST_CASE("Message Key Tests", "[decoding]" ) {
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    bsm_fast_path::Bsm bsm;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), bsm ));
+    std::string id;
+    hex_codec::encode( bsm.id, sizeof( bsm.id ), id );
+
+    // the temporary id on both paths, and from the decode cache.
+    for ( bool path : { true, false } ) {
+        BsmCodec codec;
+        codec.set_bsm_fast_path( path );
+        codec.use_decode_cache( 1 << 20 );
+        codec.set_message_key( static_cast<uint32_t>( MessageKey::BSM_ID ) | static_cast<uint32_t>( MessageKey::TIM_PACKET_ID ) );
+        for ( int i = 0; i < 2; ++i ) {
+            std::stringstream output;
+            CHECK(codec.decode( bytes, output ));
+            CHECK(codec.message_key() == id);
+        }
+        CHECK(codec.decode_cache_stats().hits == 1);
+
+        // another field, or none, is no key.
+        codec.set_message_key( static_cast<uint32_t>( MessageKey::INTERSECTION_ID ) );
+        std::stringstream output;
+        CHECK(codec.decode( bytes, output ));
+        CHECK(codec.message_key().empty());
+    }
+
+    // an error has no key.
+    BsmCodec codec;
+    codec.set_message_key( static_cast<uint32_t>( MessageKey::BSM_ID ) );
+    std::stringstream output;
+    CHECK(codec.decode( bytes, output ));
+    CHECK(!codec.message_key().empty());
+    CHECK(!codec.decode( bytes.data(), 3, output ));
+    CHECK(codec.message_key().empty());
+}
+
+TEST_CASE("Projection Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CHECK_THROWS_AS(Asn1Projection{ "" }, const std::invalid_argument&);
+    CHECK_THROWS_AS(Asn1Projection{ "value//coreData" }, const std::invalid_argument&);
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_projection( "messageId, value/BasicSafetyMessage/coreData/lat,value/BasicSafetyMessage/coreData/long,value/TravelerInformation/msgCnt" );
+
+    std::stringstream output;
+    CHECK(codec.process( input.data(), input.size(), output ));
+
+    pugi::xml_document doc;
+    CHECK(doc.load(output));
+    pugi::xml_node frame = ode_payload_query.evaluate_node(doc).node().child("MessageFrame");
+    CHECK(std::string{ frame.child("messageId").text().get() } == "20");
+
+    pugi::xml_node core = frame.child("value").child("BasicSafetyMessage").child("coreData");
+    CHECK(core.child("lat"));
+    CHECK(core.child("long"));
+    CHECK(!core.child("msgCnt"));
+    CHECK(!frame.child("value").child("BasicSafetyMessage").child("partII"));
+
+    codec.set_json_output( true );
+    std::stringstream json;
+    CHECK(codec.process( input.data(), input.size(), json ));
+
+    rapidjson::Document jdoc;
+    REQUIRE(!jdoc.Parse( json.str().c_str() ).HasParseError());
+    const rapidjson::Value& jcore = jdoc["OdeAsn1Data"]["payload"]["data"]["MessageFrame"]["value"]["BasicSafetyMessage"]["coreData"];
+    CHECK(jcore["lat"].IsInt());
+    CHECK(jcore.MemberCount() == 2);
+}
+
+TEST_CASE("Binary Stream Input Tests", "[decoding]" ) {
+    BsmCodec codec;
+
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(bytes.size() > 1);
+
+    std::stringstream output;
+    std::vector<bool> results;
+    auto respond = [&]( bool success ) {
+        pugi::xml_document doc;
+        CHECK(doc.load(output));
+        CHECK(ode_payload_query.evaluate_node(doc).node().child("MessageFrame"));
+        results.push_back( success );
+        output.str( "" );
+        output.clear();
+    };
+
+    // a PDU split over two messages is decoded when its last byte arrives.
+    std::size_t half = bytes.size() / 2;
+    CHECK(codec.decode_stream( "t:0", bytes.data(), half, output, respond ) == 0);
+    CHECK(codec.carried_bytes( "t:0" ) == half);
+    CHECK(codec.carried_bytes( "t:1" ) == 0);
+
+    CHECK(codec.decode_stream( "t:0", bytes.data() + half, bytes.size() - half, output, respond ) == 1);
+    CHECK(codec.carried_bytes( "t:0" ) == 0);
+
+    // a message holding several PDUs has a response for each.
+    std::string two = bytes + bytes;
+    CHECK(codec.decode_stream( "t:1", two.data(), two.size(), output, respond ) == 2);
+    CHECK(codec.carried_bytes( "t:1" ) == 0);
+
+    CHECK(results == std::vector<bool>( 3, true ));
+}
+
+TEST_CASE("Payload Only Output Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_payload_only( true );
+
+    // the scanned and the DOM envelopes give the same payload and metadata.
+    for ( bool scan : { true, false } ) {
+        codec.set_scan_envelope( scan );
+
+        std::stringstream output;
+        CHECK(codec.process( input.data(), input.size(), output ));
+
+        pugi::xml_document doc;
+        CHECK(doc.load(output));
+        CHECK(doc.document_element().name() == std::string{ "MessageFrame" });
+
+        const CodecContext::ResponseMetadata& metadata = codec.response_metadata();
+        CHECK(metadata.payload_type == "us.dot.its.jpo.ode.model.OdeAsn1Payload");
+        CHECK(metadata.data_type == "MessageFrame");
+        CHECK(metadata.generated_at == "2017-08-10T21:02:14.799Z[UTC]");
+        CHECK(metadata.encodings == "MessageFrame:UPER,Ieee1609Dot2Data:UPER");
+    }
+
+    // errors are complete documents without metadata.
+    std::string bad{ "<OdeAsn1Data>" };
+    std::stringstream error;
+    CHECK(!codec.process( bad.data(), bad.size(), error ));
+    CHECK(codec.response_metadata().data_type.empty());
+}
+
+TEST_CASE("Constraint Validation Policy Tests", "[decoding]" ) {
+    CHECK(ValidationPolicy::parse( "always" ).mode == ValidationPolicy::Mode::ALWAYS);
+    CHECK(ValidationPolicy::parse( "off" ).mode == ValidationPolicy::Mode::OFF);
+    CHECK(ValidationPolicy::parse( "sample:4" ).rate_ppm == 250000);
+    CHECK(ValidationPolicy::parse( "sample:10%" ).rate_ppm == 100000);
+    for ( const char* bad : { "sometimes", "sample:", "sample:0", "sample:x", "sample:101%" } ) {
+        CHECK_THROWS_AS(ValidationPolicy::parse( bad ), const std::invalid_argument&);
+    }
+
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    CHECK(!codec.set_validation_policy( "BasicSafetyMessage", ValidationPolicy::parse( "off" ) ));
+    CHECK(codec.set_validation_policy( "Ieee1609Dot2Data", ValidationPolicy::parse( "off" ) ));
+    CHECK(codec.set_validation_policy( "MessageFrame", ValidationPolicy::parse( "sample:2" ) ));
+
+    for ( int i = 0; i < 4; ++i ) {
+        std::stringstream output;
+        CHECK(codec.process( input.data(), input.size(), output ));
+    }
+
+    // every 1609.2 frame and every other MessageFrame is skipped.
+    CHECK(codec.validation_stats().checked == 2);
+    CHECK(codec.validation_stats().skipped == 6);
+    CHECK(codec.validation_stats().violations == 0);
+}
+
+TEST_CASE("Lazy Decode Tests", "[decoding]" ) {
+    CHECK(!LazyDecode::parse( "off" ).enabled);
+    CHECK(LazyDecode::parse( "on" ).lazy( 32 ));
+    CHECK(!LazyDecode::parse( "32,0x8003" ).lazy( 0x8003 ));
+    CHECK(LazyDecode::parse( "32,0x8003" ).lazy( 33 ));
+    for ( const char* bad : { "", "lazy", "0x", "-1", "32,x" } ) {
+        CHECK_THROWS_AS(LazyDecode::parse( bad ), const std::invalid_argument&);
+    }
+
+    // a signed frame whose unsecuredData is a 134 byte MessageFrame at offset 8.
+    std::string bytes = read_file( "data/Ieee1609Dot2Data.unsecuredData.Bsm.coer" );
+    REQUIRE(bytes.size() > 142);
+
+    std::string encodings{ "Ieee1609Dot2Data:COER,MessageFrame:UPER" };
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_lazy_decode( LazyDecode::parse( "on" ) );
+
+    std::stringstream lazy;
+    CHECK(codec.process_bytes( bytes.data(), bytes.size(), encodings.data(), encodings.size(), lazy ));
+
+    pugi::xml_document doc;
+    CHECK(doc.load(lazy));
+    pugi::xml_node data = ode_payload_query.evaluate_node(doc).node();
+    pugi::xml_node header = data.child("Ieee1609Dot2Header");
+    CHECK(!data.child("MessageFrame"));
+    CHECK(header.child("psid"));
+    CHECK(header.child("signer").first_child());
+
+    std::string unsecured;
+    hex_codec::encode( bytes.data() + 8, 134, unsecured );
+    CHECK(unsecured == std::string{ header.child("unsecuredData").text().get() });
+
+    // the frames of a PSID that is decoded in full have their MessageFrame.
+    codec.set_lazy_decode( LazyDecode{ true, { static_cast<uintmax_t>( std::stoull( header.child("psid").text().get() ) ) } } );
+    std::stringstream full;
+    CHECK(codec.process_bytes( bytes.data(), bytes.size(), encodings.data(), encodings.size(), full ));
+    CHECK(doc.load(full));
+    CHECK(ode_payload_query.evaluate_node(doc).node().child("MessageFrame"));
+}
+
+TEST_CASE("Message Budget Tests", "[decoding]" ) {
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_budget( MessageBudget{ input.size(), 0, 0, 0 } );
+
+    std::stringstream within;
+    CHECK(codec.process( input.data(), input.size(), within ));
+
+    // one byte too many is an error response without a parse.
+    codec.set_budget( MessageBudget{ input.size() - 1, 0, 0, 0 } );
+    std::stringstream over;
+    CHECK(!codec.process( input.data(), input.size(), over ));
+    CHECK(over.str().find( "over the limit" ) != std::string::npos);
+    CHECK(codec.budget_stats().oversize == 1);
+    CHECK(codec.budget_stats().memory == 0);
+    CHECK(codec.budget_stats().time == 0);
+}
+
+TEST_CASE("Coarse Clock Tests", "[metrics]" ) {
+    CoarseClock clock;
+
+    std::string first = clock.now();
+    const std::string& second = clock.now();
+
+    // e.g., 2018-03-14T15:09:26Z[UTC]
+    CHECK(first.size() == 25);
+    CHECK(first.substr( 19 ) == "Z[UTC]");
+    CHECK(second.size() == first.size());
+    CHECK(second.compare( 0, 4, first, 0, 4 ) == 0);
+}
+
+TEST_CASE("Latency Histogram Tests", "[histogram]" ) {
+
+    SECTION( "Buckets" ) {
+        for ( uint64_t v : { 0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull } ) {
+            std::size_t b = LatencyHistogram::bucket( v );
+            CHECK( b < LatencyHistogram::bucket_count );
+            CHECK( LatencyHistogram::bucket_limit( b ) >= v );
+            CHECK( LatencyHistogram::bucket_limit( b ) - v <= v / 8 );
+            if ( b > 0 ) CHECK( LatencyHistogram::bucket_limit( b - 1 ) < v );
+        }
+    }
+
+    SECTION( "Percentiles" ) {
+        LatencyHistogram histogram;
+        LatencyHistogram::Snapshot snapshot;
+
+        histogram.take( snapshot );
+        CHECK( snapshot.count == 0 );
+        CHECK( snapshot.percentile( 0.5 ) == 0 );
+
+        for ( uint64_t i = 1; i <= 1000; ++i ) histogram.record( i * 1000 );
+
+        histogram.take( snapshot );
+        CHECK( snapshot.count == 1000 );
+        CHECK( snapshot.max == 1000000 );
+        CHECK( snapshot.mean() == 500500 );
+        CHECK( snapshot.percentile( 0.5 ) >= 500000 );
+        CHECK( snapshot.percentile( 0.5 ) <= 500000 + 500000 / 8 );
+        CHECK( snapshot.percentile( 1.0 ) == 1000000 );
+
+        // taking the counts empties the histogram; peeking at them does not.
+        histogram.take( snapshot );
+        CHECK( snapshot.count == 0 );
+        CHECK( snapshot.max == 0 );
+
+        histogram.record( 5000 );
+        histogram.peek( snapshot );
+        CHECK( snapshot.count == 1 );
+        histogram.take( snapshot );
+        CHECK( snapshot.count == 1 );
+        CHECK( snapshot.max == 5000 );
+    }
+}
+
+TEST_CASE("Slow Messages Tests", "[diagnostics]" ) {
+    SlowMessages slow{ 3, 1000 };
+
+    CHECK( slow.recent().empty() );
+
+    slow.record( "topic", 0, 1, 500, 0 );
+    slow.record( "topic", 0, 2, 100, 10 );
+    slow.record( "topic", 0, 3, 300, 20 );
+    slow.record( "topic", 0, 4, 200, 30 );
+    slow.record( "topic", 0, 5, 50, 40 );
+
+    // only the slowest messages of a window are kept, slowest first.
+    std::vector<SlowMessages::Message> recent = slow.recent();
+    REQUIRE( recent.size() == 3 );
+    CHECK( recent[0].offset == 1 );
+    CHECK( recent[1].offset == 3 );
+    CHECK( recent[2].offset == 4 );
+    CHECK( recent[1].at_ms == 20 );
+
+    // the previous window is reported with the current one.
+    slow.record( "other", 2, 9, 400, 1000 );
+    recent = slow.recent();
+    REQUIRE( recent.size() == 4 );
+    CHECK( recent[1].topic == "other" );
+    CHECK( recent[1].partition == 2 );
+
+    // a window with no messages leaves none to the next.
+    slow.record( "other", 2, 10, 10, 5000 );
+    recent = slow.recent();
+    REQUIRE( recent.size() == 1 );
+    CHECK( recent[0].offset == 10 );
+}
+
+TEST_CASE("Output Partitioner Tests", "[kafka]" ) {
+    CHECK(OutputPartitioner::parse( "sticky" ) == OutputPartitioner::Strategy::STICKY);
+    CHECK(std::string{ OutputPartitioner::name( OutputPartitioner::Strategy::KEY ) } == "key");
+    CHECK_THROWS(OutputPartitioner::parse( "random" ));
+
+    OutputPartitioner fixed{ OutputPartitioner::Strategy::FIXED, 3 };
+    CHECK(fixed.partition( 0, 7 ) == 3);
+    OutputPartitioner input{ OutputPartitioner::Strategy::INPUT };
+    CHECK(input.partition( 0, 7 ) == 7);
+    CHECK(input.partition( 0, -1 ) == OutputPartitioner::unassigned);
+    OutputPartitioner key{ OutputPartitioner::Strategy::KEY, 3 };
+    CHECK(key.partition( 0, 7 ) == OutputPartitioner::unassigned);
+
+    // two responses to each of the 3 partitions in turn; a topic of unknown size is left to librdkafka.
+    OutputPartitioner sticky{ OutputPartitioner::Strategy::STICKY, 0, 2 };
+    sticky.set_partitions( { 3, 0 } );
+    std::vector<int32_t> partitions;
+    for ( int i = 0; i < 8; ++i ) partitions.push_back( sticky.partition( 0, 5 ) );
+    CHECK(partitions == std::vector<int32_t>( { 0, 0, 1, 1, 2, 2, 0, 0 } ));
+    CHECK(sticky.partition( 1, 5 ) == OutputPartitioner::unassigned);
+    CHECK(sticky.partition( 2, 5 ) == OutputPartitioner::unassigned);
+}
+
+TEST_CASE("Batch Tuner Tests", "[metrics]" ) {
+    BatchTuner tuner{ 20000000, BatchTuner::Settings{ 100, 50 } };          // p99 20 ms.
+    BatchTuner::Settings settings{ 16, 8 };
+
+    // nothing recorded: no change.
+    CHECK(!tuner.adjust( settings ));
+
+    // full batches well under the target grow; the timeout stops at half of the target.
+    for ( int round = 0; round < 20; ++round ) {
+        for ( int i = 0; i < 100; ++i ) tuner.record( 1000000 );
+        tuner.consumed( true, 0 );
+        tuner.adjust( settings );
+    }
+    CHECK(settings.batch_size == 100);
+    CHECK(settings.batch_timeout == 10);
+
+    // partial batches do not grow.
+    for ( int i = 0; i < 100; ++i ) tuner.record( 1000000 );
+    tuner.consumed( false, 0 );
+    CHECK(!tuner.adjust( settings ));
+
+    // over the target the timeout is halved, and the batch too unless the workers are behind.
+    for ( int i = 0; i < 100; ++i ) tuner.record( 40000000 );
+    tuner.consumed( true, 500 );
+    CHECK(tuner.adjust( settings ));
+    CHECK(settings.batch_size == 100);
+    CHECK(settings.batch_timeout == 5);
+    CHECK(tuner.last_p99() > 20000000);
+
+    for ( int i = 0; i < 100; ++i ) tuner.record( 40000000 );
+    tuner.consumed( true, 0 );
+    CHECK(tuner.adjust( settings ));
+    CHECK(settings.batch_size == 50);
+    CHECK(settings.batch_timeout == 2);
+}
+
+TEST_CASE("Message Latencies Tests", "[metrics]" ) {
+    MessageLatencies latencies;
+
+    MessageLatencies::Partition& p0 = latencies.partition( "topic.OdeRawEncodedBSMJson", 0 );
+    CHECK(&latencies.partition( "topic.OdeRawEncodedBSMJson", 0 ) == &p0);
+    CHECK(&latencies.partition( "topic.OdeRawEncodedBSMJson", 1 ) != &p0);
+
+    // the thread's copy of the lookups never gives the histogram of another object.
+    {
+        MessageLatencies other;
+        CHECK(&other.partition( "topic.OdeRawEncodedBSMJson", 0 ) != &p0);
+    }
+    CHECK(&latencies.partition( "topic.OdeRawEncodedBSMJson", 0 ) == &p0);
+
+    p0.kafka.record( 2000000 );
+    p0.acm.record( 50000 );
+    latencies.delivery( "topic.Asn1DecoderOutput" ).record( 4000000 );
+
+    std::vector<std::string> seen;
+    latencies.take( [&seen]( const std::string& key, const char* stage, const LatencyHistogram::Snapshot& snapshot ) {
+        CHECK(snapshot.count == 1);
+        seen.push_back( key + " " + stage );
+    } );
+    std::vector<std::string> expected{ "topic.OdeRawEncodedBSMJson:0 kafka", "topic.OdeRawEncodedBSMJson:0 acm", "topic.Asn1DecoderOutput delivery" };
+    CHECK(seen == expected);
+
+    // taken counts are not visited again.
+    seen.clear();
+    latencies.take( [&seen]( const std::string& key, const char* stage, const LatencyHistogram::Snapshot& ) { seen.push_back( key ); } );
+    CHECK(seen.empty());
+}
+
+TEST_CASE("Kafka Statistics Tests", "[metrics]" ) {
+
+    KafkaStatistics stats;
+
+    std::string producer = R"({"name":"rdkafka#producer-1","type":"producer","replyq":3,"msg_cnt":12,"msg_size":4096,
+        "brokers":{"b1:9092/1":{"nodeid":1,"rtt":{"min":100,"max":900,"avg":250,"p99":800,"cnt":10}},
+                   "b2:9092/2":{"nodeid":2,"rtt":{"min":100,"max":900,"avg":400,"p99":600,"cnt":5}},
+                   "b3:9092/bootstrap":{"nodeid":-1,"rtt":{"avg":9999,"p99":9999,"cnt":0}}},
+        "topics":{}})";
+
+    REQUIRE( KafkaStatistics::parse( producer.data(), producer.size(), stats ) );
+    CHECK( stats.type == "producer" );
+    CHECK( stats.reply_queue == 3 );
+    CHECK( stats.queued_messages == 12 );
+    CHECK( stats.queued_bytes == 4096 );
+    CHECK( stats.brokers == 2 );
+    CHECK( stats.rtt_avg_us == 400 );
+    CHECK( stats.rtt_p99_us == 800 );
+
+    std::string consumer = R"({"type":"consumer","brokers":{},
+        "topics":{"topic.OdeRawEncodedBSMJson":{"partitions":{
+            "0":{"partition":0,"fetchq_cnt":5,"consumer_lag":100},
+            "1":{"partition":1,"fetchq_cnt":2,"consumer_lag":-1},
+            "-1":{"partition":-1,"fetchq_cnt":50,"consumer_lag":70}}}}})";
+
+    REQUIRE( KafkaStatistics::parse( consumer.data(), consumer.size(), stats ) );
+    CHECK( stats.type == "consumer" );
+    CHECK( stats.queued_messages == 0 );
+    CHECK( stats.fetch_queue == 7 );
+    CHECK( stats.consumer_lag == 100 );
+    CHECK( stats.partitions == 1 );
+
+    std::string bad = "not json";
+    CHECK_FALSE( KafkaStatistics::parse( bad.data(), bad.size(), stats ) );
+    CHECK( stats.type == "consumer" );
+}
+
+TEST_CASE("Batch Input Tests", "[batch]" ) {
+
+    BatchInput::Record record;
+
+    SECTION( "Lines" ) {
+        std::string text{ "<a/>\r\n\n<b/>\n<c/>" };
+        BatchInput input{ BatchInput::Framing::LINES };
+        input.assign( reinterpret_cast<const uint8_t*>( text.data() ), text.size() );
+
+        REQUIRE( input.next( record ) );
+        CHECK( std::string( reinterpret_cast<const char*>( record.data ), record.length ) == "<a/>" );
+        REQUIRE( input.next( record ) );
+        CHECK( std::string( reinterpret_cast<const char*>( record.data ), record.length ) == "<b/>" );
+        REQUIRE( input.next( record ) );
+        CHECK( std::string( reinterpret_cast<const char*>( record.data ), record.length ) == "<c/>" );
+        CHECK_FALSE( input.next( record ) );
+        CHECK_FALSE( input.truncated() );
+    }
+
+    SECTION( "Length Prefixed Frames" ) {
+        std::vector<uint8_t> frames{ 0, 0, 0, 2, 0x20, 0x14, 0, 0, 0, 0, 0, 0, 0, 3, 0x01 };
+        BatchInput input{ BatchInput::Framing::LENGTH };
+        input.assign( frames.data(), frames.size() );
+
+        REQUIRE( input.next( record ) );
+        CHECK( record.length == 2 );
+        CHECK( record.data[0] == 0x20 );
+        REQUIRE( input.next( record ) );
+        CHECK( record.length == 0 );
+        CHECK_FALSE( input.next( record ) );
+        CHECK( input.truncated() );
+        CHECK( input.position() == 10 );
+    }
+
+    SECTION( "Timed Frames" ) {
+        std::string frames;
+        BatchInput::append_timed( frames, 1700000000123, 3, "\x20\x14", 2 );
+        BatchInput::append_timed( frames, 1700000000125, -1, "", 0 );
+        frames.append( "\0\0", 2 );
+
+        BatchInput input{ BatchInput::Framing::TIMED };
+        input.assign( reinterpret_cast<const uint8_t*>( frames.data() ), frames.size() );
+
+        REQUIRE( input.next( record ) );
+        CHECK( record.timestamp == 1700000000123 );
+        CHECK( record.partition == 3 );
+        CHECK( record.length == 2 );
+        CHECK( record.data[1] == 0x14 );
+        REQUIRE( input.next( record ) );
+        CHECK( record.timestamp == 1700000000125 );
+        CHECK( record.partition == -1 );
+        CHECK( record.length == 0 );
+        CHECK_FALSE( input.next( record ) );
+        CHECK( input.truncated() );
+        CHECK( input.position() == 34 );
+    }
+
+    CHECK( BatchInput::parse_framing( "length" ) == BatchInput::Framing::LENGTH );
+    CHECK( BatchInput::parse_framing( "timed" ) == BatchInput::Framing::TIMED );
+    CHECK_THROWS_AS( BatchInput::parse_framing( "csv" ), const std::invalid_argument& );
+}
+
+TEST_CASE("Spool Directory Tests", "[spool]" ) {
+
+    char path[] = "/tmp/acm_spool_XXXXXX";
+    REQUIRE( mkdtemp( path ) != nullptr );
+    std::string dir{ path };
+
+    std::ofstream{ dir + "/b.xml" } << "<b/>\n";
+    std::ofstream{ dir + "/a.xml" } << "<a/>\n";
+    std::ofstream{ dir + "/.partial" } << "<c/>\n";
+
+    SpoolDirectory spool{ dir };
+    REQUIRE( spool.open() );
+
+    // the files present at startup are ready in name order; hidden files are not.
+    std::vector<std::string> names;
+    CHECK( spool.wait( names, 8, 0 ) == 2 );
+    REQUIRE( names.size() == 2 );
+    CHECK( names[0] == "a.xml" );
+    CHECK( names[1] == "b.xml" );
+
+    std::vector<SpoolDirectory::File> files;
+    spool.read( names, files );
+    REQUIRE( files.size() == 2 );
+    CHECK( files[0].error == 0 );
+    CHECK( std::string( files[0].data.begin(), files[0].data.end() ) == "<a/>\n" );
+
+    // a hidden file renamed into its final name is ready.
+    CHECK( std::rename( ( dir + "/.partial" ).c_str(), ( dir + "/c.xml" ).c_str() ) == 0 );
+    names.clear();
+    CHECK( spool.wait( names, 8, 1000 ) == 1 );
+    REQUIRE( names.size() == 1 );
+    CHECK( names[0] == "c.xml" );
+
+    names.push_back( "missing.xml" );
+    spool.read( names, files );
+    REQUIRE( files.size() == 2 );
+    CHECK( files[1].error == ENOENT );
+
+    for ( const char* name : { "/a.xml", "/b.xml", "/c.xml" } ) std::remove( ( dir + name ).c_str() );
+    rmdir( path );
+}
+
+TEST_CASE("Library C API Tests", "[library]" ) {
+    char error[128];
+    acm_options options;
+    acm_options_init( &options );
+
+    options.error_template = "data/missing.error.xml";
+    CHECK( acm_create( &options, error, sizeof( error ) ) == nullptr );
+    CHECK( std::string{ error }.find( "data/missing.error.xml" ) != std::string::npos );
+
+    options.error_template = "data/Output.error.xml";
+    acm_t* acm = acm_create( &options, error, sizeof( error ) );
+    REQUIRE( acm != nullptr );
+
+    std::string input = read_file( "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml" );
+    REQUIRE(!input.empty());
+
+    // a call without room reports the size the response needs.
+    std::size_t written = 0;
+    CHECK( acm_decode( acm, input.data(), input.size(), nullptr, 0, &written ) == ACM_BUFFER_TOO_SMALL );
+    REQUIRE( written > 0 );
+
+    std::vector<char> output( written );
+    CHECK( acm_decode( acm, input.data(), input.size(), output.data(), output.size(), &written ) == ACM_OK );
+    CHECK( written == output.size() );
+
+    pugi::xml_document doc;
+    REQUIRE( doc.load_buffer( output.data(), written ) );
+    CHECK( doc.child("OdeAsn1Data").child("payload").child("data").child("MessageFrame") );
+
+    std::string garbage{ "<OdeAsn1Data><payload>&<" };
+    output.resize( 4096 );
+    CHECK( acm_decode( acm, garbage.data(), garbage.size(), output.data(), output.size(), &written ) == ACM_ERROR_RESPONSE );
+    CHECK( std::string( output.data(), written ).find( "INVALID_REQUEST_TYPE_ERROR" ) != std::string::npos );
+    CHECK( acm_decode( acm, garbage.data(), garbage.size(), output.data(), output.size(), nullptr ) == ACM_INVALID_ARGUMENT );
+
+    unsigned char bytes[2];
+    CHECK( acm_hex_decode( "0a2F", 4, bytes ) == ACM_OK );
+    char hex[4];
+    acm_hex_encode( bytes, 2, hex );
+    CHECK( std::string( hex, 4 ) == "0A2F" );
+    CHECK( acm_hex_decode( "0x", 2, bytes ) == ACM_INVALID_ARGUMENT );
+
+    acm_destroy( acm );
+}
+
+TEST_CASE("Shared Memory Ring Tests", "[shm]" ) {
+    std::string name = "/acm_tests." + std::to_string( getpid() );
+    ShmRing::remove( name );
+
+    ShmRing consumer{ name, 1000 };
+    REQUIRE(consumer.open());
+    CHECK(consumer.capacity() == 4096);
+
+    // another process, here another mapping, attaches to the ring by its name.
+    ShmRing producer{ name };
+    REQUIRE(producer.open());
+    CHECK(producer.capacity() == 4096);
+
+    std::size_t length;
+    CHECK(consumer.peek( length, 0 ) == nullptr);
+
+    // the records wrap around the end of the ring many times and come out whole and in order.
+    std::string record( 1000, 'x' );
+    for ( int i = 0; i < 20; ++i ) {
+        record[0] = static_cast<char>( 'a' + i );
+        REQUIRE(producer.push( record.data(), record.size() - i, 0 ));
+
+        const uint8_t* data = consumer.peek( length, 0 );
+        REQUIRE(data != nullptr);
+        CHECK(length == record.size() - i);
+        CHECK(std::string( reinterpret_cast<const char*>( data ), length ) == record.substr( 0, length ));
+        consumer.pop();
+    }
+
+    // a full ring refuses a record until the consumer gives space back; so does one larger than half the ring.
+    std::size_t pushed = 0;
+    while ( producer.push( record.data(), record.size(), 0 ) ) ++pushed;
+    CHECK(pushed == 3);                                                 // the padding at the end of the ring takes the room of a fourth.
+    CHECK(!producer.push( record.data(), 3000, 0 ));
+    CHECK(errno == EMSGSIZE);
+    REQUIRE(consumer.peek( length, 0 ) != nullptr);
+    consumer.pop();
+    CHECK(producer.push( record.data(), record.size(), 0 ));
+    for ( std::size_t i = 0; i < pushed; ++i ) {
+        REQUIRE(consumer.peek( length, 0 ) != nullptr);
+        consumer.pop();
+    }
+
+    // the producers of several threads wake a sleeping consumer; each producer's records stay in order.
+    const uint32_t count = 20000;
+    std::vector<std::thread> threads;
+    for ( uint32_t p = 0; p < 3; ++p ) {
+        threads.emplace_back( [&producer, p, count]() {
+            for ( uint32_t i = 0; i < count; ++i ) {
+                uint32_t item[2] = { p, i };
+                while ( !producer.push( item, sizeof( item ), 100 ) ) {}
+            }
+        } );
+    }
+
+    std::vector<uint32_t> next( 3, 0 );
+    bool ordered = true;
+    for ( uint32_t k = 0; k < 3 * count; ++k ) {
+        const uint8_t* data = consumer.peek( length, 1000 );
+        REQUIRE(data != nullptr);
+        uint32_t item[2];
+        std::memcpy( item, data, sizeof( item ) );
+        if ( length != sizeof( item ) || item[0] >= 3 || item[1] != next[item[0]]++ ) ordered = false;
+        consumer.pop();
+    }
+    for ( auto& t : threads ) t.join();
+    CHECK(ordered);
+    CHECK(consumer.peek( length, 0 ) == nullptr);
+
+    CHECK(ShmRing::remove( name ));
+}
+
+TEST_CASE("UDP Receiver Tests", "[udp]" ) {
+    std::string host;
+    uint16_t port = 0;
+    UdpReceiver::parse_listen( "127.0.0.1:47850", host, port );
+    CHECK( host == "127.0.0.1" );
+    CHECK( port == 47850 );
+    UdpReceiver::parse_listen( "[::1]:47850", host, port );
+    CHECK( host == "::1" );
+    UdpReceiver::parse_listen( "47850", host, port );
+    CHECK( host.empty() );
+    CHECK_THROWS( UdpReceiver::parse_listen( "localhost:0", host, port ) );
+    CHECK_THROWS( UdpReceiver::parse_listen( "localhost:port", host, port ) );
+
+    // two receivers share the port.
+    UdpReceiver first{ "127.0.0.1", 47850, 8, 16 };
+    UdpReceiver second{ "127.0.0.1", 47850, 8, 16 };
+    REQUIRE( first.open() );
+    REQUIRE( second.open() );
+
+    int sender = socket( AF_INET, SOCK_DGRAM, 0 );
+    REQUIRE( sender >= 0 );
+    struct sockaddr_in to;
+    std::memset( &to, 0, sizeof( to ) );
+    to.sin_family = AF_INET;
+    to.sin_port = htons( 47850 );
+    to.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    std::vector<std::string> datagrams{ "one", "two", "0123456789abcdefXYZ" };
+    for ( const auto& d : datagrams ) {
+        CHECK( sendto( sender, d.data(), d.size(), 0, reinterpret_cast<struct sockaddr*>( &to ), sizeof( to ) ) == static_cast<ssize_t>( d.size() ) );
+    }
+    close( sender );
+
+    // one sender's datagrams all go to one of the sockets.
+    std::size_t count = first.receive( 1000 );
+    UdpReceiver& receiver = count > 0 ? first : second;
+    if ( count == 0 ) count = second.receive( 1000 );
+    REQUIRE( count == 3 );
+
+    UdpReceiver::Datagram datagram = receiver.datagram( 0 );
+    CHECK( std::string( reinterpret_cast<const char*>( datagram.data ), datagram.length ) == "one" );
+    CHECK( !datagram.truncated );
+    datagram = receiver.datagram( 2 );
+    CHECK( datagram.length == 16 );
+    CHECK( datagram.truncated );
+
+    CHECK( first.receive( 0 ) == 0 );
+}
+
+TEST_CASE("Metrics Endpoint Tests", "[metrics]" ) {
+    MetricsText page;
+    page.family( "acm_lag", "gauge", "The lag." );
+    page.sample( "acm_lag", { { "topic", "a\"b" }, { "partition", "3" } }, 42 );
+    page.sample( "acm_ratio", 0.25 );
+    page.sample( "acm_drain", std::numeric_limits<double>::infinity() );
+    CHECK( page.str() == "# HELP acm_lag The lag.\n# TYPE acm_lag gauge\nacm_lag{topic=\"a\\\"b\",partition=\"3\"} 42\nacm_ratio 0.25\nacm_drain +Inf\n" );
+
+    // half busy, consuming 100/s while 50/s arrive: 50/s to spare at full utilization.
+    CHECK( MetricsEndpoint::drain_seconds( 0, 100, 0, 0.5 ) == 0 );
+    CHECK( MetricsEndpoint::drain_seconds( 1000, 100, -50, 0.5 ) == Approx( 6.6667 ).epsilon( 0.001 ) );
+    CHECK( MetricsEndpoint::drain_seconds( 1000, 100, 0, 0.5 ) == Approx( 10 ) );
+    CHECK( std::isinf( MetricsEndpoint::drain_seconds( 1000, 100, 0, 1.0 ) ) );
+    CHECK( std::isinf( MetricsEndpoint::drain_seconds( 1000, 0, 0, 0 ) ) );
+
+    MetricsEndpoint endpoint{ "127.0.0.1", 0 };
+    REQUIRE( endpoint.open() );
+    REQUIRE( endpoint.port() != 0 );
+    endpoint.publish( page.str() );
+
+    // one request per connection.
+    auto get = [&endpoint]( const std::string& request ) {
+        int fd = socket( AF_INET, SOCK_STREAM, 0 );
+        struct sockaddr_in to;
+        std::memset( &to, 0, sizeof( to ) );
+        to.sin_family = AF_INET;
+        to.sin_port = htons( endpoint.port() );
+        to.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        std::string response;
+        if ( fd >= 0 && connect( fd, reinterpret_cast<struct sockaddr*>( &to ), sizeof( to ) ) == 0
+                && send( fd, request.data(), request.size(), 0 ) == static_cast<ssize_t>( request.size() ) ) {
+            char buffer[512];
+            ssize_t n;
+            while ( ( n = recv( fd, buffer, sizeof( buffer ), 0 ) ) > 0 ) response.append( buffer, n );
+        }
+        if ( fd >= 0 ) close( fd );
+        return response;
+    };
+
+    std::string response = get( "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n" );
+    CHECK( response.compare( 0, 15, "HTTP/1.0 200 OK" ) == 0 );
+    CHECK( response.find( "text/plain; version=0.0.4" ) != std::string::npos );
+    CHECK( response.substr( response.find( "\r\n\r\n" ) + 4 ) == page.str() );
+    CHECK( get( "GET / HTTP/1.1\r\n\r\n" ).compare( 0, 12, "HTTP/1.0 404" ) == 0 );
+    CHECK( get( "POST /metrics HTTP/1.1\r\n\r\n" ).compare( 0, 12, "HTTP/1.0 405" ) == 0 );
+
+    endpoint.close();
+    CHECK( endpoint.port() == 0 );
+}
+
+TEST_CASE("MAP Cache Tests", "[decoding]" ) {
+    // MapData with only a timeStamp and a msgIssueRevision: minute 1000 revision 3, minute 1001 revision 3, and minute
+    // 1000 revision 4.
+    std::string first{ "\x00\x12\x05\x40\x00\x1f\x40\x30", 8 };
+    std::string later{ "\x00\x12\x05\x40\x00\x1f\x48\x30", 8 };
+    std::string revised{ "\x00\x12\x05\x40\x00\x1f\x40\x40", 8 };
+
+    map_frame::Header header;
+    std::string first_key, later_key, revised_key;
+    REQUIRE(map_frame::parse( first.data(), first.size(), header ));
+    CHECK(header.bytes == first.size());
+    CHECK(header.has_time_stamp);
+    CHECK(header.time_stamp == 1000);
+    CHECK(header.revision == 3);
+    map_frame::revision_key( first.data(), header, first_key );
+    REQUIRE(map_frame::parse( later.data(), later.size(), header ));
+    CHECK(header.time_stamp == 1001);
+    map_frame::revision_key( later.data(), header, later_key );
+    REQUIRE(map_frame::parse( revised.data(), revised.size(), header ));
+    CHECK(header.revision == 4);
+    map_frame::revision_key( revised.data(), header, revised_key );
+    CHECK(first_key == later_key);
+    CHECK(first_key != revised_key);
+
+    std::string bsm{ "\x00\x14\x05\x40\x00\x1f\x40\x30", 8 };
+    CHECK(!map_frame::parse( bsm.data(), bsm.size(), header ));
+    CHECK(!map_frame::parse( first.data(), first.size() - 1, header ));
+
+    // the cached responses are the decoded responses.
+    BsmCodec cached;
+    BsmCodec uncached;
+    cached.use_map_cache( 1 << 20 );
+
+    for ( const std::string* map : { &first, &later, &revised, &later } ) {
+        std::stringstream expected, output;
+        CHECK(uncached.decode( *map, expected ));
+        CHECK(cached.decode( *map, output ));
+        CHECK(output.str() == expected.str());
+        CHECK(cached.message_id() == 18);
+    }
+
+    ResultCache::Stats stats = cached.map_cache_stats();
+    CHECK(stats.hits == 2);
+    CHECK(stats.misses == 2);
+    CHECK(stats.entries == 2);
+}
+
+TEST_CASE("SPaT Delta Tests", "[decoding]" ) {
+    // one intersection with signal groups 2 and 4; the phase of group 4 is given.
+    auto spat_xer = []( const char* group4, const char* status = "0000000000000000" ) {
+        return std::string{ "<MessageFrame><messageId>19</messageId><value><SPAT><intersections><IntersectionState>"
+            "<id><id>12111</id></id><revision>0</revision><status>" } + status + "</status><states>"
+            "<MovementState><signalGroup>2</signalGroup><state-time-speed><MovementEvent><eventState>"
+            "<protected-Movement-Allowed/></eventState><timing><minEndTime>22120</minEndTime></timing></MovementEvent>"
+            "</state-time-speed></MovementState>"
+            "<MovementState><signalGroup>4</signalGroup><state-time-speed><MovementEvent><eventState>"
+            + group4 + "</eventState><timing><minEndTime>22120</minEndTime></timing></MovementEvent>"
+            "</state-time-speed></MovementState></states></IntersectionState></intersections></SPAT></value>"
+            "</MessageFrame>";
+    };
+
+    auto decode = []( const std::string& xer ) {
+        MessageFrame_t* frame = nullptr;
+        asn_dec_rval_t rval = asn_decode( 0, ATS_BASIC_XER, &asn_DEF_MessageFrame, (void **)&frame, xer.data(), xer.size() );
+        REQUIRE(rval.code == RC_OK);
+        return frame;
+    };
+
+    std::string red = spat_xer( "<stop-And-Remain/>" );
+    std::string green = spat_xer( "<protected-Movement-Allowed/>" );
+
+    SpatDelta delta{ 10 };
+    auto reduce = [&]( const std::string& xer, uint64_t now_ms, int movements, long group = 4 ) {
+        MessageFrame_t* frame = decode( xer );
+        bool kept = delta.reduce( frame->value.choice.SPAT, now_ms );
+        auto& intersections = frame->value.choice.SPAT.intersections.list;
+        CHECK(kept == ( intersections.count == 1 ));
+        CHECK(( kept ? intersections.array[0]->states.list.count : 0 ) == movements);
+        if ( movements == 1 ) CHECK(intersections.array[0]->states.list.array[0]->signalGroup == group);
+        ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+    };
+
+    reduce( red, 1000, 2 );                                             // new, so whole.
+    reduce( red, 1100, 0 );                                             // no change.
+    reduce( green, 1200, 1 );                                           // group 4 changed.
+    reduce( green, 1300, 0 );
+    reduce( spat_xer( "<protected-Movement-Allowed/>", "0000000000000001" ), 1400, 1, 2 );  // the status; one movement.
+    reduce( green, 11000, 2 );                                          // the snapshot.
+    CHECK(delta.intersections() == 1);
+
+    // a context drops the unchanged SPaT of a UPER MessageFrame.
+    MessageFrame_t* frame = decode( red );
+    std::vector<char> uper( 256 );
+    asn_enc_rval_t erval = asn_encode_to_buffer( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MessageFrame, frame, uper.data(), uper.size() );
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+    REQUIRE(erval.encoded > 0);
+    uper.resize( static_cast<std::size_t>( erval.encoded ) );
+
+    BsmCodec codec;
+    codec.use_spat_delta( true, 10 );
+    codec.use_decode_cache( 1 << 20 );
+
+    // the second is not served from the decode cache, so it is reduced, to nothing.
+    std::stringstream first, second;
+    CHECK(codec.decode( uper.data(), uper.size(), first ));
+    CHECK(codec.verdict() == BsmFilter::Verdict::PASS);
+    CHECK(first.str().find( "<signalGroup>4</signalGroup>" ) != std::string::npos);
+    CHECK(codec.decode( uper.data(), uper.size(), second ));
+    CHECK(codec.verdict() == BsmFilter::Verdict::DROP);
+    CHECK(codec.dropped_frames() == 1);
+    CHECK(second.str().empty());
+}
+
+TEST_CASE("Corpus Generator Tests", "[bench]" ) {
+    // every generated message decodes, as what it was generated as.
+    const long message_ids[] = { 20, 31, 18, 19 };
+    CodecContext codec{ nullptr, nullptr, true };
+    CorpusGenerator generator{ 7, 16, 4 };
+    std::string message;
+
+    std::string uper_encodings{ "MessageFrame:UPER" };
+    std::string coer_encodings{ "Ieee1609Dot2Data:COER,MessageFrame:UPER" };
+
+    for ( int i = 0; i < 200; ++i ) {
+        CorpusGenerator::Format format = static_cast<CorpusGenerator::Format>( i % 3 );
+        CorpusGenerator::Kind kind = generator.next( format, message );
+        REQUIRE(!message.empty());
+
+        std::stringstream output;
+        if ( format == CorpusGenerator::Format::XML ) {
+            CHECK(codec.process( message.data(), message.size(), output ));
+        } else {
+            const std::string& encodings = format == CorpusGenerator::Format::UPER ? uper_encodings : coer_encodings;
+            CHECK(codec.process_bytes( message.data(), message.size(), encodings.data(), encodings.size(), output ));
+        }
+        CHECK(codec.message_id() == message_ids[ static_cast<int>( kind ) ]);
+    }
+    CHECK(generator.generated() == 200);
+
+    // the same seed gives the same corpus.
+    CorpusGenerator first{ 3 };
+    CorpusGenerator second{ 3 };
+    std::string other;
+    for ( int i = 0; i < 20; ++i ) {
+        first.next( CorpusGenerator::Format::UPER, message );
+        second.next( CorpusGenerator::Format::UPER, other );
+        CHECK(message == other);
+    }
+
+    generator.set_mix( "map=1,spat=0" );
+    for ( int i = 0; i < 10; ++i ) {
+        CHECK(generator.next_kind() == CorpusGenerator::Kind::MAP);
+    }
+
+    CHECK_THROWS_AS(generator.set_mix( "bsm=1,psm=1" ), const std::invalid_argument&);
+    CHECK_THROWS_AS(generator.set_mix( "bsm=x" ), const std::invalid_argument&);
+    CHECK_THROWS_AS(generator.set_mix( "bsm=0" ), const std::invalid_argument&);
+    CHECK_THROWS_AS(CorpusGenerator::parse_format( "ber" ), const std::invalid_argument&);
+}
+
+TEST_CASE("BSM Archive Tests", "[archive]" ) {
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    // the core data of an asn1c MessageFrame is the core data of the fast path.
+    bsm_fast_path::Bsm fast;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), fast ));
+
+    MessageFrame_t* frame = nullptr;
+    asn_dec_rval_t rval = asn_decode( 0, ATS_UNALIGNED_BASIC_PER, &asn_DEF_MessageFrame, (void **)&frame, bytes.data(), bytes.size() );
+    REQUIRE(rval.code == RC_OK);
+    bsm_fast_path::Bsm core;
+    std::memset( &core, 0, sizeof( core ) );
+    CHECK(BsmArchive::core_data( frame, core ));
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, frame );
+
+    CHECK(core.msg_cnt == fast.msg_cnt);
+    CHECK(std::memcmp( core.id, fast.id, sizeof( core.id ) ) == 0);
+    CHECK(core.sec_mark == fast.sec_mark);
+    CHECK(core.lat == fast.lat);
+    CHECK(core.lon == fast.lon);
+    CHECK(core.elev == fast.elev);
+    CHECK(core.accuracy.orientation == fast.accuracy.orientation);
+    CHECK(core.speed == fast.speed);
+    CHECK(core.heading == fast.heading);
+    CHECK(core.accel_yaw == fast.accel_yaw);
+    CHECK(core.wheel_brakes == fast.wheel_brakes);
+    CHECK(core.aux_brakes == fast.aux_brakes);
+    CHECK(core.length == fast.length);
+
+    CHECK(!BsmArchive::core_data( nullptr, core ));
+
+    if ( !BsmArchive::available() ) {
+        BsmArchive::Settings settings;
+        settings.uri = "archive";
+        CHECK_THROWS( BsmArchive( settings, "test", nullptr ) );
+    }
+}
+
+TEST_CASE("Certificate Cache Tests", "[verify]" ) {
+    auto make = []( uint8_t n, uint32_t start, uint32_t end ) {
+        UnvalidatedCertificateCache::Entry certificate = std::make_shared<UnvalidatedCertificateCache::Certificate>();
+        for ( uint8_t i = 0; i < 32; ++i ) certificate->hash[i] = n + i;
+        std::memcpy( certificate->id, certificate->hash + 24, sizeof( certificate->id ) );
+        certificate->key[0] = 0x02;
+        std::memset( certificate->key + 1, n, 32 );
+        certificate->key_size = 33;
+        certificate->start = start;
+        certificate->end = end;
+        return certificate;
+    };
+
+    UnvalidatedCertificateCache cache{ 16 };
+    CHECK(cache.capacity() == 16);
+
+    UnvalidatedCertificateCache::Entry first = make( 1, 100, 200 );
+    CHECK(cache.insert( first ) == first);
+    CHECK(cache.find( first->id ) == first);
+    CHECK(cache.find_hash( first->hash ) == first);
+    CHECK(cache.size() == 1);
+
+    // a certificate already kept is returned in place of its copy.
+    CHECK(cache.insert( make( 1, 100, 200 ) ) == first);
+
+    UnvalidatedCertificateCache::Entry other = make( 2, 100, 200 );
+    CHECK(!cache.find( other->id ));
+    CHECK(!cache.find_hash( other->hash ));
+
+    // another certificate with the same HashedId8, key and validity is neither found for nor replaces the first.
+    UnvalidatedCertificateCache::Entry twin = make( 1, 100, 200 );
+    twin->hash[0] ^= 0xff;
+    CHECK(!cache.find_hash( twin->hash ));
+    CHECK(cache.insert( twin ) == twin);
+    CHECK(cache.find( first->id ) == first);
+    CHECK(cache.find_hash( first->hash ) == first);
+    CHECK(!cache.find_hash( twin->hash ));
+    CHECK(cache.size() == 1);
+
+    CHECK(first->current( 100 ));
+    CHECK(first->current( 199 ));
+    CHECK(!first->current( 99 ));
+    CHECK(!first->current( 200 ));
+
+    // revoked when kept, when inserted later, or when the hook says so.
+    CHECK(!first->revoked);
+    cache.revoke( first->id );
+    CHECK(first->revoked);
+    cache.revoke( other->id );
+    CHECK(cache.insert( other )->revoked);
+
+    cache.set_revocation_check( []( const UnvalidatedCertificateCache::Certificate& certificate ) { return certificate.key[1] == 3; } );
+    CHECK(cache.insert( make( 3, 0, 1 ) )->revoked);
+    CHECK(!cache.insert( make( 4, 0, 1 ) )->revoked);
+
+    // the oldest certificates are forgotten to make room.
+    for ( uint8_t n = 10; n < 200; ++n ) cache.insert( make( n, 0, 1 ) );
+    CHECK(cache.size() <= cache.capacity());
+    CHECK(!cache.find( first->id ));
+    CHECK(cache.find( make( 199, 0, 1 )->id ));
+
+    // Time32 counts from 2004; this test was written in 2026.
+    CHECK(UnvalidatedCertificateCache::now() > 22u * 365 * 86400);
+}
+
+TEST_CASE("Signature Verifier Tests", "[verify]" ) {
+    using Status = SignatureVerifier::Status;
+
+    CHECK(std::string{ SignatureVerifier::name( Status::NONE ) }.empty());
+    CHECK(std::string{ SignatureVerifier::name( Status::UNKNOWN_SIGNER ) } == "unknown_signer");
+    CHECK(std::string{ SignatureVerifier::name( Status::SIGNATURE_MATCHES_CARRIED_KEY ) } == "matches_carried_key");
+    CHECK(SignatureVerifier::combine( Status::NONE, Status::SIGNATURE_MATCHES_CARRIED_KEY ) == Status::SIGNATURE_MATCHES_CARRIED_KEY);
+    CHECK(SignatureVerifier::combine( Status::SIGNATURE_MATCHES_CARRIED_KEY, Status::SKIPPED ) == Status::SKIPPED);
+    CHECK(SignatureVerifier::combine( Status::INVALID, Status::UNSUPPORTED ) == Status::INVALID);
+
+    if ( !SignatureVerifier::available() ) {
+        CHECK_THROWS( SignatureVerifier( 1, 8, 100, 16 ) );
+        return;
+    }
+
+#ifdef ACM_VERIFY
+    // sign the digest of a request the way a 1609.2 signer does.
+    EC_KEY* signer = EC_KEY_new_by_curve_name( NID_X9_62_prime256v1 );
+    REQUIRE(EC_KEY_generate_key( signer ) == 1);
+
+    SignatureVerifier::Request request;
+    request.signer = std::make_shared<UnvalidatedCertificateCache::Certificate>();
+    for ( uint8_t i = 0; i < 32; ++i ) {
+        request.tbs_hash[i] = i;
+        request.signer->hash[i] = 0x80 | i;
+    }
+
+    unsigned char* key = nullptr;
+    request.signer->key_size = EC_KEY_key2buf( signer, POINT_CONVERSION_COMPRESSED, &key, nullptr );
+    REQUIRE(request.signer->key_size == 33);
+    std::memcpy( request.signer->key, key, request.signer->key_size );
+    OPENSSL_free( key );
+
+    uint8_t hashes[64];
+    uint8_t digest[32];
+    std::memcpy( hashes, request.tbs_hash, 32 );
+    std::memcpy( hashes + 32, request.signer->hash, 32 );
+    SignatureVerifier::sha256( hashes, sizeof( hashes ), digest );
+
+    ECDSA_SIG* signature = ECDSA_do_sign( digest, sizeof( digest ), signer );
+    REQUIRE(signature);
+    const BIGNUM* r;
+    const BIGNUM* s;
+    ECDSA_SIG_get0( signature, &r, &s );
+    BN_bn2binpad( r, request.r, sizeof( request.r ) );
+    BN_bn2binpad( s, request.s, sizeof( request.s ) );
+    ECDSA_SIG_free( signature );
+    EC_KEY_free( signer );
+
+    SignatureVerifier verifier{ 2, 8, 100, 16 };
+
+    std::vector<SignatureVerifier::Ticket> tickets;
+    for ( int i = 0; i < 20; ++i ) tickets.push_back( verifier.submit( request ) );
+    for ( const auto& ticket : tickets ) CHECK(verifier.wait( ticket ) == Status::SIGNATURE_MATCHES_CARRIED_KEY);
+    CHECK(verifier.count( Status::SIGNATURE_MATCHES_CARRIED_KEY ) == 20);
+    CHECK(verifier.batches() <= 20);
+    CHECK(request.signer->parsed);
+
+    SignatureVerifier::Request changed = request;
+    changed.tbs_hash[0] ^= 1;
+    CHECK(verifier.wait( verifier.submit( changed ) ) == Status::INVALID);
+
+    // a key that is not on the curve fails every signature.
+    changed = request;
+    changed.signer = std::make_shared<UnvalidatedCertificateCache::Certificate>();
+    std::memcpy( changed.signer->key, request.signer->key, 33 );
+    changed.signer->key[0] = 0x05;
+    changed.signer->key_size = 33;
+    CHECK(verifier.wait( verifier.submit( changed ) ) == Status::INVALID);
+
+    CHECK(verifier.wait( verifier.resolve( Status::SKIPPED ) ) == Status::SKIPPED);
+    CHECK(verifier.count( Status::SKIPPED ) == 1);
+
+    // a tenth of the frames are verified.
+    SignatureVerifier sampled{ 1, 8, 10, 16 };
+    int in_sample = 0;
+    for ( int i = 0; i < 100; ++i ) in_sample += sampled.sample();
+    CHECK(in_sample == 10);
+
+    // an unsigned frame has no signature status.
+    std::string bytes = read_file( "data/Ieee1609Dot2Data.unsecuredData.Bsm.coer" );
+    REQUIRE(!bytes.empty());
+
+    std::string encodings{ "Ieee1609Dot2Data:COER,MessageFrame:UPER" };
+    CodecContext codec{ nullptr, nullptr, true };
+    codec.set_verifier( &verifier );
+    std::stringstream output;
+    CHECK(codec.process_bytes( bytes.data(), bytes.size(), encodings.data(), encodings.size(), output ));
+    CHECK(codec.signature_status() == Status::NONE);
+#endif
+}
+
+TEST_CASE("Geofence Tests", "[filter]" ) {
+    // a 1 degree square with a hole, and a triangle; GeoJSON positions are [ longitude, latitude ].
+    auto index = GeofenceIndex::from_geojson( R"({ "type": "FeatureCollection", "features": [
+        { "type": "Feature", "geometry": { "type": "Polygon", "coordinates": [
+            [ [ -84.0, 35.0 ], [ -83.0, 35.0 ], [ -83.0, 36.0 ], [ -84.0, 36.0 ], [ -84.0, 35.0 ] ],
+            [ [ -83.6, 35.4 ], [ -83.4, 35.4 ], [ -83.4, 35.6 ], [ -83.6, 35.6 ] ] ] } },
+        { "type": "Feature", "geometry": { "type": "MultiPolygon", "coordinates": [
+            [ [ [ -80.0, 40.0 ], [ -79.0, 41.0 ], [ -78.0, 40.0 ] ] ] ] } } ] })", 16 );
+
+    CHECK(index->polygons() == 2);
+    CHECK(index->contains( 355000000, -838000000 ));
+    CHECK(!index->contains( 355000000, -835000000 ));
+    CHECK(!index->contains( 370000000, -835000000 ));
+    CHECK(index->contains( 403000000, -790000000 ));
+    CHECK(!index->contains( 409000000, -785000000 ));
+    CHECK(!index->contains( 900000001, 1800000001 ));
+
+    // the grid gives the answers of the edges alone.
+    std::vector<GeofenceIndex::Polygon> polygons{ { { { 350000000, -840000000 }, { 350000000, -830000000 }, { 360000000, -835000000 } } } };
+    GeofenceIndex fine{ polygons, 64 };
+    GeofenceIndex coarse{ polygons, 1 };
+    for ( int32_t lat = 349000000; lat <= 361000000; lat += 1234567 ) {
+        for ( int32_t lon = -841000000; lon <= -829000000; lon += 987654 ) {
+            CHECK(fine.contains( lat, lon ) == coarse.contains( lat, lon ));
+        }
+    }
+
+    CHECK_THROWS( GeofenceIndex::from_geojson( "{}" ) );
+    CHECK_THROWS( GeofenceIndex::from_geojson( R"({ "type": "Polygon", "coordinates": [ [ [ 0, 0 ], [ 1, 1 ] ] ] })" ) );
+
+    // a BSM inside is decoded; a BSM outside is dropped or diverted on both paths.
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    bsm_fast_path::Bsm bsm;
+    REQUIRE(bsm_fast_path::decode( bytes.data(), bytes.size(), bsm ));
+
+    std::vector<GeofenceIndex::Polygon> around{ { { { bsm.lat - 10000, bsm.lon - 10000 }, { bsm.lat - 10000, bsm.lon + 10000 }, { bsm.lat + 10000, bsm.lon + 10000 }, { bsm.lat + 10000, bsm.lon - 10000 } } } };
+    std::vector<GeofenceIndex::Polygon> away{ { { { bsm.lat + 20000, bsm.lon }, { bsm.lat + 20000, bsm.lon + 10000 }, { bsm.lat + 30000, bsm.lon } } } };
+    auto inside = std::make_shared<const GeofenceIndex>( around );
+    auto outside = std::make_shared<const GeofenceIndex>( away );
+
+    for ( bool path : { true, false } ) {
+        BsmCodec codec;
+        codec.set_bsm_fast_path( path );
+        codec.use_decode_cache( 1 << 20 );
+
+        GeofenceFilter keep{ inside, BsmFilter::Verdict::DROP };
+        codec.add_filter( &keep );
+        std::stringstream kept;
+        CHECK(codec.decode( bytes, kept ));
+        CHECK(codec.verdict() == BsmFilter::Verdict::PASS);
+        CHECK(!kept.str().empty());
+
+        GeofenceFilter drop{ outside, BsmFilter::Verdict::DROP };
+        codec.clear_filters();
+        codec.add_filter( &drop );
+        std::stringstream dropped;
+        CHECK(codec.decode( bytes, dropped ));
+        CHECK(codec.verdict() == BsmFilter::Verdict::DROP);
+        CHECK(codec.dropped_frames() == 1);
+        CHECK(codec.dropped_bytes() == bytes.size());
+        CHECK(dropped.str().empty());
+
+        GeofenceFilter divert{ outside, BsmFilter::Verdict::DIVERT };
+        codec.clear_filters();
+        codec.add_filter( &divert );
+        std::stringstream diverted;
+        CHECK(codec.decode( bytes, diverted ));
+        CHECK(codec.verdict() == BsmFilter::Verdict::DIVERT);
+        CHECK(codec.dropped_frames() == 0);
+        CHECK(diverted.str() == kept.str());
+    }
+}
+
+TEST_CASE("BSM Filter Helper Tests", "[filter]" ) {
+    bsm_fast_path::Bsm bsm{};
+    bsm.id[0] = 0x12; bsm.id[1] = 0x34; bsm.id[2] = 0x56; bsm.id[3] = 0x78;
+    CHECK(bsm_filter::vehicle_id( bsm ) == 0x12345678u);
+
+    // the shard is the top log2(shard_count) bits of the spread key.
+    for ( uint64_t key = 1; key < 1000; key += 7 ) {
+        CHECK(bsm_filter::shard_of<16>( key ) == bsm_filter::spread( key ) >> 60);
+        CHECK(bsm_filter::shard_of<2>( key ) == bsm_filter::spread( key ) >> 63);
+        CHECK(bsm_filter::shard_of<64>( key ) < 64);
+    }
+}
+
+TEST_CASE("BSM Rate Limiter Tests", "[filter]" ) {
+    // a vehicle at 10 Hz is passed at 1 Hz.
+    BsmRateLimiter limiter{ 1000, 1024, 5000 };
+    std::size_t passed = 0;
+    for ( uint64_t now = 0; now < 10000; now += 100 ) {
+        if ( limiter.test( 7, now ) == BsmFilter::Verdict::PASS ) ++passed;
+    }
+    CHECK(passed == 10);
+
+    // the vehicles are limited on their own.
+    CHECK(limiter.test( 8, 9950 ) == BsmFilter::Verdict::PASS);
+    CHECK(limiter.test( 8, 9990 ) == BsmFilter::Verdict::DROP);
+    CHECK(limiter.test( 7, 9990 ) == BsmFilter::Verdict::DROP);
+    CHECK(limiter.test( 7, 10000 ) == BsmFilter::Verdict::PASS);
+
+    // the vehicles share the shards; each is passed once in the interval.
+    BsmRateLimiter small{ 1000, 16, 5000 };
+    CHECK(small.capacity() == 256);
+    passed = 0;
+    for ( uint64_t now = 0; now < 1000; now += 100 ) {
+        for ( uint32_t id = 0; id < 100; ++id ) {
+            if ( small.test( id, now ) == BsmFilter::Verdict::PASS ) ++passed;
+        }
+    }
+    CHECK(passed == 100);
+
+    // the dropped BSMs write no response.
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    BsmRateLimiter codec_limiter{ 60000 };
+    BsmCodec codec;
+    codec.add_filter( &codec_limiter );
+
+    std::stringstream first;
+    CHECK(codec.decode( bytes, first ));
+    CHECK(codec.verdict() == BsmFilter::Verdict::PASS);
+    CHECK(!first.str().empty());
+
+    std::stringstream second;
+    CHECK(codec.decode( bytes, second ));
+    CHECK(codec.verdict() == BsmFilter::Verdict::DROP);
+    CHECK(second.str().empty());
+}
+
+TEST_CASE("Trajectory Aggregator Tests", "[filter]" ) {
+    bsm_fast_path::Bsm bsm;
+    std::memset( &bsm, 0, sizeof( bsm ) );
+    bsm.id[3] = 7;
+
+    // a vehicle at 10 Hz for two 1 s windows; the polyline of at most 4 points spans the whole window.
+    TrajectoryAggregator trajectories{ 1000, 4 };
+    for ( uint64_t now = 0; now < 2000; now += 100 ) {
+        bsm.lat = static_cast<int32_t>( now );
+        bsm.speed = static_cast<uint16_t>( 100 + now % 1000 );
+        CHECK(trajectories.test( bsm, now ) == BsmFilter::Verdict::PASS);
+    }
+    CHECK(trajectories.vehicles() == 1);
+
+    std::vector<TrajectoryAggregator::Summary> summaries;
+    CHECK(trajectories.collect( 1999, summaries ) == 1);
+    REQUIRE(summaries.size() == 1);
+    CHECK(summaries[0].id == 7);
+    CHECK(summaries[0].window_start == 0);
+    CHECK(summaries[0].window_end == 1000);
+    CHECK(summaries[0].count == 10);
+    CHECK(summaries[0].min_speed == 100);
+    CHECK(summaries[0].max_speed == 1000);
+    REQUIRE(summaries[0].points.size() == 3);
+    CHECK(summaries[0].points[0].lat == 0);
+    CHECK(summaries[0].points[2].lat == 800);
+
+    std::string json;
+    TrajectoryAggregator::write_json( summaries[0], json );
+    CHECK(json == "{\"id\":\"00000007\",\"windowStart\":0,\"windowEnd\":1000,\"count\":10,\"minSpeed\":100,\"maxSpeed\":1000,"
+                  "\"points\":[[0,0,0],[400,0,0],[800,0,0]]}");
+    CHECK(TrajectoryAggregator::key( 0x0a0b0c0d ) == "0A0B0C0D");
+
+    // the open track is taken when its window ends; a BSM without a speed leaves it unavailable.
+    summaries.clear();
+    bsm.id[3] = 8;
+    bsm.speed = 8191;
+    CHECK(trajectories.test( bsm, 1500 ) == BsmFilter::Verdict::PASS);
+    CHECK(trajectories.collect( 2000, summaries ) == 2);
+    CHECK(trajectories.vehicles() == 0);
+    for ( const auto& s : summaries ) CHECK(s.count == ( s.id == 7 ? 10 : 1 ));
+    for ( const auto& s : summaries ) CHECK(( s.id == 7 || s.max_speed == 8191 ));
+
+    // past the capacity a vehicle is not tracked; a summary only aggregator drops the BSMs.
+    TrajectoryAggregator small{ 1000, 4, 1, BsmFilter::Verdict::DROP };
+    for ( uint8_t id = 0; id < 40; ++id ) {
+        bsm.id[3] = id;
+        CHECK(small.test( bsm, 0 ) == BsmFilter::Verdict::DROP);
+    }
+    CHECK(small.vehicles() + small.untracked() == 40);
+    CHECK(small.vehicles() <= 16);
+}
+
+TEST_CASE("BSM Deduplicator Tests", "[filter]" ) {
+    BsmDeduplicator dedup{ 2000, 1024 };
+    CHECK(dedup.capacity() == 1536);
+
+    // a copy within the window is dropped; another msgCnt, secMark, or vehicle is not a copy.
+    CHECK(dedup.test( 1, 2, 3, 0 ) == BsmFilter::Verdict::PASS);
+    CHECK(dedup.test( 1, 2, 3, 1999 ) == BsmFilter::Verdict::DROP);
+    CHECK(dedup.test( 1, 3, 3, 1999 ) == BsmFilter::Verdict::PASS);
+    CHECK(dedup.test( 1, 2, 4, 1999 ) == BsmFilter::Verdict::PASS);
+    CHECK(dedup.test( 2, 2, 3, 1999 ) == BsmFilter::Verdict::PASS);
+
+    // the key is forgotten after at most a fifth more than the window: a slice of 400 ms, and 6 slices live.
+    CHECK(dedup.test( 1, 2, 3, 2600 ) == BsmFilter::Verdict::PASS);
+    // a key of the start of a slice is forgotten 2400 ms later, and one of its end is kept for the whole window.
+    BsmDeduplicator edges{ 2000, 1024 };
+    CHECK(edges.test( 5, 0, 0, 0 ) == BsmFilter::Verdict::PASS);
+    CHECK(edges.test( 6, 0, 0, 0 ) == BsmFilter::Verdict::PASS);
+    CHECK(edges.test( 5, 0, 0, 2399 ) == BsmFilter::Verdict::DROP);
+    CHECK(edges.test( 6, 0, 0, 2400 ) == BsmFilter::Verdict::PASS);
+    CHECK(edges.test( 7, 0, 0, 2799 ) == BsmFilter::Verdict::PASS);
+    CHECK(edges.test( 8, 0, 0, 2799 ) == BsmFilter::Verdict::PASS);
+    CHECK(edges.test( 7, 0, 0, 4799 ) == BsmFilter::Verdict::DROP);
+    CHECK(edges.test( 8, 0, 0, 4800 ) == BsmFilter::Verdict::PASS);
+
+    // every BSM of 500 vehicles at 10 Hz, heard by 3 RSUs, is decoded once.
+    BsmDeduplicator corridor{ 2000 };
+    std::size_t passed = 0;
+    for ( uint64_t now = 10000; now < 20000; now += 100 ) {
+        for ( uint32_t id = 0; id < 500; ++id ) {
+            for ( uint64_t copy = 0; copy < 3; ++copy ) {
+                if ( corridor.test( id, static_cast<uint8_t>( now / 100 % 128 ), static_cast<uint16_t>( now % 60000 ), now + copy * 30 ) == BsmFilter::Verdict::PASS ) ++passed;
+            }
+        }
+    }
+    CHECK(passed == 50000);
+
+    // a second copy writes no response.
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+
+    BsmDeduplicator codec_dedup{ 60000 };
+    for ( bool path : { true, false } ) {
+        BsmCodec codec;
+        codec.set_bsm_fast_path( path );
+        codec.add_filter( &codec_dedup );
+
+        std::stringstream output;
+        CHECK(codec.decode( bytes, output ));
+        CHECK(codec.verdict() == ( path ? BsmFilter::Verdict::PASS : BsmFilter::Verdict::DROP ));
+        CHECK(output.str().empty() == !path);
+    }
+}
+
+TEST_CASE("Error Breaker Tests", "[filter]" ) {
+    const uint32_t data = static_cast<uint32_t>( Asn1ErrorType::DATA );
+    ErrorBreaker breaker{ 3, 1000, 10 };
+
+    // the errors below the threshold are reported; the one that opens the breaker is the first sample.
+    std::size_t reported = 0;
+    for ( uint64_t now = 0; now < 23; ++now ) {
+        if ( breaker.report( "in", 0, data, now ) ) ++reported;
+    }
+    CHECK(reported == 5);
+    CHECK(breaker.suppressed() == 18);
+
+    // the other partitions keep their full reports.
+    CHECK(breaker.report( "in", 1, data, 30 ));
+    CHECK(breaker.report( "other", 0, data, 30 ));
+
+    std::vector<ErrorBreaker::Summary> summaries = breaker.summaries( 500 );
+    REQUIRE(summaries.size() == 1);
+    CHECK(summaries[0].topic == "in");
+    CHECK(summaries[0].partition == 0);
+    CHECK(summaries[0].errors == 23);
+    CHECK(summaries[0].reported == 5);
+    CHECK(summaries[0].suppressed[data] == 18);
+    CHECK(summaries[0].open);
+
+    // a busy window keeps the breaker open; a quiet one closes it.
+    summaries = breaker.summaries( 1500 );
+    REQUIRE(summaries.size() == 1);
+    CHECK(summaries[0].errors == 0);
+    CHECK(summaries[0].open);
+
+    summaries = breaker.summaries( 2600 );
+    REQUIRE(summaries.size() == 1);
+    CHECK(!summaries[0].open);
+    CHECK(breaker.summaries( 2700 ).empty());
+    CHECK(breaker.report( "in", 0, data, 2700 ));
+
+    // the codec gives the code of its last error response.
+    std::string garbage{ "\xff\xff\xff\xff" };
+    BsmCodec codec;
+    std::stringstream output;
+    CHECK(!codec.decode( garbage, output ));
+    CHECK(codec.error_type() == Asn1ErrorType::DATA);
+
+    std::string bytes = read_file( "data/j2735.MessageFrame.Bsm.uper" );
+    REQUIRE(!bytes.empty());
+    CHECK(codec.decode( bytes, output ));
+    CHECK(codec.error_type() == Asn1ErrorType::SUCCESS);
+}
+
+TEST_CASE("Memory Budget Tests", "[queue]" ) {
+    MemoryBudget budget{ 1000 };
+    CHECK(budget.limit( MemoryBudget::Component::QUEUES ) == 400);
+    CHECK(budget.limit( MemoryBudget::Component::BATCH ) == 100);
+
+    budget.set_total( 1000, "queues=50,caches=50" );
+    CHECK(budget.limit( MemoryBudget::Component::QUEUES ) == 500);
+    CHECK(budget.limit( MemoryBudget::Component::ARENAS ) == 0);
+    for ( const char* bad : { "queue=50", "queues=", "queues=x", "queues=101", "queues=60,caches=50" } ) {
+        CHECK_THROWS_AS(budget.set_total( 1000, bad ), const std::invalid_argument&);
+    }
+
+    // the share is only exceeded by a reservation made when nothing else is reserved.
+    CHECK(budget.try_reserve( MemoryBudget::Component::QUEUES, 800 ));
+    CHECK(!budget.try_reserve( MemoryBudget::Component::QUEUES, 1 ));
+    budget.release( MemoryBudget::Component::QUEUES, 800 );
+    CHECK(budget.try_reserve( MemoryBudget::Component::QUEUES, 300 ));
+    CHECK(budget.try_reserve( MemoryBudget::Component::QUEUES, 200 ));
+    CHECK(!budget.try_reserve( MemoryBudget::Component::QUEUES, 1 ));
+    CHECK(budget.in_use( MemoryBudget::Component::QUEUES ) == 500);
+    CHECK(budget.high_water( MemoryBudget::Component::QUEUES ) == 800);
+
+    // a reservation waits for the release that makes room.
+    std::thread releaser{ [&budget]() {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+        budget.release( MemoryBudget::Component::QUEUES, 300 );
+    } };
+    budget.reserve( MemoryBudget::Component::QUEUES, 100 );
+    releaser.join();
+    CHECK(budget.in_use( MemoryBudget::Component::QUEUES ) == 300);
+
+    // the components that size themselves only report their use.
+    budget.adjust( MemoryBudget::Component::CACHES, 0, 2000 );
+    budget.adjust( MemoryBudget::Component::CACHES, 2000, 1500 );
+    CHECK(budget.in_use( MemoryBudget::Component::CACHES ) == 1500);
+    CHECK(budget.high_water( MemoryBudget::Component::CACHES ) == 2000);
+
+    // no total limits nothing.
+    budget.set_total( 0 );
+    CHECK(budget.limit( MemoryBudget::Component::QUEUES ) == 0);
+    CHECK(budget.try_reserve( MemoryBudget::Component::QUEUES, 1 << 20 ));
+}
+
+TEST_CASE("Concurrent Stress Tests", "[stress]" ) {
+    // the objects the workers share, used from several threads at once. Catch is not thread safe, so the threads count
+    // what goes wrong and it is checked after they join. Run these in an ACM_THREAD_SANITIZER build to find the races
+    // the checks cannot see.
+    const std::size_t thread_count = std::max<std::size_t>( 4, std::min<std::size_t>( 8, std::thread::hardware_concurrency() ) );
+    const std::size_t rounds = 2000;
+    std::atomic<std::size_t> failures{ 0 };
+
+    auto run = [thread_count]( const std::function<void( std::size_t )>& work ) {
+        std::vector<std::thread> threads;
+        for ( std::size_t t = 0; t < thread_count; ++t ) threads.emplace_back( work, t );
+        for ( std::thread& thread : threads ) thread.join();
+    };
+
+    SECTION( "Codec Contexts" ) {
+        // each worker has its own context; they share the asn1c type tables, the encode plans, and the pugixml
+        // allocation hooks, which use the page pool of the calling thread.
+        struct Input {
+            const char* file;
+            bool decode;
+            std::string message;
+            std::string expected;
+        };
+
+        std::vector<Input> inputs{
+            { "data/InputData.Ieee1609Dot2Data.Bsm.packed.xml", true, "", "" },
+            { "data/InputData.TravelerInformation.packed.xml", true, "", "" },
+            { "data/InputData.encoding.bsm.xml", false, "", "" },
+            { "unit-test-data/1609_BSM.xml", false, "", "" }
+        };
+
+        auto payload = []( const std::string& response ) {
+            pugi::xml_document doc;
+            if ( !doc.load_buffer( response.data(), response.size() ) ) return std::string{};
+            std::stringstream data;
+            doc.child("OdeAsn1Data").child("payload").child("data").print( data );
+            return data.str();
+        };
+
+        auto make = []( bool decode, bool cached ) {
+            std::unique_ptr<CodecContext> codec{ new CodecContext{ nullptr, nullptr, decode } };
+            codec->use_arena( 1 << 16 );
+            codec->use_xml_pool( 1 << 16 );
+            if ( cached ) {
+                codec->use_decode_cache( 1 << 16 );
+                codec->use_encode_cache( 1 << 16 );
+            }
+            return codec;
+        };
+
+        for ( Input& input : inputs ) {
+            INFO( input.file );
+            input.message = read_file( input.file );
+            REQUIRE(!input.message.empty());
+
+            std::stringstream output;
+            REQUIRE(make( input.decode, false )->process( input.message.data(), input.message.size(), output ));
+            input.expected = payload( output.str() );
+            REQUIRE(!input.expected.empty());
+        }
+
+        run( [&]( std::size_t t ) {
+            std::unique_ptr<CodecContext> decoder = make( true, t % 2 == 1 );
+            std::unique_ptr<CodecContext> encoder = make( false, t % 2 == 1 );
+
+            for ( std::size_t r = 0; r < rounds / 10; ++r ) {
+                const Input& input = inputs[ ( r + t ) % inputs.size() ];
+                std::stringstream output;
+                CodecContext& codec = input.decode ? *decoder : *encoder;
+                if ( !codec.process( input.message.data(), input.message.size(), output ) || payload( output.str() ) != input.expected ) ++failures;
+            }
+        } );
+
+        CHECK(failures == 0);
+    }
+
+    SECTION( "Certificate Cache" ) {
+        // more certificates than are kept, so the shards forget them while they are found.
+        UnvalidatedCertificateCache cache{ 64 };
+
+        run( [&]( std::size_t t ) {
+            for ( std::size_t r = 0; r < rounds; ++r ) {
+                uint8_t n = static_cast<uint8_t>( ( r * 7 + t ) % 251 );
+                UnvalidatedCertificateCache::Entry certificate = std::make_shared<UnvalidatedCertificateCache::Certificate>();
+                for ( uint8_t i = 0; i < 32; ++i ) certificate->hash[i] = n + i;
+                std::memcpy( certificate->id, certificate->hash + 24, sizeof( certificate->id ) );
+                certificate->key[0] = 0x02;
+                std::memset( certificate->key + 1, n, 32 );
+                certificate->key_size = 33;
+
+                UnvalidatedCertificateCache::Entry kept = cache.insert( certificate );
+                if ( !kept || std::memcmp( kept->hash, certificate->hash, sizeof( kept->hash ) ) != 0 ) ++failures;
+
+                UnvalidatedCertificateCache::Entry found = cache.find( certificate->id );
+                if ( found && std::memcmp( found->id, certificate->id, sizeof( found->id ) ) != 0 ) ++failures;
+                found = cache.find_hash( certificate->hash );
+                if ( found && std::memcmp( found->hash, certificate->hash, sizeof( found->hash ) ) != 0 ) ++failures;
+
+                if ( r % 97 == 0 ) cache.revoke( certificate->id );
+            }
+        } );
+
+        CHECK(failures == 0);
+        CHECK(cache.size() <= cache.capacity());
+    }
+
+    SECTION( "BSM Filters" ) {
+        // every thread hears every BSM; the deduplicator passes exactly one copy of each.
+        BsmDeduplicator dedup{ 60000 };
+        BsmRateLimiter limiter{ 100, 1024 };
+        std::unique_ptr<std::atomic<uint32_t>[]> passed{ new std::atomic<uint32_t>[ rounds ]() };
+
+        run( [&]( std::size_t t ) {
+            for ( std::size_t r = 0; r < rounds; ++r ) {
+                uint32_t id = static_cast<uint32_t>( r );
+                if ( dedup.test( id, static_cast<uint8_t>( r % 128 ), static_cast<uint16_t>( r % 60000 ), 1000 + r ) == BsmFilter::Verdict::PASS ) ++passed[r];
+                limiter.test( id % 64, 1000 + r + t );
+            }
+        } );
+
+        for ( std::size_t r = 0; r < rounds; ++r ) {
+            if ( passed[r] != 1 ) ++failures;
+        }
+        CHECK(failures == 0);
+    }
+
+    SECTION( "Error Breaker" ) {
+        // the summaries taken while the errors are reported account for every error.
+        ErrorBreaker breaker{ 1, 60000, 10 };
+        std::atomic<uint64_t> summarized{ 0 };
+
+        auto summarize = [&breaker, &summarized]() {
+            for ( const ErrorBreaker::Summary& summary : breaker.summaries() ) summarized += summary.errors;
+        };
+
+        run( [&]( std::size_t t ) {
+            for ( std::size_t r = 0; r < rounds; ++r ) {
+                breaker.report( "stress", static_cast<int32_t>( t % 2 ), static_cast<uint32_t>( r % ErrorBreaker::codes ) );
+                if ( r % 256 == 0 ) summarize();
+            }
+        } );
+
+        summarize();
+        CHECK(summarized == thread_count * rounds);
+    }
+
+    SECTION( "Memory Budget" ) {
+        // more reservations than fit, so the blocking reservations wait for the releases of the other threads.
+        MemoryBudget budget{ 10000 };
+        const std::size_t limit = budget.limit( MemoryBudget::Component::QUEUES );
+
+        run( [&]( std::size_t t ) {
+            for ( std::size_t r = 0; r < rounds; ++r ) {
+                std::size_t bytes = 500 + ( r + t ) % 500;
+                if ( r % 2 ) {
+                    budget.reserve( MemoryBudget::Component::QUEUES, bytes );
+                } else if ( !budget.try_reserve( MemoryBudget::Component::QUEUES, bytes ) ) {
+                    continue;
+                }
+                budget.release( MemoryBudget::Component::QUEUES, bytes );
+            }
+        } );
+
+        CHECK(budget.in_use( MemoryBudget::Component::QUEUES ) == 0);
+        CHECK(budget.high_water( MemoryBudget::Component::QUEUES ) <= limit);
+    }
+
+    SECTION( "Buffer Pool and Queue" ) {
+        // the responses' buffers pass between threads through the queue, as from the workers to the producers.
+        OutputBufferPool pool{ 64, 16 };
+        RingQueue<char*> queue{ 16 };
+        std::atomic<std::size_t> producing{ thread_count / 2 };
+        std::atomic<std::size_t> consumed{ 0 };
+
+        run( [&]( std::size_t t ) {
+            if ( t < thread_count / 2 ) {
+                for ( std::size_t r = 0; r < rounds; ++r ) {
+                    char* data = pool.acquire();
+                    if ( r % 8 == 0 ) data = pool.grow( data, 256 );
+                    std::memset( data, static_cast<int>( t ), 64 );
+                    if ( !queue.push( data ) ) ++failures;
+                }
+                if ( --producing == 0 ) queue.close();
+                return;
+            }
+
+            char* data = nullptr;
+            while ( queue.pop( data ) ) {
+                for ( std::size_t i = 1; i < 64; ++i ) {
+                    if ( data[i] != data[0] ) ++failures;
+                }
+                pool.release( data );
+                ++consumed;
+            }
+        } );
+
+        CHECK(failures == 0);
+        CHECK(consumed == thread_count / 2 * rounds);
+        CHECK(pool.available() <= 16);
+    }
+
+    SECTION( "Latency Registries" ) {
+        // the histograms are created and recorded by the workers while another thread takes them.
+        MessageLatencies latencies;
+        SlowMessages slow{ 10, 60000 };
+        std::atomic<uint64_t> taken{ 0 };
+
+        auto take = [&latencies, &taken]() {
+            latencies.take( [&taken]( const std::string&, const char*, const LatencyHistogram::Snapshot& snapshot ) {
+                taken += snapshot.count;
+            } );
+        };
+
+        run( [&]( std::size_t t ) {
+            for ( std::size_t r = 0; r < rounds; ++r ) {
+                latencies.partition( "stress", static_cast<int32_t>( r % 4 ) ).acm.record( 1000 + r );
+                latencies.delivery( "stress.out" ).record( 1000 + t );
+
+                int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+                slow.record( "stress", static_cast<int32_t>( t ), static_cast<int64_t>( r ), r * 1000 + t, now );
+
+                if ( t == 0 && r % 100 == 0 ) {
+                    take();
+                    if ( slow.recent().size() > 20 ) ++failures;
+                }
+            }
+        } );
+
+        take();
+        CHECK(taken == 2 * thread_count * rounds);
+        CHECK(failures == 0);
+    }
+}
@@ -0,0 +1,238 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "tim_template.hpp"
+#include "asn1_arena.hpp"
+#include "hex_codec.hpp"
+#include "TravelerDataFrame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    struct FieldTag {
+        const char* tag;                                                ///> the start tag without its '<'.
+        std::size_t length;
+    };
+
+    // in the order of TimTemplates::Field.
+    const FieldTag field_tags[] = {
+        { "msgCnt>", 7 }, { "timeStamp>", 10 }, { "packetID>", 9 }, { "startTime>", 10 }, { "duratonTime>", 12 }
+    };
+
+    const char tim_tag[] = "<TravelerInformation>";
+
+    /**
+     * @brief Parse the decimal text of an INTEGER; false when it is not one or does not fit.
+     */
+    bool parse_long( const char* text, std::size_t length, long& value ) {
+        bool negative = length > 0 && text[0] == '-';
+        std::size_t i = negative ? 1 : 0;
+        if ( i == length || length - i > 18 ) return false;
+
+        long v = 0;
+        for ( ; i < length; ++i ) {
+            if ( text[i] < '0' || text[i] > '9' ) return false;
+            v = v * 10 + ( text[i] - '0' );
+        }
+
+        value = negative ? -v : v;
+        return true;
+    }
+}
+
+TimTemplates::TimTemplates( std::size_t capacity ) :
+    capacity_{ capacity ? capacity : 1 }
+    , templates_{}
+    , lookups_{ 0 }
+    , hits_{ 0 }
+    , misses_{ 0 }
+    , key_{}
+    , values_{}
+    , bytes_{}
+{}
+
+TimTemplates::~TimTemplates()
+{
+    clear();
+}
+
+bool TimTemplates::split( const char* xer, std::size_t length )
+{
+    const char* end = xer + length;
+
+    key_.clear();
+    values_.clear();
+
+    if ( std::search( xer, end, tim_tag, tim_tag + sizeof( tim_tag ) - 1 ) == end ) return false;
+
+    const char* copied = xer;
+    const char* p = xer;
+
+    while ( ( p = static_cast<const char*>( std::memchr( p, '<', end - p ) ) ) ) {
+        const char* name = p + 1;
+        bool varying = false;
+
+        for ( std::size_t f = 0; f < sizeof( field_tags ) / sizeof( field_tags[0] ); ++f ) {
+            const FieldTag& t = field_tags[f];
+            if ( static_cast<std::size_t>( end - name ) <= t.length || std::memcmp( name, t.tag, t.length ) != 0 ) continue;
+
+            // the value is the text up to the end tag; it leaves a gap in the key.
+            const char* text = name + t.length;
+            const char* close = static_cast<const char*>( std::memchr( text, '<', end - text ) );
+            if ( !close ) return false;
+
+            key_.append( copied, text );
+            values_.push_back( Value{ static_cast<Field>( f ), text, static_cast<std::size_t>( close - text ) } );
+            copied = close;
+            p = close;
+            varying = true;
+            break;
+        }
+
+        if ( !varying ) ++p;
+    }
+
+    key_.append( copied, end );
+    return true;
+}
+
+MessageFrame_t* TimTemplates::find()
+{
+    ++lookups_;
+
+    for ( Template& t : templates_ ) {
+        if ( t.key.size() != key_.size() || t.key != key_ ) continue;
+
+        // a packetID of another length is reallocated, and must not come from the message's arena.
+        Asn1Arena::Suspend heap;
+        if ( !patch( *t.frame ) ) break;
+
+        t.used = lookups_;
+        ++hits_;
+        return t.frame;
+    }
+
+    ++misses_;
+    return nullptr;
+}
+
+void TimTemplates::insert( MessageFrame_t* frame )
+{
+    Asn1Arena::Suspend heap;
+
+    for ( Template& t : templates_ ) {
+        if ( t.key == key_ ) {
+            ASN_STRUCT_FREE( asn_DEF_MessageFrame, t.frame );
+            t.frame = frame;
+            t.used = lookups_;
+            return;
+        }
+    }
+
+    if ( templates_.size() < capacity_ ) {
+        templates_.push_back( Template{ key_, frame, lookups_ } );
+        return;
+    }
+
+    auto oldest = std::min_element( templates_.begin(), templates_.end(),
+            []( const Template& a, const Template& b ) { return a.used < b.used; } );
+
+    ASN_STRUCT_FREE( asn_DEF_MessageFrame, oldest->frame );
+    *oldest = Template{ key_, frame, lookups_ };
+}
+
+std::size_t TimTemplates::size() const
+{
+    return templates_.size();
+}
+
+uint64_t TimTemplates::hits() const
+{
+    return hits_;
+}
+
+uint64_t TimTemplates::misses() const
+{
+    return misses_;
+}
+
+void TimTemplates::clear()
+{
+    Asn1Arena::Suspend heap;
+
+    for ( Template& t : templates_ ) {
+        ASN_STRUCT_FREE( asn_DEF_MessageFrame, t.frame );
+    }
+    templates_.clear();
+}
+
+bool TimTemplates::patch( MessageFrame_t& frame )
+{
+    if ( frame.value.present != MessageFrame__value_PR_TravelerInformation ) return false;
+
+    TravelerInformation_t& tim = frame.value.choice.TravelerInformation;
+    int frames = tim.dataFrames.list.count;
+    int start_times = 0;
+    int duration_times = 0;
+    long value;
+
+    for ( const Value& v : values_ ) {
+        switch ( v.field ) {
+            case Field::MSG_CNT:
+                if ( !parse_long( v.text, v.length, value ) ) return false;
+                tim.msgCnt = value;
+                break;
+
+            case Field::TIME_STAMP:
+                if ( !tim.timeStamp || !parse_long( v.text, v.length, value ) ) return false;
+                *tim.timeStamp = value;
+                break;
+
+            case Field::PACKET_ID:
+                if ( !tim.packetID ) return false;
+                bytes_.resize( ( v.length + 1 ) / 2 );
+                if ( hex_codec::decode( v.text, v.length, bytes_.data() ) != hex_codec::npos ) return false;
+                if ( static_cast<std::size_t>( tim.packetID->size ) == bytes_.size() ) {
+                    std::memcpy( tim.packetID->buf, bytes_.data(), bytes_.size() );
+                } else if ( OCTET_STRING_fromBuf( tim.packetID, reinterpret_cast<const char*>( bytes_.data() ), static_cast<int>( bytes_.size() ) ) != 0 ) {
+                    return false;
+                }
+                break;
+
+            case Field::START_TIME:
+                // the elements elsewhere in the TIM with these names are not the frames' times.
+                if ( start_times >= frames || !parse_long( v.text, v.length, value ) ) return false;
+                tim.dataFrames.list.array[ start_times++ ]->startTime = value;
+                break;
+
+            case Field::DURATION_TIME:
+                if ( duration_times >= frames || !parse_long( v.text, v.length, value ) ) return false;
+                tim.dataFrames.list.array[ duration_times++ ]->duratonTime = value;
+                break;
+        }
+    }
+
+    return start_times == frames && duration_times == frames;
+}
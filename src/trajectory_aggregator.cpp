@@ -0,0 +1,190 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "trajectory_aggregator.hpp"
+#include "hex_codec.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+    const uint16_t speed_unavailable = 8191;
+}
+
+constexpr std::size_t TrajectoryAggregator::shard_count;
+
+TrajectoryAggregator::TrajectoryAggregator( uint32_t window_ms, std::size_t max_points, std::size_t capacity, Verdict verdict ) :
+    window_{ std::max<uint32_t>( 1, window_ms ) }
+    , max_points_{ std::max<std::size_t>( 2, max_points ) }
+    , shard_capacity_{ std::max<std::size_t>( 1, ( capacity + shard_count - 1 ) / shard_count ) }
+    , verdict_{ verdict }
+    , shards_{ new Shard[ shard_count ] }
+    , untracked_{ 0 }
+{}
+
+BsmFilter::Verdict TrajectoryAggregator::test( const bsm_fast_path::Bsm& bsm ) {
+    return test( bsm, bsm_filter::system_ms() );
+}
+
+BsmFilter::Verdict TrajectoryAggregator::test( const bsm_fast_path::Bsm& bsm, uint64_t now_ms ) {
+    uint32_t id = bsm_filter::vehicle_id( bsm );
+    uint64_t window_start = now_ms / window_ * window_;
+
+    Shard& shard = shards_[ bsm_filter::shard_of<shard_count>( id ) ];
+
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+
+    auto found = shard.tracks.find( id );
+    if ( found == shard.tracks.end() ) {
+        if ( shard.tracks.size() >= shard_capacity_ ) {
+            ++untracked_;
+            return verdict_;
+        }
+        found = shard.tracks.emplace( id, Track{} ).first;
+        start( found->second, id, window_start );
+
+    } else if ( found->second.summary.window_start < window_start ) {
+        shard.ended.push_back( std::move( found->second.summary ) );
+        start( found->second, id, window_start );
+    }
+
+    add( found->second, bsm );
+    return verdict_;
+}
+
+std::size_t TrajectoryAggregator::collect( uint64_t now_ms, std::vector<Summary>& summaries ) {
+    std::size_t before = summaries.size();
+
+    for ( std::size_t i = 0; i < shard_count; ++i ) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock{ shard.mutex };
+
+        for ( Summary& s : shard.ended ) summaries.push_back( std::move( s ) );
+        shard.ended.clear();
+
+        for ( auto it = shard.tracks.begin(); it != shard.tracks.end(); ) {
+            if ( it->second.summary.window_end <= now_ms ) {
+                summaries.push_back( std::move( it->second.summary ) );
+                it = shard.tracks.erase( it );
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    return summaries.size() - before;
+}
+
+std::string TrajectoryAggregator::key( uint32_t id ) {
+    uint8_t bytes[4] = { static_cast<uint8_t>( id >> 24 ), static_cast<uint8_t>( id >> 16 ), static_cast<uint8_t>( id >> 8 ),
+        static_cast<uint8_t>( id ) };
+    char hex[8];
+    hex_codec::encode( bytes, sizeof( bytes ), hex );
+    return std::string( hex, sizeof( hex ) );
+}
+
+void TrajectoryAggregator::write_json( const Summary& summary, std::string& json ) {
+    json += "{\"id\":\"";
+    json += key( summary.id );
+    json += "\",\"windowStart\":";
+    json += std::to_string( summary.window_start );
+    json += ",\"windowEnd\":";
+    json += std::to_string( summary.window_end );
+    json += ",\"count\":";
+    json += std::to_string( summary.count );
+    json += ",\"minSpeed\":";
+    json += std::to_string( summary.min_speed );
+    json += ",\"maxSpeed\":";
+    json += std::to_string( summary.max_speed );
+    json += ",\"points\":[";
+
+    for ( std::size_t i = 0; i < summary.points.size(); ++i ) {
+        const Point& p = summary.points[i];
+        if ( i > 0 ) json += ',';
+        json += '[';
+        json += std::to_string( p.lat );
+        json += ',';
+        json += std::to_string( p.lon );
+        json += ',';
+        json += std::to_string( p.sec_mark );
+        json += ']';
+    }
+
+    json += "]}";
+}
+
+uint32_t TrajectoryAggregator::window() const {
+    return static_cast<uint32_t>( window_ );
+}
+
+std::size_t TrajectoryAggregator::vehicles() const {
+    std::size_t n = 0;
+    for ( std::size_t i = 0; i < shard_count; ++i ) {
+        std::lock_guard<std::mutex> lock{ shards_[i].mutex };
+        n += shards_[i].tracks.size();
+    }
+    return n;
+}
+
+uint64_t TrajectoryAggregator::untracked() const {
+    return untracked_.load();
+}
+
+void TrajectoryAggregator::start( Track& track, uint32_t id, uint64_t window_start ) {
+    Summary& s = track.summary;
+    s.id = id;
+    s.window_start = window_start;
+    s.window_end = window_start + window_;
+    s.count = 0;
+    s.min_speed = speed_unavailable;
+    s.max_speed = speed_unavailable;
+    s.points.clear();
+    s.points.reserve( std::min<std::size_t>( max_points_, 16 ) );
+    track.stride = 1;
+}
+
+void TrajectoryAggregator::add( Track& track, const bsm_fast_path::Bsm& bsm ) {
+    Summary& s = track.summary;
+    uint64_t n = s.count++;
+
+    // both are unavailable until a BSM has a speed.
+    if ( bsm.speed != speed_unavailable ) {
+        bool first = s.min_speed == speed_unavailable;
+        s.min_speed = first ? bsm.speed : std::min( s.min_speed, bsm.speed );
+        s.max_speed = first ? bsm.speed : std::max( s.max_speed, bsm.speed );
+    }
+
+    if ( n % track.stride != 0 ) return;
+
+    if ( s.points.size() == max_points_ ) {
+        // the points of the BSMs numbered by the doubled stride are kept.
+        std::size_t kept = 0;
+        for ( std::size_t i = 0; i < s.points.size(); i += 2 ) s.points[ kept++ ] = s.points[i];
+        s.points.resize( kept );
+        track.stride *= 2;
+        if ( n % track.stride != 0 ) return;
+    }
+
+    s.points.push_back( Point{ bsm.lat, bsm.lon, bsm.sec_mark } );
+}
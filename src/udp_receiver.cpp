@@ -0,0 +1,143 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "udp_receiver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+UdpReceiver::UdpReceiver( const std::string& host, uint16_t port, std::size_t batch, std::size_t max_bytes ) :
+    host_{ host }
+    , port_{ port }
+    , max_bytes_{ max_bytes }
+    , fd_{ -1 }
+    , buffers_( batch * max_bytes )
+    , iovecs_( batch )
+    , headers_( batch )
+{
+    for ( std::size_t i = 0; i < batch; ++i ) {
+        iovecs_[i].iov_base = buffers_.data() + i * max_bytes;
+        iovecs_[i].iov_len = max_bytes;
+        std::memset( &headers_[i], 0, sizeof( headers_[i] ) );
+        headers_[i].msg_hdr.msg_iov = &iovecs_[i];
+        headers_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+UdpReceiver::~UdpReceiver()
+{
+    if ( fd_ >= 0 ) ::close( fd_ );
+}
+
+void UdpReceiver::parse_listen( const std::string& listen, std::string& host, uint16_t& port )
+{
+    std::size_t colon = listen.rfind( ':' );
+    std::string number = ( colon == std::string::npos ) ? listen : listen.substr( colon + 1 );
+    host = ( colon == std::string::npos ) ? std::string{} : listen.substr( 0, colon );
+    if ( host.size() >= 2 && host.front() == '[' && host.back() == ']' ) host = host.substr( 1, host.size() - 2 );
+
+    char* end = nullptr;
+    long value = std::strtol( number.c_str(), &end, 10 );
+    if ( number.empty() || *end != '\0' || value < 1 || value > 65535 ) {
+        throw std::invalid_argument{ "not a listen address, [host:]port: " + listen };
+    }
+    port = static_cast<uint16_t>( value );
+}
+
+bool UdpReceiver::open()
+{
+    // without a host the IPv6 wildcard also receives IPv4; a host without IPv6 is left with the IPv4 wildcard.
+    if ( host_.empty() ) return bind_to( AF_INET6 ) || bind_to( AF_INET );
+    return bind_to( AF_UNSPEC );
+}
+
+bool UdpReceiver::bind_to( int family )
+{
+    struct addrinfo hints;
+    std::memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+    struct addrinfo* addresses = nullptr;
+    std::string service = std::to_string( port_ );
+    if ( getaddrinfo( host_.empty() ? nullptr : host_.c_str(), service.c_str(), &hints, &addresses ) != 0 ) {
+        errno = EADDRNOTAVAIL;
+        return false;
+    }
+
+    int e = EADDRNOTAVAIL;
+    for ( struct addrinfo* a = addresses; a != nullptr; a = a->ai_next ) {
+        fd_ = ::socket( a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol );
+        if ( fd_ < 0 ) {
+            e = errno;
+            continue;
+        }
+
+        // every worker binds the same address; the kernel balances the datagrams across their sockets.
+        int on = 1;
+        int off = 0;
+        setsockopt( fd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof( on ) );
+        if ( a->ai_family == AF_INET6 ) setsockopt( fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof( off ) );
+
+        if ( ::bind( fd_, a->ai_addr, a->ai_addrlen ) == 0 ) break;
+
+        e = errno;
+        ::close( fd_ );
+        fd_ = -1;
+    }
+    freeaddrinfo( addresses );
+
+    if ( fd_ < 0 ) {
+        errno = e;
+        return false;
+    }
+    return true;
+}
+
+std::size_t UdpReceiver::receive( int timeout_ms )
+{
+    if ( fd_ < 0 ) return 0;
+
+    struct pollfd pfd{ fd_, POLLIN, 0 };
+    if ( poll( &pfd, 1, timeout_ms ) <= 0 ) return 0;
+
+    // take what is queued, without waiting for a full batch.
+    int n = recvmmsg( fd_, headers_.data(), static_cast<unsigned int>( headers_.size() ), MSG_DONTWAIT, nullptr );
+    return n > 0 ? static_cast<std::size_t>( n ) : 0;
+}
+
+UdpReceiver::Datagram UdpReceiver::datagram( std::size_t i ) const
+{
+    const struct mmsghdr& header = headers_[i];
+    return Datagram{ buffers_.data() + i * max_bytes_, std::min<std::size_t>( header.msg_len, max_bytes_ ),
+        ( header.msg_hdr.msg_flags & MSG_TRUNC ) != 0 };
+}
@@ -0,0 +1,151 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+
+#include "unvalidated_certificate_cache.hpp"
+#include "bsm_filter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+    // 2004-01-01 00:00:00 UTC in Unix time, and the leap seconds added since (2005, 2008, 2012, 2015, and 2016).
+    constexpr int64_t time32_epoch = 1072915200;
+    constexpr int64_t time32_leap_seconds = 5;
+}
+
+UnvalidatedCertificateCache::Certificate::Certificate() :
+    id{}
+    , hash{}
+    , key{}
+    , key_size{ 0 }
+    , start{ 0 }
+    , end{ 0 }
+    , revoked{ false }
+    , parse_once{}
+    , parsed{}
+{}
+
+bool UnvalidatedCertificateCache::Certificate::current( uint32_t now ) const {
+    return start <= now && now < end;
+}
+
+UnvalidatedCertificateCache::UnvalidatedCertificateCache( std::size_t capacity ) :
+    shard_capacity_{ std::max<std::size_t>( 1, ( capacity + shard_count - 1 ) / shard_count ) }
+    , ids_{ new Shard[ shard_count ] }
+    , revoked_mutex_{}
+    , revoked_{}
+    , check_{}
+{}
+
+uint64_t UnvalidatedCertificateCache::id_key( const uint8_t id[8] ) {
+    uint64_t key;
+    std::memcpy( &key, id, sizeof( key ) );
+    return key;
+}
+
+UnvalidatedCertificateCache::Entry UnvalidatedCertificateCache::lookup( const Shard* shards, uint64_t key ) {
+    // the top bits of the mixed key choose the shard.
+    const Shard& shard = shards[ bsm_filter::shard_of<shard_count>( key ) ];
+
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+    auto it = shard.entries.find( key );
+    return it == shard.entries.end() ? nullptr : it->second;
+}
+
+void UnvalidatedCertificateCache::keep( Shard* shards, uint64_t key, const Entry& certificate ) {
+    Shard& shard = shards[ bsm_filter::shard_of<shard_count>( key ) ];
+
+    std::lock_guard<std::mutex> lock{ shard.mutex };
+    if ( !shard.entries.emplace( key, certificate ).second ) return;
+
+    shard.order.push_back( key );
+    if ( shard.order.size() > shard_capacity_ ) {
+        shard.entries.erase( shard.order.front() );
+        shard.order.pop_front();
+    }
+}
+
+UnvalidatedCertificateCache::Entry UnvalidatedCertificateCache::find( const uint8_t id[8] ) const {
+    return lookup( ids_.get(), id_key( id ) );
+}
+
+UnvalidatedCertificateCache::Entry UnvalidatedCertificateCache::find_hash( const uint8_t hash[32] ) const {
+    // the HashedId8 is the low 8 bytes of the hash; the rest must match too.
+    Entry certificate = lookup( ids_.get(), id_key( hash + 24 ) );
+    if ( certificate && std::memcmp( certificate->hash, hash, sizeof( certificate->hash ) ) != 0 ) return nullptr;
+    return certificate;
+}
+
+UnvalidatedCertificateCache::Entry UnvalidatedCertificateCache::insert( Entry certificate ) {
+    uint64_t id = id_key( certificate->id );
+
+    Entry kept = lookup( ids_.get(), id );
+    bool same = kept && std::memcmp( kept->hash, certificate->hash, sizeof( kept->hash ) ) == 0;
+    if ( same ) return kept;
+
+    {
+        std::lock_guard<std::mutex> lock{ revoked_mutex_ };
+        bool revoked = revoked_.count( id ) > 0 || ( check_ && check_( *certificate ) );
+        certificate->revoked.store( revoked, std::memory_order_relaxed );
+    }
+
+    // two threads may insert a new certificate at once; either copy serves. Another certificate with a kept HashedId8
+    // is not kept, so the frames signed with that digest keep finding the first.
+    if ( !kept ) keep( ids_.get(), id, certificate );
+    return certificate;
+}
+
+void UnvalidatedCertificateCache::revoke( const uint8_t id[8] ) {
+    {
+        std::lock_guard<std::mutex> lock{ revoked_mutex_ };
+        revoked_.insert( id_key( id ) );
+    }
+
+    Entry certificate = find( id );
+    if ( certificate ) certificate->revoked.store( true, std::memory_order_relaxed );
+}
+
+void UnvalidatedCertificateCache::set_revocation_check( RevocationCheck check ) {
+    std::lock_guard<std::mutex> lock{ revoked_mutex_ };
+    check_ = std::move( check );
+}
+
+std::size_t UnvalidatedCertificateCache::size() const {
+    std::size_t n = 0;
+    for ( std::size_t i = 0; i < shard_count; ++i ) {
+        std::lock_guard<std::mutex> lock{ ids_[i].mutex };
+        n += ids_[i].entries.size();
+    }
+    return n;
+}
+
+std::size_t UnvalidatedCertificateCache::capacity() const {
+    return shard_capacity_ * shard_count;
+}
+
+uint32_t UnvalidatedCertificateCache::now() {
+    int64_t unix_seconds = std::chrono::duration_cast<std::chrono::seconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+    return static_cast<uint32_t>( unix_seconds - time32_epoch + time32_leap_seconds );
+}
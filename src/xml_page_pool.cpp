@@ -0,0 +1,276 @@
+/**
+ * @file
+ *
+ * @copyright Copyright 2017 US DOT - Joint Program Office
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License")
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Contributors:
+ *    Oak Ridge National Laboratory, Center for Trustworthy Embedded Systems, UT Battelle.
+ */
+
+
+#include "xml_page_pool.hpp"
+#include "pugixml.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace {
+
+    // every block is preceded by a header holding its class.
+    constexpr std::size_t header_size = 16;
+    constexpr std::size_t smallest_class = 64;
+
+    thread_local XmlPagePool* current_pool = nullptr;
+
+    // the chunks of every pool, so a block freed where its pool is not active goes back to its pool and is never
+    // passed to free(). The chunks are added and removed under the mutex and read without it: a slot is published by
+    // its base, which is stored last and cleared first. These are never destroyed; pugixml documents may be freed
+    // during static destruction.
+    constexpr std::size_t max_chunks = 4096;
+
+    struct Range {
+        std::atomic<const char*> base;                  ///> null when the slot is free.
+        std::atomic<const char*> end;
+        std::atomic<XmlPagePool*> owner;
+    };
+
+    std::mutex& registry_mutex() {
+        static std::mutex* m = new std::mutex;
+        return *m;
+    }
+
+    Range* registry() {
+        static Range* r = new Range[ max_chunks ]();
+        return r;
+    }
+
+    std::atomic<std::size_t> registry_size{ 0 };        // the slots ever used.
+
+    bool register_chunk( const char* base, std::size_t size, XmlPagePool* owner ) {
+        std::lock_guard<std::mutex> lock{ registry_mutex() };
+        Range* ranges = registry();
+        std::size_t used = registry_size.load( std::memory_order_relaxed );
+
+        std::size_t slot = 0;
+        while ( slot < used && ranges[slot].base.load( std::memory_order_relaxed ) ) ++slot;
+        if ( slot == max_chunks ) return false;
+
+        ranges[slot].owner.store( owner, std::memory_order_relaxed );
+        ranges[slot].end.store( base + size, std::memory_order_relaxed );
+        ranges[slot].base.store( base, std::memory_order_release );
+        if ( slot == used ) registry_size.store( used + 1, std::memory_order_release );
+        return true;
+    }
+
+    void unregister_chunk( const char* base ) {
+        std::lock_guard<std::mutex> lock{ registry_mutex() };
+        Range* ranges = registry();
+        std::size_t used = registry_size.load( std::memory_order_relaxed );
+
+        for ( std::size_t slot = 0; slot < used; ++slot ) {
+            if ( ranges[slot].base.load( std::memory_order_relaxed ) == base ) {
+                ranges[slot].base.store( nullptr, std::memory_order_release );
+                return;
+            }
+        }
+    }
+
+    // the pool whose chunk holds ptr, or null; takes no lock.
+    XmlPagePool* owner_of( const void* ptr ) {
+        const char* p = static_cast<const char*>( ptr );
+        const Range* ranges = registry();
+        std::size_t used = registry_size.load( std::memory_order_acquire );
+
+        for ( std::size_t slot = 0; slot < used; ++slot ) {
+            const char* base = ranges[slot].base.load( std::memory_order_acquire );
+            if ( !base || p < base ) continue;
+
+            const char* end = ranges[slot].end.load( std::memory_order_relaxed );
+            XmlPagePool* owner = ranges[slot].owner.load( std::memory_order_relaxed );
+
+            // a slot reused while it was read is skipped; a live block is never in the chunk being replaced.
+            if ( ranges[slot].base.load( std::memory_order_acquire ) != base ) continue;
+            if ( p < end ) return owner;
+        }
+        return nullptr;
+    }
+
+    void* pugi_allocate( std::size_t size ) {
+        void* ptr = current_pool ? current_pool->allocate( size ) : nullptr;
+        return ptr ? ptr : std::malloc( size );
+    }
+
+    void pugi_deallocate( void* ptr ) {
+        if ( !ptr ) return;
+
+        if ( current_pool && current_pool->owns( ptr ) ) {
+            current_pool->release( ptr );
+            return;
+        }
+
+        XmlPagePool* owner = owner_of( ptr );
+        if ( owner ) {
+            owner->release_remote( ptr );
+        } else {
+            std::free( ptr );
+        }
+    }
+}
+
+XmlPagePool::Scope::Scope( XmlPagePool* pool ) :
+    pool_{ pool }
+    , previous_{ current_pool }
+{
+    if ( pool_ ) current_pool = pool_;
+}
+
+XmlPagePool::Scope::~Scope()
+{
+    if ( pool_ ) current_pool = previous_;
+}
+
+XmlPagePool::XmlPagePool( std::size_t chunk_size ) :
+    chunk_size_{ chunk_size ? chunk_size : 1 }
+    , chunks_{}
+    , offset_{ 0 }
+    , free_{}
+    , remote_{ nullptr }
+    , recycled_{ 0 }
+{}
+
+XmlPagePool::~XmlPagePool()
+{
+    for ( auto& chunk : chunks_ ) {
+        unregister_chunk( chunk.base );
+        std::free( chunk.base );
+    }
+}
+
+XmlPagePool* XmlPagePool::current()
+{
+    return current_pool;
+}
+
+void XmlPagePool::install()
+{
+    static const bool installed = ( pugi::set_memory_management_functions( pugi_allocate, pugi_deallocate ), true );
+    (void)installed;
+}
+
+std::size_t XmlPagePool::class_of( std::size_t size )
+{
+    if ( size <= smallest_class ) return 0;
+    if ( size > class_size( class_count - 1 ) ) return class_count;
+
+    // 2^k < size <= 2^(k+1), in four steps of 2^(k-2).
+    std::size_t k = 6;
+    while ( ( std::size_t{ 1 } << ( k + 1 ) ) < size ) ++k;
+    return ( k - 6 ) * 4 + ( size - 1 - ( std::size_t{ 1 } << k ) ) / ( std::size_t{ 1 } << ( k - 2 ) ) + 1;
+}
+
+std::size_t XmlPagePool::class_size( std::size_t index )
+{
+    if ( index == 0 ) return smallest_class;
+
+    std::size_t k = ( index - 1 ) / 4 + 6;
+    return ( std::size_t{ 1 } << k ) + ( ( index - 1 ) % 4 + 1 ) * ( std::size_t{ 1 } << ( k - 2 ) );
+}
+
+bool XmlPagePool::add_chunk( std::size_t minimum )
+{
+    Chunk chunk{ nullptr, minimum > chunk_size_ ? minimum : chunk_size_ };
+    chunk.base = static_cast<char*>( std::malloc( chunk.size ) );
+    if ( !chunk.base ) return false;
+
+    if ( !register_chunk( chunk.base, chunk.size, this ) ) {
+        std::free( chunk.base );
+        return false;
+    }
+
+    chunks_.push_back( chunk );
+    offset_ = 0;
+    return true;
+}
+
+void* XmlPagePool::allocate( std::size_t size )
+{
+    std::size_t index = class_of( size );
+    if ( index >= class_count ) return nullptr;
+
+    // the blocks freed on other threads are taken back when the class has none of its own.
+    if ( !free_[index] && remote_.load( std::memory_order_relaxed ) ) {
+        void* block = remote_.exchange( nullptr, std::memory_order_acquire );
+        while ( block ) {
+            void* next = *static_cast<void**>( block );
+            release( block );
+            block = next;
+        }
+    }
+
+    if ( free_[index] ) {
+        void* ptr = free_[index];
+        free_[index] = *static_cast<void**>( ptr );
+        ++recycled_;
+        return ptr;
+    }
+
+    // the rest of the last chunk is given up when the block does not fit; it is never more than the largest class.
+    std::size_t needed = header_size + class_size( index );
+    if ( chunks_.empty() || chunks_.back().size - offset_ < needed ) {
+        if ( !add_chunk( needed ) ) return nullptr;
+    }
+
+    char* block = chunks_.back().base + offset_;
+    offset_ += needed;
+    *reinterpret_cast<std::size_t*>( block ) = index;
+    return block + header_size;
+}
+
+void XmlPagePool::release( void* ptr )
+{
+    std::size_t index = *reinterpret_cast<std::size_t*>( static_cast<char*>( ptr ) - header_size );
+    *static_cast<void**>( ptr ) = free_[index];
+    free_[index] = ptr;
+}
+
+void XmlPagePool::release_remote( void* ptr )
+{
+    void* head = remote_.load( std::memory_order_relaxed );
+    do {
+        *static_cast<void**>( ptr ) = head;
+    } while ( !remote_.compare_exchange_weak( head, ptr, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+bool XmlPagePool::owns( const void* ptr ) const
+{
+    const char* p = static_cast<const char*>( ptr );
+    for ( const auto& chunk : chunks_ ) {
+        if ( p >= chunk.base && p < chunk.base + chunk.size ) return true;
+    }
+    return false;
+}
+
+std::size_t XmlPagePool::bytes_reserved() const
+{
+    std::size_t total = 0;
+    for ( const auto& chunk : chunks_ ) total += chunk.size;
+    return total;
+}
+
+std::size_t XmlPagePool::blocks_recycled() const
+{
+    return recycled_;
+}